@@ -97,6 +97,9 @@ const { DriveUploader } = require('./src/lib/drive-uploader');
 const { FolderSync } = require('./src/lib/folder-sync');
 const { SyncTracker } = require('./src/lib/sync-tracker');
 const { FolderWatcher } = require('./src/lib/folder-watcher');
+const { createExclusionMatcher, rebasePatterns } = require('./src/lib/exclusions');
+const { consumeBatchFile } = require('./src/lib/shell-batch');
+const { startShellCommandServer } = require('./src/lib/shell-ipc');
 
 // Single instance lock
 const gotTheLock = app.requestSingleInstanceLock();
@@ -112,6 +115,7 @@ if (!gotTheLock) {
   let driveUploader = null;
   let syncTracker = null;
   let folderWatcher = null;
+  let shellCommandServer = null;
 
   // Initialize store
   store = new Store({
@@ -144,6 +148,11 @@ if (!gotTheLock) {
     return path.normalize(p).toLowerCase();
   }
 
+  function isPathUnder(childPath, parentPath) {
+    const relative = path.relative(normalizeLocalPath(parentPath), normalizeLocalPath(childPath));
+    return Boolean(relative) && !relative.startsWith('..') && !path.isAbsolute(relative);
+  }
+
   function normalizeExcludePaths(paths = []) {
     return [...paths].map(p => p.toLowerCase()).sort();
   }
@@ -820,6 +829,18 @@ if (!gotTheLock) {
     }
   }
 
+  // Paths a job's overlay state is shown on: the files it is limited to, or
+  // its whole folder.
+  function getJobOverlayPaths(job) {
+    return job.onlyFiles && job.onlyFiles.length > 0 ? job.onlyFiles : [job.folderPath];
+  }
+
+  function setJobOverlayStatus(job, state) {
+    if (syncTracker) {
+      syncTracker.setOverlayStatus(getJobOverlayPaths(job), state);
+    }
+  }
+
   function enqueueSyncJob(jobInput, options = {}) {
     const job = normalizeSyncJob(jobInput);
     if (!job) return null;
@@ -851,6 +872,7 @@ if (!gotTheLock) {
         if (normalizeLocalPath(existing.folderPath) !== normalizedFolder) return true;
         if (existing.mode !== 'sync') return true;
         if (!existing.onlyFiles || existing.onlyFiles.length === 0) return true; // keep other full syncs
+        setJobOverlayStatus(existing, null);
         return false; // remove individual-file syncs for this folder
       });
       if (syncQueue.length < before) {
@@ -865,6 +887,7 @@ if (!gotTheLock) {
       syncQueue.push(job);
     }
 
+    setJobOverlayStatus(job, 'pending');
     persistSyncQueue();
     updateTrayTooltip();
 
@@ -1033,26 +1056,40 @@ if (!gotTheLock) {
 
   async function runSyncJob(job) {
     if (!googleAuth.isAuthenticated()) {
+      setJobOverlayStatus(job, null);
       showNotification('Not Signed In', 'Please sign in to Google Drive first.');
       createWindow();
       return;
     }
 
     if (!fs.existsSync(job.folderPath)) {
+      setJobOverlayStatus(job, null);
       showNotification('Sync Skipped', `Folder not found: ${job.folderPath}`);
       return;
     }
 
+    const mappings = store.get('folderMappings') || [];
+    const existingMapping = mappings.find(m => normalizeLocalPath(m.localPath) === normalizeLocalPath(job.folderPath));
+    // A job for a subfolder of a synced folder (a watcher rescan) syncs into
+    // that folder's Drive tree, with its exclusions restated for the subfolder.
+    const parentMapping = existingMapping ? null : mappings.find(m => isPathUnder(job.folderPath, m.localPath));
+    const excludePaths = parentMapping
+      ? rebasePatterns(parentMapping.excludePaths, path.relative(parentMapping.localPath, job.folderPath))
+      : existingMapping?.excludePaths || [];
+    if (!excludePaths) {
+      setJobOverlayStatus(job, null);
+      safeLog(`Sync skipped: ${job.folderPath} is excluded from ${parentMapping.localPath}`);
+      return;
+    }
+
     const startedMs = Date.now();
+    setJobOverlayStatus(job, 'syncing');
     await createProgressWindow(job.folderPath, job);
 
     try {
       const folderSync = new FolderSync(driveUploader, store, logDir, syncTracker);
-      const existingMapping = (store.get('folderMappings') || []).find(
-        m => normalizeLocalPath(m.localPath) === normalizeLocalPath(job.folderPath)
-      );
-      if (existingMapping?.excludePaths?.length) {
-        folderSync.setExcludePaths(existingMapping.excludePaths);
+      if (excludePaths.length > 0) {
+        folderSync.setExcludePaths(excludePaths);
       }
 
       currentSync = folderSync;
@@ -1082,6 +1119,7 @@ if (!gotTheLock) {
 
       // Check if cancelled
       if (folderSync.cancelled) {
+        setJobOverlayStatus(job, null);
         clearActiveSyncSession();
         updateTrayTooltip();
         return;
@@ -1089,19 +1127,22 @@ if (!gotTheLock) {
 
       // Track this sync in our database
       if (result.folderId && result.shareLink) {
-        syncTracker.trackSync(job.folderPath, result.folderId, result.shareLink, 'folder');
-
-        // Track each uploaded file individually
-        if (result.uploadedFiles) {
-          for (const file of result.uploadedFiles) {
-            syncTracker.trackSync(file.localPath, file.driveId, file.driveUrl, 'file', {
+        // The folder and every uploaded file in one database batch
+        syncTracker.bulkTrackSync([
+          { localPath: job.folderPath, driveId: result.folderId, driveUrl: result.shareLink, type: 'folder' },
+          ...(result.uploadedFiles || []).map(file => ({
+            localPath: file.localPath,
+            driveId: file.driveId,
+            driveUrl: file.driveUrl,
+            type: 'file',
+            metadata: {
               sizeBytes: Number.isFinite(file.sizeBytes) ? file.sizeBytes : null,
               mtimeMs: Number.isFinite(file.mtimeMs) ? file.mtimeMs : null
-            });
-          }
-        }
+            }
+          }))
+        ]);
 
-        if (job.mode === 'sync') {
+        if (job.mode === 'sync' && !parentMapping) {
           // Add to folder mappings and start watching
           const mappings = store.get('folderMappings') || [];
           const existingIndex = mappings.findIndex(m => normalizeLocalPath(m.localPath) === normalizeLocalPath(job.folderPath));
@@ -1138,6 +1179,15 @@ if (!gotTheLock) {
         clipboard.writeText(result.shareLink);
       }
 
+      // A full sync settles every state beneath the folder; failed files keep
+      // an error overlay until a later sync uploads them.
+      if (job.onlyFiles && job.onlyFiles.length > 0) {
+        setJobOverlayStatus(job, null);
+      } else {
+        syncTracker.clearOverlayStatusUnder(job.folderPath);
+      }
+      syncTracker.setOverlayStatus((result.failedFiles || []).map(f => f.localPath), 'error');
+
       const report = {
         jobId: job.id,
         mode: job.mode,
@@ -1178,6 +1228,7 @@ if (!gotTheLock) {
       updateTrayTooltip();
     } catch (error) {
       safeLog('Sync job failed:', error);
+      setJobOverlayStatus(job, 'error');
       showNotification(job.mode === 'copy' ? 'Copy Failed' : 'Sync Failed', error.message);
 
       store.set('lastSyncReport', {
@@ -1199,6 +1250,8 @@ if (!gotTheLock) {
     } finally {
       currentSync = null;
       activeSyncJob = null;
+      // Files tracked during the job only marked the link index stale.
+      syncTracker.flushDriveLinkIndex();
     }
   }
 
@@ -1317,6 +1370,85 @@ if (!gotTheLock) {
     );
   }
 
+  // Several items selected in Explorer arrive as one request file. Items
+  // inside another selected folder were already dropped by the extension.
+  function handleBatchRequest(batchFile) {
+    const request = consumeBatchFile(batchFile);
+    if (!request || request.paths.length === 0) {
+      safeLog('Ignoring unreadable batch request:', batchFile);
+      return;
+    }
+    handleShellRequest(request);
+  }
+
+  // A context menu command, from the shell command pipe or a --batch file.
+  // A single item gets the same handling as its command line flag.
+  function handleShellRequest(request) {
+    if (request.paths.length === 1) {
+      const [itemPath] = request.paths;
+      if (request.mode === 'sync') {
+        handleFolderUpload(itemPath);
+      } else if (request.mode === 'copy') {
+        handleCopyToGdrive(itemPath);
+      } else {
+        handleGetUrl(itemPath);
+      }
+      return;
+    }
+
+    if (request.mode === 'get-url') {
+      handleGetUrls(request.paths);
+      return;
+    }
+
+    const isCopy = request.mode === 'copy';
+    if (!googleAuth.isAuthenticated()) {
+      showNotification('Not Signed In', 'Please sign in to Google Drive first.');
+      createWindow();
+      return;
+    }
+
+    // One queue pass handles every folder; one notification covers them.
+    const missing = [];
+    let queued = 0;
+    for (const folderPath of request.paths) {
+      if (!fs.existsSync(folderPath)) {
+        missing.push(folderPath);
+        continue;
+      }
+      if (enqueueSyncJob({ folderPath, mode: isCopy ? 'copy' : 'sync', source: 'manual' }, { notify: false })) {
+        queued++;
+      }
+    }
+
+    const verb = isCopy ? 'Copy' : 'Sync';
+    const missingNote = missing.length > 0 ? ` ${missing.length} not found.` : '';
+    showNotification(`${verb} Queued`, `${queued} folder(s) added to the queue.${missingNote}`);
+  }
+
+  // Links of several items, one per line, in selection order.
+  function handleGetUrls(itemPaths) {
+    const links = [];
+    for (const itemPath of itemPaths) {
+      const info = syncTracker.getSyncInfo(itemPath);
+      const url = info && info.driveUrl ? info.driveUrl : syncTracker.getParentSyncInfo(itemPath)?.driveUrl;
+      if (url) {
+        links.push(url);
+      }
+    }
+
+    if (links.length === 0) {
+      showNotification('Not Synced', 'None of the selected items have been synced yet.');
+      return;
+    }
+    clipboard.writeText(links.join('\r\n'));
+    const skipped = itemPaths.length - links.length;
+    showNotification(
+      'Links Copied!',
+      `${links.length} Google Drive link(s) copied to clipboard.${skipped > 0 ? ` ${skipped} item(s) not synced.` : ''}`
+    );
+  }
+
   function hasShellCommandArg(args = []) {
     const commandFlags = [
       '--sync-folder',
@@ -1324,7 +1456,8 @@ if (!gotTheLock) {
       '--copy-folder',
       '--copy',
       '--get-url',
-      '--open-drive'
+      '--open-drive',
+      '--batch'
     ];
     return commandFlags.some((flag) => args.includes(flag));
   }
@@ -1344,6 +1477,13 @@ if (!gotTheLock) {
       return null;
     }
 
+    // Several selected items in one request file
+    const batchFile = findPathAfterFlag(argv, '--batch');
+    if (batchFile) {
+      handleBatchRequest(batchFile);
+      return;
+    }
+
     // Look for --sync-folder argument (upload + watch)
     const folderPath = findPathAfterFlag(argv, '--sync-folder');
     if (folderPath) {
@@ -1515,7 +1655,7 @@ if (!gotTheLock) {
     }
 
     try {
-      const excluded = (excludePaths || []).map(p => p.toLowerCase());
+      const excluded = createExclusionMatcher((excludePaths || []).map(pattern => ({ root: '', pattern })));
 
       // Walk local filesystem
       const localFiles = new Map(); // normalised key → display relPath
@@ -1526,7 +1666,7 @@ if (!gotTheLock) {
           if (entry.name.startsWith('.')) continue;
           const rel = relBase ? `${relBase}/${entry.name}` : entry.name;
           // Skip excluded subfolders
-          if (excluded.some(ex => rel.toLowerCase() === ex || rel.toLowerCase().startsWith(ex + '/'))) continue;
+          if (excluded.isExcluded(rel)) continue;
           if (entry.isFile()) {
             localFiles.set(rel.toLowerCase(), rel);
           } else if (entry.isDirectory()) {
@@ -1821,12 +1961,20 @@ if (!gotTheLock) {
     await googleAuth.loadTokens(); // Load saved tokens from keytar
     driveUploader = new DriveUploader(googleAuth);
     syncTracker = new SyncTracker();
+    // Exclusions change through settings and the add/remove handlers alike.
+    syncTracker.persistExclusionIndex(store.get('folderMappings') || []);
+    store.onDidChange('folderMappings', (mappings) => {
+      syncTracker.persistExclusionIndex(mappings || []);
+    });
+    for (const job of syncQueue) {
+      setJobOverlayStatus(job, 'pending');
+    }
 
     // Initialize folder watcher
     folderWatcher = new FolderWatcher();
 
-    // Handle file changes from watcher
-    folderWatcher.on('file-changed', async (data) => {
+    // Handle file changes from watcher: one coalesced batch per folder burst
+    folderWatcher.on('files-changed', async (data) => {
       if (!googleAuth.isAuthenticated()) {
         safeLog('Skipping auto-sync - not authenticated');
         return;
@@ -1835,21 +1983,24 @@ if (!gotTheLock) {
         safeLog('Skipping auto-sync - autoUpload disabled');
         return;
       }
-      // Skip files we just downloaded from Drive — avoid the upload→download loop
-      if (recentlyDownloadedFromDrive.has(data.filePath)) {
-        safeLog(`Skipping upload of ${data.relativePath} — recently downloaded from Drive`);
-        return;
-      }
 
-      const { filePath, localPath, driveName, relativePath } = data;
-      if (!fs.existsSync(filePath)) {
+      const { localPath, driveName } = data;
+      const filePaths = data.filePaths.filter((filePath, i) => {
+        // Skip files we just downloaded from Drive — avoid the upload→download loop
+        if (recentlyDownloadedFromDrive.has(filePath)) {
+          safeLog(`Skipping upload of ${data.relativePaths[i]} — recently downloaded from Drive`);
+          return false;
+        }
+        return fs.existsSync(filePath);
+      });
+      if (filePaths.length === 0) {
         return;
       }
 
       const queued = enqueueSyncJob({
         folderPath: localPath,
         mode: 'sync',
-        onlyFiles: [filePath],
+        onlyFiles: filePaths,
         source: 'watcher'
       }, { notify: false });
 
@@ -1857,20 +2008,24 @@ if (!gotTheLock) {
       // rapid or overlapping changes don't get silently dropped.
       if (!queued) {
         setTimeout(() => {
-          if (!fs.existsSync(filePath)) return;
           if (!googleAuth.isAuthenticated()) return;
           if (!store.get('autoUpload')) return;
+          const remaining = filePaths.filter(filePath => fs.existsSync(filePath));
+          if (remaining.length === 0) return;
           enqueueSyncJob({
             folderPath: localPath,
             mode: 'sync',
-            onlyFiles: [filePath],
+            onlyFiles: remaining,
             source: 'watcher-retry'
           }, { notify: false });
         }, 10000);
       }
 
       if (queued && store.get('showNotifications')) {
-        showNotification('File Queued', `${relativePath} queued for sync to ${driveName}`);
+        const what = filePaths.length === 1
+          ? path.relative(localPath, filePaths[0])
+          : `${filePaths.length} files`;
+        showNotification('Files Queued', `${what} queued for sync to ${driveName}`);
       }
 
       updateTrayTooltip();
@@ -1919,6 +2074,25 @@ if (!gotTheLock) {
       }, { notify: false });
     });
 
+    // The watcher lost track of changes under a directory (its event buffer
+    // overflowed, or the directory was replaced) — syncing that directory
+    // catches up; only a rescan of the synced folder itself syncs all of it.
+    folderWatcher.on('rescan', async (data) => {
+      if (!googleAuth.isAuthenticated() || !store.get('autoUpload')) {
+        return;
+      }
+
+      const { dirPath, localPath, relativePath } = data;
+      const folderPath = dirPath && isPathUnder(dirPath, localPath) ? dirPath : localPath;
+      safeLog(`Watcher rescan: ${relativePath || '.'} — queuing sync of ${folderPath}`);
+
+      enqueueSyncJob({
+        folderPath,
+        mode: 'sync',
+        source: 'watcher-rescan'
+      }, { notify: false });
+    });
+
     // A subdirectory was deleted locally — trash its Drive counterpart
     folderWatcher.on('dir-deleted', async (data) => {
       const { dirPath, relativePath, driveName } = data;
@@ -1964,6 +2138,13 @@ if (!gotTheLock) {
     // Check for folder argument on startup
     handleArgs(process.argv);
 
+    // Context menu commands from the shell extension, without a process launch
+    shellCommandServer = startShellCommandServer((request) => {
+      if (request.paths.length > 0) {
+        handleShellRequest(request);
+      }
+    }, safeLog);
+
     // Start queue processing if any jobs exist and auth is ready.
     processSyncQueue();
 
@@ -2020,8 +2201,15 @@ if (!gotTheLock) {
   app.on('before-quit', () => {
     app.isQuitting = true;
     stopDrivePolling();
+    if (shellCommandServer) {
+      shellCommandServer.close();
+      shellCommandServer = null;
+    }
     if (folderWatcher) {
       folderWatcher.unwatchAll();
     }
+    if (syncTracker) {
+      syncTracker.flushDriveLinkIndex();
+    }
   });
 }
@@ -0,0 +1,20 @@
+// RRightclickrr native addon entry point
+//
+// Exposes the C++ engines shared with the shell extension to the Electron
+// app. Every binding is optional from JS: src/lib/native.js falls back to
+// the pure JS paths when the addon is missing.
+
+#include "NapiUtil.h"
+
+static napi_value Init(napi_env env, napi_value exports)
+{
+    if (!RegisterOverlayIndex(env, exports) || !RegisterShellStats(env, exports) || !RegisterExclusions(env, exports) ||
+        !RegisterDirectoryScan(env, exports) || !RegisterFileHash(env, exports) || !RegisterSyncDatabase(env, exports) ||
+        !RegisterChangeWatch(env, exports))
+    {
+        return nullptr;
+    }
+    return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
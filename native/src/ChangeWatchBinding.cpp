@@ -0,0 +1,351 @@
+// watchDirectory(root, options, onBatch) -> {close(), stats()}
+//
+// FolderWatcher's native watcher. Raw events are coalesced on the watcher's
+// own thread (ChangeWatcher.h) and reach onBatch as
+// {groups: [{directory, names, types}]}, one entry per changed path, with
+// types 'add', 'change', 'unlink', 'addDir', 'unlinkDir' or 'rescan'. A
+// batch only comes once the folder has been quiet for quietMs (or the
+// oldest change is maxDelayMs old), so the JS thread sees one call per burst
+// instead of one per event.
+//
+// options: {quietMs, maxDelayMs, maxPending, skipHidden, skipDirectoryNames,
+// skipFileSuffixes}. Throws when root cannot be watched; the caller falls
+// back to chokidar. Errors while watching come as {groups: [], error,
+// stopped}; once stopped is true no batch follows and the caller has to
+// watch again and rescan.
+
+#include "ChangeWatcher.h"
+#include "NapiUtil.h"
+#include <memory>
+#include <new>
+
+namespace
+{
+// What the watcher thread queues for onBatch: a batch, or an error.
+struct Delivery
+{
+    ChangeBatch batch;
+    std::string error;
+    bool stopped = false;
+};
+
+struct WatchHandle
+{
+    CChangeWatcher watcher;
+    napi_threadsafe_function onBatch = nullptr;
+    bool closed = false; // JS thread only
+};
+
+// Shared by the JS object and the threadsafe function, since either can go
+// first.
+using WatchHandlePtr = std::shared_ptr<WatchHandle>;
+
+const char *TypeName(ChangeKind kind)
+{
+    switch (kind)
+    {
+    case ChangeKind::Added:
+        return "add";
+    case ChangeKind::Modified:
+        return "change";
+    case ChangeKind::Deleted:
+        return "unlink";
+    case ChangeKind::DirectoryAdded:
+        return "addDir";
+    case ChangeKind::DirectoryDeleted:
+        return "unlinkDir";
+    case ChangeKind::Rescan:
+        break;
+    }
+    return "rescan";
+}
+
+bool GetOptions(napi_env env, napi_value object, ChangeWatchOptions &options)
+{
+    napi_valuetype type = napi_undefined;
+    if (napi_typeof(env, object, &type) != napi_ok)
+    {
+        return false;
+    }
+    if (type == napi_undefined || type == napi_null)
+    {
+        return true;
+    }
+    if (type != napi_object)
+    {
+        return false;
+    }
+
+    napi_value value = nullptr;
+    uint32_t number = 0;
+    if (GetOptionalProperty(env, object, "quietMs", value) && napi_get_value_uint32(env, value, &number) == napi_ok)
+    {
+        options.coalescer.quietMs = number;
+    }
+    if (GetOptionalProperty(env, object, "maxDelayMs", value) && napi_get_value_uint32(env, value, &number) == napi_ok)
+    {
+        options.coalescer.maxDelayMs = number;
+    }
+    if (GetOptionalProperty(env, object, "maxPending", value) &&
+        napi_get_value_uint32(env, value, &number) == napi_ok && number > 0)
+    {
+        options.coalescer.maxPending = number;
+    }
+    if (GetOptionalProperty(env, object, "skipHidden", value))
+    {
+        napi_get_value_bool(env, value, &options.skipDotNames);
+    }
+    return !(GetOptionalProperty(env, object, "skipDirectoryNames", value) &&
+             !GetUtf8StringArray(env, value, options.skipDirectoryNames)) &&
+           !(GetOptionalProperty(env, object, "skipFileSuffixes", value) &&
+             !GetUtf8StringArray(env, value, options.skipFileSuffixes));
+}
+
+napi_value CreateGroup(napi_env env, const ChangeGroup &group)
+{
+    napi_value object = nullptr;
+    napi_value directory = nullptr;
+    napi_value names = nullptr;
+    napi_value types = nullptr;
+    NAPI_CALL(env, napi_create_object(env, &object));
+    NAPI_CALL(env, napi_create_string_utf8(env, group.directory.data(), group.directory.size(), &directory));
+    NAPI_CALL(env, napi_create_array_with_length(env, group.changes.size(), &names));
+    NAPI_CALL(env, napi_create_array_with_length(env, group.changes.size(), &types));
+    for (size_t i = 0; i < group.changes.size(); i++)
+    {
+        const CoalescedChange &change = group.changes[i];
+        napi_value name = nullptr;
+        napi_value type = nullptr;
+        NAPI_CALL(env, napi_create_string_utf8(env, change.name.data(), change.name.size(), &name));
+        NAPI_CALL(env, napi_create_string_utf8(env, TypeName(change.kind), NAPI_AUTO_LENGTH, &type));
+        NAPI_CALL(env, napi_set_element(env, names, static_cast<uint32_t>(i), name));
+        NAPI_CALL(env, napi_set_element(env, types, static_cast<uint32_t>(i), type));
+    }
+    NAPI_CALL(env, napi_set_named_property(env, object, "directory", directory));
+    NAPI_CALL(env, napi_set_named_property(env, object, "names", names));
+    NAPI_CALL(env, napi_set_named_property(env, object, "types", types));
+    return object;
+}
+
+napi_value CreateBatch(napi_env env, const Delivery &delivery)
+{
+    const ChangeBatch &batch = delivery.batch;
+    napi_value object = nullptr;
+    napi_value groups = nullptr;
+    NAPI_CALL(env, napi_create_object(env, &object));
+    NAPI_CALL(env, napi_create_array_with_length(env, batch.groups.size(), &groups));
+    for (size_t i = 0; i < batch.groups.size(); i++)
+    {
+        napi_value group = CreateGroup(env, batch.groups[i]);
+        if (!group)
+        {
+            return nullptr;
+        }
+        NAPI_CALL(env, napi_set_element(env, groups, static_cast<uint32_t>(i), group));
+    }
+    NAPI_CALL(env, napi_set_named_property(env, object, "groups", groups));
+    if (!delivery.error.empty())
+    {
+        napi_value error = nullptr;
+        napi_value stopped = nullptr;
+        NAPI_CALL(env, napi_create_string_utf8(env, delivery.error.data(), delivery.error.size(), &error));
+        NAPI_CALL(env, napi_get_boolean(env, delivery.stopped, &stopped));
+        NAPI_CALL(env, napi_set_named_property(env, object, "error", error));
+        NAPI_CALL(env, napi_set_named_property(env, object, "stopped", stopped));
+    }
+    return object;
+}
+
+// JS thread: hands one batch or error to onBatch. Anything still queued
+// when the watcher is closed is dropped.
+void CallOnBatch(napi_env env, napi_value callback, void *context, void *data)
+{
+    auto *handle = static_cast<WatchHandle *>(context);
+    std::unique_ptr<Delivery> delivery(static_cast<Delivery *>(data));
+    if (!env || handle->closed)
+    {
+        return;
+    }
+
+    napi_value undefined = nullptr;
+    napi_value argument = CreateBatch(env, *delivery);
+    napi_get_undefined(env, &undefined);
+    if (argument)
+    {
+        napi_call_function(env, undefined, callback, 1, &argument, nullptr);
+    }
+}
+
+void ReleaseHandle(napi_env, void *data, void *)
+{
+    delete static_cast<WatchHandlePtr *>(data);
+}
+
+void Close(WatchHandle &handle)
+{
+    if (handle.closed)
+    {
+        return;
+    }
+    handle.closed = true;
+    handle.watcher.Stop();
+    napi_release_threadsafe_function(handle.onBatch, napi_tsfn_release);
+}
+
+// The JS object was collected without close().
+void FinalizeHandle(napi_env env, void *data, void *hint)
+{
+    Close(**static_cast<WatchHandlePtr *>(data));
+    ReleaseHandle(env, data, hint);
+}
+
+WatchHandle *GetThis(napi_env env, napi_callback_info info)
+{
+    napi_value self = nullptr;
+    void *data = nullptr;
+    if (napi_get_cb_info(env, info, nullptr, nullptr, &self, nullptr) != napi_ok ||
+        napi_unwrap(env, self, &data) != napi_ok)
+    {
+        napi_throw_type_error(env, nullptr, "Not a directory watcher");
+        return nullptr;
+    }
+    return static_cast<WatchHandlePtr *>(data)->get();
+}
+
+napi_value CloseBinding(napi_env env, napi_callback_info info)
+{
+    WatchHandle *handle = GetThis(env, info);
+    if (handle)
+    {
+        Close(*handle);
+    }
+    return nullptr;
+}
+
+napi_value StatsBinding(napi_env env, napi_callback_info info)
+{
+    WatchHandle *handle = GetThis(env, info);
+    if (!handle)
+    {
+        return nullptr;
+    }
+
+    const ChangeCoalescerStats stats = handle->watcher.Stats();
+    napi_value object = nullptr;
+    NAPI_CALL(env, napi_create_object(env, &object));
+    const struct
+    {
+        const char *name;
+        uint64_t value;
+    } fields[] = {
+        {"events", stats.events},     {"absorbed", stats.absorbed}, {"cancelled", stats.cancelled},
+        {"subsumed", stats.subsumed}, {"emitted", stats.emitted},   {"batches", stats.batches},
+        {"rescans", stats.rescans},   {"folds", stats.folds},       {"peakPending", stats.peakPending},
+    };
+    for (const auto &field : fields)
+    {
+        napi_value value = nullptr;
+        NAPI_CALL(env, napi_create_double(env, static_cast<double>(field.value), &value));
+        NAPI_CALL(env, napi_set_named_property(env, object, field.name, value));
+    }
+    return object;
+}
+
+napi_value WatchDirectoryBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 3;
+    napi_value args[3] = {};
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    std::string root;
+    ChangeWatchOptions options;
+    napi_valuetype callbackType = napi_undefined;
+    if (argc < 3 || !GetUtf8String(env, args[0], root) || root.empty() || !GetOptions(env, args[1], options) ||
+        napi_typeof(env, args[2], &callbackType) != napi_ok || callbackType != napi_function)
+    {
+        napi_throw_type_error(env, nullptr, "watchDirectory(root: string, options: object, onBatch: function)");
+        return nullptr;
+    }
+
+    WatchHandlePtr handle;
+    auto *tsfnOwner = new (std::nothrow) WatchHandlePtr();
+    auto *objectOwner = new (std::nothrow) WatchHandlePtr();
+    try
+    {
+        handle = std::make_shared<WatchHandle>();
+    }
+    catch (const std::bad_alloc &)
+    {
+    }
+    if (!handle || !tsfnOwner || !objectOwner)
+    {
+        delete tsfnOwner;
+        delete objectOwner;
+        napi_throw_error(env, nullptr, "Out of memory");
+        return nullptr;
+    }
+    *tsfnOwner = handle;
+    *objectOwner = handle;
+
+    // Unbounded queue: the watcher thread must never block on a busy JS
+    // thread, and coalescing keeps the batches few.
+    napi_value name = nullptr;
+    NAPI_CALL(env, napi_create_string_utf8(env, "watchDirectory", NAPI_AUTO_LENGTH, &name));
+    if (napi_create_threadsafe_function(env, args[2], nullptr, name, 0, 1, tsfnOwner, ReleaseHandle, handle.get(),
+                                        CallOnBatch, &handle->onBatch) != napi_ok)
+    {
+        delete tsfnOwner;
+        delete objectOwner;
+        ThrowLastError(env);
+        return nullptr;
+    }
+
+    napi_threadsafe_function onBatch = handle->onBatch;
+    const auto deliver = [onBatch](Delivery *queued) {
+        if (queued && napi_call_threadsafe_function(onBatch, queued, napi_tsfn_blocking) != napi_ok)
+        {
+            delete queued;
+        }
+    };
+    const bool started = handle->watcher.Start(
+        root, options,
+        [deliver](ChangeBatch &&batch) { deliver(new (std::nothrow) Delivery{std::move(batch), {}, false}); },
+        [deliver](const std::string &message, bool stopped) {
+            deliver(new (std::nothrow) Delivery{{}, message, stopped});
+        });
+    if (!started)
+    {
+        handle->closed = true;
+        napi_release_threadsafe_function(onBatch, napi_tsfn_release);
+        delete objectOwner;
+        const std::string text = "Cannot watch directory: " + root;
+        napi_throw_error(env, nullptr, text.c_str());
+        return nullptr;
+    }
+
+    napi_value object = nullptr;
+    napi_property_descriptor methods[] = {
+        {"close", nullptr, CloseBinding, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"stats", nullptr, StatsBinding, nullptr, nullptr, nullptr, napi_default, nullptr},
+    };
+    if (napi_create_object(env, &object) != napi_ok ||
+        napi_define_properties(env, object, sizeof(methods) / sizeof(methods[0]), methods) != napi_ok ||
+        napi_wrap(env, object, objectOwner, FinalizeHandle, nullptr, nullptr) != napi_ok)
+    {
+        Close(*handle);
+        delete objectOwner;
+        ThrowLastError(env);
+        return nullptr;
+    }
+    return object;
+}
+} // namespace
+
+napi_value RegisterChangeWatch(napi_env env, napi_value exports)
+{
+    if (!SetFunction(env, exports, "watchDirectory", WatchDirectoryBinding))
+    {
+        return nullptr;
+    }
+    return exports;
+}
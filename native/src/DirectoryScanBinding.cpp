@@ -0,0 +1,318 @@
+// scanDirectory(root, options, onBatch) -> Promise<totals>
+//
+// Lists a synced folder for FolderSync on the scanner's own thread pool, off
+// the JS thread. Batches of {files, sizes, mtimeMs, directories} reach
+// onBatch as they are found; the queue to the JS thread is short, so a busy
+// event loop slows the scan down instead of piling up paths. Returning false
+// from onBatch (or throwing) stops the scan. The promise settles after the
+// last batch has been delivered.
+
+#include "DirectoryScanner.h"
+#include "NapiUtil.h"
+#include "Utf8.h"
+#include <algorithm>
+#include <memory>
+#include <new>
+
+namespace
+{
+constexpr size_t kMaxQueuedBatches = 4;
+
+struct ScanRequest
+{
+    std::string root;
+    DirectoryScanOptions options;
+    CExclusionMatcher exclusions;
+    CDirectoryScanner scanner;
+
+    napi_async_work work = nullptr;
+    napi_deferred deferred = nullptr;
+    napi_threadsafe_function onBatch = nullptr;
+    napi_ref error = nullptr; // Thrown by onBatch
+    bool stopped = false;     // By onBatch; later batches are dropped
+
+    DirectoryScanTotals totals;
+    bool rootReadable = false;
+};
+
+bool GetOptions(napi_env env, napi_value object, ScanRequest &request)
+{
+    napi_valuetype type = napi_undefined;
+    if (napi_typeof(env, object, &type) != napi_ok)
+    {
+        return false;
+    }
+    if (type == napi_undefined || type == napi_null)
+    {
+        return true;
+    }
+    if (type != napi_object)
+    {
+        return false;
+    }
+
+    DirectoryScanOptions &options = request.options;
+    napi_value value = nullptr;
+    uint32_t number = 0;
+    if (GetOptionalProperty(env, object, "threads", value) && napi_get_value_uint32(env, value, &number) == napi_ok)
+    {
+        options.threads = number;
+    }
+    if (GetOptionalProperty(env, object, "batchSize", value) && napi_get_value_uint32(env, value, &number) == napi_ok &&
+        number > 0)
+    {
+        options.batchSize = number;
+    }
+    if (GetOptionalProperty(env, object, "skipHidden", value))
+    {
+        napi_get_value_bool(env, value, &options.skipDotNames);
+    }
+    if ((GetOptionalProperty(env, object, "skipDirectoryNames", value) &&
+         !GetUtf8StringArray(env, value, options.skipDirectoryNames)) ||
+        (GetOptionalProperty(env, object, "skipFileNames", value) &&
+         !GetUtf8StringArray(env, value, options.skipFileNames)))
+    {
+        return false;
+    }
+
+    std::vector<std::string> patterns;
+    if (GetOptionalProperty(env, object, "excludePatterns", value) && !GetUtf8StringArray(env, value, patterns))
+    {
+        return false;
+    }
+    if (!patterns.empty())
+    {
+        // Relative to the scanned folder, as FolderSync.setExcludePaths takes them.
+        std::vector<ExclusionRule> rules(patterns.size());
+        for (size_t i = 0; i < patterns.size(); i++)
+        {
+            AppendUtf8AsWide(patterns[i], rules[i].pattern);
+        }
+        request.exclusions.Compile(rules);
+        options.exclusions = &request.exclusions;
+    }
+    return true;
+}
+
+napi_value CreateFloat64Array(napi_env env, const double *values, size_t count)
+{
+    void *data = nullptr;
+    napi_value buffer = nullptr;
+    napi_value array = nullptr;
+    NAPI_CALL(env, napi_create_arraybuffer(env, count * sizeof(double), &data, &buffer));
+    if (count > 0)
+    {
+        std::copy(values, values + count, static_cast<double *>(data));
+    }
+    NAPI_CALL(env, napi_create_typedarray(env, napi_float64_array, count, buffer, 0, &array));
+    return array;
+}
+
+napi_value CreateStringArray(napi_env env, const std::vector<std::string> &values)
+{
+    napi_value array = nullptr;
+    NAPI_CALL(env, napi_create_array_with_length(env, values.size(), &array));
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        napi_value value = nullptr;
+        NAPI_CALL(env, napi_create_string_utf8(env, values[i].data(), values[i].size(), &value));
+        NAPI_CALL(env, napi_set_element(env, array, static_cast<uint32_t>(i), value));
+    }
+    return array;
+}
+
+napi_value CreateBatch(napi_env env, const DirectoryScanBatch &batch)
+{
+    std::vector<double> sizes(batch.sizes.begin(), batch.sizes.end());
+    napi_value object = nullptr;
+    napi_value files = CreateStringArray(env, batch.files);
+    napi_value sizeArray = files ? CreateFloat64Array(env, sizes.data(), sizes.size()) : nullptr;
+    napi_value mtimes = sizeArray ? CreateFloat64Array(env, batch.mtimeMs.data(), batch.mtimeMs.size()) : nullptr;
+    napi_value directories = mtimes ? CreateStringArray(env, batch.directories) : nullptr;
+    if (!directories)
+    {
+        return nullptr;
+    }
+    NAPI_CALL(env, napi_create_object(env, &object));
+    NAPI_CALL(env, napi_set_named_property(env, object, "files", files));
+    NAPI_CALL(env, napi_set_named_property(env, object, "sizes", sizeArray));
+    NAPI_CALL(env, napi_set_named_property(env, object, "mtimeMs", mtimes));
+    NAPI_CALL(env, napi_set_named_property(env, object, "directories", directories));
+    return object;
+}
+
+// JS thread: hands one batch to onBatch.
+void CallOnBatch(napi_env env, napi_value callback, void *context, void *data)
+{
+    auto *request = static_cast<ScanRequest *>(context);
+    std::unique_ptr<DirectoryScanBatch> batch(static_cast<DirectoryScanBatch *>(data));
+    if (!env || request->stopped)
+    {
+        return;
+    }
+
+    napi_value undefined = nullptr;
+    napi_value argument = CreateBatch(env, *batch);
+    napi_value result = nullptr;
+    napi_get_undefined(env, &undefined);
+    bool stop = !argument || napi_call_function(env, undefined, callback, 1, &argument, &result) != napi_ok;
+    bool pending = false;
+    napi_is_exception_pending(env, &pending);
+    if (pending)
+    {
+        napi_value exception = nullptr;
+        napi_get_and_clear_last_exception(env, &exception);
+        napi_create_reference(env, exception, 1, &request->error);
+    }
+
+    bool keepGoing = true;
+    napi_valuetype type = napi_undefined;
+    if (result && napi_typeof(env, result, &type) == napi_ok && type == napi_boolean)
+    {
+        napi_get_value_bool(env, result, &keepGoing);
+    }
+    if (stop || !keepGoing)
+    {
+        request->stopped = true;
+        request->scanner.Cancel();
+    }
+}
+
+// Worker thread.
+void ExecuteScan(napi_env, void *data)
+{
+    auto *request = static_cast<ScanRequest *>(data);
+    request->rootReadable = request->scanner.Scan(
+        request->root, request->options,
+        [request](DirectoryScanBatch &&batch) {
+            auto *queued = new (std::nothrow) DirectoryScanBatch(std::move(batch));
+            if (!queued ||
+                napi_call_threadsafe_function(request->onBatch, queued, napi_tsfn_blocking) != napi_ok)
+            {
+                delete queued;
+                request->scanner.Cancel();
+            }
+        },
+        request->totals);
+}
+
+// JS thread, once the scan has returned; the promise waits for the batches
+// still queued, see FinishScan.
+void CompleteScan(napi_env, napi_status, void *data)
+{
+    auto *request = static_cast<ScanRequest *>(data);
+    napi_release_threadsafe_function(request->onBatch, napi_tsfn_release);
+}
+
+napi_value CreateTotals(napi_env env, const DirectoryScanTotals &totals)
+{
+    napi_value object = nullptr;
+    NAPI_CALL(env, napi_create_object(env, &object));
+    const struct
+    {
+        const char *name;
+        double value;
+    } fields[] = {
+        {"files", static_cast<double>(totals.files)},
+        {"directories", static_cast<double>(totals.directories)},
+        {"bytes", static_cast<double>(totals.bytes)},
+        {"skipped", static_cast<double>(totals.skipped)},
+        {"unreadable", static_cast<double>(totals.unreadable)},
+        {"threads", static_cast<double>(totals.threads)},
+    };
+    for (const auto &field : fields)
+    {
+        napi_value value = nullptr;
+        NAPI_CALL(env, napi_create_double(env, field.value, &value));
+        NAPI_CALL(env, napi_set_named_property(env, object, field.name, value));
+    }
+    return object;
+}
+
+// JS thread, after the last batch: settles the promise and frees the request.
+void FinishScan(napi_env env, void *data, void *)
+{
+    std::unique_ptr<ScanRequest> request(static_cast<ScanRequest *>(data));
+    napi_delete_async_work(env, request->work);
+
+    napi_value outcome = nullptr;
+    if (request->error)
+    {
+        napi_get_reference_value(env, request->error, &outcome);
+        napi_delete_reference(env, request->error);
+        napi_reject_deferred(env, request->deferred, outcome);
+        return;
+    }
+    if (!request->rootReadable)
+    {
+        napi_value message = nullptr;
+        const std::string text = "Cannot read directory: " + request->root;
+        napi_create_string_utf8(env, text.data(), text.size(), &message);
+        napi_create_error(env, nullptr, message, &outcome);
+        napi_reject_deferred(env, request->deferred, outcome);
+        return;
+    }
+
+    outcome = CreateTotals(env, request->totals);
+    if (!outcome)
+    {
+        napi_get_and_clear_last_exception(env, &outcome);
+        napi_reject_deferred(env, request->deferred, outcome);
+        return;
+    }
+    napi_resolve_deferred(env, request->deferred, outcome);
+}
+
+napi_value ScanDirectoryBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 3;
+    napi_value args[3] = {};
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    std::unique_ptr<ScanRequest> request(new (std::nothrow) ScanRequest());
+    if (!request)
+    {
+        napi_throw_error(env, nullptr, "Out of memory");
+        return nullptr;
+    }
+
+    napi_valuetype callbackType = napi_undefined;
+    if (argc < 3 || !GetUtf8String(env, args[0], request->root) || request->root.empty() ||
+        !GetOptions(env, args[1], *request) || napi_typeof(env, args[2], &callbackType) != napi_ok ||
+        callbackType != napi_function)
+    {
+        napi_throw_type_error(env, nullptr, "scanDirectory(root: string, options: object, onBatch: function)");
+        return nullptr;
+    }
+
+    napi_value promise = nullptr;
+    napi_value name = nullptr;
+    NAPI_CALL(env, napi_create_promise(env, &request->deferred, &promise));
+    NAPI_CALL(env, napi_create_string_utf8(env, "scanDirectory", NAPI_AUTO_LENGTH, &name));
+    NAPI_CALL(env, napi_create_threadsafe_function(env, args[2], nullptr, name, kMaxQueuedBatches, 1, request.get(),
+                                                   FinishScan, request.get(), CallOnBatch, &request->onBatch));
+    if (napi_create_async_work(env, nullptr, name, ExecuteScan, CompleteScan, request.get(), &request->work) !=
+            napi_ok ||
+        napi_queue_async_work(env, request->work) != napi_ok)
+    {
+        // FinishScan runs once the function is released and cleans up.
+        ScanRequest *owned = request.release();
+        owned->rootReadable = false;
+        napi_release_threadsafe_function(owned->onBatch, napi_tsfn_abort);
+        ThrowLastError(env);
+        return nullptr;
+    }
+
+    request.release();
+    return promise;
+}
+} // namespace
+
+napi_value RegisterDirectoryScan(napi_env env, napi_value exports)
+{
+    if (!SetFunction(env, exports, "scanDirectory", ScanDirectoryBinding))
+    {
+        return nullptr;
+    }
+    return exports;
+}
@@ -0,0 +1,143 @@
+// writeExclusionIndex(filePath, roots, patterns) -> generation
+// new ExclusionMatcher(roots, patterns).isExcluded(path) -> boolean
+//
+// Compiles each synced folder's exclude patterns into the matcher the overlay
+// handler loads from synced-exclusions.idx, and hands the same engine to the
+// sync scanner and folder watcher so both sides agree on what is excluded.
+
+#include "ExclusionMatcher.h"
+#include "NapiUtil.h"
+#include "OverlayIndexWriter.h"
+#include "SyncedPathMatch.h"
+#include "Utf8.h"
+#include <new>
+
+namespace
+{
+bool GetRules(napi_env env, napi_value roots, napi_value patterns, std::vector<std::string> &utf8Roots,
+              std::vector<std::string> &utf8Patterns)
+{
+    return GetUtf8StringArray(env, roots, utf8Roots) && GetUtf8StringArray(env, patterns, utf8Patterns) &&
+           utf8Roots.size() == utf8Patterns.size();
+}
+
+napi_value WriteExclusionIndexBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 3;
+    napi_value args[3] = {};
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    std::string filePath;
+    std::vector<std::string> roots;
+    std::vector<std::string> patterns;
+    if (argc < 3 || !GetUtf8String(env, args[0], filePath) || !GetRules(env, args[1], args[2], roots, patterns))
+    {
+        napi_throw_type_error(env, nullptr, "writeExclusionIndex(filePath: string, roots: string[], patterns: string[])");
+        return nullptr;
+    }
+
+    uint64_t generation = 0;
+    if (!WriteExclusionIndex(std::filesystem::u8path(filePath), roots, patterns, generation))
+    {
+        napi_throw_error(env, nullptr, "Failed to write exclusion index");
+        return nullptr;
+    }
+
+    napi_value result = nullptr;
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(generation), &result));
+    return result;
+}
+
+void DeleteMatcher(napi_env, void *data, void *)
+{
+    delete static_cast<CExclusionMatcher *>(data);
+}
+
+// new ExclusionMatcher(roots, patterns); an empty root matches paths given
+// relative to the synced folder.
+napi_value MatcherConstructor(napi_env env, napi_callback_info info)
+{
+    size_t argc = 2;
+    napi_value args[2] = {};
+    napi_value self = nullptr;
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, &self, nullptr));
+
+    std::vector<std::string> roots;
+    std::vector<std::string> patterns;
+    if (argc < 2 || !GetRules(env, args[0], args[1], roots, patterns))
+    {
+        napi_throw_type_error(env, nullptr, "new ExclusionMatcher(roots: string[], patterns: string[])");
+        return nullptr;
+    }
+
+    std::vector<ExclusionRule> rules(roots.size());
+    for (size_t i = 0; i < rules.size(); i++)
+    {
+        AppendUtf8AsWide(roots[i], rules[i].root);
+        AppendUtf8AsWide(patterns[i], rules[i].pattern);
+    }
+
+    CExclusionMatcher *matcher = new (std::nothrow) CExclusionMatcher();
+    if (!matcher)
+    {
+        napi_throw_error(env, nullptr, "Out of memory");
+        return nullptr;
+    }
+    matcher->Compile(rules);
+    if (napi_wrap(env, self, matcher, DeleteMatcher, nullptr, nullptr) != napi_ok)
+    {
+        delete matcher;
+        ThrowLastError(env);
+        return nullptr;
+    }
+    return self;
+}
+
+napi_value IsExcludedBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value args[1] = {};
+    napi_value self = nullptr;
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, &self, nullptr));
+
+    void *data = nullptr;
+    std::string utf8;
+    if (napi_unwrap(env, self, &data) != napi_ok || argc < 1 || !GetUtf8String(env, args[0], utf8))
+    {
+        napi_throw_type_error(env, nullptr, "ExclusionMatcher.isExcluded(path: string)");
+        return nullptr;
+    }
+
+    bool excluded = false;
+    const auto *matcher = static_cast<const CExclusionMatcher *>(data);
+    if (!matcher->Empty())
+    {
+        std::wstring wide;
+        AppendUtf8AsWide(utf8, wide);
+        std::u16string normalized;
+        AppendWideAsUtf16(NormalizePath(std::move(wide)), normalized);
+        excluded = matcher->IsExcluded(normalized);
+    }
+
+    napi_value result = nullptr;
+    NAPI_CALL(env, napi_get_boolean(env, excluded, &result));
+    return result;
+}
+} // namespace
+
+napi_value RegisterExclusions(napi_env env, napi_value exports)
+{
+    if (!SetFunction(env, exports, "writeExclusionIndex", WriteExclusionIndexBinding))
+    {
+        return nullptr;
+    }
+
+    const napi_property_descriptor methods[] = {
+        {"isExcluded", nullptr, IsExcludedBinding, nullptr, nullptr, nullptr, napi_default, nullptr},
+    };
+    napi_value matcherClass = nullptr;
+    NAPI_CALL(env, napi_define_class(env, "ExclusionMatcher", NAPI_AUTO_LENGTH, MatcherConstructor, nullptr,
+                                     sizeof(methods) / sizeof(methods[0]), methods, &matcherClass));
+    NAPI_CALL(env, napi_set_named_property(env, exports, "ExclusionMatcher", matcherClass));
+    return exports;
+}
@@ -0,0 +1,180 @@
+// hashFiles(paths[, options]) -> Promise<{digests, sizes, totals}>
+//
+// MD5s of a batch of files off the JS thread for FolderSync's drift check and
+// upload verification. digests[i] is the lowercase hex digest Drive reports
+// as md5Checksum, or null when paths[i] could not be read; totals carries the
+// throughput counters the sync log reports.
+
+#include "FileHasher.h"
+#include "NapiUtil.h"
+#include <memory>
+#include <new>
+
+namespace
+{
+struct HashRequest
+{
+    std::vector<std::string> paths;
+    FileHashOptions options;
+    CFileHasher hasher;
+    std::vector<FileHashResult> results;
+    FileHashTotals totals;
+
+    napi_async_work work = nullptr;
+    napi_deferred deferred = nullptr;
+};
+
+bool GetOptions(napi_env env, napi_value object, FileHashOptions &options)
+{
+    napi_valuetype type = napi_undefined;
+    if (napi_typeof(env, object, &type) != napi_ok)
+    {
+        return false;
+    }
+    if (type == napi_undefined || type == napi_null)
+    {
+        return true;
+    }
+    if (type != napi_object)
+    {
+        return false;
+    }
+
+    napi_value value = nullptr;
+    uint32_t number = 0;
+    if (napi_get_named_property(env, object, "threads", &value) == napi_ok &&
+        napi_get_value_uint32(env, value, &number) == napi_ok)
+    {
+        options.threads = number;
+    }
+    if (napi_get_named_property(env, object, "smallFileLimit", &value) == napi_ok &&
+        napi_get_value_uint32(env, value, &number) == napi_ok)
+    {
+        options.smallFileLimit = number;
+    }
+    return true;
+}
+
+void ExecuteHash(napi_env, void *data)
+{
+    auto *request = static_cast<HashRequest *>(data);
+    request->hasher.Hash(request->paths, request->options, request->results, request->totals);
+}
+
+napi_value CreateResult(napi_env env, const HashRequest &request)
+{
+    napi_value digests = nullptr;
+    napi_value sizes = nullptr;
+    NAPI_CALL(env, napi_create_array_with_length(env, request.results.size(), &digests));
+    NAPI_CALL(env, napi_create_array_with_length(env, request.results.size(), &sizes));
+    for (size_t i = 0; i < request.results.size(); i++)
+    {
+        const FileHashResult &result = request.results[i];
+        napi_value digest = nullptr;
+        napi_value size = nullptr;
+        if (result.ok)
+        {
+            const std::string hex = result.digest.Hex();
+            NAPI_CALL(env, napi_create_string_utf8(env, hex.data(), hex.size(), &digest));
+            NAPI_CALL(env, napi_create_double(env, static_cast<double>(result.size), &size));
+        }
+        else
+        {
+            NAPI_CALL(env, napi_get_null(env, &digest));
+            NAPI_CALL(env, napi_get_null(env, &size));
+        }
+        NAPI_CALL(env, napi_set_element(env, digests, static_cast<uint32_t>(i), digest));
+        NAPI_CALL(env, napi_set_element(env, sizes, static_cast<uint32_t>(i), size));
+    }
+
+    const FileHashTotals &totals = request.totals;
+    const double seconds = totals.elapsedMs / 1000.0;
+    const struct
+    {
+        const char *name;
+        double value;
+    } fields[] = {
+        {"files", static_cast<double>(totals.files)},
+        {"failed", static_cast<double>(totals.failed)},
+        {"bytes", static_cast<double>(totals.bytes)},
+        {"multiBufferFiles", static_cast<double>(totals.multiBufferFiles)},
+        {"threads", static_cast<double>(totals.threads)},
+        {"elapsedMs", totals.elapsedMs},
+        {"bytesPerSec", seconds > 0 ? static_cast<double>(totals.bytes) / seconds : 0},
+    };
+    napi_value totalsObject = nullptr;
+    NAPI_CALL(env, napi_create_object(env, &totalsObject));
+    for (const auto &field : fields)
+    {
+        napi_value value = nullptr;
+        NAPI_CALL(env, napi_create_double(env, field.value, &value));
+        NAPI_CALL(env, napi_set_named_property(env, totalsObject, field.name, value));
+    }
+
+    napi_value result = nullptr;
+    NAPI_CALL(env, napi_create_object(env, &result));
+    NAPI_CALL(env, napi_set_named_property(env, result, "digests", digests));
+    NAPI_CALL(env, napi_set_named_property(env, result, "sizes", sizes));
+    NAPI_CALL(env, napi_set_named_property(env, result, "totals", totalsObject));
+    return result;
+}
+
+void CompleteHash(napi_env env, napi_status, void *data)
+{
+    std::unique_ptr<HashRequest> request(static_cast<HashRequest *>(data));
+    napi_delete_async_work(env, request->work);
+
+    napi_value result = CreateResult(env, *request);
+    if (!result)
+    {
+        napi_get_and_clear_last_exception(env, &result);
+        napi_reject_deferred(env, request->deferred, result);
+        return;
+    }
+    napi_resolve_deferred(env, request->deferred, result);
+}
+
+napi_value HashFilesBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 2;
+    napi_value args[2] = {};
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    std::unique_ptr<HashRequest> request(new (std::nothrow) HashRequest());
+    if (!request)
+    {
+        napi_throw_error(env, nullptr, "Out of memory");
+        return nullptr;
+    }
+    if (argc < 1 || !GetUtf8StringArray(env, args[0], request->paths) ||
+        (argc > 1 && !GetOptions(env, args[1], request->options)))
+    {
+        napi_throw_type_error(env, nullptr, "hashFiles(paths: string[], options?: object)");
+        return nullptr;
+    }
+
+    napi_value promise = nullptr;
+    napi_value name = nullptr;
+    NAPI_CALL(env, napi_create_promise(env, &request->deferred, &promise));
+    NAPI_CALL(env, napi_create_string_utf8(env, "hashFiles", NAPI_AUTO_LENGTH, &name));
+    NAPI_CALL(env,
+              napi_create_async_work(env, nullptr, name, ExecuteHash, CompleteHash, request.get(), &request->work));
+    if (napi_queue_async_work(env, request->work) != napi_ok)
+    {
+        napi_delete_async_work(env, request->work);
+        ThrowLastError(env);
+        return nullptr;
+    }
+    request.release();
+    return promise;
+}
+} // namespace
+
+napi_value RegisterFileHash(napi_env env, napi_value exports)
+{
+    if (!SetFunction(env, exports, "hashFiles", HashFilesBinding))
+    {
+        return nullptr;
+    }
+    return exports;
+}
@@ -0,0 +1,106 @@
+// Small Node-API helpers shared by the bindings
+
+#pragma once
+
+#include <node_api.h>
+#include <string>
+#include <vector>
+
+#define NAPI_CALL(env, call)                                          \
+    do                                                                \
+    {                                                                 \
+        if ((call) != napi_ok)                                        \
+        {                                                             \
+            ThrowLastError(env);                                      \
+            return nullptr;                                           \
+        }                                                             \
+    } while (0)
+
+inline void ThrowLastError(napi_env env)
+{
+    bool pending = false;
+    napi_is_exception_pending(env, &pending);
+    if (pending)
+    {
+        return;
+    }
+
+    const napi_extended_error_info *info = nullptr;
+    napi_get_last_error_info(env, &info);
+    napi_throw_error(env, nullptr, info && info->error_message ? info->error_message : "Node-API call failed");
+}
+
+inline bool GetUtf8String(napi_env env, napi_value value, std::string &out)
+{
+    size_t length = 0;
+    if (napi_get_value_string_utf8(env, value, nullptr, 0, &length) != napi_ok)
+    {
+        return false;
+    }
+
+    out.resize(length + 1);
+    if (napi_get_value_string_utf8(env, value, out.data(), out.size(), &length) != napi_ok)
+    {
+        return false;
+    }
+    out.resize(length);
+    return true;
+}
+
+inline bool GetUtf8StringArray(napi_env env, napi_value value, std::vector<std::string> &out)
+{
+    bool isArray = false;
+    uint32_t count = 0;
+    if (napi_is_array(env, value, &isArray) != napi_ok || !isArray || napi_get_array_length(env, value, &count) != napi_ok)
+    {
+        return false;
+    }
+
+    // Any element that is not a string fails the whole array, so parallel
+    // arrays (paths and their urls) cannot slip out of step.
+    out.reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        napi_value element = nullptr;
+        std::string path;
+        if (napi_get_element(env, value, i, &element) != napi_ok || !GetUtf8String(env, element, path))
+        {
+            return false;
+        }
+        out.push_back(std::move(path));
+    }
+    return true;
+}
+
+// Fetches object[name] unless it is missing, undefined or null.
+inline bool GetOptionalProperty(napi_env env, napi_value object, const char *name, napi_value &value)
+{
+    bool has = false;
+    napi_valuetype type = napi_undefined;
+    return napi_has_named_property(env, object, name, &has) == napi_ok && has &&
+           napi_get_named_property(env, object, name, &value) == napi_ok &&
+           napi_typeof(env, value, &type) == napi_ok && type != napi_undefined && type != napi_null;
+}
+
+inline napi_value SetFunction(napi_env env, napi_value exports, const char *name, napi_callback callback)
+{
+    napi_value fn = nullptr;
+    NAPI_CALL(env, napi_create_function(env, name, NAPI_AUTO_LENGTH, callback, nullptr, &fn));
+    NAPI_CALL(env, napi_set_named_property(env, exports, name, fn));
+    return fn;
+}
+
+class CSyncDatabase;
+
+// The database behind an open SyncDatabase object, or nullptr if value is not
+// one (SyncDatabaseBinding.cpp). Does not throw.
+CSyncDatabase *UnwrapSyncDatabase(napi_env env, napi_value value);
+
+// Per-binding registration hooks, called from Addon.cpp.
+napi_value RegisterOverlayIndex(napi_env env, napi_value exports);
+napi_value RegisterShellStats(napi_env env, napi_value exports);
+napi_value RegisterExclusions(napi_env env, napi_value exports);
+napi_value RegisterDirectoryScan(napi_env env, napi_value exports);
+napi_value RegisterFileHash(napi_env env, napi_value exports);
+napi_value RegisterSyncDatabase(napi_env env, napi_value exports);
+napi_value RegisterChangeWatch(napi_env env, napi_value exports);
@@ -0,0 +1,166 @@
+// writeOverlayIndex(filePath, paths | syncDatabase[, journalPath]) -> generation
+// appendOverlayJournal(indexPath, journalPath, adds, removes) -> journal bytes
+// writeDriveLinkIndex(filePath, paths, urls | filePath, syncDatabase) -> generation
+//
+// Publishes synced-paths.idx and its journal for the overlay handler from
+// SyncTracker.persistSyncedPathIndex, and mirrors both into the shared-memory
+// index the handler prefers over the files. The link index lets the shell
+// extension copy a synced item's Drive link without starting the app.
+
+#include "NapiUtil.h"
+#include "OverlayIndexWriter.h"
+#include "SyncDatabase.h"
+#include <vector>
+
+namespace
+{
+// Keep the journal tail and the published roots between calls; bindings run
+// on the JS thread only.
+COverlayJournalWriter g_journalWriter;
+COverlaySegmentPublisher g_segmentPublisher;
+
+// paths is a string array or a SyncDatabase, whose keys are the synced paths.
+bool GetSyncedPaths(napi_env env, napi_value value, std::vector<std::string> &paths)
+{
+    const CSyncDatabase *db = UnwrapSyncDatabase(env, value);
+    if (!db)
+    {
+        return GetUtf8StringArray(env, value, paths);
+    }
+
+    paths.reserve(db->Size());
+    const CSyncDatabase::Range range = db->PrefixRange("");
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        paths.push_back(it->first);
+    }
+    return true;
+}
+
+napi_value WriteOverlayIndexBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 3;
+    napi_value args[3] = {};
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    std::string filePath;
+    std::string journalPath;
+    std::vector<std::string> paths;
+    if (argc < 2 || !GetUtf8String(env, args[0], filePath) || !GetSyncedPaths(env, args[1], paths) ||
+        (argc >= 3 && !GetUtf8String(env, args[2], journalPath)))
+    {
+        napi_throw_type_error(env, nullptr,
+                              "writeOverlayIndex(filePath: string, paths: string[] | SyncDatabase, journalPath?: string)");
+        return nullptr;
+    }
+
+    uint64_t generation = 0;
+    // A segment that cannot be published leaves the handler on the files.
+    if (!WriteOverlayIndex(std::filesystem::u8path(filePath), paths, generation, &g_segmentPublisher))
+    {
+        napi_throw_error(env, nullptr, "Failed to write overlay index");
+        return nullptr;
+    }
+
+    // The new index already holds everything journaled against the old one.
+    if (!journalPath.empty() && !g_journalWriter.Reset(std::filesystem::u8path(journalPath), generation))
+    {
+        napi_throw_error(env, nullptr, "Failed to reset overlay journal");
+        return nullptr;
+    }
+
+    napi_value result = nullptr;
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(generation), &result));
+    return result;
+}
+
+napi_value AppendOverlayJournalBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 4;
+    napi_value args[4] = {};
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    std::string indexPath;
+    std::string journalPath;
+    std::vector<std::string> adds;
+    std::vector<std::string> removes;
+    if (argc < 4 || !GetUtf8String(env, args[0], indexPath) || !GetUtf8String(env, args[1], journalPath) ||
+        !GetUtf8StringArray(env, args[2], adds) || !GetUtf8StringArray(env, args[3], removes))
+    {
+        napi_throw_type_error(env, nullptr,
+                              "appendOverlayJournal(indexPath: string, journalPath: string, adds: string[], removes: string[])");
+        return nullptr;
+    }
+
+    // Records only mean something on top of a valid index.
+    const uint64_t baseGeneration = ReadOverlayIndexGeneration(std::filesystem::u8path(indexPath));
+    uint64_t journalSize = 0;
+    if (baseGeneration == 0 ||
+        !g_journalWriter.Append(std::filesystem::u8path(journalPath), baseGeneration, removes, adds, journalSize))
+    {
+        napi_throw_error(env, nullptr, "Failed to append to overlay journal");
+        return nullptr;
+    }
+    g_segmentPublisher.PublishJournal(std::filesystem::u8path(indexPath), std::filesystem::u8path(journalPath), baseGeneration,
+                                      removes, adds);
+
+    napi_value result = nullptr;
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(journalSize), &result));
+    return result;
+}
+
+napi_value WriteDriveLinkIndexBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 3;
+    napi_value args[3] = {};
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    std::string filePath;
+    std::vector<std::string> paths;
+    std::vector<std::string> urls;
+    const CSyncDatabase *db = argc >= 2 ? UnwrapSyncDatabase(env, args[1]) : nullptr;
+    if (db)
+    {
+        // Entries without a link stay out of the index.
+        const CSyncDatabase::Range range = db->PrefixRange("");
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (!it->second.link.empty())
+            {
+                paths.push_back(it->first);
+                urls.push_back(it->second.link);
+            }
+        }
+    }
+    if (argc < 2 || !GetUtf8String(env, args[0], filePath) ||
+        (!db && (argc < 3 || !GetUtf8StringArray(env, args[1], paths) || !GetUtf8StringArray(env, args[2], urls) ||
+                 paths.size() != urls.size())))
+    {
+        napi_throw_type_error(env, nullptr,
+                              "writeDriveLinkIndex(filePath: string, paths: string[] | SyncDatabase, urls?: string[])");
+        return nullptr;
+    }
+
+    uint64_t generation = 0;
+    if (!WriteDriveLinkIndex(std::filesystem::u8path(filePath), paths, urls, generation))
+    {
+        napi_throw_error(env, nullptr, "Failed to write Drive link index");
+        return nullptr;
+    }
+
+    napi_value result = nullptr;
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(generation), &result));
+    return result;
+}
+} // namespace
+
+napi_value RegisterOverlayIndex(napi_env env, napi_value exports)
+{
+    if (!SetFunction(env, exports, "writeOverlayIndex", WriteOverlayIndexBinding) ||
+        !SetFunction(env, exports, "appendOverlayJournal", AppendOverlayJournalBinding) ||
+        !SetFunction(env, exports, "writeDriveLinkIndex", WriteDriveLinkIndexBinding))
+    {
+        return nullptr;
+    }
+    return exports;
+}
@@ -0,0 +1,120 @@
+// readShellStats(processId) -> stats | null
+//
+// Reads the hot-path stats block a process hosting the shell extension
+// publishes (ShellStats.h), for diagnostics in the app. Returns null when the
+// process has no block, e.g. it never loaded the extension or has exited.
+
+#include "NapiUtil.h"
+#include "SharedMemorySegment.h"
+#include "ShellStats.h"
+
+namespace
+{
+napi_value MakeNumber(napi_env env, uint64_t value)
+{
+    napi_value number = nullptr;
+    napi_create_double(env, static_cast<double>(value), &number);
+    return number;
+}
+
+bool SetNumber(napi_env env, napi_value object, const char *name, uint64_t value)
+{
+    napi_value number = MakeNumber(env, value);
+    return number && napi_set_named_property(env, object, name, number) == napi_ok;
+}
+
+// { count, totalNs, p50Ns, p90Ns, p99Ns, maxNs, buckets[] }
+napi_value MakeLatency(napi_env env, const ShellLatency &latency)
+{
+    napi_value object = nullptr;
+    napi_value buckets = nullptr;
+    if (napi_create_object(env, &object) != napi_ok || napi_create_array_with_length(env, kShellStatsBucketCount, &buckets) != napi_ok)
+    {
+        return nullptr;
+    }
+
+    for (uint32_t bucket = 0; bucket < kShellStatsBucketCount; bucket++)
+    {
+        if (napi_set_element(env, buckets, bucket, MakeNumber(env, latency.buckets[bucket])) != napi_ok)
+        {
+            return nullptr;
+        }
+    }
+
+    const bool ok = SetNumber(env, object, "count", latency.count) && SetNumber(env, object, "totalNs", latency.totalNs) &&
+                    SetNumber(env, object, "p50Ns", latency.PercentileNs(50)) &&
+                    SetNumber(env, object, "p90Ns", latency.PercentileNs(90)) &&
+                    SetNumber(env, object, "p99Ns", latency.PercentileNs(99)) &&
+                    SetNumber(env, object, "maxNs", latency.PercentileNs(100)) &&
+                    napi_set_named_property(env, object, "buckets", buckets) == napi_ok;
+    return ok ? object : nullptr;
+}
+
+napi_value ReadShellStatsBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value args[1] = {};
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+
+    uint32_t processId = 0;
+    if (argc < 1 || napi_get_value_uint32(env, args[0], &processId) != napi_ok)
+    {
+        napi_throw_type_error(env, nullptr, "readShellStats(processId: number)");
+        return nullptr;
+    }
+
+    CSharedMemorySegment segment;
+    ShellStatsSnapshot snapshot;
+    napi_value result = nullptr;
+    if (!segment.OpenReadOnly(ShellStatsSegmentName(processId)) || !ReadShellStats(segment.Data(), segment.Size(), snapshot))
+    {
+        NAPI_CALL(env, napi_get_null(env, &result));
+        return result;
+    }
+
+    napi_value counters = nullptr;
+    napi_value gauges = nullptr;
+    napi_value timers = nullptr;
+    NAPI_CALL(env, napi_create_object(env, &result));
+    NAPI_CALL(env, napi_create_object(env, &counters));
+    NAPI_CALL(env, napi_create_object(env, &gauges));
+    NAPI_CALL(env, napi_create_object(env, &timers));
+
+    for (size_t counter = 0; counter < kShellCounterCount; counter++)
+    {
+        const ShellCounter id = static_cast<ShellCounter>(counter);
+        NAPI_CALL(env, napi_set_named_property(env, counters, ShellCounterName(id), MakeNumber(env, snapshot.Counter(id))));
+    }
+    for (size_t gauge = 0; gauge < kShellGaugeCount; gauge++)
+    {
+        const ShellGauge id = static_cast<ShellGauge>(gauge);
+        NAPI_CALL(env, napi_set_named_property(env, gauges, ShellGaugeName(id), MakeNumber(env, snapshot.Gauge(id))));
+    }
+    for (size_t timer = 0; timer < kShellTimerCount; timer++)
+    {
+        const ShellTimer id = static_cast<ShellTimer>(timer);
+        napi_value latency = MakeLatency(env, snapshot.Timer(id));
+        if (!latency)
+        {
+            ThrowLastError(env);
+            return nullptr;
+        }
+        NAPI_CALL(env, napi_set_named_property(env, timers, ShellTimerName(id), latency));
+    }
+
+    NAPI_CALL(env, napi_set_named_property(env, result, "processId", MakeNumber(env, snapshot.processId)));
+    NAPI_CALL(env, napi_set_named_property(env, result, "counters", counters));
+    NAPI_CALL(env, napi_set_named_property(env, result, "gauges", gauges));
+    NAPI_CALL(env, napi_set_named_property(env, result, "timers", timers));
+    return result;
+}
+} // namespace
+
+napi_value RegisterShellStats(napi_env env, napi_value exports)
+{
+    if (!SetFunction(env, exports, "readShellStats", ReadShellStatsBinding))
+    {
+        return nullptr;
+    }
+    return exports;
+}
@@ -0,0 +1,430 @@
+// new SyncDatabase(filePath)
+// .get(key) -> JSON string | null
+// .put(keys, links, values)          one batch; links[i] is keys[i]'s Drive link
+// .remove(keys, prefixes) -> removed one batch; a prefix drops every key starting with it
+// .keys(prefix?) -> string[]         in key order
+// .entries(prefix?) -> {keys, values}
+// .writePathList(filePath)           every key, one per line (synced-paths.txt)
+// .compact() -> boolean
+// .stats() -> {entries, logBytes, snapshotBytes, compactions, droppedTailBytes}
+// .close()
+//
+// SyncTracker's store of synced items, keyed by normalized path. Each put or
+// remove is appended to the log as one batch instead of rewriting every item.
+// writeOverlayIndex and writeDriveLinkIndex take an open SyncDatabase in place
+// of their path lists, so the overlay's indexes are derived from it without
+// copying every key through JS.
+
+#include "NapiUtil.h"
+#include "SyncDatabase.h"
+#include <fstream>
+#include <new>
+#include <system_error>
+
+namespace
+{
+const napi_type_tag kSyncDatabaseTag = {0x52534442c0d1a4e7ULL, 0x9b1f2e7c3d4a5b6cULL};
+
+void DeleteDatabase(napi_env, void *data, void *)
+{
+    delete static_cast<CSyncDatabase *>(data);
+}
+
+// The open database behind this; throws and returns nullptr otherwise.
+CSyncDatabase *GetThis(napi_env env, napi_callback_info info, size_t &argc, napi_value *args, const char *usage)
+{
+    napi_value self = nullptr;
+    void *data = nullptr;
+    if (napi_get_cb_info(env, info, &argc, args, &self, nullptr) != napi_ok ||
+        napi_unwrap(env, self, &data) != napi_ok)
+    {
+        napi_throw_type_error(env, nullptr, usage);
+        return nullptr;
+    }
+    auto *db = static_cast<CSyncDatabase *>(data);
+    if (!db->IsOpen())
+    {
+        napi_throw_error(env, nullptr, "SyncDatabase is closed");
+        return nullptr;
+    }
+    return db;
+}
+
+// Optional prefix argument; a missing one selects every key.
+bool GetPrefix(napi_env env, size_t argc, napi_value *args, std::string &prefix)
+{
+    napi_valuetype type = napi_undefined;
+    if (argc < 1 || (napi_typeof(env, args[0], &type) == napi_ok && type == napi_undefined))
+    {
+        return true;
+    }
+    return GetUtf8String(env, args[0], prefix);
+}
+
+napi_value CreateString(napi_env env, const std::string &utf8)
+{
+    napi_value value = nullptr;
+    NAPI_CALL(env, napi_create_string_utf8(env, utf8.data(), utf8.size(), &value));
+    return value;
+}
+
+napi_value DatabaseConstructor(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value args[1] = {};
+    napi_value self = nullptr;
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, &self, nullptr));
+
+    std::string filePath;
+    if (argc < 1 || !GetUtf8String(env, args[0], filePath))
+    {
+        napi_throw_type_error(env, nullptr, "new SyncDatabase(filePath: string)");
+        return nullptr;
+    }
+
+    CSyncDatabase *db = new (std::nothrow) CSyncDatabase();
+    if (!db)
+    {
+        napi_throw_error(env, nullptr, "Out of memory");
+        return nullptr;
+    }
+    if (!db->Open(std::filesystem::u8path(filePath)))
+    {
+        delete db;
+        napi_throw_error(env, nullptr, "Failed to open sync database");
+        return nullptr;
+    }
+    if (napi_wrap(env, self, db, DeleteDatabase, nullptr, nullptr) != napi_ok)
+    {
+        delete db;
+        ThrowLastError(env);
+        return nullptr;
+    }
+    NAPI_CALL(env, napi_type_tag_object(env, self, &kSyncDatabaseTag));
+    return self;
+}
+
+napi_value GetBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value args[1] = {};
+    const char *usage = "SyncDatabase.get(key: string)";
+    CSyncDatabase *db = GetThis(env, info, argc, args, usage);
+    if (!db)
+    {
+        return nullptr;
+    }
+
+    std::string key;
+    if (argc < 1 || !GetUtf8String(env, args[0], key))
+    {
+        napi_throw_type_error(env, nullptr, usage);
+        return nullptr;
+    }
+
+    const SyncDbEntry *entry = db->Find(key);
+    if (!entry)
+    {
+        napi_value result = nullptr;
+        NAPI_CALL(env, napi_get_null(env, &result));
+        return result;
+    }
+    return CreateString(env, entry->data);
+}
+
+napi_value PutBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 3;
+    napi_value args[3] = {};
+    const char *usage = "SyncDatabase.put(keys: string[], links: string[], values: string[])";
+    CSyncDatabase *db = GetThis(env, info, argc, args, usage);
+    if (!db)
+    {
+        return nullptr;
+    }
+
+    std::vector<std::string> keys;
+    std::vector<std::string> links;
+    std::vector<std::string> values;
+    if (argc < 3 || !GetUtf8StringArray(env, args[0], keys) || !GetUtf8StringArray(env, args[1], links) ||
+        !GetUtf8StringArray(env, args[2], values) || keys.size() != links.size() || keys.size() != values.size())
+    {
+        napi_throw_type_error(env, nullptr, usage);
+        return nullptr;
+    }
+
+    std::vector<SyncDbWrite> writes(keys.size());
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        writes[i].key = std::move(keys[i]);
+        writes[i].entry.link = std::move(links[i]);
+        writes[i].entry.data = std::move(values[i]);
+    }
+    if (!db->Apply(writes))
+    {
+        napi_throw_error(env, nullptr, "Failed to write sync database");
+        return nullptr;
+    }
+    return nullptr;
+}
+
+napi_value RemoveBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 2;
+    napi_value args[2] = {};
+    const char *usage = "SyncDatabase.remove(keys: string[], prefixes: string[])";
+    CSyncDatabase *db = GetThis(env, info, argc, args, usage);
+    if (!db)
+    {
+        return nullptr;
+    }
+
+    std::vector<std::string> keys;
+    std::vector<std::string> prefixes;
+    if (argc < 2 || !GetUtf8StringArray(env, args[0], keys) || !GetUtf8StringArray(env, args[1], prefixes))
+    {
+        napi_throw_type_error(env, nullptr, usage);
+        return nullptr;
+    }
+
+    std::vector<SyncDbWrite> writes;
+    writes.reserve(keys.size() + prefixes.size());
+    for (std::string &key : keys)
+    {
+        writes.push_back({SyncDbOp::Delete, std::move(key), {}});
+    }
+    for (std::string &prefix : prefixes)
+    {
+        writes.push_back({SyncDbOp::DeletePrefix, std::move(prefix), {}});
+    }
+    size_t removed = 0;
+    if (!db->Apply(writes, &removed))
+    {
+        napi_throw_error(env, nullptr, "Failed to write sync database");
+        return nullptr;
+    }
+
+    napi_value result = nullptr;
+    NAPI_CALL(env, napi_create_double(env, static_cast<double>(removed), &result));
+    return result;
+}
+
+napi_value KeysBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value args[1] = {};
+    const char *usage = "SyncDatabase.keys(prefix?: string)";
+    CSyncDatabase *db = GetThis(env, info, argc, args, usage);
+    if (!db)
+    {
+        return nullptr;
+    }
+
+    std::string prefix;
+    if (!GetPrefix(env, argc, args, prefix))
+    {
+        napi_throw_type_error(env, nullptr, usage);
+        return nullptr;
+    }
+
+    napi_value keys = nullptr;
+    NAPI_CALL(env, napi_create_array(env, &keys));
+    const CSyncDatabase::Range range = db->PrefixRange(prefix);
+    uint32_t index = 0;
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        napi_value key = CreateString(env, it->first);
+        if (!key)
+        {
+            return nullptr;
+        }
+        NAPI_CALL(env, napi_set_element(env, keys, index++, key));
+    }
+    return keys;
+}
+
+napi_value EntriesBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value args[1] = {};
+    const char *usage = "SyncDatabase.entries(prefix?: string)";
+    CSyncDatabase *db = GetThis(env, info, argc, args, usage);
+    if (!db)
+    {
+        return nullptr;
+    }
+
+    std::string prefix;
+    if (!GetPrefix(env, argc, args, prefix))
+    {
+        napi_throw_type_error(env, nullptr, usage);
+        return nullptr;
+    }
+
+    napi_value keys = nullptr;
+    napi_value values = nullptr;
+    NAPI_CALL(env, napi_create_array(env, &keys));
+    NAPI_CALL(env, napi_create_array(env, &values));
+    const CSyncDatabase::Range range = db->PrefixRange(prefix);
+    uint32_t index = 0;
+    for (auto it = range.first; it != range.second; ++it, index++)
+    {
+        napi_value key = CreateString(env, it->first);
+        napi_value value = key ? CreateString(env, it->second.data) : nullptr;
+        if (!value)
+        {
+            return nullptr;
+        }
+        NAPI_CALL(env, napi_set_element(env, keys, index, key));
+        NAPI_CALL(env, napi_set_element(env, values, index, value));
+    }
+
+    napi_value result = nullptr;
+    NAPI_CALL(env, napi_create_object(env, &result));
+    NAPI_CALL(env, napi_set_named_property(env, result, "keys", keys));
+    NAPI_CALL(env, napi_set_named_property(env, result, "values", values));
+    return result;
+}
+
+napi_value WritePathListBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value args[1] = {};
+    const char *usage = "SyncDatabase.writePathList(filePath: string)";
+    CSyncDatabase *db = GetThis(env, info, argc, args, usage);
+    if (!db)
+    {
+        return nullptr;
+    }
+
+    std::string filePath;
+    if (argc < 1 || !GetUtf8String(env, args[0], filePath))
+    {
+        napi_throw_type_error(env, nullptr, usage);
+        return nullptr;
+    }
+
+    std::string text;
+    const CSyncDatabase::Range range = db->PrefixRange("");
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it != range.first)
+        {
+            text += '\n';
+        }
+        text += it->first;
+    }
+
+    // Temp file + rename, so the overlay handler never reads half a list.
+    const std::filesystem::path file = std::filesystem::u8path(filePath);
+    std::filesystem::path temp = file;
+    temp += ".tmp";
+    bool written = false;
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        written = static_cast<bool>(out.write(text.data(), static_cast<std::streamsize>(text.size())));
+    }
+    std::error_code ec;
+    if (written)
+    {
+        std::filesystem::rename(temp, file, ec);
+    }
+    if (!written || ec)
+    {
+        std::filesystem::remove(temp, ec);
+        napi_throw_error(env, nullptr, "Failed to write path list");
+    }
+    return nullptr;
+}
+
+napi_value CompactBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 0;
+    CSyncDatabase *db = GetThis(env, info, argc, nullptr, "SyncDatabase.compact()");
+    if (!db)
+    {
+        return nullptr;
+    }
+
+    napi_value result = nullptr;
+    NAPI_CALL(env, napi_get_boolean(env, db->Compact(), &result));
+    return result;
+}
+
+napi_value StatsBinding(napi_env env, napi_callback_info info)
+{
+    size_t argc = 0;
+    CSyncDatabase *db = GetThis(env, info, argc, nullptr, "SyncDatabase.stats()");
+    if (!db)
+    {
+        return nullptr;
+    }
+
+    const SyncDbStats stats = db->Stats();
+    const struct
+    {
+        const char *name;
+        uint64_t value;
+    } fields[] = {
+        {"entries", stats.entries},
+        {"logBytes", stats.logBytes},
+        {"snapshotBytes", stats.snapshotBytes},
+        {"compactions", stats.compactions},
+        {"droppedTailBytes", stats.droppedTailBytes},
+    };
+    napi_value result = nullptr;
+    NAPI_CALL(env, napi_create_object(env, &result));
+    for (const auto &field : fields)
+    {
+        napi_value value = nullptr;
+        NAPI_CALL(env, napi_create_double(env, static_cast<double>(field.value), &value));
+        NAPI_CALL(env, napi_set_named_property(env, result, field.name, value));
+    }
+    return result;
+}
+
+napi_value CloseBinding(napi_env env, napi_callback_info info)
+{
+    napi_value self = nullptr;
+    void *data = nullptr;
+    NAPI_CALL(env, napi_get_cb_info(env, info, nullptr, nullptr, &self, nullptr));
+    if (napi_unwrap(env, self, &data) == napi_ok)
+    {
+        static_cast<CSyncDatabase *>(data)->Close();
+    }
+    return nullptr;
+}
+} // namespace
+
+CSyncDatabase *UnwrapSyncDatabase(napi_env env, napi_value value)
+{
+    bool tagged = false;
+    void *data = nullptr;
+    if (napi_check_object_type_tag(env, value, &kSyncDatabaseTag, &tagged) != napi_ok || !tagged ||
+        napi_unwrap(env, value, &data) != napi_ok)
+    {
+        return nullptr;
+    }
+    auto *db = static_cast<CSyncDatabase *>(data);
+    return db->IsOpen() ? db : nullptr;
+}
+
+napi_value RegisterSyncDatabase(napi_env env, napi_value exports)
+{
+    const napi_property_descriptor methods[] = {
+        {"get", nullptr, GetBinding, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"put", nullptr, PutBinding, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"remove", nullptr, RemoveBinding, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"keys", nullptr, KeysBinding, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"entries", nullptr, EntriesBinding, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"writePathList", nullptr, WritePathListBinding, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"compact", nullptr, CompactBinding, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"stats", nullptr, StatsBinding, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"close", nullptr, CloseBinding, nullptr, nullptr, nullptr, napi_default, nullptr},
+    };
+    napi_value databaseClass = nullptr;
+    NAPI_CALL(env, napi_define_class(env, "SyncDatabase", NAPI_AUTO_LENGTH, DatabaseConstructor, nullptr,
+                                     sizeof(methods) / sizeof(methods[0]), methods, &databaseClass));
+    NAPI_CALL(env, napi_set_named_property(env, exports, "SyncDatabase", databaseClass));
+    return exports;
+}
@@ -0,0 +1,24 @@
+#!/usr/bin/env node
+// Builds the native addon (native/) against the Electron version that is
+// actually installed, so the ABI always matches the app that loads it.
+
+const { spawn } = require('child_process');
+
+const electronVersion = require('electron/package.json').version;
+const cmakeJs = require.resolve('cmake-js/bin/cmake-js');
+
+const args = [
+  cmakeJs,
+  'compile',
+  '--directory', 'native',
+  '--out', 'native/build',
+  '--runtime', 'electron',
+  '--runtime-version', electronVersion,
+  ...process.argv.slice(2)
+];
+
+const child = spawn(process.execPath, args, { stdio: 'inherit' });
+
+child.on('close', (code) => {
+  process.exit(code);
+});
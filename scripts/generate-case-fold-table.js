@@ -0,0 +1,86 @@
+#!/usr/bin/env node
+/**
+ * generate-case-fold-table.js
+ *
+ * Regenerates shell-extension/src/CaseFoldTable.h from String.prototype.toLowerCase,
+ * so the shell extension's NormalizePath lowercases exactly like
+ * SyncTracker.normalizePath does in this Node/ICU version.
+ *
+ * Only one-to-one mappings are kept. toLowerCase's two length- or
+ * context-dependent cases (U+0130 and final sigma) use their simple mappings.
+ *
+ * Usage: node scripts/generate-case-fold-table.js
+ */
+
+'use strict';
+
+const fs = require('fs');
+const path = require('path');
+
+const OUTPUT = path.join(__dirname, '..', 'shell-extension', 'src', 'CaseFoldTable.h');
+
+function simpleLower(cp) {
+  if (cp === 0x0130) {
+    return 0x0069;
+  }
+  const lower = String.fromCodePoint(cp).toLowerCase();
+  const points = Array.from(lower);
+  return points.length === 1 ? points[0].codePointAt(0) : cp;
+}
+
+// Runs of mappings sharing one delta, either contiguous (stride 1) or every
+// other code point (stride 2, the Latin Extended upper/lower pairs).
+const ranges = [];
+for (let cp = 0x80; cp <= 0x10ffff; cp++) {
+  if (cp >= 0xd800 && cp <= 0xdfff) {
+    continue;
+  }
+  const lower = simpleLower(cp);
+  if (lower === cp) {
+    continue;
+  }
+  // NormalizePath folds UTF-16 in place, so a mapping may not change length.
+  if ((cp < 0x10000) !== (lower < 0x10000)) {
+    throw new Error(`U+${cp.toString(16)} lowercases across planes`);
+  }
+  const delta = lower - cp;
+  const last = ranges[ranges.length - 1];
+  if (last && last.delta === delta) {
+    const stride = cp - last.last;
+    if ((last.first === last.last && (stride === 1 || stride === 2)) || stride === last.stride) {
+      last.stride = stride;
+      last.last = cp;
+      continue;
+    }
+  }
+  ranges.push({ first: cp, last: cp, delta, stride: 1 });
+}
+
+const hex = (value) => `0x${value.toString(16).toUpperCase().padStart(4, '0')}`;
+const rows = ranges.map((r) => `    {${hex(r.first)}, ${hex(r.last)}, ${r.delta}, ${r.stride}},`);
+
+const source = `// RRightclickrr lowercase table for NormalizePath
+//
+// Generated by scripts/generate-case-fold-table.js from JavaScript's
+// toLowerCase (Node ${process.versions.node}, ICU ${process.versions.icu}, Unicode ${process.versions.unicode}).
+// Do not edit by hand. ASCII is handled inline and not listed.
+
+#pragma once
+
+#include <cstdint>
+
+struct CaseFoldRange
+{
+    uint32_t first;
+    uint32_t last;
+    int32_t delta;   // Added to a matching code point
+    uint32_t stride; // 1: every code point in range, 2: every other one
+};
+
+constexpr CaseFoldRange kCaseFoldRanges[] = {
+${rows.join('\n')}
+};
+`;
+
+fs.writeFileSync(OUTPUT, source);
+console.log(`[case-fold] ${ranges.length} ranges written to ${path.relative(process.cwd(), OUTPUT)}`);
@@ -0,0 +1,210 @@
+// Steady-state IsMemberOf lookups must not touch the heap
+//
+// Replaces the global operator new for the whole bench executable and counts
+// calls while armed. The loop mirrors CSyncOverlayIcon::IsPathSynced: read the
+// published snapshot, normalize the query on the stack and answer through the
+// parent memo from the trie or the binary index, recording into the shell
+// stats block as the handler does.
+
+#include "BenchUtil.h"
+#include "OverlayIndexFormat.h"
+#include "ParentVerdictMemo.h"
+#include "PathNormalize.h"
+#include "ShellStats.h"
+#include "SnapshotPublisher.h"
+#include "SyncedPathMatch.h"
+#include "SyncedPathTrie.h"
+#include "Utf8.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+std::atomic<bool> g_countAllocations{false};
+std::atomic<uint64_t> g_allocations{0};
+
+void *CountedAllocate(size_t size)
+{
+    if (g_countAllocations.load(std::memory_order_relaxed))
+    {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void *block = std::malloc(size ? size : 1))
+    {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+
+class CAllocationScope
+{
+public:
+    CAllocationScope() : m_start(g_allocations.load())
+    {
+        g_countAllocations = true;
+    }
+
+    ~CAllocationScope()
+    {
+        g_countAllocations = false;
+    }
+
+    uint64_t Count() const { return g_allocations.load() - m_start; }
+
+private:
+    uint64_t m_start;
+};
+} // namespace
+
+void *operator new(size_t size)
+{
+    return CountedAllocate(size);
+}
+
+void *operator new[](size_t size)
+{
+    return CountedAllocate(size);
+}
+
+void operator delete(void *block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete[](void *block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void *block, size_t) noexcept
+{
+    std::free(block);
+}
+
+void operator delete[](void *block, size_t) noexcept
+{
+    std::free(block);
+}
+
+namespace
+{
+struct LookupSnapshot
+{
+    uint64_t generation = 0;
+    CSyncedPathTrie trie;
+    std::vector<uint8_t> image;
+    COverlayIndexView view;
+};
+
+// On Windows the DLL reinterprets wchar_t as UTF-16; here wchar_t is wider,
+// so re-encode into a fixed buffer instead.
+class CUtf16Query
+{
+public:
+    explicit CUtf16Query(std::wstring_view path) : m_length(0)
+    {
+        for (wchar_t ch : path)
+        {
+            if (m_length < sizeof(m_units) / sizeof(m_units[0]))
+            {
+                m_units[m_length++] = static_cast<char16_t>(ch);
+            }
+        }
+    }
+
+    std::u16string_view View() const { return std::u16string_view(m_units, m_length); }
+
+private:
+    char16_t m_units[1024];
+    size_t m_length;
+};
+
+bool LookupViaTrie(const CSnapshotPublisher<LookupSnapshot> &publisher, CParentVerdictMemo &memo, std::wstring_view raw)
+{
+    const auto snapshot = publisher.Read();
+    const CNormalizedPath target(raw);
+    return snapshot && memo.Resolve(
+        snapshot->generation, target.View(),
+        [&](std::wstring_view parentWithSeparator) { return ClassifyParent(snapshot->trie, parentWithSeparator); },
+        [&](std::wstring_view path) { return snapshot->trie.Matches(path); });
+}
+
+bool LookupViaIndex(const CSnapshotPublisher<LookupSnapshot> &publisher, CParentVerdictMemo &memo, std::wstring_view raw)
+{
+    const auto snapshot = publisher.Read();
+    const CNormalizedPath target(raw);
+    return snapshot && memo.Resolve(
+        snapshot->generation, target.View(),
+        [&](std::wstring_view parentWithSeparator) {
+            return ClassifyParent(snapshot->view, CUtf16Query(parentWithSeparator).View());
+        },
+        [&](std::wstring_view path) { return snapshot->view.Matches(CUtf16Query(path).View()); });
+}
+} // namespace
+
+int RunAllocationBench(const BenchOptions &options)
+{
+    CPathGenerator gen(2468);
+    const SyntheticIndex index = GenerateSyncedIndex(gen, options.quick ? 200 : 2000, 10);
+    std::vector<std::wstring> roots;
+    for (const std::wstring &path : index.rawPaths)
+    {
+        roots.push_back(NormalizePath(path));
+    }
+    ReduceToCoveringRoots(roots);
+    const std::vector<std::wstring> queries = GenerateQueries(gen, index, options.quick ? 5000 : 50000);
+
+    std::unique_ptr<LookupSnapshot> snapshot(new LookupSnapshot());
+    snapshot->generation = 1;
+    snapshot->trie.Build(roots);
+    std::vector<std::u16string> units;
+    for (const std::wstring &root : roots)
+    {
+        units.emplace_back();
+        AppendWideAsUtf16(root, units.back());
+    }
+    snapshot->image = BuildOverlayIndexImage(units, 1);
+    snapshot->view.Open(snapshot->image.data(), snapshot->image.size());
+
+    CSnapshotPublisher<LookupSnapshot> publisher;
+    publisher.Publish(std::move(snapshot));
+    CParentVerdictMemo trieMemo;
+    CParentVerdictMemo indexMemo;
+
+    int failures = 0;
+    size_t trieHits = 0;
+    size_t indexHits = 0;
+    uint64_t steadyAllocations = 0;
+    CShellStats &stats = ProcessShellStats(); // Created on first use, like the DLL's
+    stats.Count(ShellCounter::IsMemberOfCalls, 0);
+    {
+        CAllocationScope scope;
+        for (const std::wstring &query : queries)
+        {
+            CShellStatsTimer timer(stats, ShellTimer::IsMemberOf);
+            stats.Count(ShellCounter::IsMemberOfCalls);
+            trieHits += LookupViaTrie(publisher, trieMemo, query) ? 1 : 0;
+            indexHits += LookupViaIndex(publisher, indexMemo, query) ? 1 : 0;
+            failures += IsSameOrChildPath(query, query) ? 0 : 1;
+        }
+        steadyAllocations = scope.Count();
+    }
+    failures += steadyAllocations == 0 ? 0 : 1;
+    failures += trieHits == indexHits ? 0 : 1;
+
+    // The counter works, and only overlong paths spill to the heap.
+    uint64_t longAllocations = 0;
+    {
+        const std::wstring longPath(CNormalizedPath::kInlineLength + 1, L'a');
+        CAllocationScope scope;
+        LookupViaTrie(publisher, trieMemo, longPath);
+        longAllocations = scope.Count();
+    }
+    failures += longAllocations == 1 ? 0 : 1;
+
+    std::printf("steady state: %zu lookups x 2, %llu allocations (%zu hits)\n", queries.size(),
+                static_cast<unsigned long long>(steadyAllocations), trieHits);
+    std::printf("over-long path: %llu allocation(s)\n", static_cast<unsigned long long>(longAllocations));
+    return failures == 0 ? 0 : 1;
+}
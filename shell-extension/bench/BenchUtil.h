@@ -0,0 +1,212 @@
+// Shared helpers for the overlay core benchmark
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// Named measurements collected across suites; written out with --json so
+// runs can be compared for regressions.
+class CBenchReport
+{
+public:
+    void SetSuite(const char *suite) { m_suite = suite; }
+
+    void Add(const std::string &name, double value, const char *unit)
+    {
+        m_metrics.push_back(Metric{m_suite, name, unit, value});
+    }
+
+    // {"schema": 1, "quick": bool, "metrics": [{"suite", "name", "value", "unit"}, ...]}
+    bool WriteJson(const char *file, bool quick) const
+    {
+        FILE *out = std::fopen(file, "w");
+        if (!out)
+        {
+            return false;
+        }
+
+        std::fprintf(out, "{\n  \"schema\": 1,\n  \"quick\": %s,\n  \"metrics\": [", quick ? "true" : "false");
+        for (size_t i = 0; i < m_metrics.size(); i++)
+        {
+            const Metric &metric = m_metrics[i];
+            std::fprintf(out, "%s\n    {\"suite\": \"%s\", \"name\": \"%s\", \"value\": %.6g, \"unit\": \"%s\"}",
+                         i ? "," : "", metric.suite.c_str(), metric.name.c_str(), metric.value, metric.unit.c_str());
+        }
+        std::fprintf(out, "\n  ]\n}\n");
+        return std::fclose(out) == 0;
+    }
+
+private:
+    // Names are plain ASCII chosen by the suites; nothing needs escaping.
+    struct Metric
+    {
+        std::string suite;
+        std::string name;
+        std::string unit;
+        double value;
+    };
+
+    std::string m_suite;
+    std::vector<Metric> m_metrics;
+};
+
+struct BenchOptions
+{
+    bool quick = false;             // Small sizes for CTest runs
+    CBenchReport *report = nullptr; // Where suites record metrics, if anyone asked
+};
+
+inline void ReportMetric(const BenchOptions &options, const std::string &name, double value, const char *unit)
+{
+    if (options.report)
+    {
+        options.report->Add(name, value, unit);
+    }
+}
+
+// Nearest-rank percentile (0-100) of samples sorted ascending.
+inline double Percentile(const std::vector<double> &sorted, double percent)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    const size_t rank = static_cast<size_t>(percent / 100.0 * static_cast<double>(sorted.size()));
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+class CStopwatch
+{
+public:
+    CStopwatch() : m_start(std::chrono::steady_clock::now()) {}
+
+    double ElapsedMs() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Synthetic synced-path generator. Produces raw (un-normalized) paths with
+// mixed case and separators, the way the app writes them.
+class CPathGenerator
+{
+public:
+    explicit CPathGenerator(unsigned seed) : m_rng(seed) {}
+
+    std::wstring Component()
+    {
+        static const wchar_t *const kWords[] = {
+            L"Documents", L"photos", L"Projects", L"src", L"node_modules", L"Backup",
+            L"2024", L"Q3 Reports", L"client-a", L"client-ab", L"Music", L"raw",
+        };
+        std::wstring word = kWords[m_rng() % (sizeof(kWords) / sizeof(kWords[0]))];
+        if (m_rng() % 3 == 0)
+        {
+            word += std::to_wstring(m_rng() % 1000);
+        }
+        return word;
+    }
+
+    std::wstring Drive()
+    {
+        static const wchar_t *const kDrives[] = {L"C:", L"c:", L"D:", L"\\\\server\\share"};
+        return kDrives[m_rng() % (sizeof(kDrives) / sizeof(kDrives[0]))];
+    }
+
+    wchar_t Separator()
+    {
+        return (m_rng() % 4 == 0) ? L'/' : L'\\';
+    }
+
+    // Path of the given depth below a drive, e.g. "C:\Projects/src\raw12".
+    std::wstring Path(size_t depth)
+    {
+        std::wstring path = Drive();
+        for (size_t i = 0; i < depth; i++)
+        {
+            path += Separator();
+            path += Component();
+        }
+        return path;
+    }
+
+    unsigned Next() { return static_cast<unsigned>(m_rng()); }
+
+private:
+    std::mt19937 m_rng;
+};
+
+// Index shaped like SyncTracker's: every synced folder plus the files in it.
+struct SyntheticIndex
+{
+    std::vector<std::wstring> rawFolders;
+    std::vector<std::wstring> rawPaths;
+};
+
+inline SyntheticIndex GenerateSyncedIndex(CPathGenerator &gen, size_t folderCount, size_t filesPerFolder)
+{
+    SyntheticIndex index;
+    for (size_t i = 0; i < folderCount; i++)
+    {
+        const std::wstring folder = gen.Path(1 + gen.Next() % 5);
+        index.rawFolders.push_back(folder);
+        index.rawPaths.push_back(folder);
+        for (size_t f = 0; f < filesPerFolder; f++)
+        {
+            index.rawPaths.push_back(folder + gen.Separator() + gen.Component() + L".txt");
+        }
+    }
+    return index;
+}
+
+// Raw query paths: roots, children, near-miss siblings, parents and noise.
+inline std::vector<std::wstring> GenerateQueries(CPathGenerator &gen, const SyntheticIndex &index, size_t count)
+{
+    std::vector<std::wstring> queries;
+    for (size_t i = 0; queries.size() < count; i++)
+    {
+        const std::wstring &folder = index.rawFolders[gen.Next() % index.rawFolders.size()];
+        switch (i % 5)
+        {
+        case 0: queries.push_back(folder); break;
+        case 1: queries.push_back(folder + L"\\" + gen.Component()); break;
+        case 2: queries.push_back(folder + L"x"); break;
+        case 3: queries.push_back(folder.substr(0, folder.find_last_of(L"\\/"))); break;
+        default: queries.push_back(gen.Path(1 + gen.Next() % 7)); break;
+        }
+    }
+    return queries;
+}
+
+int RunTrieBench(const BenchOptions &options);
+int RunIndexFormatBench(const BenchOptions &options);
+int RunSnapshotBench(const BenchOptions &options);
+int RunChangeMonitorBench(const BenchOptions &options);
+int RunParentMemoBench(const BenchOptions &options);
+int RunNormalizeBench(const BenchOptions &options);
+int RunAllocationBench(const BenchOptions &options);
+int RunJournalBench(const BenchOptions &options);
+int RunTextLoaderBench(const BenchOptions &options);
+int RunStatusBench(const BenchOptions &options);
+int RunSharedIndexBench(const BenchOptions &options);
+int RunEngineBench(const BenchOptions &options);
+int RunStatsBench(const BenchOptions &options);
+int RunReloaderBench(const BenchOptions &options);
+int RunLinkIndexBench(const BenchOptions &options);
+int RunSelectionBench(const BenchOptions &options);
+int RunIpcBench(const BenchOptions &options);
+int RunInvokeBench(const BenchOptions &options);
+int RunMenuBench(const BenchOptions &options);
+int RunExclusionBench(const BenchOptions &options);
+int RunScanBench(const BenchOptions &options);
+int RunHashBench(const BenchOptions &options);
+int RunSyncDbBench(const BenchOptions &options);
+int RunWatchBench(const BenchOptions &options);
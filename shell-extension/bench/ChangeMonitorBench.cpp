@@ -0,0 +1,133 @@
+// Index change monitor: notification latency, idle silence, fallback and
+// upgrade when the index directory appears later.
+
+#include "BenchUtil.h"
+#include "IndexChangeSource.h"
+#include <fstream>
+#include <thread>
+
+namespace
+{
+namespace fs = std::filesystem;
+
+void TouchFile(const fs::path &file, const char *content)
+{
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    out << content;
+}
+
+// Milliseconds until the monitor reports a change, or -1 on timeout.
+double WaitForPending(CIndexChangeMonitor &monitor, double timeoutMs)
+{
+    CStopwatch timer;
+    while (timer.ElapsedMs() < timeoutMs)
+    {
+        if (monitor.ConsumeChange())
+        {
+            return timer.ElapsedMs();
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return -1.0;
+}
+
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+int RunSource(const char *label, bool allowNative, uint32_t pollMs, int writes)
+{
+    const fs::path dir = fs::temp_directory_path() / "rrightclickrr-bench-monitor";
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir);
+    const fs::path index = dir / "synced-paths.idx";
+
+    CIndexChangeMonitor monitor;
+    int failures = Expect(monitor.Start(dir, {index}, pollMs, allowNative), "monitor starts");
+    failures += Expect(monitor.ConsumeChange(), "change pending right after start");
+    failures += Expect(monitor.UsingPollingFallback() == !allowNative, "expected source kind");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(pollMs + 100));
+    failures += Expect(!monitor.HasPendingChange(), "idle directory stays quiet");
+
+    double total = 0;
+    double worst = 0;
+    for (int i = 0; i < writes; i++)
+    {
+        TouchFile(index, i % 2 ? "odd" : "even-write");
+        const double latency = WaitForPending(monitor, 3000.0 + pollMs);
+        failures += Expect(latency >= 0, "write is noticed");
+        total += latency;
+        worst = latency > worst ? latency : worst;
+        // Let trailing events from this write settle before the next one.
+        std::this_thread::sleep_for(std::chrono::milliseconds(allowNative ? 5 : pollMs + 20));
+        monitor.ConsumeChange();
+    }
+
+    CStopwatch stopTimer;
+    monitor.Stop();
+    const double stopMs = stopTimer.ElapsedMs();
+    failures += Expect(!monitor.IsRunning(), "monitor stops");
+
+    std::printf("%-8s writes %d, latency avg %.2f ms, max %.2f ms, stop %.2f ms\n", label, writes, total / writes, worst, stopMs);
+    fs::remove_all(dir, ec);
+    return failures;
+}
+
+int RunLateDirectory(uint32_t pollMs)
+{
+    const fs::path dir = fs::temp_directory_path() / "rrightclickrr-bench-monitor-late";
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    const fs::path index = dir / "synced-paths.idx";
+
+    CIndexChangeMonitor monitor;
+    int failures = Expect(monitor.Start(dir, {index}, pollMs), "monitor starts without directory");
+    monitor.ConsumeChange();
+    failures += Expect(monitor.UsingPollingFallback(), "missing directory falls back to polling");
+
+    fs::create_directories(dir);
+    TouchFile(index, "first");
+    failures += Expect(WaitForPending(monitor, 3000.0 + pollMs) >= 0, "first index write is noticed by polling");
+
+    // After the first change the monitor upgrades to notifications.
+    CStopwatch upgrade;
+    while (monitor.UsingPollingFallback() && upgrade.ElapsedMs() < 2000)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+#if defined(_WIN32) || defined(__linux__)
+    failures += Expect(!monitor.UsingPollingFallback(), "upgrades to notifications once the directory exists");
+#endif
+
+    monitor.ConsumeChange();
+    TouchFile(index, "second");
+    failures += Expect(WaitForPending(monitor, 3000.0 + pollMs) >= 0, "later write is noticed");
+
+    monitor.Stop();
+    fs::remove_all(dir, ec);
+    std::printf("late directory: %s\n", failures == 0 ? "ok" : "failed");
+    return failures;
+}
+} // namespace
+
+int RunChangeMonitorBench(const BenchOptions &options)
+{
+    const int writes = options.quick ? 5 : 50;
+    const uint32_t pollMs = options.quick ? 50 : 250;
+
+    int failures = 0;
+#if defined(_WIN32) || defined(__linux__)
+    failures += RunSource("native", true, pollMs, writes);
+#endif
+    failures += RunSource("polling", false, pollMs, options.quick ? 3 : 10);
+    failures += RunLateDirectory(pollMs);
+    return failures == 0 ? 0 : 1;
+}
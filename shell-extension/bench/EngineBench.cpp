@@ -0,0 +1,239 @@
+// Overlay engine end to end on synthetic indexes of 1k, 100k and 1M listed
+// paths: load time for both index files, bytes per root, and per-call
+// latency percentiles for normalization, matching and lookups. Every metric
+// goes to the --json report for regression tracking.
+
+#include "BenchUtil.h"
+#include "OverlayIndexFormat.h"
+#include "OverlayIndexWriter.h"
+#include "PathArena.h"
+#include "PathNormalize.h"
+#include "SyncedPathMatch.h"
+#include "SyncedPathTrie.h"
+#include "Utf8.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+std::string ToUtf8(const std::wstring &value)
+{
+    std::string utf8;
+    for (wchar_t ch : value)
+    {
+        utf8.push_back(static_cast<char>(ch)); // Generator paths are ASCII
+    }
+    return utf8;
+}
+
+std::u16string ToUtf16(const std::wstring &value)
+{
+    std::u16string units;
+    AppendWideAsUtf16(value, units);
+    return units;
+}
+
+std::string SizeLabel(size_t paths)
+{
+    if (paths >= 1000000 && paths % 1000000 == 0)
+    {
+        return std::to_string(paths / 1000000) + "M";
+    }
+    return paths >= 1000 ? std::to_string(paths / 1000) + "k" : std::to_string(paths);
+}
+
+// Cost of the clock reads around each timed call, taken off every sample.
+double ClockOverheadNs()
+{
+    std::vector<double> samples(10000);
+    for (double &sample : samples)
+    {
+        const Clock::time_point start = Clock::now();
+        sample = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+    std::sort(samples.begin(), samples.end());
+    return Percentile(samples, 50);
+}
+
+// Times op(i) once per item and reports the latency distribution.
+template <typename Op>
+void MeasureLatency(const BenchOptions &options, const std::string &prefix, const char *name, size_t count,
+                    double overheadNs, Op &&op)
+{
+    std::vector<double> samples(count);
+    size_t sink = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const Clock::time_point start = Clock::now();
+        sink += op(i) ? 1 : 0;
+        const double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count() - overheadNs;
+        samples[i] = std::max(0.0, elapsed);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    static const struct
+    {
+        const char *label;
+        double percent;
+    } kPercentiles[] = {{"p50", 50}, {"p90", 90}, {"p99", 99}, {"p999", 99.9}};
+
+    std::printf("  %-16s", name);
+    for (const auto &percentile : kPercentiles)
+    {
+        const double value = Percentile(samples, percentile.percent);
+        std::printf(" %s %7.0f", percentile.label, value);
+        ReportMetric(options, prefix + name + "/" + percentile.label, value, "ns");
+    }
+    std::printf(" max %8.0f ns (%zu hits)\n", samples.back(), sink);
+    ReportMetric(options, prefix + name + "/max", samples.back(), "ns");
+}
+
+// Median wall time of runs calls to op, in milliseconds.
+template <typename Op>
+double MedianMs(int runs, Op &&op)
+{
+    std::vector<double> times;
+    for (int run = 0; run < runs; run++)
+    {
+        CStopwatch timer;
+        op();
+        times.push_back(timer.ElapsedMs());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+int RunSize(CPathGenerator &gen, const BenchOptions &options, size_t pathCount, double overheadNs)
+{
+    namespace fs = std::filesystem;
+    const std::string label = SizeLabel(pathCount);
+    const std::string prefix = label + "/";
+    const fs::path dir = fs::temp_directory_path() / "rrightclickrr-bench-engine";
+    fs::create_directories(dir);
+    const fs::path textFile = dir / "synced-paths.txt";
+    const fs::path indexFile = dir / "synced-paths.idx";
+    fs::remove(indexFile);
+
+    // SyncTracker's shape: each synced folder, then the files in it.
+    constexpr size_t kFilesPerFolder = 9;
+    const SyntheticIndex index = GenerateSyncedIndex(gen, pathCount / (kFilesPerFolder + 1), kFilesPerFolder);
+    std::vector<std::string> utf8Paths;
+    utf8Paths.reserve(index.rawPaths.size());
+    {
+        std::ofstream out(textFile, std::ios::binary | std::ios::trunc);
+        for (const std::wstring &path : index.rawPaths)
+        {
+            utf8Paths.push_back(ToUtf8(path));
+            out << utf8Paths.back() << '\n';
+        }
+    }
+
+    const int runs = pathCount >= 1000000 ? 3 : 5;
+    CPathArena arena;
+    size_t lineCount = 0;
+    const double textLoadMs = MedianMs(runs, [&]() {
+        arena.Clear();
+        LoadSyncedPathListFile(textFile, arena, lineCount);
+    });
+
+    CSyncedPathTrie trie;
+    const double trieBuildMs = MedianMs(runs, [&]() { trie.Build(arena); });
+
+    uint64_t generation = 0;
+    CStopwatch writeTimer;
+    WriteOverlayIndex(indexFile, utf8Paths, generation);
+    const double indexWriteMs = writeTimer.ElapsedMs();
+
+    std::vector<uint8_t> image;
+    COverlayIndexView view;
+    OverlayIndexStatus status = OverlayIndexStatus::TooSmall;
+    const double indexOpenMs = MedianMs(runs, [&]() {
+        std::ifstream in(indexFile, std::ios::binary);
+        image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        status = view.Open(image.data(), image.size());
+    });
+
+    const size_t roots = trie.RootCount();
+    const double trieBytesPerRoot = static_cast<double>(trie.MemoryBytes()) / static_cast<double>(roots);
+    const double indexBytesPerRoot = static_cast<double>(image.size()) / static_cast<double>(view.EntryCount());
+    std::printf("%s: %zu paths -> %zu roots; text load %.1f ms + trie build %.1f ms (%.0f B/root); "
+                "index write %.1f ms, read+open %.1f ms (%.0f B/root)\n",
+                label.c_str(), lineCount, roots, textLoadMs, trieBuildMs, trieBytesPerRoot, indexWriteMs, indexOpenMs,
+                indexBytesPerRoot);
+    ReportMetric(options, prefix + "paths", static_cast<double>(lineCount), "count");
+    ReportMetric(options, prefix + "roots", static_cast<double>(roots), "count");
+    ReportMetric(options, prefix + "text_load", textLoadMs, "ms");
+    ReportMetric(options, prefix + "trie_build", trieBuildMs, "ms");
+    ReportMetric(options, prefix + "text_reload", textLoadMs + trieBuildMs, "ms");
+    ReportMetric(options, prefix + "trie_bytes_per_root", trieBytesPerRoot, "bytes");
+    ReportMetric(options, prefix + "index_write", indexWriteMs, "ms");
+    ReportMetric(options, prefix + "index_open", indexOpenMs, "ms");
+    ReportMetric(options, prefix + "index_bytes_per_root", indexBytesPerRoot, "bytes");
+
+    // Explorer-style queries, as raw paths and prepared for each stage.
+    const size_t queryCount = options.quick ? 20000 : 200000;
+    const std::vector<std::wstring> raw = GenerateQueries(gen, index, queryCount);
+    std::vector<std::wstring> normalized;
+    std::vector<std::u16string> units;
+    std::vector<std::wstring_view> nearestRoot;
+    for (const std::wstring &query : raw)
+    {
+        normalized.push_back(NormalizePath(query));
+        units.push_back(ToUtf16(normalized.back()));
+        // The root a sorted scan would compare the query with.
+        const size_t nearest = std::min(arena.LowerBound(normalized.back()), arena.Size() - 1);
+        nearestRoot.push_back(arena[nearest]);
+    }
+
+    MeasureLatency(options, prefix, "normalize", raw.size(), overheadNs,
+                   [&](size_t i) { return CNormalizedPath(raw[i]).View().size() > 3; });
+    MeasureLatency(options, prefix, "is_same_or_child", raw.size(), overheadNs,
+                   [&](size_t i) { return IsSameOrChildPath(normalized[i], nearestRoot[i]); });
+    MeasureLatency(options, prefix, "trie_lookup", raw.size(), overheadNs,
+                   [&](size_t i) { return trie.Matches(normalized[i]); });
+    MeasureLatency(options, prefix, "index_lookup", raw.size(), overheadNs,
+                   [&](size_t i) { return view.Matches(units[i]); });
+    MeasureLatency(options, prefix, "raw_to_verdict", raw.size(), overheadNs,
+                   [&](size_t i) { return trie.Matches(CNormalizedPath(raw[i]).View()); });
+
+    int mismatches = status == OverlayIndexStatus::Ok ? 0 : 1;
+    for (size_t i = 0; i < raw.size(); i++)
+    {
+        if (trie.Matches(normalized[i]) != view.Matches(units[i]))
+        {
+            if (mismatches++ < 5)
+            {
+                std::fprintf(stderr, "  trie and index disagree on %ls\n", normalized[i].c_str());
+            }
+        }
+    }
+
+    fs::remove_all(dir);
+    return mismatches;
+}
+} // namespace
+
+int RunEngineBench(const BenchOptions &options)
+{
+    CPathGenerator gen(1313);
+    const double overheadNs = ClockOverheadNs();
+    std::printf("clock overhead %.0f ns, subtracted from every latency sample\n", overheadNs);
+    ReportMetric(options, "clock_overhead", overheadNs, "ns");
+
+    // CTest keeps to the two smaller indexes.
+    std::vector<size_t> sizes = {1000, 100000, 1000000};
+    if (options.quick)
+    {
+        sizes.pop_back();
+    }
+
+    int failures = 0;
+    for (size_t size : sizes)
+    {
+        failures += RunSize(gen, options, size, overheadNs);
+    }
+    return failures == 0 ? 0 : 1;
+}
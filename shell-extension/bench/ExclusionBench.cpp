@@ -0,0 +1,463 @@
+// Exclusion matcher: parity with the app's rule (src/lib/exclusions.js) on
+// fixed and random rule sets, what a parent's verdict promises about its
+// children, file round trip and torn images, and the cost of one compiled
+// walk against checking every rule of every synced folder in turn.
+
+#include "BenchUtil.h"
+#include "ExclusionMatcher.h"
+#include "OverlayIndexWriter.h"
+#include "ParentVerdictMemo.h"
+#include "SyncedPathMatch.h"
+#include "Utf8.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+namespace fs = std::filesystem;
+
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+std::u16string Normalized(const std::wstring &path)
+{
+    std::u16string units;
+    AppendWideAsUtf16(NormalizePath(path), units);
+    return units;
+}
+
+std::string ToUtf8(const std::wstring &value)
+{
+    std::string utf8;
+    AppendWideAsUtf8(value, utf8);
+    return utf8;
+}
+
+std::vector<std::wstring> SplitNames(const std::wstring &path)
+{
+    std::vector<std::wstring> names;
+    size_t begin = 0;
+    while (begin <= path.size())
+    {
+        size_t end = path.find_first_of(L"\\/", begin);
+        if (end == std::wstring::npos)
+        {
+            end = path.size();
+        }
+        if (end > begin && path.compare(begin, end - begin, L".") != 0)
+        {
+            // exclusions.js folds final sigma into sigma.
+            std::wstring name = path.substr(begin, end - begin);
+            std::replace(name.begin(), name.end(), L'\u03C2', L'\u03C3');
+            names.push_back(std::move(name));
+        }
+        begin = end + 1;
+    }
+    return names;
+}
+
+bool ReferenceGlob(const wchar_t *pattern, const wchar_t *name)
+{
+    if (*pattern == L'\0')
+    {
+        return *name == L'\0';
+    }
+    if (*pattern == L'*')
+    {
+        return ReferenceGlob(pattern + 1, name) || (*name != L'\0' && ReferenceGlob(pattern, name + 1));
+    }
+    return *name != L'\0' && (*pattern == L'?' || *pattern == *name) && ReferenceGlob(pattern + 1, name + 1);
+}
+
+bool ReferenceNames(const std::vector<std::wstring> &pattern, size_t p, const std::vector<std::wstring> &names,
+                    size_t n)
+{
+    if (p == pattern.size())
+    {
+        return true; // Everything beneath what the pattern names
+    }
+    if (pattern[p] == L"**")
+    {
+        for (size_t skip = n; skip <= names.size(); skip++)
+        {
+            if (ReferenceNames(pattern, p + 1, names, skip))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    return n < names.size() && ReferenceGlob(pattern[p].c_str(), names[n].c_str()) &&
+           ReferenceNames(pattern, p + 1, names, n + 1);
+}
+
+// The app's rule as exclusions.js applies it: lower-cased, relative to the
+// synced folder, pattern names matched against the leading names of the
+// relative path.
+bool ReferenceExcluded(const std::vector<ExclusionRule> &rules, const std::wstring &path)
+{
+    const std::wstring query = NormalizePath(path);
+    for (const ExclusionRule &rule : rules)
+    {
+        const std::wstring root = NormalizePath(rule.root);
+        std::wstring relative;
+        if (root.empty())
+        {
+            relative = query;
+        }
+        else if (query.size() > root.size() && IsSameOrChildPath(query, root))
+        {
+            relative = query.substr(root.size());
+        }
+        else
+        {
+            continue;
+        }
+        const std::vector<std::wstring> pattern = SplitNames(NormalizePath(rule.pattern));
+        if (!pattern.empty() && ReferenceNames(pattern, 0, SplitNames(relative), 0))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int CheckExamples()
+{
+    const std::vector<ExclusionRule> rules = {
+        {L"C:\\Work", L"Photos/RAW"},
+        {L"C:\\Work", L"**\\node_modules"},
+        {L"C:\\Work", L"cache\\*.tmp"},
+        {L"C:\\Work", L"build-?"},
+        {L"C:\\Work", L"docs\\**\\drafts"},
+        {L"D:\\", L"pagefile.sys"},
+        {L"\\\\server\\share\\team", L"*.bak"},
+        {L"C:\\Work", L""},
+        {L"C:\\Work", L"..\\Other"},
+        {L"", L".git"},
+    };
+    CExclusionMatcher matcher;
+    matcher.Compile(rules);
+    int failures = Expect(matcher.View().RuleCount() == 8, "empty and escaping patterns dropped");
+
+    const std::pair<const wchar_t *, bool> cases[] = {
+        {L"c:\\work\\photos\\raw", true},
+        {L"C:/Work/Photos/Raw/img1.cr2", true},
+        {L"c:\\work\\photos\\rawer", false},
+        {L"c:\\work\\photos", false},
+        {L"c:\\work\\node_modules", true},
+        {L"c:\\work\\a\\b\\node_modules\\x\\y.js", true},
+        {L"c:\\work\\a\\node_modules2", false},
+        {L"c:\\work\\cache\\1.tmp", true},
+        {L"c:\\work\\cache\\sub\\1.tmp", false},
+        {L"c:\\work\\build-1\\out.o", true},
+        {L"c:\\work\\build-10", false},
+        {L"c:\\work\\docs\\drafts", true},
+        {L"c:\\work\\docs\\2024\\q3\\drafts\\a.md", true},
+        {L"c:\\work\\docs\\2024\\final", false},
+        {L"c:\\work", false},
+        {L"c:\\workshop\\node_modules", false},
+        {L"c:\\other", false},
+        {L"d:\\pagefile.sys", true},
+        {L"d:\\data\\pagefile.sys", false},
+        {L"\\\\server\\share\\team\\old.bak", true},
+        {L"\\\\server\\share\\team\\old.bak\\inner", true},
+        {L"\\\\server\\share\\old.bak", false},
+        {L".git\\objects", true},
+        {L"src\\.git", false},
+    };
+    for (const auto &entry : cases)
+    {
+        const bool excluded = matcher.IsExcluded(Normalized(entry.first));
+        failures += Expect(excluded == entry.second, "example verdict");
+        failures += Expect(excluded == ReferenceExcluded(rules, entry.first), "example matches the reference");
+    }
+
+    failures += Expect(matcher.Classify(u"c:\\work\\photos\\raw\\") == ExclusionVerdict::Excluded,
+                       "children of an excluded folder");
+    failures += Expect(matcher.Classify(u"c:\\work\\photos\\") == ExclusionVerdict::Partial, "folder above a rule");
+    failures += Expect(matcher.Classify(u"e:\\music\\") == ExclusionVerdict::None, "unrelated folder");
+    failures += Expect(matcher.Classify(u"c:\\work\\x\\y\\") == ExclusionVerdict::Partial,
+                       "\"**\" keeps every folder beneath partial");
+
+    // Folded into the overlay handler's parent verdicts.
+    const bool narrowed =
+        ExcludeFromVerdict(ParentVerdict::Covered, ExclusionVerdict::Partial) == ParentVerdict::Mixed &&
+        ExcludeFromVerdict(ParentVerdict::Covered, ExclusionVerdict::Excluded) == ParentVerdict::Empty &&
+        ExcludeFromVerdict(ParentVerdict::Mixed, ExclusionVerdict::Partial) == ParentVerdict::Mixed &&
+        ExcludeFromVerdict(ParentVerdict::Covered, ExclusionVerdict::None) == ParentVerdict::Covered;
+    failures += Expect(narrowed, "parent verdicts narrowed by exclusions");
+
+    CExclusionMatcher empty;
+    failures += Expect(empty.Empty() && !empty.IsExcluded(u"c:\\work") &&
+                           empty.Classify(u"c:\\") == ExclusionVerdict::None,
+                       "nothing compiled excludes nothing");
+    empty.Compile({});
+    failures += Expect(empty.Empty() && !empty.IsExcluded(u"c:\\work"), "no rules exclude nothing");
+
+    // Where the compiled walk once parted from exclusions.js.
+    const std::vector<ExclusionRule> edgeRules = {
+        {L"C:\\Users\\a\\proj", L"**"},
+        {L"C:\\Work", L"build"},
+        {L"C:\\Greek", L"\u03A3\u0391\u03A3"},
+        {L"C:\\Greek2", L"\u03C3\u03B1\u03C2"},
+        {L"C:\\Greek3", L"*\u03C2"},
+    };
+    CExclusionMatcher edges;
+    edges.Compile(edgeRules);
+    const std::pair<const wchar_t *, bool> edgeCases[] = {
+        {L"C:\\Users\\a\\proj", false},
+        {L"C:\\Users\\a\\proj\\src\\main.c", true},
+        {L"C:\\Work\\.\\build", true},
+        {L"C:\\Work\\.\\src\\.\\build", false},
+        {L"C:\\Greek\\\u03C3\u03B1\u03C2", true},
+        {L"C:\\Greek\\\u03C3\u03B1\u03C3", true},
+        {L"C:\\Greek2\\\u03A3\u0391\u03A3", true},
+        {L"C:\\Greek3\\\u0391\u03A3", true},
+    };
+    for (const auto &entry : edgeCases)
+    {
+        const bool excluded = edges.IsExcluded(Normalized(entry.first));
+        failures += Expect(excluded == entry.second, "edge case verdict");
+        failures += Expect(excluded == ReferenceExcluded(edgeRules, entry.first), "edge case matches the reference");
+    }
+
+    failures += Expect(MatchExclusionGlob(u"*", u"") && MatchExclusionGlob(u"a*b*c", u"aXbYbc") &&
+                           !MatchExclusionGlob(u"a*b", u"ab!") && MatchExclusionGlob(u"??", u"ab") &&
+                           !MatchExclusionGlob(u"?", u""),
+                       "glob basics");
+    std::printf("examples: %zu paths; %d failures\n", sizeof(cases) / sizeof(cases[0]), failures);
+    return failures;
+}
+
+std::wstring RandomPattern(CPathGenerator &gen)
+{
+    switch (gen.Next() % 8)
+    {
+    case 0: return L"**\\" + gen.Component();
+    case 1: return gen.Component() + L"\\*.txt";
+    case 2: return gen.Component() + L"*";
+    case 3: return L"client-?";
+    case 4: return gen.Component() + L"\\**\\raw";
+    case 5: return gen.Component() + L"/" + gen.Component();
+    case 6: return L"*\\" + gen.Component() + L"\\**";
+    default: return gen.Component();
+    }
+}
+
+// Rules and queries from the same words, so matches are common enough to
+// matter; queries hang below the rules' roots and elsewhere.
+struct RandomCase
+{
+    std::vector<ExclusionRule> rules;
+    std::vector<std::wstring> queries;
+};
+
+RandomCase GenerateCase(unsigned seed, size_t folders, size_t patternsPerFolder, size_t queryCount)
+{
+    CPathGenerator gen(seed);
+    RandomCase result;
+    std::vector<std::wstring> roots;
+    for (size_t i = 0; i < folders; i++)
+    {
+        roots.push_back(gen.Path(1 + gen.Next() % 3));
+        for (size_t p = 0; p < patternsPerFolder; p++)
+        {
+            result.rules.push_back({roots.back(), RandomPattern(gen)});
+        }
+    }
+    for (size_t i = 0; i < queryCount; i++)
+    {
+        std::wstring query = (i % 4 == 3) ? gen.Path(1 + gen.Next() % 4) : roots[gen.Next() % roots.size()];
+        const size_t depth = gen.Next() % 6;
+        for (size_t d = 0; d < depth; d++)
+        {
+            query += gen.Separator();
+            query += (gen.Next() % 5 == 0) ? L"file.txt" : gen.Component();
+        }
+        result.queries.push_back(query);
+    }
+    return result;
+}
+
+int CheckParity(const BenchOptions &options)
+{
+    const size_t queryCount = options.quick ? 20000 : 200000;
+    const RandomCase sample = GenerateCase(21, 60, 3, queryCount);
+    CExclusionMatcher matcher;
+    matcher.Compile(sample.rules);
+
+    int failures = 0;
+    size_t excluded = 0;
+    size_t promises = 0;
+    for (const std::wstring &query : sample.queries)
+    {
+        const std::u16string normalized = Normalized(query);
+        const bool actual = matcher.IsExcluded(normalized);
+        excluded += actual ? 1 : 0;
+        if (actual != ReferenceExcluded(sample.rules, query) && failures < 10)
+        {
+            failures += Expect(false, "random path matches the reference");
+        }
+
+        // A parent's verdict must hold for whichever child is asked about.
+        const size_t cut = normalized.rfind(u'\\');
+        if (cut != std::u16string::npos && cut > 0)
+        {
+            const ExclusionVerdict parent = matcher.Classify(std::u16string_view(normalized).substr(0, cut + 1));
+            if ((parent == ExclusionVerdict::Excluded && !actual) || (parent == ExclusionVerdict::None && actual))
+            {
+                failures += Expect(false, "parent verdict holds for its child");
+            }
+            promises += parent != ExclusionVerdict::Partial ? 1 : 0;
+        }
+    }
+    failures += Expect(excluded > queryCount / 20 && excluded < queryCount, "a useful share excluded");
+    std::printf("random parity: %zu rules, %u states, %zu queries, %zu excluded, %zu settled by the parent; "
+                "%d failures\n",
+                sample.rules.size(), matcher.View().StateCount(), queryCount, excluded, promises, failures);
+    return failures;
+}
+
+int CheckFileRoundTrip()
+{
+    const fs::path dir = fs::temp_directory_path() / "rrightclickrr-bench-exclusions";
+    fs::create_directories(dir);
+    const fs::path file = dir / "synced-exclusions.idx";
+    fs::remove(file);
+
+    const RandomCase sample = GenerateCase(22, 40, 4, 4000);
+    std::vector<std::string> roots;
+    std::vector<std::string> patterns;
+    for (const ExclusionRule &rule : sample.rules)
+    {
+        roots.push_back(ToUtf8(rule.root));
+        patterns.push_back(ToUtf8(rule.pattern));
+    }
+
+    uint64_t first = 0;
+    uint64_t second = 0;
+    int failures = Expect(WriteExclusionIndex(file, roots, patterns, first) && first == 1, "first write");
+    failures += Expect(WriteExclusionIndex(file, roots, patterns, second) && second == 2, "generation advances");
+
+    std::vector<uint8_t> bytes;
+    {
+        std::ifstream in(file, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    CExclusionMatcher loaded;
+    CExclusionMatcher compiled;
+    compiled.Compile(sample.rules);
+    failures += Expect(loaded.Load(bytes.data(), bytes.size()) == OverlayIndexStatus::Ok &&
+                           loaded.View().Generation() == 2 && loaded.View().RuleCount() == sample.rules.size(),
+                       "written index loads");
+    size_t mismatches = 0;
+    for (const std::wstring &query : sample.queries)
+    {
+        const std::u16string normalized = Normalized(query);
+        mismatches += loaded.IsExcluded(normalized) != compiled.IsExcluded(normalized) ? 1 : 0;
+    }
+    failures += Expect(mismatches == 0, "loaded index answers like the compiled one");
+
+    // Torn and foreign images leave the matcher empty.
+    std::vector<uint8_t> torn = bytes;
+    torn[torn.size() / 2] ^= 0x01;
+    failures += Expect(loaded.Load(torn.data(), torn.size()) == OverlayIndexStatus::ChecksumMismatch && loaded.Empty(),
+                       "torn payload");
+    failures += Expect(loaded.Load(bytes.data(), bytes.size() - 1) == OverlayIndexStatus::ChecksumMismatch,
+                       "truncated image");
+    failures += Expect(loaded.Load(bytes.data(), 12) == OverlayIndexStatus::TooSmall, "short image");
+    const std::vector<uint8_t> overlay = BuildOverlayIndexImage({u"c:\\work"}, 1);
+    failures += Expect(loaded.Load(overlay.data(), overlay.size()) == OverlayIndexStatus::BadMagic,
+                       "overlay index rejected");
+    failures += Expect(!loaded.IsExcluded(u"c:\\work\\node_modules"), "rejected image excludes nothing");
+
+    fs::remove_all(dir);
+    std::printf("file round trip: %zu bytes, %zu queries; %d failures\n", bytes.size(), sample.queries.size(),
+                failures);
+    return failures;
+}
+
+int CheckThroughput(const BenchOptions &options)
+{
+    // Shaped like a user with many synced folders, each with a few excludes.
+    const size_t queryCount = options.quick ? 20000 : 200000;
+    const RandomCase sample = GenerateCase(23, options.quick ? 200 : 1000, 5, queryCount);
+    CStopwatch compileTimer;
+    CExclusionMatcher matcher;
+    matcher.Compile(sample.rules);
+    const double compileMs = compileTimer.ElapsedMs();
+
+    std::vector<std::u16string> normalized;
+    for (const std::wstring &query : sample.queries)
+    {
+        normalized.push_back(Normalized(query));
+    }
+
+    // Before: every folder's rules in turn, as the app checked them. The
+    // paths are normalized up front for both so only matching is timed.
+    std::vector<std::wstring> roots;
+    std::vector<std::vector<std::wstring>> patterns;
+    for (const ExclusionRule &rule : sample.rules)
+    {
+        roots.push_back(NormalizePath(rule.root));
+        patterns.push_back(SplitNames(NormalizePath(rule.pattern)));
+    }
+    std::vector<std::wstring> wide;
+    for (const std::wstring &query : sample.queries)
+    {
+        wide.push_back(NormalizePath(query));
+    }
+    size_t referenceHits = 0;
+    CStopwatch referenceTimer;
+    for (const std::wstring &query : wide)
+    {
+        for (size_t r = 0; r < roots.size(); r++)
+        {
+            if (query.size() > roots[r].size() && IsSameOrChildPath(query, roots[r]) &&
+                ReferenceNames(patterns[r], 0, SplitNames(query.substr(roots[r].size())), 0))
+            {
+                referenceHits++;
+                break;
+            }
+        }
+    }
+    const double referenceNs = referenceTimer.ElapsedMs() * 1e6 / queryCount;
+
+    size_t hits = 0;
+    CStopwatch matcherTimer;
+    for (const std::u16string &query : normalized)
+    {
+        hits += matcher.IsExcluded(query) ? 1 : 0;
+    }
+    const double matcherNs = matcherTimer.ElapsedMs() * 1e6 / queryCount;
+
+    int failures = Expect(hits == referenceHits, "same paths excluded");
+    std::printf("%zu rules (%u states, compiled in %.2f ms): %.0f ns per path checking each rule, %.0f ns compiled "
+                "(%.1fx); %d failures\n",
+                sample.rules.size(), matcher.View().StateCount(), compileMs, referenceNs, matcherNs,
+                referenceNs / matcherNs, failures);
+    ReportMetric(options, "exclusion_rules_ns", referenceNs, "ns");
+    ReportMetric(options, "exclusion_compiled_ns", matcherNs, "ns");
+    ReportMetric(options, "exclusion_compile_ms", compileMs, "ms");
+    return failures;
+}
+} // namespace
+
+int RunExclusionBench(const BenchOptions &options)
+{
+    int failures = CheckExamples();
+    failures += CheckParity(options);
+    failures += CheckFileRoundTrip();
+    failures += CheckThroughput(options);
+    return failures == 0 ? 0 : 1;
+}
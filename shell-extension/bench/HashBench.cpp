@@ -0,0 +1,297 @@
+// MD5 engine: RFC 1321 vectors, multi-buffer against streaming digests on
+// random lengths and chunkings, batch file hashing against per-file
+// digests (with unreadable paths), and throughput of small-file batches and
+// large files against one file at a time through 64 KiB reads, the way the
+// app's createReadStream hashing worked.
+
+#include "BenchUtil.h"
+#include "FileHasher.h"
+#include "Md5.h"
+#include "SequentialFileReader.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+namespace fs = std::filesystem;
+
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+Md5Digest StreamDigest(const std::string &data, CPathGenerator &gen)
+{
+    CMd5 md5;
+    for (size_t offset = 0; offset < data.size();)
+    {
+        const size_t chunk = std::min<size_t>(1 + gen.Next() % 150, data.size() - offset);
+        md5.Update(data.data() + offset, chunk);
+        offset += chunk;
+    }
+    return md5.Final();
+}
+
+std::string RandomBytes(CPathGenerator &gen, size_t size)
+{
+    std::string bytes(size, '\0');
+    for (char &byte : bytes)
+    {
+        byte = static_cast<char>(gen.Next());
+    }
+    return bytes;
+}
+
+int CheckVectors()
+{
+    static const struct
+    {
+        const char *message;
+        const char *hex;
+    } kVectors[] = {
+        {"", "d41d8cd98f00b204e9800998ecf8427e"},
+        {"a", "0cc175b9c0f1b6a831c399e269772661"},
+        {"abc", "900150983cd24fb0d6963f7d28e17f72"},
+        {"message digest", "f96b697d7cb7938d525a2f31aaf161d0"},
+        {"abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b"},
+        {"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "d174ab98d277d9f5a5611c2c9f419d9f"},
+        {"12345678901234567890123456789012345678901234567890123456789012345678901234567890",
+         "57edf4a22be3c955ac49da2e2107b67a"},
+    };
+
+    int failures = 0;
+    std::vector<std::string_view> messages;
+    for (const auto &vector : kVectors)
+    {
+        CMd5 md5;
+        md5.Update(vector.message, std::strlen(vector.message));
+        failures += Expect(md5.Final().Hex() == vector.hex, "streaming RFC 1321 vector");
+        messages.push_back(vector.message);
+    }
+    std::vector<Md5Digest> digests(messages.size());
+    HashMd5Many(messages.data(), messages.size(), digests.data());
+    for (size_t i = 0; i < messages.size(); i++)
+    {
+        failures += Expect(digests[i].Hex() == kVectors[i].hex, "multi-buffer RFC 1321 vector");
+    }
+    std::printf("RFC 1321 vectors: %zu lanes; %d failures\n", Md5Lanes(), failures);
+    return failures;
+}
+
+int CheckMultiBufferParity(const BenchOptions &options)
+{
+    // Lengths around the one- and two-block padding edges, and mixed sizes so
+    // lanes finish at different blocks.
+    CPathGenerator gen(51);
+    const size_t rounds = options.quick ? 200 : 2000;
+    size_t mismatches = 0;
+    size_t messages = 0;
+    for (size_t round = 0; round < rounds; round++)
+    {
+        const size_t count = 1 + gen.Next() % 23;
+        std::vector<std::string> data;
+        for (size_t i = 0; i < count; i++)
+        {
+            const size_t size = (gen.Next() % 4 == 0) ? gen.Next() % 5000 : 48 + gen.Next() % 90;
+            data.push_back(RandomBytes(gen, size));
+        }
+        std::vector<std::string_view> views(data.begin(), data.end());
+        std::vector<Md5Digest> digests(count);
+        HashMd5Many(views.data(), count, digests.data());
+        for (size_t i = 0; i < count; i++)
+        {
+            mismatches += digests[i] == StreamDigest(data[i], gen) ? 0 : 1;
+        }
+        messages += count;
+    }
+    const int failures = Expect(mismatches == 0, "multi-buffer digests match streaming ones");
+    std::printf("multi-buffer parity: %zu messages in %zu batches; %d failures\n", messages, rounds, failures);
+    return failures;
+}
+
+void WriteBytes(const fs::path &path, const std::string &bytes)
+{
+    std::ofstream out(path, std::ios::binary);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+// One file at a time through 64 KiB reads, as createReadStream fed the hash.
+Md5Digest ReferenceFileDigest(const std::string &path, bool &ok)
+{
+    static char buffer[64 * 1024];
+    CMd5 md5;
+    ok = ReadFileSequential(
+        fs::u8path(path), buffer, sizeof(buffer),
+        [](const char *data, size_t size, void *context) { static_cast<CMd5 *>(context)->Update(data, size); }, &md5);
+    return md5.Final();
+}
+
+struct FileSet
+{
+    std::vector<std::string> paths;
+    uint64_t bytes = 0;
+};
+
+FileSet WriteFiles(const fs::path &dir, CPathGenerator &gen, size_t count, size_t minSize, size_t maxSize)
+{
+    FileSet set;
+    fs::create_directories(dir);
+    for (size_t i = 0; i < count; i++)
+    {
+        const size_t size = minSize + gen.Next() % (maxSize - minSize + 1);
+        const fs::path path = dir / ("file-" + std::to_string(i) + ".bin");
+        WriteBytes(path, RandomBytes(gen, size));
+        set.paths.push_back(path.u8string());
+        set.bytes += size;
+    }
+    return set;
+}
+
+int CheckFiles(const fs::path &root)
+{
+    CPathGenerator gen(52);
+    FileSet set = WriteFiles(root / "mixed", gen, 60, 0, 300 * 1024);
+    set.paths.insert(set.paths.begin() + 7, (root / "missing.bin").u8string());
+    set.paths.push_back((root / "mixed").u8string()); // A directory
+
+    int failures = 0;
+    for (unsigned threads : {1u, 3u, 0u})
+    {
+        CFileHasher hasher;
+        FileHashOptions options;
+        options.threads = threads;
+        std::vector<FileHashResult> results;
+        FileHashTotals totals;
+        hasher.Hash(set.paths, options, results, totals);
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < set.paths.size(); i++)
+        {
+            bool ok = false;
+            const Md5Digest want = ReferenceFileDigest(set.paths[i], ok);
+            mismatches += (results[i].ok != ok || (ok && !(results[i].digest == want))) ? 1 : 0;
+        }
+        failures += Expect(mismatches == 0, "file digests match one-at-a-time hashing");
+        failures += Expect(totals.files == 60 && totals.failed == 2 && totals.bytes == set.bytes, "totals");
+        failures += Expect(totals.multiBufferFiles > 0 && totals.multiBufferFiles < totals.files,
+                           "small files multi-buffer, large ones streamed");
+    }
+
+    // A Cancel while the batch is still queued is not lost when it starts.
+    CFileHasher cancelled;
+    std::vector<FileHashResult> results;
+    FileHashTotals totals;
+    cancelled.Cancel();
+    cancelled.Hash(set.paths, FileHashOptions(), results, totals);
+    failures += Expect(totals.files == 0 && results.size() == set.paths.size() && !results[0].ok,
+                       "cancel before start");
+    cancelled.Reset();
+    cancelled.Hash(set.paths, FileHashOptions(), results, totals);
+    failures += Expect(totals.files == 60, "reset hasher runs again");
+
+    std::printf("file batches: %zu paths, 2 unreadable; %d failures\n", set.paths.size(), failures);
+    return failures;
+}
+
+int TimeFiles(const BenchOptions &options, const char *label, const FileSet &set)
+{
+    CStopwatch referenceTimer;
+    size_t readable = 0;
+    for (const std::string &path : set.paths)
+    {
+        bool ok = false;
+        ReferenceFileDigest(path, ok);
+        readable += ok ? 1 : 0;
+    }
+    const double referenceMs = referenceTimer.ElapsedMs();
+
+    CFileHasher hasher;
+    std::vector<FileHashResult> results;
+    FileHashTotals totals;
+    hasher.Hash(set.paths, FileHashOptions(), results, totals);
+
+    const double mb = static_cast<double>(set.bytes) / (1024.0 * 1024.0);
+    const int failures = Expect(readable == set.paths.size() && totals.files == set.paths.size(), "timed batch");
+    std::printf("%s: %zu files, %.1f MiB: %.0f MiB/s one at a time, %.0f MiB/s batched on %u threads "
+                "(%llu multi-buffer); %d failures\n",
+                label, set.paths.size(), mb, mb / (referenceMs / 1000.0), mb / (totals.elapsedMs / 1000.0),
+                totals.threads, static_cast<unsigned long long>(totals.multiBufferFiles), failures);
+    ReportMetric(options, std::string("md5_") + label + "_reference_mibps", mb / (referenceMs / 1000.0), "MiB/s");
+    ReportMetric(options, std::string("md5_") + label + "_batch_mibps", mb / (totals.elapsedMs / 1000.0), "MiB/s");
+    return failures;
+}
+
+int CheckKernelThroughput(const BenchOptions &options)
+{
+    // In-memory small messages: the hashing alone, no reads.
+    CPathGenerator gen(53);
+    const size_t count = options.quick ? 2000 : 20000;
+    std::vector<std::string> data;
+    for (size_t i = 0; i < count; i++)
+    {
+        data.push_back(RandomBytes(gen, 512 + gen.Next() % 8192));
+    }
+    size_t bytes = 0;
+    for (const std::string &message : data)
+    {
+        bytes += message.size();
+    }
+
+    std::vector<Md5Digest> scalar(count);
+    CStopwatch scalarTimer;
+    for (size_t i = 0; i < count; i++)
+    {
+        CMd5 md5;
+        md5.Update(data[i].data(), data[i].size());
+        scalar[i] = md5.Final();
+    }
+    const double scalarMs = scalarTimer.ElapsedMs();
+
+    std::vector<std::string_view> views(data.begin(), data.end());
+    std::vector<Md5Digest> many(count);
+    CStopwatch manyTimer;
+    for (size_t begin = 0; begin < count; begin += 16)
+    {
+        const size_t batch = std::min<size_t>(16, count - begin);
+        HashMd5Many(views.data() + begin, batch, many.data() + begin);
+    }
+    const double manyMs = manyTimer.ElapsedMs();
+
+    const int failures = Expect(scalar == many, "kernel digests agree");
+    const double mb = static_cast<double>(bytes) / (1024.0 * 1024.0);
+    std::printf("kernel, %zu messages of 0.5-8.5 KiB: %.0f MiB/s one at a time, %.0f MiB/s on %zu lanes (%.1fx); "
+                "%d failures\n",
+                count, mb / (scalarMs / 1000.0), mb / (manyMs / 1000.0), Md5Lanes(), scalarMs / manyMs, failures);
+    ReportMetric(options, "md5_scalar_mibps", mb / (scalarMs / 1000.0), "MiB/s");
+    ReportMetric(options, "md5_multibuffer_mibps", mb / (manyMs / 1000.0), "MiB/s");
+    return failures;
+}
+} // namespace
+
+int RunHashBench(const BenchOptions &options)
+{
+    const fs::path root = fs::temp_directory_path() / "rrightclickrr-bench-md5";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root);
+
+    int failures = CheckVectors();
+    failures += CheckMultiBufferParity(options);
+    failures += CheckKernelThroughput(options);
+    failures += CheckFiles(root);
+
+    CPathGenerator gen(54);
+    const FileSet small = WriteFiles(root / "small", gen, options.quick ? 1000 : 20000, 256, 32 * 1024);
+    failures += TimeFiles(options, "small", small);
+    const FileSet large = WriteFiles(root / "large", gen, options.quick ? 4 : 16, 4 << 20, 16 << 20);
+    failures += TimeFiles(options, "large", large);
+
+    fs::remove_all(root, ec);
+    return failures;
+}
@@ -0,0 +1,222 @@
+// Binary overlay index: in-place lookups, round trip and torn-image detection
+
+#include "BenchUtil.h"
+#include "OverlayIndexFormat.h"
+#include "OverlayIndexWriter.h"
+#include "SyncedPathMatch.h"
+#include "SyncedPathTrie.h"
+#include "Utf8.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+std::u16string ToUtf16(const std::wstring &value)
+{
+    std::u16string units;
+    AppendWideAsUtf16(value, units);
+    return units;
+}
+
+std::string ToUtf8(const std::wstring &value)
+{
+    std::string utf8;
+    for (wchar_t ch : value)
+    {
+        const uint32_t cp = static_cast<uint32_t>(ch);
+        if (cp < 0x80)
+        {
+            utf8.push_back(static_cast<char>(cp));
+        }
+        else if (cp < 0x800)
+        {
+            utf8.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            utf8.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else
+        {
+            utf8.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            utf8.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            utf8.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+    return utf8;
+}
+
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+int CheckTornImages(const std::vector<uint8_t> &image)
+{
+    int failures = 0;
+    COverlayIndexView view;
+
+    std::vector<uint8_t> flipped = image;
+    flipped[flipped.size() / 2] ^= 0x5A;
+    failures += Expect(view.Open(flipped.data(), flipped.size()) == OverlayIndexStatus::ChecksumMismatch, "payload flip detected");
+
+    failures += Expect(view.Open(image.data(), image.size() - 4) == OverlayIndexStatus::ChecksumMismatch, "truncated image detected");
+
+    std::vector<uint8_t> header = image;
+    header[offsetof(OverlayIndexHeader, entryCount)] ^= 0x01;
+    failures += Expect(view.Open(header.data(), header.size()) == OverlayIndexStatus::ChecksumMismatch, "header flip detected");
+
+    failures += Expect(view.Open(image.data(), 16) == OverlayIndexStatus::TooSmall, "short image rejected");
+    failures += Expect(!view.IsOpen(), "rejected image leaves view closed");
+    return failures;
+}
+
+int CheckFileRoundTrip(const std::vector<std::wstring> &rawPaths, const CSyncedPathTrie &trie, const std::vector<std::wstring> &queries)
+{
+    const std::filesystem::path file = std::filesystem::temp_directory_path() / "rrightclickrr-bench-synced-paths.idx";
+    std::error_code ec;
+    std::filesystem::remove(file, ec);
+
+    std::vector<std::string> utf8Paths;
+    for (const std::wstring &path : rawPaths)
+    {
+        utf8Paths.push_back(ToUtf8(path));
+    }
+
+    int failures = 0;
+    uint64_t generation = 0;
+    failures += Expect(WriteOverlayIndex(file, utf8Paths, generation) && generation == 1, "first write is generation 1");
+    failures += Expect(WriteOverlayIndex(file, utf8Paths, generation) && generation == 2, "rewrite bumps generation");
+
+    std::ifstream in(file, std::ios::binary);
+    const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    COverlayIndexView view;
+    failures += Expect(view.Open(bytes.data(), bytes.size()) == OverlayIndexStatus::Ok, "written file opens");
+    failures += Expect(view.Generation() == 2, "header carries generation");
+    failures += Expect(view.SourceCount() == utf8Paths.size(), "header records the source path count");
+    failures += Expect(view.EntryCount() < view.SourceCount(), "writer reduces to covering roots");
+
+    for (const std::wstring &query : queries)
+    {
+        if (view.Matches(ToUtf16(query)) != trie.Matches(query))
+        {
+            failures += Expect(false, "file round trip lookup parity");
+            break;
+        }
+    }
+
+    std::filesystem::remove(file, ec);
+    return failures;
+}
+} // namespace
+
+int RunIndexFormatBench(const BenchOptions &options)
+{
+    const size_t folderCount = options.quick ? 200 : 10000;
+    const size_t filesPerFolder = 10;
+    const size_t queryCount = options.quick ? 5000 : 20000;
+
+    CPathGenerator gen(4321);
+    const SyntheticIndex index = GenerateSyncedIndex(gen, folderCount, filesPerFolder);
+    std::vector<std::wstring> roots;
+    std::vector<std::u16string> units;
+    size_t textBytes = 0;
+    for (const std::wstring &path : index.rawPaths)
+    {
+        roots.push_back(NormalizePath(path));
+        units.push_back(ToUtf16(roots.back()));
+        textBytes += path.size() + 1;
+    }
+
+    std::vector<std::wstring> queries;
+    for (const std::wstring &query : GenerateQueries(gen, index, queryCount))
+    {
+        queries.push_back(NormalizePath(query));
+    }
+    // Edge roots mixed into a small index must agree as well.
+    const std::vector<std::wstring> edgeRoots = {L"c:\\", L"\\\\server\\share\\", L"ab\\", L"x", L"e:\\a\\\\b"};
+    const std::vector<std::wstring> edgeQueries = {
+        L"c:", L"c:\\", L"c:\\x", L"\\\\server\\share", L"\\\\server\\share\\a", L"ab", L"ab\\",
+        L"ab\\c", L"x", L"x\\y", L"xy", L"e:\\a\\\\b", L"e:\\a\\\\b\\c", L"e:\\a\\b", L"e:\\a",
+    };
+
+    int failures = 0;
+
+    CSyncedPathTrie edgeTrie;
+    edgeTrie.Build(edgeRoots);
+    std::vector<std::u16string> edgeUnits;
+    for (const std::wstring &root : edgeRoots)
+    {
+        edgeUnits.push_back(ToUtf16(root));
+    }
+    const std::vector<uint8_t> edgeImage = BuildOverlayIndexImage(edgeUnits, 1);
+    COverlayIndexView edgeView;
+    failures += Expect(edgeView.Open(edgeImage.data(), edgeImage.size()) == OverlayIndexStatus::Ok, "edge image opens");
+    for (const std::wstring &query : edgeQueries)
+    {
+        if (edgeView.Matches(ToUtf16(query)) != edgeTrie.Matches(query))
+        {
+            std::fprintf(stderr, "  edge mismatch: \"%ls\"\n", query.c_str());
+            failures++;
+        }
+    }
+
+    CStopwatch buildTimer;
+    const std::vector<uint8_t> image = BuildOverlayIndexImage(units, 7);
+    const double buildMs = buildTimer.ElapsedMs();
+
+    CStopwatch openTimer;
+    COverlayIndexView view;
+    const OverlayIndexStatus status = view.Open(image.data(), image.size());
+    const double openMs = openTimer.ElapsedMs();
+    failures += Expect(status == OverlayIndexStatus::Ok, "image opens");
+    failures += Expect(view.Generation() == 7, "generation preserved");
+
+    CSyncedPathTrie trie;
+    trie.Build(roots);
+
+    // Every stored entry must be found exactly, and lookups must agree with
+    // the trie (itself verified against the linear matcher).
+    for (const std::wstring &root : roots)
+    {
+        if (!view.Contains(ToUtf16(root)))
+        {
+            failures += Expect(false, "every entry is found");
+            break;
+        }
+    }
+
+    std::vector<std::u16string> queryUnits;
+    int mismatches = 0;
+    for (const std::wstring &query : queries)
+    {
+        queryUnits.push_back(ToUtf16(query));
+        mismatches += view.Matches(queryUnits.back()) != trie.Matches(query) ? 1 : 0;
+    }
+    failures += mismatches;
+
+    const int rounds = options.quick ? 1 : 50;
+    size_t hits = 0;
+    CStopwatch lookupTimer;
+    for (int round = 0; round < rounds; round++)
+    {
+        for (const std::u16string &query : queryUnits)
+        {
+            hits += view.Matches(query) ? 1 : 0;
+        }
+    }
+    const double lookupMs = lookupTimer.ElapsedMs() / rounds;
+
+    failures += CheckTornImages(image);
+    failures += CheckFileRoundTrip(index.rawPaths, trie, queries);
+
+    std::printf("entries: %u, image %zu bytes (%.1f bytes/entry, text ~%zu bytes)\n",
+                view.EntryCount(), image.size(), static_cast<double>(image.size()) / view.EntryCount(), textBytes);
+    std::printf("build %.2f ms, open+verify %.3f ms\n", buildMs, openMs);
+    std::printf("in-place lookup: %.3f us/lookup (%zu hits)\n", lookupMs * 1000.0 / queryUnits.size(), hits / rounds);
+    std::printf("parity: %zu queries, %d mismatches\n", queries.size(), mismatches);
+    return failures == 0 ? 0 : 1;
+}
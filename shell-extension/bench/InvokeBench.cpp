@@ -0,0 +1,207 @@
+// Invoke queue: what queuing costs the thread Explorer's menu waits on while
+// the worker is stuck on a slow launch, repeat clicks coalesced, order,
+// back-pressure and shutdown.
+
+#include "BenchUtil.h"
+#include "InvokeQueue.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+InvokeRequest MakeRequest(BatchMode mode, std::vector<std::wstring> paths)
+{
+    InvokeRequest request;
+    request.mode = mode;
+    request.paths = std::move(paths);
+    return request;
+}
+
+// Records handled requests; each one takes delayMs, like a launch held up by
+// a slow disk or a virus scanner.
+struct DispatchLog
+{
+    std::mutex mutex;
+    std::vector<InvokeRequest> handled;
+    std::atomic<int> delayMs{0};
+    std::atomic<int> coalesced{0};
+
+    CInvokeQueue::Handler Handler()
+    {
+        return [this](const InvokeRequest &request) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs.load()));
+            std::lock_guard<std::mutex> lock(mutex);
+            handled.push_back(request);
+        };
+    }
+
+    CInvokeQueue::CoalescedHandler Coalesced()
+    {
+        return [this](const InvokeRequest &) { coalesced.fetch_add(1); };
+    }
+
+    size_t Count()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return handled.size();
+    }
+};
+
+CInvokeQueue::Options Window(uint32_t coalesceMs)
+{
+    CInvokeQueue::Options options;
+    options.coalesceMs = coalesceMs;
+    return options;
+}
+
+int CheckEnqueueLatency(const BenchOptions &options)
+{
+    DispatchLog log;
+    log.delayMs = 20;
+    CInvokeQueue queue;
+    CInvokeQueue::Options queueOptions = Window(0);
+    queueOptions.maxPending = 100000;
+    int failures = Expect(queue.Start(log.Handler(), log.Coalesced(), queueOptions), "queue starts");
+
+    // A selection of a few items, copied the way Invoke builds it.
+    CPathGenerator gen(19);
+    const int requests = options.quick ? 2000 : 20000;
+    std::vector<InvokeRequest> prepared;
+    for (int i = 0; i < requests; i++)
+    {
+        prepared.push_back(MakeRequest(BatchMode::Sync, {gen.Path(3), gen.Path(4), gen.Path(2)}));
+    }
+
+    std::vector<double> samples;
+    for (InvokeRequest &request : prepared)
+    {
+        CStopwatch timer;
+        failures += Expect(queue.Enqueue(std::move(request)) == InvokeQueueResult::Queued, "queued");
+        samples.push_back(timer.ElapsedMs() * 1e6);
+    }
+    // The worker is still on its first few 20 ms launches.
+    failures += Expect(log.Count() < 10, "enqueue does not wait for dispatch");
+    queue.Stop();
+
+    std::sort(samples.begin(), samples.end());
+    const double p50 = Percentile(samples, 50);
+    const double p99 = Percentile(samples, 99);
+    failures += Expect(p99 < 1e6, "enqueue stays under a millisecond");
+    std::printf("%d requests queued behind 20 ms launches: p50 %.0f ns, p99 %.0f ns, max %.0f ns; %d failures\n",
+                requests, p50, p99, samples.back(), failures);
+    ReportMetric(options, "enqueue_p50", p50, "ns");
+    ReportMetric(options, "enqueue_p99", p99, "ns");
+    return failures;
+}
+
+int CheckCoalescing()
+{
+    DispatchLog log;
+    log.delayMs = 50;
+    CInvokeQueue queue;
+    int failures = Expect(queue.Start(log.Handler(), log.Coalesced(), Window(200)), "queue starts");
+
+    // Clicked again and again while the first launch is slow; spelling and
+    // order of the selection do not matter.
+    queue.Enqueue(MakeRequest(BatchMode::Sync, {L"C:\\Work", L"D:\\Music"}));
+    queue.Enqueue(MakeRequest(BatchMode::Sync, {L"C:\\Work", L"D:\\Music"}));
+    queue.Enqueue(MakeRequest(BatchMode::Sync, {L"d:/music/", L"c:\\WORK"}));
+    queue.Enqueue(MakeRequest(BatchMode::Copy, {L"C:\\Work", L"D:\\Music"}));
+    queue.Enqueue(MakeRequest(BatchMode::Sync, {L"C:\\Work"}));
+    failures += Expect(queue.WaitIdle(2000), "burst drained");
+    failures += Expect(log.Count() == 3 && log.coalesced.load() == 2 && queue.CoalescedCount() == 2,
+                       "repeats dropped; other modes and selections run");
+
+    // Shortly after the run finished: still a repeat. After the window: a new
+    // command.
+    queue.Enqueue(MakeRequest(BatchMode::Sync, {L"C:\\Work"}));
+    queue.WaitIdle(2000);
+    failures += Expect(log.Count() == 3, "repeat within the window dropped");
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    queue.Enqueue(MakeRequest(BatchMode::Sync, {L"C:\\Work"}));
+    queue.WaitIdle(2000);
+    failures += Expect(log.Count() == 4, "same command after the window runs");
+
+    // A repeat queued while its twin ran stays a repeat even when another
+    // slow request finishes long after the window in between.
+    log.delayMs = 300;
+    queue.Enqueue(MakeRequest(BatchMode::GetUrl, {L"E:\\A"}));
+    queue.Enqueue(MakeRequest(BatchMode::GetUrl, {L"E:\\B"}));
+    queue.Enqueue(MakeRequest(BatchMode::GetUrl, {L"E:\\A"}));
+    queue.WaitIdle(3000);
+    failures += Expect(log.Count() == 6, "repeat queued during its twin dropped after a slow neighbour");
+
+    std::lock_guard<std::mutex> lock(log.mutex);
+    const bool ordered = log.handled.size() == 6 && log.handled[0].mode == BatchMode::Sync &&
+                         log.handled[1].mode == BatchMode::Copy && log.handled[2].paths.size() == 1 &&
+                         log.handled[4].paths[0] == L"E:\\A" && log.handled[5].paths[0] == L"E:\\B";
+    failures += Expect(ordered, "requests handled in the order queued");
+    std::printf("coalescing: %zu handled, %llu dropped as repeats; %d failures\n", log.handled.size(),
+                static_cast<unsigned long long>(queue.CoalescedCount()), failures);
+    return failures;
+}
+
+int CheckBackPressureAndStop()
+{
+    DispatchLog log;
+    log.delayMs = 100;
+    CInvokeQueue queue;
+    CInvokeQueue::Options options = Window(0);
+    options.maxPending = 4;
+    std::atomic<int> starts{0};
+    std::atomic<int> exits{0};
+    options.onThreadStart = [&]() { starts++; };
+    options.onThreadExit = [&]() { exits++; };
+    int failures = Expect(queue.Start(log.Handler(), log.Coalesced(), options), "queue starts");
+
+    queue.Enqueue(MakeRequest(BatchMode::Sync, {L"C:\\0"}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20)); // Worker busy with it
+    int queued = 0;
+    for (int i = 1; i <= 4; i++)
+    {
+        queued += queue.Enqueue(MakeRequest(BatchMode::Sync, {L"C:\\" + std::to_wstring(i)})) ==
+                          InvokeQueueResult::Queued
+                      ? 1
+                      : 0;
+    }
+    InvokeRequest extra = MakeRequest(BatchMode::Sync, {L"C:\\5"});
+    failures += Expect(queued == 4 && queue.Enqueue(std::move(extra)) == InvokeQueueResult::Full,
+                       "queue refuses past maxPending");
+    failures += Expect(extra.paths.size() == 1, "refused request left intact");
+
+    CStopwatch stopTimer;
+    queue.Stop();
+    const double stopMs = stopTimer.ElapsedMs();
+    failures += Expect(log.Count() == 1, "stop finishes the running request and drops the rest");
+    failures += Expect(stopMs < 200, "stop waits for one request at most");
+    failures += Expect(queue.Enqueue(std::move(extra)) == InvokeQueueResult::NotRunning && extra.paths.size() == 1,
+                       "stopped queue refuses");
+    failures += Expect(starts.load() == 1 && exits.load() == 1, "thread hooks run once each");
+
+    failures += Expect(queue.Start(log.Handler()) && queue.Enqueue(std::move(extra)) == InvokeQueueResult::Queued &&
+                           queue.WaitIdle(2000) && log.Count() == 2,
+                       "restart dispatches again");
+    queue.Stop();
+    std::printf("back-pressure: stop %.1f ms; %d failures\n", stopMs, failures);
+    return failures;
+}
+} // namespace
+
+int RunInvokeBench(const BenchOptions &options)
+{
+    int failures = CheckEnqueueLatency(options);
+    failures += CheckCoalescing();
+    failures += CheckBackPressureAndStop();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,319 @@
+// Shell command pipe: the request frame and its rejection of malformed
+// input, then, against the Unix-socket stand-in server, the round trip Invoke
+// makes to a running app timed against starting a process, and the timeouts
+// that decide when it falls back to one.
+
+#include "BenchUtil.h"
+#include "ShellCommandClient.h"
+#include "ShellCommandProtocol.h"
+#include "Utf8.h"
+#include <cstring>
+
+#ifndef _WIN32
+#include "ShellCommandServer.h"
+#include <filesystem>
+#include <mutex>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+namespace
+{
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+std::vector<std::string> ToUtf8(const std::vector<std::wstring> &paths)
+{
+    std::vector<std::string> utf8(paths.size());
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        AppendWideAsUtf8(paths[i], utf8[i]);
+    }
+    return utf8;
+}
+
+bool Decodes(const std::vector<uint8_t> &frame)
+{
+    ShellCommandRequest request;
+    return DecodeShellCommand(frame.data(), frame.size(), request);
+}
+
+// Overwrites a little-endian field of the frame.
+template <typename T>
+std::vector<uint8_t> Patched(std::vector<uint8_t> frame, size_t offset, T value)
+{
+    std::memcpy(frame.data() + offset, &value, sizeof(value));
+    return frame;
+}
+
+int CheckProtocol()
+{
+    // Past MAX_PATH * 2, where the old command line was cut off.
+    std::wstring longPath = L"C:\\Deep";
+    while (longPath.size() < 40000)
+    {
+        longPath += L"\\Folder with a long name";
+    }
+    const std::vector<std::wstring> paths = {L"C:\\Work", L"D:\\caf\u00e9 \"quoted\"", L"E:\\\U0001F600", longPath};
+
+    int failures = 0;
+    for (BatchMode mode : {BatchMode::Sync, BatchMode::Copy, BatchMode::GetUrl})
+    {
+        const std::vector<uint8_t> frame = EncodeShellCommand(mode, paths);
+        ShellCommandRequest request;
+        failures += Expect(DecodeShellCommand(frame.data(), frame.size(), request) && request.mode == mode &&
+                               request.paths == ToUtf8(paths),
+                           "round trip keeps mode, order and every byte of each path");
+    }
+
+    const std::vector<uint8_t> frame = EncodeShellCommand(BatchMode::Copy, {L"C:\\a", L"C:\\bc"});
+    failures += Expect(frame.size() == sizeof(ShellCommandHeader) + 4 + 4 + 4 + 5, "frame size");
+    failures += Expect(!Decodes(Patched<uint32_t>(frame, 0, 0x12345678)), "bad magic");
+    failures += Expect(!Decodes(Patched<uint16_t>(frame, 4, 2)), "unknown version");
+    failures += Expect(!Decodes(Patched<uint16_t>(frame, 6, 3)), "unknown mode");
+    failures += Expect(!Decodes(Patched<uint32_t>(frame, 8, 3)), "more paths than the payload holds");
+    failures += Expect(!Decodes(Patched<uint32_t>(frame, 8, 1)), "fewer paths than the payload holds");
+    failures += Expect(!Decodes(Patched<uint32_t>(frame, 12, kShellCommandMaxPayload + 1)), "oversized payload");
+    failures += Expect(!Decodes(Patched<uint32_t>(frame, 16, 100)), "path runs past the payload");
+    failures += Expect(!Decodes(EncodeShellCommand(BatchMode::Sync, {L"C:\\a", L""})), "empty path");
+
+    std::vector<uint8_t> extended = frame;
+    extended.push_back(0);
+    failures += Expect(!Decodes(extended), "trailing byte");
+    int truncations = 0;
+    for (size_t size = 0; size < frame.size(); size++)
+    {
+        ShellCommandRequest request;
+        truncations += DecodeShellCommand(frame.data(), size, request) ? 1 : 0;
+    }
+    failures += Expect(truncations == 0, "every truncation rejected");
+
+    ShellCommandStatus status = ShellCommandStatus::Rejected;
+    const ShellCommandReply accepted = MakeShellCommandReply(ShellCommandStatus::Accepted);
+    failures += Expect(ReadShellCommandReply(&accepted, sizeof(accepted), status) &&
+                           status == ShellCommandStatus::Accepted,
+                       "reply round trip");
+    const ShellCommandReply unknown = {kShellCommandReplyMagic, 9};
+    const ShellCommandReply foreign = {kShellCommandMagic, 0};
+    failures += Expect(!ReadShellCommandReply(&unknown, sizeof(unknown), status) &&
+                           !ReadShellCommandReply(&foreign, sizeof(foreign), status),
+                       "unknown replies rejected");
+
+    std::printf("protocol: %zu-byte frame for a %zu-character path; %d failures\n",
+                EncodeShellCommand(BatchMode::Sync, {longPath}).size(), longPath.size(), failures);
+    return failures;
+}
+
+#ifndef _WIN32
+namespace fs = std::filesystem;
+
+std::string BenchEndpoint(const char *name)
+{
+    return (fs::temp_directory_path() / (std::string("rrightclickrr-bench-") + name + "-" +
+                                         std::to_string(getpid()) + ".sock"))
+        .string();
+}
+
+// A socket file nobody listens on, as a crashed app leaves behind, or, with
+// listening set, a server that accepts connections but never answers.
+int BindRawSocket(const std::string &endpoint, bool listening)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, endpoint.data(), endpoint.size());
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        (listening && listen(fd, 4) != 0))
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Records what the server was handed, as the app's queue would.
+struct ReceivedLog
+{
+    std::mutex mutex;
+    std::vector<ShellCommandRequest> requests;
+    ShellCommandStatus answer = ShellCommandStatus::Accepted;
+
+    CShellCommandServer::Handler Handler()
+    {
+        return [this](const ShellCommandRequest &request) {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.push_back(request);
+            return answer;
+        };
+    }
+};
+
+int CheckServer()
+{
+    const std::string endpoint = BenchEndpoint("server");
+    ReceivedLog log;
+    CShellCommandServer server;
+    int failures = Expect(server.Start(endpoint, log.Handler()), "server starts");
+
+    const std::vector<std::wstring> paths = {L"C:\\Work", L"D:\\Music"};
+    failures += Expect(SendShellCommand(endpoint, EncodeShellCommand(BatchMode::Sync, paths), 1000) ==
+                           ShellCommandResult::Accepted,
+                       "request accepted");
+    {
+        std::lock_guard<std::mutex> lock(log.mutex);
+        failures += Expect(log.requests.size() == 1 && log.requests[0].mode == BatchMode::Sync &&
+                               log.requests[0].paths == ToUtf8(paths),
+                           "server handed the request as sent");
+        log.answer = ShellCommandStatus::Rejected;
+    }
+    failures += Expect(SendShellCommand(endpoint, EncodeShellCommand(BatchMode::Copy, paths), 1000) ==
+                           ShellCommandResult::Rejected,
+                       "rejection reported");
+
+    std::vector<uint8_t> garbage = EncodeShellCommand(BatchMode::Copy, paths);
+    garbage[0] ^= 0xFF;
+    failures += Expect(SendShellCommand(endpoint, garbage, 1000) == ShellCommandResult::Rejected &&
+                           server.MalformedCount() == 1 && server.RequestCount() == 2,
+                       "malformed frame rejected without reaching the handler");
+
+    // A second server must not take over a live endpoint.
+    CShellCommandServer second;
+    failures += Expect(!second.Start(endpoint, log.Handler()), "live endpoint not replaced");
+
+    CStopwatch stopTimer;
+    server.Stop();
+    const double stopMs = stopTimer.ElapsedMs();
+    failures += Expect(stopMs < 100 && !fs::exists(endpoint), "stop is prompt and removes the endpoint");
+
+    std::printf("server: %llu requests, %llu malformed, stop %.2f ms; %d failures\n",
+                static_cast<unsigned long long>(server.RequestCount()),
+                static_cast<unsigned long long>(server.MalformedCount()), stopMs, failures);
+    return failures;
+}
+
+// What falling back costs: nothing when no app is running, the timeout when
+// one is wedged.
+int CheckFallback(const BenchOptions &options)
+{
+    const std::vector<uint8_t> frame = EncodeShellCommand(BatchMode::Sync, {L"C:\\Work"});
+    const std::string missing = BenchEndpoint("missing");
+    CStopwatch missingTimer;
+    int failures = Expect(SendShellCommand(missing, frame, 150) == ShellCommandResult::NoServer, "no server");
+    const double missingMs = missingTimer.ElapsedMs();
+    failures += Expect(missingMs < 20, "no server is known at once");
+
+    const std::string stale = BenchEndpoint("stale");
+    const int staleFd = BindRawSocket(stale, false);
+    failures += Expect(staleFd >= 0, "stale socket file created");
+    close(staleFd);
+    failures += Expect(SendShellCommand(stale, frame, 150) == ShellCommandResult::NoServer, "stale socket file");
+    ReceivedLog log;
+    CShellCommandServer server;
+    failures += Expect(server.Start(stale, log.Handler()) &&
+                           SendShellCommand(stale, frame, 1000) == ShellCommandResult::Accepted,
+                       "stale socket file replaced");
+    server.Stop();
+
+    const std::string hung = BenchEndpoint("hung");
+    const int hungFd = BindRawSocket(hung, true);
+    const uint32_t timeoutMs = 100;
+    CStopwatch hungTimer;
+    failures += Expect(SendShellCommand(hung, frame, timeoutMs) == ShellCommandResult::TimedOut, "hung server");
+    const double hungMs = hungTimer.ElapsedMs();
+    failures += Expect(hungMs >= timeoutMs - 5 && hungMs < timeoutMs + 100, "hung server costs the timeout");
+    close(hungFd);
+    unlink(hung.c_str());
+
+    std::printf("fallback: no server %.3f ms, hung server %.1f ms (timeout %u ms); %d failures\n", missingMs, hungMs,
+                timeoutMs, failures);
+    ReportMetric(options, "no_server", missingMs, "ms");
+    return failures;
+}
+
+// Pipe round trip against starting a process. /bin/true is the cheapest
+// launch there is; the Electron app forwarding a command costs far more.
+int CheckLatency(const BenchOptions &options)
+{
+    const std::string endpoint = BenchEndpoint("latency");
+    ReceivedLog log;
+    CShellCommandServer server;
+    int failures = Expect(server.Start(endpoint, log.Handler()), "server starts");
+
+    const std::vector<uint8_t> frame = EncodeShellCommand(BatchMode::Sync, {L"C:\\Users\\me\\Documents\\Projects"});
+    const int sends = options.quick ? 200 : 2000;
+    std::vector<double> piped;
+    int accepted = 0;
+    for (int i = 0; i < sends; i++)
+    {
+        CStopwatch timer;
+        accepted += SendShellCommand(endpoint, frame, 1000) == ShellCommandResult::Accepted ? 1 : 0;
+        piped.push_back(timer.ElapsedMs() * 1000);
+    }
+    server.Stop();
+    failures += Expect(accepted == sends, "every request accepted");
+
+    const int launches = options.quick ? 20 : 200;
+    std::vector<double> launched;
+    char *const argv[] = {const_cast<char *>("/bin/true"), nullptr};
+    for (int i = 0; i < launches; i++)
+    {
+        CStopwatch timer;
+        pid_t child;
+        int status = 0;
+        if (posix_spawn(&child, "/bin/true", nullptr, nullptr, argv, environ) != 0 ||
+            waitpid(child, &status, 0) != child)
+        {
+            break;
+        }
+        launched.push_back(timer.ElapsedMs() * 1000);
+    }
+
+    std::sort(piped.begin(), piped.end());
+    std::sort(launched.begin(), launched.end());
+    const double pipedP50 = Percentile(piped, 50);
+    const double pipedP99 = Percentile(piped, 99);
+    ReportMetric(options, "pipe_p50", pipedP50, "us");
+    ReportMetric(options, "pipe_p99", pipedP99, "us");
+    if (launched.empty())
+    {
+        std::printf("pipe: p50 %.1f us, p99 %.1f us; process launch unavailable; %d failures\n", pipedP50, pipedP99,
+                    failures);
+        return failures;
+    }
+
+    const double launchP50 = Percentile(launched, 50);
+    const double launchP99 = Percentile(launched, 99);
+    failures += Expect(pipedP50 < launchP50, "pipe round trip beats a process launch");
+    std::printf("pipe: p50 %.1f us, p99 %.1f us; process launch: p50 %.1f us, p99 %.1f us (%.0fx); %d failures\n",
+                pipedP50, pipedP99, launchP50, launchP99, launchP50 / pipedP50, failures);
+    ReportMetric(options, "launch_p50", launchP50, "us");
+    ReportMetric(options, "launch_p99", launchP99, "us");
+    return failures;
+}
+#endif
+} // namespace
+
+int RunIpcBench(const BenchOptions &options)
+{
+    int failures = CheckProtocol();
+#ifndef _WIN32
+    failures += CheckServer();
+    failures += CheckFallback(options);
+    failures += CheckLatency(options);
+#else
+    (void)options;
+#endif
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,348 @@
+// Overlay journal: writer round trip, torn tails, and a replica of the
+// overlay handler's incremental apply checked against a full rebuild
+
+#include "BenchUtil.h"
+#include "OverlayIndexWriter.h"
+#include "OverlayJournal.h"
+#include "SyncedPathMatch.h"
+#include "SyncedPathTrie.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+
+namespace
+{
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+std::string ToUtf8(const std::wstring &value)
+{
+    std::string utf8;
+    for (wchar_t ch : value)
+    {
+        utf8.push_back(static_cast<char>(ch)); // Generator paths are ASCII
+    }
+    return utf8;
+}
+
+std::vector<uint8_t> ReadAll(const std::filesystem::path &file)
+{
+    std::ifstream in(file, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Mirrors ApplyJournalTail in SyncOverlay.cpp: adds go into the layer, a
+// remove or a full layer compacts into a new trie base.
+class CJournalReplica
+{
+public:
+    CJournalReplica(const std::vector<std::wstring> &baseRoots, size_t layerLimit) : m_layerLimit(layerLimit)
+    {
+        m_base.Build(baseRoots);
+    }
+
+    // Applies whatever complete records data[m_offset, size) holds.
+    size_t Poll(const std::vector<uint8_t> &data, size_t size)
+    {
+        const size_t offset = m_offset ? m_offset : sizeof(OverlayJournalHeader);
+        if (size <= offset)
+        {
+            return 0;
+        }
+
+        std::vector<JournalRecord> records;
+        m_offset = offset + ParseOverlayJournalRecords(data.data() + offset, size - offset, m_nextSequence, records);
+
+        size_t applied = 0;
+        while (applied < records.size() && records[applied].op == JournalOp::Add && m_layer.Size() < m_layerLimit)
+        {
+            m_layer.Add(records[applied].path, [&](std::wstring_view path) { return m_base.Matches(path); });
+            applied++;
+        }
+        if (applied < records.size())
+        {
+            const std::vector<JournalRecord> pending(records.begin() + applied, records.end());
+            m_base.Build(CompactJournal(m_base.Roots(), m_layer, pending));
+            m_layer = CJournalLayer();
+            m_compactions++;
+        }
+        return records.size();
+    }
+
+    bool Matches(std::wstring_view path) const { return m_base.Matches(path) || m_layer.Matches(path); }
+
+    ParentVerdict Classify(std::wstring_view parentWithSeparator) const
+    {
+        const ParentVerdict verdict = ClassifyParent(m_base, parentWithSeparator);
+        return m_layer.Empty() ? verdict : CombineVerdicts(verdict, m_layer.Classify(parentWithSeparator));
+    }
+
+    size_t Offset() const { return m_offset; }
+    size_t Compactions() const { return m_compactions; }
+
+private:
+    CSyncedPathTrie m_base;
+    CJournalLayer m_layer;
+    size_t m_layerLimit;
+    size_t m_offset = 0;
+    uint64_t m_nextSequence = 1;
+    size_t m_compactions = 0;
+};
+
+bool ReferenceMatches(const std::set<std::wstring> &tracked, const std::wstring &path)
+{
+    return std::any_of(tracked.begin(), tracked.end(), [&](const std::wstring &root) { return IsSameOrChildPath(path, root); });
+}
+
+int CheckRecordCodec()
+{
+    int failures = 0;
+    std::vector<uint8_t> bytes = BuildOverlayJournalHeader(7);
+    AppendOverlayJournalRecord(bytes, 1, JournalOp::Add, u"c:\\a");
+    AppendOverlayJournalRecord(bytes, 2, JournalOp::Remove, u"c:\\b");
+    AppendOverlayJournalRecord(bytes, 4, JournalOp::Add, u"c:\\gap");
+
+    OverlayJournalHeader header = {};
+    failures += Expect(ParseOverlayJournalHeader(bytes.data(), bytes.size(), header) == OverlayJournalStatus::Ok, "header parses");
+    failures += Expect(header.baseGeneration == 7, "header keeps base generation");
+
+    uint64_t next = 1;
+    std::vector<JournalRecord> records;
+    const size_t consumed = ParseOverlayJournalRecords(bytes.data() + sizeof(header), bytes.size() - sizeof(header), next, records);
+    failures += Expect(records.size() == 2 && next == 3, "sequence gap stops the parse");
+    failures += Expect(records.size() == 2 && records[1].op == JournalOp::Remove && records[1].path == L"c:\\b", "records decode");
+
+    // Every truncation point inside the third record yields the first two.
+    std::vector<uint8_t> valid(bytes.begin(), bytes.begin() + sizeof(header) + consumed);
+    AppendOverlayJournalRecord(valid, 3, JournalOp::Add, u"c:\\third");
+    bool tornOk = true;
+    for (size_t size = sizeof(header) + consumed; size < valid.size(); size++)
+    {
+        next = 1;
+        records.clear();
+        tornOk &= ParseOverlayJournalRecords(valid.data() + sizeof(header), size - sizeof(header), next, records) == consumed;
+    }
+    failures += Expect(tornOk, "torn record is not trusted");
+
+    valid[valid.size() - 1] ^= 0x20;
+    next = 1;
+    records.clear();
+    failures += Expect(ParseOverlayJournalRecords(valid.data() + sizeof(header), valid.size() - sizeof(header), next, records) == consumed,
+                       "corrupt record is not trusted");
+
+    bytes[4] ^= 0x01;
+    failures += Expect(ParseOverlayJournalHeader(bytes.data(), bytes.size(), header) != OverlayJournalStatus::Ok, "header flip detected");
+    return failures;
+}
+
+int CheckWriter(const std::filesystem::path &index, const std::filesystem::path &journal)
+{
+    int failures = 0;
+    uint64_t generation = 0;
+    failures += Expect(WriteOverlayIndex(index, {"C:\\Base"}, generation), "index written");
+
+    COverlayJournalWriter writer;
+    uint64_t size = 0;
+    failures += Expect(writer.Reset(journal, generation), "journal reset");
+    failures += Expect(writer.Append(journal, generation, {}, {"C:/Docs/A", "D:\\X\\"}, size), "first append");
+    failures += Expect(size == std::filesystem::file_size(journal), "append reports file size");
+
+    // A torn append from a crashed writer is cut off by the next one.
+    {
+        std::ofstream out(journal, std::ios::binary | std::ios::app);
+        const char garbage[9] = {3, 0, 0, 0, 0, 0, 0, 0, 1};
+        out.write(garbage, sizeof(garbage));
+    }
+    COverlayJournalWriter restarted;
+    failures += Expect(restarted.Append(journal, generation, {"c:\\docs"}, {"C:\\Docs\\B"}, size), "append after torn tail");
+
+    const std::vector<uint8_t> bytes = ReadAll(journal);
+    failures += Expect(bytes.size() == size, "torn tail truncated");
+    OverlayJournalHeader header = {};
+    std::vector<JournalRecord> records;
+    uint64_t next = 1;
+    if (ParseOverlayJournalHeader(bytes.data(), bytes.size(), header) == OverlayJournalStatus::Ok)
+    {
+        failures += Expect(ParseOverlayJournalRecords(bytes.data() + sizeof(header), bytes.size() - sizeof(header), next, records) ==
+                               bytes.size() - sizeof(header),
+                           "every record valid");
+    }
+    failures += Expect(header.baseGeneration == generation, "journal names the index generation");
+    failures += Expect(records.size() == 4, "four records");
+    if (records.size() == 4)
+    {
+        failures += Expect(records[0].path == L"c:\\docs\\a" && records[1].path == L"d:\\x", "paths normalized");
+        failures += Expect(records[2].op == JournalOp::Remove && records[3].op == JournalOp::Add, "removes precede adds");
+    }
+
+    // A journal written for another index generation is started over.
+    failures += Expect(writer.Append(journal, generation + 1, {}, {"E:\\New"}, size), "append for new generation");
+    failures += Expect(size == sizeof(OverlayJournalHeader) + sizeof(OverlayJournalRecordHeader) + 2 * 6, "stale journal replaced");
+    return failures;
+}
+
+// Random track/untrack traffic through the writer; the replica tails the file
+// (sometimes mid-record) and must match the reference set at every step.
+int CheckReplicaParity(const std::filesystem::path &index, const std::filesystem::path &journal, size_t steps, size_t layerLimit,
+                       size_t &compactions)
+{
+    CPathGenerator gen(4242);
+    std::set<std::wstring> tracked;
+    std::vector<std::string> initial;
+    for (size_t i = 0; i < 40; i++)
+    {
+        const std::wstring path = gen.Path(1 + gen.Next() % 3);
+        tracked.insert(NormalizePath(path));
+        initial.push_back(ToUtf8(path));
+    }
+
+    uint64_t generation = 0;
+    int failures = Expect(WriteOverlayIndex(index, initial, generation), "parity index written");
+    COverlayJournalWriter writer;
+    failures += Expect(writer.Reset(journal, generation), "parity journal reset");
+
+    std::vector<std::wstring> baseRoots(tracked.begin(), tracked.end());
+    ReduceToCoveringRoots(baseRoots);
+    CJournalReplica replica(baseRoots, layerLimit);
+
+    int mismatches = 0;
+    for (size_t step = 0; step < steps; step++)
+    {
+        std::vector<std::string> adds;
+        std::vector<std::string> removes;
+        const unsigned action = gen.Next() % 10;
+        if (action < 6 || tracked.empty())
+        {
+            // trackSync / bulkTrackSync
+            for (size_t n = 1 + gen.Next() % 3; n > 0; n--)
+            {
+                const std::wstring path = NormalizePath(gen.Path(1 + gen.Next() % 4));
+                tracked.insert(path);
+                adds.push_back(ToUtf8(path));
+            }
+        }
+        else
+        {
+            auto victim = tracked.begin();
+            std::advance(victim, gen.Next() % tracked.size());
+            const std::wstring root = *victim;
+            if (action < 8)
+            {
+                // untrack: drop one key, re-add the tracked keys beneath it
+                tracked.erase(victim);
+                for (const std::wstring &key : tracked)
+                {
+                    if (key.size() > root.size() && IsSameOrChildPath(key, root))
+                    {
+                        adds.push_back(ToUtf8(key));
+                    }
+                }
+            }
+            else
+            {
+                // untrackUnderPath
+                for (auto it = tracked.begin(); it != tracked.end();)
+                {
+                    it = IsSameOrChildPath(*it, root) ? tracked.erase(it) : std::next(it);
+                }
+            }
+            removes.push_back(ToUtf8(root));
+        }
+
+        uint64_t size = 0;
+        failures += Expect(writer.Append(journal, generation, removes, adds, size), "parity append");
+
+        const std::vector<uint8_t> bytes = ReadAll(journal);
+        if (gen.Next() % 3 == 0 && bytes.size() > replica.Offset() + 1)
+        {
+            // Reader races the append and sees a partial tail first.
+            replica.Poll(bytes, replica.Offset() + 1 + gen.Next() % (bytes.size() - replica.Offset() - 1));
+        }
+        replica.Poll(bytes, bytes.size());
+
+        for (size_t q = 0; q < 20; q++)
+        {
+            const std::wstring query = NormalizePath(gen.Path(1 + gen.Next() % 5));
+            const bool expected = ReferenceMatches(tracked, query);
+            mismatches += replica.Matches(query) != expected ? 1 : 0;
+
+            const size_t slash = query.find_last_of(L'\\');
+            const ParentVerdict verdict = replica.Classify(std::wstring_view(query).substr(0, slash + 1));
+            mismatches += (verdict == ParentVerdict::Covered && !expected) || (verdict == ParentVerdict::Empty && expected) ? 1 : 0;
+        }
+    }
+
+    compactions = replica.Compactions();
+    failures += Expect(mismatches == 0, "replica matches the reference set");
+    return failures;
+}
+
+void ReportApplyCost(bool quick)
+{
+    CPathGenerator gen(515);
+    const SyntheticIndex index = GenerateSyncedIndex(gen, quick ? 2000 : 50000, 5);
+    std::vector<std::wstring> roots;
+    for (const std::wstring &path : index.rawPaths)
+    {
+        roots.push_back(NormalizePath(path));
+    }
+    ReduceToCoveringRoots(roots);
+    CSyncedPathTrie base;
+    base.Build(roots);
+
+    std::vector<std::wstring> adds;
+    for (size_t i = 0; i < 100; i++)
+    {
+        adds.push_back(NormalizePath(gen.Path(2 + gen.Next() % 4)));
+    }
+
+    CStopwatch layerTimer;
+    CJournalLayer layer;
+    for (const std::wstring &path : adds)
+    {
+        layer.Add(path, [&](std::wstring_view candidate) { return base.Matches(candidate); });
+    }
+    const double layerMs = layerTimer.ElapsedMs();
+
+    CStopwatch rebuildTimer;
+    std::vector<std::wstring> all = roots;
+    all.insert(all.end(), adds.begin(), adds.end());
+    ReduceToCoveringRoots(all);
+    CSyncedPathTrie rebuilt;
+    rebuilt.Build(all);
+    const double rebuildMs = rebuildTimer.ElapsedMs();
+
+    std::printf("100 adds over %zu roots: journal layer %.3f ms, full rebuild %.3f ms\n", roots.size(), layerMs, rebuildMs);
+}
+} // namespace
+
+int RunJournalBench(const BenchOptions &options)
+{
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    const std::filesystem::path index = dir / "rrightclickrr-bench-journal.idx";
+    const std::filesystem::path journal = dir / "rrightclickrr-bench-synced-paths.journal";
+
+    int failures = CheckRecordCodec();
+    failures += CheckWriter(index, journal);
+
+    size_t compactions = 0;
+    failures += CheckReplicaParity(index, journal, options.quick ? 300 : 3000, 8, compactions);
+    failures += Expect(compactions > 0, "compaction exercised");
+    std::printf("replica parity: %zu compactions, %d failures\n", compactions, failures);
+
+    ReportApplyCost(options.quick);
+
+    std::error_code ec;
+    std::filesystem::remove(index, ec);
+    std::filesystem::remove(journal, ec);
+    return failures == 0 ? 0 : 1;
+}
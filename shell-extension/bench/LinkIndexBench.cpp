@@ -0,0 +1,213 @@
+// Drive link index: file round trip through the app's writer, parity of the
+// nearest-synced-parent fallback with a reference scan, torn images, and the
+// cost of the lookup "Copy Google Drive Link" now does inside Explorer.
+
+#include "BenchUtil.h"
+#include "DriveLinkIndex.h"
+#include "OverlayIndexWriter.h"
+#include "SyncedPathMatch.h"
+#include "Utf8.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+namespace fs = std::filesystem;
+
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+std::string ToUtf8(const std::wstring &value)
+{
+    std::string utf8;
+    for (wchar_t ch : value)
+    {
+        utf8.push_back(static_cast<char>(ch)); // Generator paths are ASCII
+    }
+    return utf8;
+}
+
+std::u16string ToUtf16(const std::wstring &value)
+{
+    std::u16string units;
+    AppendWideAsUtf16(value, units);
+    return units;
+}
+
+std::vector<uint8_t> ReadWholeFile(const fs::path &file)
+{
+    std::ifstream in(file, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+std::string UrlFor(size_t i)
+{
+    return "https://drive.google.com/drive/folders/id" + std::to_string(i);
+}
+
+// Longest linked path the query equals or lies beneath, by brute force.
+const std::string *ReferenceFind(const std::vector<std::pair<std::wstring, std::string>> &links, const std::wstring &query,
+                                 bool &exact)
+{
+    const std::pair<std::wstring, std::string> *best = nullptr;
+    for (const auto &link : links)
+    {
+        if (IsSameOrChildPath(query, link.first) && (!best || link.first.size() > best->first.size()))
+        {
+            best = &link;
+        }
+    }
+    exact = best && best->first == query;
+    return best ? &best->second : nullptr;
+}
+
+int CheckEdgeCases()
+{
+    std::vector<DriveLinkEntry> entries = {
+        {u"c:\\", "root"},
+        {u"c:\\work", "old"},
+        {u"c:\\work", "new"},
+        {u"c:\\work\\a.txt", "file"},
+        {u"", "dropped"},
+        {u"d:\\empty", ""},
+    };
+    const std::vector<uint8_t> image = BuildDriveLinkImage(entries, 3);
+
+    CDriveLinkIndexView view;
+    int failures = Expect(view.Open(image.data(), image.size()) == OverlayIndexStatus::Ok, "image opens");
+    failures += Expect(view.EntryCount() == 3 && view.Generation() == 3, "duplicates and empty entries dropped");
+
+    DriveLink link;
+    failures += Expect(view.Find(u"c:\\work", link) && link.url == "new" && link.exact, "last duplicate wins");
+    failures += Expect(view.Find(u"c:\\work\\a.txt", link) && link.url == "file" && link.exact, "file link");
+    failures += Expect(view.Find(u"c:\\work\\b\\c.txt", link) && link.url == "new" && !link.exact &&
+                           link.matchedLength == 7,
+                       "nearest synced parent");
+    failures += Expect(view.Find(u"c:\\other", link) && link.url == "root", "drive root keeps its separator");
+    failures += Expect(!view.Find(u"d:\\empty\\x", link) && !view.Find(u"", link), "misses");
+    failures += Expect(view.Find(u"c:\\workshop", link) && link.url == "root", "sibling prefix is not a child");
+
+    // Torn and foreign images.
+    std::vector<uint8_t> torn = image;
+    torn.back() ^= 0x20;
+    failures += Expect(view.Open(torn.data(), torn.size()) == OverlayIndexStatus::ChecksumMismatch, "torn payload");
+    failures += Expect(view.Open(image.data(), image.size() - 1) == OverlayIndexStatus::ChecksumMismatch,
+                       "truncated image");
+    failures += Expect(view.Open(image.data(), 10) == OverlayIndexStatus::TooSmall, "short image");
+    const std::vector<uint8_t> overlay = BuildOverlayIndexImage({u"c:\\work"}, 1);
+    failures += Expect(view.Open(overlay.data(), overlay.size()) == OverlayIndexStatus::BadMagic, "overlay index rejected");
+    failures += Expect(!view.IsOpen() && !view.Find(u"c:\\work", link), "closed view answers nothing");
+
+    std::printf("edge cases: %d failures\n", failures);
+    return failures;
+}
+
+int CheckParity(const BenchOptions &options)
+{
+    const size_t folderCount = options.quick ? 200 : 2000;
+    CPathGenerator gen(16);
+    const SyntheticIndex index = GenerateSyncedIndex(gen, folderCount, options.quick ? 4 : 20);
+
+    // What SyncTracker hands the addon: raw paths and their links.
+    std::vector<std::string> paths;
+    std::vector<std::string> urls;
+    std::vector<std::pair<std::wstring, std::string>> reference;
+    for (size_t i = 0; i < index.rawPaths.size(); i++)
+    {
+        paths.push_back(ToUtf8(index.rawPaths[i]));
+        urls.push_back(UrlFor(i));
+        reference.emplace_back(NormalizePath(index.rawPaths[i]), urls.back());
+    }
+    // Later duplicates win, in the writer and the reference alike.
+    std::stable_sort(reference.begin(), reference.end(),
+                     [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+    std::vector<std::pair<std::wstring, std::string>> unique;
+    for (size_t i = 0; i < reference.size(); i++)
+    {
+        if (i + 1 == reference.size() || reference[i + 1].first != reference[i].first)
+        {
+            unique.push_back(reference[i]);
+        }
+    }
+
+    const fs::path dir = fs::temp_directory_path() / "rrightclickrr-bench-links";
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    const fs::path file = dir / "synced-links.idx";
+    fs::remove(file, ec);
+
+    uint64_t generation = 0;
+    int failures = Expect(WriteDriveLinkIndex(file, paths, urls, generation) && generation == 1, "first write");
+    CStopwatch writeTimer;
+    failures += Expect(WriteDriveLinkIndex(file, paths, urls, generation) && generation == 2, "generation advances");
+    const double writeMs = writeTimer.ElapsedMs();
+
+    const std::vector<uint8_t> image = ReadWholeFile(file);
+    fs::remove_all(dir, ec);
+    CDriveLinkIndexView view;
+    failures += Expect(view.Open(image.data(), image.size()) == OverlayIndexStatus::Ok, "written file opens");
+    failures += Expect(view.EntryCount() == unique.size(), "one entry per distinct path");
+
+    const std::vector<std::wstring> rawQueries = GenerateQueries(gen, index, options.quick ? 5000 : 50000);
+    std::vector<std::u16string> queries;
+    size_t mismatches = 0;
+    size_t hits = 0;
+    for (const std::wstring &raw : rawQueries)
+    {
+        const std::wstring normalized = NormalizePath(raw);
+        queries.push_back(ToUtf16(normalized));
+
+        bool exact = false;
+        const std::string *expected = ReferenceFind(unique, normalized, exact);
+        DriveLink link;
+        const bool found = view.Find(queries.back(), link);
+        hits += found ? 1 : 0;
+        if (found != (expected != nullptr) || (found && (link.url != *expected || link.exact != exact)))
+        {
+            mismatches++;
+        }
+    }
+    failures += Expect(mismatches == 0, "lookups match the reference scan");
+
+    CStopwatch lookupTimer;
+    size_t found = 0;
+    const int rounds = options.quick ? 20 : 100;
+    for (int round = 0; round < rounds; round++)
+    {
+        for (const std::u16string &query : queries)
+        {
+            DriveLink link;
+            found += view.Find(query, link) ? 1 : 0;
+        }
+    }
+    const double lookupNs = lookupTimer.ElapsedMs() * 1e6 / static_cast<double>(queries.size() * rounds);
+
+    CStopwatch openTimer;
+    CDriveLinkIndexView reopened;
+    reopened.Open(image.data(), image.size());
+    const double openMs = openTimer.ElapsedMs();
+
+    std::printf("%zu links (%zu KiB): write %.2f ms, open %.3f ms, lookup %.0f ns; %zu/%zu queries linked; %zu "
+                "mismatches, %d failures\n",
+                unique.size(), image.size() / 1024, writeMs, openMs, lookupNs, hits, queries.size(), mismatches, failures);
+    ReportMetric(options, "write", writeMs, "ms");
+    ReportMetric(options, "open", openMs, "ms");
+    ReportMetric(options, "lookup", lookupNs, "ns");
+    return failures + (found == hits * rounds ? 0 : 1);
+}
+} // namespace
+
+int RunLinkIndexBench(const BenchOptions &options)
+{
+    int failures = CheckEdgeCases();
+    failures += CheckParity(options);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+// Context menu command table: the rows Explorer sees against the menus and
+// CLSIDs the shell extension has always registered, and what populating a
+// menu costs with the table and precomputed icon paths against a switch per
+// callback and an icon path rebuilt on every GetIcon.
+
+#include "BenchUtil.h"
+#include "CommandTable.h"
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <memory>
+
+namespace
+{
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+constexpr wchar_t kModulePath[] = L"C:\\Program Files\\RRightclickrr\\shell-extension\\RRightclickrrShell.dll";
+
+std::wstring FormatGuid(const CommandGuid &guid)
+{
+    wchar_t text[40];
+    std::swprintf(text, 40, L"%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X", guid.data1, guid.data2, guid.data3,
+                  guid.data4[0], guid.data4[1], guid.data4[2], guid.data4[3], guid.data4[4], guid.data4[5],
+                  guid.data4[6], guid.data4[7]);
+    return text;
+}
+
+// The icon path as GetIcon built it on every call: two levels up from the
+// DLL, then resources\assets\<icon>.ico.
+std::wstring BuildIconPath(const wchar_t *modulePath, const wchar_t *icon)
+{
+    std::wstring path(modulePath);
+    path.erase(path.rfind(L'\\'));
+    path.erase(path.rfind(L'\\'));
+    return path + L"\\resources\\assets\\" + icon + L".ico";
+}
+
+// Stands in for SHStrDupW, which every callback pays either way.
+wchar_t *Dup(const wchar_t *text)
+{
+    const size_t bytes = (std::wcslen(text) + 1) * sizeof(wchar_t);
+    wchar_t *copy = static_cast<wchar_t *>(std::malloc(bytes));
+    std::memcpy(copy, text, bytes);
+    return copy;
+}
+
+const wchar_t *LegacyIconName(CommandType type)
+{
+    switch (type)
+    {
+    case CommandType::RootMenuFolder:
+    case CommandType::RootMenuFile:
+        return L"rrightclickrr";
+    case CommandType::SyncToDrive:
+        return L"sync-icon";
+    case CommandType::CopyToDrive:
+        return L"copy-icon";
+    case CommandType::GetDriveURL:
+        return L"link-icon";
+    }
+    return L"rrightclickrr";
+}
+
+struct LegacyCommand
+{
+    CommandType type;
+};
+
+// Title, tooltip, icon and canonical name of one command, as Explorer asks
+// for them while painting the menu.
+size_t PaintLegacy(const LegacyCommand &command)
+{
+    const CommandDescriptor &row = DescribeCommand(command.type);
+    wchar_t *title = Dup(row.title);
+    wchar_t *tooltip = Dup(row.tooltip);
+    wchar_t *icon = Dup(BuildIconPath(kModulePath, LegacyIconName(command.type)).c_str());
+    const size_t work = std::wcslen(icon) + title[0] + tooltip[0] + row.clsid.data4[7];
+    std::free(title);
+    std::free(tooltip);
+    std::free(icon);
+    return work;
+}
+
+size_t PaintFromTable(const CommandDescriptor &row, const std::wstring *icons)
+{
+    wchar_t *title = Dup(row.title);
+    wchar_t *tooltip = Dup(row.tooltip);
+    wchar_t *icon = Dup(icons[static_cast<size_t>(row.type)].c_str());
+    const size_t work = std::wcslen(icon) + title[0] + tooltip[0] + row.clsid.data4[7];
+    std::free(title);
+    std::free(tooltip);
+    std::free(icon);
+    return work;
+}
+
+int CheckTable()
+{
+    int failures = 0;
+    const std::pair<CommandType, const wchar_t *> registered[] = {
+        {CommandType::RootMenuFolder, L"7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6A"},
+        {CommandType::RootMenuFile, L"7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6E"},
+        {CommandType::SyncToDrive, L"7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6B"},
+        {CommandType::CopyToDrive, L"7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6C"},
+        {CommandType::GetDriveURL, L"7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6D"},
+    };
+    for (const auto &entry : registered)
+    {
+        failures += Expect(FormatGuid(DescribeCommand(entry.first).clsid) == entry.second, "CLSID as registered");
+    }
+
+    failures += Expect(kFolderSubcommands.count == 3 && kFolderSubcommands.items[0] == CommandType::SyncToDrive &&
+                           kFolderSubcommands.items[1] == CommandType::CopyToDrive &&
+                           kFolderSubcommands.items[2] == CommandType::GetDriveURL,
+                       "folder menu: sync, copy, link");
+    failures += Expect(kFileSubcommands.count == 1 && kFileSubcommands.items[0] == CommandType::GetDriveURL,
+                       "file menu: link only");
+    failures += Expect(SubcommandsOf(CommandType::SyncToDrive).count == 0, "commands have no subcommands");
+    failures += Expect(DescribeCommand(CommandType::SyncToDrive).mode == BatchMode::Sync &&
+                           DescribeCommand(CommandType::CopyToDrive).mode == BatchMode::Copy &&
+                           DescribeCommand(CommandType::GetDriveURL).mode == BatchMode::GetUrl,
+                       "command modes");
+    for (const CommandDescriptor &row : kCommandTable)
+    {
+        failures += Expect(row.title[0] != L'\0' && row.tooltip[0] != L'\0', "title and tooltip set");
+        failures += Expect(row.hasSubcommands == (row.type == CommandType::RootMenuFolder ||
+                                                  row.type == CommandType::RootMenuFile),
+                           "only root menus have subcommands");
+        failures += Expect(row.icon == std::wstring(LegacyIconName(row.type)), "same icon as before");
+    }
+    std::printf("command table: %zu commands, %zu in the folder menu, %zu in the file menu; %d failures\n",
+                kCommandCount, kFolderSubcommands.count, kFileSubcommands.count, failures);
+    return failures;
+}
+
+double MedianNs(std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    return Percentile(samples, 50);
+}
+
+int CheckPopulation(const BenchOptions &options)
+{
+    // Resolved once, as DLL_PROCESS_ATTACH does.
+    std::wstring icons[kCommandCount];
+    for (const CommandDescriptor &row : kCommandTable)
+    {
+        icons[static_cast<size_t>(row.type)] = BuildIconPath(kModulePath, row.icon);
+    }
+    int failures = Expect(icons[static_cast<size_t>(CommandType::GetDriveURL)] ==
+                              L"C:\\Program Files\\RRightclickrr\\resources\\assets\\link-icon.ico",
+                          "icon path two levels above the DLL");
+
+    const int menus = options.quick ? 20000 : 200000;
+    const int rounds = 5;
+    std::vector<double> before;
+    std::vector<double> after;
+    size_t sink = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        // Before: a new object per subcommand on every enumeration.
+        CStopwatch legacyTimer;
+        for (int i = 0; i < menus; i++)
+        {
+            sink += PaintLegacy(LegacyCommand{CommandType::RootMenuFolder});
+            for (CommandType type : {CommandType::SyncToDrive, CommandType::CopyToDrive, CommandType::GetDriveURL})
+            {
+                std::unique_ptr<LegacyCommand> command(new LegacyCommand{type});
+                sink += PaintLegacy(*command);
+            }
+        }
+        before.push_back(legacyTimer.ElapsedMs() * 1e6 / menus);
+
+        // After: shared rows and icon paths.
+        CStopwatch tableTimer;
+        for (int i = 0; i < menus; i++)
+        {
+            sink += PaintFromTable(DescribeCommand(CommandType::RootMenuFolder), icons);
+            for (size_t j = 0; j < kFolderSubcommands.count; j++)
+            {
+                sink += PaintFromTable(DescribeCommand(kFolderSubcommands.items[j]), icons);
+            }
+        }
+        after.push_back(tableTimer.ElapsedMs() * 1e6 / menus);
+    }
+
+    const double beforeNs = MedianNs(before);
+    const double afterNs = MedianNs(after);
+    failures += Expect(sink != 0, "menus painted");
+    std::printf("folder menu populated: %.0f ns before, %.0f ns after (%.1fx), %d menus x %d rounds; "
+                "before leaves out GetModuleFileNameW; %d failures\n",
+                beforeNs, afterNs, beforeNs / afterNs, menus, rounds, failures);
+    ReportMetric(options, "menu_populate_before", beforeNs, "ns");
+    ReportMetric(options, "menu_populate_after", afterNs, "ns");
+    return failures;
+}
+} // namespace
+
+int RunMenuBench(const BenchOptions &options)
+{
+    int failures = CheckTable();
+    failures += CheckPopulation(options);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+// NormalizePath kernels: differential test against the scalar kernel and the
+// original towlower normalizer, plus throughput
+
+#include "BenchUtil.h"
+#include "PathNormalize.h"
+#include "SyncedPathMatch.h"
+#include <algorithm>
+#include <cwctype>
+
+namespace
+{
+const PathNormalizeKernel kKernels[] = {PathNormalizeKernel::Scalar, PathNormalizeKernel::Sse2, PathNormalizeKernel::Avx2};
+
+// NormalizePath as it was before the kernels: std::replace, then towlower.
+std::wstring LegacyNormalizePath(std::wstring value)
+{
+    std::replace(value.begin(), value.end(), L'/', L'\\');
+    for (wchar_t &ch : value)
+    {
+        ch = static_cast<wchar_t>(towlower(ch));
+    }
+    while (value.length() > 3 && value.back() == L'\\')
+    {
+        value.pop_back();
+    }
+    return value;
+}
+
+std::wstring NormalizeWith(std::wstring value, PathNormalizeKernel kernel)
+{
+    value.resize(NormalizePathInPlace(value.data(), value.size(), kernel));
+    return value;
+}
+
+void AppendCodePoint(std::wstring &value, uint32_t codePoint)
+{
+    if (sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+    {
+        codePoint -= 0x10000;
+        value += static_cast<wchar_t>(0xD800 + (codePoint >> 10));
+        value += static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF));
+        return;
+    }
+    value += static_cast<wchar_t>(codePoint);
+}
+
+// Expected values taken from Node's toLowerCase.
+int CheckFoldTable()
+{
+    const uint32_t kCases[][2] = {
+        {0x41, 0x61},     {0x5A, 0x7A},     {0x5B, 0x5B},     {0xC4, 0xE4},   {0xD7, 0xD7},
+        {0xDF, 0xDF},     {0x130, 0x69},    {0x178, 0xFF},    {0x1C5, 0x1C6}, {0x3A3, 0x3C3},
+        {0x416, 0x436},   {0x1E9E, 0xDF},   {0x2126, 0x3C9},  {0x212A, 0x6B}, {0xFF21, 0xFF41},
+        {0x10400, 0x10428}, {0x1E920, 0x1E942}, {0xE4, 0xE4}, {0x10FFFF, 0x10FFFF},
+    };
+
+    int failures = 0;
+    for (const auto &entry : kCases)
+    {
+        const uint32_t folded = FoldCodePoint(entry[0]);
+        if (folded != entry[1])
+        {
+            std::fprintf(stderr, "  fold U+%04X: got U+%04X, expected U+%04X\n", entry[0], folded, entry[1]);
+            failures++;
+        }
+    }
+
+    // The kernels fold supplementary characters too (surrogate pairs on Windows).
+    std::wstring deseret;
+    AppendCodePoint(deseret, 0x10400);
+    deseret += L"/X";
+    std::wstring expected;
+    AppendCodePoint(expected, 0x10428);
+    expected += L"\\x";
+    failures += NormalizePath(deseret) == expected ? 0 : 1;
+
+    std::printf("fold table: %d failures\n", failures);
+    return failures;
+}
+
+// Random paths mixing ASCII runs, separators and non-ASCII characters at
+// every offset relative to the vector width.
+std::wstring RandomPath(std::mt19937 &rng)
+{
+    static const uint32_t kNonAscii[] = {0xC4, 0xE9, 0x130, 0x3A3, 0x416, 0x2126, 0x1E9E, 0x4E2D, 0x10400, 0x1F600};
+    static const wchar_t kAscii[] = L"abcXYZ019 -_.~@[`{/\\\\";
+
+    std::wstring path;
+    const size_t length = rng() % 80;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (rng() % 16 == 0)
+        {
+            AppendCodePoint(path, kNonAscii[rng() % (sizeof(kNonAscii) / sizeof(kNonAscii[0]))]);
+        }
+        else
+        {
+            path += kAscii[rng() % (sizeof(kAscii) / sizeof(kAscii[0]) - 1)];
+        }
+    }
+    if (sizeof(wchar_t) == 2 && rng() % 20 == 0)
+    {
+        path += static_cast<wchar_t>(0xD800 + rng() % 0x800); // Unpaired surrogate
+    }
+    return path;
+}
+
+int RunDifferential(size_t count)
+{
+    std::mt19937 rng(7);
+    int mismatches = 0;
+    size_t asciiCompared = 0;
+    for (size_t n = 0; n < count; n++)
+    {
+        const std::wstring path = RandomPath(rng);
+        const std::wstring reference = NormalizeWith(path, PathNormalizeKernel::Scalar);
+
+        for (PathNormalizeKernel kernel : kKernels)
+        {
+            if (IsPathNormalizeKernelSupported(kernel) && NormalizeWith(path, kernel) != reference)
+            {
+                if (mismatches < 10)
+                {
+                    std::fprintf(stderr, "  %s mismatch: \"%ls\"\n", PathNormalizeKernelName(kernel), path.c_str());
+                }
+                mismatches++;
+            }
+        }
+
+        // For ASCII the original towlower normalizer is locale-independent.
+        if (std::all_of(path.begin(), path.end(), [](wchar_t ch) { return ch >= 0 && ch < 0x80; }))
+        {
+            asciiCompared++;
+            mismatches += LegacyNormalizePath(path) != reference ? 1 : 0;
+        }
+    }
+
+    std::printf("differential: %zu paths (%zu ASCII-only vs towlower), %d mismatches\n", count, asciiCompared, mismatches);
+    return mismatches;
+}
+} // namespace
+
+int RunNormalizeBench(const BenchOptions &options)
+{
+    std::printf("active kernel: %s\n", PathNormalizeKernelName(ActivePathNormalizeKernel()));
+    int failures = CheckFoldTable();
+    failures += RunDifferential(options.quick ? 20000 : 200000);
+
+    CPathGenerator gen(99);
+    std::vector<std::wstring> paths;
+    size_t units = 0;
+    for (size_t i = 0; i < (options.quick ? 2000 : 100000); i++)
+    {
+        paths.push_back(gen.Path(2 + gen.Next() % 6) + gen.Separator() + gen.Component() + L".txt");
+        units += paths.back().size();
+    }
+
+    const int rounds = options.quick ? 1 : 10;
+    size_t checksum = 0;
+    CStopwatch legacyTimer;
+    for (int round = 0; round < rounds; round++)
+    {
+        for (const std::wstring &path : paths)
+        {
+            checksum += LegacyNormalizePath(path).size();
+        }
+    }
+    const double legacyMs = legacyTimer.ElapsedMs() / rounds;
+    std::printf("towlower: %.1f ns/path\n", legacyMs * 1e6 / paths.size());
+
+    for (PathNormalizeKernel kernel : kKernels)
+    {
+        if (!IsPathNormalizeKernelSupported(kernel))
+        {
+            std::printf("%-8s: not supported on this CPU\n", PathNormalizeKernelName(kernel));
+            continue;
+        }
+
+        std::wstring scratch;
+        CStopwatch timer;
+        for (int round = 0; round < rounds; round++)
+        {
+            for (const std::wstring &path : paths)
+            {
+                scratch.assign(path);
+                checksum += NormalizePathInPlace(scratch.data(), scratch.size(), kernel);
+            }
+        }
+        const double ms = timer.ElapsedMs() / rounds;
+        std::printf("%-8s: %.1f ns/path, %.2f GB/s\n", PathNormalizeKernelName(kernel), ms * 1e6 / paths.size(),
+                    units * sizeof(wchar_t) / (ms * 1e6));
+    }
+
+    std::printf("(checksum %zu)\n", checksum);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+// Overlay core benchmark driver
+//
+// Usage: OverlayBench [suite] [--quick] [--json <file>]
+// Each suite verifies its results against the reference implementation and
+// exits non-zero on any mismatch. --json writes the metrics suites record.
+
+#include "BenchUtil.h"
+#include <cstring>
+
+namespace
+{
+struct Suite
+{
+    const char *name;
+    int (*run)(const BenchOptions &options);
+};
+
+const Suite kSuites[] = {
+    {"trie", RunTrieBench},
+    {"index", RunIndexFormatBench},
+    {"snapshot", RunSnapshotBench},
+    {"monitor", RunChangeMonitorBench},
+    {"memo", RunParentMemoBench},
+    {"normalize", RunNormalizeBench},
+    {"alloc", RunAllocationBench},
+    {"journal", RunJournalBench},
+    {"textload", RunTextLoaderBench},
+    {"status", RunStatusBench},
+    {"shared", RunSharedIndexBench},
+    {"engine", RunEngineBench},
+    {"stats", RunStatsBench},
+    {"reload", RunReloaderBench},
+    {"links", RunLinkIndexBench},
+    {"selection", RunSelectionBench},
+    {"ipc", RunIpcBench},
+    {"invoke", RunInvokeBench},
+    {"menu", RunMenuBench},
+    {"exclude", RunExclusionBench},
+    {"scan", RunScanBench},
+    {"md5", RunHashBench},
+    {"syncdb", RunSyncDbBench},
+    {"watch", RunWatchBench},
+};
+} // namespace
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    CBenchReport report;
+    const char *selected = nullptr;
+    const char *jsonFile = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--quick") == 0)
+        {
+            options.quick = true;
+        }
+        else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+        {
+            jsonFile = argv[++i];
+            options.report = &report;
+        }
+        else
+        {
+            selected = argv[i];
+        }
+    }
+
+    int failures = 0;
+    bool matched = false;
+    for (const Suite &suite : kSuites)
+    {
+        if (selected && std::strcmp(selected, suite.name) != 0)
+        {
+            continue;
+        }
+        matched = true;
+        report.SetSuite(suite.name);
+        std::printf("== %s ==\n", suite.name);
+        failures += suite.run(options) != 0 ? 1 : 0;
+    }
+
+    if (!matched)
+    {
+        std::fprintf(stderr, "unknown suite: %s\n", selected);
+        return 2;
+    }
+    if (jsonFile && !report.WriteJson(jsonFile, options.quick))
+    {
+        std::fprintf(stderr, "cannot write %s\n", jsonFile);
+        return 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,263 @@
+// Parent-directory memo: folder-listing bursts against direct lookups
+
+#include "BenchUtil.h"
+#include "OverlayIndexFormat.h"
+#include "ParentVerdictMemo.h"
+#include "SyncedPathMatch.h"
+#include "SyncedPathTrie.h"
+#include "Utf8.h"
+
+namespace
+{
+std::u16string ToUtf16(std::wstring_view value)
+{
+    std::u16string units;
+    AppendWideAsUtf16(value, units);
+    return units;
+}
+
+// Both index representations the DLL can answer from, over the same roots.
+struct MemoFixture
+{
+    CSyncedPathTrie trie;
+    std::vector<uint8_t> image;
+    COverlayIndexView view;
+
+    explicit MemoFixture(const std::vector<std::wstring> &roots)
+    {
+        trie.Build(roots);
+        std::vector<std::u16string> units;
+        for (const std::wstring &root : roots)
+        {
+            units.push_back(ToUtf16(root));
+        }
+        image = BuildOverlayIndexImage(units, 1);
+        view.Open(image.data(), image.size());
+    }
+
+    bool TrieResolve(CParentVerdictMemo &memo, uint64_t generation, const std::wstring &path) const
+    {
+        return memo.Resolve(
+            generation, path,
+            [&](std::wstring_view parentWithSeparator) { return ClassifyParent(trie, parentWithSeparator); },
+            [&](std::wstring_view candidate) { return trie.Matches(candidate); });
+    }
+
+    bool IndexResolve(CParentVerdictMemo &memo, uint64_t generation, const std::wstring &path) const
+    {
+        return memo.Resolve(
+            generation, path,
+            [&](std::wstring_view parentWithSeparator) { return ClassifyParent(view, ToUtf16(parentWithSeparator)); },
+            [&](std::wstring_view candidate) { return view.Matches(ToUtf16(candidate)); });
+    }
+};
+
+bool LinearMatches(const std::vector<std::wstring> &roots, const std::wstring &path)
+{
+    for (const std::wstring &root : roots)
+    {
+        if (IsSameOrChildPath(path, root))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Every query goes through a cold and a warm memo for both representations.
+int CheckParity(const std::vector<std::wstring> &roots, const std::vector<std::wstring> &queries)
+{
+    const MemoFixture fixture(roots);
+    CParentVerdictMemo trieMemo;
+    CParentVerdictMemo indexMemo;
+
+    int mismatches = 0;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (const std::wstring &query : queries)
+        {
+            const bool expected = LinearMatches(roots, query);
+            const bool viaTrie = fixture.TrieResolve(trieMemo, 1, query);
+            const bool viaIndex = fixture.IndexResolve(indexMemo, 1, query);
+            if (viaTrie != expected || viaIndex != expected)
+            {
+                if (mismatches < 10)
+                {
+                    std::fprintf(stderr, "  mismatch: \"%ls\" expected %d, trie %d, index %d\n", query.c_str(),
+                                 expected ? 1 : 0, viaTrie ? 1 : 0, viaIndex ? 1 : 0);
+                }
+                mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+int RunEdgeCases()
+{
+    const wchar_t *const kRoots[] = {
+        L"c:\\", L"d:\\projects\\client-a", L"\\\\server\\share\\", L"ab\\", L"x", L"e:\\a\\\\b", L"f:",
+        L"g:\\deep\\nested\\root",
+    };
+    const wchar_t *const kParents[] = {
+        L"c:", L"c:\\windows", L"d:", L"d:\\projects", L"d:\\projects\\client-a", L"d:\\projects\\client-ab",
+        L"\\\\server", L"\\\\server\\share", L"ab", L"x", L"e:\\a", L"e:\\a\\", L"f:", L"g:", L"g:\\deep",
+        L"g:\\deep\\nested", L"g:\\deep\\nested\\root", L"g:\\deep\\nestedroot", L"h:", L"\\",
+    };
+    const wchar_t *const kChildren[] = {L"", L"b", L"root", L"client-a", L"x.txt"};
+
+    std::vector<std::wstring> roots(std::begin(kRoots), std::end(kRoots));
+    std::vector<std::wstring> queries;
+    for (const wchar_t *parent : kParents)
+    {
+        queries.push_back(parent);
+        for (const wchar_t *child : kChildren)
+        {
+            queries.push_back(std::wstring(parent) + L"\\" + child);
+        }
+    }
+
+    int mismatches = 0;
+    for (const std::wstring &root : roots)
+    {
+        mismatches += CheckParity({root}, queries);
+    }
+    mismatches += CheckParity(roots, queries);
+    mismatches += CheckParity({}, queries);
+
+    std::printf("edge cases: %zu queries, %d mismatches\n", queries.size(), mismatches);
+    return mismatches;
+}
+
+// A stale verdict must not survive a new generation.
+int CheckGenerationInvalidation()
+{
+    const MemoFixture before({L"c:\\sync"});
+    const MemoFixture after({L"d:\\other"});
+    const std::wstring child = L"c:\\sync\\report.txt";
+
+    CParentVerdictMemo memo;
+    int failures = 0;
+    failures += before.TrieResolve(memo, 1, child) ? 0 : 1;
+    failures += before.IndexResolve(memo, 1, child) ? 0 : 1;
+    failures += after.TrieResolve(memo, 2, child) ? 1 : 0;
+    failures += after.IndexResolve(memo, 2, child) ? 1 : 0;
+
+    memo.Clear();
+    failures += before.TrieResolve(memo, 1, child) ? 0 : 1;
+
+    std::printf("generation invalidation: %s\n", failures == 0 ? "ok" : "FAILED");
+    return failures;
+}
+
+// Explorer listing folders: children of synced folders, of folders that
+// only contain synced roots, and of folders unrelated to any root.
+std::vector<std::wstring> GenerateListings(CPathGenerator &gen, const SyntheticIndex &index, size_t folderCount,
+                                           size_t childrenPerFolder)
+{
+    std::vector<std::wstring> queries;
+    for (size_t i = 0; i < folderCount; i++)
+    {
+        const std::wstring &folder = index.rawFolders[gen.Next() % index.rawFolders.size()];
+        std::wstring listed;
+        switch (i % 3)
+        {
+        case 0: listed = folder; break;
+        case 1: listed = folder.substr(0, folder.find_last_of(L"\\/")); break;
+        default: listed = gen.Path(2 + gen.Next() % 4); break;
+        }
+
+        const std::wstring normalized = NormalizePath(listed);
+        for (size_t c = 0; c < childrenPerFolder; c++)
+        {
+            queries.push_back(normalized + L"\\" + gen.Component() + std::to_wstring(c));
+        }
+    }
+    return queries;
+}
+} // namespace
+
+int RunParentMemoBench(const BenchOptions &options)
+{
+    int mismatches = RunEdgeCases();
+    mismatches += CheckGenerationInvalidation();
+
+    const size_t folderCount = options.quick ? 200 : 10000;
+    const size_t listedFolders = options.quick ? 30 : 300;
+    const size_t childrenPerFolder = options.quick ? 100 : 2000;
+
+    CPathGenerator gen(4321);
+    const SyntheticIndex index = GenerateSyncedIndex(gen, folderCount, 10);
+    std::vector<std::wstring> roots;
+    for (const std::wstring &path : index.rawPaths)
+    {
+        roots.push_back(NormalizePath(path));
+    }
+    const std::vector<std::wstring> queries = GenerateListings(gen, index, listedFolders, childrenPerFolder);
+
+    const MemoFixture fixture(roots);
+    std::vector<std::u16string> queryUnits;
+    for (const std::wstring &query : queries)
+    {
+        queryUnits.push_back(ToUtf16(query));
+    }
+
+    CStopwatch trieTimer;
+    size_t trieHits = 0;
+    for (const std::wstring &query : queries)
+    {
+        trieHits += fixture.trie.Matches(query) ? 1 : 0;
+    }
+    const double trieMs = trieTimer.ElapsedMs();
+
+    CStopwatch indexTimer;
+    size_t indexHits = 0;
+    for (const std::u16string &query : queryUnits)
+    {
+        indexHits += fixture.view.Matches(query) ? 1 : 0;
+    }
+    const double indexMs = indexTimer.ElapsedMs();
+
+    ParentMemoStats trieStats;
+    CParentVerdictMemo trieMemo(&trieStats);
+    CStopwatch trieMemoTimer;
+    size_t trieMemoHits = 0;
+    for (const std::wstring &query : queries)
+    {
+        trieMemoHits += fixture.TrieResolve(trieMemo, 1, query) ? 1 : 0;
+    }
+    const double trieMemoMs = trieMemoTimer.ElapsedMs();
+
+    ParentMemoStats indexStats;
+    CParentVerdictMemo indexMemo(&indexStats);
+    CStopwatch indexMemoTimer;
+    size_t indexMemoHits = 0;
+    for (const std::wstring &query : queries)
+    {
+        indexMemoHits += fixture.IndexResolve(indexMemo, 1, query) ? 1 : 0;
+    }
+    const double indexMemoMs = indexMemoTimer.ElapsedMs();
+
+    int burstMismatches = 0;
+    burstMismatches += trieMemoHits != trieHits ? 1 : 0;
+    burstMismatches += indexMemoHits != trieHits || indexHits != trieHits ? 1 : 0;
+    CParentVerdictMemo parityMemo;
+    for (const std::wstring &query : queries)
+    {
+        burstMismatches += fixture.TrieResolve(parityMemo, 1, query) != fixture.trie.Matches(query) ? 1 : 0;
+    }
+    mismatches += burstMismatches;
+
+    const double perLookup = 1000.0 / queries.size();
+    std::printf("roots: %zu, listings: %zu x %zu children\n", fixture.trie.RootCount(), listedFolders, childrenPerFolder);
+    std::printf("trie:         %.3f us/lookup (%zu hits)\n", trieMs * perLookup, trieHits);
+    std::printf("trie + memo:  %.3f us/lookup (%zu hits)\n", trieMemoMs * perLookup, trieMemoHits);
+    std::printf("index:        %.3f us/lookup (%zu hits)\n", indexMs * perLookup, indexHits);
+    std::printf("index + memo: %.3f us/lookup (%zu hits)\n", indexMemoMs * perLookup, indexMemoHits);
+    std::printf("memo: %llu hits, %llu misses, %llu bypassed\n",
+                static_cast<unsigned long long>(trieStats.hits.load()),
+                static_cast<unsigned long long>(trieStats.misses.load()),
+                static_cast<unsigned long long>(trieStats.bypassed.load()));
+    std::printf("parity: %zu queries, %d mismatches\n", queries.size(), burstMismatches);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+// Background index reloader: bursts coalesced into one pass, urgent requests
+// skipping the settle window, the cap on how long writes can hold a reload
+// back, readers answered while a slow reload runs, and the change monitor
+// driving it.
+
+#include "BenchUtil.h"
+#include "IndexChangeSource.h"
+#include "IndexReloader.h"
+#include "SnapshotPublisher.h"
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+namespace
+{
+namespace fs = std::filesystem;
+
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+// Counts passes and the requests each one answered.
+struct ReloadLog
+{
+    std::atomic<uint64_t> passes{0};
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> lastRequests{0};
+
+    CIndexReloader::ReloadFunction Function()
+    {
+        return [this](uint64_t answered) {
+            requests.fetch_add(answered);
+            lastRequests.store(answered);
+            passes.fetch_add(1);
+        };
+    }
+};
+
+int CheckBurst(bool quick)
+{
+    ReloadLog log;
+    CIndexReloader reloader;
+    int failures = Expect(reloader.Start(log.Function(), {30, 2000}), "reloader starts");
+    failures += Expect(reloader.WaitForReload(0, 1000), "initial load runs without a request");
+
+    const int writes = quick ? 20 : 100;
+    CStopwatch timer;
+    for (int i = 0; i < writes; i++)
+    {
+        reloader.Request();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    failures += Expect(reloader.WaitForReload(1, 3000), "burst is reloaded");
+    const double burstMs = timer.ElapsedMs();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    failures += Expect(reloader.ReloadCount() == 2, "one pass for the whole burst");
+    failures += Expect(log.lastRequests.load() == static_cast<uint64_t>(writes), "pass answers every request");
+
+    // Urgent requests skip the settle window.
+    CStopwatch urgentTimer;
+    reloader.RequestNow();
+    failures += Expect(reloader.WaitForReload(2, 1000), "urgent request reloaded");
+    const double urgentMs = urgentTimer.ElapsedMs();
+    failures += Expect(urgentMs < 30, "urgent request does not wait to settle");
+
+    reloader.Stop();
+    std::printf("burst of %d requests: 1 pass after %.1f ms; urgent %.2f ms; %d failures\n", writes, burstMs, urgentMs,
+                failures);
+    return failures;
+}
+
+// Writes that never pause still get a reload every maxDelayMs.
+int CheckMaxDelay(bool quick)
+{
+    ReloadLog log;
+    CIndexReloader reloader;
+    int failures = Expect(reloader.Start(log.Function(), {50, 150}), "reloader starts");
+    reloader.WaitForReload(0, 1000);
+
+    const int periods = quick ? 4 : 10;
+    CStopwatch timer;
+    while (timer.ElapsedMs() < periods * 150.0)
+    {
+        reloader.Request();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    const uint64_t passes = reloader.ReloadCount() - 1;
+    reloader.Stop();
+
+    failures += Expect(passes >= 2 && passes <= static_cast<uint64_t>(periods) + 1, "passes bounded by the delay cap");
+    std::printf("%.0f ms of steady writes: %llu passes (cap 150 ms); %d failures\n", timer.ElapsedMs(),
+                static_cast<unsigned long long>(passes), failures);
+    return failures;
+}
+
+// A reload that takes a while builds its snapshot to the side; lookups keep
+// answering from the current one and the cold-start wait is bounded.
+int CheckReadersNotBlocked(const BenchOptions &options)
+{
+    CSnapshotPublisher<int> published;
+    CIndexReloader reloader;
+    std::atomic<int> version{0};
+    const auto reload = [&](uint64_t) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        published.Publish(std::make_unique<int>(++version));
+    };
+
+    int failures = Expect(reloader.Start(reload), "reloader starts");
+    CStopwatch coldTimer;
+    failures += Expect(!reloader.WaitForReload(0, 10), "cold-start wait times out while loading");
+    failures += Expect(coldTimer.ElapsedMs() < 90, "cold-start wait is bounded");
+    failures += Expect(!published.Read(), "immediate answer before the first load has no snapshot");
+    failures += Expect(reloader.WaitForReload(0, 2000), "cold-start wait sees the first load");
+    failures += Expect(published.Read() && *published.Read().Get() == 1, "first snapshot published");
+
+    // Read throughout a second slow reload.
+    reloader.RequestNow();
+    std::vector<double> samples;
+    CStopwatch window;
+    while (window.ElapsedMs() < 250)
+    {
+        CStopwatch read;
+        {
+            const auto snapshot = published.Read();
+            failures += Expect(static_cast<bool>(snapshot), "snapshot always present");
+        }
+        samples.push_back(read.ElapsedMs() * 1e6);
+    }
+    failures += Expect(reloader.ReloadCount() == 2 && *published.Read().Get() == 2, "second snapshot swapped in");
+    reloader.Stop();
+
+    std::sort(samples.begin(), samples.end());
+    const double p99 = Percentile(samples, 99);
+    const double worst = samples.back();
+    // A 100 ms reload must not show up in any read.
+    failures += Expect(worst < 50e6, "no read waits for the reload");
+    std::printf("%zu reads during a 100 ms reload: p99 %.0f ns, max %.0f ns; %d failures\n", samples.size(), p99,
+                worst, failures);
+    ReportMetric(options, "read_during_reload_p99", p99, "ns");
+    ReportMetric(options, "read_during_reload_max", worst, "ns");
+    return failures;
+}
+
+// The monitor's callback requests; a burst of file writes costs one pass.
+int CheckMonitorDriven(bool quick)
+{
+    const fs::path dir = fs::temp_directory_path() / "rrightclickrr-bench-reload";
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir);
+    const fs::path index = dir / "synced-paths.idx";
+    const fs::path journal = dir / "synced-paths.journal";
+
+    ReloadLog log;
+    CIndexReloader reloader;
+    CIndexChangeMonitor monitor;
+    int failures = Expect(reloader.Start(log.Function(), {50, 1000}), "reloader starts");
+    monitor.SetChangeCallback([&reloader]() { reloader.Request(); });
+    failures += Expect(monitor.Start(dir, {index, journal}, 50), "monitor starts");
+    reloader.WaitForReload(0, 1000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    const uint64_t before = reloader.ReloadCount();
+
+    const int writes = quick ? 10 : 50;
+    for (int i = 0; i < writes; i++)
+    {
+        std::ofstream(i % 2 ? journal : index, std::ios::binary | std::ios::trunc) << "write " << i;
+    }
+    failures += Expect(reloader.WaitForReload(before, 3000), "writes trigger a reload");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    const uint64_t passes = reloader.ReloadCount() - before;
+
+    monitor.Stop();
+    reloader.Stop();
+    fs::remove_all(dir, ec);
+
+    failures += Expect(passes >= 1 && passes <= 2, "burst of writes reloaded once or twice");
+    std::printf("%d index writes via %s: %llu passes; %d failures\n", writes,
+                monitor.UsingPollingFallback() ? "polling" : "notifications", static_cast<unsigned long long>(passes),
+                failures);
+    return failures;
+}
+
+int CheckStop()
+{
+    ReloadLog log;
+    CIndexReloader reloader;
+    int failures = Expect(reloader.Start(log.Function(), {5000, 10000}), "reloader starts");
+    reloader.WaitForReload(0, 1000);
+    reloader.Request();
+
+    CStopwatch timer;
+    reloader.Stop();
+    const double stopMs = timer.ElapsedMs();
+    failures += Expect(stopMs < 500, "stop does not wait out the settle window");
+    failures += Expect(!reloader.IsRunning() && log.passes.load() == 1, "pending request dropped");
+    failures += Expect(!reloader.WaitForReload(1, 1000), "no reload after stop");
+
+    // A later start loads again.
+    failures += Expect(reloader.Start(log.Function()) && reloader.WaitForReload(1, 1000), "restart reloads");
+    reloader.Stop();
+    std::printf("stop with a pending request: %.2f ms; %d failures\n", stopMs, failures);
+    return failures;
+}
+} // namespace
+
+int RunReloaderBench(const BenchOptions &options)
+{
+    int failures = CheckBurst(options.quick);
+    failures += CheckMaxDelay(options.quick);
+    failures += CheckReadersNotBlocked(options);
+    failures += CheckMonitorDriven(options.quick);
+    failures += CheckStop();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,320 @@
+// Directory scanner: the files, sizes and mtimes it reports against a plain
+// recursive std::filesystem walk with the app's filters, on a synthetic tree
+// with hidden names, system folders, excluded subtrees and links; then the
+// time to list the whole tree on one thread and on the pool. The full run
+// builds a tree of about a million entries.
+
+#include "BenchUtil.h"
+#include "DirectoryScanner.h"
+#include "SyncedPathMatch.h"
+#include "Utf8.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+namespace fs = std::filesystem;
+
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+// FolderSync's isSystemFolder and isSystemFile lists.
+const std::vector<std::string> kSystemFolders = {"node_modules", "__pycache__", ".git", ".svn", ".hg",
+                                                 "Thumbs.db", ".DS_Store", "$RECYCLE.BIN",
+                                                 "System Volume Information"};
+const std::vector<std::string> kSystemFiles = {"desktop.ini", "Thumbs.db", ".DS_Store"};
+
+struct ScannedFile
+{
+    std::string path;
+    uint64_t size;
+    double mtimeMs;
+
+    bool operator<(const ScannedFile &other) const { return path < other.path; }
+};
+
+struct Listing
+{
+    std::vector<ScannedFile> files;
+    std::vector<std::string> directories;
+
+    void Sort()
+    {
+        std::sort(files.begin(), files.end());
+        std::sort(directories.begin(), directories.end());
+    }
+};
+
+std::u16string RelativeKey(const std::string &relativeUtf8)
+{
+    std::wstring wide;
+    AppendUtf8AsWide(relativeUtf8, wide);
+    std::u16string key;
+    AppendWideAsUtf16(NormalizePath(wide), key);
+    return key;
+}
+
+double ReferenceMtimeMs(const fs::path &path)
+{
+#ifndef _WIN32
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0)
+    {
+        return static_cast<double>(st.st_mtim.tv_sec) * 1e3 + static_cast<double>(st.st_mtim.tv_nsec) / 1e6;
+    }
+#else
+    (void)path;
+#endif
+    return -1;
+}
+
+// What FolderSync.getAllFiles and getAllDirectories return, one entry at a time.
+void ReferenceWalk(const fs::path &root, const fs::path &directory, const CExclusionMatcher &exclusions,
+                   Listing &listing)
+{
+    std::error_code ec;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+    {
+        const fs::path path = it->path();
+        const std::string name = path.filename().u8string();
+        const fs::file_status status = it->status(ec); // Follows links
+        const bool isLink = it->is_symlink(ec);
+        const bool isDirectory = fs::is_directory(status) && !isLink;
+        const bool isFile = fs::is_regular_file(status);
+        if ((!isDirectory && !isFile) || name[0] == '.')
+        {
+            continue;
+        }
+        const auto &skip = isDirectory ? kSystemFolders : kSystemFiles;
+        if (std::find(skip.begin(), skip.end(), name) != skip.end() ||
+            exclusions.IsExcluded(RelativeKey(fs::relative(path, root).u8string())))
+        {
+            continue;
+        }
+        if (isDirectory)
+        {
+            listing.directories.push_back(path.u8string());
+            ReferenceWalk(root, path, exclusions, listing);
+        }
+        else
+        {
+            listing.files.push_back({path.u8string(), fs::file_size(path, ec), ReferenceMtimeMs(path)});
+        }
+    }
+}
+
+void WriteFile(const fs::path &path, size_t size)
+{
+    std::ofstream out(path, std::ios::binary);
+    const std::string bytes(size, 'x');
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+// A random tree of about entryCount entries: directories hang off earlier
+// ones at random, so depth and fan-out vary. Every 16th directory also gets
+// the names the scan must leave out.
+size_t BuildTree(const fs::path &root, size_t entryCount)
+{
+    CPathGenerator gen(41);
+    std::vector<fs::path> directories = {root};
+    const size_t directoryCount = std::max<size_t>(entryCount / 40, 8);
+    static const char *const kNames[] = {"Documents", "photos", "src", "Backup", "cache", "raw", "build", "Music"};
+    for (size_t i = 1; i < directoryCount; i++)
+    {
+        const fs::path &parent = directories[gen.Next() % directories.size()];
+        directories.push_back(parent / (std::string(kNames[gen.Next() % 8]) + "-" + std::to_string(i)));
+        fs::create_directory(directories.back());
+    }
+    // Exact names the exclusion rules below pick out.
+    fs::create_directories(root / "build" / "obj");
+    fs::create_directories(directories[1] / "cache");
+    directories.push_back(root / "build" / "obj");
+    directories.push_back(directories[1] / "cache");
+
+    size_t created = directories.size();
+    for (size_t d = 0; d < directories.size(); d += 16)
+    {
+        const fs::path &dir = directories[d];
+        fs::create_directories(dir / "node_modules" / "left-pad");
+        WriteFile(dir / "node_modules" / "left-pad" / "index.js", 10);
+        fs::create_directories(dir / ".git");
+        WriteFile(dir / ".git" / "HEAD", 20);
+        WriteFile(dir / "desktop.ini", 30);
+        WriteFile(dir / ".hidden", 40);
+        WriteFile(dir / "scratch.tmp", 50);
+        created += 7;
+    }
+
+    // Links: one to a file (followed), one back up the tree (not walked).
+    std::error_code ec;
+    WriteFile(root / "target.txt", 123);
+    fs::create_symlink(root / "target.txt", directories[2] / "link.txt", ec);
+    fs::create_directory_symlink(root, directories[3] / "loop", ec);
+    created += 3;
+
+    for (size_t i = 0; created < entryCount; i++, created++)
+    {
+        const fs::path &dir = directories[gen.Next() % directories.size()];
+        WriteFile(dir / ("file-" + std::to_string(i) + ".dat"), gen.Next() % 257);
+    }
+    return created;
+}
+
+CExclusionMatcher &Exclusions()
+{
+    static CExclusionMatcher matcher;
+    static bool compiled = false;
+    if (!compiled)
+    {
+        // Rooted at the scanned folder, as the addon compiles one folder's rules.
+        matcher.Compile({{L"", L"build"}, {L"", L"**/cache"}, {L"", L"**/*.tmp"}});
+        compiled = true;
+    }
+    return matcher;
+}
+
+DirectoryScanOptions AppOptions(unsigned threads)
+{
+    DirectoryScanOptions options;
+    options.threads = threads;
+    options.batchSize = 512;
+    options.skipDirectoryNames = kSystemFolders;
+    options.skipFileNames = kSystemFiles;
+    options.exclusions = &Exclusions();
+    return options;
+}
+
+bool RunScan(const fs::path &root, unsigned threads, Listing &listing, DirectoryScanTotals &totals,
+             size_t &batches)
+{
+    CDirectoryScanner scanner;
+    batches = 0;
+    return scanner.Scan(root.u8string(), AppOptions(threads),
+                        [&](DirectoryScanBatch &&batch) {
+                            batches++;
+                            for (size_t i = 0; i < batch.files.size(); i++)
+                            {
+                                listing.files.push_back({batch.files[i], batch.sizes[i], batch.mtimeMs[i]});
+                            }
+                            for (std::string &directory : batch.directories)
+                            {
+                                listing.directories.push_back(std::move(directory));
+                            }
+                        },
+                        totals);
+}
+
+int CheckParity(const fs::path &root, const Listing &reference)
+{
+    int failures = 0;
+    for (unsigned threads : {1u, 4u, 0u})
+    {
+        Listing listing;
+        DirectoryScanTotals totals;
+        size_t batches = 0;
+        failures += Expect(RunScan(root, threads, listing, totals, batches), "scan succeeds");
+        listing.Sort();
+        failures += Expect(listing.directories == reference.directories, "same directories");
+        failures += Expect(listing.files.size() == reference.files.size() && totals.files == listing.files.size(),
+                           "same number of files");
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < std::min(listing.files.size(), reference.files.size()); i++)
+        {
+            const ScannedFile &got = listing.files[i];
+            const ScannedFile &want = reference.files[i];
+            const bool sameMtime = want.mtimeMs < 0 || got.mtimeMs == want.mtimeMs;
+            mismatches += (got.path != want.path || got.size != want.size || !sameMtime) ? 1 : 0;
+        }
+        failures += Expect(mismatches == 0, "same paths, sizes and mtimes");
+        failures += Expect(totals.unreadable == 0, "nothing unreadable");
+        std::printf("%u threads: %llu files, %llu directories, %llu skipped, %zu batches, %llu steals\n",
+                    totals.threads, static_cast<unsigned long long>(totals.files), static_cast<unsigned long long>(totals.directories),
+                    static_cast<unsigned long long>(totals.skipped), batches,
+                    static_cast<unsigned long long>(totals.steals));
+    }
+
+    // Nothing from the filtered names or the excluded subtrees got through.
+    size_t leaked = 0;
+    for (const ScannedFile &file : reference.files)
+    {
+        leaked += (file.path.find("node_modules") != std::string::npos || file.path.find(".tmp") != std::string::npos ||
+                   file.path.find("desktop.ini") != std::string::npos)
+                      ? 1
+                      : 0;
+    }
+    failures += Expect(leaked == 0, "filters applied");
+
+    Listing missing;
+    DirectoryScanTotals totals;
+    size_t batches = 0;
+    failures += Expect(!RunScan(root / "missing", 0, missing, totals, batches) && missing.files.empty(),
+                       "missing root reported");
+    return failures;
+}
+
+int CheckThroughput(const BenchOptions &options, const fs::path &root, const Listing &reference)
+{
+    int failures = 0;
+    double singleMs = 0;
+    double poolMs = 0;
+    unsigned poolThreads = 0;
+    for (unsigned threads : {1u, 0u})
+    {
+        Listing listing;
+        DirectoryScanTotals totals;
+        size_t batches = 0;
+        CStopwatch timer;
+        RunScan(root, threads, listing, totals, batches);
+        (threads == 1 ? singleMs : poolMs) = timer.ElapsedMs();
+        poolThreads = totals.threads;
+        failures += Expect(listing.files.size() == reference.files.size(), "timed scan complete");
+    }
+
+    Listing walked;
+    CStopwatch referenceTimer;
+    ReferenceWalk(root, root, Exclusions(), walked);
+    const double referenceMs = referenceTimer.ElapsedMs();
+
+    std::printf("%zu files: %.1f ms filesystem walk with a stat per file, %.1f ms scanner on 1 thread, %.1f ms on "
+                "%u threads (%.1fx); %d failures\n",
+                reference.files.size(), referenceMs, singleMs, poolMs, poolThreads, singleMs / poolMs, failures);
+    ReportMetric(options, "scan_reference_ms", referenceMs, "ms");
+    ReportMetric(options, "scan_single_thread_ms", singleMs, "ms");
+    ReportMetric(options, "scan_pool_ms", poolMs, "ms");
+    return failures;
+}
+} // namespace
+
+int RunScanBench(const BenchOptions &options)
+{
+    const fs::path root = fs::temp_directory_path() / "rrightclickrr-bench-scan";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root);
+
+    CStopwatch buildTimer;
+    const size_t entries = BuildTree(root, options.quick ? 6000 : 1000000);
+    std::printf("built %zu entries in %.0f ms\n", entries, buildTimer.ElapsedMs());
+
+    Listing reference;
+    ReferenceWalk(root, root, Exclusions(), reference);
+    reference.Sort();
+
+    int failures = CheckParity(root, reference);
+    failures += CheckThroughput(options, root, reference);
+
+    fs::remove_all(root, ec);
+    return failures;
+}
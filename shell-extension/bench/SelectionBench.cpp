@@ -0,0 +1,126 @@
+// Multi-selection batches: nested-item removal against a brute-force scan,
+// the response file the app parses, and what reducing a large selection
+// costs Invoke.
+
+#include "BenchUtil.h"
+#include "SelectionBatch.h"
+#include "SyncedPathMatch.h"
+#include "Utf8.h"
+
+namespace
+{
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+// Keeps an item unless another selected item covers it; of equal items the
+// first selected stays. O(n^2).
+std::vector<std::wstring> ReferenceReduce(const std::vector<std::wstring> &paths)
+{
+    std::vector<std::wstring> kept;
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        const std::wstring key = NormalizePath(paths[i]);
+        bool covered = key.empty();
+        for (size_t j = 0; j < paths.size() && !covered; j++)
+        {
+            const std::wstring other = NormalizePath(paths[j]);
+            covered = j != i && !other.empty() && IsSameOrChildPath(key, other) && (other != key || j < i);
+        }
+        if (!covered)
+        {
+            kept.push_back(paths[i]);
+        }
+    }
+    return kept;
+}
+
+int CheckExamples()
+{
+    const std::vector<std::wstring> selection = {
+        L"C:\\Work\\Photos", L"C:\\Work", L"c:/work/notes.txt", L"C:\\Workshop", L"D:\\", L"D:\\Music",
+        L"C:\\WORK\\", L"", L"E:\\Solo",
+    };
+    const std::vector<std::wstring> reduced = ReduceSelection(selection);
+    int failures = Expect(reduced == std::vector<std::wstring>{L"C:\\Work", L"C:\\Workshop", L"D:\\", L"E:\\Solo"},
+                          "nested and repeated items dropped, order and spelling kept");
+    failures += Expect(ReduceSelection({}).empty(), "empty selection");
+    failures += Expect(ReduceSelection({L"C:\\a"}) == std::vector<std::wstring>{L"C:\\a"}, "single item");
+
+    const std::string request = BuildBatchRequest(BatchMode::Copy, {L"C:\\a b", L"D:\\caf\u00e9", L"E:\\\U0001F600"});
+    failures += Expect(request == "rrightclickrr-batch 1\nmode copy\nC:\\a b\nD:\\caf\xc3\xa9\nE:\\\xf0\x9f\x98\x80\n",
+                       "response file lines in UTF-8");
+    failures += Expect(BuildBatchRequest(BatchMode::Sync, {}).find("mode sync\n") != std::string::npos &&
+                           BuildBatchRequest(BatchMode::GetUrl, {}).find("mode get-url\n") != std::string::npos,
+                       "mode names");
+
+    std::wstring decoded;
+    AppendUtf8AsWide(request, decoded);
+    std::string encoded;
+    AppendWideAsUtf8(decoded, encoded);
+    failures += Expect(encoded == request, "UTF-8 round trip");
+
+    std::printf("examples: %d failures\n", failures);
+    return failures;
+}
+
+int CheckRandomSelections(const BenchOptions &options)
+{
+    CPathGenerator gen(17);
+    const int rounds = options.quick ? 200 : 2000;
+    int mismatches = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        // Folders, some of their children and a few repeats, as Explorer
+        // hands them over after a rubber-band or Ctrl+A selection.
+        std::vector<std::wstring> selection;
+        const size_t count = 1 + gen.Next() % 24;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!selection.empty() && gen.Next() % 3 == 0)
+            {
+                const std::wstring &base = selection[gen.Next() % selection.size()];
+                selection.push_back(gen.Next() % 4 == 0 ? base : base + gen.Separator() + gen.Component());
+            }
+            else
+            {
+                selection.push_back(gen.Path(1 + gen.Next() % 3));
+            }
+        }
+        mismatches += ReduceSelection(selection) == ReferenceReduce(selection) ? 0 : 1;
+    }
+
+    int failures = Expect(mismatches == 0, "reduction matches the reference scan");
+
+    // A large selection: every folder of a synced tree plus its files.
+    const SyntheticIndex index = GenerateSyncedIndex(gen, options.quick ? 500 : 5000, 4);
+    CStopwatch timer;
+    const std::vector<std::wstring> reduced = ReduceSelection(index.rawPaths);
+    const double reduceMs = timer.ElapsedMs();
+    timer = CStopwatch();
+    const std::string request = BuildBatchRequest(BatchMode::Sync, reduced);
+    const double buildMs = timer.ElapsedMs();
+    failures += Expect(reduced.size() <= index.rawFolders.size(), "files beneath selected folders dropped");
+
+    std::printf("%d random selections: %d mismatches; %zu items -> %zu in %.2f ms, request %zu KiB in %.2f ms; %d "
+                "failures\n",
+                rounds, mismatches, index.rawPaths.size(), reduced.size(), reduceMs, request.size() / 1024, buildMs,
+                failures);
+    ReportMetric(options, "reduce", reduceMs, "ms");
+    ReportMetric(options, "build_request", buildMs, "ms");
+    return failures;
+}
+} // namespace
+
+int RunSelectionBench(const BenchOptions &options)
+{
+    int failures = CheckExamples();
+    failures += CheckRandomSelections(options);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,487 @@
+// Shared-memory overlay index: publish protocol, readers racing a writer,
+// a real named segment mapped twice, and the app-side publisher's journal
+// deltas checked against a reference root set
+
+#include "BenchUtil.h"
+#include "OverlayIndexFormat.h"
+#include "OverlayIndexWriter.h"
+#include "OverlayJournal.h"
+#include "OverlaySharedIndex.h"
+#include "SharedMemorySegment.h"
+#include "SyncedPathMatch.h"
+#include "SyncedPathTrie.h"
+#include "Utf8.h"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+namespace
+{
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+std::string ToUtf8(const std::wstring &value)
+{
+    std::string utf8;
+    for (wchar_t ch : value)
+    {
+        utf8.push_back(static_cast<char>(ch)); // Generator paths are ASCII
+    }
+    return utf8;
+}
+
+std::u16string ToUtf16(const std::wstring &value)
+{
+    std::u16string units;
+    AppendWideAsUtf16(value, units);
+    return units;
+}
+
+std::vector<std::wstring> NormalizedRoots(const std::vector<std::wstring> &rawPaths)
+{
+    std::vector<std::wstring> roots;
+    for (const std::wstring &path : rawPaths)
+    {
+        roots.push_back(NormalizePath(path));
+    }
+    ReduceToCoveringRoots(roots);
+    return roots;
+}
+
+std::vector<uint8_t> ImageOf(const std::vector<std::wstring> &roots, uint64_t generation)
+{
+    std::vector<std::u16string> units;
+    for (const std::wstring &root : roots)
+    {
+        units.push_back(ToUtf16(root));
+    }
+    return BuildOverlayIndexImage(std::move(units), generation);
+}
+
+// Queries a view against a trie of the same roots; returns the mismatches.
+int CountMismatches(const COverlayIndexView &view, const CSyncedPathTrie &expected, const std::vector<std::wstring> &queries)
+{
+    int mismatches = 0;
+    for (const std::wstring &query : queries)
+    {
+        if (view.Matches(ToUtf16(query)) != expected.Matches(query))
+        {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+// Zeroed, 8-byte aligned stand-in for a segment.
+struct HeapSegment
+{
+    explicit HeapSegment(size_t slotCapacity) : words((COverlaySharedIndexWriter::SegmentSize(slotCapacity) + 7) / 8) {}
+    void *Data() { return words.data(); }
+    size_t Size() const { return words.size() * 8; }
+
+    std::vector<uint64_t> words;
+};
+
+int CheckProtocol(CPathGenerator &gen)
+{
+    const std::vector<std::wstring> small = NormalizedRoots({gen.Path(2), gen.Path(3)});
+    HeapSegment segment(4096);
+    COverlaySharedIndexReader reader;
+    int failures = Expect(!reader.Attach(segment.Data(), segment.Size()), "zeroed segment rejected");
+
+    COverlaySharedIndexWriter writer;
+    failures += Expect(writer.Attach(segment.Data(), segment.Size(), 7) && writer.SlotCapacity() == 4096, "writer lays out");
+    failures += Expect(reader.Attach(segment.Data(), segment.Size()) && reader.SegmentId() == 7, "reader attaches");
+
+    COverlayIndexView view;
+    OverlaySharedLease lease;
+    uint64_t count = 0;
+    failures += Expect(reader.OpenCurrent(view, lease, count) == OverlaySharedStatus::Absent, "absent before publish");
+
+    writer.Publish(ImageOf(small, 1));
+    failures += Expect(reader.OpenCurrent(view, lease, count) == OverlaySharedStatus::Ok && view.Generation() == 1 &&
+                           count == 1 && view.Matches(ToUtf16(small[0])),
+                       "first image");
+    const OverlaySharedLease first = lease;
+
+    writer.Publish(ImageOf(small, 2));
+    failures += Expect(first.IsStable(), "next publish fills the other slot");
+    failures += Expect(reader.OpenCurrent(view, lease, count) == OverlaySharedStatus::Ok && view.Generation() == 2,
+                       "second image");
+
+    writer.Publish(ImageOf(small, 3));
+    failures += Expect(!first.IsStable() && lease.IsStable(), "third publish overwrites the first slot");
+
+    std::vector<std::wstring> large;
+    for (int i = 0; i < 200; i++)
+    {
+        large.push_back(NormalizePath(gen.Path(4)));
+    }
+    failures += Expect(!writer.Publish(ImageOf(large, 4)), "oversized image refused");
+    failures += Expect(reader.OpenCurrent(view, lease, count) == OverlaySharedStatus::Unavailable, "readers sent to files");
+
+    writer.Publish(ImageOf(small, 5));
+    failures += Expect(reader.OpenCurrent(view, lease, count) == OverlaySharedStatus::Ok && view.Generation() == 5,
+                       "publishing again recovers");
+
+    COverlaySharedIndexWriter restarted;
+    failures += Expect(restarted.Attach(segment.Data(), segment.Size(), 8) && restarted.PublishCount() == 4,
+                       "a restarted writer adopts the segment");
+    restarted.Publish(ImageOf(small, 6));
+    failures += Expect(reader.OpenCurrent(view, lease, count) == OverlaySharedStatus::Ok && count == 5 &&
+                           reader.SegmentId() == 7,
+                       "publish counts continue");
+
+    std::printf("protocol: %d failures\n", failures);
+    return failures;
+}
+
+// A writer cycles three root sets through the two slots as fast as it can
+// while readers query whatever is current, so a slot a reader is using is
+// soon overwritten with different roots. Every answer a stable lease vouches
+// for must agree with the set its image was built from (generation % 3).
+int CheckRacingReaders(CPathGenerator &gen, bool quick)
+{
+    constexpr size_t kSets = 3;
+    const SyntheticIndex index = GenerateSyncedIndex(gen, quick ? 300 : 3000, 0);
+    const size_t third = index.rawFolders.size() / kSets;
+    std::vector<std::wstring> sets[kSets];
+    CSyncedPathTrie tries[kSets];
+    std::vector<uint8_t> images[kSets];
+    size_t capacity = 0;
+    for (size_t set = 0; set < kSets; set++)
+    {
+        sets[set] = NormalizedRoots(std::vector<std::wstring>(index.rawFolders.begin() + set * third,
+                                                              index.rawFolders.begin() + (set + 1) * third));
+        tries[set].Build(sets[set]);
+        images[set] = ImageOf(sets[set], set);
+        capacity = std::max(capacity, images[set].size());
+    }
+
+    std::vector<std::u16string> queryUnits;
+    std::vector<uint8_t> expected[kSets];
+    for (const std::wstring &raw : GenerateQueries(gen, index, 512))
+    {
+        const std::wstring query = NormalizePath(raw);
+        queryUnits.push_back(ToUtf16(query));
+        for (size_t set = 0; set < kSets; set++)
+        {
+            expected[set].push_back(tries[set].Matches(query) ? 1 : 0);
+        }
+    }
+
+    HeapSegment segment(capacity + COverlaySharedIndexWriter::kSlotAlignment);
+    COverlaySharedIndexWriter writer;
+    writer.Attach(segment.Data(), segment.Size(), 1);
+    writer.Publish(images[0]);
+
+    const int publishes = quick ? 400 : 4000;
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> stableAnswers{0};
+    std::atomic<uint64_t> discardedAnswers{0};
+    std::atomic<uint64_t> busyOpens{0};
+    std::atomic<int> mismatches{0};
+
+    const unsigned readerCount = std::max(2u, std::min(4u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> readers;
+    for (unsigned r = 0; r < readerCount; r++)
+    {
+        readers.emplace_back([&, r]() {
+            COverlaySharedIndexReader reader;
+            reader.Attach(segment.Data(), segment.Size());
+            COverlayIndexView view;
+            OverlaySharedLease lease;
+            uint64_t count = 0;
+            size_t next = r;
+            uint8_t answers[16];
+            while (!done.load(std::memory_order_relaxed))
+            {
+                if (reader.OpenCurrent(view, lease, count) != OverlaySharedStatus::Ok)
+                {
+                    busyOpens.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                // Answer a batch, then check the lease once, as the handler does.
+                const size_t start = next;
+                for (uint8_t &answer : answers)
+                {
+                    answer = view.Matches(queryUnits[next++ % queryUnits.size()]) ? 1 : 0;
+                }
+                if (!lease.IsStable())
+                {
+                    discardedAnswers.fetch_add(16, std::memory_order_relaxed);
+                    continue;
+                }
+
+                const std::vector<uint8_t> &answerSet = expected[view.Generation() % kSets];
+                for (size_t i = 0; i < 16; i++)
+                {
+                    if (answers[i] != answerSet[(start + i) % answerSet.size()])
+                    {
+                        mismatches.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+                stableAnswers.fetch_add(16, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    // Keep publishing until the readers have had a fair share of the race.
+    const uint64_t wantAnswers = quick ? 50000 : 500000;
+    CStopwatch timer;
+    int published = 0;
+    while ((published < publishes || stableAnswers.load(std::memory_order_relaxed) < wantAnswers) &&
+           timer.ElapsedMs() < 5000)
+    {
+        writer.Publish(images[++published % kSets]);
+    }
+    done = true;
+    for (std::thread &reader : readers)
+    {
+        reader.join();
+    }
+    const double elapsedMs = timer.ElapsedMs();
+
+    int failures = mismatches.load();
+    failures += Expect(stableAnswers.load() > 0, "readers got stable answers");
+    std::printf("%d publishes of %zu-%zu roots in %.1f ms, %u readers: %llu answers kept, %llu discarded, %llu retried "
+                "opens, %d mismatches\n",
+                published, sets[0].size(), sets[2].size(), elapsedMs, readerCount,
+                static_cast<unsigned long long>(stableAnswers.load()),
+                static_cast<unsigned long long>(discardedAnswers.load()),
+                static_cast<unsigned long long>(busyOpens.load()), mismatches.load());
+    return failures;
+}
+
+// Reference for the publisher: the same operations on a plain list, matched
+// by a linear scan.
+bool ReferenceMatches(const std::vector<std::wstring> &roots, const std::wstring &path)
+{
+    for (const std::wstring &root : roots)
+    {
+        if (IsSameOrChildPath(path, root))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int CheckReaderParity(const std::string &name, const std::vector<std::wstring> &reference,
+                      const std::vector<std::wstring> &queries, const char *what)
+{
+    CSharedMemorySegment mapping;
+    COverlaySharedIndexReader reader;
+    COverlayIndexView view;
+    OverlaySharedLease lease;
+    uint64_t count = 0;
+    if (!mapping.OpenReadOnly(name) || !reader.Attach(mapping.Data(), mapping.Size()) ||
+        reader.OpenCurrent(view, lease, count) != OverlaySharedStatus::Ok)
+    {
+        std::fprintf(stderr, "  failed: %s (segment not readable)\n", what);
+        return 1;
+    }
+
+    int mismatches = 0;
+    for (const std::wstring &query : queries)
+    {
+        mismatches += view.Matches(ToUtf16(query)) != ReferenceMatches(reference, query) ? 1 : 0;
+    }
+    if (mismatches != 0)
+    {
+        std::fprintf(stderr, "  failed: %s (%d mismatches)\n", what, mismatches);
+    }
+    return mismatches;
+}
+
+void ApplyReference(std::vector<std::wstring> &reference, const std::vector<std::wstring> &removes,
+                    const std::vector<std::wstring> &adds)
+{
+    for (const std::wstring &remove : removes)
+    {
+        reference.erase(std::remove_if(reference.begin(), reference.end(),
+                                       [&](const std::wstring &root) { return IsSameOrChildPath(root, remove); }),
+                        reference.end());
+    }
+    reference.insert(reference.end(), adds.begin(), adds.end());
+}
+
+// The app side end to end: index writes and journal appends through a real
+// named segment, read through a second read-only mapping.
+int CheckPublisher(CPathGenerator &gen, bool quick)
+{
+    namespace fs = std::filesystem;
+    const std::string name = OverlaySharedIndexSegmentName() + "-bench";
+    const fs::path dir = fs::temp_directory_path() / "rrightclickrr-bench-shared";
+    fs::create_directories(dir);
+    const fs::path indexFile = dir / "synced-paths.idx";
+    const fs::path journalFile = dir / "synced-paths.journal";
+    fs::remove(indexFile);
+    CSharedMemorySegment::Remove(name);
+
+    const SyntheticIndex index = GenerateSyncedIndex(gen, quick ? 300 : 3000, 3);
+    std::vector<std::string> utf8Paths;
+    for (const std::wstring &path : index.rawPaths)
+    {
+        utf8Paths.push_back(ToUtf8(path));
+    }
+    std::vector<std::wstring> queries;
+    for (const std::wstring &query : GenerateQueries(gen, index, quick ? 2000 : 20000))
+    {
+        queries.push_back(NormalizePath(query));
+    }
+
+    int failures = 0;
+    std::vector<std::wstring> reference;
+    for (const std::wstring &path : index.rawPaths)
+    {
+        reference.push_back(NormalizePath(path));
+    }
+
+    COverlaySegmentPublisher publisher(name);
+    COverlayJournalWriter journalWriter;
+    uint64_t generation = 0;
+    failures += Expect(WriteOverlayIndex(indexFile, utf8Paths, generation, &publisher) &&
+                           journalWriter.Reset(journalFile, generation),
+                       "index written");
+    failures += Expect(publisher.PublishCount() == 1, "index published");
+    failures += CheckReaderParity(name, reference, queries, "full index");
+
+    CSharedMemorySegment firstMapping;
+    COverlaySharedIndexReader firstReader;
+    failures += Expect(firstMapping.OpenReadOnly(name) && firstReader.Attach(firstMapping.Data(), firstMapping.Size()),
+                       "second mapping");
+
+    // Journal deltas, folded in by the publisher without touching the files.
+    const int rounds = quick ? 10 : 50;
+    for (int round = 0; round < rounds; round++)
+    {
+        std::vector<std::wstring> removes;
+        std::vector<std::wstring> adds;
+        std::vector<std::string> utf8Removes;
+        std::vector<std::string> utf8Adds;
+        for (int i = 0; i < 4; i++)
+        {
+            const std::wstring &existing = index.rawFolders[gen.Next() % index.rawFolders.size()];
+            const std::wstring add = (i % 2) ? gen.Path(3) : existing + L"\\" + gen.Component();
+            const std::wstring remove = (i % 2) ? existing : existing + L"\\" + gen.Component();
+            adds.push_back(NormalizePath(add));
+            removes.push_back(NormalizePath(remove));
+            utf8Adds.push_back(ToUtf8(add));
+            utf8Removes.push_back(ToUtf8(remove));
+        }
+        ApplyReference(reference, removes, adds);
+
+        uint64_t journalSize = 0;
+        journalWriter.Append(journalFile, generation, utf8Removes, utf8Adds, journalSize);
+        failures += Expect(publisher.PublishJournal(indexFile, journalFile, generation, utf8Removes, utf8Adds),
+                           "delta published");
+    }
+    failures += CheckReaderParity(name, reference, queries, "after journal deltas");
+    failures += Expect(firstReader.PublishCount() == publisher.PublishCount(), "existing mappings see the publishes");
+
+    // A publisher started after the index was written (an app restart)
+    // rebuilds from the files on its first append.
+    {
+        COverlaySegmentPublisher restarted(name);
+        const std::wstring add = gen.Path(2);
+        const std::vector<std::string> utf8Adds = {ToUtf8(add)};
+        uint64_t journalSize = 0;
+        journalWriter.Append(journalFile, generation, {}, utf8Adds, journalSize);
+        ApplyReference(reference, {}, {NormalizePath(add)});
+        failures += Expect(restarted.PublishJournal(indexFile, journalFile, generation, {}, utf8Adds) &&
+                               restarted.RootCount() > 0,
+                           "restarted publisher loads the files");
+        failures += CheckReaderParity(name, reference, queries, "restarted publisher");
+
+        // Outgrowing the slots retires the segment for a larger one.
+        std::vector<std::string> bulk;
+        std::vector<std::wstring> bulkReference;
+        const size_t bulkCount = quick ? 120000 : 400000;
+        for (size_t i = 0; i < bulkCount; i++)
+        {
+            const std::wstring path = gen.Path(5) + std::to_wstring(i);
+            bulk.push_back(ToUtf8(path));
+            bulkReference.push_back(NormalizePath(path));
+        }
+        const size_t oldCapacity = restarted.SlotCapacity();
+        failures += Expect(WriteOverlayIndex(indexFile, bulk, generation, &restarted), "bulk index written");
+        failures += Expect(restarted.SlotCapacity() > oldCapacity, "segment grown");
+
+        COverlayIndexView view;
+        OverlaySharedLease lease;
+        uint64_t count = 0;
+        failures += Expect(firstReader.OpenCurrent(view, lease, count) == OverlaySharedStatus::Unavailable,
+                           "old mapping sent to the files");
+        std::vector<std::wstring> sample(bulkReference.begin(), bulkReference.begin() + 200);
+        sample.insert(sample.end(), queries.begin(), queries.begin() + 200);
+        CSyncedPathTrie bulkTrie;
+        bulkTrie.Build(bulkReference);
+        CSharedMemorySegment grown;
+        COverlaySharedIndexReader grownReader;
+        failures += Expect(grown.OpenReadOnly(name) && grownReader.Attach(grown.Data(), grown.Size()) &&
+                               grownReader.SegmentId() != firstReader.SegmentId() &&
+                               grownReader.OpenCurrent(view, lease, count) == OverlaySharedStatus::Ok &&
+                               CountMismatches(view, bulkTrie, sample) == 0,
+                           "reopened by name");
+
+        std::printf("%zu roots: %zu byte image in a %zu byte slot pair, mapped once per session instead of per process\n",
+                    restarted.RootCount(), static_cast<size_t>(fs::file_size(indexFile)),
+                    static_cast<size_t>(COverlaySharedIndexWriter::SegmentSize(restarted.SlotCapacity())));
+
+        // Open cost a handler pays per publish, against reloading the file.
+        const int opens = quick ? 5 : 20;
+        CStopwatch openTimer;
+        for (int i = 0; i < opens; i++)
+        {
+            grownReader.OpenCurrent(view, lease, count);
+        }
+        const double openMs = openTimer.ElapsedMs() / opens;
+        CStopwatch fileTimer;
+        for (int i = 0; i < opens; i++)
+        {
+            std::ifstream in(indexFile, std::ios::binary);
+            const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            COverlayIndexView fileView;
+            fileView.Open(bytes.data(), bytes.size());
+        }
+        const double fileMs = fileTimer.ElapsedMs() / opens;
+        std::printf("open in place %.2f ms, read and open the file %.2f ms\n", openMs, fileMs);
+    }
+
+    // The publisher going away sends readers back to the files.
+    COverlayIndexView view;
+    OverlaySharedLease lease;
+    uint64_t count = 0;
+    CSharedMemorySegment last;
+    COverlaySharedIndexReader lastReader;
+    failures += Expect(last.OpenReadOnly(name) && lastReader.Attach(last.Data(), last.Size()) &&
+                           lastReader.OpenCurrent(view, lease, count) == OverlaySharedStatus::Unavailable,
+                       "invalidated on shutdown");
+
+    CSharedMemorySegment::Remove(name);
+    fs::remove_all(dir);
+    std::printf("publisher: %d rounds of deltas, %d failures\n", rounds, failures);
+    return failures;
+}
+} // namespace
+
+int RunSharedIndexBench(const BenchOptions &options)
+{
+    CPathGenerator gen(1212);
+    int failures = CheckProtocol(gen);
+    failures += CheckRacingReaders(gen, options.quick);
+    failures += CheckPublisher(gen, options.quick);
+    return failures == 0 ? 0 : 1;
+}
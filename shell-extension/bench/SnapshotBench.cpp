@@ -0,0 +1,194 @@
+// Snapshot publication: lock-free readers under a continuously publishing
+// writer, compared with the mutex-guarded cache it replaces.
+
+#include "BenchUtil.h"
+#include "SnapshotPublisher.h"
+#include "SyncedPathMatch.h"
+#include "SyncedPathTrie.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+constexpr uint64_t kLiveCanary = 0x5AFE5AFE5AFE5AFEull;
+constexpr uint64_t kDeadCanary = 0xDEADDEADDEADDEADull;
+
+// Two alternating root sets so readers can tell which snapshot answered.
+struct StressSnapshot
+{
+    uint64_t canary = kLiveCanary;
+    int variant = 0;
+    CSyncedPathTrie trie;
+
+    ~StressSnapshot() { canary = kDeadCanary; }
+};
+
+struct StressData
+{
+    std::vector<std::wstring> roots[2];
+    std::vector<std::wstring> queries;
+    std::vector<bool> expected[2];
+};
+
+StressData BuildStressData(size_t folderCount)
+{
+    StressData data;
+    CPathGenerator gen(99);
+    const SyntheticIndex index = GenerateSyncedIndex(gen, folderCount, 4);
+    for (size_t i = 0; i < index.rawPaths.size(); i++)
+    {
+        // Variant 0 holds the even entries, variant 1 the odd ones.
+        data.roots[i % 2].push_back(NormalizePath(index.rawPaths[i]));
+    }
+    for (const std::wstring &query : GenerateQueries(gen, index, 512))
+    {
+        data.queries.push_back(NormalizePath(query));
+    }
+
+    for (int variant = 0; variant < 2; variant++)
+    {
+        CSyncedPathTrie trie;
+        trie.Build(data.roots[variant]);
+        for (const std::wstring &query : data.queries)
+        {
+            data.expected[variant].push_back(trie.Matches(query));
+        }
+    }
+    return data;
+}
+
+std::unique_ptr<StressSnapshot> MakeSnapshot(const StressData &data, int variant)
+{
+    auto snapshot = std::make_unique<StressSnapshot>();
+    snapshot->variant = variant;
+    snapshot->trie.Build(data.roots[variant]);
+    return snapshot;
+}
+
+struct RunResult
+{
+    double lookupsPerSec;
+    uint64_t publishes;
+    uint64_t errors;
+};
+
+RunResult RunLockFree(const StressData &data, int threads, int durationMs)
+{
+    CSnapshotPublisher<StressSnapshot> publisher;
+    publisher.Publish(MakeSnapshot(data, 0));
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> lookups{0};
+    std::atomic<uint64_t> errors{0};
+    uint64_t publishes = 0;
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < threads; t++)
+    {
+        readers.emplace_back([&, t]() {
+            uint64_t local = 0;
+            uint64_t localErrors = 0;
+            size_t q = static_cast<size_t>(t) * 31;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                q = (q + 1) % data.queries.size();
+                const auto snapshot = publisher.Read();
+                if (snapshot->canary != kLiveCanary ||
+                    snapshot->trie.Matches(data.queries[q]) != data.expected[snapshot->variant][q])
+                {
+                    localErrors++;
+                }
+                local++;
+            }
+            lookups.fetch_add(local);
+            errors.fetch_add(localErrors);
+        });
+    }
+
+    CStopwatch timer;
+    while (timer.ElapsedMs() < durationMs)
+    {
+        publisher.Publish(MakeSnapshot(data, static_cast<int>(++publishes % 2)));
+    }
+    stop = true;
+    for (std::thread &reader : readers)
+    {
+        reader.join();
+    }
+
+    return {lookups.load() / (timer.ElapsedMs() / 1000.0), publishes, errors.load()};
+}
+
+// The previous design: a mutex around both the reload and every lookup.
+RunResult RunMutex(const StressData &data, int threads, int durationMs)
+{
+    std::mutex cacheMutex;
+    std::unique_ptr<StressSnapshot> current = MakeSnapshot(data, 0);
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> lookups{0};
+    std::atomic<uint64_t> errors{0};
+    uint64_t publishes = 0;
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < threads; t++)
+    {
+        readers.emplace_back([&, t]() {
+            uint64_t local = 0;
+            uint64_t localErrors = 0;
+            size_t q = static_cast<size_t>(t) * 31;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                q = (q + 1) % data.queries.size();
+                std::lock_guard<std::mutex> guard(cacheMutex);
+                if (current->trie.Matches(data.queries[q]) != data.expected[current->variant][q])
+                {
+                    localErrors++;
+                }
+                local++;
+            }
+            lookups.fetch_add(local);
+            errors.fetch_add(localErrors);
+        });
+    }
+
+    CStopwatch timer;
+    while (timer.ElapsedMs() < durationMs)
+    {
+        // Like the old reload, the rebuild happens while holding the lock.
+        std::lock_guard<std::mutex> guard(cacheMutex);
+        current = MakeSnapshot(data, static_cast<int>(++publishes % 2));
+    }
+    stop = true;
+    for (std::thread &reader : readers)
+    {
+        reader.join();
+    }
+
+    return {lookups.load() / (timer.ElapsedMs() / 1000.0), publishes, errors.load()};
+}
+} // namespace
+
+int RunSnapshotBench(const BenchOptions &options)
+{
+    const StressData data = BuildStressData(options.quick ? 200 : 2000);
+    const int maxThreads = options.quick ? 4 : 64;
+    const int durationMs = options.quick ? 100 : 500;
+
+    uint64_t errors = 0;
+    std::printf("threads  lock-free Mlookups/s (publishes)  mutex Mlookups/s (publishes)\n");
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        const RunResult lockFree = RunLockFree(data, threads, durationMs);
+        const RunResult locked = RunMutex(data, threads, durationMs);
+        errors += lockFree.errors + locked.errors;
+        std::printf("%7d  %12.2f (%6llu)                %12.2f (%6llu)\n", threads,
+                    lockFree.lookupsPerSec / 1e6, static_cast<unsigned long long>(lockFree.publishes),
+                    locked.lookupsPerSec / 1e6, static_cast<unsigned long long>(locked.publishes));
+    }
+
+    std::printf("stale or torn snapshot reads: %llu\n", static_cast<unsigned long long>(errors));
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+// Shell stats block: per-thread slots merged on read, histogram bucketing,
+// the per-process segment as an outside reader maps it, and what recording
+// costs the hot path.
+
+#include "BenchUtil.h"
+#include "SharedMemorySegment.h"
+#include "ShellStats.h"
+#include <memory>
+#include <thread>
+
+namespace
+{
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+struct StatsBlock
+{
+    std::unique_ptr<uint8_t[]> memory{new uint8_t[CShellStats::kBlockSize + 64]};
+    CShellStats stats;
+
+    StatsBlock()
+    {
+        // Slots are cache-line aligned, as in a mapped segment.
+        void *aligned = memory.get() + (64 - reinterpret_cast<uintptr_t>(memory.get()) % 64) % 64;
+        stats.Attach(aligned, CShellStats::kBlockSize, 42);
+    }
+};
+
+int CheckBuckets()
+{
+    int failures = Expect(ShellLatencyBucket(0) == 0 && ShellLatencyBucket(1) == 1, "0 and 1 ns buckets");
+    failures += Expect(ShellLatencyBucket(2) == 2 && ShellLatencyBucket(3) == 2 && ShellLatencyBucket(4) == 3,
+                       "power-of-two bucket edges");
+    failures += Expect(ShellLatencyBucket(1000) == 10, "1 us lands in [512, 1024)");
+    failures += Expect(ShellLatencyBucket(UINT64_MAX) == kShellStatsBucketCount - 1, "slow calls clamp to the last bucket");
+
+    ShellLatency latency;
+    latency.buckets[ShellLatencyBucket(100)] = 90;
+    latency.buckets[ShellLatencyBucket(5000)] = 9;
+    latency.buckets[ShellLatencyBucket(2000000)] = 1;
+    latency.count = 100;
+    failures += Expect(latency.PercentileNs(50) == 127 && latency.PercentileNs(90) == 127, "p50 and p90 bound");
+    failures += Expect(latency.PercentileNs(99) == 8191 && latency.PercentileNs(100) == 2097151, "p99 and max bound");
+    failures += Expect(ShellLatency().PercentileNs(50) == 0, "empty histogram");
+
+    failures += Expect(std::string(ShellCounterName(ShellCounter::InvokeFailures)) == "invoke_failures" &&
+                           std::string(ShellTimerName(ShellTimer::PublishWait)) == "publish_wait" &&
+                           std::string(ShellGaugeName(ShellGauge::LastReloadNs)) == "last_reload_ns",
+                       "stable names");
+    std::printf("buckets: %d failures\n", failures);
+    return failures;
+}
+
+// More threads than slots, so the last one is shared with atomic adds; the
+// merged totals must still be exact.
+int CheckMerge(bool quick)
+{
+    StatsBlock block;
+    const size_t threadCount = kShellStatsSlotCount + 8;
+    const uint64_t perThread = quick ? 20000 : 200000;
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back([&block, perThread, t]() {
+            for (uint64_t i = 0; i < perThread; i++)
+            {
+                block.stats.Count(ShellCounter::IsMemberOfCalls);
+                block.stats.Record(ShellTimer::IsMemberOf, (t + 1) * 100);
+            }
+        });
+    }
+
+    // Read while they write: totals only ever grow.
+    ShellStatsSnapshot previous;
+    int failures = 0;
+    for (int read = 0; read < 50; read++)
+    {
+        ShellStatsSnapshot current;
+        failures += Expect(block.stats.Read(current), "block readable");
+        failures += Expect(current.Counter(ShellCounter::IsMemberOfCalls) >=
+                               previous.Counter(ShellCounter::IsMemberOfCalls),
+                           "merged counter never goes back");
+        previous = current;
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    block.stats.SetGauge(ShellGauge::CoveringRoots, 1234);
+    ShellStatsSnapshot merged;
+    block.stats.Read(merged);
+    const uint64_t expected = threadCount * perThread;
+    uint64_t expectedNs = 0;
+    for (size_t t = 0; t < threadCount; t++)
+    {
+        expectedNs += (t + 1) * 100 * perThread;
+    }
+
+    const ShellLatency &latency = merged.Timer(ShellTimer::IsMemberOf);
+    failures += Expect(merged.Counter(ShellCounter::IsMemberOfCalls) == expected, "every count merged");
+    failures += Expect(latency.count == expected && latency.totalNs == expectedNs, "every sample merged");
+    failures += Expect(merged.Gauge(ShellGauge::CoveringRoots) == 1234 && merged.processId == 42, "gauges and pid");
+    failures += Expect(merged.Counter(ShellCounter::InvokeCalls) == 0 && merged.Timer(ShellTimer::Reload).count == 0,
+                       "untouched counters stay zero");
+
+    std::printf("%zu threads over %zu slots: %llu counts, %d failures\n", threadCount, kShellStatsSlotCount,
+                static_cast<unsigned long long>(merged.Counter(ShellCounter::IsMemberOfCalls)), failures);
+    return failures;
+}
+
+// What the app or a CLI does: map the process's block by pid, read-only.
+int CheckSegment()
+{
+    CShellStats &stats = ProcessShellStats();
+    stats.Count(ShellCounter::Reloads, 3);
+    stats.Record(ShellTimer::Reload, 250000);
+    stats.SetGauge(ShellGauge::SnapshotGeneration, 7);
+
+    CSharedMemorySegment segment;
+    ShellStatsSnapshot snapshot;
+    int failures = Expect(segment.OpenReadOnly(ShellStatsSegmentName(CurrentProcessId())), "segment opens by pid");
+    failures += Expect(ReadShellStats(segment.Data(), segment.Size(), snapshot), "segment holds a stats block");
+    failures += Expect(snapshot.processId == CurrentProcessId(), "block names its process");
+    failures += Expect(snapshot.Counter(ShellCounter::Reloads) >= 3 && snapshot.Timer(ShellTimer::Reload).count >= 1 &&
+                           snapshot.Gauge(ShellGauge::SnapshotGeneration) == 7,
+                       "reader sees what was recorded");
+
+    uint8_t garbage[CShellStats::kBlockSize] = {};
+    failures += Expect(!ReadShellStats(garbage, sizeof(garbage), snapshot), "zeroed memory is not a block");
+    failures += Expect(!ReadShellStats(segment.Data(), 64, snapshot), "truncated block rejected");
+
+    std::printf("segment %s: %d failures\n", ShellStatsSegmentName(CurrentProcessId()).c_str(), failures);
+    return failures;
+}
+
+double MeasureNsPerEvent(CShellStats &stats, size_t threadCount, uint64_t events, bool timed)
+{
+    CStopwatch timer;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back([&stats, events, timed]() {
+            for (uint64_t i = 0; i < events; i++)
+            {
+                if (timed)
+                {
+                    CShellStatsTimer scope(stats, ShellTimer::GetState);
+                    stats.Count(ShellCounter::GetStateCalls);
+                }
+                else
+                {
+                    stats.Count(ShellCounter::GetStateCalls);
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    // Cost per event on each thread, with the threads spread over the cores
+    // there are; matches the single-thread figure when slots do not contend.
+    const size_t cores = std::min<size_t>(threadCount, std::max(1u, std::thread::hardware_concurrency()));
+    return timer.ElapsedMs() * 1e6 * static_cast<double>(cores) / static_cast<double>(events * threadCount);
+}
+
+int ReportOverhead(const BenchOptions &options)
+{
+    const uint64_t events = options.quick ? 200000 : 5000000;
+    const size_t threadCount = 4;
+
+    StatsBlock block;
+    const double countNs = MeasureNsPerEvent(block.stats, 1, events, false);
+    const double timedNs = MeasureNsPerEvent(block.stats, 1, events, true);
+    const double parallelNs = MeasureNsPerEvent(block.stats, threadCount, events, true);
+
+    // Every thread past the exclusive slots lands on the shared one.
+    StatsBlock crowded;
+    for (size_t t = 0; t + 1 < kShellStatsSlotCount; t++)
+    {
+        std::thread([&crowded]() { crowded.stats.Count(ShellCounter::Reloads); }).join();
+    }
+    const double sharedNs = MeasureNsPerEvent(crowded.stats, threadCount, events, true);
+
+    std::printf("count %.1f ns, count + timed scope %.1f ns; %zu threads: own slots %.1f ns, shared slot %.1f ns\n",
+                countNs, timedNs, threadCount, parallelNs, sharedNs);
+    ReportMetric(options, "count", countNs, "ns");
+    ReportMetric(options, "count_and_timer", timedNs, "ns");
+    ReportMetric(options, "parallel_own_slots", parallelNs, "ns");
+    ReportMetric(options, "parallel_shared_slot", sharedNs, "ns");
+
+    ShellStatsSnapshot snapshot;
+    block.stats.Read(snapshot);
+    const uint64_t expected = events * (2 + threadCount);
+    return Expect(snapshot.Counter(ShellCounter::GetStateCalls) == expected, "overhead runs all counted");
+}
+} // namespace
+
+int RunStatsBench(const BenchOptions &options)
+{
+    int failures = CheckBuckets();
+    failures += CheckMerge(options.quick);
+    failures += CheckSegment();
+    failures += ReportOverhead(options);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,272 @@
+// Multi-state overlays: status file parsing, state resolution against a
+// reference scan, and one lookup per item however many handlers ask
+
+#include "BenchUtil.h"
+#include "OverlayStatus.h"
+#include "PathNormalize.h"
+#include "SyncedPathMatch.h"
+#include "SyncedPathTrie.h"
+
+namespace
+{
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+const OverlayState kHandlerStates[] = {OverlayState::Synced, OverlayState::Syncing, OverlayState::Error,
+                                       OverlayState::Pending};
+
+struct StatusEntry
+{
+    OverlayState state;
+    std::wstring path; // Normalized
+};
+
+// What the DLL's snapshot holds: synced roots plus the transient states.
+struct StatusFixture
+{
+    CSyncedPathTrie synced;
+    COverlayStatusSet status;
+
+    OverlayState Lookup(std::wstring_view rawPath) const
+    {
+        const CNormalizedPath target(rawPath);
+        const OverlayState state = status.Classify(target.View());
+        if (state != OverlayState::None)
+        {
+            return state;
+        }
+        return synced.Matches(target.View()) ? OverlayState::Synced : OverlayState::None;
+    }
+};
+
+int Rank(OverlayState state)
+{
+    switch (state)
+    {
+    case OverlayState::Error: return 4;
+    case OverlayState::Syncing: return 3;
+    case OverlayState::Pending: return 2;
+    case OverlayState::Synced: return 1;
+    default: return 0;
+    }
+}
+
+// Linear scan over every entry, keeping the highest-ranked state.
+OverlayState ReferenceState(const std::vector<std::wstring> &syncedRoots, const std::vector<StatusEntry> &entries,
+                            const std::wstring &rawPath)
+{
+    const std::wstring path = NormalizePath(rawPath);
+    OverlayState best = OverlayState::None;
+    for (const StatusEntry &entry : entries)
+    {
+        if (Rank(entry.state) > Rank(best) && IsSameOrChildPath(path, entry.path))
+        {
+            best = entry.state;
+        }
+    }
+    if (best == OverlayState::None)
+    {
+        for (const std::wstring &root : syncedRoots)
+        {
+            if (IsSameOrChildPath(path, root))
+            {
+                return OverlayState::Synced;
+            }
+        }
+    }
+    return best;
+}
+
+int CheckParse()
+{
+    COverlayStatusSet set;
+    const size_t added = set.Parse("\xEF\xBB\xBF"
+                                   "syncing\tC:\\Work\\Photos\r\n"
+                                   "error\tc:/work/photos/raw/IMG_1.jpg\n"
+                                   "pending\tD:\\Queue\\\n"
+                                   "synced\tC:\\Ignored\n"
+                                   "bogus\tC:\\Ignored\n"
+                                   "no tab here\n"
+                                   "\n"
+                                   "error\t\n"
+                                   "pending\tC:\\Work");
+
+    int failures = Expect(added == 4 && set.Size() == 4, "four transient entries parsed");
+    failures += Expect(set.Classify(L"c:\\work\\photos") == OverlayState::Syncing, "syncing folder");
+    failures += Expect(set.Classify(L"c:\\work\\photos\\a.txt") == OverlayState::Syncing, "syncing covers children");
+    failures += Expect(set.Classify(L"c:\\work\\photos\\raw\\img_1.jpg") == OverlayState::Error, "error beats syncing");
+    failures += Expect(set.Classify(L"c:\\work\\notes.txt") == OverlayState::Pending, "pending elsewhere in the folder");
+    failures += Expect(set.Classify(L"d:\\queue\\x") == OverlayState::Pending, "trailing separator trimmed");
+    failures += Expect(set.Classify(L"c:\\ignored") == OverlayState::None, "synced and unknown states ignored");
+    failures += Expect(set.Classify(L"c:\\workshop") == OverlayState::None, "sibling prefix not covered");
+    failures += Expect(ParseOverlayStateName(OverlayStateName(OverlayState::Pending)) == OverlayState::Pending,
+                       "state names round-trip");
+
+    COverlayStatusSet empty;
+    failures += Expect(empty.Parse("") == 0 && empty.Empty() && empty.Classify(L"c:\\a") == OverlayState::None,
+                       "empty file");
+    std::printf("parse: %d failures\n", failures);
+    return failures;
+}
+
+// Explorer's loop: every handler's IsMemberOf for each item, same thread.
+template <typename Resolve>
+size_t RunListing(const std::vector<std::wstring> &items, Resolve &&resolve, std::vector<OverlayState> *claimed)
+{
+    size_t claims = 0;
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        OverlayState owner = OverlayState::None;
+        for (OverlayState handler : kHandlerStates)
+        {
+            if (resolve(items[i]) == handler)
+            {
+                owner = handler;
+                claims++;
+            }
+        }
+        if (claimed)
+        {
+            (*claimed)[i] = owner;
+        }
+    }
+    return claims;
+}
+
+int CheckSharedLookup(CPathGenerator &gen, bool quick)
+{
+    const SyntheticIndex index = GenerateSyncedIndex(gen, quick ? 200 : 2000, 4);
+    std::vector<std::wstring> syncedRoots;
+    for (const std::wstring &folder : index.rawFolders)
+    {
+        syncedRoots.push_back(NormalizePath(folder));
+    }
+    ReduceToCoveringRoots(syncedRoots);
+
+    // Transient states on a slice of the synced folders and some of their
+    // children, plus a few paths outside any synced root.
+    StatusFixture fixture;
+    fixture.synced.Build(syncedRoots);
+    std::vector<StatusEntry> entries;
+    static const OverlayState kTransient[] = {OverlayState::Syncing, OverlayState::Error, OverlayState::Pending};
+    for (size_t i = 0; i < index.rawFolders.size() / 4; i++)
+    {
+        std::wstring path = index.rawFolders[gen.Next() % index.rawFolders.size()];
+        if (gen.Next() % 2 == 0)
+        {
+            path += L"\\" + gen.Component();
+        }
+        if (gen.Next() % 10 == 0)
+        {
+            path = gen.Path(2);
+        }
+        const StatusEntry entry{kTransient[gen.Next() % 3], NormalizePath(path)};
+        fixture.status.Add(entry.state, entry.path);
+        entries.push_back(entry);
+    }
+
+    const std::vector<std::wstring> items = GenerateQueries(gen, index, quick ? 20000 : 200000);
+
+    // Shared: one lookup per item, the other handlers compare.
+    OverlayQueryStats stats;
+    CLastOverlayQuery lastQuery(&stats);
+    std::vector<OverlayState> claimed(items.size());
+    CStopwatch sharedTimer;
+    const size_t sharedClaims = RunListing(
+        items, [&](const std::wstring &item) { return lastQuery.Resolve(1, item, [&]() { return fixture.Lookup(item); }); },
+        &claimed);
+    const double sharedMs = sharedTimer.ElapsedMs();
+
+    // Naive: every handler looks the item up itself.
+    size_t naiveLookups = 0;
+    CStopwatch naiveTimer;
+    const size_t naiveClaims = RunListing(
+        items,
+        [&](const std::wstring &item) {
+            naiveLookups++;
+            return fixture.Lookup(item);
+        },
+        nullptr);
+    const double naiveMs = naiveTimer.ElapsedMs();
+
+    int mismatches = 0;
+    size_t withState = 0;
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        const OverlayState expected = ReferenceState(syncedRoots, entries, items[i]);
+        withState += expected != OverlayState::None ? 1 : 0;
+        if (claimed[i] != expected)
+        {
+            if (mismatches++ < 5)
+            {
+                std::fprintf(stderr, "  %ls: %s, expected %s\n", items[i].c_str(), OverlayStateName(claimed[i]),
+                             OverlayStateName(expected));
+            }
+        }
+    }
+
+    // An item repeated back to back is answered from the last query too.
+    size_t distinctRuns = 0;
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        distinctRuns += (i == 0 || items[i] != items[i - 1]) ? 1 : 0;
+    }
+
+    const uint64_t lookups = stats.lookups.load();
+    const uint64_t shared = stats.shared.load();
+    int failures = mismatches;
+    failures += Expect(lookups == distinctRuns, "one lookup per item");
+    failures += Expect(lookups + shared == items.size() * 4, "other handlers answered from the last query");
+    failures += Expect(sharedClaims == withState && naiveClaims == withState, "at most one handler claims an item");
+
+    std::printf("%zu items x %zu handlers, %zu transient entries: %llu lookups shared, %zu naive\n", items.size(),
+                sizeof(kHandlerStates) / sizeof(kHandlerStates[0]), entries.size(),
+                static_cast<unsigned long long>(lookups), naiveLookups);
+    std::printf("shared %.1f ms, naive %.1f ms (%.1fx), %d mismatches\n", sharedMs, naiveMs, naiveMs / sharedMs, mismatches);
+    return failures;
+}
+
+int CheckInvalidation()
+{
+    OverlayQueryStats stats;
+    CLastOverlayQuery lastQuery(&stats);
+    OverlayState answer = OverlayState::Synced;
+    const auto lookup = [&]() { return answer; };
+
+    int failures = 0;
+    failures += Expect(lastQuery.Resolve(1, L"C:\\A", lookup) == OverlayState::Synced, "first lookup");
+    answer = OverlayState::Syncing;
+    failures += Expect(lastQuery.Resolve(1, L"C:\\A", lookup) == OverlayState::Synced, "same generation reuses");
+    failures += Expect(lastQuery.Resolve(2, L"C:\\A", lookup) == OverlayState::Syncing, "new generation looks up");
+    failures += Expect(lastQuery.Resolve(2, L"C:\\a", lookup) == OverlayState::Syncing && stats.lookups == 3,
+                       "raw paths differing in case look up again");
+    failures += Expect(lastQuery.Resolve(0, L"C:\\a", lookup) == OverlayState::Syncing && stats.lookups == 4,
+                       "generation 0 never cached");
+
+    const std::wstring longPath = L"C:\\" + std::wstring(CLastOverlayQuery::kMaxPathLength, L'x');
+    lastQuery.Resolve(2, longPath, lookup);
+    lastQuery.Resolve(2, longPath, lookup);
+    failures += Expect(stats.lookups == 6, "paths past the buffer are not cached");
+    failures += Expect(lastQuery.Resolve(2, L"C:\\a", lookup) == OverlayState::Syncing && stats.lookups == 7,
+                       "an uncached path drops the previous entry");
+
+    std::printf("invalidation: %d failures\n", failures);
+    return failures;
+}
+} // namespace
+
+int RunStatusBench(const BenchOptions &options)
+{
+    CPathGenerator gen(1111);
+    int failures = CheckParse();
+    failures += CheckInvalidation();
+    failures += CheckSharedLookup(gen, options.quick);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,422 @@
+// Sync database: random puts, deletes and prefix deletes against a plain
+// map (across reopens and compactions), recovery from torn and corrupt
+// batches, automatic compaction, and point update / prefix delete / reopen
+// times against rewriting every entry as one JSON file per change, the way
+// electron-store kept syncedItems.
+
+#include "BenchUtil.h"
+#include "SyncDatabase.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+
+namespace
+{
+namespace fs = std::filesystem;
+
+using Model = std::map<std::string, SyncDbEntry>;
+
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+std::string FolderKey(CPathGenerator &gen, size_t folders)
+{
+    return "c:\\users\\sam\\documents\\project" + std::to_string(gen.Next() % folders);
+}
+
+std::string FileKey(CPathGenerator &gen, size_t folders)
+{
+    return FolderKey(gen, folders) + "\\file" + std::to_string(gen.Next() % 64) + ".txt";
+}
+
+SyncDbEntry MakeEntry(CPathGenerator &gen, const std::string &key)
+{
+    SyncDbEntry entry;
+    const std::string id = "1" + std::to_string(gen.Next()) + "AbCdEfGhIjKlMnOpQrStUv";
+    if (gen.Next() % 8 != 0)
+    {
+        entry.link = "https://drive.google.com/file/d/" + id + "/view";
+    }
+    entry.data = "{\"driveId\":\"" + id + "\",\"type\":\"file\",\"syncedAt\":\"2026-10-17T09:30:00.000Z\"," +
+                 "\"localPath\":\"" + key + "\",\"sizeBytes\":" + std::to_string(gen.Next() % 100000) +
+                 ",\"mtimeMs\":1760693400000}";
+    return entry;
+}
+
+void ApplyToModel(Model &model, const SyncDbWrite &write)
+{
+    switch (write.op)
+    {
+    case SyncDbOp::Put:
+        model[write.key] = write.entry;
+        break;
+    case SyncDbOp::Delete:
+        model.erase(write.key);
+        break;
+    case SyncDbOp::DeletePrefix:
+        for (auto it = model.lower_bound(write.key);
+             it != model.end() && it->first.compare(0, write.key.size(), write.key) == 0;)
+        {
+            it = model.erase(it);
+        }
+        break;
+    }
+}
+
+bool Matches(const CSyncDatabase &db, const Model &model)
+{
+    const CSyncDatabase::Range all = db.PrefixRange("");
+    auto it = all.first;
+    for (const auto &[key, entry] : model)
+    {
+        if (it == all.second || it->first != key || it->second.link != entry.link || it->second.data != entry.data)
+        {
+            return false;
+        }
+        ++it;
+    }
+    return it == all.second && db.Size() == model.size();
+}
+
+std::vector<SyncDbWrite> RandomBatch(CPathGenerator &gen, size_t folders)
+{
+    std::vector<SyncDbWrite> writes(1 + gen.Next() % 40);
+    for (SyncDbWrite &write : writes)
+    {
+        const unsigned roll = gen.Next() % 100;
+        if (roll < 80)
+        {
+            write.key = FileKey(gen, folders);
+            write.entry = MakeEntry(gen, write.key);
+        }
+        else if (roll < 95)
+        {
+            write.op = SyncDbOp::Delete;
+            write.key = FileKey(gen, folders);
+        }
+        else
+        {
+            write.op = SyncDbOp::DeletePrefix;
+            write.key = FolderKey(gen, folders) + "\\";
+        }
+    }
+    return writes;
+}
+
+int CheckModel(const BenchOptions &options, const fs::path &file)
+{
+    CPathGenerator gen(61);
+    const size_t batches = options.quick ? 600 : 6000;
+    Model model;
+    CSyncDatabase db;
+    int failures = Expect(db.Open(file) && db.Size() == 0, "open a new database");
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < batches; i++)
+    {
+        const std::vector<SyncDbWrite> writes = RandomBatch(gen, 40);
+        size_t removed = 0;
+        const size_t before = model.size();
+        size_t puts = 0;
+        for (const SyncDbWrite &write : writes)
+        {
+            const bool isNew = write.op == SyncDbOp::Put && model.find(write.key) == model.end();
+            ApplyToModel(model, write);
+            puts += isNew ? 1 : 0;
+        }
+        failures += Expect(db.Apply(writes, &removed), "apply a batch");
+        mismatches += (before + puts - removed == model.size()) ? 0 : 1;
+
+        if (i % 97 == 0)
+        {
+            mismatches += Matches(db, model) ? 0 : 1;
+        }
+        if (i % 211 == 0)
+        {
+            db.Close();
+            failures += Expect(db.Open(file), "reopen");
+            mismatches += Matches(db, model) ? 0 : 1;
+        }
+        if (i % 307 == 0)
+        {
+            failures += Expect(db.Compact(), "compact");
+            mismatches += Matches(db, model) ? 0 : 1;
+        }
+    }
+    db.Close();
+    failures += Expect(db.Open(file) && Matches(db, model), "state after the last reopen");
+    failures += Expect(mismatches == 0, "entries and removed counts match the model");
+
+    // Prefix scans see exactly the folder's children.
+    const std::string prefix = "c:\\users\\sam\\documents\\project7\\";
+    const CSyncDatabase::Range range = db.PrefixRange(prefix);
+    const size_t scanned = static_cast<size_t>(std::distance(range.first, range.second));
+    size_t expected = 0;
+    for (const auto &item : model)
+    {
+        expected += item.first.compare(0, prefix.size(), prefix) == 0 ? 1 : 0;
+    }
+    failures += Expect(scanned == expected, "prefix range");
+    std::printf("model parity: %zu batches, %zu entries left; %d failures\n", batches, model.size(), failures);
+    return failures;
+}
+
+int CheckRecovery(const fs::path &file)
+{
+    CPathGenerator gen(62);
+    std::error_code ec;
+    fs::remove(file, ec);
+
+    std::vector<Model> states(1);
+    std::vector<uint64_t> sizes;
+    int failures = 0;
+    {
+        CSyncDatabase db;
+        failures += Expect(db.Open(file), "open");
+        sizes.push_back(db.Stats().logBytes);
+        for (int i = 0; i < 30; i++)
+        {
+            const std::vector<SyncDbWrite> writes = RandomBatch(gen, 6);
+            states.push_back(states.back());
+            for (const SyncDbWrite &write : writes)
+            {
+                ApplyToModel(states.back(), write);
+            }
+            failures += Expect(db.Apply(writes), "apply");
+            sizes.push_back(db.Stats().logBytes);
+        }
+    }
+    std::vector<uint8_t> image;
+    {
+        std::ifstream in(file, std::ios::binary);
+        image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    // Cut the file every 7 bytes inside a few batches: the batch vanishes,
+    // the ones before it stand.
+    size_t cuts = 0;
+    for (size_t batch : {1u, 13u, 30u})
+    {
+        for (uint64_t cut = sizes[batch - 1] + 1; cut < sizes[batch]; cut += 7)
+        {
+            {
+                std::ofstream out(file, std::ios::binary | std::ios::trunc);
+                out.write(reinterpret_cast<const char *>(image.data()), static_cast<std::streamsize>(cut));
+            }
+            CSyncDatabase db;
+            failures += Expect(db.Open(file) && Matches(db, states[batch - 1]), "torn batch dropped");
+            failures += Expect(db.Stats().droppedTailBytes == cut - sizes[batch - 1], "tail cut off");
+
+            // Appends after recovery follow the last valid batch.
+            const std::vector<SyncDbWrite> writes = RandomBatch(gen, 6);
+            Model model = states[batch - 1];
+            for (const SyncDbWrite &write : writes)
+            {
+                ApplyToModel(model, write);
+            }
+            failures += Expect(db.Apply(writes), "append after recovery");
+            db.Close();
+            failures += Expect(db.Open(file) && Matches(db, model), "recovered log reopens");
+            cuts++;
+        }
+    }
+
+    // A flipped byte inside batch 20 drops it and everything after.
+    image[sizes[19] + sizeof(SyncDbBatchHeader) + 5] ^= 0x40;
+    {
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(image.data()), static_cast<std::streamsize>(image.size()));
+    }
+    CSyncDatabase db;
+    failures += Expect(db.Open(file) && Matches(db, states[19]), "corrupt batch dropped");
+    db.Close();
+
+    // Not a sync database: refused, not overwritten.
+    {
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        out << "{\"syncedItems\":{}}";
+    }
+    failures += Expect(!db.Open(file) && fs::file_size(file, ec) == 18, "foreign file refused");
+    std::printf("recovery: %zu cut points, corrupt batch, foreign file; %d failures\n", cuts, failures);
+    return failures;
+}
+
+int CheckAutoCompaction(const BenchOptions &options, const fs::path &file)
+{
+    CPathGenerator gen(63);
+    std::error_code ec;
+    fs::remove(file, ec);
+
+    CSyncDatabase db;
+    int failures = Expect(db.Open(file), "open");
+    Model model;
+    const size_t rounds = options.quick ? 12 : 40;
+    uint64_t peakLog = 0;
+    for (size_t round = 0; round < rounds; round++)
+    {
+        // Rewrite the same 2000 entries, as every resync of a folder does.
+        std::vector<SyncDbWrite> writes(2000);
+        for (size_t i = 0; i < writes.size(); i++)
+        {
+            writes[i].key = "d:\\photos\\" + std::to_string(i) + ".jpg";
+            writes[i].entry = MakeEntry(gen, writes[i].key);
+            model[writes[i].key] = writes[i].entry;
+        }
+        failures += Expect(db.Apply(writes), "apply");
+        peakLog = std::max(peakLog, db.Stats().logBytes);
+    }
+    const SyncDbStats stats = db.Stats();
+    failures += Expect(stats.compactions > 0, "log compacted on its own");
+    failures += Expect(stats.logBytes <= std::max(kSyncDbCompactMinBytes, kSyncDbCompactRatio * stats.snapshotBytes) +
+                                             stats.snapshotBytes,
+                       "log stays within its bound");
+    db.Close();
+    failures += Expect(db.Open(file) && Matches(db, model), "compacted log reopens");
+    std::printf("auto compaction: %zu rewrites of %zu entries, %llu compactions, log %.1f MiB (peak %.1f); "
+                "%d failures\n",
+                rounds, model.size(), static_cast<unsigned long long>(stats.compactions),
+                static_cast<double>(stats.logBytes) / (1024.0 * 1024.0),
+                static_cast<double>(peakLog) / (1024.0 * 1024.0), failures);
+    return failures;
+}
+
+// Every entry serialized into one JSON object and written to a temp file that
+// replaces the store, as electron-store's set did.
+void RewriteWholeJson(const Model &model, const fs::path &file)
+{
+    std::string json = "{\"syncedItems\":{";
+    bool first = true;
+    for (const auto &[key, entry] : model)
+    {
+        json += first ? "\"" : ",\"";
+        json += key;
+        json += "\":";
+        json += entry.data;
+        first = false;
+    }
+    json += "}}";
+
+    fs::path temp = file;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(json.data(), static_cast<std::streamsize>(json.size()));
+    }
+    std::error_code ec;
+    fs::rename(temp, file, ec);
+}
+
+int TimeUpdates(const BenchOptions &options, const fs::path &root)
+{
+    CPathGenerator gen(64);
+    const size_t entries = options.quick ? 20000 : 200000;
+    const fs::path file = root / "timed.log";
+
+    CSyncDatabase db;
+    int failures = Expect(db.Open(file), "open");
+    Model model;
+    CStopwatch loadTimer;
+    std::vector<SyncDbWrite> writes;
+    for (size_t i = 0; i < entries; i++)
+    {
+        SyncDbWrite write;
+        write.key = "c:\\users\\sam\\documents\\project" + std::to_string(i / 500) + "\\file" + std::to_string(i) +
+                    ".txt";
+        write.entry = MakeEntry(gen, write.key);
+        model[write.key] = write.entry;
+        writes.push_back(std::move(write));
+        if (writes.size() == 500)
+        {
+            failures += Expect(db.Apply(writes), "bulk load");
+            writes.clear();
+        }
+    }
+    failures += Expect(db.Apply(writes), "bulk load");
+    const double loadMs = loadTimer.ElapsedMs();
+
+    const size_t updates = options.quick ? 2000 : 20000;
+    std::vector<double> updateUs;
+    updateUs.reserve(updates);
+    for (size_t i = 0; i < updates; i++)
+    {
+        std::vector<SyncDbWrite> one(1);
+        const size_t index = gen.Next() % entries;
+        one[0].key = "c:\\users\\sam\\documents\\project" + std::to_string(index / 500) + "\\file" +
+                     std::to_string(index) + ".txt";
+        one[0].entry = MakeEntry(gen, one[0].key);
+        model[one[0].key] = one[0].entry;
+        CStopwatch timer;
+        failures += Expect(db.Apply(one), "point update");
+        updateUs.push_back(timer.ElapsedMs() * 1000.0);
+    }
+    std::sort(updateUs.begin(), updateUs.end());
+
+    // untrackUnderPath of one 500-file folder.
+    std::vector<SyncDbWrite> untrack(2);
+    untrack[0].op = SyncDbOp::Delete;
+    untrack[0].key = "c:\\users\\sam\\documents\\project3";
+    untrack[1].op = SyncDbOp::DeletePrefix;
+    untrack[1].key = untrack[0].key + "\\";
+    size_t removed = 0;
+    CStopwatch prefixTimer;
+    failures += Expect(db.Apply(untrack, &removed) && removed == 500, "prefix delete");
+    const double prefixUs = prefixTimer.ElapsedMs() * 1000.0;
+    for (const SyncDbWrite &write : untrack)
+    {
+        ApplyToModel(model, write);
+    }
+
+    const SyncDbStats stats = db.Stats();
+    db.Close();
+    CStopwatch reopenTimer;
+    failures += Expect(db.Open(file), "reopen");
+    const double reopenMs = reopenTimer.ElapsedMs();
+    failures += Expect(Matches(db, model), "timed database matches");
+
+    const size_t rewrites = options.quick ? 3 : 10;
+    CStopwatch jsonTimer;
+    for (size_t i = 0; i < rewrites; i++)
+    {
+        RewriteWholeJson(model, root / "sync-db.json");
+    }
+    const double jsonMs = jsonTimer.ElapsedMs() / static_cast<double>(rewrites);
+
+    const double p50 = Percentile(updateUs, 50);
+    std::printf("%zu entries: load %.0f ms, update p50 %.1f us / p99 %.1f us (whole JSON rewrite %.1f ms, %.0fx), "
+                "prefix delete of 500 %.0f us, reopen %.0f ms, log %.1f MiB, %llu compactions; %d failures\n",
+                entries, loadMs, p50, Percentile(updateUs, 99), jsonMs, jsonMs * 1000.0 / p50, prefixUs, reopenMs,
+                static_cast<double>(stats.logBytes) / (1024.0 * 1024.0),
+                static_cast<unsigned long long>(stats.compactions), failures);
+    ReportMetric(options, "syncdb_update_p50_us", p50, "us");
+    ReportMetric(options, "syncdb_update_p99_us", Percentile(updateUs, 99), "us");
+    ReportMetric(options, "syncdb_json_rewrite_ms", jsonMs, "ms");
+    ReportMetric(options, "syncdb_prefix_delete_us", prefixUs, "us");
+    ReportMetric(options, "syncdb_reopen_ms", reopenMs, "ms");
+    return failures;
+}
+} // namespace
+
+int RunSyncDbBench(const BenchOptions &options)
+{
+    const fs::path root = fs::temp_directory_path() / "rrightclickrr-bench-syncdb";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root);
+
+    int failures = CheckModel(options, root / "model.log");
+    failures += CheckRecovery(root / "recovery.log");
+    failures += CheckAutoCompaction(options, root / "compact.log");
+    failures += TimeUpdates(options, root);
+
+    fs::remove_all(root, ec);
+    return failures;
+}
@@ -0,0 +1,219 @@
+// Streaming synced-paths.txt loader: parity with the whole-file loader under
+// arbitrary chunking, bounded memory on lists past the old 4 MiB cap, and
+// throughput
+
+#include "BenchUtil.h"
+#include "PathArena.h"
+#include "SyncedPathMatch.h"
+#include "Utf8.h"
+#include <algorithm>
+
+namespace
+{
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+std::string ToUtf8(const std::wstring &value)
+{
+    std::string utf8;
+    for (wchar_t ch : value)
+    {
+        const uint32_t cp = static_cast<uint32_t>(ch);
+        if (cp < 0x80)
+        {
+            utf8.push_back(static_cast<char>(cp));
+        }
+        else if (cp < 0x800)
+        {
+            utf8.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            utf8.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else
+        {
+            utf8.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            utf8.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            utf8.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+    return utf8;
+}
+
+// synced-paths.txt as the app writes it, with CRLF lines, blank lines and
+// multi-byte characters mixed in.
+std::string GenerateListFile(CPathGenerator &gen, size_t folderCount, size_t filesPerFolder)
+{
+    static const wchar_t *const kNonAscii[] = {L"\u00C4rger", L"\u0416\u0443\u0440", L"\u4E2D\u6587", L"Caf\u00E9"};
+    const SyntheticIndex index = GenerateSyncedIndex(gen, folderCount, filesPerFolder);
+
+    std::string text;
+    for (size_t i = 0; i < index.rawPaths.size(); i++)
+    {
+        std::wstring path = index.rawPaths[i];
+        if (gen.Next() % 8 == 0)
+        {
+            path += L'\\';
+            path += kNonAscii[gen.Next() % 4];
+        }
+        text += ToUtf8(path);
+        text += (gen.Next() % 5 == 0) ? "\r\n" : "\n";
+        if (gen.Next() % 50 == 0)
+        {
+            text += "\n";
+        }
+    }
+    return text;
+}
+
+// The loader as it was: decode the whole file, one std::wstring per line.
+std::vector<std::wstring> LoadWholeFile(const std::string &text)
+{
+    std::wstring content;
+    AppendUtf8AsWide(text, content);
+
+    std::vector<std::wstring> paths;
+    size_t start = 0;
+    while (start < content.length())
+    {
+        size_t end = content.find(L'\n', start);
+        if (end == std::wstring::npos)
+        {
+            end = content.length();
+        }
+
+        std::wstring line = content.substr(start, end - start);
+        if (!line.empty() && line.back() == L'\r')
+        {
+            line.pop_back();
+        }
+        if (!line.empty())
+        {
+            paths.push_back(NormalizePath(line));
+        }
+        start = end + 1;
+    }
+    ReduceToCoveringRoots(paths);
+    return paths;
+}
+
+bool SameRoots(const CPathArena &arena, const std::vector<std::wstring> &expected)
+{
+    if (arena.Size() != expected.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        if (arena[i] != expected[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void LoadInChunks(const std::string &text, size_t chunk, size_t reduceChars, CPathArena &arena)
+{
+    CSyncedPathListLoader loader(arena, reduceChars);
+    for (size_t offset = 0; offset < text.size(); offset += chunk)
+    {
+        loader.Feed(text.data() + offset, std::min(chunk, text.size() - offset));
+    }
+    loader.Finish();
+}
+
+int CheckChunkParity(CPathGenerator &gen)
+{
+    int failures = 0;
+    std::string text = "\xEF\xBB\xBF" + GenerateListFile(gen, 60, 6);
+    text += ToUtf8(L"C:\\No\\Trailing\\Newline\u00E9");
+    const std::vector<std::wstring> expected = LoadWholeFile(text.substr(3));
+
+    // Every chunk size from one byte up splits lines, CRLF pairs, multi-byte
+    // sequences and the byte order mark at different places; tiny reduce
+    // thresholds make the loader fold the arena many times on the way.
+    for (size_t chunk : {size_t(1), size_t(2), size_t(3), size_t(7), size_t(64), size_t(4096), text.size()})
+    {
+        for (size_t reduceChars : {size_t(16), size_t(1000), CSyncedPathListLoader::kDefaultReduceChars})
+        {
+            CPathArena arena;
+            LoadInChunks(text, chunk, reduceChars, arena);
+            if (!SameRoots(arena, expected))
+            {
+                std::fprintf(stderr, "  chunk %zu, reduce at %zu: %zu roots, expected %zu\n", chunk, reduceChars, arena.Size(),
+                             expected.size());
+                failures++;
+            }
+        }
+    }
+
+    CPathArena arena;
+    CSyncedPathListLoader loader(arena);
+    loader.Feed("\r\n\n", 3);
+    loader.Finish();
+    failures += Expect(arena.Empty() && loader.LineCount() == 0, "blank lines ignored");
+
+    // Binary search over the reduced arena agrees with a linear scan.
+    CPathArena roots;
+    for (const std::wstring &root : expected)
+    {
+        roots.Append(root);
+    }
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        const auto linear = std::find_if(expected.begin(), expected.end(),
+                                         [&](const std::wstring &root) { return !CoveringRootOrder(root, expected[i]); });
+        failures += roots.LowerBound(expected[i]) == static_cast<size_t>(linear - expected.begin()) ? 0 : 1;
+    }
+
+    std::printf("chunk parity: %zu roots from %zu bytes, %d failures\n", expected.size(), text.size(), failures);
+    return failures;
+}
+
+// A list well past the old cap: every root must load, while the arena never
+// holds more than a fraction of the decoded file.
+int CheckLargeList(CPathGenerator &gen, bool quick)
+{
+    const std::string text = GenerateListFile(gen, quick ? 2000 : 20000, quick ? 60 : 200);
+    const std::vector<std::wstring> expected = LoadWholeFile(text);
+
+    CPathArena arena;
+    CSyncedPathListLoader loader(arena);
+    CStopwatch timer;
+    const size_t kChunk = 64 * 1024; // Same as the overlay handler
+    for (size_t offset = 0; offset < text.size(); offset += kChunk)
+    {
+        loader.Feed(text.data() + offset, std::min(kChunk, text.size() - offset));
+    }
+    loader.Finish();
+    const double streamMs = timer.ElapsedMs();
+
+    CStopwatch wholeTimer;
+    const size_t wholeRoots = LoadWholeFile(text).size();
+    const double wholeMs = wholeTimer.ElapsedMs();
+
+    int failures = Expect(text.size() > 4 * 1024 * 1024, "list exceeds the old 4 MiB cap");
+    failures += Expect(SameRoots(arena, expected) && wholeRoots == expected.size(), "large list roots match");
+    failures += Expect(loader.PeakChars() * 2 < text.size(), "arena stays well below the file size");
+
+    std::printf("large list: %.1f MiB, %zu lines -> %zu roots, peak arena %.1f MiB\n", text.size() / 1048576.0,
+                loader.LineCount(), arena.Size(), loader.PeakChars() * sizeof(wchar_t) / 1048576.0);
+    std::printf("streaming %.1f ms (%.0f MiB/s), whole file %.1f ms\n", streamMs, text.size() / 1048576.0 / (streamMs / 1000),
+                wholeMs);
+    return failures;
+}
+} // namespace
+
+int RunTextLoaderBench(const BenchOptions &options)
+{
+    CPathGenerator gen(1010);
+    int failures = CheckChunkParity(gen);
+    failures += CheckLargeList(gen, options.quick);
+    return failures == 0 ? 0 : 1;
+}
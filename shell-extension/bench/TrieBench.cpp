@@ -0,0 +1,198 @@
+// Trie lookup vs. the reference linear IsSameOrChildPath scan
+
+#include "BenchUtil.h"
+#include "SyncedPathMatch.h"
+#include "SyncedPathTrie.h"
+
+namespace
+{
+bool LinearMatches(const std::vector<std::wstring> &roots, const std::wstring &path)
+{
+    for (const std::wstring &root : roots)
+    {
+        if (IsSameOrChildPath(path, root))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int CheckParity(const std::vector<std::wstring> &roots, const CSyncedPathTrie &trie, const std::vector<std::wstring> &queries)
+{
+    int mismatches = 0;
+    for (const std::wstring &query : queries)
+    {
+        const bool expected = LinearMatches(roots, query);
+        if (trie.Matches(query) != expected)
+        {
+            if (mismatches < 10)
+            {
+                std::fprintf(stderr, "  mismatch: \"%ls\" expected %d\n", query.c_str(), expected ? 1 : 0);
+            }
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+// Awkward roots that exercise every branch of IsSameOrChildPath.
+int RunEdgeCases()
+{
+    const wchar_t *const kRoots[] = {
+        L"c:\\", L"d:\\projects\\client-a", L"\\\\server\\share\\", L"ab\\", L"x", L"e:\\a\\\\b", L"f:",
+    };
+    const wchar_t *const kQueries[] = {
+        L"c:\\", L"c:", L"c:\\windows", L"c:\\\\", L"d:\\projects", L"d:\\projects\\client-a",
+        L"d:\\projects\\client-a\\x.txt", L"d:\\projects\\client-ab", L"d:\\projects\\client-a\\",
+        L"\\\\server\\share", L"\\\\server\\share\\", L"\\\\server\\share\\doc", L"\\\\server\\shared",
+        L"ab", L"ab\\", L"ab\\c", L"abc", L"x", L"x\\y", L"xy", L"e:\\a\\\\b", L"e:\\a\\\\b\\c",
+        L"e:\\a\\b", L"e:\\a\\", L"f:", L"f:\\", L"f:\\g", L"f:g", L"", L"\\",
+    };
+
+    std::vector<std::wstring> roots(std::begin(kRoots), std::end(kRoots));
+    std::vector<std::wstring> queries(std::begin(kQueries), std::end(kQueries));
+
+    int mismatches = 0;
+    // Each root on its own isolates its semantics; then all together.
+    for (const std::wstring &root : roots)
+    {
+        CSyncedPathTrie trie;
+        trie.Build({root});
+        mismatches += CheckParity({root}, trie, queries);
+    }
+
+    CSyncedPathTrie trie;
+    trie.Build(roots);
+    mismatches += CheckParity(roots, trie, queries);
+
+    // A lone "\" root matches every path that starts with a separator.
+    CSyncedPathTrie slashTrie;
+    slashTrie.Build({L"\\"});
+    mismatches += CheckParity({L"\\"}, slashTrie, queries);
+
+    std::printf("edge cases: %zu queries, %d mismatches\n", queries.size(), mismatches);
+    return mismatches;
+}
+
+// Random sets over labels that sort on both sides of the separator ("a-b",
+// "a b" and "a.txt" around "a\..."), with and without trailing separators.
+int CheckRootCoverEdgeCases()
+{
+    static const wchar_t *const kLabels[] = {L"a", L"a-b", L"a b", L"a.txt", L"ab", L"b", L""};
+    std::mt19937 rng(99);
+    auto randomPath = [&]() {
+        std::wstring path = (rng() % 2) ? L"c:" : L"a";
+        const size_t depth = rng() % 4;
+        for (size_t i = 0; i < depth; i++)
+        {
+            path += L'\\';
+            path += kLabels[rng() % (sizeof(kLabels) / sizeof(kLabels[0]))];
+        }
+        if (rng() % 5 == 0)
+        {
+            path += L'\\';
+        }
+        return path;
+    };
+
+    int mismatches = 0;
+    for (int round = 0; round < 300; round++)
+    {
+        std::vector<std::wstring> roots;
+        for (size_t i = rng() % 12; i > 0; i--)
+        {
+            roots.push_back(randomPath());
+        }
+        std::vector<std::wstring> reduced = roots;
+        ReduceToCoveringRoots(reduced);
+
+        for (int q = 0; q < 40; q++)
+        {
+            const std::wstring query = randomPath();
+            mismatches += LinearMatches(roots, query) != LinearMatches(reduced, query) ? 1 : 0;
+        }
+        // Minimal: no kept root may cover another.
+        for (size_t i = 0; i < reduced.size(); i++)
+        {
+            for (size_t j = 0; j < reduced.size(); j++)
+            {
+                mismatches += (i != j && IsSameOrChildPath(reduced[i], reduced[j])) ? 1 : 0;
+            }
+        }
+    }
+
+    std::printf("root cover edge cases: %d mismatches\n", mismatches);
+    return mismatches;
+}
+} // namespace
+
+int RunTrieBench(const BenchOptions &options)
+{
+    int mismatches = RunEdgeCases();
+    mismatches += CheckRootCoverEdgeCases();
+
+    const size_t folderCount = options.quick ? 200 : 10000;
+    const size_t filesPerFolder = 10;
+    const size_t parityQueries = options.quick ? 5000 : 2000;
+
+    CPathGenerator gen(1234);
+    const SyntheticIndex index = GenerateSyncedIndex(gen, folderCount, filesPerFolder);
+    std::vector<std::wstring> roots;
+    for (const std::wstring &path : index.rawPaths)
+    {
+        roots.push_back(NormalizePath(path));
+    }
+
+    std::vector<std::wstring> queries;
+    for (const std::wstring &query : GenerateQueries(gen, index, parityQueries))
+    {
+        queries.push_back(NormalizePath(query));
+    }
+
+    CStopwatch buildTimer;
+    CSyncedPathTrie trie;
+    trie.Build(roots);
+    const double buildMs = buildTimer.ElapsedMs();
+
+    CStopwatch linearTimer;
+    size_t linearHits = 0;
+    for (const std::wstring &query : queries)
+    {
+        linearHits += LinearMatches(roots, query) ? 1 : 0;
+    }
+    const double linearMs = linearTimer.ElapsedMs();
+
+    const int rounds = options.quick ? 1 : 200;
+    CStopwatch trieTimer;
+    size_t trieHits = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        for (const std::wstring &query : queries)
+        {
+            trieHits += trie.Matches(query) ? 1 : 0;
+        }
+    }
+    const double trieMs = trieTimer.ElapsedMs() / rounds;
+
+    const int scaleMismatches = CheckParity(roots, trie, queries);
+    mismatches += scaleMismatches;
+
+    CStopwatch reduceTimer;
+    std::vector<std::wstring> covering = roots;
+    ReduceToCoveringRoots(covering);
+    const double reduceMs = reduceTimer.ElapsedMs();
+    CSyncedPathTrie coveringTrie;
+    coveringTrie.Build(covering);
+    const int coverMismatches = CheckParity(roots, coveringTrie, queries);
+    mismatches += coverMismatches;
+
+    std::printf("roots: %zu (%zu trie nodes), build %.2f ms\n", trie.RootCount(), trie.NodeCount(), buildMs);
+    std::printf("linear: %.3f us/lookup (%zu hits)\n", linearMs * 1000.0 / queries.size(), linearHits);
+    std::printf("trie:   %.3f us/lookup (%zu hits)\n", trieMs * 1000.0 / queries.size(), trieHits / rounds);
+    std::printf("parity: %zu queries, %d mismatches\n", queries.size(), scaleMismatches);
+    std::printf("root cover: %zu -> %zu roots (%.1fx, %zu trie nodes) in %.2f ms, %d mismatches\n", roots.size(),
+                covering.size(), static_cast<double>(roots.size()) / (covering.empty() ? 1 : covering.size()),
+                coveringTrie.NodeCount(), reduceMs, coverMismatches);
+    return mismatches == 0 ? 0 : 1;
+}
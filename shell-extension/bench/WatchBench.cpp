@@ -0,0 +1,365 @@
+// Watcher coalescing: net change per path across create/modify/delete
+// sequences, directory changes covering their contents, the quiet window and
+// maxDelay, overflow rescans and folding at maxPending; then a synthetic
+// checkout-sized event storm through the coalescer, and a live watcher on a
+// temp folder.
+
+#include "BenchUtil.h"
+#include "ChangeWatcher.h"
+#include "DirectoryEnum.h"
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+namespace
+{
+namespace fs = std::filesystem;
+
+using Changes = std::map<std::string, ChangeKind>;
+
+int Expect(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "  failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+void Flatten(const ChangeBatch &batch, Changes &changes)
+{
+    for (const ChangeGroup &group : batch.groups)
+    {
+        for (const CoalescedChange &change : group.changes)
+        {
+            std::string path = group.directory;
+            if (!path.empty() && path.back() != kDirectorySeparator)
+            {
+                path += kDirectorySeparator;
+            }
+            changes[path + change.name] = change.kind;
+        }
+    }
+}
+
+bool TakeAll(CChangeCoalescer &coalescer, uint64_t nowMs, Changes &changes)
+{
+    ChangeBatch batch;
+    if (!coalescer.Take(nowMs, batch))
+    {
+        return false;
+    }
+    Flatten(batch, changes);
+    return true;
+}
+
+std::string P(const char *relative)
+{
+    std::string path = std::string(1, kDirectorySeparator) + "w";
+    for (const char *c = relative; *c; c++)
+    {
+        path += *c == '/' ? kDirectorySeparator : *c;
+    }
+    return path;
+}
+
+int CheckSemantics()
+{
+    int failures = 0;
+    ChangeCoalescerOptions options;
+    options.quietMs = 100;
+    options.maxDelayMs = 500;
+    CChangeCoalescer coalescer(options);
+
+    coalescer.Add(P("/created"), RawChangeOp::Created, false, 0);
+    coalescer.Add(P("/created"), RawChangeOp::Modified, false, 10);
+    coalescer.Add(P("/scratch"), RawChangeOp::Created, false, 10);
+    coalescer.Add(P("/scratch"), RawChangeOp::Deleted, false, 20);
+    coalescer.Add(P("/saved"), RawChangeOp::Deleted, false, 20);
+    coalescer.Add(P("/saved"), RawChangeOp::Created, false, 30);
+    coalescer.Add(P("/edited"), RawChangeOp::Modified, false, 30);
+    coalescer.Add(P("/edited"), RawChangeOp::Modified, false, 40);
+    coalescer.Add(P("/gone"), RawChangeOp::Deleted, false, 40);
+    coalescer.Add(P("/newdir"), RawChangeOp::Created, true, 40);
+    coalescer.Add(P("/newdir/inner"), RawChangeOp::Created, false, 45);
+    coalescer.Add(P("/newdir/inner"), RawChangeOp::Modified, false, 46);
+    coalescer.Add(P("/olddir/a"), RawChangeOp::Deleted, false, 50);
+    coalescer.Add(P("/olddir/b"), RawChangeOp::Deleted, false, 50);
+    coalescer.Add(P("/olddir"), RawChangeOp::Deleted, true, 50);
+    coalescer.Add(P("/olddir"), RawChangeOp::Modified, true, 50);
+    coalescer.Add(P("/sub/deep"), RawChangeOp::Modified, false, 50);
+
+    Changes changes;
+    failures += Expect(!TakeAll(coalescer, 100, changes), "nothing due inside the quiet window");
+    failures += Expect(coalescer.NextDueMs(100) == 50, "due when the folder is quiet");
+    failures += Expect(TakeAll(coalescer, 150, changes), "batch due after the quiet window");
+    const Changes expected = {
+        {P("/created"), ChangeKind::Added},           {P("/saved"), ChangeKind::Modified},
+        {P("/edited"), ChangeKind::Modified},         {P("/gone"), ChangeKind::Deleted},
+        {P("/newdir"), ChangeKind::DirectoryAdded},   {P("/olddir"), ChangeKind::DirectoryDeleted},
+        {P("/sub/deep"), ChangeKind::Modified},
+    };
+    failures += Expect(changes == expected, "one net change per path, directory changes cover their contents");
+    failures += Expect(coalescer.Pending() == 0 && coalescer.NextDueMs(150) == UINT32_MAX, "drained");
+    failures += Expect(coalescer.Stats().cancelled == 1 && coalescer.Stats().subsumed == 3,
+                       "cancel and subsume counts");
+
+    ChangeBatch batch;
+    coalescer.Add(P("/b/2"), RawChangeOp::Modified, false, 1000);
+    coalescer.Add(P("/a/1"), RawChangeOp::Modified, false, 1000);
+    coalescer.Add(P("/b/1"), RawChangeOp::Modified, false, 1000);
+    coalescer.Take(1100, batch);
+    failures += Expect(batch.groups.size() == 2 && batch.groups[0].directory == P("/a") &&
+                           batch.groups[1].changes.size() == 2 && batch.groups[1].changes[0].name == "1",
+                       "grouped by directory, in name order");
+
+    // A file written continuously must not hold back one that went quiet.
+    Changes early;
+    bool quietFileSeen = false;
+    coalescer.Add(P("/still"), RawChangeOp::Modified, false, 2000);
+    for (uint64_t now = 2000; now < 3000 && !quietFileSeen; now += 50)
+    {
+        coalescer.Add(P("/busy"), RawChangeOp::Modified, false, now);
+        TakeAll(coalescer, now, early);
+        quietFileSeen = early.count(P("/still")) != 0;
+        failures += Expect(early.count(P("/busy")) == 0, "busy file waits for its own quiet window");
+        if (quietFileSeen)
+        {
+            failures += Expect(now >= 2500 && now <= 2550, "quiet file handed out at maxDelay");
+        }
+    }
+    failures += Expect(quietFileSeen, "maxDelay bounds the wait in an event stream");
+    Changes late;
+    TakeAll(coalescer, 4000, late);
+    failures += Expect(late.size() == 1 && late.count(P("/busy")), "busy file follows once quiet");
+
+    // Overflow: one rescan, whatever was pending or arrives below is absorbed.
+    Changes rescan;
+    coalescer.Add(P("/big/x"), RawChangeOp::Created, false, 5000);
+    coalescer.Add(P("/other"), RawChangeOp::Created, false, 5000);
+    coalescer.AddOverflow(P("/big"), 5010);
+    coalescer.Add(P("/big/y/z"), RawChangeOp::Modified, false, 5020);
+    coalescer.AddOverflow(P("/big/y"), 5030);
+    TakeAll(coalescer, 5200, rescan);
+    const Changes expectedRescan = {{P("/big"), ChangeKind::Rescan}, {P("/other"), ChangeKind::Added}};
+    failures += Expect(rescan == expectedRescan, "overflow reported as one rescan of the subtree");
+
+    // A directory replaced by another is listed again.
+    Changes replaced;
+    coalescer.Add(P("/swap"), RawChangeOp::Deleted, true, 6000);
+    coalescer.Add(P("/swap"), RawChangeOp::Created, true, 6000);
+    TakeAll(coalescer, 6200, replaced);
+    failures += Expect(replaced.size() == 1 && replaced.begin()->second == ChangeKind::Rescan, "replaced directory");
+    return failures;
+}
+
+int CheckFolding()
+{
+    int failures = 0;
+    ChangeCoalescerOptions options;
+    options.quietMs = 100;
+    options.maxPending = 1000;
+    CChangeCoalescer coalescer(options);
+
+    std::vector<std::string> paths;
+    for (int i = 0; i < 5000; i++)
+    {
+        const std::string path = P("/storm/sub") + std::to_string(i % 10) + kDirectorySeparator + std::to_string(i);
+        paths.push_back(path);
+        coalescer.Add(path, RawChangeOp::Created, false, 0);
+    }
+    coalescer.Add(P("/calm"), RawChangeOp::Modified, false, 0);
+    failures += Expect(coalescer.Stats().peakPending <= options.maxPending + 1, "pending bounded by maxPending");
+    failures += Expect(coalescer.Stats().folds > 0, "busy directories folded");
+
+    Changes changes;
+    TakeAll(coalescer, 200, changes);
+    size_t covered = 0;
+    for (const std::string &path : paths)
+    {
+        bool found = changes.count(path) != 0;
+        for (std::string_view parent = ParentPath(path); !found && parent.size() > 1; parent = ParentPath(parent))
+        {
+            const auto it = changes.find(std::string(parent));
+            found = it != changes.end() && it->second == ChangeKind::Rescan;
+        }
+        covered += found ? 1 : 0;
+    }
+    failures += Expect(covered == paths.size(), "every folded change covered by a rescan");
+    failures += Expect(changes.count(P("/calm")) == 1, "unrelated change kept");
+    return failures;
+}
+
+// Checkout-shaped storm: most files rewritten through delete + create and a
+// few writes, some created and removed again, new directories filled.
+int CheckStorm(const BenchOptions &options)
+{
+    const size_t files = options.quick ? 20000 : 200000;
+    const size_t directories = files / 50;
+    CPathGenerator gen(25);
+    std::vector<RawChange> events;
+    events.reserve(files * 5);
+    for (size_t i = 0; i < files; i++)
+    {
+        const std::string path = P("/repo/src/module") + std::to_string(i % directories) + kDirectorySeparator +
+                                 "file" + std::to_string(i) + ".cpp";
+        switch (gen.Next() % 4)
+        {
+        case 0:
+            events.push_back({path, RawChangeOp::Created, false});
+            events.push_back({path, RawChangeOp::Deleted, false});
+            break;
+        case 1:
+            events.push_back({path, RawChangeOp::Deleted, false});
+            events.push_back({path, RawChangeOp::Created, false});
+            events.push_back({path, RawChangeOp::Modified, false});
+            break;
+        default:
+            for (unsigned writes = 1 + gen.Next() % 4; writes > 0; writes--)
+            {
+                events.push_back({path, RawChangeOp::Modified, false});
+            }
+            break;
+        }
+    }
+    for (size_t i = 0; i < directories / 10; i++)
+    {
+        const std::string directory = P("/repo/generated") + std::to_string(i);
+        events.push_back({directory, RawChangeOp::Created, true});
+        for (int f = 0; f < 20; f++)
+        {
+            events.push_back({directory + kDirectorySeparator + std::to_string(f), RawChangeOp::Created, false});
+            events.push_back({directory + kDirectorySeparator + std::to_string(f), RawChangeOp::Modified, false});
+        }
+    }
+    // Events of a checkout arrive interleaved across files.
+    for (size_t i = events.size() - 1; i > 0; i--)
+    {
+        std::swap(events[i], events[gen.Next() % (i + 1)]);
+    }
+
+    ChangeCoalescerOptions coalescerOptions;
+    coalescerOptions.quietMs = 2000;
+    CChangeCoalescer coalescer(coalescerOptions);
+    Changes changes;
+    CStopwatch timer;
+    uint64_t now = 0;
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        now = i / 1000; // A thousand events per millisecond
+        coalescer.Add(events[i].path, events[i].op, events[i].directory, now);
+    }
+    const double addMs = timer.ElapsedMs();
+    CStopwatch takeTimer;
+    TakeAll(coalescer, now + coalescerOptions.quietMs, changes);
+    const double takeMs = takeTimer.ElapsedMs();
+
+    const ChangeCoalescerStats &stats = coalescer.Stats();
+    int failures = 0;
+    failures += Expect(stats.events == events.size(), "every event counted");
+    failures += Expect(stats.emitted == changes.size() && stats.batches == 1, "storm handed out as one batch");
+    failures += Expect(changes.size() < files, "storm coalesced below one change per file");
+
+    const double eventsPerSecond = static_cast<double>(events.size()) / ((addMs + takeMs) / 1000.0);
+    std::printf("%zu raw events -> %zu changes in 1 batch (%llu cancelled, %llu under new directories): %.1f ms add, "
+                "%.1f ms take, %.1f M events/s; %d failures\n",
+                events.size(), changes.size(), static_cast<unsigned long long>(stats.cancelled),
+                static_cast<unsigned long long>(stats.subsumed), addMs, takeMs, eventsPerSecond / 1e6, failures);
+    ReportMetric(options, "watch_storm_events", static_cast<double>(events.size()), "events");
+    ReportMetric(options, "watch_storm_changes", static_cast<double>(changes.size()), "changes");
+    ReportMetric(options, "watch_storm_events_per_s", eventsPerSecond, "events/s");
+    return failures;
+}
+
+void WriteFile(const fs::path &path, const char *text)
+{
+    std::ofstream(path, std::ios::binary) << text;
+}
+
+int CheckLiveWatcher()
+{
+    const fs::path root = fs::temp_directory_path() / "rrightclickrr-bench-watch";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root / "existing");
+    fs::create_directories(root / "node_modules");
+    WriteFile(root / "existing" / "kept.txt", "v1");
+    WriteFile(root / "existing" / "removed.txt", "v1");
+
+    ChangeWatchOptions watchOptions;
+    watchOptions.coalescer.quietMs = 250; // Wide enough that the writes below land in one window
+    watchOptions.skipDirectoryNames = {"node_modules"};
+    watchOptions.skipFileSuffixes = {".tmp", "~"};
+
+    std::mutex mutex;
+    std::condition_variable arrived;
+    Changes changes;
+    CChangeWatcher watcher;
+    int failures = 0;
+    const bool started = watcher.Start(root.string(), watchOptions, [&](ChangeBatch &&batch) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Flatten(batch, changes);
+        arrived.notify_all();
+    });
+    failures += Expect(started, "watcher started");
+    if (!started)
+    {
+        return failures;
+    }
+
+    WriteFile(root / "existing" / "kept.txt", "v2");
+    WriteFile(root / "existing" / "kept.txt", "v3");
+    fs::remove(root / "existing" / "removed.txt");
+    WriteFile(root / "new.txt", "new");
+    WriteFile(root / "scratch.txt", "scratch");
+    fs::remove(root / "scratch.txt");
+    WriteFile(root / ".hidden", "x");
+    WriteFile(root / "download.tmp", "x");
+    WriteFile(root / "node_modules" / "dep.js", "x");
+    fs::create_directories(root / "added" / "nested");
+    WriteFile(root / "added" / "nested" / "inside.txt", "x");
+
+    const std::string base = root.string();
+    const Changes expected = {
+        {base + kDirectorySeparator + "added", ChangeKind::DirectoryAdded},
+        {(root / "existing" / "kept.txt").string(), ChangeKind::Modified},
+        {(root / "existing" / "removed.txt").string(), ChangeKind::Deleted},
+        {base + kDirectorySeparator + "new.txt", ChangeKind::Added},
+    };
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        arrived.wait_for(lock, std::chrono::seconds(5), [&] { return changes.size() >= expected.size(); });
+    }
+    // Anything further would have come within another quiet window.
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    watcher.Stop();
+
+    failures += Expect(changes == expected, "live changes coalesced, filtered and grouped");
+    for (const auto &[path, kind] : changes)
+    {
+        if (expected.count(path) == 0)
+        {
+            std::fprintf(stderr, "  unexpected: %s (%d)\n", path.c_str(), static_cast<int>(kind));
+        }
+    }
+    const ChangeCoalescerStats stats = watcher.Stats();
+    std::printf("live watcher: %llu raw events -> %llu changes in %llu batches\n",
+                static_cast<unsigned long long>(stats.events), static_cast<unsigned long long>(stats.emitted),
+                static_cast<unsigned long long>(stats.batches));
+    fs::remove_all(root, ec);
+    return failures;
+}
+} // namespace
+
+int RunWatchBench(const BenchOptions &options)
+{
+    int failures = CheckSemantics();
+    failures += CheckFolding();
+    std::printf("coalescing semantics and folding: %d failures\n", failures);
+    failures += CheckStorm(options);
+    failures += CheckLiveWatcher();
+    return failures;
+}
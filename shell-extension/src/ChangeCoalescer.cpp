@@ -0,0 +1,406 @@
+// RRightclickrr watcher event coalescing
+
+#include "ChangeCoalescer.h"
+#include <algorithm>
+#include <unordered_set>
+
+namespace
+{
+#ifdef _WIN32
+constexpr char kSeparators[] = "\\/";
+#else
+constexpr char kSeparators[] = "/";
+#endif
+
+// Folding stops once the pending paths are back under this share of
+// maxPending, so a storm does not fold on every event past the limit.
+constexpr size_t kFoldTargetPercent = 75;
+
+// A directory folds only if it stands for at least this many pending paths;
+// otherwise the count moves up a level.
+constexpr size_t kMinFoldPaths = 16;
+constexpr size_t kMaxFoldLevels = 8;
+
+std::string_view LeafName(std::string_view path)
+{
+    const size_t separator = path.find_last_of(kSeparators);
+    return separator == std::string_view::npos ? path : path.substr(separator + 1);
+}
+
+bool IsUnder(std::string_view path, std::string_view directory)
+{
+    return path.size() > directory.size() && path.compare(0, directory.size(), directory) == 0 &&
+           (std::string_view(kSeparators).find(path[directory.size()]) != std::string_view::npos ||
+            std::string_view(kSeparators).find(directory.back()) != std::string_view::npos);
+}
+
+struct ReadyChange
+{
+    std::string path;
+    ChangeKind kind;
+};
+
+// Sorting these rather than the changes keeps the comparisons in one
+// contiguous array.
+struct GroupKey
+{
+    std::string_view directory;
+    std::string_view name;
+    ChangeKind kind;
+};
+
+bool IsDirectoryKind(ChangeKind kind)
+{
+    return kind == ChangeKind::DirectoryAdded || kind == ChangeKind::DirectoryDeleted || kind == ChangeKind::Rescan;
+}
+} // namespace
+
+std::string_view ParentPath(std::string_view path)
+{
+    const size_t separator = path.find_last_of(kSeparators);
+    if (separator == std::string_view::npos)
+    {
+        return {};
+    }
+    // The filesystem root keeps its separator.
+    return path.substr(0, separator == 0 ? 1 : separator);
+}
+
+CChangeCoalescer::CChangeCoalescer(ChangeCoalescerOptions options) : m_options(options)
+{
+}
+
+CChangeCoalescer::PendingChange *CChangeCoalescer::FindRescanAbove(std::string_view path)
+{
+    if (m_rescans == 0)
+    {
+        return nullptr;
+    }
+    for (std::string_view parent = ParentPath(path); !parent.empty(); path = parent, parent = ParentPath(parent))
+    {
+        if (parent == path)
+        {
+            break;
+        }
+        m_probe.assign(parent.data(), parent.size());
+        const auto it = m_pending.find(m_probe);
+        if (it != m_pending.end() && it->second.rescan)
+        {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+void CChangeCoalescer::Insert(const std::string &path, const PendingChange &change)
+{
+    if (m_pending.empty())
+    {
+        m_nextQuietMs = change.lastMs + m_options.quietMs;
+    }
+    m_oldestMs = std::min(m_oldestMs, change.firstMs);
+    m_pending[path] = change;
+    m_rescans += change.rescan ? 1 : 0;
+    m_stats.peakPending = std::max<uint64_t>(m_stats.peakPending, m_pending.size());
+}
+
+void CChangeCoalescer::Add(const std::string &path, RawChangeOp op, bool directory, uint64_t nowMs)
+{
+    m_stats.events++;
+    m_lastEventMs = nowMs;
+    if (PendingChange *rescan = FindRescanAbove(path))
+    {
+        rescan->lastMs = nowMs;
+        m_stats.absorbed++;
+        return;
+    }
+
+    const auto it = m_pending.find(path);
+    if (it == m_pending.end())
+    {
+        if (directory && op == RawChangeOp::Modified)
+        {
+            return;
+        }
+        Insert(path, {nowMs, nowMs, op != RawChangeOp::Created, op != RawChangeOp::Deleted, directory, false});
+        if (m_pending.size() > m_options.maxPending)
+        {
+            Fold(nowMs);
+        }
+        return;
+    }
+
+    PendingChange &change = it->second;
+    change.lastMs = nowMs;
+    m_stats.absorbed++;
+    if (change.rescan || (directory && op == RawChangeOp::Modified))
+    {
+        return;
+    }
+    change.existsNow = op != RawChangeOp::Deleted;
+    change.directory = directory;
+}
+
+void CChangeCoalescer::AddOverflow(const std::string &directory, uint64_t nowMs)
+{
+    m_lastEventMs = nowMs;
+    if (PendingChange *rescan = FindRescanAbove(directory))
+    {
+        rescan->lastMs = nowMs;
+        return;
+    }
+    StartRescan(directory, nowMs);
+}
+
+void CChangeCoalescer::StartRescan(const std::string &directory, uint64_t nowMs)
+{
+    for (auto it = m_pending.begin(); it != m_pending.end();)
+    {
+        if (it->first == directory || IsUnder(it->first, directory))
+        {
+            m_rescans -= it->second.rescan ? 1 : 0;
+            m_stats.absorbed++;
+            it = m_pending.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    Insert(directory, {nowMs, nowMs, true, true, true, true});
+    m_stats.rescans++;
+}
+
+void CChangeCoalescer::Fold(uint64_t nowMs)
+{
+    const size_t target = m_options.maxPending * kFoldTargetPercent / 100;
+    for (size_t level = 1; level <= kMaxFoldLevels && m_pending.size() > target; level++)
+    {
+        // Pending paths per ancestor this many levels up.
+        std::unordered_map<std::string_view, size_t> counts;
+        for (const auto &[path, change] : m_pending)
+        {
+            std::string_view ancestor = path;
+            for (size_t i = 0; i < level && !ancestor.empty(); i++)
+            {
+                const std::string_view parent = ParentPath(ancestor);
+                ancestor = parent == ancestor ? std::string_view() : parent;
+            }
+            if (!ancestor.empty() && !change.rescan)
+            {
+                counts[ancestor]++;
+            }
+        }
+        // Paths of different depths meet at different levels; a candidate
+        // with a deeper one beneath it waits for a later level, so a folder
+        // of new directories does not fold the whole tree.
+        std::unordered_set<std::string_view> covering;
+        for (const auto &[directory, count] : counts)
+        {
+            if (count < kMinFoldPaths)
+            {
+                continue;
+            }
+            std::string_view path = directory;
+            for (std::string_view parent = ParentPath(path); !parent.empty() && parent != path;
+                 path = parent, parent = ParentPath(parent))
+            {
+                covering.insert(parent);
+            }
+        }
+        std::vector<std::pair<size_t, std::string>> candidates;
+        for (const auto &[directory, count] : counts)
+        {
+            if (count >= kMinFoldPaths && !covering.count(directory))
+            {
+                candidates.emplace_back(count, std::string(directory));
+            }
+        }
+        if (candidates.empty())
+        {
+            continue;
+        }
+
+        // Busiest first, until enough would be folded; then one sweep drops
+        // everything beneath the chosen directories.
+        std::sort(candidates.begin(), candidates.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+        std::unordered_set<std::string_view> folded; // Into candidates
+        size_t remaining = m_pending.size();
+        for (const auto &[count, directory] : candidates)
+        {
+            if (remaining <= target)
+            {
+                break;
+            }
+            folded.insert(directory);
+            remaining -= count - 1;
+        }
+        const auto foldedAbove = [&](std::string_view path) {
+            for (std::string_view parent = ParentPath(path); !parent.empty() && parent != path;
+                 path = parent, parent = ParentPath(parent))
+            {
+                if (folded.count(parent))
+                {
+                    return true;
+                }
+            }
+            return false;
+        };
+        for (auto it = m_pending.begin(); it != m_pending.end();)
+        {
+            if (folded.count(it->first) || foldedAbove(it->first))
+            {
+                m_rescans -= it->second.rescan ? 1 : 0;
+                m_stats.absorbed++;
+                it = m_pending.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        for (const std::string_view directory : folded)
+        {
+            if (!foldedAbove(directory))
+            {
+                Insert(std::string(directory), {nowMs, nowMs, true, true, true, true});
+                m_stats.rescans++;
+                m_stats.folds++;
+            }
+        }
+    }
+}
+
+bool CChangeCoalescer::Take(uint64_t nowMs, ChangeBatch &batch)
+{
+    batch.groups.clear();
+    if (m_pending.empty())
+    {
+        return false;
+    }
+    const bool quiet = nowMs - m_lastEventMs >= m_options.quietMs;
+    const bool overdue = nowMs - m_oldestMs >= m_options.maxDelayMs && nowMs >= m_nextQuietMs;
+    if (!quiet && !overdue)
+    {
+        return false;
+    }
+
+    std::vector<ReadyChange> ready;
+    uint64_t oldest = UINT64_MAX;
+    uint64_t nextQuiet = UINT64_MAX;
+    for (auto it = m_pending.begin(); it != m_pending.end();)
+    {
+        const PendingChange change = it->second;
+        if (nowMs - change.lastMs < m_options.quietMs)
+        {
+            oldest = std::min(oldest, change.firstMs);
+            nextQuiet = std::min(nextQuiet, change.lastMs + m_options.quietMs);
+            ++it;
+            continue;
+        }
+
+        auto node = m_pending.extract(it++);
+        m_rescans -= change.rescan ? 1 : 0;
+        ChangeKind kind;
+        if (change.rescan || (change.directory && change.existedBefore && change.existsNow))
+        {
+            kind = ChangeKind::Rescan;
+        }
+        else if (!change.existedBefore && !change.existsNow)
+        {
+            m_stats.cancelled++;
+            continue;
+        }
+        else if (change.directory)
+        {
+            kind = change.existsNow ? ChangeKind::DirectoryAdded : ChangeKind::DirectoryDeleted;
+        }
+        else
+        {
+            kind = !change.existedBefore ? ChangeKind::Added
+                   : change.existsNow    ? ChangeKind::Modified
+                                         : ChangeKind::Deleted;
+        }
+        ready.push_back({std::move(node.key()), kind});
+    }
+    m_oldestMs = oldest;
+    m_nextQuietMs = nextQuiet == UINT64_MAX ? 0 : nextQuiet;
+
+    // Whatever happened beneath a directory that is added, deleted or
+    // rescanned in this batch is covered by that change.
+    std::unordered_set<std::string_view> directories;
+    for (const ReadyChange &change : ready)
+    {
+        if (IsDirectoryKind(change.kind))
+        {
+            directories.insert(change.path);
+        }
+    }
+    if (!directories.empty())
+    {
+        const auto covered = [&](const ReadyChange &change) {
+            std::string_view path = change.path;
+            for (std::string_view parent = ParentPath(path); !parent.empty() && parent != path;
+                 path = parent, parent = ParentPath(parent))
+            {
+                if (directories.count(parent))
+                {
+                    return true;
+                }
+            }
+            return false;
+        };
+        std::vector<ReadyChange> kept;
+        kept.reserve(ready.size());
+        for (ReadyChange &change : ready)
+        {
+            if (covered(change))
+            {
+                m_stats.subsumed++;
+            }
+            else
+            {
+                kept.push_back(std::move(change));
+            }
+        }
+        ready.swap(kept);
+    }
+    if (ready.empty())
+    {
+        return false;
+    }
+
+    std::vector<GroupKey> keys;
+    keys.reserve(ready.size());
+    for (const ReadyChange &change : ready)
+    {
+        keys.push_back({ParentPath(change.path), LeafName(change.path), change.kind});
+    }
+    std::sort(keys.begin(), keys.end(), [](const GroupKey &a, const GroupKey &b) {
+        const int order = a.directory.compare(b.directory);
+        return order != 0 ? order < 0 : a.name < b.name;
+    });
+    for (const GroupKey &key : keys)
+    {
+        if (batch.groups.empty() || batch.groups.back().directory != key.directory)
+        {
+            batch.groups.push_back({std::string(key.directory), {}});
+        }
+        batch.groups.back().changes.push_back({std::string(key.name), key.kind});
+    }
+    m_stats.emitted += ready.size();
+    m_stats.batches++;
+    return true;
+}
+
+uint32_t CChangeCoalescer::NextDueMs(uint64_t nowMs) const
+{
+    if (m_pending.empty())
+    {
+        return UINT32_MAX;
+    }
+    const uint64_t quietAt = m_lastEventMs + m_options.quietMs;
+    const uint64_t overdueAt = std::max(m_oldestMs + m_options.maxDelayMs, m_nextQuietMs);
+    const uint64_t due = std::min(quietAt, overdueAt);
+    return due <= nowMs ? 0 : static_cast<uint32_t>(std::min<uint64_t>(due - nowMs, UINT32_MAX - 1));
+}
@@ -0,0 +1,131 @@
+// RRightclickrr watcher event coalescing
+//
+// Folds the raw create/modify/delete events of a watched folder into one net
+// change per path and hands them out in batches grouped by directory. A path
+// created and deleted within the window disappears; deleted and recreated
+// (an editor's atomic save) is a modify. Changes beneath a directory that
+// was added, deleted or needs a rescan are left to that directory.
+//
+// A batch is due once the folder has been quiet for quietMs, or once the
+// oldest pending change is maxDelayMs old; either way only paths quiet for
+// quietMs themselves are handed out, so a file still being written waits.
+// Past maxPending paths, the busiest directory is folded into one rescan
+// instead of dropping events; a watcher that overflows does the same for
+// the subtree it lost track of.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+enum class RawChangeOp : uint8_t
+{
+    Created,  // Also a rename's new name
+    Modified,
+    Deleted,  // Also a rename's old name
+};
+
+enum class ChangeKind : uint8_t
+{
+    Added,
+    Modified,
+    Deleted,
+    DirectoryAdded,
+    DirectoryDeleted,
+    Rescan, // Events under the directory were lost; list it again
+};
+
+struct ChangeCoalescerOptions
+{
+    uint32_t quietMs = 2000;
+    uint32_t maxDelayMs = 10000;
+    size_t maxPending = 100000;
+};
+
+struct CoalescedChange
+{
+    std::string name; // Within ChangeGroup::directory
+    ChangeKind kind;
+};
+
+struct ChangeGroup
+{
+    std::string directory;
+    std::vector<CoalescedChange> changes; // In name order
+};
+
+struct ChangeBatch
+{
+    std::vector<ChangeGroup> groups; // In directory order
+};
+
+struct ChangeCoalescerStats
+{
+    uint64_t events = 0;
+    uint64_t absorbed = 0;  // Merged into a pending change or rescan
+    uint64_t cancelled = 0; // Created and deleted within the window
+    uint64_t subsumed = 0;  // Left to a directory change in the same batch
+    uint64_t emitted = 0;
+    uint64_t batches = 0;
+    uint64_t rescans = 0;   // Overflows plus folds
+    uint64_t folds = 0;     // Directories folded at maxPending
+    uint64_t peakPending = 0;
+};
+
+// Directory part of path ("" for a bare name); both separators count on
+// Windows, only '/' elsewhere.
+std::string_view ParentPath(std::string_view path);
+
+class CChangeCoalescer
+{
+public:
+    explicit CChangeCoalescer(ChangeCoalescerOptions options = {});
+
+    // path is absolute; directory tells whether it names a directory.
+    // Modifications of directories are ignored.
+    void Add(const std::string &path, RawChangeOp op, bool directory, uint64_t nowMs);
+
+    // The watcher lost events under directory: drop what is pending there and
+    // report it as one Rescan.
+    void AddOverflow(const std::string &directory, uint64_t nowMs);
+
+    // Moves the changes that are due into batch (cleared first); false when
+    // none are.
+    bool Take(uint64_t nowMs, ChangeBatch &batch);
+
+    // Milliseconds until Take may have something, or UINT32_MAX when nothing
+    // is pending; for the watcher's wait.
+    uint32_t NextDueMs(uint64_t nowMs) const;
+
+    size_t Pending() const { return m_pending.size(); }
+    const ChangeCoalescerStats &Stats() const { return m_stats; }
+
+private:
+    struct PendingChange
+    {
+        uint64_t firstMs;
+        uint64_t lastMs;
+        bool existedBefore;
+        bool existsNow;
+        bool directory;
+        bool rescan;
+    };
+
+    PendingChange *FindRescanAbove(std::string_view path);
+    void Insert(const std::string &path, const PendingChange &change);
+    void StartRescan(const std::string &directory, uint64_t nowMs);
+    void Fold(uint64_t nowMs);
+
+    ChangeCoalescerOptions m_options;
+    std::unordered_map<std::string, PendingChange> m_pending;
+    size_t m_rescans = 0; // Pending entries with rescan set
+    uint64_t m_lastEventMs = 0;
+    uint64_t m_oldestMs = UINT64_MAX; // Earliest firstMs pending
+    uint64_t m_nextQuietMs = 0;       // No pending path is quiet before this
+    ChangeCoalescerStats m_stats;
+    std::string m_probe; // Reused for ancestor lookups
+};
@@ -0,0 +1,154 @@
+// RRightclickrr synced folder watcher
+
+#include "ChangeWatcher.h"
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+#ifdef _WIN32
+constexpr std::string_view kSeparators = "\\/";
+#else
+constexpr std::string_view kSeparators = "/";
+#endif
+
+uint64_t NowMs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+bool EndsWith(std::string_view name, std::string_view suffix)
+{
+    return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+} // namespace
+
+bool IsWatchPathSkipped(std::string_view relativePath, bool directory, const ChangeWatchOptions &options)
+{
+    size_t start = 0;
+    while (start < relativePath.size())
+    {
+        size_t end = relativePath.find_first_of(kSeparators, start);
+        const bool last = end == std::string_view::npos;
+        end = last ? relativePath.size() : end;
+        const std::string_view name = relativePath.substr(start, end - start);
+        start = end + 1;
+        if (name.empty())
+        {
+            continue;
+        }
+        if (options.skipDotNames && name[0] == '.')
+        {
+            return true;
+        }
+        if (!last || directory)
+        {
+            if (std::find(options.skipDirectoryNames.begin(), options.skipDirectoryNames.end(), name) !=
+                options.skipDirectoryNames.end())
+            {
+                return true;
+            }
+        }
+        else
+        {
+            for (const std::string &suffix : options.skipFileSuffixes)
+            {
+                if (EndsWith(name, suffix))
+                {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+CChangeWatcher::~CChangeWatcher()
+{
+    Stop();
+}
+
+bool CChangeWatcher::Start(const std::string &root, const ChangeWatchOptions &options, BatchSink sink,
+                           ErrorSink onError)
+{
+    Stop();
+    m_source = CreateRawChangeSource(root, options);
+    if (!m_source)
+    {
+        return false;
+    }
+    m_options = options;
+    m_sink = std::move(sink);
+    m_onError = std::move(onError);
+    m_coalescer = std::make_unique<CChangeCoalescer>(options.coalescer);
+    m_stop.store(false, std::memory_order_relaxed);
+    m_thread = std::thread(&CChangeWatcher::Run, this);
+    return true;
+}
+
+void CChangeWatcher::Stop()
+{
+    if (!m_thread.joinable())
+    {
+        return;
+    }
+    m_stop.store(true, std::memory_order_relaxed);
+    m_source->Cancel();
+    m_thread.join();
+    m_source.reset();
+}
+
+ChangeCoalescerStats CChangeWatcher::Stats() const
+{
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_stats;
+}
+
+void CChangeWatcher::Run()
+{
+    std::vector<RawChange> changes;
+    std::vector<std::string> overflows;
+    ChangeBatch batch;
+    while (!m_stop.load(std::memory_order_relaxed))
+    {
+        // UINT32_MAX, nothing pending, waits until the next event.
+        const bool reading = m_source->Read(m_coalescer->NextDueMs(NowMs()), changes, overflows);
+        const std::string error = m_source->TakeError();
+        if (!reading)
+        {
+            if (!m_stop.load(std::memory_order_relaxed) && m_onError)
+            {
+                m_onError(error.empty() ? "Change notifications stopped" : error, true);
+            }
+            break;
+        }
+        if (!error.empty() && m_onError)
+        {
+            m_onError(error, false);
+        }
+
+        const uint64_t now = NowMs();
+        for (const std::string &directory : overflows)
+        {
+            m_coalescer->AddOverflow(directory, now);
+        }
+        for (const RawChange &change : changes)
+        {
+            m_coalescer->Add(change.path, change.op, change.directory, now);
+        }
+        overflows.clear();
+        changes.clear();
+
+        const bool due = m_coalescer->Take(now, batch);
+        {
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            m_stats = m_coalescer->Stats();
+        }
+        if (due && !m_stop.load(std::memory_order_relaxed))
+        {
+            m_sink(std::move(batch));
+        }
+    }
+}
@@ -0,0 +1,101 @@
+// RRightclickrr synced folder watcher
+//
+// Watches a synced folder recursively and hands the coalesced changes
+// (ChangeCoalescer.h) to a callback from its own thread. The raw events
+// come from a platform source: ReadDirectoryChangesExW over the subtree on
+// Windows, one inotify watch per directory on Linux. When the source
+// overflows, the folder is reported as one Rescan instead of losing events;
+// a directory that cannot be watched is reported as a Rescan plus an error,
+// and a source that fails outright stops the watcher with an error.
+
+#pragma once
+
+#include "ChangeCoalescer.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+struct ChangeWatchOptions
+{
+    ChangeCoalescerOptions coalescer;
+    bool skipDotNames = true; // Names starting with '.'
+    std::vector<std::string> skipDirectoryNames; // Exact names; nothing beneath them is reported
+    std::vector<std::string> skipFileSuffixes;   // Editor and download temporaries
+};
+
+struct RawChange
+{
+    std::string path; // Absolute, UTF-8
+    RawChangeOp op;
+    bool directory;
+};
+
+class IRawChangeSource
+{
+public:
+    virtual ~IRawChangeSource() = default;
+
+    // Waits up to timeoutMs for events and appends them; directories whose
+    // events were lost (or that could not be watched) go to overflows. False
+    // once cancelled or when the source failed.
+    virtual bool Read(uint32_t timeoutMs, std::vector<RawChange> &changes, std::vector<std::string> &overflows) = 0;
+
+    // What went wrong since the last call, or empty: why Read failed, or
+    // which directories could not be watched.
+    virtual std::string TakeError() = 0;
+
+    // Wakes a blocked Read from another thread; sticky.
+    virtual void Cancel() = 0;
+};
+
+// Platform source watching everything below root, or nullptr when root
+// cannot be watched.
+std::unique_ptr<IRawChangeSource> CreateRawChangeSource(const std::string &root, const ChangeWatchOptions &options);
+
+// Whether the options leave out relativePath (below the watched root); every
+// component is checked, the last one as a directory when directory is set.
+bool IsWatchPathSkipped(std::string_view relativePath, bool directory, const ChangeWatchOptions &options);
+
+class CChangeWatcher
+{
+public:
+    // Receives each batch on the watcher thread.
+    using BatchSink = std::function<void(ChangeBatch &&batch)>;
+    // Receives source errors on the watcher thread. After one with stopped
+    // set no batch follows; changes from then on are unknown until the
+    // owner watches again.
+    using ErrorSink = std::function<void(const std::string &message, bool stopped)>;
+
+    CChangeWatcher() = default;
+    ~CChangeWatcher();
+
+    CChangeWatcher(const CChangeWatcher &) = delete;
+    CChangeWatcher &operator=(const CChangeWatcher &) = delete;
+
+    // Starts watching below root; false when it cannot be watched.
+    bool Start(const std::string &root, const ChangeWatchOptions &options, BatchSink sink,
+               ErrorSink onError = nullptr);
+
+    // Stops the thread; pending changes are dropped and no batch follows.
+    void Stop();
+
+    ChangeCoalescerStats Stats() const;
+
+private:
+    void Run();
+
+    ChangeWatchOptions m_options;
+    BatchSink m_sink;
+    ErrorSink m_onError;
+    std::unique_ptr<IRawChangeSource> m_source;
+    std::unique_ptr<CChangeCoalescer> m_coalescer;
+    mutable std::mutex m_statsMutex;
+    ChangeCoalescerStats m_stats;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{false};
+};
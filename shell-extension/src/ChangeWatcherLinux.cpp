@@ -0,0 +1,260 @@
+// RRightclickrr synced folder watcher (Linux, inotify)
+//
+// inotify is not recursive: every directory below the root gets its own
+// watch, added as directories appear and dropped as they go. Files created
+// in a new directory before its watch lands are covered by the directory's
+// own DirectoryAdded. A directory whose watch cannot be added (out of
+// watches, or no access) is reported as a rescan and an error, so its
+// changes are synced at least once rather than silently missed.
+
+#include "ChangeWatcher.h"
+#include "DirectoryEnum.h"
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+
+namespace
+{
+constexpr uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO |
+                                IN_DELETE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+class CInotifyRawSource : public IRawChangeSource
+{
+public:
+    CInotifyRawSource(int inotifyFd, int cancelFd, std::string root, const ChangeWatchOptions &options)
+        : m_inotifyFd(inotifyFd), m_cancelFd(cancelFd), m_root(std::move(root)), m_options(options)
+    {
+    }
+
+    ~CInotifyRawSource() override
+    {
+        close(m_inotifyFd);
+        close(m_cancelFd);
+    }
+
+    bool WatchTree(const std::string &directory)
+    {
+        const int wd = inotify_add_watch(m_inotifyFd, directory.c_str(), kWatchMask);
+        if (wd < 0)
+        {
+            if (m_unwatched.empty())
+            {
+                m_unwatchedError = directory + ": " + std::strerror(errno);
+            }
+            m_unwatched.push_back(directory);
+            return false;
+        }
+        m_directories[wd] = directory;
+
+        struct Walk
+        {
+            CInotifyRawSource *source;
+            const std::string *directory;
+            std::vector<std::string> children;
+        } walk{this, &directory, {}};
+        EnumerateDirectory(
+            directory,
+            [](const DirectoryEntry &entry, void *context) {
+                auto *walk = static_cast<Walk *>(context);
+                if (entry.type == DirectoryEntryType::Directory && !walk->source->IsSkipped(entry.name, true))
+                {
+                    walk->children.push_back(*walk->directory + kDirectorySeparator + std::string(entry.name));
+                }
+            },
+            &walk);
+        for (const std::string &child : walk.children)
+        {
+            WatchTree(child);
+        }
+        return true;
+    }
+
+    bool Read(uint32_t timeoutMs, std::vector<RawChange> &changes, std::vector<std::string> &overflows) override
+    {
+        // Directories left unwatched when the tree was first walked
+        if (TakeUnwatched(overflows))
+        {
+            return true;
+        }
+
+        pollfd fds[2] = {{m_cancelFd, POLLIN, 0}, {m_inotifyFd, POLLIN, 0}};
+        const int timeout = timeoutMs == UINT32_MAX ? -1 : static_cast<int>(timeoutMs);
+        const int ready = poll(fds, 2, timeout);
+        if (fds[0].revents & POLLIN)
+        {
+            return false;
+        }
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                return true;
+            }
+            m_error = std::string("poll failed: ") + std::strerror(errno);
+            return false;
+        }
+        if (!(fds[1].revents & POLLIN))
+        {
+            return true;
+        }
+
+        alignas(inotify_event) char buffer[64 * 1024];
+        ssize_t length;
+        while ((length = read(m_inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char *cursor = buffer; cursor < buffer + length;)
+            {
+                const auto *event = reinterpret_cast<const inotify_event *>(cursor);
+                cursor += sizeof(inotify_event) + event->len;
+                Translate(*event, changes, overflows);
+            }
+        }
+        TakeUnwatched(overflows);
+        return true;
+    }
+
+    std::string TakeError() override
+    {
+        return std::exchange(m_error, {});
+    }
+
+    void Cancel() override
+    {
+        const uint64_t one = 1;
+        (void)!write(m_cancelFd, &one, sizeof(one));
+    }
+
+private:
+    // Hands the directories whose watch could not be added to overflows and
+    // notes them for TakeError.
+    bool TakeUnwatched(std::vector<std::string> &overflows)
+    {
+        if (m_unwatched.empty())
+        {
+            return false;
+        }
+        m_error = "Cannot watch " + std::to_string(m_unwatched.size()) + " directories, rescanning them (" +
+                  m_unwatchedError + ")";
+        overflows.insert(overflows.end(), m_unwatched.begin(), m_unwatched.end());
+        m_unwatched.clear();
+        return true;
+    }
+
+    bool IsSkipped(std::string_view name, bool directory) const
+    {
+        return IsWatchPathSkipped(name, directory, m_options);
+    }
+
+    void Translate(const inotify_event &event, std::vector<RawChange> &changes, std::vector<std::string> &overflows)
+    {
+        if (event.mask & IN_Q_OVERFLOW)
+        {
+            overflows.push_back(m_root);
+            return;
+        }
+        const auto it = m_directories.find(event.wd);
+        if (it == m_directories.end())
+        {
+            return;
+        }
+        if (event.mask & (IN_IGNORED | IN_DELETE_SELF))
+        {
+            if (event.mask & IN_IGNORED)
+            {
+                m_directories.erase(it);
+            }
+            return;
+        }
+        if (event.len == 0)
+        {
+            return;
+        }
+
+        const bool directory = (event.mask & IN_ISDIR) != 0;
+        const std::string_view name(event.name);
+        if (IsSkipped(name, directory))
+        {
+            return;
+        }
+        std::string path = it->second + kDirectorySeparator + std::string(name);
+        if (event.mask & (IN_CREATE | IN_MOVED_TO))
+        {
+            if (directory)
+            {
+                WatchTree(path);
+            }
+            changes.push_back({std::move(path), RawChangeOp::Created, directory});
+        }
+        else if (event.mask & (IN_DELETE | IN_MOVED_FROM))
+        {
+            if (directory && (event.mask & IN_MOVED_FROM))
+            {
+                Unwatch(path);
+            }
+            changes.push_back({std::move(path), RawChangeOp::Deleted, directory});
+        }
+        else if (!directory)
+        {
+            changes.push_back({std::move(path), RawChangeOp::Modified, false});
+        }
+    }
+
+    // A directory moved away keeps its watches under the old paths; drop
+    // them so later events are not reported there. A move within the root
+    // is watched again from its IN_MOVED_TO.
+    void Unwatch(const std::string &directory)
+    {
+        for (auto it = m_directories.begin(); it != m_directories.end();)
+        {
+            const std::string &path = it->second;
+            const bool under = path.compare(0, directory.size(), directory) == 0 &&
+                               (path.size() == directory.size() || path[directory.size()] == kDirectorySeparator);
+            if (under)
+            {
+                inotify_rm_watch(m_inotifyFd, it->first);
+                it = m_directories.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    int m_inotifyFd;
+    int m_cancelFd;
+    std::string m_root;
+    ChangeWatchOptions m_options;
+    std::unordered_map<int, std::string> m_directories; // Watch descriptor to directory path
+    std::vector<std::string> m_unwatched;               // Watches that failed since the last Read
+    std::string m_unwatchedError;                       // Why the first of them failed
+    std::string m_error;
+};
+} // namespace
+
+std::unique_ptr<IRawChangeSource> CreateRawChangeSource(const std::string &root, const ChangeWatchOptions &options)
+{
+    const int inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+    {
+        return nullptr;
+    }
+    const int cancelFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (cancelFd < 0)
+    {
+        close(inotifyFd);
+        return nullptr;
+    }
+
+    auto source = std::make_unique<CInotifyRawSource>(inotifyFd, cancelFd, root, options);
+    if (!source->WatchTree(root))
+    {
+        return nullptr;
+    }
+    return source;
+}
@@ -0,0 +1,216 @@
+// RRightclickrr synced folder watcher (Windows, ReadDirectoryChangesExW)
+//
+// One overlapped subtree read covers the whole folder. The extended
+// information carries each entry's attributes, so deletes and renames know
+// whether they were directories without touching the disk. A read that
+// completes empty or with ERROR_NOTIFY_ENUM_DIR means the system buffer
+// overflowed. Any other failure (the folder was deleted, or the share went
+// away) stops the source with an error for the app to watch again.
+
+#include "ChangeWatcher.h"
+#include "Utf8.h"
+#include <string>
+#include <utility>
+#include <windows.h>
+
+namespace
+{
+constexpr DWORD kBufferBytes = 64 * 1024; // Network shares refuse more
+constexpr DWORD kNotifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+                                FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+
+class CDirectoryRawSource : public IRawChangeSource
+{
+public:
+    CDirectoryRawSource(HANDLE directory, HANDLE completed, HANDLE cancel, std::string root,
+                        const ChangeWatchOptions &options)
+        : m_directory(directory), m_cancel(cancel), m_buffer(kBufferBytes / sizeof(DWORD)), m_root(std::move(root)),
+          m_options(options)
+    {
+        m_overlapped.hEvent = completed;
+    }
+
+    ~CDirectoryRawSource() override
+    {
+        if (m_reading)
+        {
+            // The buffer must outlive the read.
+            DWORD bytes;
+            CancelIoEx(m_directory, &m_overlapped);
+            GetOverlappedResult(m_directory, &m_overlapped, &bytes, TRUE);
+        }
+        CloseHandle(m_directory);
+        CloseHandle(m_overlapped.hEvent);
+        CloseHandle(m_cancel);
+    }
+
+    bool Arm()
+    {
+        m_reading = ReadDirectoryChangesExW(m_directory, m_buffer.data(), kBufferBytes, TRUE, kNotifyFilter, nullptr,
+                                            &m_overlapped, nullptr, ReadDirectoryNotifyExtendedInformation) != FALSE;
+        return m_reading;
+    }
+
+    bool Read(uint32_t timeoutMs, std::vector<RawChange> &changes, std::vector<std::string> &overflows) override
+    {
+        if (!m_reading && !Arm())
+        {
+            const DWORD error = GetLastError();
+            if (error != ERROR_NOTIFY_ENUM_DIR)
+            {
+                return Fail("ReadDirectoryChangesExW", error);
+            }
+            overflows.push_back(m_root);
+            return true;
+        }
+
+        HANDLE handles[] = {m_cancel, m_overlapped.hEvent};
+        const DWORD result = WaitForMultipleObjects(ARRAYSIZE(handles), handles, FALSE, timeoutMs);
+        if (result == WAIT_TIMEOUT)
+        {
+            return true;
+        }
+        if (result == WAIT_OBJECT_0)
+        {
+            return false;
+        }
+        if (result != WAIT_OBJECT_0 + 1)
+        {
+            return Fail("WaitForMultipleObjects", GetLastError());
+        }
+
+        DWORD bytes = 0;
+        const BOOL completed = GetOverlappedResult(m_directory, &m_overlapped, &bytes, FALSE);
+        m_reading = false;
+        if (!completed)
+        {
+            const DWORD error = GetLastError();
+            if (error != ERROR_NOTIFY_ENUM_DIR)
+            {
+                return Fail("GetOverlappedResult", error);
+            }
+            bytes = 0;
+        }
+        if (bytes == 0)
+        {
+            overflows.push_back(m_root);
+        }
+        else
+        {
+            Translate(changes);
+        }
+        // Re-arm before the batch is handled so the system buffer keeps
+        // collecting meanwhile. A failure is retried, and reported, on the
+        // next Read; this batch still goes out.
+        Arm();
+        return true;
+    }
+
+    std::string TakeError() override
+    {
+        return std::exchange(m_error, {});
+    }
+
+    void Cancel() override
+    {
+        SetEvent(m_cancel);
+    }
+
+private:
+    bool Fail(const char *call, DWORD error)
+    {
+        m_error = std::string(call) + " failed with error " + std::to_string(error) + " watching " + m_root;
+        return false;
+    }
+
+    void Translate(std::vector<RawChange> &changes)
+    {
+        std::string relative;
+        const auto *cursor = reinterpret_cast<const BYTE *>(m_buffer.data());
+        for (;;)
+        {
+            const auto *info = reinterpret_cast<const FILE_NOTIFY_EXTENDED_INFORMATION *>(cursor);
+            relative.clear();
+            AppendWideAsUtf8(std::wstring_view(info->FileName, info->FileNameLength / sizeof(WCHAR)), relative);
+
+            const bool directory = (info->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+            if (!IsWatchPathSkipped(relative, directory, m_options))
+            {
+                RawChangeOp op;
+                switch (info->Action)
+                {
+                case FILE_ACTION_ADDED:
+                case FILE_ACTION_RENAMED_NEW_NAME:
+                    op = RawChangeOp::Created;
+                    break;
+                case FILE_ACTION_REMOVED:
+                case FILE_ACTION_RENAMED_OLD_NAME:
+                    op = RawChangeOp::Deleted;
+                    break;
+                default:
+                    op = RawChangeOp::Modified;
+                    break;
+                }
+                changes.push_back({m_root + '\\' + relative, op, directory});
+            }
+
+            if (info->NextEntryOffset == 0)
+            {
+                break;
+            }
+            cursor += info->NextEntryOffset;
+        }
+    }
+
+    HANDLE m_directory;
+    HANDLE m_cancel;
+    OVERLAPPED m_overlapped = {};
+    std::vector<DWORD> m_buffer; // DWORD-aligned, as the call requires
+    bool m_reading = false;
+    std::string m_root;
+    ChangeWatchOptions m_options;
+    std::string m_error;
+};
+} // namespace
+
+std::unique_ptr<IRawChangeSource> CreateRawChangeSource(const std::string &root, const ChangeWatchOptions &options)
+{
+    std::wstring wide;
+    AppendUtf8AsWide(root, wide);
+    HANDLE directory = CreateFileW(wide.c_str(), FILE_LIST_DIRECTORY,
+                                   FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                   FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (directory == INVALID_HANDLE_VALUE)
+    {
+        return nullptr;
+    }
+    HANDLE completed = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    HANDLE cancel = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!completed || !cancel)
+    {
+        CloseHandle(directory);
+        if (completed)
+        {
+            CloseHandle(completed);
+        }
+        if (cancel)
+        {
+            CloseHandle(cancel);
+        }
+        return nullptr;
+    }
+
+    std::string trimmed = root;
+    while (trimmed.size() > 3 && (trimmed.back() == '\\' || trimmed.back() == '/'))
+    {
+        trimmed.pop_back();
+    }
+    auto source = std::make_unique<CDirectoryRawSource>(directory, completed, cancel, std::move(trimmed), options);
+    // Refused on file systems without change notifications (and before
+    // Windows 10 1709); the app falls back to its own watcher.
+    if (!source->Arm())
+    {
+        return nullptr;
+    }
+    return source;
+}
@@ -0,0 +1,140 @@
+// RRightclickrr context menu command table
+//
+// One row per command: what Explorer shows, the CLSID it is registered
+// under (also its canonical name) and which menu lists it. The commands, the
+// subcommand enumerator and the class factory all read this table instead of
+// switching on the command type.
+//
+// Platform-independent so the bench can check it on Linux.
+
+#pragma once
+
+#include "SelectionBatch.h"
+#include <cstddef>
+#include <cstdint>
+
+enum class CommandType
+{
+    RootMenuFolder, // Parent menu for directory selection
+    RootMenuFile,   // Parent menu for file selection
+    SyncToDrive,
+    CopyToDrive,
+    GetDriveURL
+};
+
+// Laid out like a Windows GUID.
+struct CommandGuid
+{
+    uint32_t data1;
+    uint16_t data2;
+    uint16_t data3;
+    uint8_t data4[8];
+};
+
+// Which root menu a command belongs to.
+enum CommandMenu : uint8_t
+{
+    kFolderMenu = 1,
+    kFileMenu = 2,
+};
+
+struct CommandDescriptor
+{
+    CommandType type;
+    const wchar_t *title;
+    const wchar_t *tooltip;
+    const wchar_t *icon;  // resources\assets\<icon>.ico
+    CommandGuid clsid;    // Must match AppxManifest.xml
+    uint8_t menus;        // Root menus: the selection they serve; others: the root menus listing them
+    bool hasSubcommands;  // Root menus
+    BatchMode mode;       // Others: what Invoke asks the app for
+};
+
+constexpr CommandGuid MakeCommandGuid(uint8_t last)
+{
+    return {0x7b3b5e52, 0xa1f0, 0x4c5e, {0x9b, 0x8a, 0x1c, 0x2d, 0x3e, 0x4f, 0x5a, last}};
+}
+
+// Indexed by CommandType; subcommands are listed in menu order.
+inline constexpr CommandDescriptor kCommandTable[] = {
+    {CommandType::RootMenuFolder, L"RRightclickrr", L"Sync files and folders to Google Drive", L"rrightclickrr",
+     MakeCommandGuid(0x6a), kFolderMenu, true, BatchMode::Sync},
+    {CommandType::RootMenuFile, L"RRightclickrr", L"Sync files and folders to Google Drive", L"rrightclickrr",
+     MakeCommandGuid(0x6e), kFileMenu, true, BatchMode::Sync},
+    {CommandType::SyncToDrive, L"Sync to Google Drive", L"Sync this folder to Google Drive and watch for changes",
+     L"sync-icon", MakeCommandGuid(0x6b), kFolderMenu, false, BatchMode::Sync},
+    {CommandType::CopyToDrive, L"Copy to Google Drive", L"Copy to Google Drive (one-time upload)", L"copy-icon",
+     MakeCommandGuid(0x6c), kFolderMenu, false, BatchMode::Copy},
+    {CommandType::GetDriveURL, L"Copy Google Drive Link", L"Copy the Google Drive URL to clipboard", L"link-icon",
+     MakeCommandGuid(0x6d), kFolderMenu | kFileMenu, false, BatchMode::GetUrl},
+};
+
+constexpr size_t kCommandCount = sizeof(kCommandTable) / sizeof(kCommandTable[0]);
+
+constexpr const CommandDescriptor &DescribeCommand(CommandType type)
+{
+    return kCommandTable[static_cast<size_t>(type)];
+}
+
+// Subcommands of a root menu, in menu order.
+struct CommandList
+{
+    CommandType items[kCommandCount] = {};
+    size_t count = 0;
+};
+
+constexpr CommandList SubcommandsOf(CommandType root)
+{
+    CommandList list;
+    const CommandDescriptor &menu = DescribeCommand(root);
+    for (const CommandDescriptor &command : kCommandTable)
+    {
+        if (menu.hasSubcommands && !command.hasSubcommands && (command.menus & menu.menus) != 0)
+        {
+            list.items[list.count++] = command.type;
+        }
+    }
+    return list;
+}
+
+inline constexpr CommandList kFolderSubcommands = SubcommandsOf(CommandType::RootMenuFolder);
+inline constexpr CommandList kFileSubcommands = SubcommandsOf(CommandType::RootMenuFile);
+
+constexpr bool IsSameCommandGuid(const CommandGuid &a, const CommandGuid &b)
+{
+    if (a.data1 != b.data1 || a.data2 != b.data2 || a.data3 != b.data3)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < 8; i++)
+    {
+        if (a.data4[i] != b.data4[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool IsCommandTableValid()
+{
+    for (size_t i = 0; i < kCommandCount; i++)
+    {
+        if (static_cast<size_t>(kCommandTable[i].type) != i)
+        {
+            return false;
+        }
+        for (size_t j = i + 1; j < kCommandCount; j++)
+        {
+            if (IsSameCommandGuid(kCommandTable[i].clsid, kCommandTable[j].clsid))
+            {
+                return false;
+            }
+        }
+    }
+    return static_cast<size_t>(CommandType::GetDriveURL) + 1 == kCommandCount;
+}
+
+static_assert(sizeof(CommandGuid) == 16, "CommandGuid must match GUID");
+static_assert(IsCommandTableValid(), "kCommandTable rows must follow CommandType and have distinct CLSIDs");
+static_assert(kFolderSubcommands.count == 3 && kFileSubcommands.count == 1, "Menus lost a command");
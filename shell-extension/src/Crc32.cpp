@@ -0,0 +1,37 @@
+// RRightclickrr CRC-32 (IEEE 802.3, same polynomial as zlib)
+
+#include "Crc32.h"
+
+namespace
+{
+struct CrcTable
+{
+    uint32_t entries[256];
+
+    CrcTable()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+            }
+            entries[i] = value;
+        }
+    }
+};
+
+const CrcTable g_crcTable;
+} // namespace
+
+uint32_t Crc32(const void *data, size_t size, uint32_t crc)
+{
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = g_crcTable.entries[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
@@ -0,0 +1,41 @@
+// RRightclickrr directory enumeration with file metadata
+//
+// One directory read that already carries each file's size and modification
+// time, so a scan never stats entries one by one: FindFirstFileEx with large
+// fetch on Windows, getdents64 plus statx relative to the open directory on
+// Linux. The scanner above is platform-independent.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+enum class DirectoryEntryType : uint8_t
+{
+    File,
+    Directory,
+    Other, // Devices, sockets, dangling links, and links or junctions to directories
+};
+
+struct DirectoryEntry
+{
+    std::string_view name; // UTF-8; valid during the callback only
+    DirectoryEntryType type;
+    uint64_t size;  // Files only
+    double mtimeMs; // Files only; milliseconds since 1970, as Node's fs.Stats.mtimeMs
+};
+
+// Calls visit for every entry of the UTF-8 directory path except "." and "..".
+// Links to files are followed and report their target; links to directories
+// are Other so a scan cannot loop. Entries that vanish or cannot be stat'ed
+// mid-read are left out. Returns false if the directory cannot be read.
+bool EnumerateDirectory(const std::string &directory, void (*visit)(const DirectoryEntry &entry, void *context),
+                        void *context);
+
+// Separator used when joining names onto a directory path.
+#ifdef _WIN32
+constexpr char kDirectorySeparator = '\\';
+#else
+constexpr char kDirectorySeparator = '/';
+#endif
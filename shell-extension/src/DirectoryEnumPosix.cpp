@@ -0,0 +1,192 @@
+// RRightclickrr directory enumeration (POSIX; getdents64 and statx on Linux)
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "DirectoryEnum.h"
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+bool IsDotOrDotDot(const char *name)
+{
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+double ToMtimeMs(int64_t seconds, uint32_t nanoseconds)
+{
+    // Same arithmetic as Node's fs.Stats.mtimeMs, so the app's rounding
+    // compares equal to values it stat'ed itself.
+    return static_cast<double>(seconds) * 1e3 + static_cast<double>(nanoseconds) / 1e6;
+}
+
+// Type, size and mtime of name in dirFd; follows links when follow is set.
+bool StatEntry(int dirFd, const char *name, bool follow, DirectoryEntry &entry, bool &isLink)
+{
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+    struct statx st;
+    const int flags = AT_STATX_DONT_SYNC | (follow ? 0 : AT_SYMLINK_NOFOLLOW);
+    if (statx(dirFd, name, flags, STATX_TYPE | STATX_SIZE | STATX_MTIME, &st) != 0)
+    {
+        return false;
+    }
+    const mode_t mode = st.stx_mode;
+    entry.size = st.stx_size;
+    entry.mtimeMs = ToMtimeMs(st.stx_mtime.tv_sec, st.stx_mtime.tv_nsec);
+#else
+    struct stat st;
+    if (fstatat(dirFd, name, &st, follow ? 0 : AT_SYMLINK_NOFOLLOW) != 0)
+    {
+        return false;
+    }
+    const mode_t mode = st.st_mode;
+    entry.size = static_cast<uint64_t>(st.st_size);
+#ifdef __APPLE__
+    entry.mtimeMs = ToMtimeMs(st.st_mtimespec.tv_sec, static_cast<uint32_t>(st.st_mtimespec.tv_nsec));
+#else
+    entry.mtimeMs = ToMtimeMs(st.st_mtim.tv_sec, static_cast<uint32_t>(st.st_mtim.tv_nsec));
+#endif
+#endif
+    isLink = S_ISLNK(mode);
+    entry.type = S_ISREG(mode) ? DirectoryEntryType::File
+                 : S_ISDIR(mode) ? DirectoryEntryType::Directory
+                                 : DirectoryEntryType::Other;
+    return true;
+}
+
+// Fills entry from the type the directory read reported, statting only
+// what it must: files for their metadata, links and unknown types for
+// their target.
+bool DescribeEntry(int dirFd, const char *name, unsigned char type, DirectoryEntry &entry)
+{
+    entry.size = 0;
+    entry.mtimeMs = 0;
+    if (type == DT_DIR)
+    {
+        entry.type = DirectoryEntryType::Directory;
+        return true;
+    }
+    if (type != DT_REG && type != DT_LNK && type != DT_UNKNOWN)
+    {
+        entry.type = DirectoryEntryType::Other;
+        return true;
+    }
+
+    bool isLink = false;
+    if (type != DT_LNK && !StatEntry(dirFd, name, false, entry, isLink))
+    {
+        return false;
+    }
+    if (type == DT_LNK || isLink)
+    {
+        // Describe the target; only links to files count as entries.
+        if (!StatEntry(dirFd, name, true, entry, isLink))
+        {
+            return false;
+        }
+        if (entry.type != DirectoryEntryType::File)
+        {
+            entry.type = DirectoryEntryType::Other;
+        }
+    }
+    return true;
+}
+} // namespace
+
+#ifdef __linux__
+namespace
+{
+struct LinuxDirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+} // namespace
+
+bool EnumerateDirectory(const std::string &directory, void (*visit)(const DirectoryEntry &entry, void *context),
+                        void *context)
+{
+    const int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    // Entries for a few hundred names per call; the scanner's threads each
+    // have their own stack.
+    alignas(8) char buffer[32 * 1024];
+    bool ok = true;
+    for (;;)
+    {
+        const long read = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+        if (read < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (read <= 0)
+        {
+            ok = read == 0;
+            break;
+        }
+
+        for (long offset = 0; offset < read;)
+        {
+            const auto *dirent = reinterpret_cast<const LinuxDirent64 *>(buffer + offset);
+            offset += dirent->d_reclen;
+            if (IsDotOrDotDot(dirent->d_name))
+            {
+                continue;
+            }
+            DirectoryEntry entry = {};
+            if (DescribeEntry(fd, dirent->d_name, dirent->d_type, entry))
+            {
+                entry.name = std::string_view(dirent->d_name);
+                visit(entry, context);
+            }
+        }
+    }
+
+    close(fd);
+    return ok;
+}
+#else
+bool EnumerateDirectory(const std::string &directory, void (*visit)(const DirectoryEntry &entry, void *context),
+                        void *context)
+{
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+    {
+        return false;
+    }
+
+    const int fd = dirfd(dir);
+    while (const dirent *next = readdir(dir))
+    {
+        if (IsDotOrDotDot(next->d_name))
+        {
+            continue;
+        }
+        DirectoryEntry entry = {};
+        if (DescribeEntry(fd, next->d_name, next->d_type, entry))
+        {
+            entry.name = std::string_view(next->d_name);
+            visit(entry, context);
+        }
+    }
+
+    closedir(dir);
+    return true;
+}
+#endif
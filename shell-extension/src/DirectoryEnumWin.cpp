@@ -0,0 +1,93 @@
+// RRightclickrr directory enumeration (Windows, FindFirstFileEx large fetch)
+
+#include "DirectoryEnum.h"
+#include "Utf8.h"
+#include <windows.h>
+
+namespace
+{
+// Paths past MAX_PATH need the long-path prefix, as Node's fs adds it.
+std::wstring SearchPattern(const std::string &directory)
+{
+    std::wstring wide;
+    AppendUtf8AsWide(directory, wide);
+    if (wide.size() + 2 >= MAX_PATH && wide.compare(0, 4, L"\\\\?\\") != 0)
+    {
+        wide = (wide.compare(0, 2, L"\\\\") == 0) ? L"\\\\?\\UNC\\" + wide.substr(2) : L"\\\\?\\" + wide;
+    }
+    if (!wide.empty() && wide.back() != L'\\')
+    {
+        wide += L'\\';
+    }
+    wide += L'*';
+    return wide;
+}
+
+double ToMtimeMs(const FILETIME &time)
+{
+    // Split into seconds and nanoseconds first, as libuv does for
+    // fs.Stats.mtimeMs, so the app's rounding compares equal.
+    const int64_t windowsTicks = (static_cast<int64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    const int64_t ticks = windowsTicks - 116444736000000000LL; // 100 ns units since 1970
+    const int64_t seconds = ticks / 10000000;
+    const int64_t nanoseconds = (ticks % 10000000) * 100;
+    return static_cast<double>(seconds) * 1e3 + static_cast<double>(nanoseconds) / 1e6;
+}
+
+DirectoryEntryType EntryType(const WIN32_FIND_DATAW &data)
+{
+    if (data.dwFileAttributes & FILE_ATTRIBUTE_DEVICE)
+    {
+        return DirectoryEntryType::Other;
+    }
+    if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        // Cloud placeholders and file links report their logical size here.
+        return DirectoryEntryType::File;
+    }
+    // Junctions and directory links could lead back up the tree; cloud
+    // folders (OneDrive) are reparse points too and are walked.
+    const bool isLink = (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) &&
+                        (data.dwReserved0 == IO_REPARSE_TAG_MOUNT_POINT || data.dwReserved0 == IO_REPARSE_TAG_SYMLINK);
+    return isLink ? DirectoryEntryType::Other : DirectoryEntryType::Directory;
+}
+} // namespace
+
+bool EnumerateDirectory(const std::string &directory, void (*visit)(const DirectoryEntry &entry, void *context),
+                        void *context)
+{
+    WIN32_FIND_DATAW data;
+    HANDLE find = FindFirstFileExW(SearchPattern(directory).c_str(), FindExInfoBasic, &data, FindExSearchNameMatch,
+                                   nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (find == INVALID_HANDLE_VALUE)
+    {
+        // An empty directory still has "." and ".."; nothing at all is an error.
+        return false;
+    }
+
+    std::string name;
+    do
+    {
+        const wchar_t *wideName = data.cFileName;
+        if (wideName[0] == L'.' && (wideName[1] == L'\0' || (wideName[1] == L'.' && wideName[2] == L'\0')))
+        {
+            continue;
+        }
+
+        DirectoryEntry entry = {};
+        entry.type = EntryType(data);
+        if (entry.type == DirectoryEntryType::File)
+        {
+            entry.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+            entry.mtimeMs = ToMtimeMs(data.ftLastWriteTime);
+        }
+        name.clear();
+        AppendWideAsUtf8(wideName, name);
+        entry.name = name;
+        visit(entry, context);
+    } while (FindNextFileW(find, &data));
+
+    const bool ok = GetLastError() == ERROR_NO_MORE_FILES;
+    FindClose(find);
+    return ok;
+}
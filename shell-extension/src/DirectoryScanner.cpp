@@ -0,0 +1,349 @@
+// RRightclickrr parallel directory scanner
+
+#include "DirectoryScanner.h"
+#include "DirectoryEnum.h"
+#include "PathNormalize.h"
+#include "Utf8.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+struct DirectoryJob
+{
+    std::string path;
+    std::u16string key; // Normalized path relative to the scan root, ending in '\'; only kept under exclusions
+    ExclusionVerdict verdict = ExclusionVerdict::None;
+};
+
+// One per thread, each on its own cache lines.
+struct alignas(64) CWorker
+{
+    std::mutex mutex;
+    std::deque<DirectoryJob> jobs;
+
+    DirectoryScanBatch batch;
+    DirectoryScanTotals totals;
+    std::wstring wideName;
+    std::u16string nameKey;
+};
+
+class CScanRun
+{
+public:
+    CScanRun(const DirectoryScanOptions &options, const CDirectoryScanner::BatchSink &sink,
+             const std::atomic<bool> &cancelled, unsigned threads)
+        : m_options(options), m_sink(sink), m_cancelled(cancelled), m_workers(threads)
+    {
+        for (auto &worker : m_workers)
+        {
+            worker = std::make_unique<CWorker>();
+        }
+        m_hasExclusions = options.exclusions && !options.exclusions->Empty();
+    }
+
+    bool Run(const std::string &root, DirectoryScanTotals &totals);
+
+private:
+    struct VisitContext
+    {
+        CScanRun *run;
+        unsigned index;
+        const DirectoryJob *job;
+    };
+
+    void WorkerLoop(unsigned index);
+    bool TakeJob(unsigned index, DirectoryJob &job);
+    void Push(unsigned index, DirectoryJob &&job);
+    bool ProcessJob(unsigned index, const DirectoryJob &job);
+    void Visit(unsigned index, const DirectoryJob &job, const DirectoryEntry &entry);
+    const std::u16string &NameKey(CWorker &worker, std::string_view name);
+    void Flush(CWorker &worker, bool force);
+
+    static bool Contains(const std::vector<std::string> &names, std::string_view name)
+    {
+        return std::find(names.begin(), names.end(), name) != names.end();
+    }
+
+    const DirectoryScanOptions &m_options;
+    const CDirectoryScanner::BatchSink &m_sink;
+    const std::atomic<bool> &m_cancelled;
+    bool m_hasExclusions = false;
+
+    std::vector<std::unique_ptr<CWorker>> m_workers;
+    std::mutex m_sinkMutex;
+
+    // Directories pushed and not yet finished; the scan is done at zero.
+    std::atomic<size_t> m_pending{0};
+    // Directories sitting in a deque, so idle threads know when to look.
+    std::atomic<size_t> m_queued{0};
+    std::mutex m_idleMutex;
+    std::condition_variable m_idle;
+    bool m_rootReadable = true;
+};
+
+const std::u16string &CScanRun::NameKey(CWorker &worker, std::string_view name)
+{
+    worker.wideName.clear();
+    AppendUtf8AsWide(name, worker.wideName);
+    worker.wideName.resize(NormalizePathInPlace(&worker.wideName[0], worker.wideName.size()));
+    worker.nameKey.clear();
+    AppendWideAsUtf16(worker.wideName, worker.nameKey);
+    return worker.nameKey;
+}
+
+void CScanRun::Visit(unsigned index, const DirectoryJob &job, const DirectoryEntry &entry)
+{
+    CWorker &worker = *m_workers[index];
+    if (entry.type == DirectoryEntryType::Other)
+    {
+        return;
+    }
+    if (m_options.skipDotNames && !entry.name.empty() && entry.name[0] == '.')
+    {
+        worker.totals.skipped++;
+        return;
+    }
+
+    const bool isDirectory = entry.type == DirectoryEntryType::Directory;
+    if (Contains(isDirectory ? m_options.skipDirectoryNames : m_options.skipFileNames, entry.name))
+    {
+        worker.totals.skipped++;
+        return;
+    }
+
+    DirectoryJob child;
+    if (job.verdict == ExclusionVerdict::Partial)
+    {
+        // One walk per directory answers for the directory and, through its
+        // verdict, for everything beneath it.
+        child.key = job.key;
+        child.key += NameKey(worker, entry.name);
+        if (isDirectory)
+        {
+            child.key += u'\\';
+            child.verdict = m_options.exclusions->Classify(child.key);
+            if (child.verdict == ExclusionVerdict::Excluded)
+            {
+                worker.totals.skipped++;
+                return;
+            }
+        }
+        else if (m_options.exclusions->IsExcluded(child.key))
+        {
+            worker.totals.skipped++;
+            return;
+        }
+    }
+
+    std::string path;
+    path.reserve(job.path.size() + 1 + entry.name.size());
+    path = job.path;
+    if (path.empty() || (path.back() != kDirectorySeparator && path.back() != '/'))
+    {
+        path += kDirectorySeparator;
+    }
+    path.append(entry.name.data(), entry.name.size());
+
+    if (isDirectory)
+    {
+        worker.totals.directories++;
+        worker.batch.directories.push_back(path);
+        child.path = std::move(path);
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        Push(index, std::move(child));
+    }
+    else
+    {
+        worker.totals.files++;
+        worker.totals.bytes += entry.size;
+        worker.batch.files.push_back(std::move(path));
+        worker.batch.sizes.push_back(entry.size);
+        worker.batch.mtimeMs.push_back(entry.mtimeMs);
+    }
+    Flush(worker, false);
+}
+
+void CScanRun::Push(unsigned index, DirectoryJob &&job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_workers[index]->mutex);
+        m_workers[index]->jobs.push_back(std::move(job));
+    }
+    m_queued.fetch_add(1, std::memory_order_seq_cst);
+    // Taking the lock orders this against a thread that checked m_queued
+    // and is about to wait.
+    {
+        std::lock_guard<std::mutex> lock(m_idleMutex);
+    }
+    m_idle.notify_one();
+}
+
+bool CScanRun::TakeJob(unsigned index, DirectoryJob &job)
+{
+    // Own deque from the back: depth first, so the deques stay short.
+    {
+        CWorker &own = *m_workers[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty())
+        {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Others' from the front: the shallowest directories, the most work per steal.
+    const unsigned count = static_cast<unsigned>(m_workers.size());
+    for (unsigned step = 1; step < count; step++)
+    {
+        CWorker &victim = *m_workers[(index + step) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty())
+        {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            m_workers[index]->totals.steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CScanRun::ProcessJob(unsigned index, const DirectoryJob &job)
+{
+    CWorker &worker = *m_workers[index];
+    VisitContext context = {this, index, &job};
+    const bool readable = EnumerateDirectory(
+        job.path,
+        [](const DirectoryEntry &entry, void *data) {
+            auto *visit = static_cast<VisitContext *>(data);
+            visit->run->Visit(visit->index, *visit->job, entry);
+        },
+        &context);
+    if (!readable)
+    {
+        worker.totals.unreadable++;
+    }
+    return readable;
+}
+
+void CScanRun::WorkerLoop(unsigned index)
+{
+    DirectoryJob job;
+    for (;;)
+    {
+        if (m_cancelled.load(std::memory_order_relaxed))
+        {
+            break;
+        }
+        if (TakeJob(index, job))
+        {
+            ProcessJob(index, job);
+            if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                // Last directory: wake everyone to leave.
+                std::lock_guard<std::mutex> lock(m_idleMutex);
+                m_idle.notify_all();
+                break;
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_idleMutex);
+        if (m_pending.load(std::memory_order_acquire) == 0)
+        {
+            break;
+        }
+        // The timeout only bounds how late a Cancel is noticed.
+        m_idle.wait_for(lock, std::chrono::milliseconds(10), [this] {
+            return m_queued.load(std::memory_order_seq_cst) != 0 || m_pending.load(std::memory_order_acquire) == 0;
+        });
+    }
+    Flush(*m_workers[index], true);
+}
+
+void CScanRun::Flush(CWorker &worker, bool force)
+{
+    DirectoryScanBatch &batch = worker.batch;
+    if (batch.Empty() ||
+        (!force && batch.files.size() < m_options.batchSize && batch.directories.size() < m_options.batchSize))
+    {
+        return;
+    }
+
+    DirectoryScanBatch full;
+    std::swap(full, batch);
+    batch.files.reserve(std::min<size_t>(m_options.batchSize, 4096));
+    std::lock_guard<std::mutex> lock(m_sinkMutex);
+    m_sink(std::move(full));
+}
+
+bool CScanRun::Run(const std::string &root, DirectoryScanTotals &totals)
+{
+    // The root is listed before the pool starts, so an unreadable root is
+    // reported as such rather than as an empty scan.
+    DirectoryJob rootJob;
+    rootJob.path = root;
+    if (m_hasExclusions)
+    {
+        rootJob.verdict = m_options.exclusions->Classify(std::u16string_view());
+    }
+    m_pending.store(1, std::memory_order_relaxed);
+    m_rootReadable = ProcessJob(0, rootJob);
+    if (m_pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        std::vector<std::thread> threads;
+        threads.reserve(m_workers.size() - 1);
+        for (unsigned i = 1; i < m_workers.size(); i++)
+        {
+            threads.emplace_back(&CScanRun::WorkerLoop, this, i);
+        }
+        WorkerLoop(0);
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    }
+    else
+    {
+        Flush(*m_workers[0], true);
+    }
+
+    totals = {};
+    totals.threads = static_cast<unsigned>(m_workers.size());
+    for (const auto &worker : m_workers)
+    {
+        totals.files += worker->totals.files;
+        totals.directories += worker->totals.directories;
+        totals.bytes += worker->totals.bytes;
+        totals.skipped += worker->totals.skipped;
+        totals.unreadable += worker->totals.unreadable;
+        totals.steals += worker->totals.steals;
+    }
+    return m_rootReadable;
+}
+} // namespace
+
+bool CDirectoryScanner::Scan(const std::string &root, const DirectoryScanOptions &options, const BatchSink &sink,
+                             DirectoryScanTotals &totals)
+{
+    m_cancelled.store(false, std::memory_order_relaxed);
+
+    unsigned threads = options.threads;
+    if (threads == 0)
+    {
+        threads = std::thread::hardware_concurrency();
+    }
+    threads = std::clamp(threads, 1u, kMaxScanThreads);
+
+    CScanRun run(options, sink, m_cancelled, threads);
+    return run.Run(root, totals);
+}
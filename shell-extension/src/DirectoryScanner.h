@@ -0,0 +1,76 @@
+// RRightclickrr parallel directory scanner
+//
+// Lists the files the app syncs from a folder, with the same filters as
+// FolderSync.getAllFiles: hidden names, system folders and files, and the
+// folder's exclusions. Each directory is a work item. A thread pushes the
+// subdirectories it finds onto its own deque and takes its next item from
+// the back; idle threads steal from the front of the others, so one deep
+// subtree still spreads over the pool. Sizes and modification times come
+// from the directory enumeration (DirectoryEnum.h), and files are handed
+// out in batches as they are found.
+//
+// Platform-independent apart from the enumeration, so the bench can check
+// it on Linux.
+
+#pragma once
+
+#include "ExclusionMatcher.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+constexpr unsigned kMaxScanThreads = 16;
+
+struct DirectoryScanOptions
+{
+    unsigned threads = 0;     // 0 = one per core, at most kMaxScanThreads
+    size_t batchSize = 1024;  // Files (or directories) per batch
+    bool skipDotNames = true; // Names starting with '.'
+    std::vector<std::string> skipDirectoryNames; // Exact, case-sensitive names
+    std::vector<std::string> skipFileNames;
+    const CExclusionMatcher *exclusions = nullptr; // Rooted at "": paths relative to the scan root
+};
+
+struct DirectoryScanBatch
+{
+    std::vector<std::string> files; // Full UTF-8 paths
+    std::vector<uint64_t> sizes;
+    std::vector<double> mtimeMs;         // As fs.Stats.mtimeMs
+    std::vector<std::string> directories; // Directories walked below the root
+
+    bool Empty() const { return files.empty() && directories.empty(); }
+};
+
+struct DirectoryScanTotals
+{
+    uint64_t files = 0;
+    uint64_t directories = 0;
+    uint64_t bytes = 0;
+    uint64_t skipped = 0;    // Left out by name or by an exclusion
+    uint64_t unreadable = 0; // Directories that could not be listed
+    uint64_t steals = 0;     // Directories taken from another thread's deque
+    unsigned threads = 0;
+};
+
+class CDirectoryScanner
+{
+public:
+    // Receives each batch; calls never overlap, but may come from any of the
+    // scan's threads.
+    using BatchSink = std::function<void(DirectoryScanBatch &&batch)>;
+
+    // Scans below root, the calling thread taking part, and returns once
+    // every directory is done or Cancel was called. False when root itself
+    // cannot be listed.
+    bool Scan(const std::string &root, const DirectoryScanOptions &options, const BatchSink &sink,
+              DirectoryScanTotals &totals);
+
+    // Stops a running scan soon after; callable from any thread.
+    void Cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> m_cancelled{false};
+};
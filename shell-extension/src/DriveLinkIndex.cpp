@@ -0,0 +1,224 @@
+// RRightclickrr Drive link index (synced-links.idx)
+
+#include "DriveLinkIndex.h"
+#include "Crc32.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+constexpr char16_t kSeparator = u'\\';
+
+uint32_t HeaderChecksum(DriveLinkIndexHeader header)
+{
+    header.headerChecksum = 0;
+    return Crc32(&header, sizeof(header));
+}
+
+void AppendBytes(std::vector<uint8_t> &out, const void *data, size_t size)
+{
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+} // namespace
+
+std::vector<uint8_t> BuildDriveLinkImage(std::vector<DriveLinkEntry> entries, uint64_t generation)
+{
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [](const DriveLinkEntry &entry) {
+                                     return entry.path.empty() || entry.url.empty() || entry.path.size() > UINT32_MAX ||
+                                            entry.url.size() > UINT32_MAX;
+                                 }),
+                  entries.end());
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const DriveLinkEntry &lhs, const DriveLinkEntry &rhs) { return lhs.path < rhs.path; });
+
+    // Keep the last of each run of equal paths.
+    std::vector<const DriveLinkEntry *> kept;
+    kept.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (i + 1 == entries.size() || entries[i + 1].path != entries[i].path)
+        {
+            kept.push_back(&entries[i]);
+        }
+    }
+
+    std::vector<DriveLinkRecord> records(kept.size());
+    std::vector<uint8_t> paths;
+    std::vector<uint8_t> urls;
+    for (size_t i = 0; i < kept.size(); i++)
+    {
+        records[i].pathOffset = static_cast<uint32_t>(paths.size() / sizeof(char16_t));
+        records[i].pathLength = static_cast<uint32_t>(kept[i]->path.size());
+        records[i].urlOffset = static_cast<uint32_t>(urls.size());
+        records[i].urlLength = static_cast<uint32_t>(kept[i]->url.size());
+        AppendBytes(paths, kept[i]->path.data(), kept[i]->path.size() * sizeof(char16_t));
+        AppendBytes(urls, kept[i]->url.data(), kept[i]->url.size());
+    }
+
+    DriveLinkIndexHeader header = {};
+    header.magic = kDriveLinkIndexMagic;
+    header.version = kDriveLinkIndexVersion;
+    header.headerSize = sizeof(DriveLinkIndexHeader);
+    header.generation = generation;
+    header.entryCount = static_cast<uint32_t>(records.size());
+    header.recordsOffset = sizeof(DriveLinkIndexHeader);
+    header.pathsOffset = header.recordsOffset + records.size() * sizeof(DriveLinkRecord);
+    header.urlsOffset = header.pathsOffset + paths.size();
+    header.imageSize = header.urlsOffset + urls.size();
+
+    std::vector<uint8_t> image(sizeof(DriveLinkIndexHeader), 0);
+    image.reserve(static_cast<size_t>(header.imageSize));
+    AppendBytes(image, records.data(), records.size() * sizeof(DriveLinkRecord));
+    AppendBytes(image, paths.data(), paths.size());
+    AppendBytes(image, urls.data(), urls.size());
+
+    header.payloadChecksum = Crc32(image.data() + sizeof(header), image.size() - sizeof(header));
+    header.headerChecksum = HeaderChecksum(header);
+    std::memcpy(image.data(), &header, sizeof(header));
+    return image;
+}
+
+OverlayIndexStatus CDriveLinkIndexView::Open(const void *data, size_t size)
+{
+    Close();
+
+    if (!data || size < sizeof(DriveLinkIndexHeader))
+    {
+        return OverlayIndexStatus::TooSmall;
+    }
+
+    DriveLinkIndexHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != kDriveLinkIndexMagic)
+    {
+        return OverlayIndexStatus::BadMagic;
+    }
+    if (header.version != kDriveLinkIndexVersion || header.headerSize != sizeof(DriveLinkIndexHeader))
+    {
+        return OverlayIndexStatus::BadVersion;
+    }
+    if (HeaderChecksum(header) != header.headerChecksum)
+    {
+        return OverlayIndexStatus::ChecksumMismatch;
+    }
+
+    const bool layoutOk =
+        header.recordsOffset == sizeof(DriveLinkIndexHeader) &&
+        header.pathsOffset == header.recordsOffset + static_cast<uint64_t>(header.entryCount) * sizeof(DriveLinkRecord) &&
+        header.urlsOffset >= header.pathsOffset && (header.urlsOffset - header.pathsOffset) % sizeof(char16_t) == 0 &&
+        header.imageSize >= header.urlsOffset;
+    if (!layoutOk)
+    {
+        return OverlayIndexStatus::BadLayout;
+    }
+    if (header.imageSize > size)
+    {
+        // The writer has published a header for bytes that are not there yet.
+        return OverlayIndexStatus::ChecksumMismatch;
+    }
+
+    const auto *base = static_cast<const uint8_t *>(data);
+    if (Crc32(base + sizeof(header), static_cast<size_t>(header.imageSize) - sizeof(header)) != header.payloadChecksum)
+    {
+        return OverlayIndexStatus::ChecksumMismatch;
+    }
+
+    m_base = base;
+    m_size = static_cast<size_t>(header.imageSize);
+    m_header = header;
+    return OverlayIndexStatus::Ok;
+}
+
+void CDriveLinkIndexView::Close()
+{
+    m_base = nullptr;
+    m_size = 0;
+    m_header = {};
+}
+
+bool CDriveLinkIndexView::Record(uint32_t index, std::u16string_view &path, std::string_view &url) const
+{
+    // Bounds checked on every access: a writer may still overwrite a mapped
+    // image in place.
+    DriveLinkRecord record;
+    std::memcpy(&record, m_base + m_header.recordsOffset + static_cast<size_t>(index) * sizeof(record), sizeof(record));
+
+    const uint64_t pathUnits = (m_header.urlsOffset - m_header.pathsOffset) / sizeof(char16_t);
+    const uint64_t urlBytes = m_header.imageSize - m_header.urlsOffset;
+    if (static_cast<uint64_t>(record.pathOffset) + record.pathLength > pathUnits ||
+        static_cast<uint64_t>(record.urlOffset) + record.urlLength > urlBytes)
+    {
+        return false;
+    }
+
+    path = std::u16string_view(
+        reinterpret_cast<const char16_t *>(m_base + m_header.pathsOffset) + record.pathOffset, record.pathLength);
+    url = std::string_view(reinterpret_cast<const char *>(m_base + m_header.urlsOffset) + record.urlOffset,
+                           record.urlLength);
+    return true;
+}
+
+bool CDriveLinkIndexView::FindExact(std::u16string_view path, std::string_view &url) const
+{
+    if (!m_base)
+    {
+        return false;
+    }
+
+    uint32_t low = 0;
+    uint32_t high = m_header.entryCount;
+    while (low < high)
+    {
+        const uint32_t middle = low + (high - low) / 2;
+        std::u16string_view entry;
+        std::string_view entryUrl;
+        if (!Record(middle, entry, entryUrl))
+        {
+            return false;
+        }
+
+        const int order = entry.compare(path);
+        if (order == 0)
+        {
+            url = entryUrl;
+            return true;
+        }
+        if (order < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return false;
+}
+
+bool CDriveLinkIndexView::Find(std::u16string_view path, DriveLink &link) const
+{
+    std::u16string_view candidate = path;
+    bool exact = true;
+    while (!candidate.empty())
+    {
+        if (FindExact(candidate, link.url))
+        {
+            link.matchedLength = candidate.size();
+            link.exact = exact;
+            return true;
+        }
+
+        exact = false;
+        const size_t cut = candidate.find_last_of(kSeparator);
+        if (cut == std::u16string_view::npos)
+        {
+            break;
+        }
+        // Drive roots keep their separator ("c:\"), as NormalizePath leaves them.
+        const bool driveRoot = cut == 2 && candidate[1] == u':' && candidate.size() > 3;
+        candidate = candidate.substr(0, driveRoot ? cut + 1 : cut);
+    }
+    return false;
+}
@@ -0,0 +1,94 @@
+// RRightclickrr Drive link index (synced-links.idx)
+//
+// Maps every synced path to its Google Drive URL so "Copy Google Drive Link"
+// is answered inside Explorer instead of by starting the app.
+//
+// Layout (little-endian):
+//   DriveLinkIndexHeader (64 bytes)
+//   records - entryCount x DriveLinkRecord, sorted by path
+//   paths   - normalized UTF-16 paths, back to back
+//   urls    - UTF-8 URLs, back to back
+//
+// The reader binary-searches a mapped image in place; the checksums catch an
+// image torn by a concurrent writer, as in synced-paths.idx.
+
+#pragma once
+
+#include "OverlayIndexFormat.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr uint32_t kDriveLinkIndexMagic = 0x4B4C5252; // "RRLK"
+constexpr uint16_t kDriveLinkIndexVersion = 1;
+
+struct DriveLinkIndexHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint64_t generation;      // Incremented by the writer on every publish
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t recordsOffset;
+    uint64_t pathsOffset;     // pathsSize is the distance to urlsOffset
+    uint64_t urlsOffset;
+    uint64_t imageSize;
+    uint32_t payloadChecksum; // CRC-32 of everything after the header
+    uint32_t headerChecksum;  // CRC-32 of this header with this field zeroed
+};
+static_assert(sizeof(DriveLinkIndexHeader) == 64, "DriveLinkIndexHeader layout is part of the file format");
+
+struct DriveLinkRecord
+{
+    uint32_t pathOffset; // In code units, from pathsOffset
+    uint32_t pathLength;
+    uint32_t urlOffset;  // In bytes, from urlsOffset
+    uint32_t urlLength;
+};
+static_assert(sizeof(DriveLinkRecord) == 16, "DriveLinkRecord layout is part of the file format");
+
+struct DriveLinkEntry
+{
+    std::u16string path; // Normalized
+    std::string url;
+};
+
+// Serializes entries into a complete index image. Sorts by path; when a path
+// repeats, the last entry wins. Entries without a path or URL are dropped.
+std::vector<uint8_t> BuildDriveLinkImage(std::vector<DriveLinkEntry> entries, uint64_t generation);
+
+struct DriveLink
+{
+    std::string_view url;
+    size_t matchedLength = 0; // Length of the path the link belongs to
+    bool exact = false;       // False when the link is a synced parent's
+};
+
+// Read-only view over a link image. Does not own the memory.
+class CDriveLinkIndexView
+{
+public:
+    OverlayIndexStatus Open(const void *data, size_t size);
+    void Close();
+
+    bool IsOpen() const { return m_base != nullptr; }
+    uint64_t Generation() const { return m_header.generation; }
+    uint32_t EntryCount() const { return m_header.entryCount; }
+
+    // Link of a normalized path, or of its nearest synced parent, the same
+    // fallback the app's --get-url handler uses.
+    bool Find(std::u16string_view path, DriveLink &link) const;
+
+    // Exact lookup only.
+    bool FindExact(std::u16string_view path, std::string_view &url) const;
+
+private:
+    bool Record(uint32_t index, std::u16string_view &path, std::string_view &url) const;
+
+    const uint8_t *m_base = nullptr;
+    size_t m_size = 0;
+    DriveLinkIndexHeader m_header = {};
+};
@@ -0,0 +1,627 @@
+// RRightclickrr compiled exclusion matcher (synced-exclusions.idx)
+
+#include "ExclusionMatcher.h"
+#include "Crc32.h"
+#include "SyncedPathMatch.h"
+#include "Utf8.h"
+#include <cstring>
+#include <map>
+#include <utility>
+
+namespace
+{
+constexpr char16_t kSeparator = u'\\';
+
+enum StateFlags : uint32_t
+{
+    kAccept = 0x1,   // A rule ends here: this name and everything beneath it
+    kAnyDepth = 0x2, // Reached through "**": stays put on any name
+};
+
+uint32_t HeaderChecksum(ExclusionIndexHeader header)
+{
+    header.headerChecksum = 0;
+    return Crc32(&header, sizeof(header));
+}
+
+void AppendBytes(std::vector<uint8_t> &out, const void *data, size_t size)
+{
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+// Names compare with final sigma folded into sigma, as exclusions.js does:
+// toLowerCase turns a trailing 'Σ' into 'ς' where NormalizePath gives 'σ'.
+char16_t FoldSigma(char16_t unit)
+{
+    return unit == u'\u03C2' ? u'\u03C3' : unit;
+}
+
+uint32_t HashName(std::u16string_view name)
+{
+    uint32_t hash = 2166136261u;
+    for (char16_t unit : name)
+    {
+        hash = (hash ^ FoldSigma(unit)) * 16777619u;
+    }
+    return hash;
+}
+
+// label is stored folded; name is as queried.
+bool SameName(std::u16string_view label, std::u16string_view name)
+{
+    if (label.size() != name.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < label.size(); i++)
+    {
+        if (label[i] != FoldSigma(name[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A state's edges are keyed by the name's hash mixed with the state, so the
+// name is hashed once per component rather than once per live state.
+uint32_t EdgeHash(uint32_t nameHash, uint32_t from)
+{
+    return nameHash ^ (from * 0x9E3779B1u);
+}
+
+// Calls visit(name) for each component of a normalized path, stopping when it
+// returns false. A trailing separator ("c:\") adds no empty name; the leading
+// empty names of a UNC path are kept, the same way for rules and queries.
+// "." names are skipped, as exclusions.js skips them.
+template <typename Visit>
+bool ForEachName(std::u16string_view path, Visit &&visit)
+{
+    size_t begin = 0;
+    while (begin < path.size())
+    {
+        size_t end = path.find(kSeparator, begin);
+        if (end == std::u16string_view::npos)
+        {
+            end = path.size();
+        }
+        const std::u16string_view name = path.substr(begin, end - begin);
+        if (name != u"." && !visit(name))
+        {
+            return false;
+        }
+        begin = end + 1;
+    }
+    return true;
+}
+
+std::u16string FoldedName(std::u16string_view name)
+{
+    std::u16string folded(name);
+    for (char16_t &unit : folded)
+    {
+        unit = FoldSigma(unit);
+    }
+    return folded;
+}
+
+std::u16string NormalizeToUtf16(const std::wstring &path)
+{
+    std::u16string normalized;
+    AppendWideAsUtf16(NormalizePath(path), normalized);
+    return normalized;
+}
+
+struct BuildState
+{
+    std::vector<std::pair<std::u16string, uint32_t>> literals;
+    std::vector<std::pair<std::u16string, uint32_t>> globs;
+    uint32_t anyDepth = 0;
+    uint32_t flags = 0;
+};
+
+class CAutomatonBuilder
+{
+public:
+    CAutomatonBuilder() : m_states(1) {}
+
+    // Adds one rule; false when it names nothing below its root.
+    bool Add(const ExclusionRule &rule)
+    {
+        std::vector<std::u16string> names;
+        const std::u16string root = NormalizeToUtf16(rule.root);
+        ForEachName(root, [&](std::u16string_view name) {
+            names.push_back(FoldedName(name));
+            return true;
+        });
+
+        const size_t rootNames = names.size();
+        bool valid = true;
+        const std::u16string pattern = NormalizeToUtf16(rule.pattern);
+        ForEachName(pattern, [&](std::u16string_view name) {
+            if (name.empty())
+            {
+                return true;
+            }
+            // Excludes only ever reach below their folder.
+            valid = name != u"..";
+            if (name == u"**" && names.size() > rootNames && names.back() == u"**")
+            {
+                return valid;
+            }
+            names.push_back(FoldedName(name));
+            return valid;
+        });
+        if (!valid || names.size() == rootNames)
+        {
+            return false;
+        }
+        // A lone "**" would accept the folder itself; it means everything
+        // beneath it, which is any one name below.
+        if (names.size() == rootNames + 1 && names.back() == u"**")
+        {
+            names.back() = u"*";
+        }
+
+        uint32_t state = 0;
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            const std::u16string &name = names[i];
+            if (i >= rootNames && name == u"**")
+            {
+                state = AnyDepth(state);
+            }
+            else if (i >= rootNames && name.find_first_of(u"*?") != std::u16string::npos)
+            {
+                state = Glob(state, name);
+            }
+            else
+            {
+                state = Literal(state, name);
+            }
+        }
+        m_states[state].flags |= kAccept;
+        return true;
+    }
+
+    std::vector<uint8_t> Serialize(uint32_t ruleCount, uint64_t generation) const
+    {
+        std::vector<ExclusionState> states(m_states.size());
+        std::vector<ExclusionEdge> edges;
+        std::vector<ExclusionGlob> globs;
+        std::u16string labels;
+        for (uint32_t i = 0; i < m_states.size(); i++)
+        {
+            const BuildState &source = m_states[i];
+            states[i].globFirst = static_cast<uint32_t>(globs.size());
+            states[i].globCount = static_cast<uint32_t>(source.globs.size());
+            states[i].anyDepth = source.anyDepth;
+            states[i].flags = source.flags;
+            for (const auto &literal : source.literals)
+            {
+                edges.push_back({i, literal.second, EdgeHash(HashName(literal.first), i),
+                                 static_cast<uint32_t>(labels.size()), static_cast<uint32_t>(literal.first.size())});
+                labels += literal.first;
+            }
+            for (const auto &glob : source.globs)
+            {
+                globs.push_back({glob.second, static_cast<uint32_t>(labels.size()),
+                                 static_cast<uint32_t>(glob.first.size())});
+                labels += glob.first;
+            }
+        }
+
+        // At most half full, so a probe for a missing name stops quickly.
+        size_t slotCount = 1;
+        while (slotCount < edges.size() * 2)
+        {
+            slotCount <<= 1;
+        }
+        std::vector<uint32_t> slots(slotCount, 0);
+        for (uint32_t i = 0; i < edges.size(); i++)
+        {
+            size_t slot = edges[i].hash & (slotCount - 1);
+            while (slots[slot] != 0)
+            {
+                slot = (slot + 1) & (slotCount - 1);
+            }
+            slots[slot] = i + 1;
+        }
+
+        ExclusionIndexHeader header = {};
+        header.magic = kExclusionIndexMagic;
+        header.version = kExclusionIndexVersion;
+        header.headerSize = sizeof(ExclusionIndexHeader);
+        header.generation = generation;
+        header.ruleCount = ruleCount;
+        header.stateCount = static_cast<uint32_t>(states.size());
+        header.edgeCount = static_cast<uint32_t>(edges.size());
+        header.slotCount = static_cast<uint32_t>(slotCount);
+        header.globCount = static_cast<uint32_t>(globs.size());
+        header.labelUnits = static_cast<uint32_t>(labels.size());
+
+        std::vector<uint8_t> image(sizeof(ExclusionIndexHeader), 0);
+        AppendBytes(image, states.data(), states.size() * sizeof(ExclusionState));
+        AppendBytes(image, edges.data(), edges.size() * sizeof(ExclusionEdge));
+        AppendBytes(image, slots.data(), slots.size() * sizeof(uint32_t));
+        AppendBytes(image, globs.data(), globs.size() * sizeof(ExclusionGlob));
+        AppendBytes(image, labels.data(), labels.size() * sizeof(char16_t));
+
+        header.imageSize = static_cast<uint32_t>(image.size());
+        header.payloadChecksum = Crc32(image.data() + sizeof(header), image.size() - sizeof(header));
+        header.headerChecksum = HeaderChecksum(header);
+        std::memcpy(image.data(), &header, sizeof(header));
+        return image;
+    }
+
+private:
+    uint32_t NewState()
+    {
+        m_states.emplace_back();
+        return static_cast<uint32_t>(m_states.size() - 1);
+    }
+
+    uint32_t Literal(uint32_t from, const std::u16string &name)
+    {
+        const auto found = m_literalIndex.find({from, name});
+        if (found != m_literalIndex.end())
+        {
+            return found->second;
+        }
+        const uint32_t to = NewState();
+        m_states[from].literals.emplace_back(name, to);
+        m_literalIndex.emplace(std::make_pair(from, name), to);
+        return to;
+    }
+
+    uint32_t Glob(uint32_t from, const std::u16string &pattern)
+    {
+        for (const auto &glob : m_states[from].globs)
+        {
+            if (glob.first == pattern)
+            {
+                return glob.second;
+            }
+        }
+        const uint32_t to = NewState();
+        m_states[from].globs.emplace_back(pattern, to);
+        return to;
+    }
+
+    uint32_t AnyDepth(uint32_t from)
+    {
+        if (m_states[from].anyDepth == 0)
+        {
+            const uint32_t to = NewState();
+            m_states[to].flags |= kAnyDepth;
+            m_states[from].anyDepth = to;
+        }
+        return m_states[from].anyDepth;
+    }
+
+    std::vector<BuildState> m_states;
+    std::map<std::pair<uint32_t, std::u16string>, uint32_t> m_literalIndex;
+};
+} // namespace
+
+bool MatchExclusionGlob(std::u16string_view pattern, std::u16string_view name)
+{
+    size_t p = 0;
+    size_t n = 0;
+    size_t star = std::u16string_view::npos;
+    size_t resume = 0;
+    while (n < name.size())
+    {
+        if (p < pattern.size() && (pattern[p] == u'?' || pattern[p] == FoldSigma(name[n])))
+        {
+            p++;
+            n++;
+        }
+        else if (p < pattern.size() && pattern[p] == u'*')
+        {
+            star = p++;
+            resume = n;
+        }
+        else if (star != std::u16string_view::npos)
+        {
+            // Let the last '*' take one more unit and retry from there.
+            p = star + 1;
+            n = ++resume;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == u'*')
+    {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+std::vector<uint8_t> BuildExclusionImage(const std::vector<ExclusionRule> &rules, uint64_t generation)
+{
+    CAutomatonBuilder builder;
+    uint32_t ruleCount = 0;
+    for (const ExclusionRule &rule : rules)
+    {
+        ruleCount += builder.Add(rule) ? 1 : 0;
+    }
+    return builder.Serialize(ruleCount, generation);
+}
+
+// Live states of the walk. Real rule sets keep a handful alive at once; only
+// pathological globs spill to the heap.
+class CExclusionIndexView::CStateSet
+{
+public:
+    bool accepting = false;
+
+    size_t Size() const { return m_count; }
+    uint32_t operator[](size_t i) const { return i < kInline ? m_inline[i] : m_spill[i - kInline]; }
+
+    bool Contains(uint32_t state) const
+    {
+        for (size_t i = 0; i < m_count; i++)
+        {
+            if ((*this)[i] == state)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Add(uint32_t state)
+    {
+        if (m_count < kInline)
+        {
+            m_inline[m_count] = state;
+        }
+        else
+        {
+            m_spill.push_back(state);
+        }
+        m_count++;
+    }
+
+    void Clear()
+    {
+        accepting = false;
+        m_count = 0;
+        m_spill.clear();
+    }
+
+private:
+    static constexpr size_t kInline = 32;
+    uint32_t m_inline[kInline];
+    size_t m_count = 0;
+    std::vector<uint32_t> m_spill;
+};
+
+OverlayIndexStatus CExclusionIndexView::Open(const void *data, size_t size)
+{
+    Close();
+
+    if (!data || size < sizeof(ExclusionIndexHeader))
+    {
+        return OverlayIndexStatus::TooSmall;
+    }
+
+    ExclusionIndexHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != kExclusionIndexMagic)
+    {
+        return OverlayIndexStatus::BadMagic;
+    }
+    if (header.version != kExclusionIndexVersion || header.headerSize != sizeof(ExclusionIndexHeader))
+    {
+        return OverlayIndexStatus::BadVersion;
+    }
+    if (HeaderChecksum(header) != header.headerChecksum)
+    {
+        return OverlayIndexStatus::ChecksumMismatch;
+    }
+
+    const uint64_t statesOffset = sizeof(ExclusionIndexHeader);
+    const uint64_t edgesOffset = statesOffset + uint64_t{header.stateCount} * sizeof(ExclusionState);
+    const uint64_t slotsOffset = edgesOffset + uint64_t{header.edgeCount} * sizeof(ExclusionEdge);
+    const uint64_t globsOffset = slotsOffset + uint64_t{header.slotCount} * sizeof(uint32_t);
+    const uint64_t labelsOffset = globsOffset + uint64_t{header.globCount} * sizeof(ExclusionGlob);
+    const uint64_t imageSize = labelsOffset + uint64_t{header.labelUnits} * sizeof(char16_t);
+    const bool layoutOk = header.stateCount > 0 && header.slotCount > 0 &&
+                          (header.slotCount & (header.slotCount - 1)) == 0 && header.edgeCount < header.slotCount &&
+                          imageSize == header.imageSize && reinterpret_cast<uintptr_t>(data) % alignof(uint32_t) == 0;
+    if (!layoutOk)
+    {
+        return OverlayIndexStatus::BadLayout;
+    }
+    if (header.imageSize > size)
+    {
+        return OverlayIndexStatus::ChecksumMismatch;
+    }
+
+    const auto *base = static_cast<const uint8_t *>(data);
+    if (Crc32(base + sizeof(header), header.imageSize - sizeof(header)) != header.payloadChecksum)
+    {
+        return OverlayIndexStatus::ChecksumMismatch;
+    }
+
+    const auto *states = reinterpret_cast<const ExclusionState *>(base + statesOffset);
+    const auto *edges = reinterpret_cast<const ExclusionEdge *>(base + edgesOffset);
+    const auto *slots = reinterpret_cast<const uint32_t *>(base + slotsOffset);
+    const auto *globs = reinterpret_cast<const ExclusionGlob *>(base + globsOffset);
+    const auto labelFits = [&](uint32_t offset, uint32_t length) {
+        return uint64_t{offset} + length <= header.labelUnits;
+    };
+
+    // A checksum only proves the writer meant these bytes; lookups trust
+    // every reference, so check them all once here.
+    bool referencesOk = true;
+    for (uint32_t i = 0; referencesOk && i < header.stateCount; i++)
+    {
+        referencesOk = uint64_t{states[i].globFirst} + states[i].globCount <= header.globCount &&
+                       states[i].anyDepth < header.stateCount && (states[i].anyDepth == 0 || states[i].anyDepth > i);
+    }
+    for (uint32_t i = 0; referencesOk && i < header.edgeCount; i++)
+    {
+        referencesOk = edges[i].from < header.stateCount && edges[i].to < header.stateCount &&
+                       labelFits(edges[i].labelOffset, edges[i].labelLength);
+    }
+    for (uint32_t i = 0; referencesOk && i < header.slotCount; i++)
+    {
+        referencesOk = slots[i] <= header.edgeCount;
+    }
+    for (uint32_t i = 0; referencesOk && i < header.globCount; i++)
+    {
+        referencesOk = globs[i].to < header.stateCount && labelFits(globs[i].labelOffset, globs[i].labelLength);
+    }
+    if (!referencesOk)
+    {
+        return OverlayIndexStatus::BadLayout;
+    }
+
+    m_base = base;
+    m_states = states;
+    m_edges = edges;
+    m_slots = slots;
+    m_globs = globs;
+    m_labels = reinterpret_cast<const char16_t *>(base + labelsOffset);
+    m_header = header;
+    return OverlayIndexStatus::Ok;
+}
+
+void CExclusionIndexView::Close()
+{
+    m_base = nullptr;
+    m_states = nullptr;
+    m_edges = nullptr;
+    m_slots = nullptr;
+    m_globs = nullptr;
+    m_labels = nullptr;
+    m_header = {};
+}
+
+bool CExclusionIndexView::IsExcluded(std::u16string_view path) const
+{
+    return m_base && !Empty() && Walk(path) == ExclusionVerdict::Excluded;
+}
+
+ExclusionVerdict CExclusionIndexView::Classify(std::u16string_view parentWithSeparator) const
+{
+    if (!m_base || Empty())
+    {
+        return ExclusionVerdict::None;
+    }
+    return Walk(parentWithSeparator);
+}
+
+std::u16string_view CExclusionIndexView::Label(uint32_t offset, uint32_t length) const
+{
+    return std::u16string_view(m_labels + offset, length);
+}
+
+uint32_t CExclusionIndexView::FindEdge(uint32_t from, std::u16string_view name, uint32_t hash) const
+{
+    const uint32_t mask = m_header.slotCount - 1;
+    for (uint32_t slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+        const uint32_t entry = m_slots[slot];
+        if (entry == 0)
+        {
+            return 0;
+        }
+        const ExclusionEdge &edge = m_edges[entry - 1];
+        if (edge.hash == hash && edge.from == from && SameName(Label(edge.labelOffset, edge.labelLength), name))
+        {
+            return edge.to;
+        }
+    }
+}
+
+void CExclusionIndexView::AddState(CStateSet &set, uint32_t state) const
+{
+    // Follow "**" states, which are live as soon as the state before them is.
+    while (!set.Contains(state))
+    {
+        set.Add(state);
+        set.accepting = set.accepting || (m_states[state].flags & kAccept) != 0;
+        state = m_states[state].anyDepth;
+        if (state == 0)
+        {
+            break;
+        }
+    }
+}
+
+ExclusionVerdict CExclusionIndexView::Walk(std::u16string_view path) const
+{
+    CStateSet sets[2];
+    CStateSet *current = &sets[0];
+    CStateSet *next = &sets[1];
+    AddState(*current, 0);
+
+    ExclusionVerdict verdict = ExclusionVerdict::Partial;
+    ForEachName(path, [&](std::u16string_view name) {
+        const uint32_t nameHash = HashName(name);
+        for (size_t i = 0; i < current->Size(); i++)
+        {
+            const uint32_t from = (*current)[i];
+            const ExclusionState &state = m_states[from];
+            if (state.flags & kAnyDepth)
+            {
+                AddState(*next, from);
+            }
+            const uint32_t to = FindEdge(from, name, EdgeHash(nameHash, from));
+            if (to != 0)
+            {
+                AddState(*next, to);
+            }
+            for (uint32_t g = 0; g < state.globCount; g++)
+            {
+                const ExclusionGlob &glob = m_globs[state.globFirst + g];
+                if (MatchExclusionGlob(Label(glob.labelOffset, glob.labelLength), name))
+                {
+                    AddState(*next, glob.to);
+                }
+            }
+        }
+
+        if (next->accepting)
+        {
+            verdict = ExclusionVerdict::Excluded;
+            return false;
+        }
+        if (next->Size() == 0)
+        {
+            verdict = ExclusionVerdict::None;
+            return false;
+        }
+        std::swap(current, next);
+        next->Clear();
+        return true;
+    });
+    return verdict;
+}
+
+void CExclusionMatcher::Compile(const std::vector<ExclusionRule> &rules)
+{
+    m_view.Close();
+    m_image = BuildExclusionImage(rules, 0);
+    m_view.Open(m_image.data(), m_image.size());
+}
+
+OverlayIndexStatus CExclusionMatcher::Load(const void *data, size_t size)
+{
+    m_view.Close();
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    m_image.assign(bytes, bytes + size);
+    const OverlayIndexStatus status = m_view.Open(m_image.data(), m_image.size());
+    if (status != OverlayIndexStatus::Ok)
+    {
+        m_image.clear();
+    }
+    return status;
+}
@@ -0,0 +1,171 @@
+// RRightclickrr compiled exclusion matcher (synced-exclusions.idx)
+//
+// Every synced folder can exclude subpaths from sync. A rule is the folder
+// plus a pattern relative to it: a plain subpath ("photos\raw") or a glob
+// whose components may use '*' and '?' within a name and "**" for any number
+// of names ("**\node_modules", "cache\*.tmp"). A rule excludes what it names
+// and everything beneath it, compared normalized like the overlay index.
+// The answers are those of src/lib/exclusions.js: "." names are skipped,
+// final sigma compares equal to sigma, and a lone "**" leaves the folder
+// itself alone.
+//
+// All rules compile into one automaton over path components: a trie of
+// literal names, with glob and "**" transitions where a rule has them. A
+// lookup walks the query's components once, however many rules there are.
+//
+// Layout (little-endian), every section back to back after the header:
+//   ExclusionIndexHeader (64 bytes)
+//   states - stateCount x ExclusionState; state 0 is the start
+//   edges  - edgeCount x ExclusionEdge, literal transitions
+//   slots  - slotCount x uint32, open-addressed (state, name) -> edge + 1
+//   globs  - globCount x ExclusionGlob, each state's globs contiguous
+//   labels - labelUnits x char16_t, normalized names and glob patterns
+//
+// The app writes the image next to the overlay index; the overlay handler
+// and the app's sync scanner query it in place. Platform-independent so the
+// bench can check it on Linux.
+
+#pragma once
+
+#include "OverlayIndexFormat.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr uint32_t kExclusionIndexMagic = 0x58455252; // "RREX"
+constexpr uint16_t kExclusionIndexVersion = 2; // 2: labels store final sigma as sigma
+
+struct ExclusionIndexHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint64_t generation; // Incremented by the writer on every publish
+    uint32_t ruleCount;  // Rules compiled in (diagnostics)
+    uint32_t stateCount;
+    uint32_t edgeCount;
+    uint32_t slotCount;  // Power of two
+    uint32_t globCount;
+    uint32_t labelUnits;
+    uint32_t imageSize;
+    uint32_t reserved[3];
+    uint32_t payloadChecksum; // CRC-32 of everything after the header
+    uint32_t headerChecksum;  // CRC-32 of this header with this field zeroed
+};
+static_assert(sizeof(ExclusionIndexHeader) == 64, "ExclusionIndexHeader layout is part of the file format");
+
+struct ExclusionState
+{
+    uint32_t globFirst;
+    uint32_t globCount;
+    uint32_t anyDepth; // State entered through "**" without consuming a name; 0 = none
+    uint32_t flags;
+};
+static_assert(sizeof(ExclusionState) == 16, "ExclusionState layout is part of the file format");
+
+struct ExclusionEdge
+{
+    uint32_t from;
+    uint32_t to;
+    uint32_t hash;
+    uint32_t labelOffset; // In code units, from the labels section
+    uint32_t labelLength;
+};
+static_assert(sizeof(ExclusionEdge) == 20, "ExclusionEdge layout is part of the file format");
+
+struct ExclusionGlob
+{
+    uint32_t to;
+    uint32_t labelOffset;
+    uint32_t labelLength;
+};
+static_assert(sizeof(ExclusionGlob) == 12, "ExclusionGlob layout is part of the file format");
+
+struct ExclusionRule
+{
+    std::wstring root;    // Synced folder; empty to match paths relative to it
+    std::wstring pattern; // Relative to root, '\' or '/' separated
+};
+
+enum class ExclusionVerdict : uint8_t
+{
+    None,     // No child of the parent is excluded
+    Partial,  // Some children may be; check each one
+    Excluded, // The parent is excluded, and so is every child
+};
+
+// Compiles the rules into a complete image. Rules whose pattern is empty (it
+// would exclude the synced folder itself) are dropped.
+std::vector<uint8_t> BuildExclusionImage(const std::vector<ExclusionRule> &rules, uint64_t generation);
+
+// Read-only view over an image. Open validates every state, edge and label
+// reference, so lookups do no bounds checks. Does not own the memory, which
+// must not change while the view is open.
+class CExclusionIndexView
+{
+public:
+    OverlayIndexStatus Open(const void *data, size_t size);
+    void Close();
+
+    bool IsOpen() const { return m_base != nullptr; }
+    uint64_t Generation() const { return m_header.generation; }
+    uint32_t RuleCount() const { return m_header.ruleCount; }
+    uint32_t StateCount() const { return m_header.stateCount; }
+    bool Empty() const { return m_header.ruleCount == 0; }
+
+    // True when a rule covers the normalized path.
+    bool IsExcluded(std::u16string_view path) const;
+
+    // Verdict for the children of a parent, given as the normalized path up
+    // to and including the separator before the child's name.
+    ExclusionVerdict Classify(std::u16string_view parentWithSeparator) const;
+
+private:
+    class CStateSet;
+
+    // Walks path's components; stops early once excluded or once no rule can
+    // match anything beneath.
+    ExclusionVerdict Walk(std::u16string_view path) const;
+    void AddState(CStateSet &set, uint32_t state) const;
+    uint32_t FindEdge(uint32_t from, std::u16string_view name, uint32_t hash) const;
+    std::u16string_view Label(uint32_t offset, uint32_t length) const;
+
+    const uint8_t *m_base = nullptr;
+    const ExclusionState *m_states = nullptr;
+    const ExclusionEdge *m_edges = nullptr;
+    const uint32_t *m_slots = nullptr;
+    const ExclusionGlob *m_globs = nullptr;
+    const char16_t *m_labels = nullptr;
+    ExclusionIndexHeader m_header = {};
+};
+
+// Owns an image: compiled in memory (the app's sync scanner) or copied from
+// synced-exclusions.idx (the overlay handler).
+class CExclusionMatcher
+{
+public:
+    CExclusionMatcher() = default;
+    CExclusionMatcher(const CExclusionMatcher &) = delete;
+    CExclusionMatcher &operator=(const CExclusionMatcher &) = delete;
+
+    void Compile(const std::vector<ExclusionRule> &rules);
+    OverlayIndexStatus Load(const void *data, size_t size);
+
+    const CExclusionIndexView &View() const { return m_view; }
+    bool Empty() const { return !m_view.IsOpen() || m_view.Empty(); }
+    bool IsExcluded(std::u16string_view path) const { return m_view.IsOpen() && m_view.IsExcluded(path); }
+    ExclusionVerdict Classify(std::u16string_view parentWithSeparator) const
+    {
+        return m_view.IsOpen() ? m_view.Classify(parentWithSeparator) : ExclusionVerdict::None;
+    }
+
+private:
+    std::vector<uint8_t> m_image;
+    CExclusionIndexView m_view;
+};
+
+// Whole-name glob match: '*' is any run of units, '?' exactly one. The
+// pattern is stored folded, so a final sigma in name matches its sigma.
+bool MatchExclusionGlob(std::u16string_view pattern, std::u16string_view name);
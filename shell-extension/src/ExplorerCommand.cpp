@@ -2,43 +2,159 @@
 
 #include "ExplorerCommand.h"
 #include "resource.h"
+#include "DriveLinkIndex.h"
+#include "InvokeQueue.h"
+#include "ModulePaths.h"
+#include "PathNormalize.h"
+#include "SelectionBatch.h"
+#include "ShellCommandClient.h"
+#include "ShellCommandProtocol.h"
+#include "ShellStats.h"
 #include <strsafe.h>
 #include <pathcch.h>
 #include <shellapi.h>
+#include <shlobj.h>
+#include <mutex>
 #include <new>
+#include <string>
+#include <vector>
 
 #pragma comment(lib, "pathcch.lib")
 #pragma comment(lib, "shell32.lib")
+#pragma comment(lib, "user32.lib")
 
 // Forward declaration
 class CEnumExplorerCommand;
 
-// Helper to get icon path for a specific icon name
-static HRESULT GetIconPathForName(LPWSTR pszPath, DWORD cchPath, LPCWSTR iconName)
+// How long the invoke worker waits for a running app to take a command
+// before starting one.
+static const uint32_t kShellCommandTimeoutMs = 150;
+
+// Per-process invoke worker (InvokeQueue.h)
+static CInvokeQueue g_invokeQueue;
+static std::mutex g_invokeQueueMutex;
+static thread_local HRESULT t_comInit = E_FAIL;
+
+static HRESULT QueueInvoke(InvokeRequest &&request);
+
+// Helper: Path of the Drive link index the app writes (synced-links.idx)
+static HRESULT GetLinkIndexPath(LPWSTR pszPath, DWORD cchPath)
 {
-    WCHAR szDllPath[MAX_PATH];
-    if (GetModuleFileNameW(g_hModule, szDllPath, ARRAYSIZE(szDllPath)) == 0)
+    PWSTR pszLocalAppData = nullptr;
+    HRESULT hr = SHGetKnownFolderPath(FOLDERID_LocalAppData, KF_FLAG_DEFAULT, nullptr, &pszLocalAppData);
+    if (FAILED(hr)) return hr;
+
+    hr = PathCchCombine(pszPath, cchPath, pszLocalAppData, L"RRightclickrr\\synced-links.idx");
+    CoTaskMemFree(pszLocalAppData);
+    return hr;
+}
+
+// Helper: Put text on the clipboard as CF_UNICODETEXT
+static HRESULT SetClipboardText(const std::wstring &text)
+{
+    const SIZE_T cb = (text.size() + 1) * sizeof(WCHAR);
+    HGLOBAL hMem = GlobalAlloc(GMEM_MOVEABLE, cb);
+    if (!hMem) return E_OUTOFMEMORY;
+
+    void *pData = GlobalLock(hMem);
+    if (!pData)
+    {
+        GlobalFree(hMem);
+        return E_OUTOFMEMORY;
+    }
+    memcpy(pData, text.c_str(), cb);
+    GlobalUnlock(hMem);
+
+    // Another application may hold the clipboard for a moment.
+    BOOL opened = FALSE;
+    for (int attempt = 0; attempt < 5 && !opened; attempt++)
+    {
+        opened = OpenClipboard(nullptr);
+        if (!opened) Sleep(10);
+    }
+    if (!opened)
+    {
+        GlobalFree(hMem);
         return HRESULT_FROM_WIN32(GetLastError());
+    }
 
-    HRESULT hr = PathCchRemoveFileSpec(szDllPath, ARRAYSIZE(szDllPath));
-    if (FAILED(hr)) return hr;
+    HRESULT hr = S_OK;
+    EmptyClipboard();
+    if (!SetClipboardData(CF_UNICODETEXT, hMem))
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        GlobalFree(hMem);
+    }
+    CloseClipboard();
+    return hr;
+}
 
-    // Go up one level from shell-extension folder
-    hr = PathCchRemoveFileSpec(szDllPath, ARRAYSIZE(szDllPath));
-    if (FAILED(hr)) return hr;
+// Helper: Drive links of the paths (or of their synced parents) from the link
+// index, one per line. Returns S_FALSE when the index is missing, unreadable
+// or lacks a link for any of them.
+static HRESULT FindDriveLinks(const std::vector<std::wstring> &paths, std::wstring &text)
+{
+    static_assert(sizeof(wchar_t) == sizeof(char16_t), "The link index stores UTF-16 code units");
+
+    WCHAR szIndexPath[MAX_PATH];
+    HRESULT hr = GetLinkIndexPath(szIndexPath, ARRAYSIZE(szIndexPath));
+    if (FAILED(hr)) return S_FALSE;
+
+    HANDLE hFile = CreateFileW(szIndexPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return S_FALSE;
+
+    LARGE_INTEGER size = {};
+    HANDLE hMapping = nullptr;
+    if (GetFileSizeEx(hFile, &size) && size.QuadPart > 0)
+        hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(hFile);
+    if (!hMapping) return S_FALSE;
+
+    const void *pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hMapping);
+    if (!pView) return S_FALSE;
+
+    CDriveLinkIndexView index;
+    hr = index.Open(pView, static_cast<size_t>(size.QuadPart)) == OverlayIndexStatus::Ok ? S_OK : S_FALSE;
+    for (size_t i = 0; hr == S_OK && i < paths.size(); i++)
+    {
+        DriveLink link;
+        const CNormalizedPath target{std::wstring_view(paths[i])};
+        const std::u16string_view key(reinterpret_cast<const char16_t *>(target.View().data()), target.View().size());
+        const int cch = index.Find(key, link)
+            ? MultiByteToWideChar(CP_UTF8, 0, link.url.data(), static_cast<int>(link.url.size()), nullptr, 0)
+            : 0;
+        if (cch <= 0)
+        {
+            hr = S_FALSE;
+            break;
+        }
 
-    // Build path: resources\assets\<iconName>.ico
-    WCHAR szIconRelPath[MAX_PATH];
-    StringCchPrintfW(szIconRelPath, ARRAYSIZE(szIconRelPath), L"resources\\assets\\%s.ico", iconName);
+        if (i > 0)
+            text += L"\r\n";
+        const size_t start = text.size();
+        text.resize(start + cch);
+        MultiByteToWideChar(CP_UTF8, 0, link.url.data(), static_cast<int>(link.url.size()), &text[start], cch);
+    }
 
-    return PathCchCombine(pszPath, cchPath, szDllPath, szIconRelPath);
+    UnmapViewOfFile(pView);
+    return hr;
+}
+
+// Helper: Request mode of a menu command
+static HRESULT GetCommandMode(const CommandDescriptor &command, BatchMode &mode)
+{
+    if (command.hasSubcommands) return E_INVALIDARG;
+    mode = command.mode;
+    return S_OK;
 }
 
 // Enumerator for subcommands
 class CEnumExplorerCommand : public IEnumExplorerCommand
 {
 public:
-    CEnumExplorerCommand(bool isFolder) : m_cRef(1), m_nCurrent(0), m_isFolder(isFolder)
+    CEnumExplorerCommand(const CommandList &commands) : m_cRef(1), m_nCurrent(0), m_commands(commands)
     {
         InterlockedIncrement(&g_cDllRef);
     }
@@ -64,31 +180,13 @@ public:
     // IEnumExplorerCommand
     IFACEMETHODIMP Next(ULONG celt, IExplorerCommand **pUICommand, ULONG *pceltFetched)
     {
+        // Hands out the shared subcommands; nothing is allocated per menu.
         ULONG fetched = 0;
-
-        // For folders: Sync, Copy, GetURL
-        // For files: GetURL
-        CommandType commands[] = {
-            CommandType::SyncToDrive,
-            CommandType::CopyToDrive,
-            CommandType::GetDriveURL
-        };
-        int startIdx = m_isFolder ? 0 : 2;  // Files expose only GetURL
-        int totalCommands = m_isFolder ? 3 : 1;
-
-        while (fetched < celt && (m_nCurrent - startIdx) < totalCommands)
+        while (fetched < celt && m_nCurrent < m_commands.count)
         {
-            if (m_nCurrent >= startIdx)
-            {
-                CExplorerCommand *pCmd = new (std::nothrow) CExplorerCommand(commands[m_nCurrent]);
-                if (pCmd)
-                {
-                    pCmd->QueryInterface(IID_PPV_ARGS(&pUICommand[fetched]));
-                    pCmd->Release();
-                    fetched++;
-                }
-            }
-            m_nCurrent++;
+            CExplorerCommand *pCmd = CExplorerCommand::Shared(m_commands.items[m_nCurrent++]);
+            pCmd->AddRef();
+            pUICommand[fetched++] = pCmd;
         }
 
         if (pceltFetched) *pceltFetched = fetched;
@@ -99,28 +197,50 @@ public:
     IFACEMETHODIMP Reset() { m_nCurrent = 0; return S_OK; }
     IFACEMETHODIMP Clone(IEnumExplorerCommand **ppEnum)
     {
-        *ppEnum = new (std::nothrow) CEnumExplorerCommand(m_isFolder);
-        return *ppEnum ? S_OK : E_OUTOFMEMORY;
+        CEnumExplorerCommand *pEnum = new (std::nothrow) CEnumExplorerCommand(m_commands);
+        if (!pEnum) return E_OUTOFMEMORY;
+        pEnum->m_nCurrent = m_nCurrent;
+        *ppEnum = pEnum;
+        return S_OK;
     }
 
 private:
     ~CEnumExplorerCommand() { InterlockedDecrement(&g_cDllRef); }
     long m_cRef;
-    ULONG m_nCurrent;
-    bool m_isFolder;
+    size_t m_nCurrent;
+    const CommandList &m_commands;
 };
 
-CExplorerCommand::CExplorerCommand(CommandType type)
-    : m_cRef(1), m_type(type), m_pSite(nullptr)
+CExplorerCommand::CExplorerCommand(CommandType type) : CExplorerCommand(type, false)
 {
-    InterlockedIncrement(&g_cDllRef);
+}
+
+CExplorerCommand::CExplorerCommand(CommandType type, bool shared)
+    : m_cRef(shared ? 0 : 1), m_pCommand(&DescribeCommand(type)), m_shared(shared), m_pSite(nullptr)
+{
+    if (!m_shared)
+        InterlockedIncrement(&g_cDllRef);
 }
 
 CExplorerCommand::~CExplorerCommand()
 {
     if (m_pSite)
         m_pSite->Release();
-    InterlockedDecrement(&g_cDllRef);
+    if (!m_shared)
+        InterlockedDecrement(&g_cDllRef);
+}
+
+CExplorerCommand *CExplorerCommand::Shared(CommandType type)
+{
+    static_assert(kCommandCount == 5, "One shared instance per command");
+    static CExplorerCommand s_commands[] = {
+        {CommandType::RootMenuFolder, true},
+        {CommandType::RootMenuFile, true},
+        {CommandType::SyncToDrive, true},
+        {CommandType::CopyToDrive, true},
+        {CommandType::GetDriveURL, true},
+    };
+    return &s_commands[static_cast<size_t>(type)];
 }
 
 // IUnknown
@@ -131,18 +251,27 @@ IFACEMETHODIMP CExplorerCommand::QueryInterface(REFIID riid, void **ppv)
         QITABENT(CExplorerCommand, IObjectWithSite),
         { 0 },
     };
-    return QISearch(this, qit, riid, ppv);
+    // A site set on a shared instance would leak into every other menu.
+    static const QITAB qitShared[] = {
+        QITABENT(CExplorerCommand, IExplorerCommand),
+        { 0 },
+    };
+    return QISearch(this, m_shared ? qitShared : qit, riid, ppv);
 }
 
 IFACEMETHODIMP_(ULONG) CExplorerCommand::AddRef()
 {
+    if (m_shared)
+        InterlockedIncrement(&g_cDllRef);
     return InterlockedIncrement(&m_cRef);
 }
 
 IFACEMETHODIMP_(ULONG) CExplorerCommand::Release()
 {
     long cRef = InterlockedDecrement(&m_cRef);
-    if (cRef == 0)
+    if (m_shared)
+        InterlockedDecrement(&g_cDllRef);
+    else if (cRef == 0)
         delete this;
     return cRef;
 }
@@ -151,112 +280,32 @@ IFACEMETHODIMP_(ULONG) CExplorerCommand::Release()
 IFACEMETHODIMP CExplorerCommand::GetTitle(IShellItemArray *psiItemArray, LPWSTR *ppszName)
 {
     UNREFERENCED_PARAMETER(psiItemArray);
-
-    LPCWSTR title;
-    switch (m_type)
-    {
-    case CommandType::RootMenuFolder:
-    case CommandType::RootMenuFile:
-        title = L"RRightclickrr";
-        break;
-    case CommandType::SyncToDrive:
-        title = L"Sync to Google Drive";
-        break;
-    case CommandType::CopyToDrive:
-        title = L"Copy to Google Drive";
-        break;
-    case CommandType::GetDriveURL:
-        title = L"Copy Google Drive Link";
-        break;
-    default:
-        title = L"RRightclickrr";
-    }
-
-    return SHStrDupW(title, ppszName);
+    return SHStrDupW(m_pCommand->title, ppszName);
 }
 
 IFACEMETHODIMP CExplorerCommand::GetIcon(IShellItemArray *psiItemArray, LPWSTR *ppszIcon)
 {
     UNREFERENCED_PARAMETER(psiItemArray);
 
-    LPCWSTR iconName;
-    switch (m_type)
-    {
-    case CommandType::RootMenuFolder:
-    case CommandType::RootMenuFile:
-        iconName = L"rrightclickrr";
-        break;
-    case CommandType::SyncToDrive:
-        iconName = L"sync-icon";
-        break;
-    case CommandType::CopyToDrive:
-        iconName = L"copy-icon";
-        break;
-    case CommandType::GetDriveURL:
-        iconName = L"link-icon";
-        break;
-    default:
-        iconName = L"rrightclickrr";
-    }
-
-    WCHAR szIconPath[MAX_PATH];
-    HRESULT hr = GetIconPathForName(szIconPath, ARRAYSIZE(szIconPath), iconName);
-    if (FAILED(hr))
+    const ModulePaths &paths = GetModulePaths();
+    if (FAILED(paths.hr))
     {
         *ppszIcon = nullptr;
         return E_FAIL;
     }
 
-    return SHStrDupW(szIconPath, ppszIcon);
+    return SHStrDupW(paths.commandIcons[static_cast<size_t>(m_pCommand->type)], ppszIcon);
 }
 
 IFACEMETHODIMP CExplorerCommand::GetToolTip(IShellItemArray *psiItemArray, LPWSTR *ppszInfotip)
 {
     UNREFERENCED_PARAMETER(psiItemArray);
-
-    LPCWSTR tooltip;
-    switch (m_type)
-    {
-    case CommandType::RootMenuFolder:
-    case CommandType::RootMenuFile:
-        tooltip = L"Sync files and folders to Google Drive";
-        break;
-    case CommandType::SyncToDrive:
-        tooltip = L"Sync this folder to Google Drive and watch for changes";
-        break;
-    case CommandType::CopyToDrive:
-        tooltip = L"Copy to Google Drive (one-time upload)";
-        break;
-    case CommandType::GetDriveURL:
-        tooltip = L"Copy the Google Drive URL to clipboard";
-        break;
-    default:
-        tooltip = L"RRightclickrr";
-    }
-
-    return SHStrDupW(tooltip, ppszInfotip);
+    return SHStrDupW(m_pCommand->tooltip, ppszInfotip);
 }
 
 IFACEMETHODIMP CExplorerCommand::GetCanonicalName(GUID *pguidCommandName)
 {
-    switch (m_type)
-    {
-    case CommandType::RootMenuFolder:
-        *pguidCommandName = { 0x7b3b5e52, 0xa1f0, 0x4c5e, { 0x9b, 0x8a, 0x1c, 0x2d, 0x3e, 0x4f, 0x5a, 0x6a } };
-        break;
-    case CommandType::RootMenuFile:
-        *pguidCommandName = { 0x7b3b5e52, 0xa1f0, 0x4c5e, { 0x9b, 0x8a, 0x1c, 0x2d, 0x3e, 0x4f, 0x5a, 0x6e } };
-        break;
-    case CommandType::SyncToDrive:
-        *pguidCommandName = { 0x7b3b5e52, 0xa1f0, 0x4c5e, { 0x9b, 0x8a, 0x1c, 0x2d, 0x3e, 0x4f, 0x5a, 0x6b } };
-        break;
-    case CommandType::CopyToDrive:
-        *pguidCommandName = { 0x7b3b5e52, 0xa1f0, 0x4c5e, { 0x9b, 0x8a, 0x1c, 0x2d, 0x3e, 0x4f, 0x5a, 0x6c } };
-        break;
-    case CommandType::GetDriveURL:
-        *pguidCommandName = { 0x7b3b5e52, 0xa1f0, 0x4c5e, { 0x9b, 0x8a, 0x1c, 0x2d, 0x3e, 0x4f, 0x5a, 0x6d } };
-        break;
-    }
+    *pguidCommandName = ToGuid(m_pCommand->clsid);
     return S_OK;
 }
 
@@ -264,12 +313,16 @@ IFACEMETHODIMP CExplorerCommand::GetState(IShellItemArray *psiItemArray, BOOL fO
 {
     UNREFERENCED_PARAMETER(fOkToBeSlow);
 
+    CShellStats &stats = ProcessShellStats();
+    CShellStatsTimer timer(stats, ShellTimer::GetState);
+    stats.Count(ShellCounter::GetStateCalls);
+
     *pCmdState = ECS_ENABLED;
 
     if (psiItemArray == nullptr)
     {
         // Root menu should still show
-        if (m_type != CommandType::RootMenuFolder && m_type != CommandType::RootMenuFile)
+        if (!m_pCommand->hasSubcommands)
             *pCmdState = ECS_HIDDEN;
         return S_OK;
     }
@@ -281,74 +334,45 @@ IFACEMETHODIMP CExplorerCommand::Invoke(IShellItemArray *psiItemArray, IBindCtx
 {
     UNREFERENCED_PARAMETER(pbc);
 
+    CShellStats &stats = ProcessShellStats();
+    CShellStatsTimer timer(stats, ShellTimer::Invoke);
+    stats.Count(ShellCounter::InvokeCalls);
+
     // Root menu doesn't invoke - it has subcommands
-    if (m_type == CommandType::RootMenuFolder || m_type == CommandType::RootMenuFile)
+    if (m_pCommand->hasSubcommands)
         return S_OK;
 
-    if (psiItemArray == nullptr)
-        return E_INVALIDARG;
-
-    WCHAR szPath[MAX_PATH];
-    HRESULT hr = GetSelectedPath(psiItemArray, szPath, ARRAYSIZE(szPath));
-    if (FAILED(hr))
-        return hr;
-
-    WCHAR szAppPath[MAX_PATH];
-    hr = GetAppPath(szAppPath, ARRAYSIZE(szAppPath));
+    // Only the selection is read here, while the item array is usable on this
+    // thread; the invoke worker does the rest once the menu has closed.
+    InvokeRequest request;
+    HRESULT hr = psiItemArray ? GetCommandMode(*m_pCommand, request.mode) : E_INVALIDARG;
+    if (SUCCEEDED(hr))
+        hr = GetSelectedPaths(psiItemArray, request.paths);
+    if (SUCCEEDED(hr))
+        hr = QueueInvoke(std::move(request));
     if (FAILED(hr))
-        return hr;
-
-    WCHAR szArgs[MAX_PATH * 2];
-    switch (m_type)
-    {
-    case CommandType::SyncToDrive:
-        StringCchPrintfW(szArgs, ARRAYSIZE(szArgs), L"--sync-folder \"%s\"", szPath);
-        break;
-    case CommandType::CopyToDrive:
-        StringCchPrintfW(szArgs, ARRAYSIZE(szArgs), L"--copy-folder \"%s\"", szPath);
-        break;
-    case CommandType::GetDriveURL:
-        StringCchPrintfW(szArgs, ARRAYSIZE(szArgs), L"--get-url \"%s\"", szPath);
-        break;
-    default:
-        return E_INVALIDARG;
-    }
-
-    SHELLEXECUTEINFOW sei = { sizeof(sei) };
-    sei.fMask = SEE_MASK_NOCLOSEPROCESS;
-    sei.lpFile = szAppPath;
-    sei.lpParameters = szArgs;
-    sei.nShow = SW_SHOWNORMAL;
-
-    if (!ShellExecuteExW(&sei))
-        return HRESULT_FROM_WIN32(GetLastError());
-
-    if (sei.hProcess)
-        CloseHandle(sei.hProcess);
-
-    return S_OK;
+        stats.Count(ShellCounter::InvokeFailures);
+    return hr;
 }
 
 IFACEMETHODIMP CExplorerCommand::GetFlags(EXPCMDFLAGS *pFlags)
 {
-    if (m_type == CommandType::RootMenuFolder || m_type == CommandType::RootMenuFile)
-        *pFlags = ECF_HASSUBCOMMANDS;
-    else
-        *pFlags = ECF_DEFAULT;
+    *pFlags = m_pCommand->hasSubcommands ? ECF_HASSUBCOMMANDS : ECF_DEFAULT;
     return S_OK;
 }
 
 IFACEMETHODIMP CExplorerCommand::EnumSubCommands(IEnumExplorerCommand **ppEnum)
 {
-    if (m_type != CommandType::RootMenuFolder && m_type != CommandType::RootMenuFile)
+    if (!m_pCommand->hasSubcommands)
     {
         *ppEnum = nullptr;
         return E_NOTIMPL;
     }
 
     // Folder menus include Sync/Copy/GetURL; file menus include GetURL only.
-    const bool isFolderMenu = (m_type == CommandType::RootMenuFolder);
-    *ppEnum = new (std::nothrow) CEnumExplorerCommand(isFolderMenu);
+    const CommandList &commands =
+        m_pCommand->type == CommandType::RootMenuFolder ? kFolderSubcommands : kFileSubcommands;
+    *ppEnum = new (std::nothrow) CEnumExplorerCommand(commands);
     return *ppEnum ? S_OK : E_OUTOFMEMORY;
 }
 
@@ -375,41 +399,247 @@ IFACEMETHODIMP CExplorerCommand::GetSite(REFIID riid, void **ppv)
     return E_FAIL;
 }
 
-// Helper: Get the app executable path
-HRESULT CExplorerCommand::GetAppPath(LPWSTR pszPath, DWORD cchPath)
+// Helper: Get the file system paths of every selected item
+HRESULT CExplorerCommand::GetSelectedPaths(IShellItemArray *psiItemArray, std::vector<std::wstring> &paths)
+{
+    DWORD count = 0;
+    HRESULT hr = psiItemArray->GetCount(&count);
+    if (FAILED(hr))
+        return hr;
+
+    paths.reserve(count);
+    for (DWORD i = 0; i < count; i++)
+    {
+        IShellItem *psi = nullptr;
+        if (FAILED(psiItemArray->GetItemAt(i, &psi)))
+            continue;
+
+        // Items with no file system path (libraries, Control Panel) are skipped.
+        PWSTR pszName = nullptr;
+        if (SUCCEEDED(psi->GetDisplayName(SIGDN_FILESYSPATH, &pszName)))
+        {
+            paths.emplace_back(pszName);
+            CoTaskMemFree(pszName);
+        }
+        psi->Release();
+    }
+
+    return paths.empty() ? E_INVALIDARG : S_OK;
+}
+
+// Helper: Write a batch request to a new file under %TEMP%; the app deletes it
+static HRESULT WriteBatchFile(BatchMode mode, const std::vector<std::wstring> &paths, std::wstring &file)
 {
-    WCHAR szDllPath[MAX_PATH];
-    if (GetModuleFileNameW(g_hModule, szDllPath, ARRAYSIZE(szDllPath)) == 0)
+    WCHAR szTempDir[MAX_PATH];
+    WCHAR szFile[MAX_PATH];
+    if (GetTempPathW(ARRAYSIZE(szTempDir), szTempDir) == 0 || GetTempFileNameW(szTempDir, L"rrb", 0, szFile) == 0)
         return HRESULT_FROM_WIN32(GetLastError());
 
-    HRESULT hr = PathCchRemoveFileSpec(szDllPath, ARRAYSIZE(szDllPath));
-    if (FAILED(hr))
+    const std::string request = BuildBatchRequest(mode, paths);
+    HANDLE hFile = CreateFileW(szFile, GENERIC_WRITE, 0, nullptr, TRUNCATE_EXISTING, FILE_ATTRIBUTE_TEMPORARY, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        const HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        DeleteFileW(szFile);
         return hr;
+    }
 
-    hr = PathCchRemoveFileSpec(szDllPath, ARRAYSIZE(szDllPath));
+    DWORD written = 0;
+    const BOOL ok = WriteFile(hFile, request.data(), static_cast<DWORD>(request.size()), &written, nullptr) &&
+                    written == request.size();
+    const HRESULT hr = ok ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+    CloseHandle(hFile);
     if (FAILED(hr))
+    {
+        DeleteFileW(szFile);
         return hr;
+    }
 
-    hr = PathCchCombine(pszPath, cchPath, szDllPath, L"RRightclickrr.exe");
-    return hr;
+    file = szFile;
+    return S_OK;
 }
 
-// Helper: Get the selected file/folder path
-HRESULT CExplorerCommand::GetSelectedPath(IShellItemArray *psiItemArray, LPWSTR pszPath, DWORD cchPath)
+// Helper: Launch the app with the command's arguments for the reduced selection
+static HRESULT LaunchApp(BatchMode mode, const std::vector<std::wstring> &paths)
 {
-    IShellItem *psi = nullptr;
-    HRESULT hr = psiItemArray->GetItemAt(0, &psi);
+    LPCWSTR pszFlag;
+    switch (mode)
+    {
+    case BatchMode::Sync:
+        pszFlag = L"--sync-folder";
+        break;
+    case BatchMode::Copy:
+        pszFlag = L"--copy-folder";
+        break;
+    case BatchMode::GetUrl:
+        pszFlag = L"--get-url";
+        break;
+    default:
+        return E_INVALIDARG;
+    }
+
+    const ModulePaths &modulePaths = GetModulePaths();
+    HRESULT hr = modulePaths.hr;
     if (FAILED(hr))
         return hr;
 
-    PWSTR pszName = nullptr;
-    hr = psi->GetDisplayName(SIGDN_FILESYSPATH, &pszName);
-    if (SUCCEEDED(hr))
+    // One item keeps the plain flag; several go to the app in one request.
+    std::wstring batchFile;
+    std::wstring args;
+    if (paths.size() == 1)
+    {
+        args = std::wstring(pszFlag) + L" \"" + paths[0] + L"\"";
+    }
+    else
+    {
+        hr = WriteBatchFile(mode, paths, batchFile);
+        if (FAILED(hr))
+            return hr;
+        args = L"--batch \"" + batchFile + L"\"";
+    }
+
+    // No process handle is needed. The worker has no message loop, so the
+    // launch must finish before ShellExecuteEx returns, and failures are
+    // reported by ReportInvokeFailure rather than the shell's own dialog.
+    SHELLEXECUTEINFOW sei = { sizeof(sei) };
+    sei.fMask = SEE_MASK_NOASYNC | SEE_MASK_FLAG_NO_UI;
+    sei.lpFile = modulePaths.appPath;
+    sei.lpParameters = args.c_str();
+    sei.nShow = SW_SHOWNORMAL;
+
+    if (!ShellExecuteExW(&sei))
     {
-        hr = StringCchCopyW(pszPath, cchPath, pszName);
-        CoTaskMemFree(pszName);
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        if (!batchFile.empty())
+            DeleteFileW(batchFile.c_str());
+        return hr;
     }
 
-    psi->Release();
+    return S_OK;
+}
+
+// Helper: Copy the selection's Drive links from the link index, in process.
+// S_FALSE when the index cannot answer for every item and the app has to.
+static HRESULT CopyDriveLink(const std::vector<std::wstring> &paths)
+{
+    std::wstring text;
+    HRESULT hr = FindDriveLinks(paths, text);
+    if (hr == S_OK)
+        hr = SetClipboardText(text);
+
+    ProcessShellStats().Count(hr == S_OK ? ShellCounter::LinksCopied : ShellCounter::LinkIndexMisses);
+    return hr == S_OK ? S_OK : S_FALSE;
+}
+
+// Helper: Run one queued request on the invoke worker: links from the link
+// index, then the running app's pipe, then a process launch.
+static HRESULT DispatchInvoke(const InvokeRequest &request)
+{
+    CShellStats &stats = ProcessShellStats();
+    CShellStatsTimer timer(stats, ShellTimer::Dispatch);
+
+    // Links of synced items are copied here; the app is asked only on a miss.
+    if (request.mode == BatchMode::GetUrl && CopyDriveLink(request.paths) == S_OK)
+        return S_OK;
+
+    // Items inside another selected folder are covered by that folder's job.
+    const std::vector<std::wstring> paths = ReduceSelection(request.paths);
+    if (paths.empty())
+        return E_INVALIDARG;
+
+    // A running app takes the command over its pipe; only when none answers
+    // in time is a second app process started to forward it.
+    if (SendShellCommand(ShellCommandEndpoint(), EncodeShellCommand(request.mode, paths), kShellCommandTimeoutMs) ==
+        ShellCommandResult::Accepted)
+    {
+        stats.Count(ShellCounter::PipedCommands);
+        return S_OK;
+    }
+    stats.Count(ShellCounter::PipeFallbacks);
+
+    return LaunchApp(request.mode, paths);
+}
+
+// Helper: Tell the user a command did not reach the app. Invoke returned long
+// ago, so this is the only place the failure can surface.
+static void ReportInvokeFailure(HRESULT hr)
+{
+    WCHAR szReason[256] = L"";
+    FormatMessageW(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, nullptr, static_cast<DWORD>(hr), 0,
+                   szReason, ARRAYSIZE(szReason), nullptr);
+
+    WCHAR szMessage[512];
+    StringCchPrintfW(szMessage, ARRAYSIZE(szMessage), L"RRightclickrr could not run this command.\n\n%s", szReason);
+    MessageBoxW(nullptr, szMessage, L"RRightclickrr", MB_OK | MB_ICONWARNING | MB_SETFOREGROUND);
+}
+
+// Starts the invoke worker on first use. Each queued request holds a DLL
+// reference until the worker is done with it, so DllCanUnloadNow only stops
+// an idle worker.
+static bool EnsureInvokeWorker()
+{
+    if (g_invokeQueue.IsRunning())
+        return true;
+
+    std::lock_guard<std::mutex> lock(g_invokeQueueMutex);
+    CInvokeQueue::Options options;
+    // ShellExecuteEx wants COM initialized on the calling thread.
+    options.onThreadStart = []() {
+        t_comInit = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
+    };
+    options.onThreadExit = []() {
+        if (SUCCEEDED(t_comInit))
+            CoUninitialize();
+    };
+
+    const auto dispatch = [](const InvokeRequest &request) {
+        const HRESULT hr = DispatchInvoke(request);
+        if (FAILED(hr))
+        {
+            ProcessShellStats().Count(ShellCounter::InvokeFailures);
+            ReportInvokeFailure(hr);
+        }
+        InterlockedDecrement(&g_cDllRef);
+    };
+    const auto coalesced = [](const InvokeRequest &) {
+        ProcessShellStats().Count(ShellCounter::InvokesCoalesced);
+        InterlockedDecrement(&g_cDllRef);
+    };
+    return g_invokeQueue.Start(dispatch, coalesced, std::move(options));
+}
+
+// Helper: Hand a request to the invoke worker. If the worker cannot start,
+// the request runs inline as before.
+static HRESULT QueueInvoke(InvokeRequest &&request)
+{
+    if (!EnsureInvokeWorker())
+        return DispatchInvoke(request);
+
+    InterlockedIncrement(&g_cDllRef);
+    const InvokeQueueResult result = g_invokeQueue.Enqueue(std::move(request));
+    if (result == InvokeQueueResult::Queued)
+        return S_OK;
+
+    InterlockedDecrement(&g_cDllRef);
+    return result == InvokeQueueResult::Full ? HRESULT_FROM_WIN32(ERROR_BUSY) : DispatchInvoke(request);
+}
+
+void ShutdownInvokeQueue()
+{
+    std::lock_guard<std::mutex> lock(g_invokeQueueMutex);
+    g_invokeQueue.Stop();
+}
+
+HRESULT CreateExplorerCommand(CommandType type, REFIID riid, void **ppv)
+{
+    if (!DescribeCommand(type).hasSubcommands)
+        return CExplorerCommand::Shared(type)->QueryInterface(riid, ppv);
+
+    CExplorerCommand *pCommand = new (std::nothrow) CExplorerCommand(type);
+    if (!pCommand)
+        return E_OUTOFMEMORY;
+
+    HRESULT hr = pCommand->QueryInterface(riid, ppv);
+    pCommand->Release();
     return hr;
 }
@@ -5,21 +5,20 @@
 #include <windows.h>
 #include <shobjidl.h>
 #include <shlwapi.h>
-
-enum class CommandType
-{
-    RootMenuFolder, // Parent menu for directory selection
-    RootMenuFile,   // Parent menu for file selection
-    SyncToDrive,
-    CopyToDrive,
-    GetDriveURL
-};
+#include <cstring>
+#include <string>
+#include <vector>
+#include "CommandTable.h"
 
 class CExplorerCommand : public IExplorerCommand, public IObjectWithSite
 {
 public:
     CExplorerCommand(CommandType type);
 
+    // Subcommands keep no per-menu state, so one instance of each serves
+    // every menu in the process. Returned without a reference.
+    static CExplorerCommand *Shared(CommandType type);
+
     // IUnknown
     IFACEMETHODIMP QueryInterface(REFIID riid, void **ppv);
     IFACEMETHODIMP_(ULONG) AddRef();
@@ -40,15 +39,31 @@ public:
     IFACEMETHODIMP GetSite(REFIID riid, void **ppv);
 
 private:
+    CExplorerCommand(CommandType type, bool shared);
     ~CExplorerCommand();
 
-    HRESULT GetAppPath(LPWSTR pszPath, DWORD cchPath);
-    HRESULT GetSelectedPath(IShellItemArray *psiItemArray, LPWSTR pszPath, DWORD cchPath);
+    HRESULT GetSelectedPaths(IShellItemArray *psiItemArray, std::vector<std::wstring> &paths);
 
     long m_cRef;
-    CommandType m_type;
+    const CommandDescriptor *m_pCommand;
+    bool m_shared; // References pin the DLL but never free the object
     IUnknown *m_pSite;
 };
 
+// Root menus get their own object (Explorer sets a site on it); subcommands
+// get the shared one.
+HRESULT CreateExplorerCommand(CommandType type, REFIID riid, void **ppv);
+
+inline GUID ToGuid(const CommandGuid &guid)
+{
+    GUID result;
+    static_assert(sizeof(result) == sizeof(guid), "CommandGuid must match GUID");
+    memcpy(&result, &guid, sizeof(result));
+    return result;
+}
+
+// Stops the invoke worker; called from DllCanUnloadNow once nothing is queued.
+void ShutdownInvokeQueue();
+
 extern HMODULE g_hModule;
 extern long g_cDllRef;
@@ -0,0 +1,17 @@
+// RRightclickrr flushing written files to disk
+//
+// SyncDatabase promises that an applied batch survives a crash, which an
+// ofstream flush alone does not: it only reaches the OS cache. These push a
+// file (and, for renames, its directory) through to the disk.
+
+#pragma once
+
+#include <filesystem>
+
+// Writes the file's cached data to disk: fsync, or FlushFileBuffers. Works
+// while the file is open elsewhere; false if it cannot be opened or synced.
+bool FlushFileToDisk(const std::filesystem::path &file);
+
+// Makes a rename or create within directory durable. A no-op on Windows,
+// where NTFS logs metadata changes itself.
+bool FlushDirectoryToDisk(const std::filesystem::path &directory);
@@ -0,0 +1,30 @@
+// RRightclickrr flushing written files to disk (POSIX)
+
+#include "FileFlush.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+bool Flush(const std::filesystem::path &path, int flags)
+{
+    const int fd = open(path.c_str(), flags | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    const bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+} // namespace
+
+bool FlushFileToDisk(const std::filesystem::path &file)
+{
+    return Flush(file, O_WRONLY);
+}
+
+bool FlushDirectoryToDisk(const std::filesystem::path &directory)
+{
+    return Flush(directory, O_RDONLY | O_DIRECTORY);
+}
@@ -0,0 +1,23 @@
+// RRightclickrr flushing written files to disk (Windows)
+
+#include "FileFlush.h"
+#include <windows.h>
+
+bool FlushFileToDisk(const std::filesystem::path &file)
+{
+    // Any handle with write access flushes the data cached for the file.
+    HANDLE handle = CreateFileW(file.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    const bool flushed = FlushFileBuffers(handle) != FALSE;
+    CloseHandle(handle);
+    return flushed;
+}
+
+bool FlushDirectoryToDisk(const std::filesystem::path &)
+{
+    return true;
+}
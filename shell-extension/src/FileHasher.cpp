@@ -0,0 +1,177 @@
+// RRightclickrr batch file hashing
+
+#include "FileHasher.h"
+#include "SequentialFileReader.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace
+{
+// Small files are hashed once this many are waiting, so lanes that finish
+// early have another file to take.
+constexpr size_t kSmallFileBatch = 16;
+
+struct ReadState
+{
+    CMd5 md5;
+    std::string whole; // The file so far, while it is still small
+    size_t limit = 0;
+    bool streaming = false;
+    uint64_t size = 0;
+
+    void Start()
+    {
+        whole.clear();
+        streaming = false;
+        size = 0;
+    }
+
+    static void Consume(const char *data, size_t size, void *context)
+    {
+        auto *state = static_cast<ReadState *>(context);
+        state->size += size;
+        if (!state->streaming && state->whole.size() + size <= state->limit)
+        {
+            state->whole.append(data, size);
+            return;
+        }
+        if (!state->streaming)
+        {
+            state->streaming = true;
+            state->md5.Reset();
+            state->md5.Update(state->whole.data(), state->whole.size());
+            state->whole.clear();
+        }
+        state->md5.Update(data, size);
+    }
+};
+
+class CHashRun
+{
+public:
+    CHashRun(const std::vector<std::string> &paths, const FileHashOptions &options,
+             std::vector<FileHashResult> &results, const std::atomic<bool> &cancelled)
+        : m_paths(paths), m_options(options), m_results(results), m_cancelled(cancelled)
+    {
+    }
+
+    void Worker(FileHashTotals &totals);
+
+private:
+    void FlushSmall(std::vector<std::string> &data, std::vector<size_t> &indexes, FileHashTotals &totals);
+
+    const std::vector<std::string> &m_paths;
+    const FileHashOptions &m_options;
+    std::vector<FileHashResult> &m_results;
+    const std::atomic<bool> &m_cancelled;
+    std::atomic<size_t> m_next{0};
+};
+
+void CHashRun::FlushSmall(std::vector<std::string> &data, std::vector<size_t> &indexes, FileHashTotals &totals)
+{
+    if (indexes.empty())
+    {
+        return;
+    }
+    std::vector<std::string_view> messages(data.begin(), data.begin() + indexes.size());
+    std::vector<Md5Digest> digests(indexes.size());
+    HashMd5Many(messages.data(), messages.size(), digests.data());
+    for (size_t i = 0; i < indexes.size(); i++)
+    {
+        m_results[indexes[i]].digest = digests[i];
+        m_results[indexes[i]].ok = true;
+    }
+    totals.multiBufferFiles += indexes.size();
+    indexes.clear();
+}
+
+void CHashRun::Worker(FileHashTotals &totals)
+{
+    const size_t bufferSize = std::max<size_t>(m_options.bufferSize, 64 * 1024);
+    std::unique_ptr<char[]> buffer(new char[bufferSize]);
+    ReadState state;
+    state.limit = m_options.smallFileLimit;
+
+    // Whole small files waiting for FlushSmall; strings are reused.
+    std::vector<std::string> smallData(kSmallFileBatch);
+    std::vector<size_t> smallIndexes;
+
+    for (;;)
+    {
+        const size_t index = m_next.fetch_add(1, std::memory_order_relaxed);
+        if (index >= m_paths.size() || m_cancelled.load(std::memory_order_relaxed))
+        {
+            break;
+        }
+
+        state.Start();
+        FileHashResult &result = m_results[index];
+        if (!ReadFileSequential(std::filesystem::u8path(m_paths[index]), buffer.get(), bufferSize,
+                                &ReadState::Consume, &state))
+        {
+            totals.failed++;
+            continue;
+        }
+
+        result.size = state.size;
+        totals.files++;
+        totals.bytes += state.size;
+        if (state.streaming)
+        {
+            result.digest = state.md5.Final();
+            result.ok = true;
+            continue;
+        }
+        smallData[smallIndexes.size()].swap(state.whole);
+        smallIndexes.push_back(index);
+        if (smallIndexes.size() == kSmallFileBatch)
+        {
+            FlushSmall(smallData, smallIndexes, totals);
+        }
+    }
+    FlushSmall(smallData, smallIndexes, totals);
+}
+} // namespace
+
+void CFileHasher::Hash(const std::vector<std::string> &paths, const FileHashOptions &options,
+                       std::vector<FileHashResult> &results, FileHashTotals &totals)
+{
+    const auto start = std::chrono::steady_clock::now();
+    results.assign(paths.size(), FileHashResult());
+    totals = {};
+
+    unsigned threads = options.threads;
+    if (threads == 0)
+    {
+        threads = std::thread::hardware_concurrency();
+    }
+    threads = std::clamp(threads, 1u, kMaxHashThreads);
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(paths.size(), 1)));
+
+    CHashRun run(paths, options, results, m_cancelled);
+    std::vector<FileHashTotals> perThread(threads);
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; i++)
+    {
+        pool.emplace_back(&CHashRun::Worker, &run, std::ref(perThread[i]));
+    }
+    run.Worker(perThread[0]);
+    for (auto &thread : pool)
+    {
+        thread.join();
+    }
+
+    for (const FileHashTotals &part : perThread)
+    {
+        totals.files += part.files;
+        totals.failed += part.failed;
+        totals.bytes += part.bytes;
+        totals.multiBufferFiles += part.multiBufferFiles;
+    }
+    totals.threads = threads;
+    totals.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,63 @@
+// RRightclickrr batch file hashing
+//
+// MD5s of many files for FolderSync's drift check and upload verification.
+// Files are handed out to a small thread pool one at a time and read front to
+// back through a 1 MiB buffer per thread. Files up to smallFileLimit are kept
+// whole and hashed several at once through HashMd5Many; larger ones stream
+// through CMd5 as they are read.
+
+#pragma once
+
+#include "Md5.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr unsigned kMaxHashThreads = 8;
+
+struct FileHashOptions
+{
+    unsigned threads = 0;              // 0 = one per core, at most kMaxHashThreads
+    size_t smallFileLimit = 64 * 1024; // Largest file hashed multi-buffer
+    size_t bufferSize = 1024 * 1024;   // Read size per thread
+};
+
+struct FileHashResult
+{
+    bool ok = false; // False when the file could not be read
+    uint64_t size = 0;
+    Md5Digest digest = {};
+};
+
+struct FileHashTotals
+{
+    uint64_t files = 0; // Hashed
+    uint64_t failed = 0;
+    uint64_t bytes = 0;
+    uint64_t multiBufferFiles = 0; // Of files, hashed side by side
+    double elapsedMs = 0;
+    unsigned threads = 0;
+};
+
+class CFileHasher
+{
+public:
+    // Hashes every UTF-8 path into results (same order) on the calling thread
+    // and up to threads - 1 more. Returns once all are done or Cancel was
+    // called; files not reached are left failed.
+    void Hash(const std::vector<std::string> &paths, const FileHashOptions &options,
+              std::vector<FileHashResult> &results, FileHashTotals &totals);
+
+    // Stops a running Hash after the files in progress; callable from any
+    // thread. Sticky: a Cancel that lands before Hash starts (the batch is
+    // still queued) makes it return with every file failed.
+    void Cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+
+    // Clears Cancel to reuse the hasher; call it when queuing the next batch,
+    // never from the thread about to hash it.
+    void Reset() { m_cancelled.store(false, std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> m_cancelled{false};
+};
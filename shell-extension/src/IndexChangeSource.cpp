@@ -0,0 +1,218 @@
+// RRightclickrr overlay index change notification (portable parts)
+
+#include "IndexChangeSource.h"
+#include <chrono>
+#include <condition_variable>
+#include <system_error>
+
+namespace
+{
+struct FileStamp
+{
+    bool exists = false;
+    uintmax_t size = 0;
+    std::filesystem::file_time_type writeTime = {};
+
+    bool operator==(const FileStamp &other) const
+    {
+        return exists == other.exists && size == other.size && writeTime == other.writeTime;
+    }
+};
+
+FileStamp ReadStamp(const std::filesystem::path &file)
+{
+    FileStamp stamp;
+    std::error_code ec;
+    stamp.size = std::filesystem::file_size(file, ec);
+    if (ec)
+    {
+        return {};
+    }
+    stamp.writeTime = std::filesystem::last_write_time(file, ec);
+    stamp.exists = !ec;
+    return stamp;
+}
+
+class CPollingChangeSource : public IIndexChangeSource
+{
+public:
+    CPollingChangeSource(std::vector<std::filesystem::path> files, uint32_t intervalMs)
+        : m_files(std::move(files)), m_intervalMs(intervalMs), m_cancelled(false)
+    {
+        for (const std::filesystem::path &file : m_files)
+        {
+            m_stamps.push_back(ReadStamp(file));
+        }
+    }
+
+    bool WaitForChange(uint32_t timeoutMs) override
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            const uint32_t waitMs = timeoutMs < m_intervalMs ? timeoutMs : m_intervalMs;
+            if (m_cv.wait_for(lock, std::chrono::milliseconds(waitMs), [this]() { return m_cancelled; }))
+            {
+                return false;
+            }
+        }
+
+        bool changed = false;
+        for (size_t i = 0; i < m_files.size(); i++)
+        {
+            const FileStamp stamp = ReadStamp(m_files[i]);
+            if (!(stamp == m_stamps[i]))
+            {
+                m_stamps[i] = stamp;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    void Cancel() override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancelled = true;
+        m_cv.notify_all();
+    }
+
+private:
+    std::vector<std::filesystem::path> m_files;
+    std::vector<FileStamp> m_stamps;
+    uint32_t m_intervalMs;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_cancelled;
+};
+
+constexpr uint32_t kWaitSliceMs = 1000;
+} // namespace
+
+std::unique_ptr<IIndexChangeSource> CreatePollingChangeSource(std::vector<std::filesystem::path> files, uint32_t intervalMs)
+{
+    return std::make_unique<CPollingChangeSource>(std::move(files), intervalMs);
+}
+
+#if !defined(_WIN32) && !defined(__linux__)
+std::unique_ptr<IIndexChangeSource> CreateDirectoryChangeSource(const std::filesystem::path &)
+{
+    return nullptr;
+}
+#endif
+
+CIndexChangeMonitor::CIndexChangeMonitor()
+    : m_pollIntervalMs(0), m_allowNativeSource(true), m_stop(false), m_running(false), m_usingFallback(false),
+      m_pending(false), m_changeCount(0)
+{
+}
+
+CIndexChangeMonitor::~CIndexChangeMonitor()
+{
+    Stop();
+}
+
+bool CIndexChangeMonitor::Start(const std::filesystem::path &directory, std::vector<std::filesystem::path> watchedFiles,
+                                uint32_t pollIntervalMs, bool allowNativeSource)
+{
+    if (m_thread.joinable())
+    {
+        return true;
+    }
+
+    m_directory = directory;
+    m_watchedFiles = std::move(watchedFiles);
+    m_pollIntervalMs = pollIntervalMs;
+    m_allowNativeSource = allowNativeSource;
+    m_stop.store(false);
+    m_source = CreateSource();
+    MarkChanged();
+
+    try
+    {
+        m_thread = std::thread(&CIndexChangeMonitor::Run, this);
+    }
+    catch (const std::system_error &)
+    {
+        m_source.reset();
+        return false;
+    }
+
+    m_running.store(true, std::memory_order_release);
+    return true;
+}
+
+void CIndexChangeMonitor::Stop()
+{
+    if (!m_thread.joinable())
+    {
+        return;
+    }
+
+    m_stop.store(true);
+    {
+        std::lock_guard<std::mutex> lock(m_sourceMutex);
+        if (m_source)
+        {
+            m_source->Cancel();
+        }
+    }
+
+    m_thread.join();
+    m_source.reset();
+    m_running.store(false, std::memory_order_release);
+}
+
+std::unique_ptr<IIndexChangeSource> CIndexChangeMonitor::CreateSource()
+{
+    if (m_allowNativeSource)
+    {
+        if (std::unique_ptr<IIndexChangeSource> source = CreateDirectoryChangeSource(m_directory))
+        {
+            m_usingFallback.store(false, std::memory_order_relaxed);
+            return source;
+        }
+    }
+
+    m_usingFallback.store(true, std::memory_order_relaxed);
+    return CreatePollingChangeSource(m_watchedFiles, m_pollIntervalMs);
+}
+
+void CIndexChangeMonitor::Run()
+{
+    IIndexChangeSource *source = m_source.get();
+    while (!m_stop.load())
+    {
+        if (!source)
+        {
+            std::unique_ptr<IIndexChangeSource> created = CreateSource();
+            std::lock_guard<std::mutex> lock(m_sourceMutex);
+            m_source = std::move(created);
+            source = m_source.get();
+            if (m_stop.load())
+            {
+                break;
+            }
+        }
+
+        if (!source->WaitForChange(kWaitSliceMs))
+        {
+            continue;
+        }
+
+        m_changeCount.fetch_add(1, std::memory_order_relaxed);
+        MarkChanged();
+        if (m_onChange)
+        {
+            m_onChange();
+        }
+
+        // The directory may not have existed when we started; once something
+        // shows up, try to upgrade from polling to real notifications.
+        if (m_allowNativeSource && UsingPollingFallback())
+        {
+            std::lock_guard<std::mutex> lock(m_sourceMutex);
+            m_source.reset();
+            source = nullptr;
+        }
+    }
+}
@@ -0,0 +1,89 @@
+// RRightclickrr overlay index change notification
+//
+// A background monitor marks the overlay cache dirty when the index directory
+// changes, so lookups never touch the filesystem to find out. The
+// notification source is pluggable: directory change notifications on
+// Windows, inotify on Linux, and timestamp polling as the fallback.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class IIndexChangeSource
+{
+public:
+    virtual ~IIndexChangeSource() = default;
+
+    // Blocks until the directory changes (true) or the timeout elapses or the
+    // source is cancelled (false).
+    virtual bool WaitForChange(uint32_t timeoutMs) = 0;
+
+    // Wakes a blocked WaitForChange from another thread; sticky.
+    virtual void Cancel() = 0;
+};
+
+// Platform notification source, or nullptr when unsupported or the directory
+// does not exist yet.
+std::unique_ptr<IIndexChangeSource> CreateDirectoryChangeSource(const std::filesystem::path &directory);
+
+// Fallback that compares size and write time of the given files.
+std::unique_ptr<IIndexChangeSource> CreatePollingChangeSource(std::vector<std::filesystem::path> files, uint32_t intervalMs);
+
+class CIndexChangeMonitor
+{
+public:
+    CIndexChangeMonitor();
+    ~CIndexChangeMonitor();
+
+    CIndexChangeMonitor(const CIndexChangeMonitor &) = delete;
+    CIndexChangeMonitor &operator=(const CIndexChangeMonitor &) = delete;
+
+    // Starts watching directory on a background thread. A change is pending
+    // right after Start so the first lookup loads the index.
+    bool Start(const std::filesystem::path &directory, std::vector<std::filesystem::path> watchedFiles,
+               uint32_t pollIntervalMs, bool allowNativeSource = true);
+    void Stop();
+
+    // Called on the monitor thread after each change it marks; set before
+    // Start.
+    void SetChangeCallback(std::function<void()> onChange) { m_onChange = std::move(onChange); }
+
+    bool IsRunning() const { return m_running.load(std::memory_order_acquire); }
+    bool UsingPollingFallback() const { return m_usingFallback.load(std::memory_order_relaxed); }
+
+    // Hot path: a single atomic load, no I/O.
+    bool HasPendingChange() const { return m_pending.load(std::memory_order_acquire); }
+
+    // Claims the pending change before reloading; a change that lands during
+    // the reload sets it again.
+    bool ConsumeChange() { return m_pending.exchange(false, std::memory_order_acq_rel); }
+    void MarkChanged() { m_pending.store(true, std::memory_order_release); }
+
+    uint64_t ChangeCount() const { return m_changeCount.load(std::memory_order_relaxed); }
+
+private:
+    void Run();
+    std::unique_ptr<IIndexChangeSource> CreateSource();
+
+    std::filesystem::path m_directory;
+    std::vector<std::filesystem::path> m_watchedFiles;
+    uint32_t m_pollIntervalMs;
+    bool m_allowNativeSource;
+    std::function<void()> m_onChange;
+
+    std::mutex m_sourceMutex;
+    std::unique_ptr<IIndexChangeSource> m_source;
+    std::thread m_thread;
+    std::atomic<bool> m_stop;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_usingFallback;
+    std::atomic<bool> m_pending;
+    std::atomic<uint64_t> m_changeCount;
+};
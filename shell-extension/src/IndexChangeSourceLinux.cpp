@@ -0,0 +1,78 @@
+// RRightclickrr overlay index change notification (Linux, inotify)
+//
+// Stand-in for the Windows directory change notifications so the monitor can
+// be exercised by the Linux bench.
+
+#include "IndexChangeSource.h"
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace
+{
+class CInotifyChangeSource : public IIndexChangeSource
+{
+public:
+    CInotifyChangeSource(int inotifyFd, int cancelFd) : m_inotifyFd(inotifyFd), m_cancelFd(cancelFd) {}
+
+    ~CInotifyChangeSource() override
+    {
+        close(m_inotifyFd);
+        close(m_cancelFd);
+    }
+
+    bool WaitForChange(uint32_t timeoutMs) override
+    {
+        pollfd fds[2] = {{m_cancelFd, POLLIN, 0}, {m_inotifyFd, POLLIN, 0}};
+        const int ready = poll(fds, 2, static_cast<int>(timeoutMs));
+        if (ready <= 0 || (fds[0].revents & POLLIN) || !(fds[1].revents & POLLIN))
+        {
+            return false;
+        }
+
+        // One wakeup covers every queued event; drain them all.
+        alignas(inotify_event) char buffer[4096];
+        while (read(m_inotifyFd, buffer, sizeof(buffer)) > 0)
+        {
+        }
+        return true;
+    }
+
+    void Cancel() override
+    {
+        const uint64_t one = 1;
+        (void)!write(m_cancelFd, &one, sizeof(one));
+    }
+
+private:
+    int m_inotifyFd;
+    int m_cancelFd;
+};
+} // namespace
+
+std::unique_ptr<IIndexChangeSource> CreateDirectoryChangeSource(const std::filesystem::path &directory)
+{
+    const int inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+    {
+        return nullptr;
+    }
+
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ATTRIB;
+    if (inotify_add_watch(inotifyFd, directory.c_str(), mask) < 0)
+    {
+        close(inotifyFd);
+        return nullptr;
+    }
+
+    const int cancelFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (cancelFd < 0)
+    {
+        close(inotifyFd);
+        return nullptr;
+    }
+
+    return std::make_unique<CInotifyChangeSource>(inotifyFd, cancelFd);
+}
@@ -0,0 +1,62 @@
+// RRightclickrr overlay index change notification (Windows)
+
+#include "IndexChangeSource.h"
+#include <windows.h>
+
+namespace
+{
+class CDirectoryChangeSource : public IIndexChangeSource
+{
+public:
+    CDirectoryChangeSource(HANDLE change, HANDLE cancel) : m_change(change), m_cancel(cancel) {}
+
+    ~CDirectoryChangeSource() override
+    {
+        FindCloseChangeNotification(m_change);
+        CloseHandle(m_cancel);
+    }
+
+    bool WaitForChange(uint32_t timeoutMs) override
+    {
+        HANDLE handles[] = {m_cancel, m_change};
+        const DWORD result = WaitForMultipleObjects(ARRAYSIZE(handles), handles, FALSE, timeoutMs);
+        if (result != WAIT_OBJECT_0 + 1)
+        {
+            return false;
+        }
+
+        FindNextChangeNotification(m_change);
+        return true;
+    }
+
+    void Cancel() override
+    {
+        SetEvent(m_cancel);
+    }
+
+private:
+    HANDLE m_change;
+    HANDLE m_cancel;
+};
+} // namespace
+
+std::unique_ptr<IIndexChangeSource> CreateDirectoryChangeSource(const std::filesystem::path &directory)
+{
+    HANDLE change = FindFirstChangeNotificationW(
+        directory.c_str(),
+        FALSE,
+        FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+    if (change == INVALID_HANDLE_VALUE)
+    {
+        return nullptr;
+    }
+
+    HANDLE cancel = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!cancel)
+    {
+        FindCloseChangeNotification(change);
+        return nullptr;
+    }
+
+    return std::make_unique<CDirectoryChangeSource>(change, cancel);
+}
@@ -0,0 +1,126 @@
+// RRightclickrr background index reloader
+
+#include "IndexReloader.h"
+#include <chrono>
+#include <system_error>
+
+CIndexReloader::~CIndexReloader()
+{
+    Stop();
+}
+
+bool CIndexReloader::Start(ReloadFunction reload, Options options)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_thread.joinable())
+    {
+        return true;
+    }
+
+    m_reload = std::move(reload);
+    m_options = options;
+    m_stop = false;
+    m_urgent = true;
+    m_requests++;
+
+    try
+    {
+        m_thread = std::thread(&CIndexReloader::Run, this);
+    }
+    catch (const std::system_error &)
+    {
+        m_answered = m_requests;
+        m_urgent = false;
+        return false;
+    }
+
+    m_running.store(true, std::memory_order_release);
+    return true;
+}
+
+void CIndexReloader::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_thread.joinable())
+        {
+            return;
+        }
+        m_stop = true;
+    }
+    m_changed.notify_all();
+    m_thread.join();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_answered = m_requests;
+    m_urgent = false;
+    m_running.store(false, std::memory_order_release);
+}
+
+void CIndexReloader::Enqueue(bool urgent)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests++;
+        m_urgent = m_urgent || urgent;
+    }
+    m_changed.notify_all();
+}
+
+bool CIndexReloader::WaitForReload(uint64_t count, uint32_t timeoutMs) const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_changed.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                              [&]() { return m_reloads.load() > count || !m_running.load(); }) &&
+           m_reloads.load() > count;
+}
+
+void CIndexReloader::Run()
+{
+    using Clock = std::chrono::steady_clock;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_changed.wait(lock, [&]() { return m_stop || m_requests != m_answered; });
+        if (m_stop)
+        {
+            break;
+        }
+
+        // Let a burst of writes finish: wait for settleMs without a new
+        // request, but no longer than maxDelayMs in all.
+        const Clock::time_point latest = Clock::now() + std::chrono::milliseconds(m_options.maxDelayMs);
+        while (!m_stop && !m_urgent)
+        {
+            const uint64_t seen = m_requests;
+            const Clock::time_point quiet = Clock::now() + std::chrono::milliseconds(m_options.settleMs);
+            const Clock::time_point until = quiet < latest ? quiet : latest;
+            const bool interrupted =
+                m_changed.wait_until(lock, until, [&]() { return m_stop || m_urgent || m_requests != seen; });
+            if (!interrupted || Clock::now() >= latest)
+            {
+                break;
+            }
+        }
+        if (m_stop)
+        {
+            break;
+        }
+
+        // Requests made from here on need another pass: this one may already
+        // have read the files they are about.
+        const uint64_t requests = m_requests - m_answered;
+        m_answered = m_requests;
+        m_urgent = false;
+
+        lock.unlock();
+        m_reload(requests);
+        lock.lock();
+
+        m_reloads.fetch_add(1, std::memory_order_release);
+        m_changed.notify_all();
+    }
+
+    m_running.store(false, std::memory_order_release);
+    m_changed.notify_all();
+}
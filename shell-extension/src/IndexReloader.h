@@ -0,0 +1,85 @@
+// RRightclickrr background index reloader
+//
+// Runs every overlay index reload on one dedicated thread, so the Explorer
+// thread that asks IsMemberOf never opens, reads or parses anything: it
+// answers from whatever snapshot is published and at most asks for a reload.
+// The reload builds the next snapshot off to the side and publishes it in one
+// swap (CSnapshotPublisher).
+//
+// The app rewrites the index, its journal and the status file in quick
+// succession, and each write is a separate change notification. A request
+// starts a settle window that every further request extends, capped at a
+// maximum delay from the first, so a burst costs one reload. Urgent requests
+// (the app published a newer shared index) skip the window.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+class CIndexReloader
+{
+public:
+    struct Options
+    {
+        uint32_t settleMs = 50;    // Quiet time after the last request
+        uint32_t maxDelayMs = 500; // Longest a request waits while writes keep coming
+    };
+
+    // Called on the loader thread with the number of requests the pass
+    // answers (at least 1).
+    using ReloadFunction = std::function<void(uint64_t requests)>;
+
+    CIndexReloader() = default;
+    ~CIndexReloader();
+
+    CIndexReloader(const CIndexReloader &) = delete;
+    CIndexReloader &operator=(const CIndexReloader &) = delete;
+
+    // Starts the loader with an initial urgent request, so the first
+    // snapshot loads without waiting for a change.
+    bool Start(ReloadFunction reload, Options options);
+    bool Start(ReloadFunction reload) { return Start(std::move(reload), Options()); }
+
+    // Waits for a reload in progress, then joins the thread; pending requests
+    // are dropped.
+    void Stop();
+
+    // Hot path: one atomic load.
+    bool IsRunning() const { return m_running.load(std::memory_order_acquire); }
+
+    // Something changed; reload once the writes settle.
+    void Request() { Enqueue(false); }
+
+    // Reload as soon as the loader is free.
+    void RequestNow() { Enqueue(true); }
+
+    // Completed reload passes; one atomic load.
+    uint64_t ReloadCount() const { return m_reloads.load(std::memory_order_acquire); }
+
+    // Blocks until more than count passes have completed or timeoutMs
+    // elapses; true when they have.
+    bool WaitForReload(uint64_t count, uint32_t timeoutMs) const;
+
+private:
+    void Enqueue(bool urgent);
+    void Run();
+
+    ReloadFunction m_reload;
+    Options m_options;
+    std::thread m_thread;
+
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_changed;
+    bool m_stop = false;
+    bool m_urgent = false;
+    uint64_t m_requests = 0; // Total ever made
+    uint64_t m_answered = 0; // Covered by a reload that has started
+    // Written under m_mutex, read without it.
+    std::atomic<bool> m_running{false};
+    std::atomic<uint64_t> m_reloads{0};
+};
@@ -0,0 +1,172 @@
+// RRightclickrr context menu invoke queue
+
+#include "InvokeQueue.h"
+#include "SyncedPathMatch.h"
+#include <algorithm>
+#include <system_error>
+
+std::wstring InvokeRequestKey(const InvokeRequest &request)
+{
+    std::vector<std::wstring> paths;
+    paths.reserve(request.paths.size());
+    for (const std::wstring &path : request.paths)
+    {
+        paths.push_back(NormalizePath(path));
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::wstring key(1, static_cast<wchar_t>(L'0' + static_cast<int>(request.mode)));
+    for (const std::wstring &path : paths)
+    {
+        key += L'\n';
+        key += path;
+    }
+    return key;
+}
+
+CInvokeQueue::~CInvokeQueue()
+{
+    Stop();
+}
+
+bool CInvokeQueue::Start(Handler handler, CoalescedHandler onCoalesced, Options options)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_thread.joinable())
+    {
+        return true;
+    }
+
+    m_handler = std::move(handler);
+    m_onCoalesced = std::move(onCoalesced);
+    m_options = std::move(options);
+    m_stop = false;
+    m_recent.clear();
+
+    try
+    {
+        m_thread = std::thread(&CInvokeQueue::Run, this);
+    }
+    catch (const std::system_error &)
+    {
+        return false;
+    }
+
+    m_running.store(true, std::memory_order_release);
+    return true;
+}
+
+void CInvokeQueue::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_thread.joinable())
+        {
+            return;
+        }
+        m_stop = true;
+    }
+    m_changed.notify_all();
+    m_thread.join();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.clear();
+    m_running.store(false, std::memory_order_release);
+    m_changed.notify_all();
+}
+
+InvokeQueueResult CInvokeQueue::Enqueue(InvokeRequest &&request)
+{
+    const auto queuedAt = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_thread.joinable() || m_stop)
+        {
+            return InvokeQueueResult::NotRunning;
+        }
+        if (m_pending.size() >= m_options.maxPending)
+        {
+            return InvokeQueueResult::Full;
+        }
+        m_pending.push_back(std::move(request));
+        m_pending.back().queuedAt = queuedAt;
+    }
+    m_changed.notify_all();
+    return InvokeQueueResult::Queued;
+}
+
+bool CInvokeQueue::WaitIdle(uint32_t timeoutMs) const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_changed.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                              [&]() { return m_pending.empty() && !m_busy; });
+}
+
+bool CInvokeQueue::IsDuplicate(const InvokeRequest &request, const std::wstring &key)
+{
+    // Requests run in the order they were queued, so everything in m_recent
+    // finished before this one started, and an entry too old to match this
+    // request is too old for every later one.
+    const auto window = std::chrono::milliseconds(m_options.coalesceMs);
+    m_recent.erase(std::remove_if(m_recent.begin(), m_recent.end(),
+                                  [&](const Recent &recent) { return recent.finishedAt + window <= request.queuedAt; }),
+                   m_recent.end());
+
+    for (const Recent &recent : m_recent)
+    {
+        if (recent.key == key)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CInvokeQueue::Run()
+{
+    if (m_options.onThreadStart)
+    {
+        m_options.onThreadStart();
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_changed.wait(lock, [&]() { return m_stop || !m_pending.empty(); });
+        if (m_stop)
+        {
+            break;
+        }
+
+        InvokeRequest request = std::move(m_pending.front());
+        m_pending.pop_front();
+        m_busy = true;
+        lock.unlock();
+
+        const std::wstring key = InvokeRequestKey(request);
+        if (IsDuplicate(request, key))
+        {
+            m_coalesced.fetch_add(1, std::memory_order_release);
+            if (m_onCoalesced)
+            {
+                m_onCoalesced(request);
+            }
+        }
+        else
+        {
+            m_handler(request);
+            m_recent.push_back(Recent{key, std::chrono::steady_clock::now()});
+            m_dispatched.fetch_add(1, std::memory_order_release);
+        }
+
+        lock.lock();
+        m_busy = false;
+        m_changed.notify_all();
+    }
+    lock.unlock();
+
+    if (m_options.onThreadExit)
+    {
+        m_options.onThreadExit();
+    }
+}
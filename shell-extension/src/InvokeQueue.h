@@ -0,0 +1,114 @@
+// RRightclickrr context menu invoke queue
+//
+// Invoke runs on Explorer's UI thread, and the menu stays open until it
+// returns. It only copies the selection into an InvokeRequest and queues it.
+// One worker thread per process does the rest, one request at a time:
+// reducing the selection, the link index, the app's pipe or a process launch.
+// Failures are reported from there.
+//
+// Clicking again because nothing seemed to happen queues the same command
+// twice. A request identical to one still waiting, running or finished less
+// than coalesceMs before it was queued is dropped.
+//
+// Platform-independent so the bench can check it on Linux.
+
+#pragma once
+
+#include "SelectionBatch.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct InvokeRequest
+{
+    BatchMode mode = BatchMode::Sync;
+    std::vector<std::wstring> paths; // As selected
+    std::chrono::steady_clock::time_point queuedAt;
+};
+
+enum class InvokeQueueResult
+{
+    Queued,
+    Full,       // maxPending requests already waiting; the worker is stuck
+    NotRunning,
+};
+
+class CInvokeQueue
+{
+public:
+    struct Options
+    {
+        uint32_t coalesceMs = 500;
+        size_t maxPending = 64;
+        // Run on the worker thread around all requests (COM setup on Windows).
+        std::function<void()> onThreadStart;
+        std::function<void()> onThreadExit;
+    };
+
+    // Runs on the worker thread.
+    using Handler = std::function<void(const InvokeRequest &request)>;
+    // Called for each request dropped as a duplicate, on the worker thread.
+    using CoalescedHandler = std::function<void(const InvokeRequest &request)>;
+
+    CInvokeQueue() = default;
+    ~CInvokeQueue();
+
+    CInvokeQueue(const CInvokeQueue &) = delete;
+    CInvokeQueue &operator=(const CInvokeQueue &) = delete;
+
+    bool Start(Handler handler, CoalescedHandler onCoalesced, Options options);
+    bool Start(Handler handler) { return Start(std::move(handler), nullptr, Options()); }
+
+    // Finishes the request in progress, then joins the worker; requests still
+    // waiting are dropped.
+    void Stop();
+
+    bool IsRunning() const { return m_running.load(std::memory_order_acquire); }
+
+    // Takes the request without doing any work on it and stamps queuedAt.
+    // The request is moved from only when the result is Queued.
+    InvokeQueueResult Enqueue(InvokeRequest &&request);
+
+    // Requests handled and dropped as duplicates.
+    uint64_t DispatchCount() const { return m_dispatched.load(std::memory_order_acquire); }
+    uint64_t CoalescedCount() const { return m_coalesced.load(std::memory_order_acquire); }
+
+    // Blocks until nothing is waiting or running, or timeoutMs elapses.
+    bool WaitIdle(uint32_t timeoutMs) const;
+
+private:
+    struct Recent
+    {
+        std::wstring key;
+        std::chrono::steady_clock::time_point finishedAt;
+    };
+
+    void Run();
+    bool IsDuplicate(const InvokeRequest &request, const std::wstring &key);
+
+    Handler m_handler;
+    CoalescedHandler m_onCoalesced;
+    Options m_options;
+    std::thread m_thread;
+
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_changed;
+    std::deque<InvokeRequest> m_pending;
+    bool m_stop = false;
+    bool m_busy = false;
+    std::vector<Recent> m_recent; // Worker thread only
+    std::atomic<bool> m_running{false};
+    std::atomic<uint64_t> m_dispatched{0};
+    std::atomic<uint64_t> m_coalesced{0};
+};
+
+// Identity of a request for coalescing: the mode and the set of normalized
+// paths.
+std::wstring InvokeRequestKey(const InvokeRequest &request);
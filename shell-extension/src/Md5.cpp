@@ -0,0 +1,418 @@
+// RRightclickrr MD5 (RFC 1321)
+
+#include "Md5.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RRIGHTCLICKRR_HAVE_SSE2_MD5 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+constexpr uint32_t kInitialState[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+inline uint32_t LoadLe32(const uint8_t *bytes)
+{
+    return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+           (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+inline void StoreLe32(uint8_t *bytes, uint32_t value)
+{
+    bytes[0] = static_cast<uint8_t>(value);
+    bytes[1] = static_cast<uint8_t>(value >> 8);
+    bytes[2] = static_cast<uint8_t>(value >> 16);
+    bytes[3] = static_cast<uint8_t>(value >> 24);
+}
+
+struct ScalarOps
+{
+    using V = uint32_t;
+
+    static V Set1(uint32_t value) { return value; }
+    static V Add(V lhs, V rhs) { return lhs + rhs; }
+    static V And(V lhs, V rhs) { return lhs & rhs; }
+    static V Or(V lhs, V rhs) { return lhs | rhs; }
+    static V Xor(V lhs, V rhs) { return lhs ^ rhs; }
+    static V Not(V value) { return ~value; }
+    template <int S>
+    static V Rotl(V value)
+    {
+        return (value << S) | (value >> (32 - S));
+    }
+};
+
+#if defined(RRIGHTCLICKRR_HAVE_SSE2_MD5)
+// Four independent messages, one per 32-bit lane.
+struct Sse2Ops
+{
+    using V = __m128i;
+    static constexpr size_t kLanes = 4;
+
+    static V Set1(uint32_t value) { return _mm_set1_epi32(static_cast<int>(value)); }
+    static V Add(V lhs, V rhs) { return _mm_add_epi32(lhs, rhs); }
+    static V And(V lhs, V rhs) { return _mm_and_si128(lhs, rhs); }
+    static V Or(V lhs, V rhs) { return _mm_or_si128(lhs, rhs); }
+    static V Xor(V lhs, V rhs) { return _mm_xor_si128(lhs, rhs); }
+    static V Not(V value) { return _mm_xor_si128(value, _mm_set1_epi32(-1)); }
+    template <int S>
+    static V Rotl(V value)
+    {
+        return _mm_or_si128(_mm_slli_epi32(value, S), _mm_srli_epi32(value, 32 - S));
+    }
+};
+#endif
+
+// One 64-byte block for every lane of Ops: state += rounds(state, x).
+template <typename Ops>
+void Md5Rounds(typename Ops::V state[4], const typename Ops::V x[16])
+{
+    using V = typename Ops::V;
+    V a = state[0];
+    V b = state[1];
+    V c = state[2];
+    V d = state[3];
+
+    // z ^ (x & (y ^ z)), y ^ (z & (x ^ y)), x ^ y ^ z, y ^ (x | ~z)
+#define MD5_F(x, y, z) Ops::Xor(z, Ops::And(x, Ops::Xor(y, z)))
+#define MD5_G(x, y, z) Ops::Xor(y, Ops::And(z, Ops::Xor(x, y)))
+#define MD5_H(x, y, z) Ops::Xor(Ops::Xor(x, y), z)
+#define MD5_I(x, y, z) Ops::Xor(y, Ops::Or(x, Ops::Not(z)))
+#define MD5_STEP(f, a, b, c, d, k, s, t)                                                                          \
+    a = Ops::Add(b, Ops::template Rotl<s>(Ops::Add(Ops::Add(a, f(b, c, d)), Ops::Add(x[k], Ops::Set1(t)))))
+
+    MD5_STEP(MD5_F, a, b, c, d, 0, 7, 0xd76aa478);
+    MD5_STEP(MD5_F, d, a, b, c, 1, 12, 0xe8c7b756);
+    MD5_STEP(MD5_F, c, d, a, b, 2, 17, 0x242070db);
+    MD5_STEP(MD5_F, b, c, d, a, 3, 22, 0xc1bdceee);
+    MD5_STEP(MD5_F, a, b, c, d, 4, 7, 0xf57c0faf);
+    MD5_STEP(MD5_F, d, a, b, c, 5, 12, 0x4787c62a);
+    MD5_STEP(MD5_F, c, d, a, b, 6, 17, 0xa8304613);
+    MD5_STEP(MD5_F, b, c, d, a, 7, 22, 0xfd469501);
+    MD5_STEP(MD5_F, a, b, c, d, 8, 7, 0x698098d8);
+    MD5_STEP(MD5_F, d, a, b, c, 9, 12, 0x8b44f7af);
+    MD5_STEP(MD5_F, c, d, a, b, 10, 17, 0xffff5bb1);
+    MD5_STEP(MD5_F, b, c, d, a, 11, 22, 0x895cd7be);
+    MD5_STEP(MD5_F, a, b, c, d, 12, 7, 0x6b901122);
+    MD5_STEP(MD5_F, d, a, b, c, 13, 12, 0xfd987193);
+    MD5_STEP(MD5_F, c, d, a, b, 14, 17, 0xa679438e);
+    MD5_STEP(MD5_F, b, c, d, a, 15, 22, 0x49b40821);
+
+    MD5_STEP(MD5_G, a, b, c, d, 1, 5, 0xf61e2562);
+    MD5_STEP(MD5_G, d, a, b, c, 6, 9, 0xc040b340);
+    MD5_STEP(MD5_G, c, d, a, b, 11, 14, 0x265e5a51);
+    MD5_STEP(MD5_G, b, c, d, a, 0, 20, 0xe9b6c7aa);
+    MD5_STEP(MD5_G, a, b, c, d, 5, 5, 0xd62f105d);
+    MD5_STEP(MD5_G, d, a, b, c, 10, 9, 0x02441453);
+    MD5_STEP(MD5_G, c, d, a, b, 15, 14, 0xd8a1e681);
+    MD5_STEP(MD5_G, b, c, d, a, 4, 20, 0xe7d3fbc8);
+    MD5_STEP(MD5_G, a, b, c, d, 9, 5, 0x21e1cde6);
+    MD5_STEP(MD5_G, d, a, b, c, 14, 9, 0xc33707d6);
+    MD5_STEP(MD5_G, c, d, a, b, 3, 14, 0xf4d50d87);
+    MD5_STEP(MD5_G, b, c, d, a, 8, 20, 0x455a14ed);
+    MD5_STEP(MD5_G, a, b, c, d, 13, 5, 0xa9e3e905);
+    MD5_STEP(MD5_G, d, a, b, c, 2, 9, 0xfcefa3f8);
+    MD5_STEP(MD5_G, c, d, a, b, 7, 14, 0x676f02d9);
+    MD5_STEP(MD5_G, b, c, d, a, 12, 20, 0x8d2a4c8a);
+
+    MD5_STEP(MD5_H, a, b, c, d, 5, 4, 0xfffa3942);
+    MD5_STEP(MD5_H, d, a, b, c, 8, 11, 0x8771f681);
+    MD5_STEP(MD5_H, c, d, a, b, 11, 16, 0x6d9d6122);
+    MD5_STEP(MD5_H, b, c, d, a, 14, 23, 0xfde5380c);
+    MD5_STEP(MD5_H, a, b, c, d, 1, 4, 0xa4beea44);
+    MD5_STEP(MD5_H, d, a, b, c, 4, 11, 0x4bdecfa9);
+    MD5_STEP(MD5_H, c, d, a, b, 7, 16, 0xf6bb4b60);
+    MD5_STEP(MD5_H, b, c, d, a, 10, 23, 0xbebfbc70);
+    MD5_STEP(MD5_H, a, b, c, d, 13, 4, 0x289b7ec6);
+    MD5_STEP(MD5_H, d, a, b, c, 0, 11, 0xeaa127fa);
+    MD5_STEP(MD5_H, c, d, a, b, 3, 16, 0xd4ef3085);
+    MD5_STEP(MD5_H, b, c, d, a, 6, 23, 0x04881d05);
+    MD5_STEP(MD5_H, a, b, c, d, 9, 4, 0xd9d4d039);
+    MD5_STEP(MD5_H, d, a, b, c, 12, 11, 0xe6db99e5);
+    MD5_STEP(MD5_H, c, d, a, b, 15, 16, 0x1fa27cf8);
+    MD5_STEP(MD5_H, b, c, d, a, 2, 23, 0xc4ac5665);
+
+    MD5_STEP(MD5_I, a, b, c, d, 0, 6, 0xf4292244);
+    MD5_STEP(MD5_I, d, a, b, c, 7, 10, 0x432aff97);
+    MD5_STEP(MD5_I, c, d, a, b, 14, 15, 0xab9423a7);
+    MD5_STEP(MD5_I, b, c, d, a, 5, 21, 0xfc93a039);
+    MD5_STEP(MD5_I, a, b, c, d, 12, 6, 0x655b59c3);
+    MD5_STEP(MD5_I, d, a, b, c, 3, 10, 0x8f0ccc92);
+    MD5_STEP(MD5_I, c, d, a, b, 10, 15, 0xffeff47d);
+    MD5_STEP(MD5_I, b, c, d, a, 1, 21, 0x85845dd1);
+    MD5_STEP(MD5_I, a, b, c, d, 8, 6, 0x6fa87e4f);
+    MD5_STEP(MD5_I, d, a, b, c, 15, 10, 0xfe2ce6e0);
+    MD5_STEP(MD5_I, c, d, a, b, 6, 15, 0xa3014314);
+    MD5_STEP(MD5_I, b, c, d, a, 13, 21, 0x4e0811a1);
+    MD5_STEP(MD5_I, a, b, c, d, 4, 6, 0xf7537e82);
+    MD5_STEP(MD5_I, d, a, b, c, 11, 10, 0xbd3af235);
+    MD5_STEP(MD5_I, c, d, a, b, 2, 15, 0x2ad7d2bb);
+    MD5_STEP(MD5_I, b, c, d, a, 9, 21, 0xeb86d391);
+
+#undef MD5_STEP
+#undef MD5_I
+#undef MD5_H
+#undef MD5_G
+#undef MD5_F
+
+    state[0] = Ops::Add(state[0], a);
+    state[1] = Ops::Add(state[1], b);
+    state[2] = Ops::Add(state[2], c);
+    state[3] = Ops::Add(state[3], d);
+}
+
+void ScalarBlock(uint32_t state[4], const uint8_t *block)
+{
+    uint32_t x[16];
+    for (int i = 0; i < 16; i++)
+    {
+        x[i] = LoadLe32(block + 4 * i);
+    }
+    Md5Rounds<ScalarOps>(state, x);
+}
+
+Md5Digest DigestFromState(const uint32_t state[4])
+{
+    Md5Digest digest;
+    for (int i = 0; i < 4; i++)
+    {
+        StoreLe32(digest.bytes + 4 * i, state[i]);
+    }
+    return digest;
+}
+
+// A whole message as its full blocks in place plus one or two padded tail
+// blocks, so a lane can fetch any block without copying the message.
+struct PaddedMessage
+{
+    const uint8_t *data = nullptr;
+    size_t fullBlocks = 0;
+    size_t blocks = 0;
+    uint8_t tail[128];
+
+    void Reset(std::string_view message)
+    {
+        data = reinterpret_cast<const uint8_t *>(message.data());
+        fullBlocks = message.size() / 64;
+        const size_t rest = message.size() % 64;
+        const size_t tailBlocks = rest < 56 ? 1 : 2;
+        blocks = fullBlocks + tailBlocks;
+
+        std::memset(tail, 0, sizeof(tail));
+        if (rest > 0)
+        {
+            std::memcpy(tail, data + fullBlocks * 64, rest);
+        }
+        tail[rest] = 0x80;
+        const uint64_t bits = static_cast<uint64_t>(message.size()) * 8;
+        StoreLe32(tail + tailBlocks * 64 - 8, static_cast<uint32_t>(bits));
+        StoreLe32(tail + tailBlocks * 64 - 4, static_cast<uint32_t>(bits >> 32));
+    }
+
+    const uint8_t *Block(size_t index) const
+    {
+        return index < fullBlocks ? data + index * 64 : tail + (index - fullBlocks) * 64;
+    }
+};
+
+#if defined(RRIGHTCLICKRR_HAVE_SSE2_MD5)
+void HashMd5ManySse2(const std::string_view *messages, size_t count, Md5Digest *digests)
+{
+    constexpr size_t kLanes = Sse2Ops::kLanes;
+    static const uint8_t kIdleBlock[64] = {};
+
+    struct Lane
+    {
+        PaddedMessage message;
+        size_t index = 0;
+        size_t block = 0;
+        bool active = false;
+    };
+    Lane lanes[kLanes];
+    alignas(16) uint32_t state[4][kLanes]; // [word][lane]
+    size_t next = 0;
+
+    for (;;)
+    {
+        size_t active = 0;
+        for (size_t lane = 0; lane < kLanes; lane++)
+        {
+            Lane &slot = lanes[lane];
+            if (!slot.active && next < count)
+            {
+                slot.message.Reset(messages[next]);
+                slot.index = next++;
+                slot.block = 0;
+                slot.active = true;
+                for (int word = 0; word < 4; word++)
+                {
+                    state[word][lane] = kInitialState[word];
+                }
+            }
+            active += slot.active ? 1 : 0;
+        }
+        if (active == 0)
+        {
+            return;
+        }
+
+        if (active == 1 && next == count)
+        {
+            // Only the longest message is left: finish it without idle lanes.
+            for (size_t lane = 0; lane < kLanes; lane++)
+            {
+                Lane &slot = lanes[lane];
+                if (slot.active)
+                {
+                    uint32_t scalar[4] = {state[0][lane], state[1][lane], state[2][lane], state[3][lane]};
+                    for (; slot.block < slot.message.blocks; slot.block++)
+                    {
+                        ScalarBlock(scalar, slot.message.Block(slot.block));
+                    }
+                    digests[slot.index] = DigestFromState(scalar);
+                    slot.active = false;
+                }
+            }
+            return;
+        }
+
+        const uint8_t *blocks[kLanes];
+        for (size_t lane = 0; lane < kLanes; lane++)
+        {
+            blocks[lane] = lanes[lane].active ? lanes[lane].message.Block(lanes[lane].block) : kIdleBlock;
+        }
+        __m128i x[16];
+        for (int i = 0; i < 16; i++)
+        {
+            x[i] = _mm_set_epi32(static_cast<int>(LoadLe32(blocks[3] + 4 * i)),
+                                 static_cast<int>(LoadLe32(blocks[2] + 4 * i)),
+                                 static_cast<int>(LoadLe32(blocks[1] + 4 * i)),
+                                 static_cast<int>(LoadLe32(blocks[0] + 4 * i)));
+        }
+        __m128i vector[4];
+        for (int word = 0; word < 4; word++)
+        {
+            vector[word] = _mm_load_si128(reinterpret_cast<const __m128i *>(state[word]));
+        }
+        Md5Rounds<Sse2Ops>(vector, x);
+        for (int word = 0; word < 4; word++)
+        {
+            _mm_store_si128(reinterpret_cast<__m128i *>(state[word]), vector[word]);
+        }
+
+        for (size_t lane = 0; lane < kLanes; lane++)
+        {
+            Lane &slot = lanes[lane];
+            if (slot.active && ++slot.block == slot.message.blocks)
+            {
+                const uint32_t words[4] = {state[0][lane], state[1][lane], state[2][lane], state[3][lane]};
+                digests[slot.index] = DigestFromState(words);
+                slot.active = false;
+            }
+        }
+    }
+}
+#endif
+} // namespace
+
+std::string Md5Digest::Hex() const
+{
+    static const char kDigits[] = "0123456789abcdef";
+    std::string hex(32, '0');
+    for (size_t i = 0; i < 16; i++)
+    {
+        hex[2 * i] = kDigits[bytes[i] >> 4];
+        hex[2 * i + 1] = kDigits[bytes[i] & 0x0F];
+    }
+    return hex;
+}
+
+bool Md5Digest::operator==(const Md5Digest &other) const
+{
+    return std::memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+}
+
+CMd5::CMd5()
+{
+    Reset();
+}
+
+void CMd5::Reset()
+{
+    std::memcpy(m_state, kInitialState, sizeof(m_state));
+    m_length = 0;
+    m_buffered = 0;
+}
+
+void CMd5::Update(const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    m_length += size;
+    if (m_buffered > 0)
+    {
+        const size_t take = size < 64 - m_buffered ? size : 64 - m_buffered;
+        std::memcpy(m_buffer + m_buffered, bytes, take);
+        m_buffered += take;
+        bytes += take;
+        size -= take;
+        if (m_buffered < 64)
+        {
+            return;
+        }
+        ScalarBlock(m_state, m_buffer);
+        m_buffered = 0;
+    }
+    for (; size >= 64; bytes += 64, size -= 64)
+    {
+        ScalarBlock(m_state, bytes);
+    }
+    if (size > 0)
+    {
+        std::memcpy(m_buffer, bytes, size);
+        m_buffered = size;
+    }
+}
+
+Md5Digest CMd5::Final()
+{
+    const uint64_t bits = m_length * 8;
+    static const uint8_t kPadding[64] = {0x80};
+    Update(kPadding, m_buffered < 56 ? 56 - m_buffered : 120 - m_buffered);
+    uint8_t length[8];
+    StoreLe32(length, static_cast<uint32_t>(bits));
+    StoreLe32(length + 4, static_cast<uint32_t>(bits >> 32));
+    Update(length, sizeof(length));
+    return DigestFromState(m_state);
+}
+
+size_t Md5Lanes()
+{
+#if defined(RRIGHTCLICKRR_HAVE_SSE2_MD5)
+    return Sse2Ops::kLanes;
+#else
+    return 1;
+#endif
+}
+
+void HashMd5Many(const std::string_view *messages, size_t count, Md5Digest *digests)
+{
+#if defined(RRIGHTCLICKRR_HAVE_SSE2_MD5)
+    if (count > 1)
+    {
+        HashMd5ManySse2(messages, count, digests);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < count; i++)
+    {
+        PaddedMessage message;
+        message.Reset(messages[i]);
+        uint32_t state[4] = {kInitialState[0], kInitialState[1], kInitialState[2], kInitialState[3]};
+        for (size_t block = 0; block < message.blocks; block++)
+        {
+            ScalarBlock(state, message.Block(block));
+        }
+        digests[i] = DigestFromState(state);
+    }
+}
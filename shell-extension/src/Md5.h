@@ -0,0 +1,47 @@
+// RRightclickrr MD5 (RFC 1321)
+//
+// Digests compare with Drive's md5Checksum, so they must match byte for byte
+// what Node's crypto.createHash('md5') produces. CMd5 streams one message;
+// HashMd5Many hashes several whole messages side by side, one per SSE2 lane
+// (multi-buffer), which is what makes small files cheap: one MD5 is a
+// serial chain of 64 dependent steps per block, so a single message cannot
+// use the vector unit.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+struct Md5Digest
+{
+    uint8_t bytes[16];
+
+    // Lowercase hex, as Drive reports md5Checksum.
+    std::string Hex() const;
+    bool operator==(const Md5Digest &other) const;
+};
+
+class CMd5
+{
+public:
+    CMd5();
+
+    void Update(const void *data, size_t size);
+    Md5Digest Final(); // Ends the message; call Reset before reusing
+    void Reset();
+
+private:
+    uint32_t m_state[4];
+    uint64_t m_length = 0;
+    uint8_t m_buffer[64];
+    size_t m_buffered = 0;
+};
+
+// Messages hashed side by side; 1 when the multi-buffer kernel is not built.
+size_t Md5Lanes();
+
+// Hashes messages[0, count) into digests. Lanes that finish early take the
+// next message, so lengths may differ freely.
+void HashMd5Many(const std::string_view *messages, size_t count, Md5Digest *digests);
@@ -0,0 +1,64 @@
+// RRightclickrr install paths
+
+#include "ModulePaths.h"
+#include <strsafe.h>
+#include <wchar.h>
+
+namespace
+{
+ModulePaths g_modulePaths;
+
+// Strips the last path component, like PathCchRemoveFileSpec on a full path.
+bool RemoveLastComponent(LPWSTR pszPath)
+{
+    LPWSTR pszSlash = wcsrchr(pszPath, L'\\');
+    if (!pszSlash || pszSlash == pszPath)
+    {
+        return false;
+    }
+    *pszSlash = L'\0';
+    return true;
+}
+
+HRESULT Resolve(HMODULE hModule, ModulePaths &paths)
+{
+    WCHAR szInstallDir[MAX_PATH];
+    const DWORD cch = GetModuleFileNameW(hModule, szInstallDir, ARRAYSIZE(szInstallDir));
+    if (cch == 0)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+    if (cch >= ARRAYSIZE(szInstallDir))
+    {
+        return HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+    }
+
+    // <install>\shell-extension\RRightclickrrShell.dll
+    if (!RemoveLastComponent(szInstallDir) || !RemoveLastComponent(szInstallDir))
+    {
+        return HRESULT_FROM_WIN32(ERROR_BAD_PATHNAME);
+    }
+
+    HRESULT hr = StringCchPrintfW(paths.appPath, ARRAYSIZE(paths.appPath), L"%s\\RRightclickrr.exe", szInstallDir);
+    if (SUCCEEDED(hr))
+    {
+        hr = StringCchPrintfW(paths.assetsDir, ARRAYSIZE(paths.assetsDir), L"%s\\resources\\assets", szInstallDir);
+    }
+    for (size_t i = 0; SUCCEEDED(hr) && i < kCommandCount; i++)
+    {
+        hr = StringCchPrintfW(paths.commandIcons[i], ARRAYSIZE(paths.commandIcons[i]), L"%s\\%s.ico",
+                              paths.assetsDir, kCommandTable[i].icon);
+    }
+    return hr;
+}
+} // namespace
+
+void ResolveModulePaths(HMODULE hModule)
+{
+    g_modulePaths.hr = Resolve(hModule, g_modulePaths);
+}
+
+const ModulePaths &GetModulePaths()
+{
+    return g_modulePaths;
+}
@@ -0,0 +1,24 @@
+// RRightclickrr install paths
+//
+// The app, its icons and the DLL share one install directory (the DLL lives
+// in its shell-extension folder). The paths are resolved once at
+// DLL_PROCESS_ATTACH, so menu and overlay callbacks only copy them.
+
+#pragma once
+
+#include <windows.h>
+#include "CommandTable.h"
+
+struct ModulePaths
+{
+    HRESULT hr = E_FAIL;
+    WCHAR appPath[MAX_PATH] = {};                     // <install>\RRightclickrr.exe
+    WCHAR assetsDir[MAX_PATH] = {};                   // <install>\resources\assets
+    WCHAR commandIcons[kCommandCount][MAX_PATH] = {}; // <assetsDir>\<icon>.ico, indexed by CommandType
+};
+
+// Called from DllMain under the loader lock: string work on the module file
+// name only, no library loads or allocations.
+void ResolveModulePaths(HMODULE hModule);
+
+const ModulePaths &GetModulePaths();
@@ -0,0 +1,373 @@
+// RRightclickrr binary overlay index (synced-paths.idx)
+
+#include "OverlayIndexFormat.h"
+#include "Crc32.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+constexpr char16_t kSeparator = u'\\';
+
+void AppendU16(std::vector<uint8_t> &out, uint16_t value)
+{
+    out.push_back(static_cast<uint8_t>(value & 0xFF));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void AppendU32(std::vector<uint8_t> &out, uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        out.push_back(static_cast<uint8_t>((value >> shift) & 0xFF));
+    }
+}
+
+uint32_t ReadU32(const uint8_t *data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint16_t ReadU16(const uint8_t *data)
+{
+    uint16_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+size_t CommonPrefix(std::u16string_view lhs, std::u16string_view rhs)
+{
+    const size_t limit = std::min(lhs.size(), rhs.size());
+    size_t i = 0;
+    while (i < limit && lhs[i] == rhs[i])
+    {
+        i++;
+    }
+    return i;
+}
+
+uint32_t HeaderChecksum(OverlayIndexHeader header)
+{
+    header.headerChecksum = 0;
+    return Crc32(&header, sizeof(header));
+}
+} // namespace
+
+std::vector<uint8_t> BuildOverlayIndexImage(std::vector<std::u16string> paths, uint64_t generation, uint32_t sourceCount)
+{
+    paths.erase(std::remove_if(paths.begin(), paths.end(),
+                               [](const std::u16string &path) { return path.empty() || path.size() > 0xFFFF; }),
+                paths.end());
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+    std::vector<uint8_t> image(sizeof(OverlayIndexHeader), 0);
+    std::vector<uint32_t> restarts;
+
+    const size_t entriesOffset = image.size();
+    std::u16string_view previous;
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        const std::u16string_view current = paths[i];
+        size_t shared = 0;
+        if (i % kOverlayIndexRestartInterval == 0)
+        {
+            restarts.push_back(static_cast<uint32_t>(image.size() - entriesOffset));
+        }
+        else
+        {
+            shared = CommonPrefix(previous, current);
+        }
+
+        AppendU16(image, static_cast<uint16_t>(shared));
+        AppendU16(image, static_cast<uint16_t>(current.size() - shared));
+        for (size_t k = shared; k < current.size(); k++)
+        {
+            AppendU16(image, static_cast<uint16_t>(current[k]));
+        }
+        previous = current;
+    }
+
+    // Keep the restart table 4-byte aligned.
+    while (image.size() % 4 != 0)
+    {
+        image.push_back(0);
+    }
+    const size_t entriesSize = image.size() - entriesOffset;
+    const size_t restartsOffset = image.size();
+    for (uint32_t restart : restarts)
+    {
+        AppendU32(image, restart);
+    }
+
+    OverlayIndexHeader header = {};
+    header.magic = kOverlayIndexMagic;
+    header.version = kOverlayIndexVersion;
+    header.headerSize = sizeof(OverlayIndexHeader);
+    header.generation = generation;
+    header.entryCount = static_cast<uint32_t>(paths.size());
+    header.restartInterval = kOverlayIndexRestartInterval;
+    header.restartCount = static_cast<uint32_t>(restarts.size());
+    header.sourceCount = sourceCount;
+    header.entriesOffset = entriesOffset;
+    header.entriesSize = entriesSize;
+    header.restartsOffset = restartsOffset;
+    header.payloadChecksum = Crc32(image.data() + entriesOffset, image.size() - entriesOffset);
+    header.headerChecksum = HeaderChecksum(header);
+    std::memcpy(image.data(), &header, sizeof(header));
+
+    return image;
+}
+
+COverlayIndexView::COverlayIndexView() : m_base(nullptr), m_size(0), m_header{}
+{
+}
+
+OverlayIndexStatus COverlayIndexView::Open(const void *data, size_t size)
+{
+    Close();
+
+    if (!data || size < sizeof(OverlayIndexHeader))
+    {
+        return OverlayIndexStatus::TooSmall;
+    }
+
+    OverlayIndexHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != kOverlayIndexMagic)
+    {
+        return OverlayIndexStatus::BadMagic;
+    }
+    if (header.version != kOverlayIndexVersion || header.headerSize != sizeof(OverlayIndexHeader))
+    {
+        return OverlayIndexStatus::BadVersion;
+    }
+    if (HeaderChecksum(header) != header.headerChecksum)
+    {
+        return OverlayIndexStatus::ChecksumMismatch;
+    }
+
+    const uint64_t restartsEnd = header.restartsOffset + static_cast<uint64_t>(header.restartCount) * 4;
+    const bool layoutOk =
+        header.entriesOffset == sizeof(OverlayIndexHeader) &&
+        header.restartsOffset == header.entriesOffset + header.entriesSize &&
+        header.restartsOffset % 4 == 0 &&
+        header.restartInterval != 0 &&
+        header.restartCount == (header.entryCount + header.restartInterval - 1) / header.restartInterval;
+    if (!layoutOk)
+    {
+        return OverlayIndexStatus::BadLayout;
+    }
+    if (restartsEnd > size)
+    {
+        // The writer has published a header for bytes that are not there yet.
+        return OverlayIndexStatus::ChecksumMismatch;
+    }
+
+    const auto *base = static_cast<const uint8_t *>(data);
+    if (Crc32(base + header.entriesOffset, static_cast<size_t>(restartsEnd - header.entriesOffset)) != header.payloadChecksum)
+    {
+        return OverlayIndexStatus::ChecksumMismatch;
+    }
+
+    m_base = base;
+    m_size = static_cast<size_t>(restartsEnd);
+    m_header = header;
+    return OverlayIndexStatus::Ok;
+}
+
+void COverlayIndexView::Close()
+{
+    m_base = nullptr;
+    m_size = 0;
+    m_header = {};
+}
+
+bool COverlayIndexView::ReadEntry(size_t offset, uint16_t &shared, std::u16string_view &suffix, size_t &next) const
+{
+    // Offsets are relative to the entries section. Every access is bounds
+    // checked because a writer may still overwrite a mapped image in place.
+    const size_t entriesEnd = static_cast<size_t>(m_header.entriesSize);
+    if (offset + 4 > entriesEnd)
+    {
+        return false;
+    }
+
+    const uint8_t *entry = m_base + m_header.entriesOffset + offset;
+    shared = ReadU16(entry);
+    const uint16_t length = ReadU16(entry + 2);
+    next = offset + 4 + static_cast<size_t>(length) * 2;
+    if (next > entriesEnd)
+    {
+        return false;
+    }
+
+    suffix = std::u16string_view(reinterpret_cast<const char16_t *>(entry + 4), length);
+    return true;
+}
+
+bool COverlayIndexView::RestartKey(uint32_t restart, std::u16string_view &key, size_t &offset) const
+{
+    offset = ReadU32(m_base + m_header.restartsOffset + static_cast<size_t>(restart) * 4);
+    uint16_t shared = 0;
+    size_t next = 0;
+    return ReadEntry(offset, shared, key, next) && shared == 0;
+}
+
+COverlayIndexView::SeekResult COverlayIndexView::Seek(std::u16string_view key, size_t &common) const
+{
+    common = 0;
+    if (!m_base || m_header.restartCount == 0)
+    {
+        return SeekResult::End;
+    }
+
+    // Last restart whose full key is <= key.
+    uint32_t lo = 0;
+    uint32_t hi = m_header.restartCount;
+    while (hi - lo > 1)
+    {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        std::u16string_view midKey;
+        size_t midOffset = 0;
+        if (!RestartKey(mid, midKey, midOffset))
+        {
+            return SeekResult::End;
+        }
+        if (midKey.compare(key) <= 0)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    // Walk the block comparing suffixes against the key without rebuilding
+    // entries: matched is the common prefix of the previous entry and key.
+    size_t offset = 0;
+    std::u16string_view suffix;
+    if (!RestartKey(lo, suffix, offset))
+    {
+        return SeekResult::End;
+    }
+
+    const uint32_t first = lo * m_header.restartInterval;
+    const uint32_t last = std::min(first + m_header.restartInterval, m_header.entryCount);
+    size_t matched = 0;
+    for (uint32_t index = first; index < last; index++)
+    {
+        uint16_t shared = 0;
+        size_t next = 0;
+        if (!ReadEntry(offset, shared, suffix, next))
+        {
+            return SeekResult::End;
+        }
+        offset = next;
+
+        if (shared > matched)
+        {
+            // Same character as the previous entry where it already sorted
+            // below the key, so this entry is below it too.
+            continue;
+        }
+        if (shared < matched)
+        {
+            // Diverges from the key earlier than the previous entry did, and
+            // upwards because entries are sorted.
+            common = shared;
+            return SeekResult::Greater;
+        }
+
+        const std::u16string_view rest = key.substr(matched);
+        const size_t suffixCommon = CommonPrefix(suffix, rest);
+        if (suffixCommon == suffix.size() && suffixCommon == rest.size())
+        {
+            common = key.size();
+            return SeekResult::Equal;
+        }
+        if (suffixCommon == rest.size() || (suffixCommon < suffix.size() && suffix[suffixCommon] > rest[suffixCommon]))
+        {
+            common = matched + suffixCommon;
+            return SeekResult::Greater;
+        }
+        matched += suffixCommon;
+    }
+
+    // Every entry in the block sorts below the key; the next restart (if
+    // any) is the first one above it.
+    if (lo + 1 >= m_header.restartCount)
+    {
+        return SeekResult::End;
+    }
+
+    std::u16string_view nextKey;
+    if (!RestartKey(lo + 1, nextKey, offset))
+    {
+        return SeekResult::End;
+    }
+    common = CommonPrefix(nextKey, key);
+    return SeekResult::Greater;
+}
+
+bool COverlayIndexView::Contains(std::u16string_view key) const
+{
+    size_t common = 0;
+    return !key.empty() && Seek(key, common) == SeekResult::Equal;
+}
+
+bool COverlayIndexView::HasEntryWithPrefix(std::u16string_view prefix) const
+{
+    // The first entry >= prefix starts with it if any entry does.
+    size_t common = 0;
+    const SeekResult result = Seek(prefix, common);
+    return result == SeekResult::Equal || (result == SeekResult::Greater && common == prefix.size());
+}
+
+bool COverlayIndexView::Matches(std::u16string_view path) const
+{
+    if (!m_base || m_header.entryCount == 0)
+    {
+        return false;
+    }
+
+    // A root R matches when it equals the path, when path starts with R + "\",
+    // or, for roots that already end in "\", when path starts with R.
+    for (size_t i = path.find(kSeparator); i != std::u16string_view::npos; i = path.find(kSeparator, i + 1))
+    {
+        if (Contains(path.substr(0, i)) || Contains(path.substr(0, i + 1)))
+        {
+            return true;
+        }
+    }
+
+    return Contains(path);
+}
+
+void COverlayIndexView::ForEach(void (*callback)(std::u16string_view entry, void *context), void *context) const
+{
+    if (!m_base)
+    {
+        return;
+    }
+
+    std::u16string current;
+    size_t offset = 0;
+    for (uint32_t index = 0; index < m_header.entryCount; index++)
+    {
+        uint16_t shared = 0;
+        std::u16string_view suffix;
+        size_t next = 0;
+        if (!ReadEntry(offset, shared, suffix, next) || shared > current.size())
+        {
+            return;
+        }
+        current.resize(shared);
+        current.append(suffix);
+        callback(current, context);
+        offset = next;
+    }
+}
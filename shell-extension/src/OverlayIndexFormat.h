@@ -0,0 +1,100 @@
+// RRightclickrr binary overlay index (synced-paths.idx)
+//
+// Layout (little-endian):
+//   OverlayIndexHeader (64 bytes)
+//   entries   - sorted, front-coded normalized paths in UTF-16:
+//               uint16 shared, uint16 suffixLength, suffixLength x uint16
+//               every restartInterval-th entry is stored in full (shared = 0)
+//   restarts  - uint32 offset of each full entry, relative to entriesOffset
+//
+// The reader queries a mapped image in place; nothing is decoded or copied.
+// Both checksums let a reader detect an image torn by a concurrent writer.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr uint32_t kOverlayIndexMagic = 0x58495252; // "RRIX"
+constexpr uint16_t kOverlayIndexVersion = 1;
+constexpr uint32_t kOverlayIndexRestartInterval = 16;
+
+struct OverlayIndexHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint64_t generation;      // Incremented by the writer on every publish
+    uint32_t entryCount;
+    uint32_t restartInterval;
+    uint32_t restartCount;
+    uint32_t sourceCount;     // Paths the writer reduced to these entries (0 = not recorded)
+    uint64_t entriesOffset;
+    uint64_t entriesSize;
+    uint64_t restartsOffset;
+    uint32_t payloadChecksum; // CRC-32 of entries and restarts
+    uint32_t headerChecksum;  // CRC-32 of this header with this field zeroed
+};
+static_assert(sizeof(OverlayIndexHeader) == 64, "OverlayIndexHeader layout is part of the file format");
+
+enum class OverlayIndexStatus
+{
+    Ok,
+    TooSmall,
+    BadMagic,
+    BadVersion,
+    BadLayout,
+    ChecksumMismatch, // Torn or corrupted image; keep the previous snapshot
+};
+
+// Serializes normalized UTF-16 paths into a complete index image. Sorts and
+// de-duplicates; empty paths and paths over 65535 units are dropped.
+// sourceCount records how many paths the caller started from, for diagnostics.
+std::vector<uint8_t> BuildOverlayIndexImage(std::vector<std::u16string> paths, uint64_t generation, uint32_t sourceCount = 0);
+
+// Read-only view over an index image. Does not own the memory.
+class COverlayIndexView
+{
+public:
+    COverlayIndexView();
+
+    OverlayIndexStatus Open(const void *data, size_t size);
+    void Close();
+
+    bool IsOpen() const { return m_base != nullptr; }
+    size_t Size() const { return m_size; }
+    uint64_t Generation() const { return m_header.generation; }
+    uint32_t EntryCount() const { return m_header.entryCount; }
+    uint32_t SourceCount() const { return m_header.sourceCount ? m_header.sourceCount : m_header.entryCount; }
+
+    // Exact lookup of a normalized path.
+    bool Contains(std::u16string_view key) const;
+
+    // Same answer as IsSameOrChildPath against every entry.
+    bool Matches(std::u16string_view path) const;
+
+    // True when some entry starts with prefix.
+    bool HasEntryWithPrefix(std::u16string_view prefix) const;
+
+    // Decodes every entry in order (diagnostics and tests).
+    void ForEach(void (*callback)(std::u16string_view entry, void *context), void *context) const;
+
+private:
+    enum class SeekResult
+    {
+        Equal,   // An entry equals the key
+        Greater, // The first entry above the key; common is their shared prefix
+        End,     // Every entry sorts below the key
+    };
+
+    SeekResult Seek(std::u16string_view key, size_t &common) const;
+    bool ReadEntry(size_t offset, uint16_t &shared, std::u16string_view &suffix, size_t &next) const;
+    bool RestartKey(uint32_t restart, std::u16string_view &key, size_t &offset) const;
+
+    const uint8_t *m_base;
+    size_t m_size;
+    OverlayIndexHeader m_header;
+};
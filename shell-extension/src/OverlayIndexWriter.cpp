@@ -0,0 +1,399 @@
+// RRightclickrr overlay index writer
+
+#include "OverlayIndexWriter.h"
+#include "DriveLinkIndex.h"
+#include "ExclusionMatcher.h"
+#include "OverlayIndexFormat.h"
+#include "OverlayJournal.h"
+#include "SyncedPathMatch.h"
+#include "Utf8.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+namespace
+{
+// UTF-8 path from the app, normalized like the overlay handler normalizes.
+std::wstring NormalizeUtf8Path(const std::string &utf8)
+{
+    std::wstring wide;
+    AppendUtf8AsWide(utf8, wide);
+    return NormalizePath(wide);
+}
+
+std::vector<uint8_t> BuildImageFromRoots(const std::vector<std::wstring> &roots, uint64_t generation, size_t sourceCount)
+{
+    std::vector<std::u16string> normalized(roots.size());
+    for (size_t i = 0; i < roots.size(); i++)
+    {
+        AppendWideAsUtf16(roots[i], normalized[i]);
+    }
+    return BuildOverlayIndexImage(std::move(normalized), generation,
+                                  static_cast<uint32_t>(std::min<size_t>(sourceCount, UINT32_MAX)));
+}
+
+std::vector<uint8_t> ReadWholeFile(const std::filesystem::path &file)
+{
+    std::ifstream in(file, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Room for the image to double before the segment has to be recreated.
+constexpr size_t kMinSlotCapacity = 4 * 1024 * 1024;
+} // namespace
+
+uint64_t ReadOverlayIndexGeneration(const std::filesystem::path &file)
+{
+    std::ifstream in(file, std::ios::binary);
+    OverlayIndexHeader header = {};
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    {
+        return 0;
+    }
+
+    return header.magic == kOverlayIndexMagic ? header.generation : 0;
+}
+
+bool WriteOverlayIndexImage(const std::filesystem::path &file, const std::vector<uint8_t> &image)
+{
+    std::filesystem::path temp = file;
+    temp += ".tmp";
+
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out.write(reinterpret_cast<const char *>(image.data()), static_cast<std::streamsize>(image.size())))
+        {
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp, file, ec);
+    if (!ec)
+    {
+        return true;
+    }
+    std::filesystem::remove(temp, ec);
+
+    // Windows refuses to replace a file another process has mapped. Overwrite
+    // it without truncating (mapped files cannot shrink); the header records
+    // the real length and readers reject the image until it is complete.
+    std::fstream inPlace(file, std::ios::binary | std::ios::in | std::ios::out);
+    if (!inPlace)
+    {
+        return false;
+    }
+    return static_cast<bool>(inPlace.write(reinterpret_cast<const char *>(image.data()), static_cast<std::streamsize>(image.size())));
+}
+
+bool WriteOverlayIndex(const std::filesystem::path &file, const std::vector<std::string> &utf8Paths, uint64_t &generation,
+                       COverlaySegmentPublisher *publisher)
+{
+    std::vector<std::wstring> roots;
+    roots.reserve(utf8Paths.size());
+
+    for (const std::string &utf8 : utf8Paths)
+    {
+        roots.push_back(NormalizeUtf8Path(utf8));
+    }
+
+    // SyncTracker lists every file under each synced folder; only the
+    // covering roots matter to the overlay.
+    ReduceToCoveringRoots(roots);
+
+    generation = ReadOverlayIndexGeneration(file) + 1;
+    const std::vector<uint8_t> image = BuildImageFromRoots(roots, generation, utf8Paths.size());
+    if (!WriteOverlayIndexImage(file, image))
+    {
+        return false;
+    }
+
+    if (publisher)
+    {
+        publisher->PublishIndex(std::move(roots), image, generation);
+    }
+    return true;
+}
+
+bool WriteDriveLinkIndex(const std::filesystem::path &file, const std::vector<std::string> &utf8Paths,
+                         const std::vector<std::string> &utf8Urls, uint64_t &generation)
+{
+    std::vector<DriveLinkEntry> entries(std::min(utf8Paths.size(), utf8Urls.size()));
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        AppendWideAsUtf16(NormalizeUtf8Path(utf8Paths[i]), entries[i].path);
+        entries[i].url = utf8Urls[i];
+    }
+
+    generation = 1;
+    {
+        std::ifstream in(file, std::ios::binary);
+        DriveLinkIndexHeader header = {};
+        if (in.read(reinterpret_cast<char *>(&header), sizeof(header)) && header.magic == kDriveLinkIndexMagic)
+        {
+            generation = header.generation + 1;
+        }
+    }
+    return WriteOverlayIndexImage(file, BuildDriveLinkImage(std::move(entries), generation));
+}
+
+bool WriteExclusionIndex(const std::filesystem::path &file, const std::vector<std::string> &utf8Roots,
+                         const std::vector<std::string> &utf8Patterns, uint64_t &generation)
+{
+    // The matcher normalizes both sides itself.
+    std::vector<ExclusionRule> rules(std::min(utf8Roots.size(), utf8Patterns.size()));
+    for (size_t i = 0; i < rules.size(); i++)
+    {
+        AppendUtf8AsWide(utf8Roots[i], rules[i].root);
+        AppendUtf8AsWide(utf8Patterns[i], rules[i].pattern);
+    }
+
+    generation = 1;
+    {
+        std::ifstream in(file, std::ios::binary);
+        ExclusionIndexHeader header = {};
+        if (in.read(reinterpret_cast<char *>(&header), sizeof(header)) && header.magic == kExclusionIndexMagic)
+        {
+            generation = header.generation + 1;
+        }
+    }
+    return WriteOverlayIndexImage(file, BuildExclusionImage(rules, generation));
+}
+
+bool COverlayJournalWriter::Reset(const std::filesystem::path &journal, uint64_t baseGeneration)
+{
+    m_path.clear();
+    const std::vector<uint8_t> header = BuildOverlayJournalHeader(baseGeneration);
+    std::ofstream out(journal, std::ios::binary | std::ios::trunc);
+    if (!out.write(reinterpret_cast<const char *>(header.data()), static_cast<std::streamsize>(header.size())))
+    {
+        return false;
+    }
+
+    m_path = journal;
+    m_baseGeneration = baseGeneration;
+    m_size = header.size();
+    m_nextSequence = 1;
+    return true;
+}
+
+bool COverlayJournalWriter::Recover(const std::filesystem::path &journal, uint64_t baseGeneration)
+{
+    std::vector<uint8_t> bytes;
+    {
+        std::ifstream in(journal, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    OverlayJournalHeader header = {};
+    if (ParseOverlayJournalHeader(bytes.data(), bytes.size(), header) != OverlayJournalStatus::Ok ||
+        header.baseGeneration != baseGeneration)
+    {
+        // Missing, damaged or written for another index: start over.
+        return Reset(journal, baseGeneration);
+    }
+
+    uint64_t nextSequence = 1;
+    std::vector<JournalRecord> records;
+    const size_t validEnd = sizeof(header) + ParseOverlayJournalRecords(bytes.data() + sizeof(header),
+                                                                        bytes.size() - sizeof(header), nextSequence, records);
+
+    // Drop a torn tail left by an interrupted append so new records follow
+    // the last valid one.
+    if (validEnd < bytes.size())
+    {
+        std::error_code ec;
+        std::filesystem::resize_file(journal, validEnd, ec);
+        if (ec)
+        {
+            return Reset(journal, baseGeneration);
+        }
+    }
+
+    m_path = journal;
+    m_baseGeneration = baseGeneration;
+    m_size = validEnd;
+    m_nextSequence = nextSequence;
+    return true;
+}
+
+bool COverlayJournalWriter::Append(const std::filesystem::path &journal, uint64_t baseGeneration,
+                                   const std::vector<std::string> &utf8Removes, const std::vector<std::string> &utf8Adds,
+                                   uint64_t &journalSize)
+{
+    std::error_code ec;
+    const uintmax_t currentSize = std::filesystem::file_size(journal, ec);
+    if (m_path != journal || m_baseGeneration != baseGeneration || ec || currentSize != m_size)
+    {
+        if (!Recover(journal, baseGeneration))
+        {
+            return false;
+        }
+    }
+
+    std::vector<uint8_t> bytes;
+    uint64_t sequence = m_nextSequence;
+    std::u16string units;
+    const auto appendRecords = [&](const std::vector<std::string> &utf8Paths, JournalOp op) {
+        for (const std::string &utf8 : utf8Paths)
+        {
+            units.clear();
+            AppendWideAsUtf16(NormalizeUtf8Path(utf8), units);
+            AppendOverlayJournalRecord(bytes, sequence++, op, units);
+        }
+    };
+    appendRecords(utf8Removes, JournalOp::Remove);
+    appendRecords(utf8Adds, JournalOp::Add);
+
+    if (!bytes.empty())
+    {
+        std::ofstream out(journal, std::ios::binary | std::ios::app);
+        if (!out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size())) ||
+            !out.flush())
+        {
+            // Whatever reached the file is rescanned on the next call.
+            m_path.clear();
+            return false;
+        }
+        m_size += bytes.size();
+        m_nextSequence = sequence;
+    }
+
+    journalSize = m_size;
+    return true;
+}
+
+COverlaySegmentPublisher::COverlaySegmentPublisher(std::string segmentName) : m_name(std::move(segmentName))
+{
+}
+
+COverlaySegmentPublisher::~COverlaySegmentPublisher()
+{
+    // Handlers that still have the segment mapped go back to the files.
+    Invalidate();
+}
+
+bool COverlaySegmentPublisher::PublishImage(const std::vector<uint8_t> &image)
+{
+    if (m_segment.IsOpen() && image.size() <= m_writer.SlotCapacity())
+    {
+        return m_writer.Publish(image);
+    }
+
+    // First publish: adopt the segment an earlier run left if it is large
+    // enough. Otherwise retire it, or ours once the image outgrew it (readers
+    // holding it fall back to the files, then reopen by name), and create a
+    // larger one.
+    const size_t capacity = std::max(kMinSlotCapacity, image.size() * 2);
+    const uint64_t segmentId = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        if (m_segment.IsOpen())
+        {
+            m_writer.Invalidate();
+            m_writer.Detach();
+            m_segment.Close();
+            CSharedMemorySegment::Remove(m_name);
+        }
+
+        if (!m_segment.Create(m_name, COverlaySharedIndexWriter::SegmentSize(capacity)) ||
+            !m_writer.Attach(m_segment.Data(), m_segment.Size(), segmentId))
+        {
+            m_writer.Detach();
+            m_segment.Close();
+            return false;
+        }
+        if (image.size() <= m_writer.SlotCapacity())
+        {
+            return m_writer.Publish(image);
+        }
+    }
+
+    // The name is still held by a segment too small for the image.
+    m_writer.Invalidate();
+    return false;
+}
+
+bool COverlaySegmentPublisher::PublishIndex(std::vector<std::wstring> roots, const std::vector<uint8_t> &image,
+                                            uint64_t generation)
+{
+    m_roots = std::move(roots);
+    m_generation = generation;
+    return PublishImage(image);
+}
+
+bool COverlaySegmentPublisher::LoadFromFiles(const std::filesystem::path &index, const std::filesystem::path &journal,
+                                             uint64_t baseGeneration)
+{
+    m_roots.clear();
+    m_generation = 0;
+
+    const std::vector<uint8_t> indexBytes = ReadWholeFile(index);
+    COverlayIndexView view;
+    if (view.Open(indexBytes.data(), indexBytes.size()) != OverlayIndexStatus::Ok || view.Generation() != baseGeneration)
+    {
+        return false;
+    }
+
+    std::vector<std::wstring> roots;
+    roots.reserve(view.EntryCount());
+    view.ForEach(
+        [](std::u16string_view entry, void *context) {
+            static_cast<std::vector<std::wstring> *>(context)->emplace_back(entry.begin(), entry.end());
+        },
+        &roots);
+
+    const std::vector<uint8_t> journalBytes = ReadWholeFile(journal);
+    OverlayJournalHeader header = {};
+    std::vector<JournalRecord> records;
+    if (ParseOverlayJournalHeader(journalBytes.data(), journalBytes.size(), header) == OverlayJournalStatus::Ok &&
+        header.baseGeneration == baseGeneration)
+    {
+        uint64_t nextSequence = 1;
+        ParseOverlayJournalRecords(journalBytes.data() + sizeof(header), journalBytes.size() - sizeof(header), nextSequence,
+                                   records);
+    }
+
+    m_roots = CompactJournal(std::move(roots), CJournalLayer(), records);
+    m_generation = baseGeneration;
+    return true;
+}
+
+bool COverlaySegmentPublisher::PublishJournal(const std::filesystem::path &index, const std::filesystem::path &journal,
+                                              uint64_t baseGeneration, const std::vector<std::string> &utf8Removes,
+                                              const std::vector<std::string> &utf8Adds)
+{
+    if (m_generation != baseGeneration)
+    {
+        // The journal on disk already holds these records.
+        if (!LoadFromFiles(index, journal, baseGeneration))
+        {
+            Invalidate();
+            return false;
+        }
+    }
+    else
+    {
+        std::vector<JournalRecord> records;
+        records.reserve(utf8Removes.size() + utf8Adds.size());
+        for (const std::string &utf8 : utf8Removes)
+        {
+            records.push_back(JournalRecord{0, JournalOp::Remove, NormalizeUtf8Path(utf8)});
+        }
+        for (const std::string &utf8 : utf8Adds)
+        {
+            records.push_back(JournalRecord{0, JournalOp::Add, NormalizeUtf8Path(utf8)});
+        }
+        m_roots = CompactJournal(std::move(m_roots), CJournalLayer(), records);
+    }
+
+    return PublishImage(BuildImageFromRoots(m_roots, m_generation, m_roots.size()));
+}
+
+void COverlaySegmentPublisher::Invalidate()
+{
+    m_writer.Invalidate();
+}
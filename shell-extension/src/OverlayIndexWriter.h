@@ -0,0 +1,107 @@
+// RRightclickrr overlay index writer
+//
+// Used by the app (through the native Node addon) to publish
+// synced-paths.idx and its append-only journal for the shell extension, and
+// to mirror both into the shared-memory segment the handler queries in place.
+// Also writes synced-links.idx for the in-process "Copy Google Drive Link"
+// and synced-exclusions.idx for suppressing overlays under excluded paths.
+
+#pragma once
+
+#include "OverlaySharedIndex.h"
+#include "SharedMemorySegment.h"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+class COverlaySegmentPublisher;
+
+// Generation stored in an existing index file, or 0 if it is missing/invalid.
+uint64_t ReadOverlayIndexGeneration(const std::filesystem::path &file);
+
+// Normalizes the UTF-8 paths exactly like the overlay handler, reduces them to
+// their covering roots, then writes a new index with the next generation
+// number. The file is replaced atomically when possible; if a reader holds it
+// mapped the image is written in place and readers detect the tear through
+// the checksums. Once the file is written the same image goes to publisher,
+// if given; a failure there does not fail the write.
+bool WriteOverlayIndex(const std::filesystem::path &file, const std::vector<std::string> &utf8Paths, uint64_t &generation,
+                       COverlaySegmentPublisher *publisher = nullptr);
+
+// Writes a prebuilt image to file (temp file + rename, in-place fallback).
+bool WriteOverlayIndexImage(const std::filesystem::path &file, const std::vector<uint8_t> &image);
+
+// Normalizes the UTF-8 paths like the overlay handler and writes the Drive
+// link index with the next generation number; utf8Urls[i] is the link of
+// utf8Paths[i]. Same replacement rules as WriteOverlayIndex.
+bool WriteDriveLinkIndex(const std::filesystem::path &file, const std::vector<std::string> &utf8Paths,
+                         const std::vector<std::string> &utf8Urls, uint64_t &generation);
+
+// Compiles the exclusion rules and writes the exclusion index with the next
+// generation number; utf8Patterns[i] is relative to the synced folder
+// utf8Roots[i]. Same replacement rules as WriteOverlayIndex.
+bool WriteExclusionIndex(const std::filesystem::path &file, const std::vector<std::string> &utf8Roots,
+                         const std::vector<std::string> &utf8Patterns, uint64_t &generation);
+
+// Appends add/remove records to synced-paths.journal on top of the index
+// generation baseGeneration. Keeps the tail offset and next sequence number
+// between calls and rescans the file only when it changed underneath.
+class COverlayJournalWriter
+{
+public:
+    // Starts an empty journal for baseGeneration (after a full index write).
+    bool Reset(const std::filesystem::path &journal, uint64_t baseGeneration);
+
+    // Writes the removes first, then the adds. journalSize receives the file
+    // size afterwards so the caller can decide when to compact.
+    bool Append(const std::filesystem::path &journal, uint64_t baseGeneration, const std::vector<std::string> &utf8Removes,
+                const std::vector<std::string> &utf8Adds, uint64_t &journalSize);
+
+private:
+    bool Recover(const std::filesystem::path &journal, uint64_t baseGeneration);
+
+    std::filesystem::path m_path;
+    uint64_t m_baseGeneration = 0;
+    uint64_t m_size = 0;
+    uint64_t m_nextSequence = 0;
+};
+
+// Keeps the covering roots of the last index written plus the journal on top
+// of it, and publishes them to the shared index segment after every change.
+// The files stay authoritative: when the segment cannot be created or the
+// image outgrows it, readers are sent back to them.
+class COverlaySegmentPublisher
+{
+public:
+    explicit COverlaySegmentPublisher(std::string segmentName = OverlaySharedIndexSegmentName());
+    ~COverlaySegmentPublisher();
+
+    COverlaySegmentPublisher(const COverlaySegmentPublisher &) = delete;
+    COverlaySegmentPublisher &operator=(const COverlaySegmentPublisher &) = delete;
+
+    // Publishes the roots just written to the index as image.
+    bool PublishIndex(std::vector<std::wstring> roots, const std::vector<uint8_t> &image, uint64_t generation);
+
+    // Publishes the records just appended to journal on top of index
+    // generation baseGeneration. Starts from both files when the segment
+    // does not hold that generation yet (first append after a restart).
+    bool PublishJournal(const std::filesystem::path &index, const std::filesystem::path &journal, uint64_t baseGeneration,
+                        const std::vector<std::string> &utf8Removes, const std::vector<std::string> &utf8Adds);
+
+    void Invalidate();
+
+    size_t RootCount() const { return m_roots.size(); }
+    size_t SlotCapacity() const { return m_writer.SlotCapacity(); }
+    uint64_t PublishCount() const { return m_writer.PublishCount(); }
+
+private:
+    bool LoadFromFiles(const std::filesystem::path &index, const std::filesystem::path &journal, uint64_t baseGeneration);
+    bool PublishImage(const std::vector<uint8_t> &image);
+
+    std::string m_name;
+    CSharedMemorySegment m_segment;
+    COverlaySharedIndexWriter m_writer;
+    std::vector<std::wstring> m_roots;
+    uint64_t m_generation = 0; // Index generation m_roots build on; 0 = nothing published
+};
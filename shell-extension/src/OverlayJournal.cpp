@@ -0,0 +1,143 @@
+// RRightclickrr append-only overlay journal (synced-paths.journal)
+
+#include "OverlayJournal.h"
+#include "Crc32.h"
+#include "SyncedPathMatch.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+uint32_t HeaderChecksum(OverlayJournalHeader header)
+{
+    header.headerChecksum = 0;
+    return Crc32(&header, sizeof(header));
+}
+
+uint32_t RecordChecksum(OverlayJournalRecordHeader record, const void *path)
+{
+    record.checksum = 0;
+    const uint32_t crc = Crc32(&record, sizeof(record));
+    return Crc32(path, static_cast<size_t>(record.pathLength) * 2, crc);
+}
+} // namespace
+
+std::vector<uint8_t> BuildOverlayJournalHeader(uint64_t baseGeneration)
+{
+    OverlayJournalHeader header = {};
+    header.magic = kOverlayJournalMagic;
+    header.version = kOverlayJournalVersion;
+    header.headerSize = sizeof(OverlayJournalHeader);
+    header.baseGeneration = baseGeneration;
+    header.headerChecksum = HeaderChecksum(header);
+
+    std::vector<uint8_t> bytes(sizeof(header));
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    return bytes;
+}
+
+void AppendOverlayJournalRecord(std::vector<uint8_t> &out, uint64_t sequence, JournalOp op, std::u16string_view path)
+{
+    OverlayJournalRecordHeader record = {};
+    record.sequence = sequence;
+    record.op = static_cast<uint16_t>(op);
+    record.pathLength = static_cast<uint16_t>(std::min<size_t>(path.size(), 0xFFFF));
+    record.checksum = RecordChecksum(record, path.data());
+
+    const size_t offset = out.size();
+    out.resize(offset + sizeof(record) + static_cast<size_t>(record.pathLength) * 2);
+    std::memcpy(out.data() + offset, &record, sizeof(record));
+    std::memcpy(out.data() + offset + sizeof(record), path.data(), static_cast<size_t>(record.pathLength) * 2);
+}
+
+OverlayJournalStatus ParseOverlayJournalHeader(const void *data, size_t size, OverlayJournalHeader &header)
+{
+    if (!data || size < sizeof(OverlayJournalHeader))
+    {
+        return OverlayJournalStatus::TooSmall;
+    }
+
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != kOverlayJournalMagic)
+    {
+        return OverlayJournalStatus::BadMagic;
+    }
+    if (header.version != kOverlayJournalVersion || header.headerSize != sizeof(OverlayJournalHeader))
+    {
+        return OverlayJournalStatus::BadVersion;
+    }
+    if (HeaderChecksum(header) != header.headerChecksum)
+    {
+        return OverlayJournalStatus::ChecksumMismatch;
+    }
+    return OverlayJournalStatus::Ok;
+}
+
+size_t ParseOverlayJournalRecords(const void *data, size_t size, uint64_t &nextSequence, std::vector<JournalRecord> &records)
+{
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    size_t offset = 0;
+    std::u16string units;
+    while (size - offset >= sizeof(OverlayJournalRecordHeader))
+    {
+        OverlayJournalRecordHeader record;
+        std::memcpy(&record, bytes + offset, sizeof(record));
+
+        const size_t pathBytes = static_cast<size_t>(record.pathLength) * 2;
+        if (size - offset - sizeof(record) < pathBytes)
+        {
+            break;
+        }
+
+        const uint8_t *path = bytes + offset + sizeof(record);
+        if (record.checksum != RecordChecksum(record, path) || record.sequence != nextSequence ||
+            (record.op != static_cast<uint16_t>(JournalOp::Add) && record.op != static_cast<uint16_t>(JournalOp::Remove)))
+        {
+            break;
+        }
+
+        units.resize(record.pathLength);
+        std::memcpy(units.data(), path, pathBytes);
+
+        JournalRecord decoded{record.sequence, static_cast<JournalOp>(record.op), std::wstring()};
+        decoded.path.reserve(units.size());
+        for (char16_t unit : units)
+        {
+            decoded.path.push_back(static_cast<wchar_t>(unit));
+        }
+        records.push_back(std::move(decoded));
+
+        nextSequence++;
+        offset += sizeof(record) + pathBytes;
+    }
+    return offset;
+}
+
+void RemoveRootsUnder(std::vector<std::wstring> &roots, std::wstring_view path)
+{
+    roots.erase(std::remove_if(roots.begin(), roots.end(),
+                               [&](const std::wstring &root) { return IsSameOrChildPath(root, path); }),
+                roots.end());
+}
+
+std::vector<std::wstring> CompactJournal(std::vector<std::wstring> baseRoots, const CJournalLayer &layer,
+                                         const std::vector<JournalRecord> &pending)
+{
+    std::vector<std::wstring> roots = std::move(baseRoots);
+    roots.insert(roots.end(), layer.Roots().begin(), layer.Roots().end());
+
+    for (const JournalRecord &record : pending)
+    {
+        if (record.op == JournalOp::Add)
+        {
+            roots.push_back(record.path);
+        }
+        else
+        {
+            RemoveRootsUnder(roots, record.path);
+        }
+    }
+
+    ReduceToCoveringRoots(roots);
+    return roots;
+}
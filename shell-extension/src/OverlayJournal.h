@@ -0,0 +1,118 @@
+// RRightclickrr append-only overlay journal (synced-paths.journal)
+//
+// Small changes are appended here instead of rewriting synced-paths.idx, and
+// the overlay handler applies only the records past the offset it last read.
+//
+// Layout (little-endian):
+//   OverlayJournalHeader (32 bytes), naming the base index generation the
+//   records apply on top of
+//   records - OverlayJournalRecordHeader (16 bytes) + pathLength x uint16
+//             normalized UTF-16 path; sequence numbers count up from 1
+//
+// A record is only trusted once its checksum matches, so a reader racing an
+// append stops at the torn tail and picks it up on the next read.
+
+#pragma once
+
+#include "ParentVerdictMemo.h"
+#include "SyncedPathTrie.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr uint32_t kOverlayJournalMagic = 0x4C4A5252; // "RRJL"
+constexpr uint16_t kOverlayJournalVersion = 1;
+
+struct OverlayJournalHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint64_t baseGeneration; // synced-paths.idx generation the records extend
+    uint32_t reserved[3];
+    uint32_t headerChecksum; // CRC-32 of this header with this field zeroed
+};
+static_assert(sizeof(OverlayJournalHeader) == 32, "OverlayJournalHeader layout is part of the file format");
+
+enum class JournalOp : uint16_t
+{
+    Add = 1,
+    Remove = 2, // Drops the path and everything beneath it
+};
+
+struct OverlayJournalRecordHeader
+{
+    uint64_t sequence;
+    uint16_t op;
+    uint16_t pathLength;
+    uint32_t checksum; // CRC-32 of the fields above and the path
+};
+static_assert(sizeof(OverlayJournalRecordHeader) == 16, "OverlayJournalRecordHeader layout is part of the file format");
+
+enum class OverlayJournalStatus
+{
+    Ok,
+    TooSmall,
+    BadMagic,
+    BadVersion,
+    ChecksumMismatch,
+};
+
+struct JournalRecord
+{
+    uint64_t sequence;
+    JournalOp op;
+    std::wstring path;
+};
+
+std::vector<uint8_t> BuildOverlayJournalHeader(uint64_t baseGeneration);
+void AppendOverlayJournalRecord(std::vector<uint8_t> &out, uint64_t sequence, JournalOp op, std::u16string_view path);
+
+OverlayJournalStatus ParseOverlayJournalHeader(const void *data, size_t size, OverlayJournalHeader &header);
+
+// Decodes the complete, valid records at the start of data[0, size), which
+// must begin on a record boundary. Stops at a torn or corrupt record or a
+// break in the sequence. Returns the bytes consumed; nextSequence advances
+// past the last record decoded.
+size_t ParseOverlayJournalRecords(const void *data, size_t size, uint64_t &nextSequence, std::vector<JournalRecord> &records);
+
+// Removes every root equal to or beneath path (Remove semantics).
+void RemoveRootsUnder(std::vector<std::wstring> &roots, std::wstring_view path);
+
+// Roots added by journal records on top of an immutable base. Copied into
+// each new snapshot, so it is kept small: once it grows past a threshold, or
+// a record removes anything, the caller compacts base and layer into a new
+// base (CompactJournal).
+class CJournalLayer
+{
+public:
+    // Adds path unless it or the layer already covers it; baseMatches reports
+    // whether the base does.
+    template <typename BaseMatches>
+    void Add(std::wstring_view path, BaseMatches &&baseMatches)
+    {
+        if (m_trie.Matches(path) || baseMatches(path))
+        {
+            return;
+        }
+        m_roots.emplace_back(path);
+        m_trie.Insert(path);
+    }
+
+    bool Empty() const { return m_roots.empty(); }
+    size_t Size() const { return m_roots.size(); }
+    const std::vector<std::wstring> &Roots() const { return m_roots; }
+    bool Matches(std::wstring_view path) const { return m_trie.Matches(path); }
+    ParentVerdict Classify(std::wstring_view parentWithSeparator) const { return ClassifyParent(m_trie, parentWithSeparator); }
+
+private:
+    std::vector<std::wstring> m_roots;
+    CSyncedPathTrie m_trie;
+};
+
+// Base roots plus the layer, with the remaining records applied in order,
+// reduced to covering roots.
+std::vector<std::wstring> CompactJournal(std::vector<std::wstring> baseRoots, const CJournalLayer &layer,
+                                         const std::vector<JournalRecord> &pending);
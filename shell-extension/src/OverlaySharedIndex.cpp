@@ -0,0 +1,205 @@
+// RRightclickrr overlay index in shared memory
+
+#include "OverlaySharedIndex.h"
+#include <cstring>
+
+namespace
+{
+size_t SlotStride(uint64_t slotCapacity)
+{
+    return sizeof(OverlaySharedSlot) + static_cast<size_t>(slotCapacity);
+}
+
+// Header fields a reader and writer must agree on before touching the slots.
+bool HeaderUsable(const OverlaySharedHeader *header, size_t size)
+{
+    if (header->magic.load(std::memory_order_acquire) != kOverlaySharedMagic)
+    {
+        return false;
+    }
+    return header->version == kOverlaySharedVersion && header->headerSize == sizeof(OverlaySharedHeader) &&
+           header->slotCapacity % COverlaySharedIndexWriter::kSlotAlignment == 0 &&
+           header->slotCapacity <= size && COverlaySharedIndexWriter::SegmentSize(static_cast<size_t>(header->slotCapacity)) <= size;
+}
+} // namespace
+
+size_t COverlaySharedIndexWriter::SegmentSize(size_t slotCapacity)
+{
+    return sizeof(OverlaySharedHeader) + 2 * SlotStride(slotCapacity);
+}
+
+bool COverlaySharedIndexWriter::Attach(void *data, size_t size, uint64_t segmentId)
+{
+    m_header = nullptr;
+    m_base = nullptr;
+    if (!data || size < SegmentSize(kSlotAlignment))
+    {
+        return false;
+    }
+
+    auto *header = static_cast<OverlaySharedHeader *>(data);
+    if (!HeaderUsable(header, size))
+    {
+        // A fresh (zero-filled) segment, or one from an incompatible version.
+        header->magic.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memset(static_cast<uint8_t *>(data) + sizeof(OverlaySharedHeader), 0, size - sizeof(OverlaySharedHeader));
+        header->version = kOverlaySharedVersion;
+        header->headerSize = sizeof(OverlaySharedHeader);
+        header->slotCapacity = (size - SegmentSize(0)) / 2 / kSlotAlignment * kSlotAlignment;
+        header->segmentId = segmentId;
+        header->publishCount.store(0, std::memory_order_relaxed);
+        header->state.store(static_cast<uint32_t>(OverlaySharedState::Ready), std::memory_order_relaxed);
+        header->magic.store(kOverlaySharedMagic, std::memory_order_release);
+    }
+
+    m_header = header;
+    m_base = static_cast<uint8_t *>(data);
+    return true;
+}
+
+bool COverlaySharedIndexWriter::Publish(const std::vector<uint8_t> &image)
+{
+    if (!m_header)
+    {
+        return false;
+    }
+    if (image.size() > m_header->slotCapacity)
+    {
+        Invalidate();
+        return false;
+    }
+
+    const uint64_t count = m_header->publishCount.load(std::memory_order_relaxed);
+    auto *slot = reinterpret_cast<OverlaySharedSlot *>(m_base + sizeof(OverlaySharedHeader) +
+                                                        ((count + 1) % 2) * SlotStride(m_header->slotCapacity));
+
+    // Odd while writing; a writer that died mid-publish left it odd already.
+    uint64_t writing = slot->sequence.load(std::memory_order_relaxed) + 1;
+    writing += (writing % 2 == 0) ? 1 : 0;
+    slot->sequence.store(writing, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(reinterpret_cast<uint8_t *>(slot + 1), image.data(), image.size());
+    slot->imageSize.store(image.size(), std::memory_order_relaxed);
+    slot->sequence.store(writing + 1, std::memory_order_release);
+
+    m_header->state.store(static_cast<uint32_t>(OverlaySharedState::Ready), std::memory_order_relaxed);
+    m_header->publishCount.store(count + 1, std::memory_order_release);
+    return true;
+}
+
+void COverlaySharedIndexWriter::Invalidate()
+{
+    if (m_header)
+    {
+        m_header->state.store(static_cast<uint32_t>(OverlaySharedState::Unavailable), std::memory_order_release);
+    }
+}
+
+void COverlaySharedIndexWriter::Detach()
+{
+    m_header = nullptr;
+    m_base = nullptr;
+}
+
+size_t COverlaySharedIndexWriter::SlotCapacity() const
+{
+    return m_header ? static_cast<size_t>(m_header->slotCapacity) : 0;
+}
+
+uint64_t COverlaySharedIndexWriter::PublishCount() const
+{
+    return m_header ? m_header->publishCount.load(std::memory_order_relaxed) : 0;
+}
+
+bool COverlaySharedIndexReader::Attach(const void *data, size_t size)
+{
+    m_header = nullptr;
+    m_base = nullptr;
+    if (!data || size < sizeof(OverlaySharedHeader))
+    {
+        return false;
+    }
+
+    const auto *header = static_cast<const OverlaySharedHeader *>(data);
+    if (!HeaderUsable(header, size))
+    {
+        return false;
+    }
+
+    m_header = header;
+    m_base = static_cast<const uint8_t *>(data);
+    return true;
+}
+
+bool COverlaySharedIndexReader::IsReady() const
+{
+    return m_header &&
+           m_header->state.load(std::memory_order_acquire) == static_cast<uint32_t>(OverlaySharedState::Ready);
+}
+
+uint64_t COverlaySharedIndexReader::SegmentId() const
+{
+    return m_header ? m_header->segmentId : 0;
+}
+
+uint64_t COverlaySharedIndexReader::PublishCount() const
+{
+    return m_header ? m_header->publishCount.load(std::memory_order_acquire) : 0;
+}
+
+const OverlaySharedSlot *COverlaySharedIndexReader::Slot(uint64_t publishCount) const
+{
+    return reinterpret_cast<const OverlaySharedSlot *>(m_base + sizeof(OverlaySharedHeader) +
+                                                       (publishCount % 2) * SlotStride(m_header->slotCapacity));
+}
+
+OverlaySharedStatus COverlaySharedIndexReader::OpenCurrent(COverlayIndexView &view, OverlaySharedLease &lease,
+                                                           uint64_t &publishCount) const
+{
+    view.Close();
+    lease = {};
+    if (!m_header)
+    {
+        return OverlaySharedStatus::Absent;
+    }
+    if (!IsReady())
+    {
+        return OverlaySharedStatus::Unavailable;
+    }
+
+    const uint64_t count = m_header->publishCount.load(std::memory_order_acquire);
+    if (count == 0)
+    {
+        return OverlaySharedStatus::Absent;
+    }
+
+    const OverlaySharedSlot *slot = Slot(count);
+    const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    if (sequence % 2 != 0)
+    {
+        return OverlaySharedStatus::Busy;
+    }
+
+    const uint64_t imageSize = slot->imageSize.load(std::memory_order_relaxed);
+    const OverlayIndexStatus status =
+        imageSize <= m_header->slotCapacity ? view.Open(slot + 1, static_cast<size_t>(imageSize)) : OverlayIndexStatus::BadLayout;
+
+    lease.sequence = &slot->sequence;
+    lease.expected = sequence;
+    if (!lease.IsStable())
+    {
+        view.Close();
+        lease = {};
+        return OverlaySharedStatus::Busy;
+    }
+    if (status != OverlayIndexStatus::Ok)
+    {
+        view.Close();
+        lease = {};
+        return OverlaySharedStatus::Invalid;
+    }
+
+    publishCount = count;
+    return OverlaySharedStatus::Ok;
+}
@@ -0,0 +1,138 @@
+// RRightclickrr overlay index in shared memory
+//
+// The app publishes the synced roots into one named segment (see
+// SharedMemorySegment.h) and every process hosting the overlay handler maps
+// it read-only and queries it in place, instead of each mapping, validating
+// and replaying synced-paths.idx and its journal on its own.
+//
+// Layout:
+//   OverlaySharedHeader (64 bytes)
+//   two slots, each an OverlaySharedSlot (64 bytes) followed by slotCapacity
+//   bytes holding a complete synced-paths.idx image (OverlayIndexFormat.h)
+//
+// There is a single writer. It fills the slot readers are not directed to,
+// bracketing the copy with its sequence number (odd while writing, seqlock
+// style), then bumps publishCount, whose parity names the active slot. A
+// reader validates the image like a file (checksums included) and keeps the
+// slot's sequence number; a later change means the writer has come round to
+// that slot again and any answer taken from it since has to be discarded.
+// Every access the view makes is bounds-checked, so reading bytes that are
+// being overwritten returns a wrong answer, never a fault.
+
+#pragma once
+
+#include "OverlayIndexFormat.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+constexpr uint32_t kOverlaySharedMagic = 0x4D535252; // "RRSM"
+constexpr uint16_t kOverlaySharedVersion = 1;
+
+enum class OverlaySharedState : uint32_t
+{
+    Ready = 1,
+    Unavailable = 2, // The writer cannot publish (image too large, shutting down); use the files
+};
+
+struct OverlaySharedHeader
+{
+    std::atomic<uint32_t> magic; // Stored last when the writer initializes the segment
+    uint16_t version;
+    uint16_t headerSize;
+    uint64_t slotCapacity;
+    uint64_t segmentId;          // Tells a recreated segment from the one a reader already has
+    std::atomic<uint64_t> publishCount; // 0 = nothing published; odd = slot 1, even = slot 0
+    std::atomic<uint32_t> state;        // OverlaySharedState
+    uint8_t reserved[28];
+};
+static_assert(sizeof(OverlaySharedHeader) == 64, "OverlaySharedHeader layout is shared between processes");
+
+struct OverlaySharedSlot
+{
+    std::atomic<uint64_t> sequence; // Odd while the writer is filling the slot
+    std::atomic<uint64_t> imageSize;
+    uint8_t reserved[48];
+};
+static_assert(sizeof(OverlaySharedSlot) == 64, "OverlaySharedSlot layout is shared between processes");
+
+// Atomics in memory shared between processes must not fall back to a lock.
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "Shared index counters must be lock-free");
+
+enum class OverlaySharedStatus
+{
+    Ok,
+    Absent,      // No segment, or nothing published yet
+    Unavailable, // The writer gave up on the segment
+    Busy,        // The writer republished while the image was being opened; retry
+    Invalid,     // Image failed validation
+};
+
+// Proof that a view opened by COverlaySharedIndexReader still shows the
+// bytes it was opened on.
+struct OverlaySharedLease
+{
+    const std::atomic<uint64_t> *sequence = nullptr;
+    uint64_t expected = 0;
+
+    // Call after using the view: true when nothing it read was overwritten.
+    bool IsStable() const
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return !sequence || sequence->load(std::memory_order_relaxed) == expected;
+    }
+};
+
+class COverlaySharedIndexWriter
+{
+public:
+    static constexpr size_t kSlotAlignment = 64;
+
+    // Bytes needed for a segment with two slots of slotCapacity.
+    static size_t SegmentSize(size_t slotCapacity);
+
+    // Initializes a new segment, or adopts one this writer's format already
+    // laid out (publish counts continue from it). segmentId only applies to
+    // a new one.
+    bool Attach(void *data, size_t size, uint64_t segmentId);
+
+    // Copies image into the inactive slot and makes it the active one.
+    // Returns false, and marks the segment Unavailable, when it does not fit.
+    bool Publish(const std::vector<uint8_t> &image);
+
+    // Sends readers back to the files.
+    void Invalidate();
+
+    // Forgets the segment (before it is unmapped).
+    void Detach();
+
+    size_t SlotCapacity() const;
+    uint64_t PublishCount() const;
+
+private:
+    OverlaySharedHeader *m_header = nullptr;
+    uint8_t *m_base = nullptr;
+};
+
+class COverlaySharedIndexReader
+{
+public:
+    bool Attach(const void *data, size_t size);
+
+    bool IsAttached() const { return m_header != nullptr; }
+    bool IsReady() const;
+    uint64_t SegmentId() const;
+    uint64_t PublishCount() const;
+
+    // Opens view on the active slot. publishCount receives the count the
+    // image was published under.
+    OverlaySharedStatus OpenCurrent(COverlayIndexView &view, OverlaySharedLease &lease, uint64_t &publishCount) const;
+
+private:
+    const OverlaySharedSlot *Slot(uint64_t publishCount) const;
+
+    const OverlaySharedHeader *m_header = nullptr;
+    const uint8_t *m_base = nullptr;
+};
@@ -0,0 +1,116 @@
+// RRightclickrr per-path sync state shared by the overlay handlers
+
+#include "OverlayStatus.h"
+#include "PathNormalize.h"
+#include "Utf8.h"
+#include <string>
+
+namespace
+{
+struct StateName
+{
+    OverlayState state;
+    std::string_view name;
+};
+
+constexpr StateName kStateNames[] = {
+    {OverlayState::Synced, "synced"},
+    {OverlayState::Syncing, "syncing"},
+    {OverlayState::Error, "error"},
+    {OverlayState::Pending, "pending"},
+};
+
+// Slot in COverlayStatusSet::m_tries, or -1 for states not kept there.
+int TransientSlot(OverlayState state)
+{
+    switch (state)
+    {
+    case OverlayState::Error: return 0;
+    case OverlayState::Syncing: return 1;
+    case OverlayState::Pending: return 2;
+    default: return -1;
+    }
+}
+
+constexpr OverlayState kSlotStates[] = {OverlayState::Error, OverlayState::Syncing, OverlayState::Pending};
+} // namespace
+
+OverlayState ParseOverlayStateName(std::string_view name)
+{
+    for (const StateName &entry : kStateNames)
+    {
+        if (entry.name == name)
+        {
+            return entry.state;
+        }
+    }
+    return OverlayState::None;
+}
+
+const char *OverlayStateName(OverlayState state)
+{
+    for (const StateName &entry : kStateNames)
+    {
+        if (entry.state == state)
+        {
+            return entry.name.data();
+        }
+    }
+    return "none";
+}
+
+void COverlayStatusSet::Add(OverlayState state, std::wstring_view normalizedPath)
+{
+    const int slot = TransientSlot(state);
+    if (slot < 0 || normalizedPath.empty())
+    {
+        return;
+    }
+    m_tries[slot].Insert(normalizedPath);
+    m_size++;
+}
+
+size_t COverlayStatusSet::Parse(std::string_view utf8)
+{
+    if (utf8.substr(0, 3) == "\xEF\xBB\xBF")
+    {
+        utf8.remove_prefix(3);
+    }
+
+    const size_t before = m_size;
+    std::wstring path;
+    while (!utf8.empty())
+    {
+        const size_t newline = utf8.find('\n');
+        std::string_view line = utf8.substr(0, newline);
+        utf8.remove_prefix(newline == std::string_view::npos ? utf8.size() : newline + 1);
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+
+        const size_t tab = line.find('\t');
+        if (tab == std::string_view::npos)
+        {
+            continue;
+        }
+
+        path.clear();
+        AppendUtf8AsWide(line.substr(tab + 1), path);
+        path.resize(NormalizePathInPlace(path.data(), path.size()));
+        Add(ParseOverlayStateName(line.substr(0, tab)), path);
+    }
+    return m_size - before;
+}
+
+OverlayState COverlayStatusSet::Classify(std::wstring_view normalizedPath) const
+{
+    for (size_t slot = 0; slot < kTransientStates; slot++)
+    {
+        if (!m_tries[slot].Empty() && m_tries[slot].Matches(normalizedPath))
+        {
+            return kSlotStates[slot];
+        }
+    }
+    return OverlayState::None;
+}
@@ -0,0 +1,121 @@
+// RRightclickrr per-path sync state shared by the overlay handlers
+//
+// Explorer calls every registered overlay identifier's IsMemberOf for each
+// item, one after the other on the same thread. Each handler owns one state,
+// so the state for a path is resolved once, kept as the thread's last query,
+// and every other handler answers from it with a compare.
+
+#pragma once
+
+#include "SyncedPathTrie.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cwchar>
+#include <string_view>
+
+enum class OverlayState : uint8_t
+{
+    None,
+    Synced,  // Under a root in the synced-paths index
+    Syncing, // Upload in progress
+    Error,   // Last sync failed for it or something beneath it
+    Pending, // Queued for sync
+};
+
+// "synced", "syncing", "error", "pending"; None for anything else.
+OverlayState ParseOverlayStateName(std::string_view name);
+const char *OverlayStateName(OverlayState state);
+
+// Transient states listed by the app in sync-status.txt, one
+// "<state>\t<path>" per line. A state covers its path and everything beneath
+// it; where several cover a path, Error wins over Syncing over Pending.
+class COverlayStatusSet
+{
+public:
+    // Adds a normalized path; Synced and None are ignored (synced roots come
+    // from the index).
+    void Add(OverlayState state, std::wstring_view normalizedPath);
+
+    // Parses the status file contents (UTF-8, optional BOM, LF or CRLF).
+    // Returns the number of entries added.
+    size_t Parse(std::string_view utf8);
+
+    OverlayState Classify(std::wstring_view normalizedPath) const;
+
+    bool Empty() const { return m_size == 0; }
+    size_t Size() const { return m_size; }
+
+private:
+    static constexpr size_t kTransientStates = 3;
+
+    // Indexed in priority order: Error, Syncing, Pending.
+    CSyncedPathTrie m_tries[kTransientStates];
+    size_t m_size = 0;
+};
+
+struct OverlayQueryStats
+{
+    std::atomic<uint64_t> lookups{0}; // Index lookups made
+    std::atomic<uint64_t> shared{0};  // Answered from the thread's last query
+};
+
+// The last path a thread resolved and its state; one per thread, shared by
+// every overlay handler. Keyed by the raw path Explorer passed and the
+// snapshot generation, so a repeat skips normalization as well as the lookup
+// and a reload invalidates it. Never allocates.
+class CLastOverlayQuery
+{
+public:
+    static constexpr size_t kMaxPathLength = 520;
+
+    explicit CLastOverlayQuery(OverlayQueryStats *stats = nullptr) : m_stats(stats) {}
+
+    // State of rawPath, from the last query when it matches, otherwise from
+    // lookup(). Generation 0 is never cached.
+    template <typename Lookup>
+    OverlayState Resolve(uint64_t generation, std::wstring_view rawPath, Lookup &&lookup);
+
+    void Clear() { m_generation = 0; }
+
+private:
+    void Count(std::atomic<uint64_t> OverlayQueryStats::*counter)
+    {
+        if (m_stats)
+        {
+            (m_stats->*counter).fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t m_generation = 0;
+    size_t m_length = 0;
+    OverlayState m_state = OverlayState::None;
+    wchar_t m_path[kMaxPathLength];
+    OverlayQueryStats *m_stats;
+};
+
+template <typename Lookup>
+OverlayState CLastOverlayQuery::Resolve(uint64_t generation, std::wstring_view rawPath, Lookup &&lookup)
+{
+    if (generation != 0 && m_generation == generation && m_length == rawPath.size() &&
+        std::wmemcmp(m_path, rawPath.data(), rawPath.size()) == 0)
+    {
+        Count(&OverlayQueryStats::shared);
+        return m_state;
+    }
+
+    Count(&OverlayQueryStats::lookups);
+    const OverlayState state = lookup();
+    if (generation != 0 && rawPath.size() <= kMaxPathLength)
+    {
+        m_generation = generation;
+        m_length = rawPath.size();
+        m_state = state;
+        std::wmemcpy(m_path, rawPath.data(), rawPath.size());
+    }
+    else
+    {
+        m_generation = 0;
+    }
+    return state;
+}
@@ -0,0 +1,48 @@
+// RRightclickrr per-parent answer memo for IsMemberOf bursts
+
+#include "ParentVerdictMemo.h"
+
+ParentVerdict ClassifyParent(const CSyncedPathTrie &trie, std::wstring_view parentWithSeparator)
+{
+    const std::wstring_view parent = parentWithSeparator.substr(0, parentWithSeparator.size() - 1);
+    if (trie.Matches(parent))
+    {
+        return ParentVerdict::Covered;
+    }
+    return trie.HasRootAtOrBelow(parent) ? ParentVerdict::Mixed : ParentVerdict::Empty;
+}
+
+ParentVerdict ClassifyParent(const COverlayIndexView &view, std::u16string_view parentWithSeparator)
+{
+    const std::u16string_view parent = parentWithSeparator.substr(0, parentWithSeparator.size() - 1);
+    if (view.Matches(parent))
+    {
+        return ParentVerdict::Covered;
+    }
+    // Roots stored with a trailing separator ("c:\") sort under the prefix too.
+    if (view.Contains(parent) || view.HasEntryWithPrefix(parentWithSeparator))
+    {
+        return ParentVerdict::Mixed;
+    }
+    return ParentVerdict::Empty;
+}
+
+void CParentVerdictMemo::Clear()
+{
+    for (Entry &entry : m_entries)
+    {
+        entry.generation = 0;
+    }
+}
+
+uint32_t CParentVerdictMemo::HashParent(std::wstring_view parent)
+{
+    // FNV-1a over the code units.
+    uint32_t hash = 2166136261u;
+    for (wchar_t ch : parent)
+    {
+        hash ^= static_cast<uint32_t>(ch);
+        hash *= 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,148 @@
+// RRightclickrr per-parent answer memo for IsMemberOf bursts
+//
+// Explorer asks about every child of a folder in turn. Once the parent is
+// known to lie inside a synced root (every child matches) or to have no
+// synced root at or below it (no child matches), each child is answered
+// without touching the index. Entries are tagged with the snapshot generation
+// they were computed against, so publishing a new snapshot invalidates them.
+
+#pragma once
+
+#include "ExclusionMatcher.h"
+#include "OverlayIndexFormat.h"
+#include "SyncedPathTrie.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cwchar>
+#include <string_view>
+
+enum class ParentVerdict : uint8_t
+{
+    Unknown,
+    Covered, // Parent is a synced root or beneath one
+    Empty,   // No synced root at or beneath the parent
+    Mixed,   // Some children may match; look each one up
+};
+
+// Verdicts for a parent, given as the normalized path up to and including the
+// separator before the child's name ("c:\users\").
+ParentVerdict ClassifyParent(const CSyncedPathTrie &trie, std::wstring_view parentWithSeparator);
+ParentVerdict ClassifyParent(const COverlayIndexView &view, std::u16string_view parentWithSeparator);
+
+// Verdict for a parent over the union of two root sets.
+inline ParentVerdict CombineVerdicts(ParentVerdict lhs, ParentVerdict rhs)
+{
+    if (lhs == ParentVerdict::Covered || rhs == ParentVerdict::Covered)
+    {
+        return ParentVerdict::Covered;
+    }
+    return (lhs == ParentVerdict::Empty && rhs == ParentVerdict::Empty) ? ParentVerdict::Empty : ParentVerdict::Mixed;
+}
+
+// Narrows a synced verdict by what the exclusion rules say about the same
+// parent: no child of an excluded parent matches, and a covered parent with
+// some excluded children has to look each one up.
+inline ParentVerdict ExcludeFromVerdict(ParentVerdict verdict, ExclusionVerdict excluded)
+{
+    if (excluded == ExclusionVerdict::Excluded)
+    {
+        return ParentVerdict::Empty;
+    }
+    if (excluded == ExclusionVerdict::Partial && verdict == ParentVerdict::Covered)
+    {
+        return ParentVerdict::Mixed;
+    }
+    return verdict;
+}
+
+struct ParentMemoStats
+{
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> bypassed{0}; // No parent, or too long to memoize
+};
+
+// Small direct-mapped memo; one per thread. Never allocates.
+class CParentVerdictMemo
+{
+public:
+    static constexpr size_t kEntryCount = 8;
+    static constexpr size_t kMaxParentLength = 260;
+
+    explicit CParentVerdictMemo(ParentMemoStats *stats = nullptr) : m_stats(stats) {}
+
+    // Answers match(path) for a normalized path. On a miss the parent is
+    // classified with classify(parentWithSeparator); Mixed parents fall back
+    // to match(path). Generation 0 is never cached.
+    template <typename Classify, typename Match>
+    bool Resolve(uint64_t generation, std::wstring_view path, Classify &&classify, Match &&match);
+
+    void Clear();
+
+private:
+    struct Entry
+    {
+        uint64_t generation = 0;
+        uint32_t hash = 0;
+        uint32_t length = 0;
+        ParentVerdict verdict = ParentVerdict::Unknown;
+        wchar_t parent[kMaxParentLength];
+    };
+
+    static uint32_t HashParent(std::wstring_view parent);
+    void Count(std::atomic<uint64_t> ParentMemoStats::*counter)
+    {
+        if (m_stats)
+        {
+            (m_stats->*counter).fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    Entry m_entries[kEntryCount];
+    ParentMemoStats *m_stats;
+};
+
+template <typename Classify, typename Match>
+bool CParentVerdictMemo::Resolve(uint64_t generation, std::wstring_view path, Classify &&classify, Match &&match)
+{
+    const size_t separator = path.rfind(L'\\');
+    if (generation == 0 || separator == std::wstring_view::npos || separator == 0 || separator > kMaxParentLength)
+    {
+        Count(&ParentMemoStats::bypassed);
+        return match(path);
+    }
+
+    const std::wstring_view parent = path.substr(0, separator);
+    const uint32_t hash = HashParent(parent);
+    Entry &entry = m_entries[hash & (kEntryCount - 1)];
+
+    ParentVerdict verdict = ParentVerdict::Unknown;
+    if (entry.generation == generation && entry.hash == hash && entry.length == parent.size() &&
+        std::wmemcmp(entry.parent, parent.data(), parent.size()) == 0)
+    {
+        Count(&ParentMemoStats::hits);
+        verdict = entry.verdict;
+    }
+    else
+    {
+        Count(&ParentMemoStats::misses);
+        verdict = classify(path.substr(0, separator + 1));
+
+        entry.generation = generation;
+        entry.hash = hash;
+        entry.length = static_cast<uint32_t>(parent.size());
+        entry.verdict = verdict;
+        std::wmemcpy(entry.parent, parent.data(), parent.size());
+    }
+
+    switch (verdict)
+    {
+    case ParentVerdict::Covered:
+        return true;
+    case ParentVerdict::Empty:
+        return false;
+    default:
+        return match(path);
+    }
+}
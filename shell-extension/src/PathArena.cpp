@@ -0,0 +1,224 @@
+// RRightclickrr contiguous path storage and streaming path-list loader
+
+#include "PathArena.h"
+#include "PathNormalize.h"
+#include "SequentialFileReader.h"
+#include "SyncedPathMatch.h"
+#include "Utf8.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <new>
+
+namespace
+{
+constexpr size_t kMaxArenaChars = UINT32_MAX;
+} // namespace
+
+void CPathArena::Append(std::wstring_view path)
+{
+    if (path.empty() || m_chars.size() + path.size() > kMaxArenaChars)
+    {
+        return;
+    }
+
+    m_entries.push_back(Entry{static_cast<uint32_t>(m_chars.size()), static_cast<uint32_t>(path.size())});
+    m_chars.append(path);
+}
+
+void CPathArena::PopBack()
+{
+    m_chars.resize(m_entries.back().offset);
+    m_entries.pop_back();
+}
+
+void CPathArena::AppendUtf8Normalized(std::string_view utf8)
+{
+    const size_t offset = m_chars.size();
+    AppendUtf8AsWide(utf8, m_chars);
+
+    const size_t length = NormalizePathInPlace(m_chars.data() + offset, m_chars.size() - offset);
+    m_chars.resize(offset + length);
+    if (length == 0 || m_chars.size() > kMaxArenaChars)
+    {
+        m_chars.resize(offset);
+        return;
+    }
+    m_entries.push_back(Entry{static_cast<uint32_t>(offset), static_cast<uint32_t>(length)});
+}
+
+void CPathArena::ReduceToCoveringRoots()
+{
+    std::sort(m_entries.begin(), m_entries.end(), [&](const Entry &lhs, const Entry &rhs) {
+        return CoveringRootOrder(std::wstring_view(m_chars.data() + lhs.offset, lhs.length),
+                                 std::wstring_view(m_chars.data() + rhs.offset, rhs.length));
+    });
+
+    // Same sweep as ReduceToCoveringRoots(std::vector<std::wstring> &), then
+    // copy the survivors out in order.
+    std::wstring packed;
+    std::vector<Entry> kept;
+    for (const Entry &entry : m_entries)
+    {
+        const std::wstring_view path(m_chars.data() + entry.offset, entry.length);
+        if (!kept.empty() && IsSameOrChildPath(path, std::wstring_view(packed.data() + kept.back().offset, kept.back().length)))
+        {
+            continue;
+        }
+        kept.push_back(Entry{static_cast<uint32_t>(packed.size()), entry.length});
+        packed.append(path);
+    }
+
+    packed.shrink_to_fit();
+    kept.shrink_to_fit();
+    m_chars.swap(packed);
+    m_entries.swap(kept);
+}
+
+size_t CPathArena::LowerBound(std::wstring_view key) const
+{
+    size_t low = 0;
+    size_t high = m_entries.size();
+    while (low < high)
+    {
+        const size_t mid = low + (high - low) / 2;
+        if (CoveringRootOrder((*this)[mid], key))
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void CPathArena::Clear()
+{
+    m_chars.clear();
+    m_entries.clear();
+}
+
+CSyncedPathListLoader::CSyncedPathListLoader(CPathArena &arena, size_t reduceChars)
+    : m_arena(arena), m_reduceAt(reduceChars), m_lineCount(0), m_peakChars(0), m_atStart(true)
+{
+}
+
+void CSyncedPathListLoader::Feed(const char *data, size_t size)
+{
+    // Skip a UTF-8 byte order mark, even one split across the first chunks.
+    while (m_atStart && size > 0)
+    {
+        static const char kBom[] = "\xEF\xBB\xBF";
+        const size_t seen = m_partial.size();
+        if (data[0] != kBom[seen])
+        {
+            m_atStart = false;
+            break;
+        }
+        m_partial.push_back(data[0]);
+        data++;
+        size--;
+        if (m_partial.size() == 3)
+        {
+            m_partial.clear();
+            m_atStart = false;
+        }
+    }
+    if (m_atStart)
+    {
+        return;
+    }
+
+    // '\n' never occurs inside a multi-byte UTF-8 sequence, so splitting on
+    // the raw bytes is safe.
+    const char *end = data + size;
+    while (data < end)
+    {
+        const char *newline = static_cast<const char *>(std::memchr(data, '\n', static_cast<size_t>(end - data)));
+        if (!newline)
+        {
+            m_partial.append(data, static_cast<size_t>(end - data));
+            return;
+        }
+
+        if (m_partial.empty())
+        {
+            AddLine(std::string_view(data, static_cast<size_t>(newline - data)));
+        }
+        else
+        {
+            m_partial.append(data, static_cast<size_t>(newline - data));
+            AddLine(m_partial);
+            m_partial.clear();
+        }
+        data = newline + 1;
+    }
+}
+
+void CSyncedPathListLoader::Finish()
+{
+    if (!m_partial.empty())
+    {
+        AddLine(m_partial);
+        m_partial.clear();
+    }
+    m_atStart = false;
+
+    m_arena.ReduceToCoveringRoots();
+}
+
+void CSyncedPathListLoader::AddLine(std::string_view line)
+{
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.remove_suffix(1);
+    }
+    if (line.empty())
+    {
+        return;
+    }
+
+    m_lineCount++;
+    const size_t before = m_arena.Size();
+    m_arena.AppendUtf8Normalized(line);
+
+    // The app lists a folder and then the files in it; drop those straight
+    // away when the last path kept already covers them.
+    if (m_arena.Size() > before && before > 0 &&
+        IsSameOrChildPath(m_arena[before], m_arena[before - 1]))
+    {
+        m_arena.PopBack();
+    }
+    m_peakChars = std::max(m_peakChars, m_arena.CharCount());
+
+    if (m_arena.CharCount() >= m_reduceAt)
+    {
+        m_arena.ReduceToCoveringRoots();
+        m_reduceAt = std::max(m_reduceAt, m_arena.CharCount() * 2);
+    }
+}
+
+bool LoadSyncedPathListFile(const std::filesystem::path &file, CPathArena &roots, size_t &lineCount)
+{
+    std::unique_ptr<char[]> chunk(new (std::nothrow) char[kSyncedPathListChunkBytes]);
+    if (!chunk)
+    {
+        return false;
+    }
+
+    CSyncedPathListLoader loader(roots);
+    const bool ok = ReadFileSequential(
+        file, chunk.get(), kSyncedPathListChunkBytes,
+        [](const char *data, size_t size, void *context) { static_cast<CSyncedPathListLoader *>(context)->Feed(data, size); },
+        &loader);
+    if (!ok)
+    {
+        return false;
+    }
+
+    loader.Finish();
+    lineCount = loader.LineCount();
+    return true;
+}
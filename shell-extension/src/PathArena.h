@@ -0,0 +1,96 @@
+// RRightclickrr contiguous path storage and streaming path-list loader
+//
+// synced-paths.txt lists every file under every synced folder and can run to
+// hundreds of megabytes. The loader decodes it in fixed-size chunks straight
+// into one character buffer plus an offset table, and folds it down to its
+// covering roots whenever the buffer doubles, so memory follows the number of
+// roots rather than the size of the file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Paths packed end to end in a single buffer. After ReduceToCoveringRoots
+// they are stored in covering-root order, so a scan walks memory linearly.
+class CPathArena
+{
+public:
+    size_t Size() const { return m_entries.size(); }
+    bool Empty() const { return m_entries.empty(); }
+    size_t CharCount() const { return m_chars.size(); }
+
+    std::wstring_view operator[](size_t index) const
+    {
+        const Entry &entry = m_entries[index];
+        return std::wstring_view(m_chars.data() + entry.offset, entry.length);
+    }
+
+    void Append(std::wstring_view path);
+    void PopBack();
+
+    // Decodes a UTF-8 path onto the end of the buffer and normalizes it in
+    // place. Empty results are dropped.
+    void AppendUtf8Normalized(std::string_view utf8);
+
+    // Sorts (see CoveringRootOrder), drops every path another one covers and
+    // repacks the characters in that order.
+    void ReduceToCoveringRoots();
+
+    // Index of the first path not ordered before key (binary search); only
+    // meaningful after ReduceToCoveringRoots.
+    size_t LowerBound(std::wstring_view key) const;
+
+    void Clear();
+
+private:
+    struct Entry
+    {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    std::wstring m_chars;
+    std::vector<Entry> m_entries;
+};
+
+// Splits a UTF-8 stream into lines fed in arbitrary chunks. Lines (and UTF-8
+// sequences) may straddle chunks; only a straddling line is copied.
+class CSyncedPathListLoader
+{
+public:
+    // Characters held before the first reduction; later reductions run each
+    // time the buffer doubles from what the previous one left.
+    static constexpr size_t kDefaultReduceChars = size_t(1) << 20;
+
+    explicit CSyncedPathListLoader(CPathArena &arena, size_t reduceChars = kDefaultReduceChars);
+
+    void Feed(const char *data, size_t size);
+
+    // Takes the last line (no trailing newline) and reduces the arena.
+    void Finish();
+
+    size_t LineCount() const { return m_lineCount; }
+    size_t PeakChars() const { return m_peakChars; }
+
+private:
+    void AddLine(std::string_view line);
+
+    CPathArena &m_arena;
+    std::string m_partial; // Start of a line continued in the next chunk
+    size_t m_reduceAt;
+    size_t m_lineCount;
+    size_t m_peakChars;
+    bool m_atStart;
+};
+
+// Chunk size LoadSyncedPathListFile reads with.
+constexpr size_t kSyncedPathListChunkBytes = 64 * 1024;
+
+// Streams a synced-paths.txt file into roots, reduced to covering roots, so
+// no file is too large to load. lineCount receives the paths listed.
+bool LoadSyncedPathListFile(const std::filesystem::path &file, CPathArena &roots, size_t &lineCount);
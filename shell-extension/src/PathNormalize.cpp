@@ -0,0 +1,282 @@
+// RRightclickrr path normalization kernels
+
+#include "PathNormalize.h"
+#include "CaseFoldTable.h"
+#include <cwchar>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RRIGHTCLICKRR_HAVE_SSE2_KERNEL 1
+#include "PathNormalizeSimd.h"
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(RRIGHTCLICKRR_HAVE_AVX2_KERNEL)
+// PathNormalizeAvx2.cpp, built with AVX2 code generation.
+size_t NormalizeAsciiBlocksAvx2(wchar_t *data, size_t length);
+#endif
+
+namespace
+{
+constexpr size_t kCaseFoldRangeCount = sizeof(kCaseFoldRanges) / sizeof(kCaseFoldRanges[0]);
+
+inline wchar_t FoldAsciiUnit(wchar_t unit)
+{
+    if (unit >= L'A' && unit <= L'Z')
+    {
+        return static_cast<wchar_t>(unit + 0x20);
+    }
+    return unit == L'/' ? L'\\' : unit;
+}
+
+size_t TrimTrailingSeparators(const wchar_t *data, size_t length)
+{
+    while (length > 3 && data[length - 1] == L'\\')
+    {
+        length--;
+    }
+    return length;
+}
+
+#if defined(RRIGHTCLICKRR_HAVE_SSE2_KERNEL)
+struct Sse2Ops16
+{
+    using V = __m128i;
+    static constexpr size_t kLanes = 8;
+
+    static V Load(const wchar_t *units) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(units)); }
+    static void Store(wchar_t *units, V value) { _mm_storeu_si128(reinterpret_cast<__m128i *>(units), value); }
+    static V Set1(int value) { return _mm_set1_epi16(static_cast<short>(value)); }
+    static V CmpEq(V lhs, V rhs) { return _mm_cmpeq_epi16(lhs, rhs); }
+    static V CmpGt(V lhs, V rhs) { return _mm_cmpgt_epi16(lhs, rhs); }
+    static V And(V lhs, V rhs) { return _mm_and_si128(lhs, rhs); }
+    static V Xor(V lhs, V rhs) { return _mm_xor_si128(lhs, rhs); }
+    static V Add(V lhs, V rhs) { return _mm_add_epi16(lhs, rhs); }
+    static bool AnyBitSet(V value) { return _mm_movemask_epi8(_mm_cmpeq_epi8(value, _mm_setzero_si128())) != 0xFFFF; }
+};
+
+struct Sse2Ops32
+{
+    using V = __m128i;
+    static constexpr size_t kLanes = 4;
+
+    static V Load(const wchar_t *units) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(units)); }
+    static void Store(wchar_t *units, V value) { _mm_storeu_si128(reinterpret_cast<__m128i *>(units), value); }
+    static V Set1(int value) { return _mm_set1_epi32(value); }
+    static V CmpEq(V lhs, V rhs) { return _mm_cmpeq_epi32(lhs, rhs); }
+    static V CmpGt(V lhs, V rhs) { return _mm_cmpgt_epi32(lhs, rhs); }
+    static V And(V lhs, V rhs) { return _mm_and_si128(lhs, rhs); }
+    static V Xor(V lhs, V rhs) { return _mm_xor_si128(lhs, rhs); }
+    static V Add(V lhs, V rhs) { return _mm_add_epi32(lhs, rhs); }
+    static bool AnyBitSet(V value) { return _mm_movemask_epi8(_mm_cmpeq_epi8(value, _mm_setzero_si128())) != 0xFFFF; }
+};
+
+size_t NormalizeAsciiBlocksSse2(wchar_t *data, size_t length)
+{
+    if constexpr (sizeof(wchar_t) == 2)
+    {
+        return NormalizeAsciiBlocks<Sse2Ops16>(data, length);
+    }
+    else
+    {
+        return NormalizeAsciiBlocks<Sse2Ops32>(data, length);
+    }
+}
+#endif
+
+bool DetectAvx2()
+{
+#if !defined(RRIGHTCLICKRR_HAVE_AVX2_KERNEL)
+    return false;
+#elif defined(_MSC_VER)
+    int info[4] = {};
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info, 7, 0);
+    return osSavesAvx && (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+bool CpuSupportsAvx2()
+{
+    static const bool supported = DetectAvx2();
+    return supported;
+}
+
+PathNormalizeKernel SelectKernel()
+{
+    if (CpuSupportsAvx2())
+    {
+        return PathNormalizeKernel::Avx2;
+    }
+#if defined(RRIGHTCLICKRR_HAVE_SSE2_KERNEL)
+    return PathNormalizeKernel::Sse2;
+#else
+    return PathNormalizeKernel::Scalar;
+#endif
+}
+} // namespace
+
+uint32_t FoldCodePoint(uint32_t codePoint)
+{
+    if (codePoint < 0x80)
+    {
+        return (codePoint >= 'A' && codePoint <= 'Z') ? codePoint + 0x20 : codePoint;
+    }
+    if (codePoint < kCaseFoldRanges[0].first)
+    {
+        return codePoint;
+    }
+
+    // Last range starting at or before the code point.
+    size_t lo = 0;
+    size_t hi = kCaseFoldRangeCount;
+    while (hi - lo > 1)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (kCaseFoldRanges[mid].first <= codePoint)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    const CaseFoldRange &range = kCaseFoldRanges[lo];
+    if (codePoint > range.last || (codePoint - range.first) % range.stride != 0)
+    {
+        return codePoint;
+    }
+    return static_cast<uint32_t>(static_cast<int32_t>(codePoint) + range.delta);
+}
+
+size_t FoldPathSpanScalar(wchar_t *data, size_t begin, size_t end, size_t length)
+{
+    size_t i = begin;
+    while (i < end)
+    {
+        const uint32_t unit = static_cast<uint32_t>(data[i]);
+        if (unit < 0x80)
+        {
+            data[i] = FoldAsciiUnit(data[i]);
+            i++;
+            continue;
+        }
+
+        if constexpr (sizeof(wchar_t) == 2)
+        {
+            // Supplementary characters fold to supplementary characters, so
+            // a surrogate pair stays a pair.
+            if (unit >= 0xD800 && unit <= 0xDBFF && i + 1 < length)
+            {
+                const uint32_t low = static_cast<uint32_t>(data[i + 1]);
+                if (low >= 0xDC00 && low <= 0xDFFF)
+                {
+                    const uint32_t folded = FoldCodePoint(0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00)) - 0x10000;
+                    data[i] = static_cast<wchar_t>(0xD800 + (folded >> 10));
+                    data[i + 1] = static_cast<wchar_t>(0xDC00 + (folded & 0x3FF));
+                    i += 2;
+                    continue;
+                }
+            }
+            if (unit >= 0xD800 && unit <= 0xDFFF)
+            {
+                i++;
+                continue;
+            }
+        }
+
+        data[i] = static_cast<wchar_t>(FoldCodePoint(unit));
+        i++;
+    }
+    return i;
+}
+
+size_t NormalizePathInPlace(wchar_t *data, size_t length, PathNormalizeKernel kernel)
+{
+    size_t done = 0;
+    switch (IsPathNormalizeKernelSupported(kernel) ? kernel : PathNormalizeKernel::Scalar)
+    {
+#if defined(RRIGHTCLICKRR_HAVE_AVX2_KERNEL)
+    case PathNormalizeKernel::Avx2:
+        done = NormalizeAsciiBlocksAvx2(data, length);
+        break;
+#endif
+#if defined(RRIGHTCLICKRR_HAVE_SSE2_KERNEL)
+    case PathNormalizeKernel::Sse2:
+        done = NormalizeAsciiBlocksSse2(data, length);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    FoldPathSpanScalar(data, done, length, length);
+    return TrimTrailingSeparators(data, length);
+}
+
+size_t NormalizePathInPlace(wchar_t *data, size_t length)
+{
+    return NormalizePathInPlace(data, length, ActivePathNormalizeKernel());
+}
+
+PathNormalizeKernel ActivePathNormalizeKernel()
+{
+    static const PathNormalizeKernel kernel = SelectKernel();
+    return kernel;
+}
+
+bool IsPathNormalizeKernelSupported(PathNormalizeKernel kernel)
+{
+    switch (kernel)
+    {
+    case PathNormalizeKernel::Scalar:
+        return true;
+    case PathNormalizeKernel::Sse2:
+#if defined(RRIGHTCLICKRR_HAVE_SSE2_KERNEL)
+        return true;
+#else
+        return false;
+#endif
+    case PathNormalizeKernel::Avx2:
+        return CpuSupportsAvx2();
+    }
+    return false;
+}
+
+const char *PathNormalizeKernelName(PathNormalizeKernel kernel)
+{
+    switch (kernel)
+    {
+    case PathNormalizeKernel::Sse2:
+        return "sse2";
+    case PathNormalizeKernel::Avx2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+CNormalizedPath::CNormalizedPath(std::wstring_view path) : m_data(m_inline), m_length(0)
+{
+    if (path.size() > kInlineLength)
+    {
+        m_heap.reset(new wchar_t[path.size()]);
+        m_data = m_heap.get();
+    }
+
+    std::wmemcpy(m_data, path.data(), path.size());
+    m_length = NormalizePathInPlace(m_data, path.size());
+}
@@ -0,0 +1,60 @@
+// RRightclickrr path normalization kernels
+//
+// One pass that lowercases, rewrites '/' as '\' and trims trailing separators.
+// Runs of ASCII are handled with SSE2 or AVX2 (chosen at runtime); anything
+// else goes through a locale-independent table generated from JavaScript's
+// toLowerCase, so paths fold the same way SyncTracker.normalizePath folds them.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+enum class PathNormalizeKernel
+{
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+// Lowercase mapping of a single code point (one-to-one mappings only).
+uint32_t FoldCodePoint(uint32_t codePoint);
+
+// Normalizes data[0, length) in place with the fastest supported kernel and
+// returns the length after trimming.
+size_t NormalizePathInPlace(wchar_t *data, size_t length);
+
+// Same, with a specific kernel (benchmarks and differential tests). Falls back
+// to Scalar when the kernel is not supported on this CPU.
+size_t NormalizePathInPlace(wchar_t *data, size_t length, PathNormalizeKernel kernel);
+
+PathNormalizeKernel ActivePathNormalizeKernel();
+bool IsPathNormalizeKernelSupported(PathNormalizeKernel kernel);
+const char *PathNormalizeKernelName(PathNormalizeKernel kernel);
+
+// Folds data[begin, end) one code unit (or surrogate pair) at a time. A pair
+// that starts before end is folded whole, so the result may exceed end.
+size_t FoldPathSpanScalar(wchar_t *data, size_t begin, size_t end, size_t length);
+
+// Normalized copy of a path for a single lookup. Paths up to kInlineLength
+// units (the Windows long-path limit) are held inline, so a stack instance
+// never touches the heap; longer ones spill to it.
+class CNormalizedPath
+{
+public:
+    static constexpr size_t kInlineLength = 32768;
+
+    explicit CNormalizedPath(std::wstring_view path);
+    CNormalizedPath(const CNormalizedPath &) = delete;
+    CNormalizedPath &operator=(const CNormalizedPath &) = delete;
+
+    std::wstring_view View() const { return std::wstring_view(m_data, m_length); }
+
+private:
+    wchar_t m_inline[kInlineLength];
+    std::unique_ptr<wchar_t[]> m_heap;
+    wchar_t *m_data;
+    size_t m_length;
+};
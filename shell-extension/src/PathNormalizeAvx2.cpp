@@ -0,0 +1,54 @@
+// RRightclickrr AVX2 path normalization kernel
+//
+// Built with AVX2 code generation and only called after a CPU check, so keep
+// this file to the kernel itself.
+
+#include "PathNormalizeSimd.h"
+#include <immintrin.h>
+
+namespace
+{
+struct Avx2Ops16
+{
+    using V = __m256i;
+    static constexpr size_t kLanes = 16;
+
+    static V Load(const wchar_t *units) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(units)); }
+    static void Store(wchar_t *units, V value) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(units), value); }
+    static V Set1(int value) { return _mm256_set1_epi16(static_cast<short>(value)); }
+    static V CmpEq(V lhs, V rhs) { return _mm256_cmpeq_epi16(lhs, rhs); }
+    static V CmpGt(V lhs, V rhs) { return _mm256_cmpgt_epi16(lhs, rhs); }
+    static V And(V lhs, V rhs) { return _mm256_and_si256(lhs, rhs); }
+    static V Xor(V lhs, V rhs) { return _mm256_xor_si256(lhs, rhs); }
+    static V Add(V lhs, V rhs) { return _mm256_add_epi16(lhs, rhs); }
+    static bool AnyBitSet(V value) { return _mm256_testz_si256(value, value) == 0; }
+};
+
+struct Avx2Ops32
+{
+    using V = __m256i;
+    static constexpr size_t kLanes = 8;
+
+    static V Load(const wchar_t *units) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(units)); }
+    static void Store(wchar_t *units, V value) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(units), value); }
+    static V Set1(int value) { return _mm256_set1_epi32(value); }
+    static V CmpEq(V lhs, V rhs) { return _mm256_cmpeq_epi32(lhs, rhs); }
+    static V CmpGt(V lhs, V rhs) { return _mm256_cmpgt_epi32(lhs, rhs); }
+    static V And(V lhs, V rhs) { return _mm256_and_si256(lhs, rhs); }
+    static V Xor(V lhs, V rhs) { return _mm256_xor_si256(lhs, rhs); }
+    static V Add(V lhs, V rhs) { return _mm256_add_epi32(lhs, rhs); }
+    static bool AnyBitSet(V value) { return _mm256_testz_si256(value, value) == 0; }
+};
+} // namespace
+
+size_t NormalizeAsciiBlocksAvx2(wchar_t *data, size_t length)
+{
+    if constexpr (sizeof(wchar_t) == 2)
+    {
+        return NormalizeAsciiBlocks<Avx2Ops16>(data, length);
+    }
+    else
+    {
+        return NormalizeAsciiBlocks<Avx2Ops32>(data, length);
+    }
+}
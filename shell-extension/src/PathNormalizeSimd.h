@@ -0,0 +1,45 @@
+// RRightclickrr vector kernel shared by the SSE2 and AVX2 translation units
+//
+// Private to PathNormalize*.cpp. Everything here has internal linkage: the
+// AVX2 unit is compiled with AVX2 enabled, and the linker must never pick its
+// copy of a shared inline function for code that runs on older CPUs.
+
+#pragma once
+
+#include "PathNormalize.h"
+
+namespace
+{
+// Ops supplies, for one instruction set and wchar_t width: V, kLanes, Load,
+// Store, Set1, CmpEq, CmpGt, And, Xor, Add and AnyBitSet.
+template <typename Ops>
+size_t NormalizeAsciiBlocks(wchar_t *data, size_t length)
+{
+    using V = typename Ops::V;
+
+    const V nonAsciiBits = Ops::Set1(~0x7F);
+    const V beforeUpper = Ops::Set1(L'A' - 1);
+    const V afterUpper = Ops::Set1(L'Z' + 1);
+    const V caseBit = Ops::Set1(0x20);
+    const V slash = Ops::Set1(L'/');
+    const V slashToBackslash = Ops::Set1(L'/' ^ L'\\');
+
+    size_t i = 0;
+    while (i + Ops::kLanes <= length)
+    {
+        V units = Ops::Load(data + i);
+        if (Ops::AnyBitSet(Ops::And(units, nonAsciiBits)))
+        {
+            i = FoldPathSpanScalar(data, i, i + Ops::kLanes, length);
+            continue;
+        }
+
+        const V upper = Ops::And(Ops::CmpGt(units, beforeUpper), Ops::CmpGt(afterUpper, units));
+        units = Ops::Add(units, Ops::And(upper, caseBit));
+        units = Ops::Xor(units, Ops::And(Ops::CmpEq(units, slash), slashToBackslash));
+        Ops::Store(data + i, units);
+        i += Ops::kLanes;
+    }
+    return i;
+}
+} // namespace
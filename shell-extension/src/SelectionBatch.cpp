@@ -0,0 +1,67 @@
+// RRightclickrr multi-selection batches for the context menu commands
+
+#include "SelectionBatch.h"
+#include "SyncedPathMatch.h"
+#include "Utf8.h"
+#include <algorithm>
+#include <utility>
+
+std::vector<std::wstring> ReduceSelection(const std::vector<std::wstring> &paths)
+{
+    // Normalized key and selection position of every item.
+    std::vector<std::pair<std::wstring, size_t>> keys;
+    keys.reserve(paths.size());
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        std::wstring key = NormalizePath(paths[i]);
+        if (!key.empty())
+        {
+            keys.emplace_back(std::move(key), i);
+        }
+    }
+
+    // Each folder sorts right before everything beneath it; of equal paths
+    // the first selected stays in front.
+    std::stable_sort(keys.begin(), keys.end(),
+                     [](const auto &lhs, const auto &rhs) { return CoveringRootOrder(lhs.first, rhs.first); });
+
+    std::vector<size_t> kept;
+    const std::wstring *lastRoot = nullptr;
+    for (const auto &key : keys)
+    {
+        if (lastRoot && IsSameOrChildPath(key.first, *lastRoot))
+        {
+            continue;
+        }
+        kept.push_back(key.second);
+        lastRoot = &key.first;
+    }
+
+    std::sort(kept.begin(), kept.end());
+    std::vector<std::wstring> reduced;
+    reduced.reserve(kept.size());
+    for (size_t index : kept)
+    {
+        reduced.push_back(paths[index]);
+    }
+    return reduced;
+}
+
+std::string BuildBatchRequest(BatchMode mode, const std::vector<std::wstring> &paths)
+{
+    std::string request = "rrightclickrr-batch 1\nmode ";
+    switch (mode)
+    {
+    case BatchMode::Sync: request += "sync"; break;
+    case BatchMode::Copy: request += "copy"; break;
+    case BatchMode::GetUrl: request += "get-url"; break;
+    }
+    request += '\n';
+
+    for (const std::wstring &path : paths)
+    {
+        AppendWideAsUtf8(path, request);
+        request += '\n';
+    }
+    return request;
+}
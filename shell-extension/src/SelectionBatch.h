@@ -0,0 +1,31 @@
+// RRightclickrr multi-selection batches for the context menu commands
+//
+// Explorer hands Invoke every selected item. Items inside another selected
+// folder are dropped (the folder's job covers them), and the rest go to the
+// app in one response file instead of one process launch per item:
+//
+//   rrightclickrr-batch 1
+//   mode <sync|copy|get-url>
+//   <path>            one per line, UTF-8, in selection order
+//
+// Platform-independent so the bench can check it on Linux.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+enum class BatchMode
+{
+    Sync,
+    Copy,
+    GetUrl
+};
+
+// The selected paths with duplicates and anything equal to or beneath
+// another selected path removed, compared normalized; original spelling and
+// selection order are kept. O(n log n).
+std::vector<std::wstring> ReduceSelection(const std::vector<std::wstring> &paths);
+
+// Response file contents for the app's --batch flag.
+std::string BuildBatchRequest(BatchMode mode, const std::vector<std::wstring> &paths);
@@ -0,0 +1,16 @@
+// RRightclickrr sequential file reads through a caller-owned buffer
+//
+// Index files are read while the app may replace them through a rename, so
+// the Windows reader opens them with every share mode; POSIX reads stand in
+// on Linux so the loaders above can be measured by the bench.
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+// Reads file front to back in buffer-sized pieces and hands each to consume.
+// Returns false if the file cannot be opened or a read fails; consume may
+// already have seen part of it.
+bool ReadFileSequential(const std::filesystem::path &file, char *buffer, size_t bufferSize,
+                        void (*consume)(const char *data, size_t size, void *context), void *context);
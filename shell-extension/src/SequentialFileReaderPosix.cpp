@@ -0,0 +1,38 @@
+// RRightclickrr sequential file reads (POSIX)
+
+#include "SequentialFileReader.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+bool ReadFileSequential(const std::filesystem::path &file, char *buffer, size_t bufferSize,
+                        void (*consume)(const char *data, size_t size, void *context), void *context)
+{
+    const int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    bool ok = true;
+    for (;;)
+    {
+        const ssize_t read = ::read(fd, buffer, bufferSize);
+        if (read < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (read <= 0)
+        {
+            ok = read == 0;
+            break;
+        }
+        consume(buffer, static_cast<size_t>(read), context);
+    }
+    close(fd);
+    return ok;
+}
@@ -0,0 +1,33 @@
+// RRightclickrr sequential file reads (Windows)
+
+#include "SequentialFileReader.h"
+#include <windows.h>
+#include <algorithm>
+
+bool ReadFileSequential(const std::filesystem::path &file, char *buffer, size_t bufferSize,
+                        void (*consume)(const char *data, size_t size, void *context), void *context)
+{
+    HANDLE handle = CreateFileW(
+        file.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr);
+
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    const DWORD chunk = static_cast<DWORD>(std::min<size_t>(bufferSize, MAXDWORD));
+    DWORD read = 0;
+    BOOL ok = FALSE;
+    while ((ok = ReadFile(handle, buffer, chunk, &read, nullptr)) && read > 0)
+    {
+        consume(buffer, read, context);
+    }
+    CloseHandle(handle);
+    return ok != FALSE;
+}
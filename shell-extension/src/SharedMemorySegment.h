@@ -0,0 +1,56 @@
+// RRightclickrr named shared-memory segment
+//
+// The app publishes the overlay index into one named segment that every
+// process hosting the shell extension maps read-only, instead of each one
+// loading a private copy. A named file mapping in the session's local
+// namespace on Windows; POSIX shared memory elsewhere, so the protocol can be
+// exercised by the bench.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class CSharedMemorySegment
+{
+public:
+    CSharedMemorySegment() = default;
+    ~CSharedMemorySegment() { Close(); }
+    CSharedMemorySegment(const CSharedMemorySegment &) = delete;
+    CSharedMemorySegment &operator=(const CSharedMemorySegment &) = delete;
+
+    // Creates the segment with size bytes (zero-filled), or opens it
+    // read-write if it already exists, in which case Size() is its existing
+    // size and Created() is false.
+    bool Create(const std::string &name, size_t size);
+
+    // Maps an existing segment read-only.
+    bool OpenReadOnly(const std::string &name);
+
+    void Close();
+
+    bool IsOpen() const { return m_data != nullptr; }
+    bool Created() const { return m_created; }
+    void *Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+    // Deletes the name so the next Create starts a fresh segment; mappings
+    // already open stay valid. No-op on Windows, where the segment goes away
+    // with its last handle.
+    static void Remove(const std::string &name);
+
+private:
+    void *m_data = nullptr;
+    size_t m_size = 0;
+    void *m_handle = nullptr; // Windows section handle; keeps the name alive
+    bool m_created = false;
+};
+
+// Per-user segment name for the overlay index in this session.
+std::string OverlaySharedIndexSegmentName();
+
+// Per-process segment name for the shell extension's stats block
+// (ShellStats.h), and the id it is keyed by.
+std::string ShellStatsSegmentName(uint32_t processId);
+uint32_t CurrentProcessId();
@@ -0,0 +1,104 @@
+// RRightclickrr named shared-memory segment (POSIX)
+//
+// Stand-in for the Windows named file mapping so the shared index protocol
+// can be exercised by the Linux bench.
+
+#include "SharedMemorySegment.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+bool MapSegment(int fd, bool writable, void *&data, size_t &size)
+{
+    struct stat info = {};
+    if (fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        return false;
+    }
+
+    const int protection = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void *view = mmap(nullptr, static_cast<size_t>(info.st_size), protection, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED)
+    {
+        return false;
+    }
+
+    data = view;
+    size = static_cast<size_t>(info.st_size);
+    return true;
+}
+} // namespace
+
+bool CSharedMemorySegment::Create(const std::string &name, size_t size)
+{
+    Close();
+
+    m_created = true;
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+    {
+        m_created = false;
+        fd = shm_open(name.c_str(), O_RDWR, 0600);
+    }
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    const bool ok = (!m_created || ftruncate(fd, static_cast<off_t>(size)) == 0) && MapSegment(fd, true, m_data, m_size);
+    close(fd);
+    if (!ok && m_created)
+    {
+        shm_unlink(name.c_str());
+    }
+    return ok;
+}
+
+bool CSharedMemorySegment::OpenReadOnly(const std::string &name)
+{
+    Close();
+
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    const bool ok = MapSegment(fd, false, m_data, m_size);
+    close(fd);
+    return ok;
+}
+
+void CSharedMemorySegment::Close()
+{
+    if (m_data)
+    {
+        munmap(m_data, m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_created = false;
+}
+
+void CSharedMemorySegment::Remove(const std::string &name)
+{
+    shm_unlink(name.c_str());
+}
+
+std::string OverlaySharedIndexSegmentName()
+{
+    return "/rrightclickrr-overlay-" + std::to_string(getuid());
+}
+
+std::string ShellStatsSegmentName(uint32_t processId)
+{
+    return "/rrightclickrr-shell-stats-" + std::to_string(processId);
+}
+
+uint32_t CurrentProcessId()
+{
+    return static_cast<uint32_t>(getpid());
+}
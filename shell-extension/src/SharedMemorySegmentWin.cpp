@@ -0,0 +1,110 @@
+// RRightclickrr named shared-memory segment (Windows)
+
+#include "SharedMemorySegment.h"
+#include <windows.h>
+
+namespace
+{
+std::wstring WideName(const std::string &name)
+{
+    // Segment names are ASCII.
+    return std::wstring(name.begin(), name.end());
+}
+
+bool MapSection(HANDLE section, DWORD access, void *&data, size_t &size)
+{
+    void *view = MapViewOfFile(section, access, 0, 0, 0);
+    if (!view)
+    {
+        return false;
+    }
+
+    // The view spans the whole section, rounded up to pages.
+    MEMORY_BASIC_INFORMATION info = {};
+    if (VirtualQuery(view, &info, sizeof(info)) == 0)
+    {
+        UnmapViewOfFile(view);
+        return false;
+    }
+
+    data = view;
+    size = info.RegionSize;
+    return true;
+}
+} // namespace
+
+bool CSharedMemorySegment::Create(const std::string &name, size_t size)
+{
+    Close();
+
+    const ULONGLONG size64 = size;
+    HANDLE section = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(size64 >> 32),
+                                        static_cast<DWORD>(size64), WideName(name).c_str());
+    if (!section)
+    {
+        return false;
+    }
+    m_created = GetLastError() != ERROR_ALREADY_EXISTS;
+
+    if (!MapSection(section, FILE_MAP_READ | FILE_MAP_WRITE, m_data, m_size))
+    {
+        CloseHandle(section);
+        m_created = false;
+        return false;
+    }
+    m_handle = section;
+    return true;
+}
+
+bool CSharedMemorySegment::OpenReadOnly(const std::string &name)
+{
+    Close();
+
+    HANDLE section = OpenFileMappingW(FILE_MAP_READ, FALSE, WideName(name).c_str());
+    if (!section)
+    {
+        return false;
+    }
+
+    // The view keeps the section alive; readers need no handle.
+    const bool ok = MapSection(section, FILE_MAP_READ, m_data, m_size);
+    CloseHandle(section);
+    return ok;
+}
+
+void CSharedMemorySegment::Close()
+{
+    if (m_data)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_handle)
+    {
+        CloseHandle(m_handle);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_handle = nullptr;
+    m_created = false;
+}
+
+void CSharedMemorySegment::Remove(const std::string &name)
+{
+    (void)name;
+}
+
+std::string OverlaySharedIndexSegmentName()
+{
+    // Local\ is per session, so each user on a terminal server gets their own.
+    return "Local\\RRightclickrrOverlayIndex";
+}
+
+std::string ShellStatsSegmentName(uint32_t processId)
+{
+    return "Local\\RRightclickrrShellStats-" + std::to_string(processId);
+}
+
+uint32_t CurrentProcessId()
+{
+    return GetCurrentProcessId();
+}
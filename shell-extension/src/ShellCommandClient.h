@@ -0,0 +1,29 @@
+// RRightclickrr shell command client
+//
+// Sends one ShellCommandProtocol request to the app's command endpoint: a
+// per-user named pipe on Windows, a Unix socket elsewhere so the bench can
+// time it against a stand-in server (ShellCommandServer.h).
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class ShellCommandResult
+{
+    Accepted,
+    Rejected, // The app answered but will not take the command
+    NoServer, // Nothing listening; the app is not running
+    TimedOut, // Connected, but no answer within the timeout
+    Untrusted, // The endpoint is owned by another user; nothing was sent
+    Failed,
+};
+
+// Connects, writes the frame and waits for the reply, all within timeoutMs.
+// Anything but Accepted means the app has not taken the command.
+ShellCommandResult SendShellCommand(const std::string &endpoint, const std::vector<uint8_t> &frame, uint32_t timeoutMs);
+
+// The running app's endpoint for this user: \\.\pipe\rrightclickrr-shell-<SID>
+// on Windows, a socket in XDG_RUNTIME_DIR (or /tmp) elsewhere.
+std::string ShellCommandEndpoint();
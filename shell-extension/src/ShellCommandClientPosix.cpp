@@ -0,0 +1,159 @@
+// RRightclickrr shell command client (POSIX)
+//
+// Unix-socket stand-in for the Windows named pipe, so the protocol and its
+// timeouts can be exercised by the Linux bench.
+
+#include "ShellCommandClient.h"
+#include "ShellCommandProtocol.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Milliseconds left before the deadline, for poll.
+int Remaining(Clock::time_point deadline)
+{
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+    return left > 0 ? static_cast<int>(left) : 0;
+}
+
+bool WaitFor(int fd, short events, Clock::time_point deadline)
+{
+    pollfd entry = {fd, events, 0};
+    for (;;)
+    {
+        const int ready = poll(&entry, 1, Remaining(deadline));
+        if (ready > 0)
+        {
+            return true;
+        }
+        if (ready == 0 || errno != EINTR)
+        {
+            return false;
+        }
+    }
+}
+
+class CSocket
+{
+public:
+    explicit CSocket(int fd) : m_fd(fd) {}
+    ~CSocket()
+    {
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+        }
+    }
+    CSocket(const CSocket &) = delete;
+    CSocket &operator=(const CSocket &) = delete;
+
+    int Get() const { return m_fd; }
+
+private:
+    int m_fd;
+};
+} // namespace
+
+ShellCommandResult SendShellCommand(const std::string &endpoint, const std::vector<uint8_t> &frame, uint32_t timeoutMs)
+{
+    const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (endpoint.empty() || endpoint.size() >= sizeof(address.sun_path))
+    {
+        return ShellCommandResult::Failed;
+    }
+    std::memcpy(address.sun_path, endpoint.data(), endpoint.size());
+
+    CSocket socket(::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+    if (socket.Get() < 0)
+    {
+        return ShellCommandResult::Failed;
+    }
+
+    while (connect(socket.Get(), reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+    {
+        if (errno == ENOENT || errno == ECONNREFUSED)
+        {
+            return ShellCommandResult::NoServer;
+        }
+        // EAGAIN is a full backlog: the server exists but is not accepting.
+        if (errno != EAGAIN)
+        {
+            return ShellCommandResult::Failed;
+        }
+        if (Remaining(deadline) == 0)
+        {
+            return ShellCommandResult::TimedOut;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    size_t written = 0;
+    while (written < frame.size())
+    {
+        const ssize_t sent = send(socket.Get(), frame.data() + written, frame.size() - written, MSG_NOSIGNAL);
+        if (sent > 0)
+        {
+            written += static_cast<size_t>(sent);
+            continue;
+        }
+        if (sent < 0 && errno != EAGAIN && errno != EINTR)
+        {
+            return ShellCommandResult::Failed;
+        }
+        if (!WaitFor(socket.Get(), POLLOUT, deadline))
+        {
+            return ShellCommandResult::TimedOut;
+        }
+    }
+
+    ShellCommandReply reply;
+    auto *bytes = reinterpret_cast<uint8_t *>(&reply);
+    size_t received = 0;
+    while (received < sizeof(reply))
+    {
+        const ssize_t count = recv(socket.Get(), bytes + received, sizeof(reply) - received, 0);
+        if (count > 0)
+        {
+            received += static_cast<size_t>(count);
+            continue;
+        }
+        if (count == 0 || (errno != EAGAIN && errno != EINTR))
+        {
+            return ShellCommandResult::Failed;
+        }
+        if (!WaitFor(socket.Get(), POLLIN, deadline))
+        {
+            return ShellCommandResult::TimedOut;
+        }
+    }
+
+    ShellCommandStatus status;
+    if (!ReadShellCommandReply(&reply, sizeof(reply), status))
+    {
+        return ShellCommandResult::Failed;
+    }
+    return status == ShellCommandStatus::Accepted ? ShellCommandResult::Accepted : ShellCommandResult::Rejected;
+}
+
+std::string ShellCommandEndpoint()
+{
+    const char *runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime)
+    {
+        return std::string(runtime) + "/rrightclickrr-shell.sock";
+    }
+    return "/tmp/rrightclickrr-shell-" + std::to_string(getuid()) + ".sock";
+}
@@ -0,0 +1,188 @@
+// RRightclickrr shell command client (Windows named pipe)
+
+#include "ShellCommandClient.h"
+#include "ShellCommandProtocol.h"
+#include "Utf8.h"
+#include <windows.h>
+#include <sddl.h>
+#include <vector>
+
+#pragma comment(lib, "advapi32.lib")
+
+namespace
+{
+DWORD Remaining(ULONGLONG deadline)
+{
+    const ULONGLONG now = GetTickCount64();
+    return now < deadline ? static_cast<DWORD>(deadline - now) : 0;
+}
+
+// Moves size bytes through overlapped I/O, giving up at the deadline. Any
+// operation still pending then is cancelled before the buffer goes away.
+// Accepted here just means every byte moved.
+ShellCommandResult Transfer(HANDLE pipe, bool write, uint8_t *data, DWORD size, ULONGLONG deadline)
+{
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!overlapped.hEvent)
+    {
+        return ShellCommandResult::Failed;
+    }
+
+    ShellCommandResult result = ShellCommandResult::Accepted;
+    DWORD done = 0;
+    while (done < size && result == ShellCommandResult::Accepted)
+    {
+        ResetEvent(overlapped.hEvent);
+        const BOOL started = write ? WriteFile(pipe, data + done, size - done, nullptr, &overlapped)
+                                   : ReadFile(pipe, data + done, size - done, nullptr, &overlapped);
+        if (!started && GetLastError() != ERROR_IO_PENDING)
+        {
+            result = ShellCommandResult::Failed;
+            break;
+        }
+
+        DWORD transferred = 0;
+        if (WaitForSingleObject(overlapped.hEvent, Remaining(deadline)) != WAIT_OBJECT_0)
+        {
+            CancelIoEx(pipe, &overlapped);
+            GetOverlappedResult(pipe, &overlapped, &transferred, TRUE);
+            result = ShellCommandResult::TimedOut;
+        }
+        else if (!GetOverlappedResult(pipe, &overlapped, &transferred, FALSE) || transferred == 0)
+        {
+            result = ShellCommandResult::Failed;
+        }
+        done += transferred;
+    }
+
+    CloseHandle(overlapped.hEvent);
+    return result;
+}
+
+// The TOKEN_USER of a token; its SID points into the returned buffer.
+std::vector<BYTE> TokenUserOf(HANDLE token)
+{
+    DWORD size = 0;
+    GetTokenInformation(token, TokenUser, nullptr, 0, &size);
+    std::vector<BYTE> buffer(size);
+    if (size == 0 || !GetTokenInformation(token, TokenUser, buffer.data(), size, &size))
+    {
+        buffer.clear();
+    }
+    return buffer;
+}
+
+std::vector<BYTE> ProcessUser(HANDLE process)
+{
+    std::vector<BYTE> user;
+    HANDLE token;
+    if (OpenProcessToken(process, TOKEN_QUERY, &token))
+    {
+        user = TokenUserOf(token);
+        CloseHandle(token);
+    }
+    return user;
+}
+
+PSID SidOf(std::vector<BYTE> &user)
+{
+    return user.empty() ? nullptr : reinterpret_cast<TOKEN_USER *>(user.data())->User.Sid;
+}
+
+// The pipe name is public, so another user could create it first. Only a
+// server running as the caller's own user is handed any paths.
+bool ServerIsSameUser(HANDLE pipe)
+{
+    ULONG serverId = 0;
+    if (!GetNamedPipeServerProcessId(pipe, &serverId))
+    {
+        return false;
+    }
+    HANDLE server = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, serverId);
+    if (!server)
+    {
+        return false;
+    }
+    std::vector<BYTE> serverUser = ProcessUser(server);
+    CloseHandle(server);
+    std::vector<BYTE> callerUser = ProcessUser(GetCurrentProcess());
+
+    PSID serverSid = SidOf(serverUser);
+    PSID callerSid = SidOf(callerUser);
+    return serverSid && callerSid && EqualSid(serverSid, callerSid);
+}
+} // namespace
+
+ShellCommandResult SendShellCommand(const std::string &endpoint, const std::vector<uint8_t> &frame, uint32_t timeoutMs)
+{
+    const ULONGLONG deadline = GetTickCount64() + timeoutMs;
+    std::wstring name;
+    AppendUtf8AsWide(endpoint, name);
+
+    // SECURITY_IDENTIFICATION: whoever owns the pipe may identify the caller
+    // but never impersonate it.
+    HANDLE pipe;
+    for (;;)
+    {
+        pipe = CreateFileW(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING,
+                           FILE_FLAG_OVERLAPPED | SECURITY_SQOS_PRESENT | SECURITY_IDENTIFICATION, nullptr);
+        if (pipe != INVALID_HANDLE_VALUE)
+        {
+            break;
+        }
+        if (GetLastError() != ERROR_PIPE_BUSY)
+        {
+            return ShellCommandResult::NoServer;
+        }
+        // Every instance is busy; wait for the server to post another.
+        const DWORD wait = Remaining(deadline);
+        if (wait == 0 || !WaitNamedPipeW(name.c_str(), wait))
+        {
+            return ShellCommandResult::TimedOut;
+        }
+    }
+
+    if (!ServerIsSameUser(pipe))
+    {
+        CloseHandle(pipe);
+        return ShellCommandResult::Untrusted;
+    }
+
+    // WriteFile only reads the buffer.
+    ShellCommandResult result =
+        Transfer(pipe, true, const_cast<uint8_t *>(frame.data()), static_cast<DWORD>(frame.size()), deadline);
+
+    ShellCommandReply reply = {};
+    if (result == ShellCommandResult::Accepted)
+    {
+        result = Transfer(pipe, false, reinterpret_cast<uint8_t *>(&reply), sizeof(reply), deadline);
+    }
+    CloseHandle(pipe);
+    if (result != ShellCommandResult::Accepted)
+    {
+        return result;
+    }
+
+    ShellCommandStatus status;
+    if (!ReadShellCommandReply(&reply, sizeof(reply), status))
+    {
+        return ShellCommandResult::Failed;
+    }
+    return status == ShellCommandStatus::Accepted ? ShellCommandResult::Accepted : ShellCommandResult::Rejected;
+}
+
+std::string ShellCommandEndpoint()
+{
+    // Per user, matching the name the app listens on (the SID from whoami /user).
+    std::string endpoint = "\\\\.\\pipe\\rrightclickrr-shell";
+    std::vector<BYTE> user = ProcessUser(GetCurrentProcess());
+    LPWSTR sid = nullptr;
+    if (SidOf(user) && ConvertSidToStringSidW(SidOf(user), &sid))
+    {
+        endpoint += '-';
+        AppendWideAsUtf8(std::wstring_view(sid), endpoint);
+        LocalFree(sid);
+    }
+    return endpoint;
+}
@@ -0,0 +1,109 @@
+// RRightclickrr shell command protocol
+
+#include "ShellCommandProtocol.h"
+#include "Utf8.h"
+#include <cstring>
+
+namespace
+{
+void AppendBytes(std::vector<uint8_t> &out, const void *data, size_t size)
+{
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+bool KnownMode(uint16_t mode)
+{
+    return mode <= static_cast<uint16_t>(BatchMode::GetUrl);
+}
+} // namespace
+
+std::vector<uint8_t> EncodeShellCommand(BatchMode mode, const std::vector<std::wstring> &paths)
+{
+    std::vector<uint8_t> frame(sizeof(ShellCommandHeader), 0);
+    std::string utf8;
+    for (const std::wstring &path : paths)
+    {
+        utf8.clear();
+        AppendWideAsUtf8(path, utf8);
+        const uint32_t length = static_cast<uint32_t>(utf8.size());
+        AppendBytes(frame, &length, sizeof(length));
+        AppendBytes(frame, utf8.data(), utf8.size());
+    }
+
+    ShellCommandHeader header = {};
+    header.magic = kShellCommandMagic;
+    header.version = kShellCommandVersion;
+    header.mode = static_cast<uint16_t>(mode);
+    header.pathCount = static_cast<uint32_t>(paths.size());
+    header.payloadBytes = static_cast<uint32_t>(frame.size() - sizeof(header));
+    std::memcpy(frame.data(), &header, sizeof(header));
+    return frame;
+}
+
+bool ReadShellCommandHeader(const void *data, size_t size, ShellCommandHeader &header)
+{
+    if (!data || size < sizeof(ShellCommandHeader))
+    {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    return header.magic == kShellCommandMagic && header.version == kShellCommandVersion && KnownMode(header.mode) &&
+           header.payloadBytes <= kShellCommandMaxPayload &&
+           static_cast<uint64_t>(header.pathCount) * sizeof(uint32_t) <= header.payloadBytes;
+}
+
+bool DecodeShellCommand(const void *data, size_t size, ShellCommandRequest &request)
+{
+    ShellCommandHeader header;
+    if (!ReadShellCommandHeader(data, size, header) || size != sizeof(header) + header.payloadBytes)
+    {
+        return false;
+    }
+
+    const auto *cursor = static_cast<const uint8_t *>(data) + sizeof(header);
+    size_t remaining = header.payloadBytes;
+    request.mode = static_cast<BatchMode>(header.mode);
+    request.paths.clear();
+    request.paths.reserve(header.pathCount);
+    for (uint32_t i = 0; i < header.pathCount; i++)
+    {
+        uint32_t length;
+        if (remaining < sizeof(length))
+        {
+            return false;
+        }
+        std::memcpy(&length, cursor, sizeof(length));
+        cursor += sizeof(length);
+        remaining -= sizeof(length);
+        if (length == 0 || length > remaining)
+        {
+            return false;
+        }
+        request.paths.emplace_back(reinterpret_cast<const char *>(cursor), length);
+        cursor += length;
+        remaining -= length;
+    }
+    return remaining == 0;
+}
+
+ShellCommandReply MakeShellCommandReply(ShellCommandStatus status)
+{
+    return ShellCommandReply{kShellCommandReplyMagic, static_cast<uint32_t>(status)};
+}
+
+bool ReadShellCommandReply(const void *data, size_t size, ShellCommandStatus &status)
+{
+    ShellCommandReply reply;
+    if (!data || size != sizeof(reply))
+    {
+        return false;
+    }
+    std::memcpy(&reply, data, sizeof(reply));
+    if (reply.magic != kShellCommandReplyMagic || reply.status > static_cast<uint32_t>(ShellCommandStatus::Rejected))
+    {
+        return false;
+    }
+    status = static_cast<ShellCommandStatus>(reply.status);
+    return true;
+}
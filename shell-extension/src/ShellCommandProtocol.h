@@ -0,0 +1,69 @@
+// RRightclickrr shell command protocol
+//
+// Invoke hands a command to a running app over a local pipe instead of
+// starting a second app process that forwards it. One request per
+// connection (little-endian):
+//
+//   ShellCommandHeader (16 bytes)
+//   pathCount x { uint32 byteLength, UTF-8 bytes }
+//
+// The app answers with a ShellCommandReply as soon as it has queued the
+// command, before doing the work, so the shell waits only for the hand-off.
+//
+// Platform-independent so the bench can check it on Linux.
+
+#pragma once
+
+#include "SelectionBatch.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr uint32_t kShellCommandMagic = 0x51435252;      // "RRCQ"
+constexpr uint32_t kShellCommandReplyMagic = 0x41435252; // "RRCA"
+constexpr uint16_t kShellCommandVersion = 1;
+constexpr uint32_t kShellCommandMaxPayload = 16 * 1024 * 1024;
+
+struct ShellCommandHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t mode;         // BatchMode
+    uint32_t pathCount;
+    uint32_t payloadBytes; // Everything after the header
+};
+static_assert(sizeof(ShellCommandHeader) == 16, "ShellCommandHeader layout is part of the protocol");
+
+enum class ShellCommandStatus : uint32_t
+{
+    Accepted,
+    Rejected, // Malformed, or the app cannot take commands right now
+};
+
+struct ShellCommandReply
+{
+    uint32_t magic;
+    uint32_t status; // ShellCommandStatus
+};
+static_assert(sizeof(ShellCommandReply) == 8, "ShellCommandReply layout is part of the protocol");
+
+struct ShellCommandRequest
+{
+    BatchMode mode = BatchMode::Sync;
+    std::vector<std::string> paths; // UTF-8
+};
+
+// Complete request frame for the selected paths.
+std::vector<uint8_t> EncodeShellCommand(BatchMode mode, const std::vector<std::wstring> &paths);
+
+// Reads the header at the front of a frame, so a server knows how many
+// payload bytes follow. False if it is not one this version understands.
+bool ReadShellCommandHeader(const void *data, size_t size, ShellCommandHeader &header);
+
+// Decodes a complete frame. Rejects anything whose lengths do not add up
+// exactly or that holds an empty path.
+bool DecodeShellCommand(const void *data, size_t size, ShellCommandRequest &request);
+
+ShellCommandReply MakeShellCommandReply(ShellCommandStatus status);
+bool ReadShellCommandReply(const void *data, size_t size, ShellCommandStatus &status);
@@ -0,0 +1,52 @@
+// RRightclickrr shell command server (POSIX stand-in)
+//
+// The app's pipe server lives in src/lib/shell-ipc.js. This Unix-socket
+// server plays its part on Linux so the bench can time the client against
+// it, feed it malformed frames and check that timeouts hold.
+
+#pragma once
+
+#include "ShellCommandProtocol.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+class CShellCommandServer
+{
+public:
+    // Runs on the server thread, one request at a time. The reply is sent
+    // after it returns, so it should only queue the work, as the app does.
+    using Handler = std::function<ShellCommandStatus(const ShellCommandRequest &)>;
+
+    CShellCommandServer() = default;
+    ~CShellCommandServer() { Stop(); }
+    CShellCommandServer(const CShellCommandServer &) = delete;
+    CShellCommandServer &operator=(const CShellCommandServer &) = delete;
+
+    // Listens on endpoint. A socket file left by a server that is gone is
+    // replaced; one another server still answers on is not.
+    bool Start(const std::string &endpoint, Handler handler);
+
+    // Stops accepting, abandons a half-read request and removes the endpoint.
+    void Stop();
+
+    bool IsRunning() const { return m_running.load(std::memory_order_acquire); }
+    uint64_t RequestCount() const { return m_requests.load(std::memory_order_relaxed); }
+    uint64_t MalformedCount() const { return m_malformed.load(std::memory_order_relaxed); }
+
+private:
+    void Run();
+    void Serve(int client);
+    bool ReadExact(int client, void *data, size_t size);
+
+    std::string m_endpoint;
+    Handler m_handler;
+    int m_listenFd = -1;
+    int m_wakeFds[2] = {-1, -1};
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<uint64_t> m_requests{0};
+    std::atomic<uint64_t> m_malformed{0};
+};
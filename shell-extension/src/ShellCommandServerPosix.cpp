@@ -0,0 +1,186 @@
+// RRightclickrr shell command server (POSIX stand-in)
+
+#include "ShellCommandServer.h"
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+// How long a connected client gets to deliver its request.
+constexpr int kClientTimeoutMs = 1000;
+
+bool MakeAddress(const std::string &endpoint, sockaddr_un &address)
+{
+    address = {};
+    address.sun_family = AF_UNIX;
+    if (endpoint.empty() || endpoint.size() >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    std::memcpy(address.sun_path, endpoint.data(), endpoint.size());
+    return true;
+}
+
+// True if a server still accepts connections on the socket file.
+bool EndpointInUse(const sockaddr_un &address)
+{
+    const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0)
+    {
+        return true;
+    }
+    const bool inUse = connect(probe, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0;
+    close(probe);
+    return inUse;
+}
+} // namespace
+
+bool CShellCommandServer::Start(const std::string &endpoint, Handler handler)
+{
+    Stop();
+
+    sockaddr_un address;
+    if (!handler || !MakeAddress(endpoint, address))
+    {
+        return false;
+    }
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0)
+    {
+        return false;
+    }
+    bool bound = bind(m_listenFd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0;
+    if (!bound && errno == EADDRINUSE && !EndpointInUse(address))
+    {
+        unlink(endpoint.c_str());
+        bound = bind(m_listenFd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0;
+    }
+    if (!bound || listen(m_listenFd, 16) != 0 || pipe(m_wakeFds) != 0)
+    {
+        if (bound)
+        {
+            unlink(endpoint.c_str());
+        }
+        close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+
+    m_endpoint = endpoint;
+    m_handler = std::move(handler);
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&CShellCommandServer::Run, this);
+    return true;
+}
+
+void CShellCommandServer::Stop()
+{
+    if (!m_thread.joinable())
+    {
+        return;
+    }
+
+    m_running.store(false, std::memory_order_release);
+    const char wake = 1;
+    (void)!write(m_wakeFds[1], &wake, sizeof(wake));
+    m_thread.join();
+
+    close(m_listenFd);
+    close(m_wakeFds[0]);
+    close(m_wakeFds[1]);
+    m_listenFd = -1;
+    m_wakeFds[0] = m_wakeFds[1] = -1;
+    unlink(m_endpoint.c_str());
+    m_endpoint.clear();
+    m_handler = nullptr;
+}
+
+void CShellCommandServer::Run()
+{
+    while (m_running.load(std::memory_order_acquire))
+    {
+        pollfd fds[2] = {{m_wakeFds[0], POLLIN, 0}, {m_listenFd, POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0 && errno != EINTR)
+        {
+            break;
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            break;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            const int client = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client >= 0)
+            {
+                Serve(client);
+                close(client);
+            }
+        }
+    }
+}
+
+void CShellCommandServer::Serve(int client)
+{
+    std::vector<uint8_t> frame(sizeof(ShellCommandHeader));
+    ShellCommandHeader header;
+    if (!ReadExact(client, frame.data(), frame.size()))
+    {
+        return;
+    }
+
+    ShellCommandRequest request;
+    bool valid = ReadShellCommandHeader(frame.data(), frame.size(), header);
+    if (valid)
+    {
+        frame.resize(sizeof(header) + header.payloadBytes);
+        valid = ReadExact(client, frame.data() + sizeof(header), header.payloadBytes) &&
+                DecodeShellCommand(frame.data(), frame.size(), request);
+    }
+
+    ShellCommandStatus status = ShellCommandStatus::Rejected;
+    if (valid)
+    {
+        m_requests.fetch_add(1, std::memory_order_relaxed);
+        status = m_handler(request);
+    }
+    else
+    {
+        m_malformed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const ShellCommandReply reply = MakeShellCommandReply(status);
+    (void)!send(client, &reply, sizeof(reply), MSG_NOSIGNAL);
+}
+
+bool CShellCommandServer::ReadExact(int client, void *data, size_t size)
+{
+    auto *bytes = static_cast<uint8_t *>(data);
+    size_t received = 0;
+    while (received < size)
+    {
+        pollfd fds[2] = {{m_wakeFds[0], POLLIN, 0}, {client, POLLIN, 0}};
+        const int ready = poll(fds, 2, kClientTimeoutMs);
+        if (ready < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (ready <= 0 || (fds[0].revents & POLLIN))
+        {
+            return false;
+        }
+
+        const ssize_t count = recv(client, bytes + received, size - received, 0);
+        if (count <= 0)
+        {
+            return false;
+        }
+        received += static_cast<size_t>(count);
+    }
+    return true;
+}
@@ -0,0 +1,218 @@
+// RRightclickrr shell extension hot-path statistics
+
+#include "ShellStats.h"
+#include "SharedMemorySegment.h"
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+constexpr const char *kCounterNames[] = {
+    "is_member_of_calls", "overlay_lookups", "last_query_hits", "parent_memo_hits",
+    "parent_memo_misses", "torn_lookups",    "reloads",         "reloads_published",
+    "reloads_skipped",    "reloads_coalesced", "cold_start_answers", "get_state_calls",
+    "invoke_calls",       "invoke_failures",   "invokes_coalesced",  "links_copied",
+    "link_index_misses",  "piped_commands",    "pipe_fallbacks",
+};
+constexpr const char *kTimerNames[] = {
+    "is_member_of", "get_state", "invoke", "dispatch", "reload", "reload_lock_wait", "publish_wait",
+};
+constexpr const char *kGaugeNames[] = {
+    "index_source", "source_paths", "covering_roots", "index_bytes", "snapshot_generation", "last_reload_ns",
+};
+static_assert(sizeof(kCounterNames) / sizeof(kCounterNames[0]) == kShellCounterCount, "One name per counter");
+static_assert(sizeof(kTimerNames) / sizeof(kTimerNames[0]) == kShellTimerCount, "One name per timer");
+static_assert(sizeof(kGaugeNames) / sizeof(kGaugeNames[0]) == kShellGaugeCount, "One name per gauge");
+
+// Layout fields a reader checks before summing the slots.
+bool HeaderUsable(const ShellStatsHeader *header, size_t size)
+{
+    return size >= CShellStats::kBlockSize && header->magic.load(std::memory_order_acquire) == kShellStatsMagic &&
+           header->version == kShellStatsVersion && header->headerSize == sizeof(ShellStatsHeader) &&
+           header->slotSize == sizeof(ShellStatsSlot) && header->slotCount == kShellStatsSlotCount &&
+           header->counterCount == kShellCounterCount && header->timerCount == kShellTimerCount &&
+           header->bucketCount == kShellStatsBucketCount && header->gaugeCount == kShellGaugeCount;
+}
+
+std::atomic<uint64_t> g_nextInstance{1};
+} // namespace
+
+const char *ShellCounterName(ShellCounter counter)
+{
+    const size_t index = static_cast<size_t>(counter);
+    return index < kShellCounterCount ? kCounterNames[index] : "unknown";
+}
+
+const char *ShellTimerName(ShellTimer timer)
+{
+    const size_t index = static_cast<size_t>(timer);
+    return index < kShellTimerCount ? kTimerNames[index] : "unknown";
+}
+
+const char *ShellGaugeName(ShellGauge gauge)
+{
+    const size_t index = static_cast<size_t>(gauge);
+    return index < kShellGaugeCount ? kGaugeNames[index] : "unknown";
+}
+
+size_t ShellLatencyBucket(uint64_t ns)
+{
+    if (ns == 0)
+    {
+        return 0;
+    }
+#if defined(_MSC_VER)
+    unsigned long highest = 0;
+    _BitScanReverse64(&highest, ns);
+    const size_t bucket = static_cast<size_t>(highest) + 1;
+#else
+    const size_t bucket = static_cast<size_t>(64 - __builtin_clzll(ns));
+#endif
+    return bucket < kShellStatsBucketCount ? bucket : kShellStatsBucketCount - 1;
+}
+
+uint64_t ShellLatency::PercentileNs(double percent) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    // Nearest rank, as the bench reports it.
+    uint64_t rank = static_cast<uint64_t>(percent / 100.0 * static_cast<double>(count) + 0.999999);
+    rank = rank == 0 ? 1 : (rank > count ? count : rank);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < kShellStatsBucketCount; bucket++)
+    {
+        seen += buckets[bucket];
+        if (seen >= rank)
+        {
+            return bucket == 0 ? 0 : (uint64_t(1) << bucket) - 1;
+        }
+    }
+    return (uint64_t(1) << (kShellStatsBucketCount - 1)) - 1;
+}
+
+bool ReadShellStats(const void *data, size_t size, ShellStatsSnapshot &snapshot)
+{
+    snapshot = ShellStatsSnapshot();
+    const auto *header = static_cast<const ShellStatsHeader *>(data);
+    if (!data || size < sizeof(ShellStatsHeader) || !HeaderUsable(header, size))
+    {
+        return false;
+    }
+
+    snapshot.processId = header->processId;
+    for (size_t gauge = 0; gauge < kShellGaugeCount; gauge++)
+    {
+        snapshot.gauges[gauge] = header->gauges[gauge].load(std::memory_order_relaxed);
+    }
+
+    const auto *slots =
+        reinterpret_cast<const ShellStatsSlot *>(static_cast<const uint8_t *>(data) + CShellStats::kSlotOffset);
+    for (size_t index = 0; index < kShellStatsSlotCount; index++)
+    {
+        const ShellStatsSlot &slot = slots[index];
+        for (size_t counter = 0; counter < kShellCounterCount; counter++)
+        {
+            snapshot.counters[counter] += slot.counters[counter].load(std::memory_order_relaxed);
+        }
+        for (size_t timer = 0; timer < kShellTimerCount; timer++)
+        {
+            ShellLatency &latency = snapshot.timers[timer];
+            latency.totalNs += slot.totalNs[timer].load(std::memory_order_relaxed);
+            for (size_t bucket = 0; bucket < kShellStatsBucketCount; bucket++)
+            {
+                const uint64_t hits = slot.buckets[timer][bucket].load(std::memory_order_relaxed);
+                latency.buckets[bucket] += hits;
+                latency.count += hits;
+            }
+        }
+    }
+    return true;
+}
+
+bool CShellStats::Attach(void *data, size_t size, uint32_t processId)
+{
+    m_header = nullptr;
+    m_slots = nullptr;
+    if (!data || size < kBlockSize)
+    {
+        return false;
+    }
+
+    auto *header = static_cast<ShellStatsHeader *>(data);
+    header->magic.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memset(static_cast<uint8_t *>(data) + sizeof(header->magic), 0, kBlockSize - sizeof(header->magic));
+    header->version = kShellStatsVersion;
+    header->headerSize = sizeof(ShellStatsHeader);
+    header->slotSize = sizeof(ShellStatsSlot);
+    header->slotCount = kShellStatsSlotCount;
+    header->counterCount = kShellCounterCount;
+    header->timerCount = kShellTimerCount;
+    header->bucketCount = kShellStatsBucketCount;
+    header->gaugeCount = kShellGaugeCount;
+    header->processId = processId;
+    header->magic.store(kShellStatsMagic, std::memory_order_release);
+
+    m_slots = reinterpret_cast<ShellStatsSlot *>(static_cast<uint8_t *>(data) + kSlotOffset);
+    m_instance = g_nextInstance.fetch_add(1, std::memory_order_relaxed);
+    m_nextSlot.store(0, std::memory_order_relaxed);
+    m_header = header;
+    return true;
+}
+
+bool CShellStats::Read(ShellStatsSnapshot &snapshot) const
+{
+    return m_header && ReadShellStats(m_header, kBlockSize, snapshot);
+}
+
+void CShellStats::Claim(ThreadSlot &cached)
+{
+    // Slots are never given back: a thread's counts stay in the total after
+    // it exits, and Explorer keeps few threads calling in.
+    const size_t next = m_nextSlot.fetch_add(1, std::memory_order_relaxed);
+    cached.instance = m_instance;
+    cached.shared = next >= kShellStatsSlotCount - 1;
+    cached.slot = &m_slots[cached.shared ? kShellStatsSlotCount - 1 : next];
+}
+
+CShellStats &ProcessShellStats()
+{
+    struct ProcessStats
+    {
+        CSharedMemorySegment segment;
+        std::string name;
+        CShellStats stats;
+        alignas(64) uint8_t fallback[CShellStats::kBlockSize];
+
+        ProcessStats()
+        {
+            const uint32_t processId = CurrentProcessId();
+            name = ShellStatsSegmentName(processId);
+            // The name is per process, so a segment that already exists was
+            // left by an earlier process with the same id; start it over.
+            if (!segment.Create(name, CShellStats::kBlockSize) || !stats.Attach(segment.Data(), segment.Size(), processId))
+            {
+                segment.Close();
+                stats.Attach(fallback, sizeof(fallback), processId);
+            }
+        }
+
+        ~ProcessStats()
+        {
+            if (segment.IsOpen())
+            {
+                segment.Close();
+                CSharedMemorySegment::Remove(name);
+            }
+        }
+    };
+
+    static ProcessStats process;
+    return process.stats;
+}
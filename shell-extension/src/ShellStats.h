@@ -0,0 +1,259 @@
+// RRightclickrr shell extension hot-path statistics
+//
+// Counters, gauges and log2 latency histograms for IsMemberOf, GetState,
+// Invoke and index reloads, kept in a small shared-memory block per host
+// process (Local\RRightclickrrShellStats-<pid>) that the app or a CLI maps
+// read-only, so no debugger is needed to see what the handlers cost Explorer.
+//
+// Layout:
+//   ShellStatsHeader, then kShellStatsSlotCount ShellStatsSlot
+//
+// Each thread that records claims a slot of its own and updates it with
+// plain loads and stores (one writer per slot, no locked instructions);
+// threads past the last exclusive slot share the final one with atomic adds.
+// Readers sum the slots. Recording never allocates or makes a syscall; the
+// clock is steady_clock, which reads the TSC-backed counter in user mode.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+constexpr uint32_t kShellStatsMagic = 0x53535252; // "RRSS"
+constexpr uint16_t kShellStatsVersion = 1;
+constexpr size_t kShellStatsSlotCount = 16;
+// Bucket 0 holds 0 ns, bucket b holds [2^(b-1), 2^b) ns; the last also
+// takes anything slower (over about a second).
+constexpr size_t kShellStatsBucketCount = 32;
+
+enum class ShellCounter : uint32_t
+{
+    IsMemberOfCalls,
+    OverlayLookups,   // Resolved against the snapshot
+    LastQueryHits,    // Answered from the thread's last query
+    ParentMemoHits,   // Answered from the parent verdict without the index
+    ParentMemoMisses, // Parent classified against the index
+    TornLookups,      // Retried after the app republished the shared slot in use
+    Reloads,          // Reload passes run
+    ReloadsPublished, // ... that published a new snapshot
+    ReloadsSkipped,   // Another thread was already reloading
+    ReloadsCoalesced, // Reload requests folded into another request's pass
+    ColdStartAnswers, // Answered before the first index load finished
+    GetStateCalls,
+    InvokeCalls,
+    InvokeFailures,
+    InvokesCoalesced, // Dropped as a repeat of a request just queued or run
+    LinksCopied,      // "Copy Google Drive Link" answered from synced-links.idx
+    LinkIndexMisses,  // ... that fell back to launching the app
+    PipedCommands,    // Invoke handed to the running app over its pipe
+    PipeFallbacks,    // ... no app answered in time, so one was launched
+    Count
+};
+
+enum class ShellTimer : uint32_t
+{
+    IsMemberOf,
+    GetState,
+    Invoke,          // Reading the selection and queuing it
+    Dispatch,        // The invoke worker handling one request
+    Reload,          // Whole reload pass, snapshot publish included
+    ReloadLockWait,  // Taking the reload lock (a try-lock; never blocks)
+    PublishWait,     // Publishing a snapshot: waiting out readers of the old one
+    Count
+};
+
+enum class ShellGauge : uint32_t
+{
+    IndexSource,   // 0 none, 1 binary file, 2 shared memory, 3 text file, 4 compacted journal
+    SourcePaths,   // Paths the app listed, journal included
+    CoveringRoots, // Roots they reduced to
+    IndexBytes,    // Mapped image, or in-memory trie, of the current base
+    SnapshotGeneration,
+    LastReloadNs,
+    Count
+};
+
+constexpr size_t kShellCounterCount = static_cast<size_t>(ShellCounter::Count);
+constexpr size_t kShellTimerCount = static_cast<size_t>(ShellTimer::Count);
+constexpr size_t kShellGaugeCount = static_cast<size_t>(ShellGauge::Count);
+
+// Stable names used by readers ("is_member_of_calls", "reload", ...).
+const char *ShellCounterName(ShellCounter counter);
+const char *ShellTimerName(ShellTimer timer);
+const char *ShellGaugeName(ShellGauge gauge);
+
+struct ShellStatsHeader
+{
+    std::atomic<uint32_t> magic; // Stored last when the block is initialized
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t slotSize;
+    uint32_t slotCount;
+    uint32_t counterCount;
+    uint32_t timerCount;
+    uint32_t bucketCount;
+    uint32_t gaugeCount;
+    uint32_t processId;
+    uint32_t reserved;
+    std::atomic<uint64_t> gauges[kShellGaugeCount]; // Written by the reloading thread
+};
+
+struct alignas(64) ShellStatsSlot
+{
+    std::atomic<uint64_t> counters[kShellCounterCount];
+    std::atomic<uint64_t> totalNs[kShellTimerCount];
+    std::atomic<uint64_t> buckets[kShellTimerCount][kShellStatsBucketCount];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "Stats counters in shared memory must be lock-free");
+
+// One timer's merged histogram.
+struct ShellLatency
+{
+    uint64_t count = 0;
+    uint64_t totalNs = 0;
+    uint64_t buckets[kShellStatsBucketCount] = {};
+
+    // Upper bound of the bucket holding the given percentile; 0 when empty.
+    uint64_t PercentileNs(double percent) const;
+};
+
+// Every slot summed, as a reader sees the block.
+struct ShellStatsSnapshot
+{
+    uint32_t processId = 0;
+    uint64_t counters[kShellCounterCount] = {};
+    uint64_t gauges[kShellGaugeCount] = {};
+    ShellLatency timers[kShellTimerCount];
+
+    uint64_t Counter(ShellCounter counter) const { return counters[static_cast<size_t>(counter)]; }
+    uint64_t Gauge(ShellGauge gauge) const { return gauges[static_cast<size_t>(gauge)]; }
+    const ShellLatency &Timer(ShellTimer timer) const { return timers[static_cast<size_t>(timer)]; }
+};
+
+// Sums a stats block; false when data is not a block of this version.
+// Slots are read while threads update them, so totals may be a few events
+// apart from each other, never torn.
+bool ReadShellStats(const void *data, size_t size, ShellStatsSnapshot &snapshot);
+
+size_t ShellLatencyBucket(uint64_t ns);
+
+class CShellStats
+{
+public:
+    static constexpr size_t kSlotOffset = (sizeof(ShellStatsHeader) + 63) / 64 * 64;
+    static constexpr size_t kBlockSize = kSlotOffset + kShellStatsSlotCount * sizeof(ShellStatsSlot);
+
+    CShellStats() = default;
+    CShellStats(const CShellStats &) = delete;
+    CShellStats &operator=(const CShellStats &) = delete;
+
+    // Lays out a fresh block in at least kBlockSize bytes of memory.
+    bool Attach(void *data, size_t size, uint32_t processId);
+    bool IsAttached() const { return m_header != nullptr; }
+
+    void Count(ShellCounter counter, uint64_t amount = 1)
+    {
+        if (m_header)
+        {
+            const ThreadSlot &slot = Slot();
+            Add(slot, slot.slot->counters[static_cast<size_t>(counter)], amount);
+        }
+    }
+
+    void Record(ShellTimer timer, uint64_t ns)
+    {
+        if (m_header)
+        {
+            const ThreadSlot &slot = Slot();
+            const size_t index = static_cast<size_t>(timer);
+            Add(slot, slot.slot->totalNs[index], ns);
+            Add(slot, slot.slot->buckets[index][ShellLatencyBucket(ns)], 1);
+        }
+    }
+
+    void SetGauge(ShellGauge gauge, uint64_t value)
+    {
+        if (m_header)
+        {
+            m_header->gauges[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+        }
+    }
+
+    bool Read(ShellStatsSnapshot &snapshot) const;
+
+private:
+    struct ThreadSlot
+    {
+        uint64_t instance = 0;
+        ShellStatsSlot *slot = nullptr;
+        bool shared = false; // Past the exclusive slots; update atomically
+    };
+
+    // The calling thread's slot in this block, claimed on first use.
+    const ThreadSlot &Slot()
+    {
+        thread_local ThreadSlot cached;
+        if (cached.instance != m_instance)
+        {
+            Claim(cached);
+        }
+        return cached;
+    }
+
+    void Claim(ThreadSlot &cached);
+
+    static void Add(const ThreadSlot &slot, std::atomic<uint64_t> &value, uint64_t amount)
+    {
+        if (slot.shared)
+        {
+            value.fetch_add(amount, std::memory_order_relaxed);
+        }
+        else
+        {
+            value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+    }
+
+    ShellStatsHeader *m_header = nullptr;
+    ShellStatsSlot *m_slots = nullptr;
+    uint64_t m_instance = 0; // Tells a thread's cached slot from another block's
+    std::atomic<size_t> m_nextSlot{0};
+};
+
+// Times a scope into a timer.
+class CShellStatsTimer
+{
+public:
+    CShellStatsTimer(CShellStats &stats, ShellTimer timer)
+        : m_stats(stats), m_timer(timer), m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~CShellStatsTimer()
+    {
+        m_stats.Record(m_timer, ElapsedNs());
+    }
+
+    CShellStatsTimer(const CShellStatsTimer &) = delete;
+    CShellStatsTimer &operator=(const CShellStatsTimer &) = delete;
+
+    uint64_t ElapsedNs() const
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+    }
+
+private:
+    CShellStats &m_stats;
+    ShellTimer m_timer;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// This process's stats, published under ShellStatsSegmentName(pid) on first
+// use; recording still works (in private memory) if the segment cannot be
+// created.
+CShellStats &ProcessShellStats();
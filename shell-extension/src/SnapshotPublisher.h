@@ -0,0 +1,127 @@
+// RRightclickrr immutable snapshot publication
+//
+// Readers obtain the current snapshot with one atomic pointer load and never
+// block. Writers publish a replacement and free the old one after a grace
+// period, SRCU style: each reader bumps a counter in one of a fixed set of
+// cache-line sized slots (chosen per thread) for the parity of the epoch it
+// entered in, and a writer waits for the old parity to drain, twice, before
+// deleting what it replaced. Only the writer ever waits.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+template <typename T>
+class CSnapshotPublisher
+{
+    static constexpr size_t kSlotCount = 64;
+
+    struct alignas(64) ReaderSlot
+    {
+        std::atomic<uint32_t> active[2];
+    };
+
+public:
+    // Keeps the snapshot it returned alive until destroyed.
+    class ReadGuard
+    {
+    public:
+        ReadGuard(ReadGuard &&other) noexcept : m_counter(other.m_counter), m_snapshot(other.m_snapshot)
+        {
+            other.m_counter = nullptr;
+        }
+
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+        ReadGuard &operator=(ReadGuard &&) = delete;
+
+        ~ReadGuard()
+        {
+            if (m_counter)
+            {
+                m_counter->fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        const T *Get() const { return m_snapshot; }
+        const T *operator->() const { return m_snapshot; }
+        explicit operator bool() const { return m_snapshot != nullptr; }
+
+    private:
+        friend class CSnapshotPublisher;
+        ReadGuard(std::atomic<uint32_t> *counter, const T *snapshot) : m_counter(counter), m_snapshot(snapshot) {}
+
+        std::atomic<uint32_t> *m_counter;
+        const T *m_snapshot;
+    };
+
+    CSnapshotPublisher() : m_current(nullptr), m_epoch(0), m_slots()
+    {
+    }
+
+    ~CSnapshotPublisher()
+    {
+        delete m_current.load(std::memory_order_relaxed);
+    }
+
+    CSnapshotPublisher(const CSnapshotPublisher &) = delete;
+    CSnapshotPublisher &operator=(const CSnapshotPublisher &) = delete;
+
+    ReadGuard Read() const
+    {
+        ReaderSlot &slot = m_slots[ThreadSlot()];
+        const uint32_t parity = m_epoch.load(std::memory_order_relaxed) & 1;
+        std::atomic<uint32_t> *counter = &slot.active[parity];
+        counter->fetch_add(1, std::memory_order_seq_cst);
+        return ReadGuard(counter, m_current.load(std::memory_order_seq_cst));
+    }
+
+    // Installs next and deletes the previous snapshot once no reader can
+    // still hold it. Must not be called while the caller holds a ReadGuard.
+    void Publish(std::unique_ptr<T> next)
+    {
+        std::lock_guard<std::mutex> guard(m_writerMutex);
+        T *previous = m_current.exchange(next.release(), std::memory_order_seq_cst);
+        if (previous)
+        {
+            WaitForReaders();
+            delete previous;
+        }
+    }
+
+private:
+    void WaitForReaders()
+    {
+        // A reader that could hold the replaced snapshot registered before
+        // the exchange, on one parity or the other, so drain both. Flipping
+        // first steers new readers to the other parity and bounds each wait.
+        for (int pass = 0; pass < 2; pass++)
+        {
+            const uint32_t drained = m_epoch.fetch_add(1, std::memory_order_seq_cst) & 1;
+            for (ReaderSlot &slot : m_slots)
+            {
+                while (slot.active[drained].load(std::memory_order_acquire) != 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+
+    static size_t ThreadSlot()
+    {
+        static std::atomic<size_t> nextSlot{0};
+        thread_local const size_t slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % kSlotCount;
+        return slot;
+    }
+
+    std::atomic<T *> m_current;
+    std::atomic<uint64_t> m_epoch;
+    mutable ReaderSlot m_slots[kSlotCount];
+    std::mutex m_writerMutex;
+};
@@ -0,0 +1,425 @@
+// RRightclickrr embedded sync database (sync-db.log)
+
+#include "SyncDatabase.h"
+#include "Crc32.h"
+#include "FileFlush.h"
+#include <cstring>
+#include <system_error>
+
+namespace
+{
+// Snapshot batches are cut at about this payload size.
+constexpr size_t kSnapshotBatchBytes = 1024 * 1024;
+
+uint32_t HeaderChecksum(SyncDbHeader header)
+{
+    header.headerChecksum = 0;
+    return Crc32(&header, sizeof(header));
+}
+
+std::vector<uint8_t> BuildHeader()
+{
+    SyncDbHeader header = {};
+    header.magic = kSyncDbMagic;
+    header.version = kSyncDbVersion;
+    header.headerSize = sizeof(SyncDbHeader);
+    header.headerChecksum = HeaderChecksum(header);
+
+    std::vector<uint8_t> bytes(sizeof(header));
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    return bytes;
+}
+
+bool ParseHeader(const std::vector<uint8_t> &bytes, SyncDbHeader &header)
+{
+    if (bytes.size() < sizeof(header))
+    {
+        return false;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    return header.magic == kSyncDbMagic && header.version == kSyncDbVersion &&
+           header.headerSize >= sizeof(SyncDbHeader) && header.headerSize <= bytes.size() &&
+           HeaderChecksum(header) == header.headerChecksum;
+}
+
+uint64_t RecordBytes(const std::string &key, const SyncDbEntry &entry)
+{
+    return sizeof(SyncDbRecordHeader) + key.size() + entry.link.size() + entry.data.size();
+}
+
+bool AppendRecord(std::vector<uint8_t> &out, SyncDbOp op, const std::string &key, const SyncDbEntry &entry)
+{
+    if (key.size() > UINT32_MAX || entry.link.size() > UINT16_MAX || entry.data.size() > UINT32_MAX)
+    {
+        return false;
+    }
+
+    SyncDbRecordHeader record = {};
+    record.op = static_cast<uint8_t>(op);
+    record.linkLength = static_cast<uint16_t>(entry.link.size());
+    record.keyLength = static_cast<uint32_t>(key.size());
+    record.dataLength = static_cast<uint32_t>(entry.data.size());
+
+    size_t offset = out.size();
+    out.resize(offset + RecordBytes(key, entry));
+    std::memcpy(out.data() + offset, &record, sizeof(record));
+    offset += sizeof(record);
+    for (const std::string *field : {&key, &entry.link, &entry.data})
+    {
+        std::memcpy(out.data() + offset, field->data(), field->size());
+        offset += field->size();
+    }
+    return true;
+}
+
+// Decodes every record of one batch payload; false if any is malformed.
+bool DecodeBatch(const uint8_t *data, size_t size, std::vector<SyncDbWrite> &writes)
+{
+    size_t offset = 0;
+    while (offset < size)
+    {
+        SyncDbRecordHeader record = {};
+        if (size - offset < sizeof(record))
+        {
+            return false;
+        }
+        std::memcpy(&record, data + offset, sizeof(record));
+        offset += sizeof(record);
+
+        const uint64_t length = static_cast<uint64_t>(record.keyLength) + record.linkLength + record.dataLength;
+        if (record.op < static_cast<uint8_t>(SyncDbOp::Put) ||
+            record.op > static_cast<uint8_t>(SyncDbOp::DeletePrefix) || length > size - offset)
+        {
+            return false;
+        }
+
+        SyncDbWrite write;
+        write.op = static_cast<SyncDbOp>(record.op);
+        const char *chars = reinterpret_cast<const char *>(data + offset);
+        write.key.assign(chars, record.keyLength);
+        write.entry.link.assign(chars + record.keyLength, record.linkLength);
+        write.entry.data.assign(chars + record.keyLength + record.linkLength, record.dataLength);
+        offset += static_cast<size_t>(length);
+        writes.push_back(std::move(write));
+    }
+    return true;
+}
+
+bool WriteBatch(std::ostream &out, const std::vector<uint8_t> &payload, uint64_t &written)
+{
+    SyncDbBatchHeader batch = {};
+    batch.payloadSize = static_cast<uint32_t>(payload.size());
+    batch.checksum = Crc32(payload.data(), payload.size());
+    if (!out.write(reinterpret_cast<const char *>(&batch), sizeof(batch)) ||
+        !out.write(reinterpret_cast<const char *>(payload.data()), static_cast<std::streamsize>(payload.size())))
+    {
+        return false;
+    }
+    written += sizeof(batch) + payload.size();
+    return true;
+}
+} // namespace
+
+bool CSyncDatabase::Open(const std::filesystem::path &file)
+{
+    Close();
+
+    std::vector<uint8_t> bytes;
+    {
+        // One read: the log can run to tens of megabytes.
+        std::ifstream in(file, std::ios::binary | std::ios::ate);
+        const std::streamoff size = in ? static_cast<std::streamoff>(in.tellg()) : 0;
+        bytes.resize(size > 0 ? static_cast<size_t>(size) : 0);
+        if (!bytes.empty() && !(in.seekg(0) && in.read(reinterpret_cast<char *>(bytes.data()), size)))
+        {
+            return false;
+        }
+    }
+
+    SyncDbHeader header = {};
+    size_t validEnd = 0;
+    if (bytes.size() < sizeof(header))
+    {
+        // Missing, or a header torn while the file was created.
+        const std::vector<uint8_t> fresh = BuildHeader();
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        if (!out.write(reinterpret_cast<const char *>(fresh.data()), static_cast<std::streamsize>(fresh.size())))
+        {
+            return false;
+        }
+        validEnd = fresh.size();
+    }
+    else if (!ParseHeader(bytes, header))
+    {
+        return false;
+    }
+    else
+    {
+        validEnd = Replay(bytes, header.headerSize);
+        if (validEnd < bytes.size())
+        {
+            // Drop the torn batch so new ones follow the last valid one.
+            std::error_code ec;
+            std::filesystem::resize_file(file, validEnd, ec);
+            if (ec)
+            {
+                m_entries.clear();
+                m_liveRecordBytes = 0;
+                return false;
+            }
+            m_droppedTailBytes = bytes.size() - validEnd;
+        }
+    }
+
+    m_path = file;
+    m_logBytes = validEnd;
+    if (!OpenLog())
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void CSyncDatabase::Close()
+{
+    m_log.close();
+    m_log.clear();
+    m_path.clear();
+    m_entries.clear();
+    m_logBytes = 0;
+    m_liveRecordBytes = 0;
+    m_compactions = 0;
+    m_droppedTailBytes = 0;
+}
+
+bool CSyncDatabase::OpenLog()
+{
+    m_log.close();
+    m_log.clear();
+    m_log.open(m_path, std::ios::binary | std::ios::app);
+    return m_log.is_open();
+}
+
+size_t CSyncDatabase::Replay(const std::vector<uint8_t> &bytes, size_t offset)
+{
+    std::vector<SyncDbWrite> writes;
+    while (bytes.size() - offset >= sizeof(SyncDbBatchHeader))
+    {
+        SyncDbBatchHeader batch = {};
+        std::memcpy(&batch, bytes.data() + offset, sizeof(batch));
+        const uint8_t *payload = bytes.data() + offset + sizeof(batch);
+        if (batch.payloadSize > bytes.size() - offset - sizeof(batch) ||
+            Crc32(payload, batch.payloadSize) != batch.checksum)
+        {
+            break;
+        }
+
+        writes.clear();
+        if (!DecodeBatch(payload, batch.payloadSize, writes))
+        {
+            break;
+        }
+        for (SyncDbWrite &write : writes)
+        {
+            ApplyInMemory(std::move(write));
+        }
+        offset += sizeof(batch) + batch.payloadSize;
+    }
+    return offset;
+}
+
+size_t CSyncDatabase::ApplyInMemory(SyncDbWrite write)
+{
+    switch (write.op)
+    {
+    case SyncDbOp::Put:
+    {
+        auto [it, inserted] = m_entries.try_emplace(write.key);
+        if (!inserted)
+        {
+            m_liveRecordBytes -= RecordBytes(it->first, it->second);
+        }
+        it->second = std::move(write.entry);
+        m_liveRecordBytes += RecordBytes(it->first, it->second);
+        return 0;
+    }
+    case SyncDbOp::Delete:
+    {
+        const auto it = m_entries.find(write.key);
+        if (it == m_entries.end())
+        {
+            return 0;
+        }
+        m_liveRecordBytes -= RecordBytes(it->first, it->second);
+        m_entries.erase(it);
+        return 1;
+    }
+    case SyncDbOp::DeletePrefix:
+    {
+        const Range range = PrefixRange(write.key);
+        size_t removed = 0;
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            m_liveRecordBytes -= RecordBytes(it->first, it->second);
+            removed++;
+        }
+        m_entries.erase(range.first, range.second);
+        return removed;
+    }
+    }
+    return 0;
+}
+
+const SyncDbEntry *CSyncDatabase::Find(const std::string &key) const
+{
+    const auto it = m_entries.find(key);
+    return it == m_entries.end() ? nullptr : &it->second;
+}
+
+CSyncDatabase::Range CSyncDatabase::PrefixRange(const std::string &prefix) const
+{
+    const auto first = m_entries.lower_bound(prefix);
+    auto last = first;
+    while (last != m_entries.end() && last->first.compare(0, prefix.size(), prefix) == 0)
+    {
+        ++last;
+    }
+    return {first, last};
+}
+
+bool CSyncDatabase::Apply(const std::vector<SyncDbWrite> &writes, size_t *removed)
+{
+    if (removed)
+    {
+        *removed = 0;
+    }
+    if (!IsOpen())
+    {
+        return false;
+    }
+    if (writes.empty())
+    {
+        return true;
+    }
+
+    std::vector<uint8_t> payload;
+    for (const SyncDbWrite &write : writes)
+    {
+        if (!AppendRecord(payload, write.op, write.key, write.op == SyncDbOp::Put ? write.entry : SyncDbEntry()))
+        {
+            return false;
+        }
+    }
+    if (payload.size() > UINT32_MAX)
+    {
+        return false;
+    }
+
+    uint64_t written = 0;
+    if ((!m_log.is_open() && !OpenLog()) || !WriteBatch(m_log, payload, written) || !m_log.flush() ||
+        !FlushFileToDisk(m_path))
+    {
+        // Cut off whatever part of the batch reached the file.
+        m_log.close();
+        std::error_code ec;
+        std::filesystem::resize_file(m_path, m_logBytes, ec);
+        OpenLog();
+        return false;
+    }
+    m_logBytes += written;
+
+    size_t dropped = 0;
+    for (const SyncDbWrite &write : writes)
+    {
+        dropped += ApplyInMemory(write);
+    }
+    if (removed)
+    {
+        *removed = dropped;
+    }
+
+    // A failed compaction keeps appending to the old log.
+    if (m_logBytes >= kSyncDbCompactMinBytes && m_logBytes > kSyncDbCompactRatio * SnapshotBytes())
+    {
+        Compact();
+    }
+    return true;
+}
+
+uint64_t CSyncDatabase::SnapshotBytes() const
+{
+    const uint64_t batches = m_liveRecordBytes / kSnapshotBatchBytes + 1;
+    return sizeof(SyncDbHeader) + batches * sizeof(SyncDbBatchHeader) + m_liveRecordBytes;
+}
+
+bool CSyncDatabase::Compact()
+{
+    if (!IsOpen())
+    {
+        return false;
+    }
+
+    std::filesystem::path temp = m_path;
+    temp += ".tmp";
+    uint64_t written = 0;
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        const std::vector<uint8_t> header = BuildHeader();
+        bool ok = static_cast<bool>(out.write(reinterpret_cast<const char *>(header.data()),
+                                              static_cast<std::streamsize>(header.size())));
+        written = header.size();
+
+        std::vector<uint8_t> payload;
+        for (auto it = m_entries.begin(); ok && it != m_entries.end(); ++it)
+        {
+            AppendRecord(payload, SyncDbOp::Put, it->first, it->second);
+            if (payload.size() >= kSnapshotBatchBytes)
+            {
+                ok = WriteBatch(out, payload, written);
+                payload.clear();
+            }
+        }
+        if (ok && !payload.empty())
+        {
+            ok = WriteBatch(out, payload, written);
+        }
+        // On disk before the rename, or a crash could leave the new name on
+        // a file whose data never arrived.
+        if (!ok || !out.flush() || !FlushFileToDisk(temp))
+        {
+            out.close();
+            std::error_code ec;
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+    }
+
+    // Windows will not rename over a file that is still open.
+    m_log.close();
+    std::error_code ec;
+    std::filesystem::rename(temp, m_path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temp, ec);
+        OpenLog();
+        return false;
+    }
+
+    // Best effort: if the rename is lost, the old log is still complete.
+    FlushDirectoryToDisk(m_path.parent_path());
+    m_logBytes = written;
+    m_compactions++;
+    return OpenLog();
+}
+
+SyncDbStats CSyncDatabase::Stats() const
+{
+    SyncDbStats stats;
+    stats.entries = m_entries.size();
+    stats.logBytes = m_logBytes;
+    stats.snapshotBytes = SnapshotBytes();
+    stats.compactions = m_compactions;
+    stats.droppedTailBytes = m_droppedTailBytes;
+    return stats;
+}
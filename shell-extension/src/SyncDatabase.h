@@ -0,0 +1,144 @@
+// RRightclickrr embedded sync database (sync-db.log)
+//
+// SyncTracker's record of what has been synced: one entry per normalized
+// local path, holding the item's Drive link and its metadata as an opaque
+// JSON string. Entries live in a sorted map, so point updates are O(log n)
+// and everything beneath a folder is one contiguous key range. Changes are
+// appended to a log as checksummed batches and the log is rewritten as a
+// snapshot once it is mostly dead records.
+//
+// Layout (little-endian):
+//   SyncDbHeader (16 bytes)
+//   batches - SyncDbBatchHeader (8 bytes) + payloadSize bytes of records,
+//             each SyncDbRecordHeader (12 bytes) + key + link + data
+//
+// A batch is applied on open only when it is complete and its checksum
+// matches; a torn batch left by a crash is cut off and everything before it
+// stands, so every Apply is all or nothing. Apply returns only once its batch
+// is on disk (FileFlush.h), and a compacted log is on disk before it replaces
+// the old one.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+constexpr uint32_t kSyncDbMagic = 0x42445352; // "RSDB"
+constexpr uint16_t kSyncDbVersion = 1;
+
+// The log is compacted once it is past this size and more than
+// kSyncDbCompactRatio times the size of a fresh snapshot.
+constexpr uint64_t kSyncDbCompactMinBytes = 4 * 1024 * 1024;
+constexpr uint64_t kSyncDbCompactRatio = 2;
+
+struct SyncDbHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t reserved;
+    uint32_t headerChecksum; // CRC-32 of this header with this field zeroed
+};
+static_assert(sizeof(SyncDbHeader) == 16, "SyncDbHeader layout is part of the file format");
+
+struct SyncDbBatchHeader
+{
+    uint32_t payloadSize;
+    uint32_t checksum; // CRC-32 of the payload
+};
+static_assert(sizeof(SyncDbBatchHeader) == 8, "SyncDbBatchHeader layout is part of the file format");
+
+enum class SyncDbOp : uint8_t
+{
+    Put = 1,
+    Delete = 2,
+    DeletePrefix = 3, // Drops every key starting with key
+};
+
+struct SyncDbRecordHeader
+{
+    uint8_t op;
+    uint8_t reserved;
+    uint16_t linkLength;
+    uint32_t keyLength;
+    uint32_t dataLength;
+};
+static_assert(sizeof(SyncDbRecordHeader) == 12, "SyncDbRecordHeader layout is part of the file format");
+
+struct SyncDbEntry
+{
+    std::string link; // Drive web link, empty if unknown
+    std::string data; // JSON metadata, stored as given
+};
+
+struct SyncDbWrite
+{
+    SyncDbOp op = SyncDbOp::Put;
+    std::string key;
+    SyncDbEntry entry; // Put only
+};
+
+struct SyncDbStats
+{
+    uint64_t entries = 0;
+    uint64_t logBytes = 0;
+    uint64_t snapshotBytes = 0; // Size a compaction would leave
+    uint64_t compactions = 0;
+    uint64_t droppedTailBytes = 0; // Torn batch cut off by the last Open
+};
+
+class CSyncDatabase
+{
+public:
+    using Map = std::map<std::string, SyncDbEntry>;
+    using Range = std::pair<Map::const_iterator, Map::const_iterator>;
+
+    CSyncDatabase() = default;
+    ~CSyncDatabase() { Close(); }
+
+    CSyncDatabase(const CSyncDatabase &) = delete;
+    CSyncDatabase &operator=(const CSyncDatabase &) = delete;
+
+    // Loads file, creating it if missing. A file that is not a sync database
+    // fails rather than being overwritten.
+    bool Open(const std::filesystem::path &file);
+    void Close();
+    bool IsOpen() const { return !m_path.empty(); }
+
+    const SyncDbEntry *Find(const std::string &key) const;
+
+    // Entries whose key starts with prefix, in key order.
+    Range PrefixRange(const std::string &prefix) const;
+    size_t Size() const { return m_entries.size(); }
+
+    // Appends writes as one batch and applies them in order; false leaves
+    // both the file and the entries as they were. removed, if given,
+    // receives the number of entries the deletes dropped. May compact.
+    bool Apply(const std::vector<SyncDbWrite> &writes, size_t *removed = nullptr);
+
+    // Rewrites the log as one snapshot of the live entries (temp file +
+    // rename). On failure the old log stays in use.
+    bool Compact();
+
+    SyncDbStats Stats() const;
+
+private:
+    size_t Replay(const std::vector<uint8_t> &bytes, size_t offset);
+    size_t ApplyInMemory(SyncDbWrite write);
+    uint64_t SnapshotBytes() const;
+    bool OpenLog();
+
+    std::filesystem::path m_path;
+    std::ofstream m_log;
+    Map m_entries;
+    uint64_t m_logBytes = 0;
+    uint64_t m_liveRecordBytes = 0; // Records a snapshot would hold
+    uint64_t m_compactions = 0;
+    uint64_t m_droppedTailBytes = 0;
+};
@@ -1,80 +1,333 @@
 // RRightclickrr shell icon overlay handler
 
 #include "SyncOverlay.h"
+#include "ExclusionMatcher.h"
+#include "IndexChangeSource.h"
+#include "IndexReloader.h"
+#include "ModulePaths.h"
+#include "OverlayIndexFormat.h"
+#include "OverlayJournal.h"
+#include "OverlaySharedIndex.h"
+#include "OverlayStatus.h"
+#include "ParentVerdictMemo.h"
+#include "PathArena.h"
+#include "PathNormalize.h"
+#include "SharedMemorySegment.h"
+#include "ShellStats.h"
+#include "SnapshotPublisher.h"
+#include "SyncedPathMatch.h"
+#include "SyncedPathTrie.h"
 #include <pathcch.h>
 #include <shlwapi.h>
 #include <shlobj.h>
-#include <strsafe.h>
 #include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <memory>
 #include <mutex>
+#include <new>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#pragma comment(lib, "advapi32.lib")
 #pragma comment(lib, "pathcch.lib")
 #pragma comment(lib, "shell32.lib")
 #pragma comment(lib, "shlwapi.lib")
 
-extern HMODULE g_hModule;
 extern long g_cDllRef;
 
 namespace
 {
+// Only used when change notifications are unavailable.
 constexpr ULONGLONG kCacheRefreshIntervalMs = 1500;
+constexpr wchar_t kBinaryIndexFile[] = L"RRightclickrr\\synced-paths.idx";
+constexpr wchar_t kTextIndexFile[] = L"RRightclickrr\\synced-paths.txt";
+constexpr wchar_t kJournalFile[] = L"RRightclickrr\\synced-paths.journal";
+constexpr wchar_t kStatusFile[] = L"RRightclickrr\\sync-status.txt";
+constexpr wchar_t kExclusionFile[] = L"RRightclickrr\\synced-exclusions.idx";
+// Journaled roots kept beside the base (and copied into every snapshot)
+// before they are compacted into it.
+constexpr size_t kJournalLayerLimit = 256;
+// The app compacts at 1 MiB; a journal far beyond that is not read.
+constexpr LONGLONG kMaxJournalBytes = 64 * 1024 * 1024;
+// sync-status.txt holds one line per folder queued, syncing or failed.
+constexpr LONGLONG kMaxStatusBytes = 4 * 1024 * 1024;
+// Compiled exclusion rules; thousands of rules stay well under this.
+constexpr LONGLONG kMaxExclusionBytes = 16 * 1024 * 1024;
+// Opens of the shared index that raced a publish, retried before keeping
+// the previous base.
+constexpr int kSharedOpenAttempts = 3;
+// Lookups repeated after the app republished over the slot they read.
+constexpr int kTornLookupRetries = 2;
+// How long a torn lookup waits for the loader to pick up the new index.
+constexpr uint32_t kTornReloadWaitMs = 20;
+// Cold-start policy: how long the first lookups in a process may wait for the
+// initial index load (HKCU\Software\RRightclickrr, OverlayColdStartWaitMs).
+// 0, the default, answers at once with no overlay until the load lands.
+constexpr wchar_t kSettingsKey[] = L"Software\\RRightclickrr";
+constexpr wchar_t kColdStartWaitValue[] = L"OverlayColdStartWaitMs";
+constexpr DWORD kMaxColdStartWaitMs = 2000;
 
-std::mutex g_cacheMutex;
-std::wstring g_cachedIndexPath;
-FILETIME g_cachedWriteTime = {};
-ULONGLONG g_lastCacheProbeTick = 0;
-std::vector<std::wstring> g_cachedSyncedRoots;
+static_assert(sizeof(wchar_t) == sizeof(char16_t), "The binary index stores UTF-16 code units");
+
+// Reported as the stats block's index_source gauge; keep the order.
+enum class IndexSource
+{
+    None,
+    Binary,   // Mapped synced-paths.idx, queried in place
+    Shared,   // Index the app published in shared memory, queried in place
+    Text,     // Parsed synced-paths.txt fallback
+    Compacted // synced-paths.idx plus its journal, folded into a trie
+};
+
+struct MappedIndex
+{
+    const void *view = nullptr;
+    size_t size = 0;
+};
 
 bool FileTimeEqual(const FILETIME &lhs, const FILETIME &rhs)
 {
     return lhs.dwLowDateTime == rhs.dwLowDateTime && lhs.dwHighDateTime == rhs.dwHighDateTime;
 }
 
-std::wstring NormalizePath(std::wstring value)
+bool MapIndexFile(const std::wstring &filePath, MappedIndex &mapped)
 {
-    std::replace(value.begin(), value.end(), L'/', L'\\');
-    for (wchar_t &ch : value)
+    HANDLE file = CreateFileW(
+        filePath.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    // The view keeps the section alive; neither handle is needed afterwards.
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
     {
-        ch = static_cast<wchar_t>(towlower(ch));
+        return false;
     }
 
-    while (value.length() > 3 && !value.empty() && value.back() == L'\\')
+    const void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!view)
     {
-        value.pop_back();
+        return false;
     }
 
-    return value;
+    mapped.view = view;
+    mapped.size = static_cast<size_t>(size.QuadPart);
+    return true;
 }
 
-bool IsSameOrChildPath(const std::wstring &candidate, const std::wstring &root)
+void UnmapIndexFile(MappedIndex &mapped)
 {
-    if (candidate == root)
+    if (mapped.view)
     {
-        return true;
+        UnmapViewOfFile(mapped.view);
+    }
+    mapped = {};
+}
+
+// Synced roots loaded from disk or shared memory, or compacted in memory
+// from the journal. Immutable once built and shared by every snapshot layered
+// on top of it.
+struct SyncedRootsBase
+{
+    IndexSource source = IndexSource::None;
+    size_t sourceCount = 0; // Paths listed by the app
+    size_t rootCount = 0;   // Covering roots left after reduction
+    MappedIndex mapping;
+    CSharedMemorySegment segment;
+    COverlaySharedIndexReader sharedReader;
+    OverlaySharedLease sharedLease;
+    uint64_t sharedPublishCount = 0;
+    COverlayIndexView indexView;
+    CSyncedPathTrie trie;
+
+    SyncedRootsBase() = default;
+    SyncedRootsBase(const SyncedRootsBase &) = delete;
+    SyncedRootsBase &operator=(const SyncedRootsBase &) = delete;
+
+    ~SyncedRootsBase()
+    {
+        UnmapIndexFile(mapping);
     }
 
-    if (candidate.length() <= root.length())
+    bool InPlace() const
     {
-        return false;
+        return source == IndexSource::Binary || source == IndexSource::Shared;
     }
 
-    if (candidate.compare(0, root.length(), root) != 0)
+    size_t MemoryBytes() const
     {
-        return false;
+        return InPlace() ? indexView.Size() : trie.MemoryBytes();
     }
 
-    // Drive roots like "c:\" should match direct children.
-    if (!root.empty() && root.back() == L'\\')
+    // False once the app has published over the slot this base reads; what
+    // was answered from it since may be torn.
+    bool IsStable() const
     {
-        return true;
+        return sharedLease.IsStable();
+    }
+
+    // False once the app has published something newer.
+    bool IsCurrent() const
+    {
+        return source != IndexSource::Shared || sharedReader.PublishCount() == sharedPublishCount;
+    }
+
+    bool Matches(std::wstring_view normalizedPath) const
+    {
+        if (InPlace())
+        {
+            return indexView.Matches(AsUtf16(normalizedPath));
+        }
+        return trie.Matches(normalizedPath);
+    }
+
+    ParentVerdict Classify(std::wstring_view parentWithSeparator) const
+    {
+        if (InPlace())
+        {
+            return ClassifyParent(indexView, AsUtf16(parentWithSeparator));
+        }
+        return ClassifyParent(trie, parentWithSeparator);
+    }
+
+    std::vector<std::wstring> Roots() const
+    {
+        if (!InPlace())
+        {
+            return trie.Roots();
+        }
+
+        std::vector<std::wstring> roots;
+        roots.reserve(indexView.EntryCount());
+        indexView.ForEach(
+            [](std::u16string_view entry, void *context) {
+                static_cast<std::vector<std::wstring> *>(context)->emplace_back(
+                    reinterpret_cast<const wchar_t *>(entry.data()), entry.size());
+            },
+            &roots);
+        return roots;
+    }
+
+    static std::u16string_view AsUtf16(std::wstring_view value)
+    {
+        return std::u16string_view(reinterpret_cast<const char16_t *>(value.data()), value.size());
+    }
+};
+
+// What lookups see: a base plus the roots journaled on top of it, and the
+// transient states from sync-status.txt. A reload builds a new snapshot and
+// publishes it; readers keep using whichever snapshot they picked up.
+struct SyncedRootsSnapshot
+{
+    uint64_t generation = 0; // Publish sequence; keys the per-thread caches
+    std::shared_ptr<const SyncedRootsBase> base; // May be null
+    CJournalLayer journal;
+    std::shared_ptr<const COverlayStatusSet> status; // May be null
+    std::shared_ptr<const CExclusionMatcher> exclusions; // May be null
+
+    bool IsExcluded(std::wstring_view normalizedPath) const
+    {
+        return exclusions && exclusions->IsExcluded(SyncedRootsBase::AsUtf16(normalizedPath));
+    }
+
+    bool Matches(std::wstring_view normalizedPath) const
+    {
+        return ((base && base->Matches(normalizedPath)) || journal.Matches(normalizedPath)) &&
+               !IsExcluded(normalizedPath);
+    }
+
+    ParentVerdict Classify(std::wstring_view parentWithSeparator) const
+    {
+        ParentVerdict verdict = base ? base->Classify(parentWithSeparator) : ParentVerdict::Empty;
+        verdict = journal.Empty() ? verdict : CombineVerdicts(verdict, journal.Classify(parentWithSeparator));
+        if (!exclusions || verdict == ParentVerdict::Empty)
+        {
+            return verdict;
+        }
+        // Folded into the parent's verdict, so the children of a folder with
+        // excluded subpaths still share one walk.
+        return ExcludeFromVerdict(verdict, exclusions->Classify(SyncedRootsBase::AsUtf16(parentWithSeparator)));
+    }
+
+    bool IsStable() const { return !base || base->IsStable(); }
+    bool IsCurrent() const { return !base || base->IsCurrent(); }
+};
+
+CSnapshotPublisher<SyncedRootsSnapshot> g_syncedRoots;
+uint64_t g_snapshotGeneration = 0; // Guarded by g_reloadMutex
+std::atomic<ULONGLONG> g_lastCacheProbeTick{0};
+
+// Background watcher on the index directory, and the loader thread its
+// change callback wakes. Both are started and stopped under g_monitorMutex.
+std::mutex g_monitorMutex;
+CIndexChangeMonitor g_indexMonitor;
+CIndexReloader g_reloader;
+
+// Reload state, owned by whichever thread holds g_reloadMutex.
+std::mutex g_reloadMutex;
+std::wstring g_cachedIndexPath;
+FILETIME g_cachedWriteTime = {};
+IndexSource g_cachedSource = IndexSource::None; // File the base came from
+std::shared_ptr<const SyncedRootsBase> g_currentBase;
+CJournalLayer g_currentJournal;
+uint64_t g_journalBaseGeneration = 0; // Index generation the journal must name
+uint64_t g_journalOffset = 0;         // Bytes of synced-paths.journal applied
+uint64_t g_journalNextSequence = 1;
+std::shared_ptr<const COverlayStatusSet> g_currentStatus;
+FILETIME g_statusWriteTime = {};
+std::shared_ptr<const CExclusionMatcher> g_currentExclusions;
+FILETIME g_exclusionsWriteTime = {};
+
+struct IndexPaths
+{
+    HRESULT hr = E_FAIL;
+    std::wstring binaryIndex;
+    std::wstring textIndex;
+    std::wstring journal;
+    std::wstring status;
+    std::wstring exclusions;
+};
+
+// Maps and validates the binary index into a new base.
+OverlayIndexStatus LoadBinaryIndex(const std::wstring &filePath, std::unique_ptr<SyncedRootsBase> &base)
+{
+    base.reset(new (std::nothrow) SyncedRootsBase());
+    if (!base || !MapIndexFile(filePath, base->mapping))
+    {
+        return OverlayIndexStatus::TooSmall;
     }
 
-    return candidate[root.length()] == L'\\';
+    base->source = IndexSource::Binary;
+    const OverlayIndexStatus status = base->indexView.Open(base->mapping.view, base->mapping.size);
+    base->sourceCount = base->indexView.SourceCount();
+    base->rootCount = base->indexView.EntryCount();
+    return status;
 }
 
-bool ReadSyncedPathList(const std::wstring &filePath, std::vector<std::wstring> &paths)
+// Reads the journal header and everything from offset to the end of the file.
+bool ReadJournalTail(const std::wstring &filePath, uint64_t offset, OverlayJournalHeader &header, uint64_t &fileSize,
+                     std::vector<uint8_t> &tail)
 {
     HANDLE file = CreateFileW(
         filePath.c_str(),
@@ -91,119 +344,679 @@ bool ReadSyncedPathList(const std::wstring &filePath, std::vector<std::wstring>
     }
 
     LARGE_INTEGER size = {};
-    if (!GetFileSizeEx(file, &size))
+    uint8_t headerBytes[sizeof(OverlayJournalHeader)];
+    DWORD read = 0;
+    bool ok = GetFileSizeEx(file, &size) && size.QuadPart <= kMaxJournalBytes &&
+              ReadFile(file, headerBytes, sizeof(headerBytes), &read, nullptr) &&
+              ParseOverlayJournalHeader(headerBytes, read, header) == OverlayJournalStatus::Ok;
+
+    fileSize = ok ? static_cast<uint64_t>(size.QuadPart) : 0;
+    if (ok && fileSize > offset)
     {
-        CloseHandle(file);
-        return false;
+        LARGE_INTEGER position = {};
+        position.QuadPart = static_cast<LONGLONG>(offset);
+        tail.resize(static_cast<size_t>(fileSize - offset));
+        ok = SetFilePointerEx(file, position, nullptr, FILE_BEGIN) &&
+             ReadFile(file, tail.data(), static_cast<DWORD>(tail.size()), &read, nullptr);
+        tail.resize(ok ? read : 0);
     }
 
-    if (size.QuadPart <= 0 || size.QuadPart > 4 * 1024 * 1024)
+    CloseHandle(file);
+    return ok;
+}
+
+enum class JournalUpdate
+{
+    Unchanged,
+    Changed,
+    Restarted // Rewritten for the same index; reload the base
+};
+
+// Applies the journal records past g_journalOffset on top of the current
+// binary base. Adds go into the journal layer; a remove, or a layer past
+// kJournalLayerLimit, folds everything into a new in-memory base instead.
+JournalUpdate ApplyJournalTail(const std::wstring &journalPath)
+{
+    if (g_cachedSource != IndexSource::Binary || !g_currentBase)
     {
-        CloseHandle(file);
-        return true;
+        return JournalUpdate::Unchanged;
+    }
+
+    const uint64_t offset = g_journalOffset ? g_journalOffset : sizeof(OverlayJournalHeader);
+    OverlayJournalHeader header = {};
+    uint64_t fileSize = 0;
+    std::vector<uint8_t> tail;
+    if (!ReadJournalTail(journalPath, offset, header, fileSize, tail) || header.baseGeneration != g_journalBaseGeneration)
+    {
+        // Missing, or still describing the previous index.
+        return JournalUpdate::Unchanged;
+    }
+    if (fileSize < offset)
+    {
+        return g_journalOffset ? JournalUpdate::Restarted : JournalUpdate::Unchanged;
+    }
+
+    std::vector<JournalRecord> records;
+    g_journalOffset = offset + ParseOverlayJournalRecords(tail.data(), tail.size(), g_journalNextSequence, records);
+    if (records.empty())
+    {
+        return JournalUpdate::Unchanged;
+    }
+
+    const std::shared_ptr<const SyncedRootsBase> base = g_currentBase;
+    CJournalLayer journal = g_currentJournal;
+    size_t applied = 0;
+    while (applied < records.size() && records[applied].op == JournalOp::Add && journal.Size() < kJournalLayerLimit)
+    {
+        journal.Add(records[applied].path, [&](std::wstring_view path) { return base->Matches(path); });
+        applied++;
+    }
+
+    if (applied < records.size())
+    {
+        // Runs on the reloading thread; lookups keep answering from the
+        // published snapshot meanwhile.
+        std::unique_ptr<SyncedRootsBase> compacted(new (std::nothrow) SyncedRootsBase());
+        if (!compacted)
+        {
+            return JournalUpdate::Restarted;
+        }
+
+        const std::vector<JournalRecord> pending(records.begin() + applied, records.end());
+        const std::vector<std::wstring> roots = CompactJournal(base->Roots(), journal, pending);
+        compacted->source = IndexSource::Compacted;
+        compacted->sourceCount = roots.size();
+        compacted->rootCount = roots.size();
+        compacted->trie.Build(roots);
+        g_currentBase = std::move(compacted);
+        journal = CJournalLayer();
+    }
+
+    g_currentJournal = std::move(journal);
+    return JournalUpdate::Changed;
+}
+
+// Replaces the base and forgets the journal applied to the previous one.
+void ResetBase(std::unique_ptr<SyncedRootsBase> base, IndexSource source, const std::wstring &indexPath,
+               const FILETIME &writeTime)
+{
+    g_cachedIndexPath = indexPath;
+    g_cachedWriteTime = writeTime;
+    g_cachedSource = base ? source : IndexSource::None;
+    g_journalBaseGeneration = (base && source == IndexSource::Binary) ? base->indexView.Generation() : 0;
+    g_currentBase = std::move(base);
+    g_currentJournal = CJournalLayer();
+    g_journalOffset = 0;
+    g_journalNextSequence = 1;
+}
+
+enum class SharedIndexUpdate
+{
+    Unavailable, // Not published, or given up on by the app; use the files
+    Unchanged,
+    Changed
+};
+
+// Picks up the index the app published in shared memory. The segment is
+// reopened by name on every reload so one recreated by a restarted app, or
+// grown for a larger index, is found; the base is only replaced when the
+// segment or its publish count differs.
+SharedIndexUpdate ReloadSharedIndex()
+{
+    static const std::string segmentName = OverlaySharedIndexSegmentName();
+    std::unique_ptr<SyncedRootsBase> base(new (std::nothrow) SyncedRootsBase());
+    if (!base || !base->segment.OpenReadOnly(segmentName) ||
+        !base->sharedReader.Attach(base->segment.Data(), base->segment.Size()) || !base->sharedReader.IsReady())
+    {
+        return SharedIndexUpdate::Unavailable;
     }
 
-    std::string bytes(static_cast<size_t>(size.QuadPart), '\0');
+    const SyncedRootsBase *current = g_cachedSource == IndexSource::Shared ? g_currentBase.get() : nullptr;
+    if (current && current->sharedReader.SegmentId() == base->sharedReader.SegmentId() &&
+        current->sharedPublishCount == base->sharedReader.PublishCount())
+    {
+        return SharedIndexUpdate::Unchanged;
+    }
+
+    OverlaySharedStatus status = OverlaySharedStatus::Busy;
+    for (int attempt = 0; attempt < kSharedOpenAttempts && status == OverlaySharedStatus::Busy; attempt++)
+    {
+        if (attempt > 0)
+        {
+            std::this_thread::yield();
+        }
+        status = base->sharedReader.OpenCurrent(base->indexView, base->sharedLease, base->sharedPublishCount);
+    }
+    if (status == OverlaySharedStatus::Busy && current)
+    {
+        // The app is publishing faster than we can open; keep the last one.
+        return SharedIndexUpdate::Unchanged;
+    }
+    if (status != OverlaySharedStatus::Ok)
+    {
+        return SharedIndexUpdate::Unavailable;
+    }
+
+    base->source = IndexSource::Shared;
+    base->sourceCount = base->indexView.SourceCount();
+    base->rootCount = base->indexView.EntryCount();
+    // The segment already includes the journal; an empty path makes a later
+    // fall back to the files reload them.
+    ResetBase(std::move(base), IndexSource::Shared, std::wstring(), {});
+    return SharedIndexUpdate::Changed;
+}
+
+// Reads a file the app rewrites in one piece (sync-status.txt,
+// synced-exclusions.idx) whole; fails past maxBytes.
+bool ReadSmallFile(const std::wstring &filePath, LONGLONG maxBytes, std::string &text)
+{
+    HANDLE file = CreateFileW(
+        filePath.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size = {};
     DWORD read = 0;
-    const BOOL ok = ReadFile(file, bytes.data(), static_cast<DWORD>(bytes.size()), &read, nullptr);
+    bool ok = GetFileSizeEx(file, &size) && size.QuadPart <= maxBytes;
+    if (ok && size.QuadPart > 0)
+    {
+        text.resize(static_cast<size_t>(size.QuadPart));
+        ok = ReadFile(file, text.data(), static_cast<DWORD>(text.size()), &read, nullptr);
+        text.resize(ok ? read : 0);
+    }
+
     CloseHandle(file);
+    return ok;
+}
 
-    if (!ok || read == 0)
+// Reloads the transient states when sync-status.txt changed. Returns true
+// when the snapshot needs republishing.
+bool ReloadStatus(const std::wstring &statusPath)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attrs = {};
+    if (!GetFileAttributesExW(statusPath.c_str(), GetFileExInfoStandard, &attrs))
     {
+        if (!g_currentStatus)
+        {
+            return false;
+        }
+        g_currentStatus.reset();
+        g_statusWriteTime = {};
         return true;
     }
 
-    bytes.resize(read);
+    if (g_currentStatus && FileTimeEqual(attrs.ftLastWriteTime, g_statusWriteTime))
+    {
+        return false;
+    }
+
+    std::string text;
+    std::unique_ptr<COverlayStatusSet> status(new (std::nothrow) COverlayStatusSet());
+    if (!status || !ReadSmallFile(statusPath, kMaxStatusBytes, text))
+    {
+        // Keep the previous states; the next change retries.
+        return false;
+    }
+
+    status->Parse(text);
+    g_statusWriteTime = attrs.ftLastWriteTime;
+    g_currentStatus = std::move(status);
+    return true;
+}
+
+// Reloads the compiled exclusion rules when synced-exclusions.idx changed.
+// Returns true when the snapshot needs republishing.
+bool ReloadExclusions(const std::wstring &exclusionsPath)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attrs = {};
+    if (!GetFileAttributesExW(exclusionsPath.c_str(), GetFileExInfoStandard, &attrs))
+    {
+        if (!g_currentExclusions)
+        {
+            return false;
+        }
+        g_currentExclusions.reset();
+        g_exclusionsWriteTime = {};
+        return true;
+    }
 
-    int wideLen = MultiByteToWideChar(CP_UTF8, 0, bytes.data(), static_cast<int>(bytes.size()), nullptr, 0);
-    if (wideLen <= 0)
+    if (g_currentExclusions && FileTimeEqual(attrs.ftLastWriteTime, g_exclusionsWriteTime))
     {
         return false;
     }
 
-    std::wstring content(static_cast<size_t>(wideLen), L'\0');
-    if (MultiByteToWideChar(CP_UTF8, 0, bytes.data(), static_cast<int>(bytes.size()), content.data(), wideLen) <= 0)
+    std::string bytes;
+    std::unique_ptr<CExclusionMatcher> exclusions(new (std::nothrow) CExclusionMatcher());
+    if (!exclusions || !ReadSmallFile(exclusionsPath, kMaxExclusionBytes, bytes) ||
+        exclusions->Load(bytes.data(), bytes.size()) != OverlayIndexStatus::Ok)
     {
+        // Keep the previous rules; a torn write is followed by another change.
         return false;
     }
 
-    size_t start = 0;
-    while (start < content.length())
+    g_exclusionsWriteTime = attrs.ftLastWriteTime;
+    g_currentExclusions = std::move(exclusions);
+    return true;
+}
+
+// Publishes the current base, journal layer, states and exclusions as a new
+// snapshot.
+void PublishSnapshot()
+{
+    std::unique_ptr<SyncedRootsSnapshot> snapshot;
+    if (g_currentBase || (g_currentStatus && !g_currentStatus->Empty()))
+    {
+        snapshot.reset(new (std::nothrow) SyncedRootsSnapshot());
+    }
+    if (snapshot)
+    {
+        snapshot->generation = ++g_snapshotGeneration;
+        snapshot->base = g_currentBase;
+        snapshot->journal = g_currentJournal;
+        snapshot->status = g_currentStatus;
+        snapshot->exclusions = g_currentExclusions && !g_currentExclusions->Empty() ? g_currentExclusions : nullptr;
+    }
+
+    CShellStats &stats = ProcessShellStats();
+    const size_t journaled = g_currentBase ? g_currentJournal.Size() : 0;
+    stats.SetGauge(ShellGauge::IndexSource, static_cast<uint64_t>(g_currentBase ? g_currentBase->source : IndexSource::None));
+    stats.SetGauge(ShellGauge::SourcePaths, g_currentBase ? g_currentBase->sourceCount + journaled : 0);
+    stats.SetGauge(ShellGauge::CoveringRoots, g_currentBase ? g_currentBase->rootCount + journaled : 0);
+    stats.SetGauge(ShellGauge::IndexBytes, g_currentBase ? g_currentBase->MemoryBytes() : 0);
+    stats.SetGauge(ShellGauge::SnapshotGeneration, g_snapshotGeneration);
+
+    // Waits for readers still on the snapshot being replaced.
+    CShellStatsTimer wait(stats, ShellTimer::PublishWait);
+    g_syncedRoots.Publish(std::move(snapshot));
+}
+
+bool ShouldReload()
+{
+    if (g_indexMonitor.IsRunning())
+    {
+        return g_indexMonitor.HasPendingChange();
+    }
+
+    // No watcher thread: probe at most once per interval on the calling thread.
+    const ULONGLONG now = GetTickCount64();
+    ULONGLONG lastProbe = g_lastCacheProbeTick.load(std::memory_order_relaxed);
+    return (now - lastProbe) >= kCacheRefreshIntervalMs &&
+           g_lastCacheProbeTick.compare_exchange_strong(lastProbe, now, std::memory_order_relaxed);
+}
+
+// Reloads the synced roots from the shared index, or else from whichever
+// index file is current. Returns true when the snapshot needs republishing.
+bool ReloadRoots(const IndexPaths &paths)
+{
+    const SharedIndexUpdate shared = ReloadSharedIndex();
+    if (shared != SharedIndexUpdate::Unavailable)
+    {
+        return shared == SharedIndexUpdate::Changed;
+    }
+
+    const std::wstring &indexPath = paths.binaryIndex;
+    const bool sameIndexFile = (g_cachedIndexPath == indexPath);
+
+    WIN32_FILE_ATTRIBUTE_DATA attrs = {};
+    if (GetFileAttributesExW(indexPath.c_str(), GetFileExInfoStandard, &attrs))
     {
-        size_t end = content.find(L'\n', start);
-        if (end == std::wstring::npos)
+        const bool fileChanged = !sameIndexFile || g_cachedSource != IndexSource::Binary ||
+                                 !FileTimeEqual(attrs.ftLastWriteTime, g_cachedWriteTime);
+        if (!fileChanged)
         {
-            end = content.length();
+            // Same base: only the journal tail can have grown.
+            const JournalUpdate update = ApplyJournalTail(paths.journal);
+            if (update != JournalUpdate::Restarted)
+            {
+                return update == JournalUpdate::Changed;
+            }
         }
 
-        std::wstring line = content.substr(start, end - start);
-        if (!line.empty() && line.back() == L'\r')
+        std::unique_ptr<SyncedRootsBase> base;
+        const OverlayIndexStatus status = LoadBinaryIndex(indexPath, base);
+        if (status == OverlayIndexStatus::Ok)
         {
-            line.pop_back();
+            ResetBase(std::move(base), IndexSource::Binary, indexPath, attrs.ftLastWriteTime);
+            ApplyJournalTail(paths.journal);
+            return true;
         }
 
-        if (!line.empty())
+        if (status == OverlayIndexStatus::ChecksumMismatch && sameIndexFile && g_cachedSource != IndexSource::None)
         {
-            paths.push_back(NormalizePath(line));
+            // Torn read while the app rewrites the index: keep answering from
+            // the previous snapshot and retry on the next probe.
+            return false;
         }
+    }
 
-        if (end == content.length())
+    // Fall back to the plain text index written by older app versions or
+    // when the native writer is unavailable. The journal only ever extends
+    // the binary index.
+    if (!GetFileAttributesExW(paths.textIndex.c_str(), GetFileExInfoStandard, &attrs))
+    {
+        if (!sameIndexFile || g_cachedSource != IndexSource::None)
         {
-            break;
+            ResetBase(nullptr, IndexSource::None, indexPath, {});
+            return true;
         }
-        start = end + 1;
+        return false;
+    }
+
+    const bool fileChanged = !sameIndexFile || g_cachedSource != IndexSource::Text ||
+                             !FileTimeEqual(attrs.ftLastWriteTime, g_cachedWriteTime);
+    if (!fileChanged)
+    {
+        return false;
     }
 
+    CPathArena loaded;
+    size_t lineCount = 0;
+    std::unique_ptr<SyncedRootsBase> base(new (std::nothrow) SyncedRootsBase());
+    if (base && LoadSyncedPathListFile(std::filesystem::path(paths.textIndex), loaded, lineCount))
+    {
+        base->source = IndexSource::Text;
+        base->sourceCount = lineCount;
+        base->rootCount = loaded.Size();
+        base->trie.Build(loaded);
+        ResetBase(std::move(base), IndexSource::Text, indexPath, attrs.ftLastWriteTime);
+    }
+    else
+    {
+        ResetBase(nullptr, IndexSource::None, indexPath, {});
+    }
     return true;
 }
 
-void RefreshSyncedRootsCache(const std::wstring &indexPath)
+// One reload pass: on the loader thread, or inline when it is not running.
+// Never waits for another pass; if one is in progress, keeps the current
+// snapshot.
+void ReloadSnapshot(const IndexPaths &paths)
 {
-    std::lock_guard<std::mutex> guard(g_cacheMutex);
-
-    const ULONGLONG now = GetTickCount64();
-    const bool recentlyChecked = (now - g_lastCacheProbeTick) < kCacheRefreshIntervalMs;
-    const bool sameIndexFile = (g_cachedIndexPath == indexPath);
-    if (recentlyChecked && sameIndexFile)
+    CShellStats &stats = ProcessShellStats();
+    std::unique_lock<std::mutex> lock(g_reloadMutex, std::defer_lock);
+    {
+        CShellStatsTimer wait(stats, ShellTimer::ReloadLockWait);
+        lock.try_lock();
+    }
+    if (!lock.owns_lock())
     {
+        stats.Count(ShellCounter::ReloadsSkipped);
         return;
     }
 
-    g_lastCacheProbeTick = now;
+    CShellStatsTimer timer(stats, ShellTimer::Reload);
+    stats.Count(ShellCounter::Reloads);
 
-    WIN32_FILE_ATTRIBUTE_DATA attrs = {};
-    const bool exists = GetFileAttributesExW(indexPath.c_str(), GetFileExInfoStandard, &attrs) != 0;
-    if (!exists)
+    // Claim the change before reading so a write that lands mid-reload
+    // triggers another one.
+    g_indexMonitor.ConsumeChange();
+
+    const bool rootsChanged = ReloadRoots(paths);
+    const bool statusChanged = ReloadStatus(paths.status);
+    const bool exclusionsChanged = ReloadExclusions(paths.exclusions);
+    if (rootsChanged || statusChanged || exclusionsChanged)
     {
-        g_cachedIndexPath = indexPath;
-        g_cachedSyncedRoots.clear();
-        g_cachedWriteTime = {};
-        return;
+        PublishSnapshot();
+        stats.Count(ShellCounter::ReloadsPublished);
     }
+    stats.SetGauge(ShellGauge::LastReloadNs, timer.ElapsedNs());
+}
 
-    const bool fileChanged = !sameIndexFile || !FileTimeEqual(attrs.ftLastWriteTime, g_cachedWriteTime);
-    if (!fileChanged)
+// Fallback when the loader thread could not start: the calling thread
+// reloads, doing no I/O unless the index changed.
+void RefreshInline(const IndexPaths &paths, bool force)
+{
+    if (force || ShouldReload())
     {
-        return;
+        ReloadSnapshot(paths);
     }
+}
 
-    std::vector<std::wstring> loaded;
-    if (ReadSyncedPathList(indexPath, loaded))
+// Starts the watcher and the loader on first use (and again after
+// ShutdownSyncOverlayCache). Returns whether the loader is running.
+bool EnsureBackgroundLoader(const IndexPaths &paths)
+{
+    if (g_reloader.IsRunning() && g_indexMonitor.IsRunning())
     {
-        g_cachedSyncedRoots = std::move(loaded);
-        g_cachedWriteTime = attrs.ftLastWriteTime;
-        g_cachedIndexPath = indexPath;
+        return true;
     }
-    else
+
+    std::unique_lock<std::mutex> lock(g_monitorMutex, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        return g_reloader.IsRunning();
+    }
+
+    if (!g_reloader.IsRunning())
+    {
+        g_reloader.Start([&paths](uint64_t requests) {
+            ProcessShellStats().Count(ShellCounter::ReloadsCoalesced, requests - 1);
+            ReloadSnapshot(paths);
+        });
+    }
+    if (!g_indexMonitor.IsRunning())
+    {
+        const std::filesystem::path index(paths.binaryIndex);
+        g_indexMonitor.SetChangeCallback([]() { g_reloader.Request(); });
+        g_indexMonitor.Start(index.parent_path(),
+                             {index, std::filesystem::path(paths.textIndex), std::filesystem::path(paths.journal),
+                              std::filesystem::path(paths.status), std::filesystem::path(paths.exclusions)},
+                             static_cast<uint32_t>(kCacheRefreshIntervalMs));
+    }
+    return g_reloader.IsRunning();
+}
+
+DWORD ColdStartWaitMs()
+{
+    static const DWORD waitMs = []() {
+        DWORD value = 0;
+        DWORD size = sizeof(value);
+        if (RegGetValueW(HKEY_CURRENT_USER, kSettingsKey, kColdStartWaitValue, RRF_RT_REG_DWORD, nullptr, &value,
+                         &size) != ERROR_SUCCESS)
+        {
+            return DWORD{0};
+        }
+        return std::min(value, kMaxColdStartWaitMs);
+    }();
+    return waitMs;
+}
+
+HRESULT CombineLocalAppDataPath(PCWSTR localAppData, PCWSTR fileName, std::wstring &path)
+{
+    WCHAR combined[MAX_PATH];
+    const HRESULT hr = PathCchCombine(combined, ARRAYSIZE(combined), localAppData, fileName);
+    if (SUCCEEDED(hr))
     {
-        g_cachedIndexPath = indexPath;
-        g_cachedSyncedRoots.clear();
-        g_cachedWriteTime = {};
+        path = combined;
     }
+    return hr;
+}
+
+// The index lives at a fixed place for the life of the process.
+const IndexPaths &GetIndexPaths()
+{
+    static const IndexPaths paths = []() {
+        IndexPaths resolved;
+        PWSTR localAppData = nullptr;
+        resolved.hr = SHGetKnownFolderPath(FOLDERID_LocalAppData, KF_FLAG_DEFAULT, nullptr, &localAppData);
+        if (SUCCEEDED(resolved.hr))
+        {
+            resolved.hr = CombineLocalAppDataPath(localAppData, kBinaryIndexFile, resolved.binaryIndex);
+        }
+        if (SUCCEEDED(resolved.hr))
+        {
+            resolved.hr = CombineLocalAppDataPath(localAppData, kTextIndexFile, resolved.textIndex);
+        }
+        if (SUCCEEDED(resolved.hr))
+        {
+            resolved.hr = CombineLocalAppDataPath(localAppData, kJournalFile, resolved.journal);
+        }
+        if (SUCCEEDED(resolved.hr))
+        {
+            resolved.hr = CombineLocalAppDataPath(localAppData, kStatusFile, resolved.status);
+        }
+        if (SUCCEEDED(resolved.hr))
+        {
+            resolved.hr = CombineLocalAppDataPath(localAppData, kExclusionFile, resolved.exclusions);
+        }
+        CoTaskMemFree(localAppData);
+        return resolved;
+    }();
+    return paths;
+}
+
+PCWSTR OverlayIconFile(OverlayState state)
+{
+    switch (state)
+    {
+    case OverlayState::Syncing: return L"syncing-icon.ico";
+    case OverlayState::Error: return L"error-icon.ico";
+    case OverlayState::Pending: return L"pending-icon.ico";
+    default: return L"sync-icon.ico";
+    }
+}
+
+// State of a path for every overlay handler. The first handler Explorer asks
+// about an item does the lookup; the rest get the thread's last query.
+OverlayState ResolveOverlayState(LPCWSTR pwszPath)
+{
+    const IndexPaths &paths = GetIndexPaths();
+    if (FAILED(paths.hr))
+    {
+        return OverlayState::None;
+    }
+
+    // Reloads happen on the loader thread; this one only answers from the
+    // published snapshot and, at most, asks for a reload.
+    const bool background = EnsureBackgroundLoader(paths);
+    CShellStats &stats = ProcessShellStats();
+    if (background && g_reloader.ReloadCount() == 0)
+    {
+        const DWORD waitMs = ColdStartWaitMs();
+        if (waitMs == 0 || !g_reloader.WaitForReload(0, waitMs))
+        {
+            stats.Count(ShellCounter::ColdStartAnswers);
+        }
+    }
+    else if (background && !g_indexMonitor.IsRunning() && ShouldReload())
+    {
+        g_reloader.Request();
+    }
+
+    thread_local CLastOverlayQuery lastQuery;
+    thread_local CParentVerdictMemo parentMemo;
+    bool force = false;
+    for (int attempt = 0; attempt <= kTornLookupRetries; attempt++)
+    {
+        if (!background)
+        {
+            RefreshInline(paths, force);
+        }
+        else if (force)
+        {
+            // Wait briefly for the loader, holding no snapshot: publishing
+            // waits out readers of the old one.
+            const uint64_t seen = g_reloader.ReloadCount();
+            g_reloader.RequestNow();
+            g_reloader.WaitForReload(seen, kTornReloadWaitMs);
+        }
+
+        const auto snapshot = g_syncedRoots.Read();
+        if (!snapshot)
+        {
+            return OverlayState::None;
+        }
+        if (!snapshot->IsCurrent())
+        {
+            // The app published a newer shared index; one atomic load told us.
+            if (background)
+            {
+                g_reloader.RequestNow();
+            }
+            else if (attempt < kTornLookupRetries)
+            {
+                force = true;
+                continue;
+            }
+        }
+
+        bool lookedUp = false;
+        const OverlayState state = lastQuery.Resolve(snapshot->generation, std::wstring_view(pwszPath), [&]() {
+            // Steady state allocates nothing: paths are resolved once, the
+            // query is normalized on the stack and everything below works on
+            // views.
+            lookedUp = true;
+            const CNormalizedPath target{std::wstring_view(pwszPath)};
+            if (snapshot->status)
+            {
+                const OverlayState transient = snapshot->status->Classify(target.View());
+                if (transient != OverlayState::None && !snapshot->IsExcluded(target.View()))
+                {
+                    return transient;
+                }
+            }
+
+            // Siblings arrive in bursts; answer them from their parent's verdict.
+            bool classified = false;
+            bool matched = false;
+            const bool synced = parentMemo.Resolve(
+                snapshot->generation,
+                target.View(),
+                [&](std::wstring_view parentWithSeparator) {
+                    classified = true;
+                    return snapshot->Classify(parentWithSeparator);
+                },
+                [&](std::wstring_view path) {
+                    matched = true;
+                    return snapshot->Matches(path);
+                });
+            if (classified)
+            {
+                stats.Count(ShellCounter::ParentMemoMisses);
+            }
+            else if (!matched)
+            {
+                stats.Count(ShellCounter::ParentMemoHits);
+            }
+            return synced ? OverlayState::Synced : OverlayState::None;
+        });
+        stats.Count(lookedUp ? ShellCounter::OverlayLookups : ShellCounter::LastQueryHits);
+
+        if (snapshot->IsStable())
+        {
+            return state;
+        }
+
+        // The app came round to the shared slot this snapshot reads while we
+        // were in it; nothing cached from it can be trusted.
+        stats.Count(ShellCounter::TornLookups);
+        lastQuery.Clear();
+        parentMemo.Clear();
+        force = true;
+    }
+    return OverlayState::None;
 }
 } // namespace
 
-CSyncOverlayIcon::CSyncOverlayIcon() : m_cRef(1)
+void ShutdownSyncOverlayCache()
+{
+    // Called from DllCanUnloadNow; the watcher and loader threads must be
+    // gone before the DLL can be unloaded. A later lookup restarts them.
+    std::lock_guard<std::mutex> lock(g_monitorMutex);
+    g_indexMonitor.Stop();
+    g_reloader.Stop();
+}
+
+CSyncOverlayIcon::CSyncOverlayIcon(OverlayState state) : m_cRef(1), m_state(state)
 {
     InterlockedIncrement(&g_cDllRef);
 }
@@ -246,7 +1059,10 @@ IFACEMETHODIMP CSyncOverlayIcon::IsMemberOf(LPCWSTR pwszPath, DWORD dwAttrib)
         return S_FALSE;
     }
 
-    return IsPathSynced(pwszPath) ? S_OK : S_FALSE;
+    CShellStats &stats = ProcessShellStats();
+    CShellStatsTimer timer(stats, ShellTimer::IsMemberOf);
+    stats.Count(ShellCounter::IsMemberOfCalls);
+    return ResolveOverlayState(pwszPath) == m_state ? S_OK : S_FALSE;
 }
 
 IFACEMETHODIMP CSyncOverlayIcon::GetOverlayInfo(LPWSTR pwszIconFile, int cchMax, int *pIndex, DWORD *pdwFlags)
@@ -256,32 +1072,14 @@ IFACEMETHODIMP CSyncOverlayIcon::GetOverlayInfo(LPWSTR pwszIconFile, int cchMax,
         return E_INVALIDARG;
     }
 
-    WCHAR szDllPath[MAX_PATH];
-    if (GetModuleFileNameW(g_hModule, szDllPath, ARRAYSIZE(szDllPath)) == 0)
-    {
-        return HRESULT_FROM_WIN32(GetLastError());
-    }
-
-    HRESULT hr = PathCchRemoveFileSpec(szDllPath, ARRAYSIZE(szDllPath));
-    if (FAILED(hr))
-    {
-        return hr;
-    }
-
-    hr = PathCchRemoveFileSpec(szDllPath, ARRAYSIZE(szDllPath));
-    if (FAILED(hr))
-    {
-        return hr;
-    }
-
-    WCHAR szIconPath[MAX_PATH];
-    hr = PathCchCombine(szIconPath, ARRAYSIZE(szIconPath), szDllPath, L"resources\\assets\\sync-icon.ico");
-    if (FAILED(hr))
+    const ModulePaths &paths = GetModulePaths();
+    if (FAILED(paths.hr))
     {
-        return hr;
+        return paths.hr;
     }
 
-    hr = StringCchCopyW(pwszIconFile, static_cast<size_t>(cchMax), szIconPath);
+    const HRESULT hr =
+        PathCchCombine(pwszIconFile, static_cast<size_t>(cchMax), paths.assetsDir, OverlayIconFile(m_state));
     if (FAILED(hr))
     {
         return hr;
@@ -299,49 +1097,7 @@ IFACEMETHODIMP CSyncOverlayIcon::GetPriority(int *pPriority)
         return E_INVALIDARG;
     }
 
+    // A path resolves to a single state, so our handlers never compete.
     *pPriority = 0;
     return S_OK;
 }
-
-HRESULT CSyncOverlayIcon::GetSyncedIndexPath(LPWSTR pszPath, DWORD cchPath)
-{
-    if (!pszPath || cchPath == 0)
-    {
-        return E_INVALIDARG;
-    }
-
-    PWSTR localAppData = nullptr;
-    const HRESULT hr = SHGetKnownFolderPath(FOLDERID_LocalAppData, KF_FLAG_DEFAULT, nullptr, &localAppData);
-    if (FAILED(hr))
-    {
-        return hr;
-    }
-
-    HRESULT combineHr = PathCchCombine(pszPath, cchPath, localAppData, L"RRightclickrr\\synced-paths.txt");
-    CoTaskMemFree(localAppData);
-    return combineHr;
-}
-
-bool CSyncOverlayIcon::IsPathSynced(LPCWSTR pwszPath)
-{
-    WCHAR szIndexPath[MAX_PATH];
-    if (FAILED(GetSyncedIndexPath(szIndexPath, ARRAYSIZE(szIndexPath))))
-    {
-        return false;
-    }
-
-    const std::wstring normalizedTarget = NormalizePath(std::wstring(pwszPath));
-    RefreshSyncedRootsCache(szIndexPath);
-
-    std::lock_guard<std::mutex> guard(g_cacheMutex);
-    for (const std::wstring &syncedRoot : g_cachedSyncedRoots)
-    {
-        if (IsSameOrChildPath(normalizedTarget, syncedRoot))
-        {
-            return true;
-        }
-    }
-
-    return false;
-}
-
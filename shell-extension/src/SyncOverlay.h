@@ -4,11 +4,14 @@
 
 #include <windows.h>
 #include <shobjidl.h>
+#include "OverlayStatus.h"
 
+// One handler per overlay state (one CLSID each); all of them share a
+// single lookup per item.
 class CSyncOverlayIcon : public IShellIconOverlayIdentifier
 {
 public:
-    CSyncOverlayIcon();
+    explicit CSyncOverlayIcon(OverlayState state);
 
     // IUnknown
     IFACEMETHODIMP QueryInterface(REFIID riid, void **ppv) override;
@@ -23,9 +26,9 @@ public:
 private:
     ~CSyncOverlayIcon();
 
-    HRESULT GetSyncedIndexPath(LPWSTR pszPath, DWORD cchPath);
-    bool IsPathSynced(LPCWSTR pwszPath);
-
     long m_cRef;
+    OverlayState m_state;
 };
 
+// Stops the overlay cache's background index watcher and loader threads.
+void ShutdownSyncOverlayCache();
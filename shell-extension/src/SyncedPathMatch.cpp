@@ -0,0 +1,67 @@
+// RRightclickrr synced-path normalization and matching
+
+#include "SyncedPathMatch.h"
+#include "PathNormalize.h"
+#include <algorithm>
+#include <cstdint>
+
+std::wstring NormalizePath(std::wstring value)
+{
+    value.resize(NormalizePathInPlace(value.data(), value.size()));
+    return value;
+}
+
+bool IsSameOrChildPath(std::wstring_view candidate, std::wstring_view root)
+{
+    if (candidate == root)
+    {
+        return true;
+    }
+
+    if (candidate.length() <= root.length())
+    {
+        return false;
+    }
+
+    if (candidate.substr(0, root.length()) != root)
+    {
+        return false;
+    }
+
+    // Drive roots like "c:\" should match direct children.
+    if (!root.empty() && root.back() == L'\\')
+    {
+        return true;
+    }
+
+    return candidate[root.length()] == L'\\';
+}
+
+bool CoveringRootOrder(std::wstring_view lhs, std::wstring_view rhs)
+{
+    auto sortKey = [](wchar_t ch) { return ch == L'\\' ? 0u : static_cast<uint32_t>(ch) + 1; };
+    return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                                        [&](wchar_t a, wchar_t b) { return sortKey(a) < sortKey(b); });
+}
+
+void ReduceToCoveringRoots(std::vector<std::wstring> &paths)
+{
+    std::sort(paths.begin(), paths.end(),
+              [](const std::wstring &lhs, const std::wstring &rhs) { return CoveringRootOrder(lhs, rhs); });
+
+    // A path covered by an earlier root is covered by the last root kept.
+    size_t kept = 0;
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        if (kept > 0 && IsSameOrChildPath(paths[i], paths[kept - 1]))
+        {
+            continue;
+        }
+        if (kept != i)
+        {
+            paths[kept] = std::move(paths[i]);
+        }
+        kept++;
+    }
+    paths.resize(kept);
+}
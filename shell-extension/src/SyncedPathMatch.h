@@ -0,0 +1,28 @@
+// RRightclickrr synced-path normalization and matching
+//
+// Platform-independent: shared by the overlay handler and the Linux bench.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Lowercases (like JavaScript's toLowerCase, independent of the C locale),
+// converts '/' to '\' and trims trailing separators (keeping drive roots such
+// as "c:\" intact). See PathNormalize.h.
+std::wstring NormalizePath(std::wstring value);
+
+// Reference matcher: true when candidate equals root or lies beneath it.
+// Both arguments must already be normalized.
+bool IsSameOrChildPath(std::wstring_view candidate, std::wstring_view root);
+
+// Lexicographic order with the separator below every other character, so
+// each root is immediately followed by everything beneath it ("a", "a\b",
+// "a-b" rather than "a", "a-b", "a\b").
+bool CoveringRootOrder(std::wstring_view lhs, std::wstring_view rhs);
+
+// Sorts normalized paths and drops every path another one already covers,
+// leaving the minimal set of roots that answers IsSameOrChildPath the same
+// way for any query. O(n log n).
+void ReduceToCoveringRoots(std::vector<std::wstring> &paths);
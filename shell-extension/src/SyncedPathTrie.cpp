@@ -0,0 +1,267 @@
+// RRightclickrr path-component trie over synced roots
+
+#include "SyncedPathTrie.h"
+#include "PathArena.h"
+
+namespace
+{
+constexpr wchar_t kSeparator = L'\\';
+constexpr size_t kInitialSlots = 64;
+} // namespace
+
+CSyncedPathTrie::CSyncedPathTrie() : m_rootCount(0)
+{
+    Clear();
+}
+
+void CSyncedPathTrie::Clear()
+{
+    m_nodes.assign(1, Node{0, 0, 0, 0, 0});
+    m_labels.clear();
+    m_slots.assign(kInitialSlots, 0);
+    m_rootCount = 0;
+}
+
+void CSyncedPathTrie::Build(const std::vector<std::wstring> &roots)
+{
+    ClearForBuild(roots.size());
+    for (const std::wstring &root : roots)
+    {
+        Insert(root);
+    }
+}
+
+void CSyncedPathTrie::Build(const CPathArena &roots)
+{
+    ClearForBuild(roots.Size());
+    for (size_t i = 0; i < roots.Size(); i++)
+    {
+        Insert(roots[i]);
+    }
+}
+
+void CSyncedPathTrie::ClearForBuild(size_t rootCount)
+{
+    Clear();
+
+    size_t slotCount = kInitialSlots;
+    while (slotCount < rootCount * 4)
+    {
+        slotCount *= 2;
+    }
+    m_slots.assign(slotCount, 0);
+    m_nodes.reserve(rootCount + 1);
+}
+
+void CSyncedPathTrie::Insert(std::wstring_view root)
+{
+    // A root ending in a separator ("c:\") matches strictly beneath its
+    // prefix; any other root also matches the path itself.
+    uint8_t flags = kMatchSelf | kMatchDescendants;
+    if (!root.empty() && root.back() == kSeparator)
+    {
+        root.remove_suffix(1);
+        flags = kMatchDescendants;
+    }
+
+    uint32_t node = 0;
+    size_t start = 0;
+    for (;;)
+    {
+        const size_t end = root.find(kSeparator, start);
+        const std::wstring_view label = root.substr(start, end == std::wstring_view::npos ? std::wstring_view::npos : end - start);
+        const uint32_t hash = HashLabel(node, label);
+
+        uint32_t child = FindChild(node, label, hash);
+        if (child == 0)
+        {
+            child = AddChild(node, label, hash);
+        }
+        node = child;
+
+        if (end == std::wstring_view::npos)
+        {
+            break;
+        }
+        start = end + 1;
+    }
+
+    if ((m_nodes[node].flags & (kMatchSelf | kMatchDescendants)) == 0)
+    {
+        m_rootCount++;
+    }
+    m_nodes[node].flags |= flags;
+}
+
+bool CSyncedPathTrie::Matches(std::wstring_view path) const
+{
+    if (m_rootCount == 0)
+    {
+        return false;
+    }
+
+    uint32_t node = 0;
+    size_t start = 0;
+    for (;;)
+    {
+        const size_t end = path.find(kSeparator, start);
+        const bool last = (end == std::wstring_view::npos);
+        const std::wstring_view label = path.substr(start, last ? std::wstring_view::npos : end - start);
+
+        node = FindChild(node, label, HashLabel(node, label));
+        if (node == 0)
+        {
+            return false;
+        }
+
+        const uint8_t flags = m_nodes[node].flags;
+        if (last)
+        {
+            return (flags & kMatchSelf) != 0;
+        }
+        if (flags & kMatchDescendants)
+        {
+            return true;
+        }
+
+        start = end + 1;
+    }
+}
+
+bool CSyncedPathTrie::HasRootAtOrBelow(std::wstring_view path) const
+{
+    if (m_rootCount == 0)
+    {
+        return false;
+    }
+
+    // Nodes only exist on the way to some root, so reaching path's node is
+    // enough.
+    uint32_t node = 0;
+    size_t start = 0;
+    for (;;)
+    {
+        const size_t end = path.find(kSeparator, start);
+        const std::wstring_view label = path.substr(start, end == std::wstring_view::npos ? std::wstring_view::npos : end - start);
+
+        node = FindChild(node, label, HashLabel(node, label));
+        if (node == 0)
+        {
+            return false;
+        }
+        if (end == std::wstring_view::npos)
+        {
+            return true;
+        }
+        start = end + 1;
+    }
+}
+
+std::vector<std::wstring> CSyncedPathTrie::Roots() const
+{
+    std::vector<std::wstring> roots;
+    roots.reserve(m_rootCount);
+
+    std::vector<uint32_t> chain;
+    for (uint32_t index = 1; index < m_nodes.size(); index++)
+    {
+        const uint8_t flags = m_nodes[index].flags;
+        if (flags == 0)
+        {
+            continue;
+        }
+
+        chain.clear();
+        for (uint32_t node = index; node != 0; node = m_nodes[node].parent)
+        {
+            chain.push_back(node);
+        }
+
+        std::wstring root;
+        for (size_t i = chain.size(); i-- > 0;)
+        {
+            const Node &node = m_nodes[chain[i]];
+            root.append(m_labels, node.labelOffset, node.labelLength);
+            if (i > 0)
+            {
+                root.push_back(kSeparator);
+            }
+        }
+        if ((flags & kMatchSelf) == 0)
+        {
+            root.push_back(kSeparator);
+        }
+        roots.push_back(std::move(root));
+    }
+    return roots;
+}
+
+uint32_t CSyncedPathTrie::FindChild(uint32_t parent, std::wstring_view label, uint32_t hash) const
+{
+    const size_t mask = m_slots.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+        const uint32_t candidate = m_slots[slot];
+        if (candidate == 0)
+        {
+            return 0;
+        }
+
+        const Node &node = m_nodes[candidate];
+        if (node.hash == hash && node.parent == parent &&
+            std::wstring_view(m_labels.data() + node.labelOffset, node.labelLength) == label)
+        {
+            return candidate;
+        }
+    }
+}
+
+uint32_t CSyncedPathTrie::AddChild(uint32_t parent, std::wstring_view label, uint32_t hash)
+{
+    // Keep the table at most half full so probes stay short.
+    if ((m_nodes.size() + 1) * 2 > m_slots.size())
+    {
+        Rehash(m_slots.size() * 2);
+    }
+
+    const uint32_t index = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.push_back(Node{parent, hash, static_cast<uint32_t>(m_labels.size()), static_cast<uint32_t>(label.size()), 0});
+    m_labels.append(label.data(), label.size());
+
+    const size_t mask = m_slots.size() - 1;
+    size_t slot = hash & mask;
+    while (m_slots[slot] != 0)
+    {
+        slot = (slot + 1) & mask;
+    }
+    m_slots[slot] = index;
+    return index;
+}
+
+void CSyncedPathTrie::Rehash(size_t slotCount)
+{
+    m_slots.assign(slotCount, 0);
+    const size_t mask = slotCount - 1;
+    for (uint32_t index = 1; index < m_nodes.size(); index++)
+    {
+        size_t slot = m_nodes[index].hash & mask;
+        while (m_slots[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        m_slots[slot] = index;
+    }
+}
+
+uint32_t CSyncedPathTrie::HashLabel(uint32_t parent, std::wstring_view label)
+{
+    // FNV-1a over the parent id and the label's code units.
+    uint32_t hash = 2166136261u ^ parent;
+    hash *= 16777619u;
+    for (wchar_t ch : label)
+    {
+        hash ^= static_cast<uint32_t>(ch);
+        hash *= 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,81 @@
+// RRightclickrr path-component trie over synced roots
+//
+// Answers "is this path a synced root or beneath one" in time proportional to
+// the number of components in the queried path, however many roots are
+// indexed. Platform-independent so it can be exercised by the Linux bench.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class CPathArena;
+
+class CSyncedPathTrie
+{
+public:
+    CSyncedPathTrie();
+
+    // Replaces the contents with the given normalized roots.
+    void Build(const std::vector<std::wstring> &roots);
+    void Build(const CPathArena &roots);
+
+    // Adds a single normalized root.
+    void Insert(std::wstring_view root);
+
+    // Same answer as running IsSameOrChildPath against every inserted root.
+    bool Matches(std::wstring_view path) const;
+
+    // True when some root equals path or lies beneath it (including a root
+    // of path + "\\").
+    bool HasRootAtOrBelow(std::wstring_view path) const;
+
+    // Reconstructs the inserted roots (covered duplicates merged), in no
+    // particular order.
+    std::vector<std::wstring> Roots() const;
+
+    void Clear();
+    bool Empty() const { return m_rootCount == 0; }
+    size_t RootCount() const { return m_rootCount; }
+    size_t NodeCount() const { return m_nodes.size() - 1; }
+
+    // Heap bytes held, including spare capacity.
+    size_t MemoryBytes() const
+    {
+        return m_nodes.capacity() * sizeof(Node) + m_labels.capacity() * sizeof(wchar_t) +
+               m_slots.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    enum NodeFlags : uint8_t
+    {
+        kMatchSelf = 0x1,        // Root without a trailing separator: matches itself
+        kMatchDescendants = 0x2, // Any root: matches everything beneath it
+    };
+
+    struct Node
+    {
+        uint32_t parent;
+        uint32_t hash;
+        uint32_t labelOffset;
+        uint32_t labelLength;
+        uint8_t flags;
+    };
+
+    void ClearForBuild(size_t rootCount);
+    uint32_t FindChild(uint32_t parent, std::wstring_view label, uint32_t hash) const;
+    uint32_t AddChild(uint32_t parent, std::wstring_view label, uint32_t hash);
+    void Rehash(size_t slotCount);
+
+    static uint32_t HashLabel(uint32_t parent, std::wstring_view label);
+
+    // Node 0 is the implicit parent of every first component.
+    std::vector<Node> m_nodes;
+    std::wstring m_labels;
+    // Open-addressed (parent, label) -> node table; 0 marks an empty slot.
+    std::vector<uint32_t> m_slots;
+    size_t m_rootCount;
+};
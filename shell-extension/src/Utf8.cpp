@@ -0,0 +1,147 @@
+// RRightclickrr UTF-8 / UTF-16 conversion helpers
+
+#include "Utf8.h"
+#include <cstdint>
+
+namespace
+{
+constexpr char32_t kReplacement = 0xFFFD;
+
+void AppendCodePoint(char32_t cp, std::wstring &out)
+{
+    if (sizeof(wchar_t) == 2 && cp > 0xFFFF)
+    {
+        cp -= 0x10000;
+        out.push_back(static_cast<wchar_t>(0xD800 + (cp >> 10)));
+        out.push_back(static_cast<wchar_t>(0xDC00 + (cp & 0x3FF)));
+        return;
+    }
+    out.push_back(static_cast<wchar_t>(cp));
+}
+} // namespace
+
+void AppendUtf8AsWide(std::string_view utf8, std::wstring &out)
+{
+    const auto *bytes = reinterpret_cast<const uint8_t *>(utf8.data());
+    const size_t size = utf8.size();
+    out.reserve(out.size() + size);
+
+    size_t i = 0;
+    while (i < size)
+    {
+        const uint8_t lead = bytes[i];
+        if (lead < 0x80)
+        {
+            out.push_back(static_cast<wchar_t>(lead));
+            i++;
+            continue;
+        }
+
+        size_t length = 0;
+        char32_t cp = 0;
+        char32_t minimum = 0;
+        if ((lead & 0xE0) == 0xC0)
+        {
+            length = 2;
+            cp = lead & 0x1F;
+            minimum = 0x80;
+        }
+        else if ((lead & 0xF0) == 0xE0)
+        {
+            length = 3;
+            cp = lead & 0x0F;
+            minimum = 0x800;
+        }
+        else if ((lead & 0xF8) == 0xF0)
+        {
+            length = 4;
+            cp = lead & 0x07;
+            minimum = 0x10000;
+        }
+
+        bool valid = length != 0 && i + length <= size;
+        for (size_t k = 1; valid && k < length; k++)
+        {
+            const uint8_t trail = bytes[i + k];
+            valid = (trail & 0xC0) == 0x80;
+            cp = (cp << 6) | (trail & 0x3F);
+        }
+        valid = valid && cp >= minimum && cp <= 0x10FFFF && (cp < 0xD800 || cp > 0xDFFF);
+
+        if (!valid)
+        {
+            AppendCodePoint(kReplacement, out);
+            i++;
+            continue;
+        }
+
+        AppendCodePoint(cp, out);
+        i += length;
+    }
+}
+
+void AppendWideAsUtf16(std::wstring_view wide, std::u16string &out)
+{
+    out.reserve(out.size() + wide.size());
+    for (wchar_t ch : wide)
+    {
+        const char32_t cp = static_cast<char32_t>(ch);
+        if (sizeof(wchar_t) > 2 && cp > 0xFFFF)
+        {
+            const char32_t offset = cp - 0x10000;
+            out.push_back(static_cast<char16_t>(0xD800 + (offset >> 10)));
+            out.push_back(static_cast<char16_t>(0xDC00 + (offset & 0x3FF)));
+            continue;
+        }
+        out.push_back(static_cast<char16_t>(cp));
+    }
+}
+
+void AppendWideAsUtf8(std::wstring_view wide, std::string &out)
+{
+    out.reserve(out.size() + wide.size());
+    for (size_t i = 0; i < wide.size(); i++)
+    {
+        char32_t cp = static_cast<char32_t>(wide[i]);
+        if (sizeof(wchar_t) == 2 && cp >= 0xD800 && cp <= 0xDFFF)
+        {
+            const bool paired = cp <= 0xDBFF && i + 1 < wide.size() && static_cast<char32_t>(wide[i + 1]) >= 0xDC00 &&
+                                static_cast<char32_t>(wide[i + 1]) <= 0xDFFF;
+            if (paired)
+            {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (static_cast<char32_t>(wide[++i]) - 0xDC00);
+            }
+            else
+            {
+                cp = kReplacement;
+            }
+        }
+        else if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+        {
+            cp = kReplacement;
+        }
+
+        if (cp < 0x80)
+        {
+            out.push_back(static_cast<char>(cp));
+        }
+        else if (cp < 0x800)
+        {
+            out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000)
+        {
+            out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else
+        {
+            out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+}
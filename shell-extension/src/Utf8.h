@@ -0,0 +1,19 @@
+// RRightclickrr UTF-8 / UTF-16 conversion helpers
+//
+// Platform-independent replacements for MultiByteToWideChar so the overlay
+// core builds on Linux. wchar_t holds UTF-16 on Windows and UTF-32 elsewhere.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Decodes UTF-8 and appends it to out. Malformed sequences become U+FFFD.
+void AppendUtf8AsWide(std::string_view utf8, std::wstring &out);
+
+// Appends the UTF-16 encoding of a wide string.
+void AppendWideAsUtf16(std::wstring_view wide, std::u16string &out);
+
+// Appends the UTF-8 encoding of a wide string. Unpaired surrogates become
+// U+FFFD.
+void AppendWideAsUtf8(std::wstring_view wide, std::string &out);
@@ -7,6 +7,7 @@
 #include <strsafe.h>
 #include <new>
 #include "ExplorerCommand.h"
+#include "ModulePaths.h"
 #include "SyncOverlay.h"
 
 #pragma comment(lib, "shlwapi.lib")
@@ -15,13 +16,16 @@
 HMODULE g_hModule = nullptr;
 long g_cDllRef = 0;
 
-// GUIDs for our commands - MUST match AppxManifest.xml
+// GUIDs for our commands - MUST match AppxManifest.xml (commands: kCommandTable)
 // {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6A} - Root Menu (folder)
 // {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6E} - Root Menu (file)
 // {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6B} - Sync to Drive
 // {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6C} - Copy to Drive
 // {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6D} - Get Drive URL
-// {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6F} - Sync overlay icon
+// {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6F} - Sync overlay icon (synced)
+// {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A70} - Sync overlay icon (syncing)
+// {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A71} - Sync overlay icon (error)
+// {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A72} - Sync overlay icon (pending)
 
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved)
 {
@@ -30,6 +34,8 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserv
     case DLL_PROCESS_ATTACH:
         g_hModule = hModule;
         DisableThreadLibraryCalls(hModule);
+        // Menu callbacks only copy these; a failure is reported from there.
+        ResolveModulePaths(hModule);
         break;
     case DLL_THREAD_ATTACH:
     case DLL_THREAD_DETACH:
@@ -49,12 +55,14 @@ enum class ClassType
 class CClassFactory : public IClassFactory
 {
 public:
-    CClassFactory(CommandType type) : m_cRef(1), m_type(type), m_classType(ClassType::ExplorerCommand)
+    CClassFactory(CommandType type)
+        : m_cRef(1), m_type(type), m_classType(ClassType::ExplorerCommand), m_overlayState(OverlayState::None)
     {
         InterlockedIncrement(&g_cDllRef);
     }
 
-    CClassFactory(ClassType classType) : m_cRef(1), m_type(CommandType::RootMenuFolder), m_classType(classType)
+    CClassFactory(OverlayState overlayState)
+        : m_cRef(1), m_type(CommandType::RootMenuFolder), m_classType(ClassType::SyncOverlay), m_overlayState(overlayState)
     {
         InterlockedIncrement(&g_cDllRef);
     }
@@ -92,7 +100,7 @@ public:
 
         if (m_classType == ClassType::SyncOverlay)
         {
-            CSyncOverlayIcon *pOverlay = new (std::nothrow) CSyncOverlayIcon();
+            CSyncOverlayIcon *pOverlay = new (std::nothrow) CSyncOverlayIcon(m_overlayState);
             if (!pOverlay)
                 return E_OUTOFMEMORY;
 
@@ -101,13 +109,7 @@ public:
             return hr;
         }
 
-        CExplorerCommand *pCommand = new (std::nothrow) CExplorerCommand(m_type);
-        if (!pCommand)
-            return E_OUTOFMEMORY;
-
-        HRESULT hr = pCommand->QueryInterface(riid, ppv);
-        pCommand->Release();
-        return hr;
+        return CreateExplorerCommand(m_type, riid, ppv);
     }
 
     IFACEMETHODIMP LockServer(BOOL fLock)
@@ -128,50 +130,49 @@ private:
     long m_cRef;
     CommandType m_type;
     ClassType m_classType;
+    OverlayState m_overlayState;
 };
 
-// CLSIDs
-// {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6A} - Root Menu (folder)
-static const CLSID CLSID_RootMenuFolder =
-{ 0x7b3b5e52, 0xa1f0, 0x4c5e, { 0x9b, 0x8a, 0x1c, 0x2d, 0x3e, 0x4f, 0x5a, 0x6a } };
-
-// {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6E} - Root Menu (file)
-static const CLSID CLSID_RootMenuFile =
-{ 0x7b3b5e52, 0xa1f0, 0x4c5e, { 0x9b, 0x8a, 0x1c, 0x2d, 0x3e, 0x4f, 0x5a, 0x6e } };
-
-// {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6B}
-static const CLSID CLSID_SyncToDrive =
-{ 0x7b3b5e52, 0xa1f0, 0x4c5e, { 0x9b, 0x8a, 0x1c, 0x2d, 0x3e, 0x4f, 0x5a, 0x6b } };
-
-// {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6C}
-static const CLSID CLSID_CopyToDrive =
-{ 0x7b3b5e52, 0xa1f0, 0x4c5e, { 0x9b, 0x8a, 0x1c, 0x2d, 0x3e, 0x4f, 0x5a, 0x6c } };
-
-// {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6D}
-static const CLSID CLSID_GetDriveURL =
-{ 0x7b3b5e52, 0xa1f0, 0x4c5e, { 0x9b, 0x8a, 0x1c, 0x2d, 0x3e, 0x4f, 0x5a, 0x6d } };
+// CLSIDs of the commands are in kCommandTable (CommandTable.h)
 
 // {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6F} - Synced overlay icon handler
 static const CLSID CLSID_SyncOverlay =
 { 0x7b3b5e52, 0xa1f0, 0x4c5e, { 0x9b, 0x8a, 0x1c, 0x2d, 0x3e, 0x4f, 0x5a, 0x6f } };
 
+// {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A70} - Syncing overlay icon handler
+static const CLSID CLSID_SyncingOverlay =
+{ 0x7b3b5e52, 0xa1f0, 0x4c5e, { 0x9b, 0x8a, 0x1c, 0x2d, 0x3e, 0x4f, 0x5a, 0x70 } };
+
+// {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A71} - Sync error overlay icon handler
+static const CLSID CLSID_ErrorOverlay =
+{ 0x7b3b5e52, 0xa1f0, 0x4c5e, { 0x9b, 0x8a, 0x1c, 0x2d, 0x3e, 0x4f, 0x5a, 0x71 } };
+
+// {7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A72} - Sync pending overlay icon handler
+static const CLSID CLSID_PendingOverlay =
+{ 0x7b3b5e52, 0xa1f0, 0x4c5e, { 0x9b, 0x8a, 0x1c, 0x2d, 0x3e, 0x4f, 0x5a, 0x72 } };
+
 STDAPI DllGetClassObject(REFCLSID rclsid, REFIID riid, void **ppv)
 {
     *ppv = nullptr;
 
+    const CommandDescriptor *pCommand = nullptr;
+    for (const CommandDescriptor &command : kCommandTable)
+    {
+        if (IsEqualCLSID(rclsid, ToGuid(command.clsid)))
+            pCommand = &command;
+    }
+
     CClassFactory *pFactory = nullptr;
-    if (IsEqualCLSID(rclsid, CLSID_RootMenuFolder))
-        pFactory = new (std::nothrow) CClassFactory(CommandType::RootMenuFolder);
-    else if (IsEqualCLSID(rclsid, CLSID_RootMenuFile))
-        pFactory = new (std::nothrow) CClassFactory(CommandType::RootMenuFile);
-    else if (IsEqualCLSID(rclsid, CLSID_SyncToDrive))
-        pFactory = new (std::nothrow) CClassFactory(CommandType::SyncToDrive);
-    else if (IsEqualCLSID(rclsid, CLSID_CopyToDrive))
-        pFactory = new (std::nothrow) CClassFactory(CommandType::CopyToDrive);
-    else if (IsEqualCLSID(rclsid, CLSID_GetDriveURL))
-        pFactory = new (std::nothrow) CClassFactory(CommandType::GetDriveURL);
+    if (pCommand)
+        pFactory = new (std::nothrow) CClassFactory(pCommand->type);
     else if (IsEqualCLSID(rclsid, CLSID_SyncOverlay))
-        pFactory = new (std::nothrow) CClassFactory(ClassType::SyncOverlay);
+        pFactory = new (std::nothrow) CClassFactory(OverlayState::Synced);
+    else if (IsEqualCLSID(rclsid, CLSID_SyncingOverlay))
+        pFactory = new (std::nothrow) CClassFactory(OverlayState::Syncing);
+    else if (IsEqualCLSID(rclsid, CLSID_ErrorOverlay))
+        pFactory = new (std::nothrow) CClassFactory(OverlayState::Error);
+    else if (IsEqualCLSID(rclsid, CLSID_PendingOverlay))
+        pFactory = new (std::nothrow) CClassFactory(OverlayState::Pending);
     else
         return CLASS_E_CLASSNOTAVAILABLE;
 
@@ -185,5 +186,10 @@ STDAPI DllGetClassObject(REFCLSID rclsid, REFIID riid, void **ppv)
 
 STDAPI DllCanUnloadNow()
 {
-    return g_cDllRef > 0 ? S_FALSE : S_OK;
+    if (g_cDllRef > 0)
+        return S_FALSE;
+
+    ShutdownSyncOverlayCache();
+    ShutdownInvokeQueue();
+    return S_OK;
 }
@@ -4,7 +4,33 @@ const fs = require('fs');
 const os = require('os');
 const { app } = require('electron');
 
-const OVERLAY_CLSID = '{7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6F}';
+// One overlay handler per sync state; the DLL resolves each item once for all
+// of them. The leading space sorts the keys ahead of other apps' overlays.
+const OVERLAY_HANDLERS = [
+  { clsid: '{7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A6F}', key: ' RRightclickrrSynced', name: 'RRightclickrr Sync Overlay' },
+  { clsid: '{7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A70}', key: ' RRightclickrrSyncing', name: 'RRightclickrr Syncing Overlay' },
+  { clsid: '{7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A71}', key: ' RRightclickrrError', name: 'RRightclickrr Sync Error Overlay' },
+  { clsid: '{7B3B5E52-A1F0-4C5E-9B8A-1C2D3E4F5A72}', key: ' RRightclickrrPending', name: 'RRightclickrr Sync Pending Overlay' }
+];
+
+const OVERLAY_IDENTIFIERS_KEY = 'HKCU:\\Software\\Microsoft\\Windows\\CurrentVersion\\Explorer\\ShellIconOverlayIdentifiers';
+
+function buildOverlayRemoveScript() {
+  return OVERLAY_HANDLERS.map(({ clsid, key }) => `
+    Remove-Item -Path '${OVERLAY_IDENTIFIERS_KEY}\\${key}' -Recurse -Force -ErrorAction SilentlyContinue
+    Remove-Item -Path 'HKCU:\\Software\\Classes\\CLSID\\${clsid}' -Recurse -Force -ErrorAction SilentlyContinue`).join('');
+}
+
+function buildOverlayRegisterScript(escapedShellExtensionPath) {
+  return OVERLAY_HANDLERS.map(({ clsid, key, name }) => `
+      New-Item -Path 'HKCU:\\Software\\Classes\\CLSID\\${clsid}' -Force | Out-Null
+      Set-ItemProperty -Path 'HKCU:\\Software\\Classes\\CLSID\\${clsid}' -Name '(Default)' -Value '${name}'
+      New-Item -Path 'HKCU:\\Software\\Classes\\CLSID\\${clsid}\\InprocServer32' -Force | Out-Null
+      Set-ItemProperty -Path 'HKCU:\\Software\\Classes\\CLSID\\${clsid}\\InprocServer32' -Name '(Default)' -Value '${escapedShellExtensionPath}'
+      Set-ItemProperty -Path 'HKCU:\\Software\\Classes\\CLSID\\${clsid}\\InprocServer32' -Name 'ThreadingModel' -Value 'Apartment'
+      New-Item -Path '${OVERLAY_IDENTIFIERS_KEY}\\${key}' -Force | Out-Null
+      Set-ItemProperty -Path '${OVERLAY_IDENTIFIERS_KEY}\\${key}' -Name '(Default)' -Value '${clsid}'`).join('');
+}
 
 async function runPowerShell(script) {
   const scriptPath = path.join(
@@ -99,18 +125,9 @@ async function registerContextMenu() {
   const escapedShellExtensionPath = shellExtensionPath.replace(/\\/g, '\\\\').replace(/'/g, "''");
 
   const script = `
-    # Refresh overlay handler registration
-    Remove-Item -Path 'HKCU:\\Software\\Microsoft\\Windows\\CurrentVersion\\Explorer\\ShellIconOverlayIdentifiers\\ RRightclickrrSynced' -Recurse -Force -ErrorAction SilentlyContinue
-    Remove-Item -Path 'HKCU:\\Software\\Classes\\CLSID\\${OVERLAY_CLSID}' -Recurse -Force -ErrorAction SilentlyContinue
-
-    if (Test-Path '${escapedShellExtensionPath}') {
-      New-Item -Path 'HKCU:\\Software\\Classes\\CLSID\\${OVERLAY_CLSID}' -Force | Out-Null
-      Set-ItemProperty -Path 'HKCU:\\Software\\Classes\\CLSID\\${OVERLAY_CLSID}' -Name '(Default)' -Value 'RRightclickrr Sync Overlay'
-      New-Item -Path 'HKCU:\\Software\\Classes\\CLSID\\${OVERLAY_CLSID}\\InprocServer32' -Force | Out-Null
-      Set-ItemProperty -Path 'HKCU:\\Software\\Classes\\CLSID\\${OVERLAY_CLSID}\\InprocServer32' -Name '(Default)' -Value '${escapedShellExtensionPath}'
-      Set-ItemProperty -Path 'HKCU:\\Software\\Classes\\CLSID\\${OVERLAY_CLSID}\\InprocServer32' -Name 'ThreadingModel' -Value 'Apartment'
-      New-Item -Path 'HKCU:\\Software\\Microsoft\\Windows\\CurrentVersion\\Explorer\\ShellIconOverlayIdentifiers\\ RRightclickrrSynced' -Force | Out-Null
-      Set-ItemProperty -Path 'HKCU:\\Software\\Microsoft\\Windows\\CurrentVersion\\Explorer\\ShellIconOverlayIdentifiers\\ RRightclickrrSynced' -Name '(Default)' -Value '${OVERLAY_CLSID}'
+    # Refresh overlay handler registration${buildOverlayRemoveScript()}
+
+    if (Test-Path '${escapedShellExtensionPath}') {${buildOverlayRegisterScript(escapedShellExtensionPath)}
     }
 
     # Remove old/legacy keys first
@@ -190,9 +207,7 @@ async function registerContextMenu() {
 
 async function unregisterContextMenu() {
   const script = `
-    # Remove overlay icon handler keys
-    Remove-Item -Path 'HKCU:\\Software\\Microsoft\\Windows\\CurrentVersion\\Explorer\\ShellIconOverlayIdentifiers\\ RRightclickrrSynced' -Recurse -Force -ErrorAction SilentlyContinue
-    Remove-Item -Path 'HKCU:\\Software\\Classes\\CLSID\\${OVERLAY_CLSID}' -Recurse -Force -ErrorAction SilentlyContinue
+    # Remove overlay icon handler keys${buildOverlayRemoveScript()}
 
     # Remove current keys
     Remove-Item -Path 'HKCU:\\Software\\Classes\\Directory\\shell\\RR_SyncDrive' -Recurse -Force -ErrorAction SilentlyContinue
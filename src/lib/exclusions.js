@@ -0,0 +1,183 @@
+const { loadNativeAddon } = require('./native');
+
+/**
+ * Exclusion rules for synced folders.
+ *
+ * A rule is a synced folder (root) plus a pattern relative to it: a plain
+ * subpath ("photos/raw") or a glob whose names may use '*' and '?' and whose
+ * "**" stands for any number of names ("**\node_modules"). A rule excludes
+ * what it names and everything beneath it. Paths and patterns compare
+ * case-insensitively and either separator works.
+ *
+ * The native addon compiles all rules into one matcher (the same engine the
+ * shell extension loads from synced-exclusions.idx); this JS matcher is the
+ * fallback and defines the semantics the native one is checked against.
+ */
+
+/**
+ * @param {string} value
+ * @returns {string[]} Names, without empty and '.' names. Final sigma becomes
+ *   sigma: toLowerCase picks between them by position, NormalizePath does not.
+ */
+function splitNames(value) {
+  return String(value || '').toLowerCase().replace(/\u03c2/g, '\u03c3').split(/[\\/]+/)
+    .filter(name => name && name !== '.');
+}
+
+function compileName(name) {
+  if (name === '**' || !/[*?]/.test(name)) {
+    return name;
+  }
+  const source = name.replace(/[.+^${}()|[\]\\]/g, '\\$&').replace(/\*/g, '.*').replace(/\?/g, '.');
+  return new RegExp(`^${source}$`, 's');
+}
+
+function matchNames(pattern, p, names, n) {
+  if (p === pattern.length) {
+    return true;
+  }
+  const name = pattern[p];
+  if (name === '**') {
+    for (let skip = n; skip <= names.length; skip++) {
+      if (matchNames(pattern, p + 1, names, skip)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  if (n >= names.length) {
+    return false;
+  }
+  const matches = typeof name === 'string' ? name === names[n] : name.test(names[n]);
+  return matches && matchNames(pattern, p + 1, names, n + 1);
+}
+
+class ExclusionMatcher {
+  /**
+   * @param {{root: string, pattern: string}[]} rules - An empty root matches
+   *   paths given relative to the synced folder
+   */
+  constructor(rules = []) {
+    this.rules = [];
+    for (const rule of rules) {
+      const pattern = splitNames(rule.pattern);
+      // Empty patterns would exclude the folder itself; '..' leaves it.
+      if (pattern.length === 0 || pattern.includes('..')) continue;
+      this.rules.push({ root: splitNames(rule.root), pattern: pattern.map(compileName) });
+    }
+  }
+
+  get size() {
+    return this.rules.length;
+  }
+
+  /**
+   * @param {string} filePath - Absolute, or relative for rules without a root
+   * @returns {boolean}
+   */
+  isExcluded(filePath) {
+    if (this.rules.length === 0) {
+      return false;
+    }
+
+    const names = splitNames(filePath);
+    for (const { root, pattern } of this.rules) {
+      if (names.length <= root.length || root.some((name, i) => name !== names[i])) continue;
+      if (matchNames(pattern, 0, names, root.length)) {
+        return true;
+      }
+    }
+    return false;
+  }
+}
+
+const EMPTY_MATCHER = new ExclusionMatcher();
+
+/**
+ * Compile rules with the native addon when it is available, else in JS.
+ * @param {{root: string, pattern: string}[]} rules
+ * @returns {{size: number, isExcluded: (filePath: string) => boolean}}
+ */
+function createExclusionMatcher(rules = []) {
+  if (rules.length === 0) {
+    return EMPTY_MATCHER;
+  }
+
+  const native = loadNativeAddon();
+  if (native && typeof native.ExclusionMatcher === 'function') {
+    try {
+      const compiled = new native.ExclusionMatcher(
+        rules.map(rule => String(rule.root || '')),
+        rules.map(rule => String(rule.pattern || ''))
+      );
+      return { size: rules.length, isExcluded: filePath => compiled.isExcluded(String(filePath)) };
+    } catch {
+      // Fall back to the JS matcher.
+    }
+  }
+  return new ExclusionMatcher(rules);
+}
+
+/**
+ * Every mapping's exclusions as rules rooted at its folder.
+ * @param {{localPath: string, excludePaths?: string[]}[]} mappings
+ * @returns {{root: string, pattern: string}[]}
+ */
+function rulesFromMappings(mappings = []) {
+  const rules = [];
+  for (const mapping of mappings) {
+    if (!mapping || !mapping.localPath) continue;
+    for (const pattern of mapping.excludePaths || []) {
+      rules.push({ root: mapping.localPath, pattern });
+    }
+  }
+  return rules;
+}
+
+/**
+ * A synced folder's patterns restated for a subfolder, for syncing just that
+ * subfolder: each way a pattern's leading names can match relativeDir leaves
+ * the rest of the pattern, relative to the subfolder.
+ * @param {string[]} patterns - Patterns relative to the synced folder
+ * @param {string} relativeDir - The subfolder, relative to the synced folder
+ * @returns {string[]|null} null when relativeDir itself is excluded
+ */
+function rebasePatterns(patterns, relativeDir) {
+  const dirNames = splitNames(relativeDir);
+  const rebased = new Set();
+  for (const source of patterns || []) {
+    const pattern = splitNames(source);
+    if (pattern.length === 0 || pattern.includes('..')) continue;
+    const compiled = pattern.map(compileName);
+
+    // Pattern positions reachable after matching the first n subfolder
+    // names; '**' may match no names, so it also reaches the next position.
+    let positions = [0];
+    for (let n = 0; n <= dirNames.length && positions.length > 0; n++) {
+      const reachable = new Set();
+      for (let p of positions) {
+        reachable.add(p);
+        while (pattern[p] === '**') reachable.add(++p);
+      }
+      if (reachable.has(pattern.length)) {
+        return null; // Matched the subfolder or a folder above it
+      }
+      if (n === dirNames.length) {
+        for (const p of reachable) rebased.add(pattern.slice(p).join('/'));
+        break;
+      }
+      positions = [];
+      for (const p of reachable) {
+        const name = compiled[p];
+        if (name === '**') {
+          positions.push(p);
+        } else if (typeof name === 'string' ? name === dirNames[n] : name.test(dirNames[n])) {
+          positions.push(p + 1);
+        }
+      }
+    }
+  }
+  return [...rebased];
+}
+
+module.exports = { ExclusionMatcher, createExclusionMatcher, rulesFromMappings, rebasePatterns };
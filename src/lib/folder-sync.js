@@ -1,6 +1,26 @@
 const fs = require('fs');
 const path = require('path');
 const crypto = require('crypto');
+const { createExclusionMatcher } = require('./exclusions');
+const { loadNativeAddon } = require('./native');
+
+// Never synced, wherever they appear (exact names).
+const SYSTEM_FOLDERS = [
+  'node_modules',
+  '__pycache__',
+  '.git',
+  '.svn',
+  '.hg',
+  'Thumbs.db',
+  '.DS_Store',
+  '$RECYCLE.BIN',
+  'System Volume Information'
+];
+const SYSTEM_FILES = [
+  'desktop.ini',
+  'Thumbs.db',
+  '.DS_Store'
+];
 
 class FolderSync {
   constructor(driveUploader, store, logDir = null, syncTracker = null) {
@@ -15,15 +35,17 @@ class FolderSync {
     this.abortController = null;
     this.pauseWaiters = [];
     this.excludePaths = []; // Paths to exclude from sync
+    this.exclusionMatcher = createExclusionMatcher();
     this.pendingMetadataBackfills = new Map();
   }
 
   /**
    * Set paths to exclude from sync
-   * @param {string[]} paths - Array of relative paths to exclude
+   * @param {string[]} paths - Relative paths or glob patterns to exclude (see exclusions.js)
    */
   setExcludePaths(paths) {
     this.excludePaths = (paths || []).map(p => p.toLowerCase());
+    this.exclusionMatcher = createExclusionMatcher(this.excludePaths.map(pattern => ({ root: '', pattern })));
   }
 
   cancel() {
@@ -76,12 +98,14 @@ class FolderSync {
     const runOptions = this.normalizeOptions(options);
 
     const folderName = path.basename(localFolderPath);
-    let files = this.getAllFiles(localFolderPath);
+    const scan = await this.scanLocalFolder(localFolderPath);
+    let entries = scan.files;
 
     // If this is a "retry failed only" run, filter to those exact files.
     if (runOptions.onlyFiles.size > 0) {
-      files = files.filter(file => runOptions.onlyFiles.has(path.normalize(file).toLowerCase()));
+      entries = entries.filter(entry => runOptions.onlyFiles.has(path.normalize(entry.path).toLowerCase()));
     }
+    const files = entries.map(entry => entry.path);
 
     const totalFiles = files.length;
 
@@ -94,31 +118,53 @@ class FolderSync {
     let changedCount = 0;
     let skippedPreflightCount = 0;
 
-    for (const file of files) {
+    // Classify from metadata first; files whose only change is their
+    // timestamps are then hashed together in one batch.
+    const preflightEntries = [];
+    for (const entry of entries) {
+      const file = entry.path;
       try {
-        const stat = fs.statSync(file);
-        const size = stat.size;
-        const mtimeMs = stat.mtimeMs;
-        totalBytes += size;
-
-        const priorSync = this.syncTracker ? this.syncTracker.getSyncInfo(file) : null;
-        const state = await this.classifyFileState(file, size, mtimeMs, priorSync);
-        fileMeta.set(file, { size, mtimeMs, priorSync, state });
-
-        if (state === 'skip') {
-          skippedPreflightCount++;
-        } else {
-          bytesToUpload += size;
-          filesToUpload++;
-          if (state === 'new') {
-            newCount++;
-          } else {
-            changedCount++;
-          }
+        let { size, mtimeMs } = entry;
+        if (size === null) {
+          const stat = fs.statSync(file);
+          size = stat.size;
+          mtimeMs = stat.mtimeMs;
         }
+        const priorSync = this.syncTracker ? this.syncTracker.getSyncInfo(file) : null;
+        const state = this.classifyByMetadata(file, size, mtimeMs, priorSync);
+        preflightEntries.push({ file, size, mtimeMs, priorSync, state });
       } catch (e) {
+        preflightEntries.push({ file, error: e });
+      }
+    }
+
+    const driftedEntries = preflightEntries.filter(entry => entry.state === 'hash');
+    if (driftedEntries.length > 0) {
+      const digests = await this.calculateFileMd5s(driftedEntries.map(entry => entry.file));
+      driftedEntries.forEach((entry, i) => {
+        entry.state = this.resolveHashedState(entry.file, entry.size, entry.mtimeMs, entry.priorSync, digests[i]);
+      });
+    }
+
+    for (const { file, size, mtimeMs, priorSync, state, error } of preflightEntries) {
+      if (error) {
         fileMeta.set(file, { size: 0, mtimeMs: 0, priorSync: null, state: 'new' });
         filesToUpload++;
+        continue;
+      }
+      totalBytes += size;
+      fileMeta.set(file, { size, mtimeMs, priorSync, state });
+
+      if (state === 'skip') {
+        skippedPreflightCount++;
+      } else {
+        bytesToUpload += size;
+        filesToUpload++;
+        if (state === 'new') {
+          newCount++;
+        } else {
+          changedCount++;
+        }
       }
     }
 
@@ -485,7 +531,7 @@ class FolderSync {
     // For full sync runs, create any local subdirectories that had no files in them
     // (those would never be created via ensureFolderPath during file uploads).
     if (runOptions.syncMode === 'sync' && runOptions.onlyFiles.size === 0 && !this.cancelled) {
-      await this.createEmptyDirsInDrive(localFolderPath, rootFolderId, ensuredDirCache);
+      await this.createEmptyDirsInDrive(localFolderPath, rootFolderId, ensuredDirCache, scan);
     }
 
     // For full sync runs, also pull Drive-only files to local (missing files only).
@@ -622,6 +668,25 @@ class FolderSync {
   }
 
   async classifyFileState(filePath, sizeBytes, mtimeMs, priorSync) {
+    const state = this.classifyByMetadata(filePath, sizeBytes, mtimeMs, priorSync);
+    if (state !== 'hash') {
+      return state;
+    }
+    let localMd5 = null;
+    try {
+      localMd5 = await this.calculateFileMd5(filePath);
+    } catch {
+      // If hashing fails, treat the file as changed.
+    }
+    return this.resolveHashedState(filePath, sizeBytes, mtimeMs, priorSync, localMd5);
+  }
+
+  /**
+   * classifyFileState without reading the file: 'new', 'skip' or 'changed',
+   * or 'hash' when only the timestamps drifted and the content has to be
+   * compared with the Drive copy's MD5 (see resolveHashedState).
+   */
+  classifyByMetadata(filePath, sizeBytes, mtimeMs, priorSync) {
     if (!this.syncTracker) return 'new';
     if (!priorSync || !priorSync.driveId) return 'new';
     if (this.shouldSkipFile(filePath, sizeBytes, mtimeMs)) return 'skip';
@@ -644,20 +709,23 @@ class FolderSync {
       typeof priorSync.remoteMd5 === 'string' &&
       priorSync.remoteMd5
     ) {
-      try {
-        const localMd5 = await this.calculateFileMd5(filePath);
-        if (localMd5.toLowerCase() === String(priorSync.remoteMd5).toLowerCase()) {
-          this.backfillLocalSyncMetadata(filePath, priorSync, sizeBytes, mtimeMs);
-          return 'skip';
-        }
-      } catch {
-        // If hashing fails, fall through to changed.
-      }
+      return 'hash';
     }
 
     return 'changed';
   }
 
+  /**
+   * Final state of a 'hash' file given its local MD5 (null if it could not be read).
+   */
+  resolveHashedState(filePath, sizeBytes, mtimeMs, priorSync, localMd5) {
+    if (localMd5 && localMd5.toLowerCase() === String(priorSync.remoteMd5).toLowerCase()) {
+      this.backfillLocalSyncMetadata(filePath, priorSync, sizeBytes, mtimeMs);
+      return 'skip';
+    }
+    return 'changed';
+  }
+
   shouldSkipFile(filePath, sizeBytes, mtimeMs) {
     if (!this.syncTracker) {
       return false;
@@ -948,7 +1016,51 @@ class FolderSync {
     }
   }
 
-  calculateFileMd5(filePath) {
+  /**
+   * MD5s of many files, hashed in parallel by the native addon when it is
+   * available (Drive md5Checksum format: lowercase hex).
+   * @param {string[]} filePaths
+   * @returns {Promise<(string|null)[]>} Digest per path; null when unreadable
+   */
+  async calculateFileMd5s(filePaths) {
+    const addon = loadNativeAddon();
+    if (addon && typeof addon.hashFiles === 'function') {
+      try {
+        const { digests, totals } = await addon.hashFiles(filePaths);
+        if (totals.files > 1) {
+          this.log(`MD5: ${totals.files} files, ${this.formatBytes(totals.bytes)} in ${Math.round(totals.elapsedMs)} ms ` +
+            `(${this.formatBytes(totals.bytesPerSec)}/s, ${totals.threads} threads, ${totals.failed} unreadable)`);
+        }
+        return digests;
+      } catch (e) {
+        this.log(`Native MD5 failed, using JS hashing: ${e.message}`);
+      }
+    }
+
+    const digests = [];
+    for (const filePath of filePaths) {
+      try {
+        digests.push(await this.calculateFileMd5Stream(filePath));
+      } catch {
+        digests.push(null);
+      }
+    }
+    return digests;
+  }
+
+  async calculateFileMd5(filePath) {
+    const addon = loadNativeAddon();
+    if (addon && typeof addon.hashFiles === 'function') {
+      const [digest] = (await addon.hashFiles([filePath])).digests;
+      if (digest === null) {
+        throw new Error(`Cannot read ${filePath}`);
+      }
+      return digest;
+    }
+    return this.calculateFileMd5Stream(filePath);
+  }
+
+  calculateFileMd5Stream(filePath) {
     return new Promise((resolve, reject) => {
       const hash = crypto.createHash('md5');
       const stream = fs.createReadStream(filePath);
@@ -1092,6 +1204,49 @@ class FolderSync {
     return next;
   }
 
+  /**
+   * List the files to sync under dirPath, with their size and mtime, and
+   * every directory walked. The native scanner reads the tree on a thread
+   * pool and takes size and mtime from the directory listing itself; without
+   * the addon this falls back to getAllFiles, whose entries have size null.
+   * Links and junctions to directories are only followed by the fallback.
+   * @param {string} dirPath
+   * @returns {Promise<{files: {path: string, size: number|null, mtimeMs: number|null}[], directories: string[]}>}
+   */
+  async scanLocalFolder(dirPath) {
+    const addon = loadNativeAddon();
+    if (addon && typeof addon.scanDirectory === 'function') {
+      const files = [];
+      const directories = [];
+      try {
+        const totals = await addon.scanDirectory(path.normalize(dirPath), {
+          excludePatterns: this.excludePaths,
+          skipDirectoryNames: SYSTEM_FOLDERS,
+          skipFileNames: SYSTEM_FILES
+        }, batch => {
+          for (let i = 0; i < batch.files.length; i++) {
+            files.push({ path: batch.files[i], size: batch.sizes[i], mtimeMs: batch.mtimeMs[i] });
+          }
+          for (const dir of batch.directories) {
+            directories.push(dir);
+          }
+          return !this.cancelled;
+        });
+        if (totals.unreadable > 0) {
+          this.log(`Scan: ${totals.unreadable} unreadable folder(s) under ${dirPath}`);
+        }
+        return { files, directories };
+      } catch (e) {
+        this.log(`Native scan of ${dirPath} failed, using JS scan: ${e.message}`);
+      }
+    }
+
+    return {
+      files: this.getAllFiles(dirPath).map(file => ({ path: file, size: null, mtimeMs: null })),
+      directories: this.getAllDirectories(dirPath)
+    };
+  }
+
   getAllFiles(dirPath, arrayOfFiles = [], basePath = null) {
     // Track base path for exclusion checking
     if (basePath === null) {
@@ -1140,41 +1295,15 @@ class FolderSync {
    * Check if a path is in the exclusion list
    */
   isPathExcluded(relativePath) {
-    if (this.excludePaths.length === 0) {
-      return false;
-    }
-
-    const normalizedPath = relativePath.toLowerCase();
-    for (const excluded of this.excludePaths) {
-      if (normalizedPath === excluded || normalizedPath.startsWith(excluded + path.sep)) {
-        return true;
-      }
-    }
-    return false;
+    return this.excludePaths.length > 0 && this.exclusionMatcher.isExcluded(relativePath);
   }
 
   isSystemFolder(name) {
-    const systemFolders = [
-      'node_modules',
-      '__pycache__',
-      '.git',
-      '.svn',
-      '.hg',
-      'Thumbs.db',
-      '.DS_Store',
-      '$RECYCLE.BIN',
-      'System Volume Information'
-    ];
-    return systemFolders.includes(name);
+    return SYSTEM_FOLDERS.includes(name);
   }
 
   isSystemFile(name) {
-    const systemFiles = [
-      'desktop.ini',
-      'Thumbs.db',
-      '.DS_Store'
-    ];
-    return systemFiles.includes(name);
+    return SYSTEM_FILES.includes(name);
   }
 
   /**
@@ -1233,9 +1362,24 @@ class FolderSync {
    * Create any local subdirectories that have no files anywhere in their subtree.
    * These are invisible to the file-upload loop but must still exist in Drive.
    * Skips dirs already processed by the file upload loop (via ensuredDirCache).
+   * @param {{files: {path: string}[], directories: string[]}} [scan] - This run's scanLocalFolder result
    */
-  async createEmptyDirsInDrive(localFolderPath, rootFolderId, ensuredDirCache) {
-    const allDirs = this.getAllDirectories(localFolderPath);
+  async createEmptyDirsInDrive(localFolderPath, rootFolderId, ensuredDirCache, scan = null) {
+    if (!scan) {
+      scan = await this.scanLocalFolder(localFolderPath);
+    }
+    const allDirs = scan.directories;
+
+    // Every directory with a file somewhere beneath it.
+    const dirsWithFiles = new Set();
+    const rootDir = path.normalize(localFolderPath);
+    for (const file of scan.files) {
+      let dir = path.dirname(file.path);
+      while (dir.length > rootDir.length && !dirsWithFiles.has(dir)) {
+        dirsWithFiles.add(dir);
+        dir = path.dirname(dir);
+      }
+    }
 
     for (const dir of allDirs) {
       if (this.cancelled) break;
@@ -1247,8 +1391,7 @@ class FolderSync {
       if (ensuredDirCache.has(relativeDir)) continue;
 
       // Check if ANY file exists anywhere in this subtree
-      const hasFiles = this.getAllFiles(dir).length > 0;
-      if (hasFiles) {
+      if (dirsWithFiles.has(dir)) {
         // Non-empty: its files will trigger ensureFolderPath via the upload loop.
         // We still want to record the Drive folder ID for this dir so we can trash
         // it later if it's deleted locally. But only do this if not already cached.
@@ -1,14 +1,154 @@
 const chokidar = require('chokidar');
 const path = require('path');
 const { EventEmitter } = require('events');
+const { createExclusionMatcher } = require('./exclusions');
+const { loadNativeAddon } = require('./native');
+
+// Names the watcher never reports, besides dotfiles.
+const SKIP_DIRECTORY_NAMES = ['node_modules'];
+const SKIP_FILE_SUFFIXES = ['.tmp', '~'];
+
+/**
+ * JS stand-in for the native coalescer (shell-extension/src/ChangeCoalescer.h)
+ * when chokidar does the watching: folds each path's events into one net
+ * change and hands the folder's changes out together once it has been quiet
+ * for quietMs. Past maxDelayMs a busy folder hands out the paths that have
+ * each been quiet for quietMs; a file still being written waits.
+ */
+class ChangeCoalescer {
+  constructor(quietMs, maxDelayMs, onBatch) {
+    this.quietMs = quietMs;
+    this.maxDelayMs = maxDelayMs;
+    this.onBatch = onBatch;
+    this.pending = new Map(); // Map<path, {firstAt, lastAt, existedBefore, existsNow, directory}>
+    this.timer = null;
+    this.lastEventAt = 0;
+    this.oldestAt = Infinity; // Earliest firstAt among pending changes
+    this.nextQuietAt = 0; // When the first pending path will have been quiet for quietMs
+  }
+
+  /**
+   * @param {string} filePath
+   * @param {'created'|'modified'|'deleted'} op
+   * @param {boolean} directory
+   */
+  add(filePath, op, directory) {
+    const now = Date.now();
+    this.lastEventAt = now;
+    const change = this.pending.get(filePath);
+    if (change) {
+      change.lastAt = now;
+      if (!(directory && op === 'modified')) {
+        change.existsNow = op !== 'deleted';
+        change.directory = directory;
+      }
+    } else if (!(directory && op === 'modified')) {
+      if (this.pending.size === 0) {
+        this.nextQuietAt = now + this.quietMs;
+      }
+      this.oldestAt = Math.min(this.oldestAt, now);
+      this.pending.set(filePath, {
+        firstAt: now,
+        lastAt: now,
+        existedBefore: op !== 'created',
+        existsNow: op !== 'deleted',
+        directory
+      });
+    }
+    this.schedule();
+  }
+
+  // Arms the timer for the next quiet or overdue point, as NextDueMs does.
+  schedule() {
+    clearTimeout(this.timer);
+    this.timer = null;
+    if (this.pending.size === 0) {
+      return;
+    }
+    const quietAt = this.lastEventAt + this.quietMs;
+    const overdueAt = Math.max(this.oldestAt + this.maxDelayMs, this.nextQuietAt);
+    this.timer = setTimeout(() => this.flush(), Math.max(0, Math.min(quietAt, overdueAt) - Date.now()));
+  }
+
+  flush() {
+    this.timer = null;
+    const now = Date.now();
+    const quiet = now - this.lastEventAt >= this.quietMs;
+    const overdue = now - this.oldestAt >= this.maxDelayMs && now >= this.nextQuietAt;
+    if (!quiet && !overdue) {
+      this.schedule();
+      return;
+    }
+
+    const ready = [];
+    let oldestAt = Infinity;
+    let nextQuietAt = Infinity;
+    for (const [filePath, change] of this.pending) {
+      if (now - change.lastAt < this.quietMs) {
+        oldestAt = Math.min(oldestAt, change.firstAt);
+        nextQuietAt = Math.min(nextQuietAt, change.lastAt + this.quietMs);
+        continue;
+      }
+      this.pending.delete(filePath);
+
+      let type;
+      if (change.directory && change.existedBefore && change.existsNow) {
+        type = 'rescan';
+      } else if (!change.existedBefore && !change.existsNow) {
+        continue;
+      } else if (change.directory) {
+        type = change.existsNow ? 'addDir' : 'unlinkDir';
+      } else {
+        type = !change.existedBefore ? 'add' : change.existsNow ? 'change' : 'unlink';
+      }
+      ready.push({ filePath, type });
+    }
+    this.oldestAt = oldestAt;
+    this.nextQuietAt = nextQuietAt === Infinity ? 0 : nextQuietAt;
+    this.schedule();
+
+    // Changes beneath a directory added, deleted or rescanned in the same
+    // batch are covered by it.
+    const directories = new Set(ready.filter(change => change.type.endsWith('Dir') || change.type === 'rescan')
+      .map(change => change.filePath));
+    const byDirectory = new Map();
+    for (const change of ready) {
+      let covered = false;
+      for (let dir = path.dirname(change.filePath); !covered; dir = path.dirname(dir)) {
+        covered = directories.has(dir);
+        if (dir === path.dirname(dir)) break;
+      }
+      if (covered) continue;
+
+      const directory = path.dirname(change.filePath);
+      if (!byDirectory.has(directory)) {
+        byDirectory.set(directory, { directory, names: [], types: [] });
+      }
+      const group = byDirectory.get(directory);
+      group.names.push(path.basename(change.filePath));
+      group.types.push(change.type);
+    }
+    if (byDirectory.size > 0) {
+      this.onBatch(Array.from(byDirectory.values()));
+    }
+  }
+
+  close() {
+    clearTimeout(this.timer);
+    this.timer = null;
+    this.pending.clear();
+    this.oldestAt = Infinity;
+  }
+}
 
 class FolderWatcher extends EventEmitter {
   constructor() {
     super();
     this.watchers = new Map(); // Map<localPath, watcher>
-    this.pendingChanges = new Map(); // Map<filePath, timeout> for debouncing
-    this.debounceMs = 2000; // Wait 2 seconds after last change before syncing
+    this.debounceMs = 2000; // Changes are handed out once a folder has been quiet this long
+    this.maxDelayMs = 10000; // ...or this long after the first one, whichever comes first
     this.excludedPaths = new Map(); // Map<localPath, Set<excludedSubpath>>
+    this.exclusionMatchers = new Map(); // Map<localPath, compiled excludedPaths entry>
   }
 
   /**
@@ -26,7 +166,68 @@ class FolderWatcher extends EventEmitter {
 
     // Store excluded paths
     this.excludedPaths.set(localPath, new Set(excludePaths.map(p => p.toLowerCase())));
+    this.compileExclusions(localPath);
 
+    const onBatch = groups => this.handleBatch(groups, localPath, driveId, driveName);
+    const watcher = this.watchNative(localPath, onBatch) || this.watchWithChokidar(localPath, onBatch);
+
+    this.watchers.set(localPath, { watcher, driveId, driveName });
+    this.emit('watching', { localPath, driveId, driveName });
+  }
+
+  /**
+   * The native watcher reported an error. Directories it could not watch
+   * arrive as rescans and the watch goes on; when it stopped, the folder is
+   * watched again and rescanned whole, since its changes since are unknown.
+   */
+  handleNativeError(localPath, onBatch, failed, { error, stopped }) {
+    this.emit('error', { localPath, error: new Error(error) });
+    const entry = this.watchers.get(localPath);
+    if (!stopped || !entry || entry.watcher !== failed) {
+      return;
+    }
+
+    failed.close();
+    entry.watcher = this.watchNative(localPath, onBatch) || this.watchWithChokidar(localPath, onBatch);
+    onBatch([{ directory: path.dirname(localPath), names: [path.basename(localPath)], types: ['rescan'] }]);
+  }
+
+  /**
+   * Watch through the native addon, which coalesces the raw events on its
+   * own thread and calls back once per burst.
+   * @returns {{close: Function}|null} null when the addon cannot watch localPath
+   */
+  watchNative(localPath, onBatch) {
+    const addon = loadNativeAddon();
+    if (!addon || typeof addon.watchDirectory !== 'function') {
+      return null;
+    }
+    try {
+      const watcher = addon.watchDirectory(path.normalize(localPath), {
+        quietMs: this.debounceMs,
+        maxDelayMs: this.maxDelayMs,
+        skipHidden: true,
+        skipDirectoryNames: SKIP_DIRECTORY_NAMES,
+        skipFileSuffixes: SKIP_FILE_SUFFIXES
+      }, batch => {
+        if (batch.error) {
+          this.handleNativeError(localPath, onBatch, watcher, batch);
+        } else {
+          onBatch(batch.groups);
+        }
+      });
+      return watcher;
+    } catch (error) {
+      this.emit('error', { localPath, error });
+      return null;
+    }
+  }
+
+  /**
+   * @returns {{close: Function}} chokidar watcher plus its coalescer
+   */
+  watchWithChokidar(localPath, onBatch) {
+    const coalescer = new ChangeCoalescer(this.debounceMs, this.maxDelayMs, onBatch);
     const watcher = chokidar.watch(localPath, {
       persistent: true,
       ignoreInitial: true, // Don't trigger for existing files
@@ -43,135 +244,101 @@ class FolderWatcher extends EventEmitter {
       ]
     });
 
-    watcher.on('add', (filePath) => this.handleChange('add', filePath, localPath, driveId, driveName));
-    watcher.on('change', (filePath) => this.handleChange('change', filePath, localPath, driveId, driveName));
-    watcher.on('unlink', (filePath) => this.handleDelete(filePath, localPath, driveId, driveName));
+    watcher.on('add', (filePath) => coalescer.add(filePath, 'created', false));
+    watcher.on('change', (filePath) => coalescer.add(filePath, 'modified', false));
+    watcher.on('unlink', (filePath) => coalescer.add(filePath, 'deleted', false));
     watcher.on('addDir', (dirPath) => {
       // chokidar fires addDir for the root itself on startup — ignore that
       if (path.normalize(dirPath) === path.normalize(localPath)) return;
-      this.handleDirAdded(dirPath, localPath, driveId, driveName);
+      coalescer.add(dirPath, 'created', true);
     });
-    watcher.on('unlinkDir', (dirPath) => this.handleDirDeleted(dirPath, localPath, driveId, driveName));
+    watcher.on('unlinkDir', (dirPath) => coalescer.add(dirPath, 'deleted', true));
     watcher.on('error', (error) => this.emit('error', { localPath, error }));
 
-    this.watchers.set(localPath, { watcher, driveId, driveName });
-    this.emit('watching', { localPath, driveId, driveName });
+    return {
+      close: () => {
+        coalescer.close();
+        return watcher.close();
+      }
+    };
   }
 
   /**
-   * Handle a file change with debouncing
+   * Emit one batch of coalesced changes: the added and modified files of the
+   * whole batch together as 'files-changed', everything else per path.
+   * @param {{directory: string, names: string[], types: string[]}[]} groups
    */
-  handleChange(type, filePath, localPath, driveId, driveName) {
-    // Check if this file is in an excluded path
-    if (this.isExcluded(filePath, localPath)) {
-      return; // Skip excluded files
+  handleBatch(groups, localPath, driveId, driveName) {
+    if (!this.watchers.has(localPath)) {
+      return; // Unwatched while the batch was on its way
     }
 
-    // Clear existing timeout for this file
-    if (this.pendingChanges.has(filePath)) {
-      clearTimeout(this.pendingChanges.get(filePath));
+    const filePaths = [];
+    for (const group of groups) {
+      for (let i = 0; i < group.names.length; i++) {
+        const changedPath = path.join(group.directory, group.names[i]);
+        if (this.isExcluded(changedPath, localPath)) {
+          continue;
+        }
+        const event = {
+          localPath,
+          driveId,
+          driveName,
+          relativePath: path.relative(localPath, changedPath)
+        };
+        switch (group.types[i]) {
+          case 'add':
+          case 'change':
+            filePaths.push(changedPath);
+            break;
+          case 'unlink':
+            this.emit('file-deleted', { filePath: changedPath, ...event });
+            break;
+          case 'addDir':
+            this.emit('dir-added', { dirPath: changedPath, ...event });
+            break;
+          case 'unlinkDir':
+            this.emit('dir-deleted', { dirPath: changedPath, ...event });
+            break;
+          default:
+            // Events were lost under this directory (or it was replaced).
+            this.emit('rescan', { dirPath: changedPath, ...event });
+            break;
+        }
+      }
     }
 
-    // Set new timeout to debounce rapid changes
-    const timeout = setTimeout(() => {
-      this.pendingChanges.delete(filePath);
-      this.emit('file-changed', {
-        type,
-        filePath,
+    if (filePaths.length > 0) {
+      this.emit('files-changed', {
+        filePaths,
         localPath,
         driveId,
         driveName,
-        relativePath: path.relative(localPath, filePath)
+        relativePaths: filePaths.map(filePath => path.relative(localPath, filePath))
       });
-    }, this.debounceMs);
-
-    this.pendingChanges.set(filePath, timeout);
-  }
-
-  /**
-   * Handle file deletion
-   */
-  handleDelete(filePath, localPath, driveId, driveName) {
-    if (this.isExcluded(filePath, localPath)) {
-      return;
-    }
-
-    this.emit('file-deleted', {
-      filePath,
-      localPath,
-      driveId,
-      driveName,
-      relativePath: path.relative(localPath, filePath)
-    });
-  }
-
-  /**
-   * Handle a new directory being created — debounced so we don't fire mid-copy
-   */
-  handleDirAdded(dirPath, localPath, driveId, driveName) {
-    if (this.isExcluded(dirPath, localPath)) {
-      return;
-    }
-
-    if (this.pendingChanges.has(dirPath)) {
-      clearTimeout(this.pendingChanges.get(dirPath));
     }
-
-    const timeout = setTimeout(() => {
-      this.pendingChanges.delete(dirPath);
-      this.emit('dir-added', {
-        dirPath,
-        localPath,
-        driveId,
-        driveName,
-        relativePath: path.relative(localPath, dirPath)
-      });
-    }, this.debounceMs);
-
-    this.pendingChanges.set(dirPath, timeout);
   }
 
   /**
-   * Handle a directory being deleted
+   * Check if a file path is in an excluded subfolder
    */
-  handleDirDeleted(dirPath, localPath, driveId, driveName) {
-    if (this.isExcluded(dirPath, localPath)) {
-      return;
-    }
-
-    // Cancel any pending debounce for this path (e.g. add → delete in rapid succession)
-    if (this.pendingChanges.has(dirPath)) {
-      clearTimeout(this.pendingChanges.get(dirPath));
-      this.pendingChanges.delete(dirPath);
-    }
-
-    this.emit('dir-deleted', {
-      dirPath,
-      localPath,
-      driveId,
-      driveName,
-      relativePath: path.relative(localPath, dirPath)
-    });
+  isExcluded(filePath, localPath) {
+    const matcher = this.exclusionMatchers.get(localPath);
+    return Boolean(matcher) && matcher.isExcluded(filePath);
   }
 
   /**
-   * Check if a file path is in an excluded subfolder
+   * Recompile a watched folder's exclusions after they changed
+   * @param {string} localPath - The watched folder path
    */
-  isExcluded(filePath, localPath) {
+  compileExclusions(localPath) {
     const excludeSet = this.excludedPaths.get(localPath);
     if (!excludeSet || excludeSet.size === 0) {
-      return false;
-    }
-
-    const relativePath = path.relative(localPath, filePath).toLowerCase();
-
-    // Check if the relative path starts with any excluded path
-    for (const excluded of excludeSet) {
-      if (relativePath === excluded || relativePath.startsWith(excluded + path.sep)) {
-        return true;
-      }
+      this.exclusionMatchers.delete(localPath);
+      return;
     }
-    return false;
+    const rules = Array.from(excludeSet, pattern => ({ root: localPath, pattern }));
+    this.exclusionMatchers.set(localPath, createExclusionMatcher(rules));
   }
 
   /**
@@ -184,6 +351,7 @@ class FolderWatcher extends EventEmitter {
       this.excludedPaths.set(localPath, new Set());
     }
     this.excludedPaths.get(localPath).add(excludePath.toLowerCase());
+    this.compileExclusions(localPath);
   }
 
   /**
@@ -195,6 +363,7 @@ class FolderWatcher extends EventEmitter {
     const excludeSet = this.excludedPaths.get(localPath);
     if (excludeSet) {
       excludeSet.delete(excludePath.toLowerCase());
+      this.compileExclusions(localPath);
     }
   }
 
@@ -218,6 +387,7 @@ class FolderWatcher extends EventEmitter {
       entry.watcher.close();
       this.watchers.delete(localPath);
       this.excludedPaths.delete(localPath); // Clean up exclusions
+      this.exclusionMatchers.delete(localPath);
       this.emit('unwatched', { localPath });
     }
   }
@@ -231,12 +401,7 @@ class FolderWatcher extends EventEmitter {
     }
     this.watchers.clear();
     this.excludedPaths.clear();
-
-    // Clear all pending timeouts
-    for (const timeout of this.pendingChanges.values()) {
-      clearTimeout(timeout);
-    }
-    this.pendingChanges.clear();
+    this.exclusionMatchers.clear();
   }
 
   /**
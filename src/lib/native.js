@@ -0,0 +1,44 @@
+const path = require('path');
+
+const ADDON_FILE = 'rrightclickrr_native.node';
+
+let cachedAddon;
+
+/**
+ * Candidate locations for the native addon, packaged first.
+ * @returns {string[]}
+ */
+function getAddonCandidates() {
+  const appRoot = path.join(__dirname, '..', '..');
+  return [
+    path.join(path.dirname(process.execPath), 'native', ADDON_FILE),
+    path.join(appRoot, 'native', 'build', 'Release', ADDON_FILE),
+    path.join(appRoot, 'native', 'build', ADDON_FILE)
+  ];
+}
+
+/**
+ * Load the optional native addon (native/).
+ * Callers must keep a JS fallback: the addon is absent in dev checkouts that
+ * have not built it and on platforms it has not been compiled for.
+ * @returns {object|null} Addon exports or null when unavailable
+ */
+function loadNativeAddon() {
+  if (cachedAddon !== undefined) {
+    return cachedAddon;
+  }
+
+  cachedAddon = null;
+  for (const candidate of getAddonCandidates()) {
+    try {
+      cachedAddon = require(candidate);
+      break;
+    } catch {
+      // Try the next location.
+    }
+  }
+
+  return cachedAddon;
+}
+
+module.exports = { loadNativeAddon };
@@ -0,0 +1,50 @@
+const fs = require('fs');
+
+// First line of every batch request the shell extension writes
+// (SelectionBatch.h); the number is the format version.
+const BATCH_HEADER = 'rrightclickrr-batch 1';
+const BATCH_MODES = new Set(['sync', 'copy', 'get-url']);
+
+/**
+ * Parse a batch request: the header, a "mode <sync|copy|get-url>" line, then
+ * one selected path per line.
+ * @param {string} text - File contents (UTF-8)
+ * @returns {{mode: string, paths: string[]}|null} Null when not a batch request
+ */
+function parseBatchRequest(text) {
+  const lines = String(text).split(/\r?\n/);
+  if (lines[0] !== BATCH_HEADER) {
+    return null;
+  }
+
+  const modeMatch = /^mode (\S+)$/.exec(lines[1] || '');
+  if (!modeMatch || !BATCH_MODES.has(modeMatch[1])) {
+    return null;
+  }
+
+  const paths = lines.slice(2).filter((line) => line.length > 0);
+  return { mode: modeMatch[1], paths };
+}
+
+/**
+ * Read and delete a batch request file written for --batch.
+ * @param {string} filePath - Response file path
+ * @returns {{mode: string, paths: string[]}|null}
+ */
+function consumeBatchFile(filePath) {
+  let text;
+  try {
+    text = fs.readFileSync(filePath, 'utf8');
+  } catch {
+    return null;
+  }
+
+  try {
+    fs.rmSync(filePath, { force: true });
+  } catch {
+    // A leftover temp file is harmless.
+  }
+  return parseBatchRequest(text);
+}
+
+module.exports = { parseBatchRequest, consumeBatchFile };
@@ -0,0 +1,186 @@
+const { execFileSync } = require('child_process');
+const fs = require('fs');
+const net = require('net');
+const path = require('path');
+
+// Binary request protocol spoken by the shell extension
+// (shell-extension/src/ShellCommandProtocol.h). One request per connection:
+// a 16-byte header, then each path as a uint32 byte length and UTF-8 bytes.
+const REQUEST_MAGIC = 0x51435252; // "RRCQ"
+const REPLY_MAGIC = 0x41435252; // "RRCA"
+const PROTOCOL_VERSION = 1;
+const HEADER_SIZE = 16;
+const MAX_PAYLOAD = 16 * 1024 * 1024;
+const MODES = ['sync', 'copy', 'get-url'];
+const STATUS_ACCEPTED = 0;
+const STATUS_REJECTED = 1;
+
+// A connected client gets this long to deliver its request.
+const CLIENT_TIMEOUT_MS = 1000;
+
+/**
+ * String SID of the current Windows user (e.g. S-1-5-21-...), or '' if it
+ * cannot be read. Node exposes no SID, so it comes from whoami.
+ * @returns {string}
+ */
+function currentUserSid() {
+  try {
+    const output = execFileSync('whoami', ['/user', '/fo', 'csv', '/nh'], {
+      encoding: 'utf8',
+      windowsHide: true,
+      timeout: 5000
+    });
+    const match = output.match(/"(S-1-[0-9-]+)"/);
+    return match ? match[1] : '';
+  } catch {
+    return '';
+  }
+}
+
+/**
+ * Endpoint the shell extension connects to; must match ShellCommandEndpoint()
+ * in ShellCommandClientWin.cpp / ShellCommandClientPosix.cpp. The pipe is
+ * named after the user's SID, which unlike a user name is unique per account.
+ * @returns {string}
+ */
+function shellCommandEndpoint() {
+  if (process.platform === 'win32') {
+    // Unnamed pipe suffix, as the DLL does when the SID cannot be read.
+    const sid = currentUserSid();
+    return `\\\\.\\pipe\\rrightclickrr-shell${sid ? `-${sid}` : ''}`;
+  }
+
+  const runtimeDir = process.env.XDG_RUNTIME_DIR;
+  if (runtimeDir) {
+    return path.join(runtimeDir, 'rrightclickrr-shell.sock');
+  }
+  return `/tmp/rrightclickrr-shell-${process.getuid()}.sock`;
+}
+
+/**
+ * Read a request header.
+ * @param {Buffer} buffer - At least HEADER_SIZE bytes
+ * @returns {{mode: string, pathCount: number, payloadBytes: number}|null}
+ */
+function readHeader(buffer) {
+  if (buffer.length < HEADER_SIZE || buffer.readUInt32LE(0) !== REQUEST_MAGIC) {
+    return null;
+  }
+  const version = buffer.readUInt16LE(4);
+  const mode = MODES[buffer.readUInt16LE(6)];
+  const pathCount = buffer.readUInt32LE(8);
+  const payloadBytes = buffer.readUInt32LE(12);
+  if (version !== PROTOCOL_VERSION || !mode || payloadBytes > MAX_PAYLOAD || pathCount * 4 > payloadBytes) {
+    return null;
+  }
+  return { mode, pathCount, payloadBytes };
+}
+
+/**
+ * Decode a complete request frame.
+ * @param {Buffer} buffer
+ * @returns {{mode: string, paths: string[]}|null} Null when malformed
+ */
+function decodeShellCommand(buffer) {
+  const header = readHeader(buffer);
+  if (!header || buffer.length !== HEADER_SIZE + header.payloadBytes) {
+    return null;
+  }
+
+  const paths = [];
+  let offset = HEADER_SIZE;
+  for (let i = 0; i < header.pathCount; i++) {
+    if (buffer.length - offset < 4) {
+      return null;
+    }
+    const length = buffer.readUInt32LE(offset);
+    offset += 4;
+    if (length === 0 || length > buffer.length - offset) {
+      return null;
+    }
+    paths.push(buffer.toString('utf8', offset, offset + length));
+    offset += length;
+  }
+  return offset === buffer.length ? { mode: header.mode, paths } : null;
+}
+
+function encodeReply(status) {
+  const reply = Buffer.alloc(8);
+  reply.writeUInt32LE(REPLY_MAGIC, 0);
+  reply.writeUInt32LE(status, 4);
+  return reply;
+}
+
+// Replies as soon as the frame decodes, before the command runs, so Explorer
+// waits only for the hand-off.
+function serveConnection(socket, onRequest) {
+  let chunks = [];
+  let received = 0;
+  let expected = 0;
+
+  socket.setTimeout(CLIENT_TIMEOUT_MS, () => socket.destroy());
+  socket.on('error', () => socket.destroy());
+  socket.on('data', (chunk) => {
+    chunks.push(chunk);
+    received += chunk.length;
+
+    if (expected === 0 && received >= HEADER_SIZE) {
+      const header = readHeader(Buffer.concat(chunks));
+      if (!header) {
+        socket.end(encodeReply(STATUS_REJECTED));
+        socket.removeAllListeners('data');
+        return;
+      }
+      expected = HEADER_SIZE + header.payloadBytes;
+    }
+    if (expected === 0 || received < expected) {
+      return;
+    }
+
+    socket.removeAllListeners('data');
+    const request = decodeShellCommand(Buffer.concat(chunks));
+    chunks = [];
+    socket.end(encodeReply(request ? STATUS_ACCEPTED : STATUS_REJECTED));
+    if (request) {
+      setImmediate(() => onRequest(request));
+    }
+  });
+}
+
+/**
+ * Listen for commands from the shell extension.
+ * @param {(request: {mode: string, paths: string[]}) => void} onRequest
+ * @param {(message: string) => void} [log]
+ * @returns {net.Server}
+ */
+function startShellCommandServer(onRequest, log = () => {}) {
+  const endpoint = shellCommandEndpoint();
+  const server = net.createServer((socket) => serveConnection(socket, onRequest));
+
+  server.on('error', (error) => {
+    // A socket file left by a crashed instance: replace it unless something
+    // still answers on it. Named pipes go away with their owner.
+    if (error.code === 'EADDRINUSE' && process.platform !== 'win32') {
+      const probe = net.connect(endpoint);
+      probe.on('connect', () => {
+        probe.destroy();
+        log(`Shell command endpoint in use: ${endpoint}`);
+      });
+      probe.on('error', () => {
+        try {
+          fs.rmSync(endpoint, { force: true });
+          server.listen(endpoint);
+        } catch (retryError) {
+          log(`Shell command server failed: ${retryError.message}`);
+        }
+      });
+      return;
+    }
+    log(`Shell command server failed: ${error.message}`);
+  });
+
+  server.listen(endpoint, () => log(`Shell command server listening on ${endpoint}`));
+  return server;
+}
+
+module.exports = { shellCommandEndpoint, decodeShellCommand, startShellCommandServer };
@@ -2,18 +2,53 @@ const Store = require('electron-store');
 const path = require('path');
 const fs = require('fs');
 const os = require('os');
+const { loadNativeAddon } = require('./native');
+const { rulesFromMappings } = require('./exclusions');
+
+// Past this size the journal is folded back into a fresh synced-paths.idx.
+const OVERLAY_JOURNAL_COMPACT_BYTES = 1024 * 1024;
+
+// Native store of synced items, next to electron-store's JSON file.
+const SYNC_DATABASE_FILE = 'rrightclickrr-sync-db.log';
+
+// synced-links.idx is rewritten whole, so tracking changes only mark it dirty
+// and it is written once they have been quiet this long (or on flush).
+const DRIVE_LINK_INDEX_DELAY_MS = 2000;
+
+function driveLinkOf(info) {
+  return info && typeof info.driveUrl === 'string' ? info.driveUrl : '';
+}
 
 class SyncTracker {
   constructor() {
     this.store = new Store({
       name: 'rrightclickrr-sync-db',
       defaults: {
-        syncedItems: {}
+        syncedItems: {},
+        syncDatabaseMigrated: false,
+        fallbackChanges: { tracked: [], removedKeys: [], removedPrefixes: [] }
       }
     });
-
-    this.overlayIndexPath = path.join(this.getLocalAppDataPath(), 'RRightclickrr', 'synced-paths.txt');
+    // Synced items live in the native SyncDatabase when the addon loads;
+    // electron-store's syncedItems is the fallback without it. After the
+    // first migration syncedItems is kept, not emptied, so the fallback still
+    // has every item tracked up to then.
+    this.db = this.openSyncDatabase();
+
+    const overlayDir = path.join(this.getLocalAppDataPath(), 'RRightclickrr');
+    this.overlayIndexPath = path.join(overlayDir, 'synced-paths.txt');
+    this.overlayBinaryIndexPath = path.join(overlayDir, 'synced-paths.idx');
+    this.overlayJournalPath = path.join(overlayDir, 'synced-paths.journal');
+    this.overlayStatusPath = path.join(overlayDir, 'sync-status.txt');
+    this.driveLinkIndexPath = path.join(overlayDir, 'synced-links.idx');
+    this.exclusionIndexPath = path.join(overlayDir, 'synced-exclusions.idx');
+    // Transient overlay states (pending/syncing/error) by normalized path.
+    // Not persisted across runs: a fresh start clears whatever was left.
+    this.overlayStatuses = new Map();
+    this.driveLinkIndexTimer = null;
     this.persistSyncedPathIndex();
+    this.persistDriveLinkIndex();
+    this.persistOverlayStatus();
   }
 
   /**
@@ -26,8 +61,8 @@ class SyncTracker {
    */
   trackSync(localPath, driveId, driveUrl, type = 'folder', metadata = null) {
     const normalized = this.normalizePath(localPath);
-    const syncedItems = this.store.get('syncedItems');
-    const existing = syncedItems[normalized] || {};
+    const syncedItems = this.db ? null : this.store.get('syncedItems');
+    const existing = (syncedItems ? syncedItems[normalized] : this.readItem(normalized)) || {};
     const payload = {
       ...existing,
       driveId,
@@ -55,14 +90,14 @@ class SyncTracker {
       }
     }
 
-    syncedItems[normalized] = payload;
-
-    this.store.set('syncedItems', syncedItems);
-    this.persistSyncedPathIndex();
+    this.writeItems([[normalized, payload]], syncedItems);
+    this.persistSyncedPathIndex({ adds: [normalized] });
+    this.scheduleDriveLinkIndex();
   }
 
   /**
-   * Bulk record/update synced items with a single store write.
+   * Bulk record/update synced items with a single store write (one database
+   * batch with the native store).
    * @param {Array<object>} entries
    */
   bulkTrackSync(entries = []) {
@@ -70,7 +105,9 @@ class SyncTracker {
       return;
     }
 
-    const syncedItems = this.store.get('syncedItems');
+    const syncedItems = this.db ? null : this.store.get('syncedItems');
+    const updates = [];
+    const adds = [];
 
     for (const entry of entries) {
       if (!entry || !entry.localPath || !entry.driveId) {
@@ -78,7 +115,7 @@ class SyncTracker {
       }
 
       const normalized = this.normalizePath(entry.localPath);
-      const existing = syncedItems[normalized] || {};
+      const existing = (syncedItems ? syncedItems[normalized] : this.readItem(normalized)) || {};
       const payload = {
         ...existing,
         driveId: entry.driveId,
@@ -107,11 +144,13 @@ class SyncTracker {
         }
       }
 
-      syncedItems[normalized] = payload;
+      updates.push([normalized, payload]);
+      adds.push(normalized);
     }
 
-    this.store.set('syncedItems', syncedItems);
-    this.persistSyncedPathIndex();
+    this.writeItems(updates, syncedItems);
+    this.persistSyncedPathIndex({ adds });
+    this.scheduleDriveLinkIndex();
   }
 
   /**
@@ -138,9 +177,7 @@ class SyncTracker {
    * @returns {object|null} Sync info or null if not synced
    */
   getSyncInfo(localPath) {
-    const normalized = this.normalizePath(localPath);
-    const syncedItems = this.store.get('syncedItems');
-    return syncedItems[normalized] || null;
+    return this.readItem(this.normalizePath(localPath));
   }
 
   /**
@@ -178,10 +215,23 @@ class SyncTracker {
    */
   untrack(localPath) {
     const normalized = this.normalizePath(localPath);
+    const prefix = normalized.endsWith(path.sep) ? normalized : normalized + path.sep;
+    if (this.db) {
+      this.db.remove([normalized], []);
+      // The journal's remove drops everything beneath the path, so re-add
+      // the tracked items that are still under it.
+      this.persistSyncedPathIndex({ adds: this.db.keys(prefix), removes: [normalized] });
+      this.scheduleDriveLinkIndex();
+      return;
+    }
+
     const syncedItems = this.store.get('syncedItems');
     delete syncedItems[normalized];
-    this.store.set('syncedItems', syncedItems);
-    this.persistSyncedPathIndex();
+    this.saveSyncedItems(syncedItems, { removedKeys: [normalized] });
+
+    const adds = Object.keys(syncedItems).filter((key) => key.startsWith(prefix));
+    this.persistSyncedPathIndex({ adds, removes: [normalized] });
+    this.scheduleDriveLinkIndex();
   }
 
   /**
@@ -191,16 +241,23 @@ class SyncTracker {
   untrackUnderPath(localPath) {
     const normalizedRoot = this.normalizePath(localPath);
     const prefix = normalizedRoot.endsWith(path.sep) ? normalizedRoot : normalizedRoot + path.sep;
-    const syncedItems = this.store.get('syncedItems');
+    if (this.db) {
+      this.db.remove([normalizedRoot], [prefix]);
+      this.persistSyncedPathIndex({ removes: [normalizedRoot] });
+      this.scheduleDriveLinkIndex();
+      return;
+    }
 
+    const syncedItems = this.store.get('syncedItems');
     for (const key of Object.keys(syncedItems)) {
       if (key === normalizedRoot || key.startsWith(prefix)) {
         delete syncedItems[key];
       }
     }
 
-    this.store.set('syncedItems', syncedItems);
-    this.persistSyncedPathIndex();
+    this.saveSyncedItems(syncedItems, { removedKeys: [normalizedRoot], removedPrefixes: [prefix] });
+    this.persistSyncedPathIndex({ removes: [normalizedRoot] });
+    this.scheduleDriveLinkIndex();
   }
 
   /**
@@ -208,7 +265,15 @@ class SyncTracker {
    * @returns {object} All synced items
    */
   getAllSynced() {
-    return this.store.get('syncedItems');
+    if (!this.db) {
+      return this.store.get('syncedItems');
+    }
+    const { keys, values } = this.db.entries();
+    const items = {};
+    keys.forEach((key, i) => {
+      items[key] = JSON.parse(values[i]);
+    });
+    return items;
   }
 
   /**
@@ -216,20 +281,349 @@ class SyncTracker {
    * @returns {string[]} Array of normalized paths
    */
   getAllSyncedPaths() {
-    return Object.keys(this.store.get('syncedItems'));
+    return this.db ? this.db.keys() : Object.keys(this.store.get('syncedItems'));
+  }
+
+  /**
+   * Open the native sync database. The first time, every item electron-store
+   * holds is moved over and syncedItems is marked migrated but kept. Later,
+   * only what changed while the addon was unavailable is replayed, so the
+   * stale copy never overwrites newer database entries.
+   * @returns {object|null} The SyncDatabase, or null to use electron-store
+   */
+  openSyncDatabase() {
+    const native = loadNativeAddon();
+    if (!native || typeof native.SyncDatabase !== 'function') {
+      return null;
+    }
+
+    const dbPath = path.join(path.dirname(this.store.path), SYNC_DATABASE_FILE);
+    try {
+      // A database that lost its file starts over from the kept copy.
+      const migrated = this.store.get('syncDatabaseMigrated') && fs.existsSync(dbPath);
+      const db = new native.SyncDatabase(dbPath);
+      const legacy = this.store.get('syncedItems') || {};
+      const pending = this.store.get('fallbackChanges');
+
+      if (migrated && (pending.removedKeys.length > 0 || pending.removedPrefixes.length > 0)) {
+        db.remove(pending.removedKeys, pending.removedPrefixes);
+      }
+      const keys = (migrated ? pending.tracked : Object.keys(legacy)).filter(key => legacy[key]);
+      if (keys.length > 0) {
+        db.put(
+          keys,
+          keys.map(key => driveLinkOf(legacy[key])),
+          keys.map(key => JSON.stringify(legacy[key]))
+        );
+      }
+
+      this.store.set({
+        syncDatabaseMigrated: true,
+        fallbackChanges: { tracked: [], removedKeys: [], removedPrefixes: [] }
+      });
+      return db;
+    } catch (error) {
+      console.warn(`Sync database ${dbPath} unavailable, using electron-store: ${error.message}`);
+      return null;
+    }
+  }
+
+  /**
+   * Tracked item by normalized path.
+   * @param {string} normalized - Normalized path
+   * @returns {object|null}
+   */
+  readItem(normalized) {
+    if (this.db) {
+      const json = this.db.get(normalized);
+      return json ? JSON.parse(json) : null;
+    }
+    return this.store.get('syncedItems')[normalized] || null;
+  }
+
+  /**
+   * Store tracked items: one database batch, or one electron-store write of
+   * syncedItems (already loaded by the caller) without the native store.
+   * @param {Array<[string, object]>} updates - [normalized path, item] pairs
+   * @param {object|null} syncedItems - electron-store's items; null with the native store
+   */
+  writeItems(updates, syncedItems) {
+    if (this.db) {
+      this.db.put(
+        updates.map(([key]) => key),
+        updates.map(([, info]) => driveLinkOf(info)),
+        updates.map(([, info]) => JSON.stringify(info))
+      );
+      return;
+    }
+
+    for (const [key, info] of updates) {
+      syncedItems[key] = info;
+    }
+    this.saveSyncedItems(syncedItems, { tracked: updates.map(([key]) => key) });
+  }
+
+  /**
+   * Write electron-store's syncedItems without the native store. Once items
+   * have been migrated, the changes are also queued for openSyncDatabase to
+   * replay into the database when it opens again.
+   * @param {object} syncedItems
+   * @param {{tracked?: string[], removedKeys?: string[], removedPrefixes?: string[]}} changes
+   */
+  saveSyncedItems(syncedItems, { tracked = [], removedKeys = [], removedPrefixes = [] }) {
+    if (!this.store.get('syncDatabaseMigrated')) {
+      this.store.set('syncedItems', syncedItems);
+      return;
+    }
+
+    const pending = this.store.get('fallbackChanges');
+    const merge = (list, added) => [...new Set([...(list || []), ...added])];
+    this.store.set({
+      syncedItems,
+      fallbackChanges: {
+        tracked: merge(pending.tracked, tracked),
+        removedKeys: merge(pending.removedKeys, removedKeys),
+        removedPrefixes: merge(pending.removedPrefixes, removedPrefixes)
+      }
+    });
   }
 
   getLocalAppDataPath() {
     return process.env.LOCALAPPDATA || path.join(os.homedir(), 'AppData', 'Local');
   }
 
-  persistSyncedPathIndex() {
+  /**
+   * Publish the overlay index for the shell extension.
+   * The binary synced-paths.idx (memory-mapped by the overlay handler) is
+   * written through the native addon; synced-paths.txt stays as the fallback
+   * the handler reads when the binary index is missing or invalid.
+   * With a delta, the change is appended to synced-paths.journal instead and
+   * both files are left as they are until the journal needs compacting.
+   * With the native store both files are written from it directly.
+   * @param {{adds?: string[], removes?: string[]}|null} delta - Normalized paths changed since the last publish
+   */
+  persistSyncedPathIndex(delta = null) {
+    if (delta && this.appendOverlayJournal(delta)) {
+      return;
+    }
+
+    let syncedPaths;
     try {
-      const syncedPaths = this.getAllSyncedPaths();
       fs.mkdirSync(path.dirname(this.overlayIndexPath), { recursive: true });
-      fs.writeFileSync(this.overlayIndexPath, syncedPaths.join('\n'), 'utf8');
+      if (this.db) {
+        this.db.writePathList(this.overlayIndexPath);
+      } else {
+        syncedPaths = this.getAllSyncedPaths();
+        fs.writeFileSync(this.overlayIndexPath, syncedPaths.join('\n'), 'utf8');
+      }
     } catch {
       // Keep tracker writes non-fatal if index file update fails.
+      return;
+    }
+
+    const native = loadNativeAddon();
+    try {
+      if (native) {
+        native.writeOverlayIndex(this.overlayBinaryIndexPath, this.db || syncedPaths, this.overlayJournalPath);
+        return;
+      }
+    } catch {
+      // Fall through: a stale binary index would shadow the fresh text one.
+    }
+
+    try {
+      fs.rmSync(this.overlayBinaryIndexPath, { force: true });
+    } catch {
+      // The handler rejects unreadable binary indexes and uses the text file.
+    }
+  }
+
+  /**
+   * Publish synced-links.idx, the path-to-Drive-URL index the shell
+   * extension's "Copy Google Drive Link" answers from without starting the
+   * app. Without the native addon the file is removed so the extension never
+   * copies a stale link; it then launches the app as before. With the
+   * native store the links come from it directly.
+   */
+  persistDriveLinkIndex() {
+    const native = loadNativeAddon();
+    try {
+      if (native && typeof native.writeDriveLinkIndex === 'function') {
+        fs.mkdirSync(path.dirname(this.driveLinkIndexPath), { recursive: true });
+        if (this.db) {
+          native.writeDriveLinkIndex(this.driveLinkIndexPath, this.db);
+          return;
+        }
+
+        const items = this.store.get('syncedItems');
+        const paths = [];
+        const urls = [];
+        for (const [normalized, info] of Object.entries(items)) {
+          const url = driveLinkOf(info);
+          if (url) {
+            paths.push(normalized);
+            urls.push(url);
+          }
+        }
+        native.writeDriveLinkIndex(this.driveLinkIndexPath, paths, urls);
+        return;
+      }
+    } catch {
+      // Fall through and remove the old index.
+    }
+
+    try {
+      fs.rmSync(this.driveLinkIndexPath, { force: true });
+    } catch {
+      // The extension launches the app when the index is missing.
+    }
+  }
+
+  /**
+   * Mark synced-links.idx stale. It is rewritten once tracking has been quiet
+   * for DRIVE_LINK_INDEX_DELAY_MS, so a sync tracking thousands of files
+   * writes it once rather than once per file.
+   */
+  scheduleDriveLinkIndex() {
+    if (this.driveLinkIndexTimer) {
+      clearTimeout(this.driveLinkIndexTimer);
+    }
+    this.driveLinkIndexTimer = setTimeout(() => this.flushDriveLinkIndex(), DRIVE_LINK_INDEX_DELAY_MS);
+    if (typeof this.driveLinkIndexTimer.unref === 'function') {
+      this.driveLinkIndexTimer.unref();
+    }
+  }
+
+  /**
+   * Write synced-links.idx now if tracking changed since it was last
+   * written. Called when a sync job finishes and before quitting.
+   */
+  flushDriveLinkIndex() {
+    if (!this.driveLinkIndexTimer) {
+      return;
+    }
+    clearTimeout(this.driveLinkIndexTimer);
+    this.driveLinkIndexTimer = null;
+    this.persistDriveLinkIndex();
+  }
+
+  /**
+   * Publish synced-exclusions.idx, every synced folder's exclude patterns
+   * compiled for the overlay handler, which leaves excluded paths without a
+   * badge. Without the native addon the file is removed; excluded paths then
+   * show their synced folder's badge as before.
+   * @param {{localPath: string, excludePaths?: string[]}[]} mappings - Folder mappings
+   */
+  persistExclusionIndex(mappings = []) {
+    const rules = rulesFromMappings(mappings);
+    const native = loadNativeAddon();
+    try {
+      if (native && typeof native.writeExclusionIndex === 'function') {
+        fs.mkdirSync(path.dirname(this.exclusionIndexPath), { recursive: true });
+        native.writeExclusionIndex(
+          this.exclusionIndexPath,
+          rules.map(rule => rule.root),
+          rules.map(rule => rule.pattern)
+        );
+        return;
+      }
+    } catch {
+      // Fall through and remove the old index.
+    }
+
+    try {
+      fs.rmSync(this.exclusionIndexPath, { force: true });
+    } catch {
+      // A missing index excludes nothing.
+    }
+  }
+
+  /**
+   * Append a change to the overlay journal.
+   * @param {{adds?: string[], removes?: string[]}} delta
+   * @returns {boolean} False when the caller should rewrite the full index instead
+   */
+  appendOverlayJournal({ adds = [], removes = [] }) {
+    const native = loadNativeAddon();
+    if (!native || typeof native.appendOverlayJournal !== 'function') {
+      return false;
+    }
+
+    try {
+      const journalBytes = native.appendOverlayJournal(
+        this.overlayBinaryIndexPath,
+        this.overlayJournalPath,
+        adds,
+        removes
+      );
+      return journalBytes < OVERLAY_JOURNAL_COMPACT_BYTES;
+    } catch {
+      // No valid index to append to yet, or the write failed.
+      return false;
+    }
+  }
+
+  /**
+   * Set or clear the overlay state shown on folders or files.
+   * A state covers the path and everything beneath it; the handler shows
+   * error over syncing over pending, and any of them over synced.
+   * @param {string|string[]} localPaths - Full local path(s)
+   * @param {'pending'|'syncing'|'error'|null} state - null clears the state
+   */
+  setOverlayStatus(localPaths, state) {
+    let changed = false;
+    for (const localPath of [].concat(localPaths)) {
+      if (!localPath) continue;
+      const normalized = this.normalizePath(localPath);
+      if (state) {
+        changed = changed || this.overlayStatuses.get(normalized) !== state;
+        this.overlayStatuses.set(normalized, state);
+      } else {
+        changed = this.overlayStatuses.delete(normalized) || changed;
+      }
+    }
+    if (changed) {
+      this.persistOverlayStatus();
+    }
+  }
+
+  /**
+   * Clear the overlay state of a folder and of everything beneath it.
+   * @param {string} localPath - Root folder path
+   */
+  clearOverlayStatusUnder(localPath) {
+    const normalizedRoot = this.normalizePath(localPath);
+    const prefix = normalizedRoot.endsWith(path.sep) ? normalizedRoot : normalizedRoot + path.sep;
+    let changed = false;
+    for (const key of [...this.overlayStatuses.keys()]) {
+      if (key === normalizedRoot || key.startsWith(prefix)) {
+        this.overlayStatuses.delete(key);
+        changed = true;
+      }
+    }
+    if (changed) {
+      this.persistOverlayStatus();
+    }
+  }
+
+  /**
+   * Write sync-status.txt ("<state>\t<path>" per line) for the overlay
+   * handlers. Written to a temporary file and renamed so the handler never
+   * reads half a file.
+   */
+  persistOverlayStatus() {
+    const lines = [];
+    for (const [normalized, state] of this.overlayStatuses) {
+      lines.push(`${state}\t${normalized}`);
+    }
+
+    const tempPath = `${this.overlayStatusPath}.tmp`;
+    try {
+      fs.mkdirSync(path.dirname(this.overlayStatusPath), { recursive: true });
+      fs.writeFileSync(tempPath, lines.join('\n'), 'utf8');
+      fs.renameSync(tempPath, this.overlayStatusPath);
+    } catch {
+      // Overlay states are cosmetic; never fail a sync over them.
     }
   }
 